@@ -49,12 +49,16 @@ int main(int argc, char *argv[]) {
     BaseFloat acoustic_scale = 0.1;
     LatticeFasterDecoderConfig config;
 
-    std::string word_syms_filename;
+    std::string word_syms_filename, state_counts_wxfilename;
     config.Register(&po);
     po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for acoustic likelihoods");
 
     po.Register("word-symbol-table", &word_syms_filename, "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial, "If true, produce output even if end state was not reached.");
+    po.Register("state-counts", &state_counts_wxfilename, "If set, write to "
+                "this file the number of times each state of the graph was "
+                "expanded, for use by fstreorderstates --order=frequency "
+                "(only if a single FST is given).");
 
     po.Read(argc, argv);
 
@@ -101,8 +105,11 @@ int main(int argc, char *argv[]) {
       Fst<StdArc> *decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
       timer.Reset();
 
+      std::vector<kaldi::int64> state_counts;
       {
         LatticeFasterDecoder decoder(*decode_fst, config);
+        if (state_counts_wxfilename != "")
+          decoder.SetStateCounts(&state_counts);
 
         for (; !loglike_reader.Done(); loglike_reader.Next()) {
           std::string utt = loglike_reader.Key();
@@ -128,8 +135,16 @@ int main(int argc, char *argv[]) {
           } else num_fail++;
         }
       }
+      if (state_counts_wxfilename != "") {
+        // One entry per state, including the ones never expanded.
+        state_counts.resize(fst::CountStates(*decode_fst), 0);
+        Output ko(state_counts_wxfilename, true);
+        WriteIntegerVector(ko.Stream(), true, state_counts);
+      }
       delete decode_fst; // delete this only after decoder goes out of scope.
     } else { // We have different FSTs for different utterances.
+      if (state_counts_wxfilename != "")
+        KALDI_ERR << "--state-counts needs a single FST.";
       SequentialTableReader<fst::VectorFstHolder> fst_reader(fst_in_str);
       RandomAccessBaseFloatMatrixReader loglike_reader(feature_rspecifier);
       for (; !fst_reader.Done(); fst_reader.Next()) {
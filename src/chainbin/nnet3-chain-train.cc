@@ -21,6 +21,7 @@
 #include "util/common-utils.h"
 #include "nnet3/nnet-chain-training.h"
 #include "cudamatrix/cu-allocator.h"
+#include "cudamatrix/cu-thread-pool.h"
 
 
 int main(int argc, char *argv[]) {
@@ -44,6 +45,7 @@ int main(int argc, char *argv[]) {
     int32 srand_seed = 0;
     bool binary_write = true;
     std::string use_gpu = "yes";
+    int32 cpu_threads = 1;
     NnetChainTrainingOptions opts;
 
     ParseOptions po(usage);
@@ -51,9 +53,13 @@ int main(int argc, char *argv[]) {
     po.Register("binary", &binary_write, "Write output in binary mode");
     po.Register("use-gpu", &use_gpu,
                 "yes|no|optional|wait, only has effect if compiled with CUDA");
+    po.Register("cpu-threads", &cpu_threads, "Number of threads for the "
+                "matrix operations when not using the GPU (best with a "
+                "single-threaded BLAS).");
 
     opts.Register(&po);
     RegisterCuAllocatorOptions(&po);
+    RegisterCpuAllocatorOptions(&po);
 
     po.Read(argc, argv);
 
@@ -67,6 +73,7 @@ int main(int argc, char *argv[]) {
 #if HAVE_CUDA==1
     CuDevice::Instantiate().SelectGpuId(use_gpu);
 #endif
+    CuThreadPool::Instantiate().SetNumThreads(cpu_threads);
 
     std::string nnet_rxfilename = po.GetArg(1),
         den_fst_rxfilename = po.GetArg(2),
@@ -95,6 +102,8 @@ int main(int argc, char *argv[]) {
 #if HAVE_CUDA==1
     CuDevice::Instantiate().PrintProfile();
 #endif
+    if (GetVerboseLevel() >= 1)
+      CpuMemoryAllocator::Instantiate().PrintMemoryUsage();
     WriteKaldiObject(nnet, nnet_wxfilename, binary_write);
     KALDI_LOG << "Wrote raw model to " << nnet_wxfilename;
     return (ok ? 0 : 1);
@@ -23,6 +23,7 @@
 #include "cudamatrix/cu-matrix.h"
 #include "cudamatrix/cu-device.h"
 #include "cudamatrix/cu-kernels.h"
+#include "cudamatrix/cu-thread-pool.h"
 
 namespace kaldi {
 
@@ -238,6 +239,73 @@ void EnsureNonzero(const CuMatrixBase<Real> &src,
   }
 }
 
+template <typename Real>
+void AddMatQuantizedMat(Real alpha, const CuMatrixBase<Real> &A,
+                        const CuMatrixBase<Real> &B,
+                        const QuantizedMatrix &B_quantized,
+                        Real beta, CuMatrixBase<Real> *C) {
+  bool use_quantized = (B_quantized.NumRows() != 0);
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    use_quantized = false;
+#endif
+  if (use_quantized) {
+    KALDI_ASSERT(B_quantized.NumRows() == B.NumRows() &&
+                 B_quantized.NumCols() == B.NumCols());
+    // A is quantized row by row, so splitting the rows changes nothing.
+    CuThreadPool::Instantiate().Run(
+        A.NumRows(), 2 * static_cast<int64>(B.NumRows()) * B.NumCols(),
+        [&](MatrixIndexT begin, MatrixIndexT end) {
+          SubMatrix<Real> A_part(A.Mat(), begin, end - begin, 0, A.NumCols()),
+              C_part(C->Mat(), begin, end - begin, 0, C->NumCols());
+          kaldi::AddMatQuantizedMat(alpha, A_part, B_quantized, beta, &C_part);
+        });
+  } else {
+    C->AddMatMat(alpha, A, kNoTrans, B, kTrans, beta);
+  }
+}
+
+template <typename Real>
+void AddMatPanelMat(Real alpha, const CuMatrixBase<Real> &A,
+                    const CuMatrixBase<Real> &B,
+                    const PanelMatrix &B_packed,
+                    Real beta, CuMatrixBase<Real> *C) {
+  bool use_packed = (B_packed.NumRows() != 0 &&
+                     PanelMatrixIsFaster(A.NumRows()));
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    use_packed = false;
+#endif
+  if (use_packed) {
+    KALDI_ASSERT(B_packed.NumRows() == B.NumRows() &&
+                 B_packed.NumCols() == B.NumCols());
+    kaldi::AddMatPanelMat(alpha, A.Mat(), B_packed, beta, &(C->Mat()));
+  } else {
+    C->AddMatMat(alpha, A, kNoTrans, B, kTrans, beta);
+  }
+}
+
+template <typename Real>
+void AddMatHalfMat(Real alpha, const CuMatrixBase<Real> &A,
+                   const HalfMatrix &B, Real beta, CuMatrixBase<Real> *C) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Matrix<Real> B_full(B.NumRows(), B.NumCols(), kUndefined);
+    B.CopyToMat(&B_full);
+    CuMatrix<Real> B_gpu(B_full);
+    C->AddMatMat(alpha, A, kNoTrans, B_gpu, kTrans, beta);
+    return;
+  }
+#endif
+  CuThreadPool::Instantiate().Run(
+      A.NumRows(), 2 * static_cast<int64>(B.NumRows()) * B.NumCols(),
+      [&](MatrixIndexT begin, MatrixIndexT end) {
+        SubMatrix<Real> A_part(A.Mat(), begin, end - begin, 0, A.NumCols()),
+            C_part(C->Mat(), begin, end - begin, 0, C->NumCols());
+        kaldi::AddMatHalfMat(alpha, A_part, B, beta, &C_part);
+      });
+}
+
 
 // instantiate the templates.
 template
@@ -943,6 +1011,33 @@ void EnsureNonzero(const CuVectorBase<double> &src,
                    double epsilon,
                    CuVectorBase<double> *dest);
 
+template
+void AddMatQuantizedMat(float alpha, const CuMatrixBase<float> &A,
+                        const CuMatrixBase<float> &B,
+                        const QuantizedMatrix &B_quantized,
+                        float beta, CuMatrixBase<float> *C);
+template
+void AddMatQuantizedMat(double alpha, const CuMatrixBase<double> &A,
+                        const CuMatrixBase<double> &B,
+                        const QuantizedMatrix &B_quantized,
+                        double beta, CuMatrixBase<double> *C);
+template
+void AddMatPanelMat(float alpha, const CuMatrixBase<float> &A,
+                    const CuMatrixBase<float> &B,
+                    const PanelMatrix &B_packed,
+                    float beta, CuMatrixBase<float> *C);
+template
+void AddMatPanelMat(double alpha, const CuMatrixBase<double> &A,
+                    const CuMatrixBase<double> &B,
+                    const PanelMatrix &B_packed,
+                    double beta, CuMatrixBase<double> *C);
+template
+void AddMatHalfMat(float alpha, const CuMatrixBase<float> &A,
+                   const HalfMatrix &B, float beta, CuMatrixBase<float> *C);
+template
+void AddMatHalfMat(double alpha, const CuMatrixBase<double> &A,
+                   const HalfMatrix &B, double beta, CuMatrixBase<double> *C);
+
 template
 void CpuBackpropLstmNonlinearity(const MatrixBase<float> &input,
                                  const MatrixBase<float> &params,
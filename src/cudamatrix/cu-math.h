@@ -26,6 +26,9 @@
 #include "cudamatrix/cu-array.h"
 #include "cudamatrix/cu-device.h"
 #include "base/timer.h"
+#include "matrix/half-matrix.h"
+#include "matrix/panel-matrix.h"
+#include "matrix/quantized-matrix.h"
 
 namespace kaldi {
 
@@ -93,6 +96,39 @@ void EnsureNonzero(const CuVectorBase<Real> &src,
                    Real epsilon,
                    CuVectorBase<Real> *dest);
 
+/// Does *C = alpha * A * B^T + beta * *C, where B_quantized is a
+/// QuantizedMatrix copy of B (see AddMatQuantizedMat() in
+/// ../matrix/quantized-matrix.h).  When we are using the GPU, or when
+/// B_quantized is empty, it is ignored and this is the same as
+/// C->AddMatMat(alpha, A, kNoTrans, B, kTrans, beta); so the layers that
+/// support quantization can call it unconditionally.
+template <typename Real>
+void AddMatQuantizedMat(Real alpha, const CuMatrixBase<Real> &A,
+                        const CuMatrixBase<Real> &B,
+                        const QuantizedMatrix &B_quantized,
+                        Real beta, CuMatrixBase<Real> *C);
+
+/// Does *C = alpha * A * B^T + beta * *C, where B_packed is a PanelMatrix
+/// copy of B (see AddMatPanelMat() in ../matrix/panel-matrix.h).  It is used
+/// only when it is expected to be faster (see PanelMatrixIsFaster()), i.e.
+/// when A has few rows, and not when we are using the GPU or when B_packed is
+/// empty; otherwise this is the same as
+/// C->AddMatMat(alpha, A, kNoTrans, B, kTrans, beta).
+template <typename Real>
+void AddMatPanelMat(Real alpha, const CuMatrixBase<Real> &A,
+                    const CuMatrixBase<Real> &B,
+                    const PanelMatrix &B_packed,
+                    Real beta, CuMatrixBase<Real> *C);
+
+/// Does *C = alpha * A * B^T + beta * *C, where B is stored in 16-bit
+/// floating point (see AddMatHalfMat() in ../matrix/half-matrix.h).  This is
+/// for layers that keep their parameters only in that form, to save memory;
+/// if we are using the GPU, B is converted to float and copied to the GPU for
+/// each call, which is slow.
+template <typename Real>
+void AddMatHalfMat(Real alpha, const CuMatrixBase<Real> &A,
+                   const HalfMatrix &B, Real beta, CuMatrixBase<Real> *C);
+
 /**
  this is a special-purpose function used by class LstmNonlinearityComponent,
  to do its forward propagation.  It computes the core part of the LSTM nonlinearity.
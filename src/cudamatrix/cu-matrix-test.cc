@@ -1419,6 +1419,33 @@ static void UnitTestCuMatrixAddMat() {
   }
 }
 
+// AddMat() of a matrix to itself, transposed, with enough threads in
+// CuThreadPool that the CPU version would be split if it did not check for
+// the aliasing.  This can't be part of CudaMatrixUnitTest(), which is run in
+// several threads at once, as it changes the number of threads of the pool.
+template<typename Real>
+static void UnitTestCuMatrixAddMatSelf() {
+  CuThreadPool &pool = CuThreadPool::Instantiate();
+  int32 num_threads = pool.NumThreads();
+  pool.SetNumThreads(4);
+  for (int32 i = 0; i < 3; i++) {
+    int32 N = 400 + Rand() % 200;
+    Matrix<Real> H(N, N);
+    H.SetRandn();
+    CuMatrix<Real> D(H);
+    Real alpha = 0.5;
+    H.AddMat(alpha, H, kTrans);
+    D.AddMat(alpha, D, kTrans);
+    Matrix<Real> H2(D);
+    AssertEqual(H, H2);
+    H.AddMat(alpha, H);
+    D.AddMat(alpha, D);
+    H2.CopyFromMat(D);
+    AssertEqual(H, H2);
+  }
+  pool.SetNumThreads(num_threads);
+}
+
 
 // this tests the branch of AddMatBlocks() that is taken when
 // 'this' has a smaller dimension than 'src' (it sums).
@@ -3051,6 +3078,8 @@ int main() {
   // to large, because it will affect CPU usage if you are using CPU.
   int32 num_threads = 4;
 
+  kaldi::UnitTestCuMatrixAddMatSelf<float>();
+  kaldi::UnitTestCuMatrixAddMatSelf<double>();
 
 #if HAVE_CUDA == 1
   for (loop = 0; loop < 2; loop++) {
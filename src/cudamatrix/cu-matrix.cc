@@ -31,6 +31,7 @@
 #endif
 
 #include "base/timer.h"
+#include "matrix/cpu-allocator.h"
 #include "cudamatrix/cu-common.h"
 #include "cudamatrix/cu-vector.h"
 #include "cudamatrix/cu-device.h"
@@ -41,10 +42,44 @@
 #include "cudamatrix/cu-tp-matrix.h"
 #include "cudamatrix/cu-block-matrix.h"
 #include "cudamatrix/cu-sparse-matrix.h"
+#include "cudamatrix/cu-thread-pool.h"
 #include "cudamatrix/cublas-wrappers.h"
 
 namespace kaldi {
 
+// The CPU versions of many of the operations below are split by rows over
+// the threads of CuThreadPool; these return rows (or columns) 'begin' ...
+// 'end' - 1 of M.
+template<typename Real>
+static inline SubMatrix<Real> CpuRows(const CuMatrixBase<Real> &M,
+                                      MatrixIndexT begin, MatrixIndexT end) {
+  if (M.NumCols() == 0)
+    return SubMatrix<Real>(M.Mat(), 0, 0, 0, 0);
+  return SubMatrix<Real>(M.Mat(), begin, end - begin, 0, M.NumCols());
+}
+
+template<typename Real>
+static inline SubMatrix<Real> CpuCols(const CuMatrixBase<Real> &M,
+                                      MatrixIndexT begin, MatrixIndexT end) {
+  if (M.NumRows() == 0)
+    return SubMatrix<Real>(M.Mat(), 0, 0, 0, 0);
+  return SubMatrix<Real>(M.Mat(), 0, M.NumRows(), begin, end - begin);
+}
+
+// Returns true if the memory of A and B overlaps.  Operations that read one
+// matrix while writing another can't be split over the threads if they do,
+// since a thread may then read rows that another one is writing.
+template<typename Real>
+static inline bool CpuOverlaps(const CuMatrixBase<Real> &A,
+                               const CuMatrixBase<Real> &B) {
+  if (A.NumRows() == 0 || A.NumCols() == 0 ||
+      B.NumRows() == 0 || B.NumCols() == 0)
+    return false;
+  const Real *a_end = A.Data() + (A.NumRows() - 1) * A.Stride() + A.NumCols(),
+      *b_end = B.Data() + (B.NumRows() - 1) * B.Stride() + B.NumCols();
+  return A.Data() < b_end && B.Data() < a_end;
+}
+
 template<typename Real>
 void CuMatrix<Real>::Resize(MatrixIndexT rows, MatrixIndexT cols,
                             MatrixResizeType resize_type,
@@ -101,7 +136,7 @@ void CuMatrix<Real>::Destroy() {
   } else
 #endif
   {
-    if (this->data_ != NULL) KALDI_MEMALIGN_FREE(this->data_);
+    if (this->data_ != NULL) CpuMemoryAllocator::Instantiate().Free(this->data_);
   }
   this->data_ = NULL;
   this->num_rows_ = 0;
@@ -674,7 +709,11 @@ void CuMatrixBase<Real>::MulElements(const CuMatrixBase<Real>& A) {
   } else
   #endif
   {
-    Mat().MulElements(A.Mat());
+    KALDI_ASSERT(SameDim(*this, A));
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).MulElements(CpuRows(A, begin, end));
+        });
   }
 }
 
@@ -968,7 +1007,22 @@ void CuMatrixBase<Real>::AddMat(Real alpha, const CuMatrixBase<Real>& A,
   } else
 #endif
   {
-    Mat().AddMat(alpha, A.Mat(), transA);
+    if (transA == kNoTrans) {
+      KALDI_ASSERT(A.NumRows() == num_rows_ && A.NumCols() == num_cols_);
+    } else {
+      KALDI_ASSERT(A.NumCols() == num_rows_ && A.NumRows() == num_cols_);
+    }
+    if (CpuOverlaps(A, *this)) {
+      // e.g. AddMat(alpha, *this, kTrans), which MatrixBase handles.
+      Mat().AddMat(alpha, A.Mat(), transA);
+      return;
+    }
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).AddMat(
+              alpha, transA == kNoTrans ? CpuRows(A, begin, end) :
+              CpuCols(A, begin, end), transA);
+        });
   }
 }
 
@@ -1268,8 +1322,12 @@ void CuMatrixBase<Real>::AddVecToRows(Real alpha,
   } else
 #endif
   {
-    if (beta != 1.0) Mat().Scale(beta);
-    Mat().AddVecToRows(alpha, row.Vec());
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          SubMatrix<Real> this_part(CpuRows(*this, begin, end));
+          if (beta != 1.0) this_part.Scale(beta);
+          this_part.AddVecToRows(alpha, row.Vec());
+        });
   }
 }
 
@@ -1311,7 +1369,20 @@ void CuMatrixBase<Real>::AddMatMat(
   } else
 #endif
   {
-    Mat().AddMatMat(alpha, A.Mat(), transA, B.Mat(), transB, beta);
+    if (CpuOverlaps(A, *this) || CpuOverlaps(B, *this)) {
+      // Not allowed; MatrixBase will fail, or at least not race.
+      Mat().AddMatMat(alpha, A.Mat(), transA, B.Mat(), transB, beta);
+      return;
+    }
+    // Each thread does a block of rows of *this, so this does not depend on
+    // the BLAS being multi-threaded.
+    CuThreadPool::Instantiate().Run(
+        NumRows(), 2 * static_cast<int64>(m) * k,
+        [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).AddMatMat(
+              alpha, transA == kNoTrans ? CpuRows(A, begin, end) :
+              CpuCols(A, begin, end), transA, B.Mat(), transB, beta);
+        });
   }
 }
 
@@ -1397,7 +1468,14 @@ void CuMatrixBase<Real>::AddDiagVecMat(
   } else
 #endif
   {
-    Mat().AddDiagVecMat(alpha, v.Vec(), M.Mat(), transM, beta);
+    KALDI_ASSERT(v.Dim() == NumRows());
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).AddDiagVecMat(
+              alpha, v.Vec().Range(begin, end - begin),
+              transM == kNoTrans ? CpuRows(M, begin, end) :
+              CpuCols(M, begin, end), transM, beta);
+        });
   }
 }
 
@@ -1538,7 +1616,10 @@ void CuMatrixBase<Real>::Sigmoid(const CuMatrixBase<Real> &src) {
   } else
   #endif
   {
-    Mat().Sigmoid(src.Mat());
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).Sigmoid(CpuRows(src, begin, end));
+        });
   }
 }
 
@@ -1716,11 +1797,13 @@ void CuMatrixBase<Real>::ApplySoftMaxPerRow(const CuMatrixBase<Real> &src) {
   } else
   #endif
   {
-    MatrixBase<Real> &mat(this->Mat());
-    mat.CopyFromMat(src.Mat());
-    for(MatrixIndexT r = 0; r < mat.NumRows(); r++) {
-      mat.Row(r).ApplySoftMax();
-    }
+    CuThreadPool::Instantiate().Run(
+        NumRows(), 10 * NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          SubMatrix<Real> mat(CpuRows(*this, begin, end));
+          mat.CopyFromMat(CpuRows(src, begin, end));
+          for (MatrixIndexT r = 0; r < mat.NumRows(); r++)
+            mat.Row(r).ApplySoftMax();
+        });
   }
 }
 
@@ -1740,11 +1823,13 @@ void CuMatrixBase<Real>::ApplyLogSoftMaxPerRow(const CuMatrixBase<Real> &src) {
   } else
 #endif
   {
-    MatrixBase<Real> &mat(this->Mat());
-    mat.CopyFromMat(src.Mat());
-    for(MatrixIndexT r = 0; r < mat.NumRows(); r++) {
-      mat.Row(r).ApplyLogSoftMax();
-    }
+    CuThreadPool::Instantiate().Run(
+        NumRows(), 10 * NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          SubMatrix<Real> mat(CpuRows(*this, begin, end));
+          mat.CopyFromMat(CpuRows(src, begin, end));
+          for (MatrixIndexT r = 0; r < mat.NumRows(); r++)
+            mat.Row(r).ApplyLogSoftMax();
+        });
   }
 }
 
@@ -1765,7 +1850,11 @@ void CuMatrixBase<Real>::DiffSigmoid(const CuMatrixBase<Real> &value,
   } else
 #endif
   {
-    Mat().DiffSigmoid(value.Mat(), diff.Mat());
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).DiffSigmoid(CpuRows(value, begin, end),
+                                        CpuRows(diff, begin, end));
+        });
   }
 }
 
@@ -1787,7 +1876,10 @@ void CuMatrixBase<Real>::Tanh(const CuMatrixBase<Real> &src) {
   } else
 #endif
   {
-    Mat().Tanh(src.Mat());
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).Tanh(CpuRows(src, begin, end));
+        });
   }
 }
 
@@ -1809,7 +1901,11 @@ void CuMatrixBase<Real>::DiffTanh(const CuMatrixBase<Real> &value,
   } else
 #endif
   {
-    Mat().DiffTanh(value.Mat(), diff.Mat());
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).DiffTanh(CpuRows(value, begin, end),
+                                        CpuRows(diff, begin, end));
+        });
   }
 }
 
@@ -1874,16 +1970,19 @@ void CuMatrixBase<Real>::DiffSoftmaxPerRow(const CuMatrixBase<Real> &value,
   } else
 #endif
   {
-    const CuMatrixBase<Real> &P(value), &E(diff);
-    CuMatrixBase<Real> &D(*this);
-
-    CuVector<Real> pe_vec(D.NumRows()); // For each row i, the dot product (p_t . e_t).
-    pe_vec.AddDiagMatMat(1.0, P, kNoTrans, E, kTrans, 0.0);
+    CuThreadPool::Instantiate().Run(
+        NumRows(), 4 * NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          SubMatrix<Real> P(CpuRows(value, begin, end)),
+              E(CpuRows(diff, begin, end)), D(CpuRows(*this, begin, end));
+          // For each row i, the dot product (p_t . e_t).
+          Vector<Real> pe_vec(D.NumRows());
+          pe_vec.AddDiagMatMat(1.0, P, kNoTrans, E, kTrans, 0.0);
 
-    D.CopyFromMat(E);
-    D.MulElements(P);
-    // At this point, D = P .* E (in matlab notation)
-    D.AddDiagVecMat(-1.0, pe_vec, P, kNoTrans, 1.0); // does D -= diag(pe_vec) * P.
+          D.CopyFromMat(E);
+          D.MulElements(P);
+          // At this point, D = P .* E (in matlab notation)
+          D.AddDiagVecMat(-1.0, pe_vec, P, kNoTrans, 1.0);  // D -= diag(pe_vec) * P.
+        });
   }
 }
 
@@ -2481,7 +2580,10 @@ void CuMatrixBase<Real>::Heaviside(const CuMatrixBase<Real> &src) {
   } else
   #endif
   {
-    Mat().Heaviside(src.Mat());
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).Heaviside(CpuRows(src, begin, end));
+        });
   }
 }
 
@@ -2569,7 +2671,10 @@ void CuMatrixBase<Real>::ApplyFloor(Real floor_val) {
   } else
 #endif
   {
-    Mat().ApplyFloor(floor_val);
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).ApplyFloor(floor_val);
+        });
   }
 }
 
@@ -2641,7 +2746,12 @@ void CuMatrixBase<Real>::CopyCols(const CuMatrixBase<Real> &src,
   } else
 #endif
   {
-    Mat().CopyCols(src.Mat(), indices.Data());
+    KALDI_ASSERT(NumRows() == src.NumRows());
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).CopyCols(CpuRows(src, begin, end),
+                                              indices.Data());
+        });
   }
 }
 
@@ -2665,7 +2775,12 @@ void CuMatrixBase<Real>::CopyRows(const CuMatrixBase<Real> &src,
   } else
 #endif
   {
-    Mat().CopyRows(src.Mat(), indices.Data());
+    KALDI_ASSERT(static_cast<MatrixIndexT>(indices.Dim()) == NumRows());
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).CopyRows(src.Mat(),
+                                              indices.Data() + begin);
+        });
   }
 }
 
@@ -2687,7 +2802,12 @@ void CuMatrixBase<Real>::AddCols(const CuMatrixBase<Real> &src,
   } else
 #endif
   {
-    Mat().AddCols(src.Mat(), indices.Data());
+    KALDI_ASSERT(NumRows() == src.NumRows());
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).AddCols(CpuRows(src, begin, end),
+                                             indices.Data());
+        });
   }
 }
 
@@ -2707,7 +2827,11 @@ void CuMatrixBase<Real>::CopyRows(const CuArrayBase<const Real*> &src) {
   } else
 #endif
   {
-    Mat().CopyRows(src.Data());
+    KALDI_ASSERT(static_cast<MatrixIndexT>(src.Dim()) == NumRows());
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).CopyRows(src.Data() + begin);
+        });
   }
 }
 
@@ -2754,7 +2878,12 @@ void CuMatrixBase<Real>::AddRows(Real alpha,
   } else
 #endif
   {
-    Mat().AddRows(alpha, src.Mat(), indexes.Data());
+    KALDI_ASSERT(static_cast<MatrixIndexT>(indexes.Dim()) == NumRows());
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).AddRows(alpha, src.Mat(),
+                                             indexes.Data() + begin);
+        });
   }
 }
 
@@ -2810,7 +2939,11 @@ void CuMatrixBase<Real>::AddRows(Real alpha, const CuArrayBase<const Real*> &src
   } else
 #endif
   {
-    Mat().AddRows(alpha, src.Data());
+    KALDI_ASSERT(static_cast<MatrixIndexT>(src.Dim()) == NumRows());
+    CuThreadPool::Instantiate().Run(
+        NumRows(), NumCols(), [&](MatrixIndexT begin, MatrixIndexT end) {
+          CpuRows(*this, begin, end).AddRows(alpha, src.Data() + begin);
+        });
   }
 }
 
@@ -2885,16 +3018,20 @@ void CuMatrixBase<Real>::SumColumnRanges(const CuMatrixBase<Real> &src,
     Real *data = this->data_;
     const Real *src_data = src.data_;
     const Int32Pair *indices_data = indices.Data();
-    for (int32 row = 0; row < num_rows; row++) {
-      for (int32 col = 0; col < num_cols; col++) {
-        int32 start_col = indices_data[col].first,
-                end_col = indices_data[col].second;
-        Real sum = 0.0;
-        for (int32 src_col = start_col; src_col < end_col; src_col++)
-          sum += src_data[row * src_stride + src_col];
-        data[row * this_stride + col] = sum;
-      }
-    }
+    int64 cost = src.NumCols() + num_cols;
+    CuThreadPool::Instantiate().Run(
+        num_rows, cost, [&](MatrixIndexT begin, MatrixIndexT end) {
+          for (int32 row = begin; row < end; row++) {
+            for (int32 col = 0; col < num_cols; col++) {
+              int32 start_col = indices_data[col].first,
+                  end_col = indices_data[col].second;
+              Real sum = 0.0;
+              for (int32 src_col = start_col; src_col < end_col; src_col++)
+                sum += src_data[row * src_stride + src_col];
+              data[row * this_stride + col] = sum;
+            }
+          }
+        });
   }
 }
 
@@ -2923,16 +3060,21 @@ void CuMatrixBase<Real>::AddRowRanges(const CuMatrixBase<Real> &src,
     Real *data = this->data_;
     const Real *src_data = src.data_;
     const Int32Pair *indexes_data = indexes.Data();
-    for (int32 row = 0; row < num_rows; row++) {
-      int32 start_row = indexes_data[row].first,
-          end_row = indexes_data[row].second;
-      for (int32 col = 0; col < num_cols; col++) {
-        Real sum = 0.0;
-        for (int32 src_row = start_row; src_row < end_row; src_row++)
-          sum += src_data[src_row * src_stride + col];
-        data[row * this_stride + col] += sum;
-      }
-    }
+    // The ranges usually cover the rows of 'src' about once.
+    int64 cost = num_cols * (1 + src.NumRows() / num_rows);
+    CuThreadPool::Instantiate().Run(
+        num_rows, cost, [&](MatrixIndexT begin, MatrixIndexT end) {
+          for (int32 row = begin; row < end; row++) {
+            int32 start_row = indexes_data[row].first,
+                end_row = indexes_data[row].second;
+            for (int32 col = 0; col < num_cols; col++) {
+              Real sum = 0.0;
+              for (int32 src_row = start_row; src_row < end_row; src_row++)
+                sum += src_data[src_row * src_stride + col];
+              data[row * this_stride + col] += sum;
+            }
+          }
+        });
   }
 }
 
@@ -3074,9 +3216,27 @@ void CuMatrixBase<Real>::CopyFromGeneralMat(const GeneralMatrix &src,
       return;
     }
     case kCompressedMatrix: {
-      Matrix<BaseFloat> mat;
-      src.GetMatrix(&mat);
-      this->CopyFromMat(mat, trans);
+      const CompressedMatrix &cmat = src.GetCompressedMatrix();
+#if HAVE_CUDA == 1
+      if (CuDevice::Instantiate().Enabled()) {
+        // Decompress a few blocks of rows at a time and copy them to the GPU,
+        // rather than decompressing the whole matrix first.
+        MatrixIndexT num_rows = cmat.NumRows(), num_cols = cmat.NumCols(),
+            block_rows = std::min(num_rows, 8 * cmat.NumBlockRows());
+        Matrix<Real> block(block_rows, num_cols, kUndefined);
+        for (MatrixIndexT r = 0; r < num_rows; r += block_rows) {
+          MatrixIndexT n = std::min(block_rows, num_rows - r);
+          SubMatrix<Real> sub_block(block, 0, n, 0, num_cols);
+          cmat.CopyToMat(r, 0, &sub_block);
+          if (trans == kNoTrans)
+            this->RowRange(r, n).CopyFromMat(sub_block);
+          else
+            this->ColRange(r, n).CopyFromMat(sub_block, kTrans);
+        }
+        return;
+      }
+#endif
+      cmat.CopyToMat(&(Mat()), trans);
       return;
     }
     case kSparseMatrix: {
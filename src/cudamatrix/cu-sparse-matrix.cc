@@ -594,16 +594,8 @@ void GeneralMatrix::CopyToMat(CuMatrixBase<BaseFloat> *cu_mat,
         break;
       }
       case kCompressedMatrix: {
-        Matrix<BaseFloat> mat(cmat_);
-        if (trans == kNoTrans) {
-          cu_mat->CopyFromMat(mat);
-          break;
-        } else {
-          CuMatrix<BaseFloat> temp_cu;
-          temp_cu.Swap(&mat);
-          cu_mat->CopyFromMat(temp_cu, kTrans);
-          break;
-        }
+        cu_mat->CopyFromGeneralMat(*this, trans);
+        break;
       }
       default:
         KALDI_ERR << "Invalid GeneralMatrix type.";
@@ -703,15 +695,29 @@ void GeneralMatrix::AddToMat(BaseFloat alpha,
       break;
     }
     case kCompressedMatrix: {
-      Matrix<BaseFloat> mat(cmat_);
 #if HAVE_CUDA == 1
       if (CuDevice::Instantiate().Enabled()) {
-        CuMatrix<BaseFloat> cu_mat_copy(mat);
-        cu_mat->AddMat(alpha, cu_mat_copy, trans);
+        // As in CuMatrixBase::CopyFromGeneralMat(), go a few blocks of rows at
+        // a time.
+        MatrixIndexT num_rows = cmat_.NumRows(), num_cols = cmat_.NumCols(),
+            block_rows = std::min(num_rows, 8 * cmat_.NumBlockRows());
+        Matrix<BaseFloat> block(block_rows, num_cols, kUndefined);
+        CuMatrix<BaseFloat> cu_block(block_rows, num_cols, kUndefined);
+        for (MatrixIndexT r = 0; r < num_rows; r += block_rows) {
+          MatrixIndexT n = std::min(block_rows, num_rows - r);
+          SubMatrix<BaseFloat> sub_block(block, 0, n, 0, num_cols);
+          CuSubMatrix<BaseFloat> cu_sub_block(cu_block, 0, n, 0, num_cols);
+          cmat_.CopyToMat(r, 0, &sub_block);
+          cu_sub_block.CopyFromMat(sub_block);
+          if (trans == kNoTrans)
+            cu_mat->RowRange(r, n).AddMat(alpha, cu_sub_block);
+          else
+            cu_mat->ColRange(r, n).AddMat(alpha, cu_sub_block, kTrans);
+        }
         break;
       }
 #endif
-      cu_mat->Mat().AddMat(alpha, mat, trans);
+      cmat_.AddToMat(alpha, &(cu_mat->Mat()), trans);
       break;
     }
     default:
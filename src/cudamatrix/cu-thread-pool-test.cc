@@ -0,0 +1,138 @@
+// cudamatrix/cu-thread-pool-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdexcept>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "cudamatrix/cu-matrix-lib.h"
+
+namespace kaldi {
+
+// Checks that Run() calls the job on each item exactly once, including when
+// it is called from inside a job.
+void UnitTestCuThreadPoolRun() {
+  CuThreadPool &pool = CuThreadPool::Instantiate();
+  for (int32 i = 0; i < 20; i++) {
+    MatrixIndexT num_items = RandInt(0, 1000);
+    int64 cost = RandInt(0, 2) * RandInt(1, 100000);
+    std::vector<int32> count(num_items, 0);
+    pool.Run(num_items, cost, [&](MatrixIndexT begin, MatrixIndexT end) {
+        KALDI_ASSERT(begin < end);
+        for (MatrixIndexT j = begin; j < end; j++) {
+          std::vector<int32> inner_count(10, 0);
+          pool.Run(10, cost, [&](MatrixIndexT b, MatrixIndexT e) {
+              for (MatrixIndexT k = b; k < e; k++) inner_count[k]++;
+            });
+          for (int32 k = 0; k < 10; k++)
+            KALDI_ASSERT(inner_count[k] == 1);
+          count[j]++;
+        }
+      });
+    for (MatrixIndexT j = 0; j < num_items; j++)
+      KALDI_ASSERT(count[j] == 1);
+  }
+}
+
+// Checks that an exception thrown by the job in a worker thread comes out of
+// Run().
+void UnitTestCuThreadPoolException() {
+  CuThreadPool &pool = CuThreadPool::Instantiate();
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT num_items = RandInt(2, 100),
+        bad_item = RandInt(0, num_items - 1);
+    bool caught = false;
+    try {
+      pool.Run(num_items, 1000000, [&](MatrixIndexT begin, MatrixIndexT end) {
+          if (bad_item >= begin && bad_item < end)
+            throw std::runtime_error("bad item");
+        });
+    } catch (const std::runtime_error &) {
+      caught = true;
+    }
+    KALDI_ASSERT(caught);
+  }
+  // The pool should still work.
+  std::vector<int32> count(100, 0);
+  pool.Run(100, 1000000, [&](MatrixIndexT begin, MatrixIndexT end) {
+      for (MatrixIndexT j = begin; j < end; j++) count[j]++;
+    });
+  for (int32 j = 0; j < 100; j++)
+    KALDI_ASSERT(count[j] == 1);
+}
+
+// Checks some of the operations that use the pool against their
+// single-threaded versions.
+template<typename Real>
+void UnitTestCuThreadPoolMatrix() {
+  CuThreadPool &pool = CuThreadPool::Instantiate();
+  int32 num_threads = pool.NumThreads();
+  for (int32 i = 0; i < 5; i++) {
+    MatrixIndexT num_rows = RandInt(1, 300), num_cols = RandInt(1, 300),
+        inner_dim = RandInt(1, 300);
+    CuMatrix<Real> A(num_rows, inner_dim), Bt(num_cols, inner_dim),
+        At(inner_dim, num_rows), C(num_rows, num_cols);
+    A.SetRandn();
+    Bt.SetRandn();
+    At.SetRandn();
+    C.SetRandn();
+    std::vector<int32> indexes(num_rows);
+    for (MatrixIndexT r = 0; r < num_rows; r++)
+      indexes[r] = RandInt(0, num_rows - 1);
+    CuArray<int32> cu_indexes(indexes);
+    CuVector<Real> v(num_rows);
+    v.SetRandn();
+
+    CuMatrix<Real> results[2];
+    CuVector<Real> diag_results[2];
+    for (int32 threads = 0; threads < 2; threads++) {
+      pool.SetNumThreads(threads == 0 ? 1 : 4);
+      CuMatrix<Real> D(C);
+      D.AddMatMat(0.5, A, kNoTrans, Bt, kTrans, 0.2);
+      D.AddMatMat(1.0, At, kTrans, Bt, kTrans, 1.0);
+      D.Sigmoid(D);
+      D.AddDiagVecMat(1.0, v, C, kNoTrans, 1.0);
+      CuMatrix<Real> E(num_rows, num_cols);
+      E.CopyRows(D, cu_indexes);
+      E.AddRows(0.5, C, cu_indexes);
+      E.ApplySoftMaxPerRow(E);
+      D.DiffSoftmaxPerRow(E, C);
+      results[threads] = D;
+      diag_results[threads].Resize(num_rows);
+      diag_results[threads].AddDiagMatMat(1.0, A, kNoTrans, At, kNoTrans,
+                                          0.0);
+    }
+    AssertEqual(results[0], results[1]);
+    AssertEqual(diag_results[0], diag_results[1]);
+  }
+  pool.SetNumThreads(num_threads);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  SetVerboseLevel(1);
+  CuThreadPool::Instantiate().SetNumThreads(3);
+  UnitTestCuThreadPoolRun();
+  UnitTestCuThreadPoolException();
+  UnitTestCuThreadPoolMatrix<float>();
+  UnitTestCuThreadPoolMatrix<double>();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,159 @@
+// cudamatrix/cu-thread-pool.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cudamatrix/cu-thread-pool.h"
+
+namespace kaldi {
+
+// Waking up a thread and waiting for it takes some microseconds, so each
+// thread should get at least about this many floating point operations.
+static const int64 kMinCostPerThread = 65536;
+
+// True while this thread is running part of a job, so that Run() called from
+// inside a job runs it here (we must not try to lock run_mutex_ again).
+static thread_local bool tls_in_job = false;
+
+CuThreadPool::CuThreadPool(): num_threads_(1), job_id_(0), stop_(false),
+                              job_(NULL), job_size_(0), job_num_threads_(1),
+                              num_running_(0) { }
+
+CuThreadPool::~CuThreadPool() {
+  StopWorkers();
+}
+
+void CuThreadPool::StopWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cond_.notify_all();
+  for (size_t i = 0; i < workers_.size(); i++)
+    workers_[i].join();
+  workers_.clear();
+  stop_ = false;
+}
+
+void CuThreadPool::SetNumThreads(int32 num_threads) {
+  if (num_threads < 1)
+    KALDI_ERR << "Invalid number of threads " << num_threads;
+  std::lock_guard<std::mutex> run_lock(run_mutex_);
+  StopWorkers();
+  num_threads_ = num_threads;
+  // Thread 0 is the one that calls Run().
+  for (int32 i = 1; i < num_threads; i++)
+    workers_.push_back(std::thread(&CuThreadPool::WorkerLoop, this, i,
+                                   job_id_));
+}
+
+void CuThreadPool::RunPart(int32 thread_index) {
+  MatrixIndexT begin = static_cast<int64>(job_size_) * thread_index /
+      job_num_threads_,
+      end = static_cast<int64>(job_size_) * (thread_index + 1) /
+      job_num_threads_;
+  if (end <= begin)
+    return;
+  tls_in_job = true;
+  try {
+    (*job_)(begin, end);
+  } catch (...) {
+    tls_in_job = false;
+    throw;
+  }
+  tls_in_job = false;
+}
+
+void CuThreadPool::WorkerLoop(int32 thread_index, int64 last_job_id) {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_cond_.wait(lock, [this, last_job_id] {
+          return stop_ || job_id_ != last_job_id; });
+      if (stop_)
+        return;
+      last_job_id = job_id_;
+      if (thread_index >= job_num_threads_)
+        continue;  // this job is too small to need this thread.
+    }
+    std::exception_ptr exception;
+    try {
+      RunPart(thread_index);
+    } catch (...) {
+      exception = std::current_exception();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (exception && !exception_)
+        exception_ = exception;  // Run() will rethrow it.
+      if (--num_running_ == 0)
+        done_cond_.notify_one();
+    }
+  }
+}
+
+void CuThreadPool::Run(
+    MatrixIndexT num_items, int64 cost_per_item,
+    const std::function<void(MatrixIndexT, MatrixIndexT)> &job) {
+  if (num_items <= 0)
+    return;
+  int64 num_threads = std::min<int64>(
+      num_threads_, std::max<int64>(cost_per_item, 1) * num_items /
+      kMinCostPerThread);
+  num_threads = std::min<int64>(num_threads, num_items);
+  if (num_threads <= 1 || tls_in_job) {
+    // Small job, or we are inside a job.
+    job(0, num_items);
+    return;
+  }
+  std::unique_lock<std::mutex> run_lock(run_mutex_, std::try_to_lock);
+  if (!run_lock.owns_lock()) {
+    // The pool is busy with another thread's job.
+    job(0, num_items);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job_ = &job;
+    job_size_ = num_items;
+    job_num_threads_ = num_threads;
+    num_running_ = num_threads - 1;
+    job_id_++;
+  }
+  work_cond_.notify_all();
+  try {
+    RunPart(0);
+  } catch (...) {
+    // The other threads are still using 'job'.
+    WaitForWorkers();
+    throw;
+  }
+  std::exception_ptr exception = WaitForWorkers();
+  if (exception)
+    std::rethrow_exception(exception);
+}
+
+std::exception_ptr CuThreadPool::WaitForWorkers() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cond_.wait(lock, [this] { return num_running_ == 0; });
+  job_ = NULL;
+  std::exception_ptr exception = exception_;
+  exception_ = NULL;
+  return exception;
+}
+
+CuThreadPool CuThreadPool::global_pool_;
+
+}  // namespace kaldi
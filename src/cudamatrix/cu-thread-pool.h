@@ -0,0 +1,119 @@
+// cudamatrix/cu-thread-pool.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_CUDAMATRIX_CU_THREAD_POOL_H_
+#define KALDI_CUDAMATRIX_CU_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "matrix/matrix-common.h"
+
+namespace kaldi {
+
+/**
+   CuThreadPool is the CPU counterpart of the GPU for the cudamatrix library:
+   when no GPU is in use (including when compiled without CUDA), the CuMatrix
+   and CuVector operations that would have been CUDA kernels split their rows
+   (or elements) over the threads of this pool.  This covers the BLAS calls
+   too (AddMatMat() gives each thread a block of rows of the output), so it
+   does not rely on the BLAS library being multi-threaded; with more than one
+   thread here, you should use a single-threaded BLAS (e.g. set
+   OPENBLAS_NUM_THREADS=1) so the two don't compete for the cores.
+
+   By default there is one thread, i.e. everything is done in the calling
+   thread as before.  Programs that want more should register an option
+   like --use-gpu and call SetNumThreads(), e.g.:
+\code
+    int32 cpu_threads = 1;
+    po.Register("cpu-threads", &cpu_threads, "Number of threads for the "
+                "matrix operations when not using a GPU.");
+    ...
+    CuThreadPool::Instantiate().SetNumThreads(cpu_threads);
+\endcode
+
+   The pool is shared by all the threads of the program.  If Run() is called
+   while the pool is busy (from another thread, or from inside a job), the job
+   is run in the calling thread, so programs that do their own multi-threading
+   are not affected.
+*/
+class CuThreadPool {
+ public:
+  static inline CuThreadPool &Instantiate() { return global_pool_; }
+
+  /// Sets the number of threads, including the calling one (so 1 means no
+  /// extra threads).  Must not be called while the pool is in use.
+  void SetNumThreads(int32 num_threads);
+
+  int32 NumThreads() const { return num_threads_; }
+
+  /// Calls job(begin, end) for ranges [begin, end) that partition
+  /// [0, num_items), in parallel, and returns when they have all finished.
+  /// 'cost_per_item' is roughly the number of floating point operations per
+  /// item, e.g. the number of columns for an elementwise operation on the rows
+  /// of a matrix; it is used to decide how many threads are worth using, so
+  /// small operations are done in the calling thread.  If job() throws in
+  /// any thread, Run() throws the exception after all the threads are done.
+  void Run(MatrixIndexT num_items, int64 cost_per_item,
+           const std::function<void(MatrixIndexT, MatrixIndexT)> &job);
+
+  ~CuThreadPool();
+
+ private:
+  CuThreadPool();
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CuThreadPool);
+
+  void StopWorkers();
+  // The loop of worker thread 'thread_index'; it waits for the jobs after
+  // 'last_job_id'.
+  void WorkerLoop(int32 thread_index, int64 last_job_id);
+  // Waits for the workers to finish the job, and returns the first exception
+  // any of them threw, if any.
+  std::exception_ptr WaitForWorkers();
+
+  // Calls job_ on the part of [0, job_size_) that belongs to thread
+  // 'thread_index' out of job_num_threads_.
+  void RunPart(int32 thread_index);
+
+  int32 num_threads_;
+  std::vector<std::thread> workers_;
+
+  // Held by the thread that is running a job, for the whole of Run().
+  std::mutex run_mutex_;
+
+  // mutex_ protects the variables below it.
+  std::mutex mutex_;
+  std::condition_variable work_cond_, done_cond_;
+  int64 job_id_;  // incremented for each job.
+  bool stop_;
+  const std::function<void(MatrixIndexT, MatrixIndexT)> *job_;
+  MatrixIndexT job_size_;
+  int32 job_num_threads_;
+  int32 num_running_;  // the number of workers still working on the job.
+  std::exception_ptr exception_;  // from a worker, for Run() to rethrow.
+
+  static CuThreadPool global_pool_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_CUDAMATRIX_CU_THREAD_POOL_H_
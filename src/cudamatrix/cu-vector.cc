@@ -26,6 +26,7 @@
 #endif
 
 #include "base/timer.h"
+#include "matrix/cpu-allocator.h"
 #include "cudamatrix/cu-common.h"
 #include "cudamatrix/cu-vector.h"
 #include "cudamatrix/cu-device.h"
@@ -37,6 +38,7 @@
 #include "cudamatrix/cu-tp-matrix.h"
 #include "cudamatrix/cu-sp-matrix.h"
 #include "cudamatrix/cu-sparse-matrix.h"
+#include "cudamatrix/cu-thread-pool.h"
 #include "cudamatrix/cublas-wrappers.h"
 
 namespace kaldi {
@@ -664,7 +666,22 @@ void CuVectorBase<Real>::AddDiagMatMat(Real alpha, const CuMatrixBase<Real> &M,
   } else
 #endif
   {
-    Vec().AddDiagMatMat(alpha, M.Mat(), transM, N.Mat(), transN, beta);
+    // Element i only depends on row (or column) i of M and column (or row) i
+    // of N, so the threads can each do a range of elements.
+    MatrixIndexT inner_dim = (transM == kNoTrans ? M.NumCols() : M.NumRows());
+    CuThreadPool::Instantiate().Run(
+        dim_, 2 * inner_dim, [&](MatrixIndexT begin, MatrixIndexT end) {
+          MatrixIndexT n = end - begin;
+          SubMatrix<Real>
+              M_part(transM == kNoTrans ?
+                     SubMatrix<Real>(M.Mat(), begin, n, 0, inner_dim) :
+                     SubMatrix<Real>(M.Mat(), 0, inner_dim, begin, n)),
+              N_part(transN == kNoTrans ?
+                     SubMatrix<Real>(N.Mat(), 0, inner_dim, begin, n) :
+                     SubMatrix<Real>(N.Mat(), begin, n, 0, inner_dim));
+          Vec().Range(begin, n).AddDiagMatMat(alpha, M_part, transM,
+                                              N_part, transN, beta);
+        });
   }
 }
 
@@ -1037,7 +1054,7 @@ void CuVector<Real>::Destroy() {
   } else
 #endif
   {
-    if (this->data_ != NULL) KALDI_MEMALIGN_FREE(this->data_);
+    if (this->data_ != NULL) CpuMemoryAllocator::Instantiate().Free(this->data_);
   }
   this->data_ = NULL;
   this->dim_ = 0;
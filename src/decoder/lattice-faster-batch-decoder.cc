@@ -0,0 +1,217 @@
+// decoder/lattice-faster-batch-decoder.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "decoder/lattice-faster-batch-decoder.h"
+
+namespace kaldi {
+
+template <typename FST, typename Token>
+LatticeFasterBatchDecoderTpl<FST, Token>::LatticeFasterBatchDecoderTpl(
+    const FST &fst, const LatticeFasterDecoderConfig &config,
+    int32 num_streams): fst_(&fst), config_(config) {
+  config.Check();
+  KALDI_ASSERT(num_streams > 0);
+  streams_.resize(num_streams);
+  // The streams' emitting phase is done here, so they need no threads.
+  LatticeFasterDecoderConfig stream_config(config);
+  stream_config.emitting_threads = 1;
+  for (int32 s = 0; s < num_streams; s++)
+    streams_[s] = new Decoder(fst, stream_config);
+}
+
+template <typename FST, typename Token>
+LatticeFasterBatchDecoderTpl<FST, Token>::~LatticeFasterBatchDecoderTpl() {
+  for (size_t s = 0; s < streams_.size(); s++)
+    delete streams_[s];
+}
+
+template <typename FST, typename Token>
+void LatticeFasterBatchDecoderTpl<FST, Token>::Advance(
+    const std::vector<DecodableInterface*> &decodables,
+    int32 max_num_frames) {
+  if (std::is_same<FST, fst::Fst<fst::StdArc> >::value) {
+    // As in LatticeFasterDecoderTpl::AdvanceDecoding(): if the FST is actually
+    // a ConstFst or VectorFst, cast *this to the version templated on that
+    // type so that the arc iterators are not virtual.
+    if (fst_->Type() == "const") {
+      LatticeFasterBatchDecoderTpl<fst::ConstFst<fst::StdArc>, Token> *this_cast =
+          reinterpret_cast<LatticeFasterBatchDecoderTpl<fst::ConstFst<fst::StdArc>, Token>* >(this);
+      this_cast->Advance(decodables, max_num_frames);
+      return;
+    } else if (fst_->Type() == "vector") {
+      LatticeFasterBatchDecoderTpl<fst::VectorFst<fst::StdArc>, Token> *this_cast =
+          reinterpret_cast<LatticeFasterBatchDecoderTpl<fst::VectorFst<fst::StdArc>, Token>* >(this);
+      this_cast->Advance(decodables, max_num_frames);
+      return;
+    }
+  }
+
+  KALDI_ASSERT(decodables.size() == streams_.size());
+  int32 num_streams = streams_.size();
+  std::vector<int32> target_frames_decoded(num_streams, 0);
+  for (int32 s = 0; s < num_streams; s++) {
+    if (decodables[s] == NULL) continue;
+    Decoder *decoder = streams_[s];
+    KALDI_ASSERT(!decoder->active_toks_.empty() &&
+                 !decoder->decoding_finalized_ &&
+                 "You must call InitDecoding() before Advance()");
+    int32 num_frames_ready = decodables[s]->NumFramesReady();
+    // See LatticeFasterDecoderTpl::AdvanceDecoding().
+    KALDI_ASSERT(num_frames_ready >= decoder->NumFramesDecoded());
+    target_frames_decoded[s] = num_frames_ready;
+    if (max_num_frames >= 0)
+      target_frames_decoded[s] = std::min(target_frames_decoded[s],
+                                          decoder->NumFramesDecoded() +
+                                          max_num_frames);
+  }
+
+  std::vector<int32> cur_streams;
+  while (true) {
+    cur_streams.clear();
+    for (int32 s = 0; s < num_streams; s++)
+      if (decodables[s] != NULL &&
+          streams_[s]->NumFramesDecoded() < target_frames_decoded[s])
+        cur_streams.push_back(s);
+    if (cur_streams.empty())
+      break;
+    for (size_t i = 0; i < cur_streams.size(); i++) {
+      Decoder *decoder = streams_[cur_streams[i]];
+      if (decoder->NumFramesDecoded() % config_.prune_interval == 0)
+        decoder->PruneActiveTokens(config_.lattice_beam * config_.prune_scale);
+    }
+    ProcessEmitting(cur_streams, decodables);
+    for (size_t i = 0; i < cur_streams.size(); i++) {
+      int32 s = cur_streams[i];
+      streams_[s]->ProcessNonemitting(frames_[s].next_cutoff);
+    }
+  }
+}
+
+template <typename FST, typename Token>
+void LatticeFasterBatchDecoderTpl<FST, Token>::ProcessEmitting(
+    const std::vector<int32> &streams,
+    const std::vector<DecodableInterface*> &decodables) {
+  frames_.resize(streams_.size());
+  stream_arcs_.resize(streams_.size());
+  arc_pos_.resize(streams_.size());
+
+  // Set up the frame in each stream, and collect the tokens that survive
+  // cur_cutoff.
+  active_toks_.clear();
+  for (size_t i = 0; i < streams.size(); i++) {
+    int32 s = streams[i];
+    StreamFrame &f = frames_[s];
+    f.final_toks = streams_[s]->BeginEmitting(
+        decodables[s], &f.frame, &f.tok_cnt, &f.cur_cutoff, &f.adaptive_beam,
+        &f.cost_offset, &f.next_cutoff);
+    stream_arcs_[s].clear();
+    arc_pos_[s].clear();
+    int32 pos = 0;
+    for (Elem *e = f.final_toks; e != NULL; e = e->tail, pos++) {
+      if (e->val->tot_cost <= f.cur_cutoff) {
+        ActiveToken active_tok = { e->key, s, pos, e->val };
+        active_toks_.push_back(active_tok);
+      }
+    }
+  }
+  std::sort(active_toks_.begin(), active_toks_.end());
+
+  // Expand the arcs, one graph state at a time.  A stream has at most one
+  // token on a state, so each stream's arcs for a token come out in arc order.
+  for (size_t i = 0; i < active_toks_.size(); ) {
+    StateId state = active_toks_[i].state;
+    size_t group_end = i + 1;
+    while (group_end < active_toks_.size() &&
+           active_toks_[group_end].state == state)
+      group_end++;
+    state_arcs_.clear();
+    for (fst::ArcIterator<FST> aiter(*fst_, state);
+         !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      if (arc.ilabel != 0)
+        state_arcs_.push_back(arc);
+    }
+    for (size_t a = 0; a < state_arcs_.size(); a++) {
+      const Arc &arc = state_arcs_[a];
+      for (size_t j = i; j < group_end; j++) {
+        const ActiveToken &active_tok = active_toks_[j];
+        const StreamFrame &f = frames_[active_tok.stream];
+        BaseFloat ac_cost = f.cost_offset -
+            decodables[active_tok.stream]->LogLikelihood(f.frame, arc.ilabel),
+            graph_cost = arc.weight.Value(),
+            cur_cost = active_tok.tok->tot_cost,
+            tot_cost = cur_cost + ac_cost + graph_cost;
+        // Only the cutoff from the best token is applied here: the cutoff of
+        // ProcessEmitting() tightens as it goes through the token list, which
+        // happens in ReplayEmittingArcs() below.
+        if (tot_cost > f.next_cutoff) continue;
+        EmittingArc emitting_arc = { active_tok.tok, arc.nextstate,
+                                     arc.ilabel, arc.olabel, graph_cost,
+                                     ac_cost, tot_cost };
+        stream_arcs_[active_tok.stream].push_back(emitting_arc);
+        arc_pos_[active_tok.stream].push_back(active_tok.pos);
+      }
+    }
+    i = group_end;
+  }
+
+  // Create the tokens and links of each stream.
+  for (size_t i = 0; i < streams.size(); i++) {
+    int32 s = streams[i];
+    StreamFrame &f = frames_[s];
+    SortArcsByPosition(s);
+    f.next_cutoff = streams_[s]->ReplayEmittingArcs(
+        f.frame, f.final_toks, NULL, stream_arcs_[s], f.adaptive_beam,
+        f.next_cutoff);
+  }
+}
+
+template <typename FST, typename Token>
+void LatticeFasterBatchDecoderTpl<FST, Token>::SortArcsByPosition(int32 s) {
+  // A counting sort, which is stable.
+  std::vector<EmittingArc> &arcs = stream_arcs_[s];
+  const std::vector<int32> &pos = arc_pos_[s];
+  size_t num_toks = frames_[s].tok_cnt;
+  pos_count_.assign(num_toks + 1, 0);
+  for (size_t i = 0; i < pos.size(); i++)
+    pos_count_[pos[i] + 1]++;
+  for (size_t p = 1; p <= num_toks; p++)
+    pos_count_[p] += pos_count_[p - 1];
+  // Now pos_count_[p] is the index of the first arc of position p.
+  sorted_arcs_.resize(arcs.size());
+  for (size_t i = 0; i < arcs.size(); i++)
+    sorted_arcs_[pos_count_[pos[i]]++] = arcs[i];
+  arcs.swap(sorted_arcs_);
+}
+
+// Instantiate the template for the combination of token types and FST types
+// that we'll need.
+template class LatticeFasterBatchDecoderTpl<fst::Fst<fst::StdArc>, decoder::StdToken>;
+template class LatticeFasterBatchDecoderTpl<fst::VectorFst<fst::StdArc>, decoder::StdToken >;
+template class LatticeFasterBatchDecoderTpl<fst::ConstFst<fst::StdArc>, decoder::StdToken >;
+template class LatticeFasterBatchDecoderTpl<fst::GrammarFst, decoder::StdToken>;
+
+template class LatticeFasterBatchDecoderTpl<fst::Fst<fst::StdArc> , decoder::BackpointerToken>;
+template class LatticeFasterBatchDecoderTpl<fst::VectorFst<fst::StdArc>, decoder::BackpointerToken >;
+template class LatticeFasterBatchDecoderTpl<fst::ConstFst<fst::StdArc>, decoder::BackpointerToken >;
+template class LatticeFasterBatchDecoderTpl<fst::GrammarFst, decoder::BackpointerToken>;
+
+
+} // end namespace kaldi.
@@ -0,0 +1,149 @@
+// decoder/lattice-faster-batch-decoder.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_LATTICE_FASTER_BATCH_DECODER_H_
+#define KALDI_DECODER_LATTICE_FASTER_BATCH_DECODER_H_
+
+#include "decoder/lattice-faster-decoder.h"
+
+namespace kaldi {
+
+/** LatticeFasterBatchDecoderTpl decodes several utterances ("streams") at
+    once with the same graph, advancing all of them frame by frame in
+    lock-step.  Each stream is an ordinary LatticeFasterDecoderTpl, which does
+    the token bookkeeping, the epsilon arcs, the pruning and the lattice
+    generation; only the expansion of the emitting arcs is done here, for all
+    streams together: the active tokens of all streams are grouped by graph
+    state, and the arcs of a state are read once and applied to every stream
+    that has a token on it.  With many streams on a large graph this visits
+    the graph memory far less often than decoding the streams one by one.
+
+    The tokens, lattices and best paths of each stream are exactly the same
+    as LatticeFasterDecoderTpl would give for that utterance on its own: the
+    arcs are expanded with the cutoff computed from the best token, and the
+    survivors are then replayed in the order of the single-stream decoder,
+    with its pruning rule.  The option emitting_threads is ignored.
+
+    Typical use:
+      LatticeFasterBatchDecoder decoder(fst, config, num_streams);
+      for (s ...) decoder.InitDecoding(s);
+      decoder.Advance(decodables);   // one DecodableInterface* per stream.
+      for (s ...) {
+        decoder.FinalizeDecoding(s);
+        decoder.Stream(s).GetLattice(&clat);
+        decoder.InitDecoding(s);  // and decodables[s] = the next utterance.
+      }
+ */
+template <typename FST, typename Token = decoder::StdToken>
+class LatticeFasterBatchDecoderTpl {
+ public:
+  using Arc = typename FST::Arc;
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+  using Decoder = LatticeFasterDecoderTpl<FST, Token>;
+
+  /// Does not take ownership of 'fst'.
+  LatticeFasterBatchDecoderTpl(const FST &fst,
+                               const LatticeFasterDecoderConfig &config,
+                               int32 num_streams);
+
+  ~LatticeFasterBatchDecoderTpl();
+
+  int32 NumStreams() const { return streams_.size(); }
+
+  /// Starts a new utterance on stream 's'.
+  void InitDecoding(int32 s) { streams_[s]->InitDecoding(); }
+
+  /// Decodes the streams s for which decodables[s] != NULL (decodables must
+  /// have NumStreams() elements) until there are no more frames ready in
+  /// their decodable objects, all streams moving forward one frame at a
+  /// time.  If max_num_frames >= 0 no stream decodes more than that many
+  /// frames.  The streams may be at different frames of their utterances.
+  /// As with LatticeFasterDecoderTpl::AdvanceDecoding(), you can keep calling
+  /// this as more frames become available.
+  void Advance(const std::vector<DecodableInterface*> &decodables,
+               int32 max_num_frames = -1);
+
+  /// Calls FinalizeDecoding() on stream 's'; see LatticeFasterDecoderTpl.
+  void FinalizeDecoding(int32 s) { streams_[s]->FinalizeDecoding(); }
+
+  /// Gives access to the decoder of stream 's', e.g. for GetLattice(),
+  /// GetBestPath(), ReachedFinal() and NumFramesDecoded().
+  const Decoder &Stream(int32 s) const { return *(streams_[s]); }
+
+ private:
+  typedef typename Decoder::Elem Elem;
+  typedef typename Decoder::EmittingArc EmittingArc;
+
+  // The state of the emitting phase of a stream on its current frame, as
+  // set up by Decoder::BeginEmitting().
+  struct StreamFrame {
+    Elem *final_toks;
+    int32 frame;
+    size_t tok_cnt;
+    BaseFloat cur_cutoff;
+    BaseFloat adaptive_beam;
+    BaseFloat cost_offset;
+    BaseFloat next_cutoff;
+  };
+
+  // A token of the previous frame that survived cur_cutoff; 'pos' is its
+  // position in the stream's token list.
+  struct ActiveToken {
+    StateId state;
+    int32 stream;
+    int32 pos;
+    Token *tok;
+    bool operator < (const ActiveToken &other) const {
+      if (state != other.state) return state < other.state;
+      if (stream != other.stream) return stream < other.stream;
+      return pos < other.pos;
+    }
+  };
+
+  // Processes the emitting arcs of one frame for the streams in 'streams'
+  // (indexes into streams_); sets frames_[s].next_cutoff to the cutoff for
+  // ProcessNonemitting().
+  void ProcessEmitting(const std::vector<int32> &streams,
+                       const std::vector<DecodableInterface*> &decodables);
+
+  // Puts the arcs in stream_arcs_[s] into the order of the stream's token
+  // list, using arc_pos_[s], keeping the arc order within each token.
+  void SortArcsByPosition(int32 s);
+
+  const FST *fst_;
+  LatticeFasterDecoderConfig config_;
+  std::vector<Decoder*> streams_;
+
+  // Temporaries used in ProcessEmitting(), indexed by stream where relevant.
+  std::vector<StreamFrame> frames_;
+  std::vector<ActiveToken> active_toks_;
+  std::vector<Arc> state_arcs_;  // the emitting arcs of one state.
+  std::vector<std::vector<EmittingArc> > stream_arcs_;
+  std::vector<std::vector<int32> > arc_pos_;  // token position of each arc.
+  std::vector<EmittingArc> sorted_arcs_;
+  std::vector<int32> pos_count_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(LatticeFasterBatchDecoderTpl);
+};
+
+typedef LatticeFasterBatchDecoderTpl<fst::StdFst, decoder::StdToken>
+  LatticeFasterBatchDecoder;
+
+}  // end namespace kaldi.
+
+#endif  // KALDI_DECODER_LATTICE_FASTER_BATCH_DECODER_H_
@@ -0,0 +1,251 @@
+// decoder/lattice-faster-decoder-speed-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/timer.h"
+#include "decoder/lattice-faster-decoder.h"
+#include "decoder/lattice-faster-batch-decoder.h"
+#include "decoder/decodable-matrix.h"
+
+namespace kaldi {
+
+// Creates a random HCLG-like graph: every state has 'num_arcs' emitting arcs
+// (ilabels are pdf-ids plus one) to random states, and one in four states
+// also has an epsilon arc to a higher-numbered state, so that there are no
+// epsilon cycles.
+fst::StdVectorFst *CreateSyntheticGraph(int32 num_states, int32 num_arcs,
+                                        int32 num_pdfs) {
+  typedef fst::StdArc Arc;
+  fst::StdVectorFst *fst = new fst::StdVectorFst();
+  for (int32 s = 0; s < num_states; s++)
+    fst->AddState();
+  fst->SetStart(0);
+  for (int32 s = 0; s < num_states; s++) {
+    for (int32 a = 0; a < num_arcs; a++) {
+      int32 pdf = RandInt(1, num_pdfs), word = (RandInt(0, 9) == 0 ?
+                                                RandInt(1, 1000) : 0);
+      fst->AddArc(s, Arc(pdf, word, RandUniform() * 5.0,
+                         RandInt(0, num_states - 1)));
+    }
+    if (s + 1 < num_states && RandInt(0, 3) == 0)
+      fst->AddArc(s, Arc(0, 0, RandUniform() * 5.0,
+                         RandInt(s + 1, num_states - 1)));
+    if (RandInt(0, 9) == 0)
+      fst->SetFinal(s, fst::TropicalWeight(RandUniform()));
+  }
+  return fst;
+}
+
+// Gives access to the token lists, to count the tokens.
+class CountingDecoder:
+      public LatticeFasterDecoderTpl<fst::StdVectorFst, decoder::StdToken> {
+ public:
+  CountingDecoder(const fst::StdVectorFst &fst,
+                  const LatticeFasterDecoderConfig &config):
+      LatticeFasterDecoderTpl<fst::StdVectorFst, decoder::StdToken>(fst,
+                                                                   config) { }
+  int64 NumTokensOnLastFrame() const {
+    int64 ans = 0;
+    for (decoder::StdToken *tok = active_toks_.back().toks; tok != NULL;
+         tok = tok->next)
+      ans++;
+    return ans;
+  }
+};
+
+// Decodes 'loglikes' and outputs the raw lattice and the number of tokens
+// created; returns the time taken.
+double DecodeSynthetic(const fst::StdVectorFst &fst,
+                       const Matrix<BaseFloat> &loglikes,
+                       const LatticeFasterDecoderConfig &config,
+                       Lattice *raw_lat, int64 *num_tokens) {
+  DecodableMatrixScaled decodable(loglikes, 1.0);
+  CountingDecoder decoder(fst, config);
+  Timer timer;
+  *num_tokens = 0;
+  decoder.InitDecoding();
+  while (decoder.NumFramesDecoded() < loglikes.NumRows()) {
+    decoder.AdvanceDecoding(&decodable, 1);
+    *num_tokens += decoder.NumTokensOnLastFrame();
+  }
+  decoder.FinalizeDecoding();
+  double elapsed = timer.Elapsed();
+  KALDI_ASSERT(decoder.GetRawLattice(raw_lat));
+  return elapsed;
+}
+
+// Decodes random log-likelihoods with the synthetic graph and reports the
+// number of tokens created per second, with one and with several threads
+// in ProcessEmitting(); the lattices must be identical.
+void TestDecoderSpeed() {
+  int32 num_states = 20000, num_arcs = 8, num_pdfs = 2000,
+      num_frames = 300;
+  fst::StdVectorFst *fst = CreateSyntheticGraph(num_states, num_arcs,
+                                                num_pdfs);
+  Matrix<BaseFloat> loglikes(num_frames, num_pdfs);
+  loglikes.SetRandn();
+  loglikes.Scale(2.0);
+
+  LatticeFasterDecoderConfig config;
+  config.beam = 12.0;
+  config.max_active = 7000;
+  config.lattice_beam = 6.0;
+
+  Lattice lat1;
+  for (int32 num_threads = 1; num_threads <= 4; num_threads *= 2) {
+    config.emitting_threads = num_threads;
+    Lattice lat;
+    int64 num_tokens;
+    double elapsed = DecodeSynthetic(*fst, loglikes, config, &lat,
+                                     &num_tokens);
+    KALDI_LOG << "Decoded " << num_frames << " frames with "
+              << num_threads << " emitting threads, " << num_tokens
+              << " tokens in " << elapsed << " sec: "
+              << (num_tokens / elapsed) << " tokens/sec.";
+    if (num_threads == 1)
+      lat1 = lat;
+    else
+      KALDI_ASSERT(fst::Equal(lat1, lat, 0.0));
+  }
+  delete fst;
+}
+
+// Decodes several utterances of different lengths one by one and then all
+// together with LatticeFasterBatchDecoder; the lattices must be identical.
+void TestBatchDecoder() {
+  int32 num_states = 20000, num_arcs = 8, num_pdfs = 2000,
+      num_streams = 8;
+  fst::StdVectorFst *fst = CreateSyntheticGraph(num_states, num_arcs,
+                                                num_pdfs);
+  LatticeFasterDecoderConfig config;
+  config.beam = 12.0;
+  config.max_active = 7000;
+  config.lattice_beam = 6.0;
+
+  std::vector<Matrix<BaseFloat> > loglikes(num_streams);
+  std::vector<Lattice> lats(num_streams);
+  double serial_time = 0.0;
+  for (int32 s = 0; s < num_streams; s++) {
+    loglikes[s].Resize(RandInt(100, 200), num_pdfs);
+    loglikes[s].SetRandn();
+    loglikes[s].Scale(2.0);
+    int64 num_tokens;
+    serial_time += DecodeSynthetic(*fst, loglikes[s], config, &(lats[s]),
+                                   &num_tokens);
+  }
+
+  std::vector<DecodableMatrixScaled*> decodables(num_streams);
+  std::vector<DecodableInterface*> decodable_ptrs(num_streams);
+  for (int32 s = 0; s < num_streams; s++)
+    decodable_ptrs[s] = decodables[s] =
+        new DecodableMatrixScaled(loglikes[s], 1.0);
+  // The base-class FST type, to test the cast to the VectorFst version.
+  LatticeFasterBatchDecoder decoder(*fst, config, num_streams);
+  Timer timer;
+  for (int32 s = 0; s < num_streams; s++)
+    decoder.InitDecoding(s);
+  // Start the second half of the streams a few frames late.
+  std::vector<DecodableInterface*> first_half(decodable_ptrs);
+  for (int32 s = num_streams / 2; s < num_streams; s++)
+    first_half[s] = NULL;
+  decoder.Advance(first_half, 5);
+  decoder.Advance(decodable_ptrs);
+  for (int32 s = 0; s < num_streams; s++)
+    decoder.FinalizeDecoding(s);
+  double batch_time = timer.Elapsed();
+  for (int32 s = 0; s < num_streams; s++) {
+    KALDI_ASSERT(decoder.Stream(s).NumFramesDecoded() ==
+                 loglikes[s].NumRows());
+    Lattice lat;
+    KALDI_ASSERT(decoder.Stream(s).GetRawLattice(&lat));
+    KALDI_ASSERT(fst::Equal(lats[s], lat, 0.0));
+    delete decodables[s];
+  }
+  KALDI_LOG << "Decoded " << num_streams << " utterances one by one in "
+            << serial_time << " sec, in lock-step in " << batch_time
+            << " sec.";
+  delete fst;
+}
+
+// Mimics the way the decoder uses memory: tokens are created frame by
+// frame, every 'prune_interval' frames some of the older ones are freed,
+// and everything is freed at the end of the utterance.  Compares the
+// TokenArena with plain new and delete.
+template <bool use_arena>
+double TimeTokenAllocation(int32 num_utts, int32 num_frames,
+                           int32 toks_per_frame) {
+  typedef decoder::StdToken Token;
+  decoder::TokenArena<Token> arena;
+  std::vector<Token*> frame_toks(num_frames);
+  Timer timer;
+  for (int32 u = 0; u < num_utts; u++) {
+    for (int32 t = 0; t < num_frames; t++) {
+      Token *toks = NULL;
+      for (int32 i = 0; i < toks_per_frame; i++) {
+        BaseFloat cost = t + i;
+        toks = (use_arena ? new (arena.Allocate()) Token(cost, 0.0, NULL,
+                                                         toks, NULL) :
+                new Token(cost, 0.0, NULL, toks, NULL));
+      }
+      frame_toks[t] = toks;
+      if (t % 25 == 0 && t > 0) {  // prune every other token of older frames.
+        for (int32 f = 0; f < t; f++) {
+          for (Token *tok = frame_toks[f]; tok != NULL; tok = tok->next) {
+            Token *next = tok->next;
+            if (next == NULL) break;
+            tok->next = next->next;
+            if (use_arena) arena.Free(next);
+            else delete next;
+          }
+        }
+      }
+    }
+    if (use_arena) {
+      arena.Clear();
+    } else {
+      for (int32 t = 0; t < num_frames; t++) {
+        for (Token *tok = frame_toks[t], *next; tok != NULL; tok = next) {
+          next = tok->next;
+          delete tok;
+        }
+      }
+    }
+  }
+  return timer.Elapsed();
+}
+
+void TestTokenArenaSpeed() {
+  int32 num_utts = 5, num_frames = 500, toks_per_frame = 5000;
+  double heap_time = TimeTokenAllocation<false>(num_utts, num_frames,
+                                                toks_per_frame),
+      arena_time = TimeTokenAllocation<true>(num_utts, num_frames,
+                                             toks_per_frame);
+  double num_toks = static_cast<double>(num_utts) * num_frames *
+      toks_per_frame;
+  KALDI_LOG << "Token allocation: new/delete " << (num_toks / heap_time)
+            << " tokens/sec, TokenArena " << (num_toks / arena_time)
+            << " tokens/sec (speedup " << (heap_time / arena_time) << ")";
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  TestTokenArenaSpeed();
+  TestDecoderSpeed();
+  TestBatchDecoder();
+  KALDI_LOG << "Tests succeeded.";
+}
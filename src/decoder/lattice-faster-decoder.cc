@@ -25,12 +25,18 @@
 
 namespace kaldi {
 
+// ProcessEmitting() only uses several threads if each of them gets at least
+// this many tokens; for fewer, waking the threads costs more than it saves.
+static const size_t kMinTokensPerShard = 1000;
+
 // instantiate this class once for each thing you have to decode.
 template <typename FST, typename Token>
 LatticeFasterDecoderTpl<FST, Token>::LatticeFasterDecoderTpl(
     const FST &fst,
     const LatticeFasterDecoderConfig &config):
-    fst_(&fst), delete_fst_(false), config_(config), num_toks_(0) {
+    shard_job_(0), shard_num_running_(0), shard_stop_(false), fst_(&fst),
+    delete_fst_(false), config_(config), num_toks_(0),
+    state_counts_(NULL) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -39,7 +45,9 @@ LatticeFasterDecoderTpl<FST, Token>::LatticeFasterDecoderTpl(
 template <typename FST, typename Token>
 LatticeFasterDecoderTpl<FST, Token>::LatticeFasterDecoderTpl(
     const LatticeFasterDecoderConfig &config, FST *fst):
-    fst_(fst), delete_fst_(true), config_(config), num_toks_(0) {
+    shard_job_(0), shard_num_running_(0), shard_stop_(false), fst_(fst),
+    delete_fst_(true), config_(config), num_toks_(0),
+    state_counts_(NULL) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -47,6 +55,7 @@ LatticeFasterDecoderTpl<FST, Token>::LatticeFasterDecoderTpl(
 
 template <typename FST, typename Token>
 LatticeFasterDecoderTpl<FST, Token>::~LatticeFasterDecoderTpl() {
+  StopShardThreads();
   DeleteElems(toks_.Clear());
   ClearActiveTokens();
   if (delete_fst_) delete fst_;
@@ -62,10 +71,11 @@ void LatticeFasterDecoderTpl<FST, Token>::InitDecoding() {
   num_toks_ = 0;
   decoding_finalized_ = false;
   final_costs_.clear();
+  StartShardThreads();
   StateId start_state = fst_->Start();
   KALDI_ASSERT(start_state != fst::kNoStateId);
   active_toks_.resize(1);
-  Token *start_tok = new Token(0.0, 0.0, NULL, NULL, NULL);
+  Token *start_tok = NewToken(0.0, 0.0, NULL, NULL, NULL);
   active_toks_[0].toks = start_tok;
   toks_.Insert(start_state, start_tok);
   num_toks_++;
@@ -276,7 +286,7 @@ inline Token* LatticeFasterDecoderTpl<FST, Token>::FindOrAddToken(
     // tokens on the currently final frame have zero extra_cost
     // as any of them could end up
     // on the winning path.
-    Token *new_tok = new Token (tot_cost, extra_cost, NULL, toks, backpointer);
+    Token *new_tok = NewToken(tot_cost, extra_cost, NULL, toks, backpointer);
     // NULL: no forward links yet
     toks = new_tok;
     num_toks_++;
@@ -353,7 +363,7 @@ void LatticeFasterDecoderTpl<FST, Token>::PruneForwardLinks(
           ForwardLinkT *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          link_arena_.Free(link);
           link = next_link;  // advance link but leave prev_link the same.
           *links_pruned = true;
         } else {   // keep the link and update the tok_extra_cost if needed.
@@ -441,7 +451,7 @@ void LatticeFasterDecoderTpl<FST, Token>::PruneForwardLinksFinal() {
           ForwardLinkT *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          link_arena_.Free(link);
           link = next_link; // advance link but leave prev_link the same.
         } else { // keep the link and update the tok_extra_cost if needed.
           if (link_extra_cost < 0.0) { // this is just a precaution.
@@ -502,7 +512,7 @@ void LatticeFasterDecoderTpl<FST, Token>::PruneTokensForFrame(int32 frame_plus_o
       // excise tok from list and delete tok.
       if (prev_tok != NULL) prev_tok->next = tok->next;
       else toks = tok->next;
-      delete tok;
+      token_arena_.Free(tok);
       num_toks_--;
     } else {  // fetch next Token
       prev_tok = tok;
@@ -724,8 +734,11 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::GetCutoff(Elem *list_head, size_t
 }
 
 template <typename FST, typename Token>
-BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
-    DecodableInterface *decodable) {
+typename LatticeFasterDecoderTpl<FST, Token>::Elem*
+LatticeFasterDecoderTpl<FST, Token>::BeginEmitting(
+    DecodableInterface *decodable, int32 *frame_out, size_t *tok_cnt,
+    BaseFloat *cur_cutoff, BaseFloat *adaptive_beam_out,
+    BaseFloat *cost_offset_out, BaseFloat *next_cutoff_out) {
   KALDI_ASSERT(active_toks_.size() > 0);
   int32 frame = active_toks_.size() - 1; // frame is the frame-index
                                          // (zero-based) used to get likelihoods
@@ -737,12 +750,21 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
                                    // being indexed in the hash in toks_.
   Elem *best_elem = NULL;
   BaseFloat adaptive_beam;
-  size_t tok_cnt;
-  BaseFloat cur_cutoff = GetCutoff(final_toks, &tok_cnt, &adaptive_beam, &best_elem);
+  *cur_cutoff = GetCutoff(final_toks, tok_cnt, &adaptive_beam, &best_elem);
   KALDI_VLOG(6) << "Adaptive beam on frame " << NumFramesDecoded() << " is "
                 << adaptive_beam;
 
-  PossiblyResizeHash(tok_cnt);  // This makes sure the hash is always big enough.
+  PossiblyResizeHash(*tok_cnt);  // This makes sure the hash is always big enough.
+
+  if (state_counts_ != NULL) {
+    for (Elem *e = final_toks; e != NULL; e = e->tail) {
+      if (e->val->tot_cost <= *cur_cutoff) {
+        if (static_cast<size_t>(e->key) >= state_counts_->size())
+          state_counts_->resize(e->key + 1, 0);
+        (*state_counts_)[e->key]++;
+      }
+    }
+  }
 
   BaseFloat next_cutoff = std::numeric_limits<BaseFloat>::infinity();
   // pruning "online" before having seen all tokens
@@ -777,6 +799,28 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
   cost_offsets_.resize(frame + 1, 0.0);
   cost_offsets_[frame] = cost_offset;
 
+  *frame_out = frame;
+  *adaptive_beam_out = adaptive_beam;
+  *cost_offset_out = cost_offset;
+  *next_cutoff_out = next_cutoff;
+  return final_toks;
+}
+
+template <typename FST, typename Token>
+BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
+    DecodableInterface *decodable) {
+  int32 frame;
+  size_t tok_cnt;
+  BaseFloat cur_cutoff, adaptive_beam, cost_offset, next_cutoff;
+  Elem *final_toks = BeginEmitting(decodable, &frame, &tok_cnt, &cur_cutoff,
+                                   &adaptive_beam, &cost_offset,
+                                   &next_cutoff);
+
+  if (!shard_threads_.empty() && tok_cnt >= 2 * kMinTokensPerShard)
+    return ProcessEmittingSharded(decodable, frame, final_toks, tok_cnt,
+                                  cur_cutoff, adaptive_beam, cost_offset,
+                                  next_cutoff);
+
   // the tokens are now owned here, in final_toks, and the hash is empty.
   // 'owned' is a complex thing here; the point is we need to call DeleteElem
   // on each elem 'e' to let toks_ know we're done with them.
@@ -805,8 +849,8 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
           // NULL: no change indicator needed
 
           // Add ForwardLink from tok to next_tok (put on head of list tok->links)
-          tok->links = new ForwardLinkT(next_tok, arc.ilabel, arc.olabel,
-                                        graph_cost, ac_cost, tok->links);
+          tok->links = NewForwardLink(next_tok, arc.ilabel, arc.olabel,
+                                      graph_cost, ac_cost, tok->links);
         }
       } // for all arcs
     }
@@ -816,13 +860,208 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
   return next_cutoff;
 }
 
-// static inline
+template <typename FST, typename Token>
+BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmittingSharded(
+    DecodableInterface *decodable, int32 frame, Elem *final_toks,
+    size_t tok_cnt, BaseFloat cur_cutoff, BaseFloat adaptive_beam,
+    BaseFloat cost_offset, BaseFloat next_cutoff) {
+  // The decodable object is not required to be thread-safe, so we get all the
+  // log-likelihoods for this frame here.
+  int32 num_indices = decodable->NumIndices();
+  frame_loglikes_.resize(num_indices + 1);
+  for (int32 i = 1; i <= num_indices; i++)
+    frame_loglikes_[i] = decodable->LogLikelihood(frame, i);
+
+  // Split the token list into consecutive shards; shard s is the tokens from
+  // shard_begin_[s] up to shard_begin_[s + 1] (NULL is the end of the list).
+  int32 num_shards = std::min<size_t>(shard_threads_.size() + 1,
+                                      tok_cnt / kMinTokensPerShard);
+  size_t shard_size = (tok_cnt + num_shards - 1) / num_shards;
+  shard_begin_.assign(num_shards + 1, NULL);
+  size_t pos = 0;
+  for (Elem *e = final_toks; e != NULL; e = e->tail, pos++)
+    if (pos % shard_size == 0)
+      shard_begin_[pos / shard_size] = e;
+
+  shard_arcs_.resize(num_shards);
+  shard_bad_ilabel_.assign(num_shards, 0);
+  shard_cur_cutoff_ = cur_cutoff;
+  shard_adaptive_beam_ = adaptive_beam;
+  shard_cost_offset_ = cost_offset;
+  shard_next_cutoff_ = next_cutoff;
+  {
+    std::lock_guard<std::mutex> lock(shard_mutex_);
+    shard_num_running_ = num_shards - 1;
+    shard_job_++;
+  }
+  shard_work_cond_.notify_all();
+  ExpandShard(shard_begin_[0], shard_begin_[1], cur_cutoff, adaptive_beam,
+              cost_offset, next_cutoff, &(shard_arcs_[0]),
+              &(shard_bad_ilabel_[0]));
+  {
+    std::unique_lock<std::mutex> lock(shard_mutex_);
+    shard_done_cond_.wait(lock, [this] { return shard_num_running_ == 0; });
+  }
+  for (int32 s = 0; s < num_shards; s++) {
+    if (shard_bad_ilabel_[s] != 0) {
+      // The decodable object should die here.
+      decodable->LogLikelihood(frame, shard_bad_ilabel_[s]);
+      KALDI_ERR << "Invalid ilabel " << shard_bad_ilabel_[s]
+                << " in decoding graph, the decodable object has "
+                << num_indices << " indices.";
+    }
+  }
+
+  // Now create the tokens and links.
+  for (int32 s = 0; s < num_shards; s++)
+    next_cutoff = ReplayEmittingArcs(frame, shard_begin_[s],
+                                     shard_begin_[s + 1], shard_arcs_[s],
+                                     adaptive_beam, next_cutoff);
+  return next_cutoff;
+}
+
+template <typename FST, typename Token>
+void LatticeFasterDecoderTpl<FST, Token>::ShardThread(int32 shard,
+                                                      int64 last_job) {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(shard_mutex_);
+      shard_work_cond_.wait(lock, [this, last_job] {
+          return shard_stop_ || shard_job_ != last_job; });
+      if (shard_stop_)
+        return;
+      last_job = shard_job_;
+      if (shard + 1 >= static_cast<int32>(shard_begin_.size()))
+        continue;  // this frame has fewer shards.
+    }
+    ExpandShard(shard_begin_[shard], shard_begin_[shard + 1],
+                shard_cur_cutoff_, shard_adaptive_beam_, shard_cost_offset_,
+                shard_next_cutoff_, &(shard_arcs_[shard]),
+                &(shard_bad_ilabel_[shard]));
+    {
+      std::lock_guard<std::mutex> lock(shard_mutex_);
+      if (--shard_num_running_ == 0)
+        shard_done_cond_.notify_one();
+    }
+  }
+}
+
+template <typename FST, typename Token>
+void LatticeFasterDecoderTpl<FST, Token>::StartShardThreads() {
+  size_t num_threads = (config_.emitting_threads > 1 && FstIsThreadSafe() ?
+                        config_.emitting_threads - 1 : 0);
+  if (shard_threads_.size() == num_threads)
+    return;  // e.g. started for a previous utterance.
+  StopShardThreads();
+  for (size_t i = 1; i <= num_threads; i++)
+    shard_threads_.push_back(std::thread(
+        &LatticeFasterDecoderTpl<FST, Token>::ShardThread, this, i,
+        shard_job_));
+}
+
+template <typename FST, typename Token>
+void LatticeFasterDecoderTpl<FST, Token>::StopShardThreads() {
+  {
+    std::lock_guard<std::mutex> lock(shard_mutex_);
+    shard_stop_ = true;
+  }
+  shard_work_cond_.notify_all();
+  for (size_t i = 0; i < shard_threads_.size(); i++)
+    shard_threads_[i].join();
+  shard_threads_.clear();
+  shard_stop_ = false;
+}
+
+template <typename FST, typename Token>
+BaseFloat LatticeFasterDecoderTpl<FST, Token>::ReplayEmittingArcs(
+    int32 frame, Elem *begin, Elem *end,
+    const std::vector<EmittingArc> &arcs, BaseFloat adaptive_beam,
+    BaseFloat next_cutoff) {
+  // This is the loop in ProcessEmitting(), except that the arcs that could not
+  // survive have already been removed.
+  typename std::vector<EmittingArc>::const_iterator
+      iter = arcs.begin(), arcs_end = arcs.end();
+  for (Elem *e = begin, *e_tail; e != end; e = e_tail) {
+    Token *tok = e->val;
+    for (; iter != arcs_end && iter->tok == tok; ++iter) {
+      BaseFloat tot_cost = iter->tot_cost;
+      if (tot_cost > next_cutoff) continue;
+      else if (tot_cost + adaptive_beam < next_cutoff)
+        next_cutoff = tot_cost + adaptive_beam; // prune by best current token
+      Token *next_tok = FindOrAddToken(iter->nextstate,
+                                       frame + 1, tot_cost, tok, NULL);
+      tok->links = NewForwardLink(next_tok, iter->ilabel, iter->olabel,
+                                  iter->graph_cost, iter->ac_cost,
+                                  tok->links);
+    }
+    e_tail = e->tail;
+    toks_.Delete(e); // delete Elem
+  }
+  KALDI_ASSERT(iter == arcs_end);
+  return next_cutoff;
+}
+
+template <typename FST, typename Token>
+void LatticeFasterDecoderTpl<FST, Token>::ExpandShard(
+    const Elem *begin, const Elem *end, BaseFloat cur_cutoff,
+    BaseFloat adaptive_beam, BaseFloat cost_offset, BaseFloat next_cutoff,
+    std::vector<EmittingArc> *arcs, Label *bad_ilabel) const {
+  arcs->clear();
+  Label num_indices = frame_loglikes_.size() - 1;
+  for (const Elem *e = begin; e != end; e = e->tail) {
+    Token *tok = e->val;
+    if (tok->tot_cost > cur_cutoff) continue;
+    for (fst::ArcIterator<FST> aiter(*fst_, e->key);
+         !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      if (arc.ilabel != 0) {  // propagate..
+        if (arc.ilabel < 0 || arc.ilabel > num_indices) {
+          *bad_ilabel = arc.ilabel;
+          return;
+        }
+        BaseFloat ac_cost = cost_offset - frame_loglikes_[arc.ilabel],
+            graph_cost = arc.weight.Value(),
+            cur_cost = tok->tot_cost,
+            tot_cost = cur_cost + ac_cost + graph_cost;
+        // The same pruning as in ProcessEmitting(), but next_cutoff only
+        // sees the arcs of this shard, so it is never tighter.
+        if (tot_cost > next_cutoff) continue;
+        else if (tot_cost + adaptive_beam < next_cutoff)
+          next_cutoff = tot_cost + adaptive_beam;
+        EmittingArc emitting_arc = { tok, arc.nextstate, arc.ilabel,
+                                     arc.olabel, graph_cost, ac_cost,
+                                     tot_cost };
+        arcs->push_back(emitting_arc);
+      }
+    }
+  }
+}
+
+template <typename FST, typename Token>
+bool LatticeFasterDecoderTpl<FST, Token>::FstIsThreadSafe() const {
+  return fst_->Properties(fst::kExpanded, false) != 0;
+}
+
+// GrammarFst expands its states on demand, from inside the arc iterator.
+template <>
+bool LatticeFasterDecoderTpl<fst::GrammarFst,
+                             decoder::StdToken>::FstIsThreadSafe() const {
+  return false;
+}
+template <>
+bool LatticeFasterDecoderTpl<fst::GrammarFst,
+                             decoder::BackpointerToken>::FstIsThreadSafe() const {
+  return false;
+}
+
+// inline
 template <typename FST, typename Token>
 void LatticeFasterDecoderTpl<FST, Token>::DeleteForwardLinks(Token *tok) {
   ForwardLinkT *l = tok->links, *m;
   while (l != NULL) {
     m = l->next;
-    delete l;
+    link_arena_.Free(l);
     l = m;
   }
   tok->links = NULL;
@@ -885,8 +1124,8 @@ void LatticeFasterDecoderTpl<FST, Token>::ProcessNonemitting(BaseFloat cutoff) {
           Token *new_tok = FindOrAddToken(arc.nextstate, frame + 1, tot_cost,
                                           tok, &changed);
 
-          tok->links = new ForwardLinkT(new_tok, 0, arc.olabel,
-                                        graph_cost, 0, tok->links);
+          tok->links = NewForwardLink(new_tok, 0, arc.olabel,
+                                      graph_cost, 0, tok->links);
 
           // "changed" tells us whether the new token has a different
           // cost from before, or is new [if so, add into queue].
@@ -909,19 +1148,13 @@ void LatticeFasterDecoderTpl<FST, Token>::DeleteElems(Elem *list) {
 
 template <typename FST, typename Token>
 void LatticeFasterDecoderTpl<FST, Token>::ClearActiveTokens() { // a cleanup routine, at utt end/begin
-  for (size_t i = 0; i < active_toks_.size(); i++) {
-    // Delete all tokens alive on this frame, and any forward
-    // links they may have.
-    for (Token *tok = active_toks_[i].toks; tok != NULL; ) {
-      DeleteForwardLinks(tok);
-      Token *next_tok = tok->next;
-      delete tok;
-      num_toks_--;
-      tok = next_tok;
-    }
-  }
+  // All tokens alive on any frame, and their forward links, live in the
+  // arenas, so we can release them in one go instead of walking the lists.
+  KALDI_ASSERT(token_arena_.NumUsed() == static_cast<size_t>(num_toks_));
+  token_arena_.Clear();
+  link_arena_.Clear();
+  num_toks_ = 0;
   active_toks_.clear();
-  KALDI_ASSERT(num_toks_ == 0);
 }
 
 // static
@@ -24,8 +24,13 @@
 #define KALDI_DECODER_LATTICE_FASTER_DECODER_H_
 
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
 #include "util/stl-utils.h"
-#include "util/hash-list.h"
+#include "util/open-hash-list.h"
 #include "fst/fstlib.h"
 #include "itf/decodable-itf.h"
 #include "fstext/fstext-lib.h"
@@ -48,6 +53,8 @@ struct LatticeFasterDecoderConfig {
   BaseFloat prune_scale;   // Note: we don't make this configurable on the command line,
                            // it's not a very important parameter.  It affects the
                            // algorithm that prunes the tokens as we go.
+  int32 emitting_threads;  // Number of threads that expand the emitting arcs
+                           // of one frame; see ProcessEmittingSharded().
   // Most of the options inside det_opts are not actually queried by the
   // LatticeFasterDecoder class itself, but by the code that calls it, for
   // example in the function DecodeUtteranceLatticeFaster.
@@ -61,7 +68,8 @@ struct LatticeFasterDecoderConfig {
                                 determinize_lattice(true),
                                 beam_delta(0.5),
                                 hash_ratio(2.0),
-                                prune_scale(0.1) { }
+                                prune_scale(0.1),
+                                emitting_threads(1) { }
   void Register(OptionsItf *opts) {
     det_opts.Register(opts);
     opts->Register("beam", &beam, "Decoding beam.  Larger->slower, more accurate.");
@@ -80,12 +88,18 @@ struct LatticeFasterDecoderConfig {
                    "max-active constraint is applied.  Larger is more accurate.");
     opts->Register("hash-ratio", &hash_ratio, "Setting used in decoder to "
                    "control hash behavior");
+    opts->Register("emitting-threads", &emitting_threads, "Number of threads "
+                   "used to expand the emitting arcs within one utterance "
+                   "(only for frames with many active tokens, and only for "
+                   "VectorFst/ConstFst graphs).  The lattices do not depend "
+                   "on this value.");
   }
   void Check() const {
     KALDI_ASSERT(beam > 0.0 && max_active > 1 && lattice_beam > 0.0
                  && min_active <= max_active
                  && prune_interval > 0 && beam_delta > 0.0 && hash_ratio >= 1.0
-                 && prune_scale > 0.0 && prune_scale < 1.0);
+                 && prune_scale > 0.0 && prune_scale < 1.0
+                 && emitting_threads >= 1);
   }
 };
 
@@ -205,9 +219,82 @@ struct BackpointerToken {
       backpointer(backpointer) { }
 };
 
+
+// TokenArena is the allocator the decoder uses for its Tokens and
+// ForwardLinks.  Objects are carved consecutively out of large blocks, so the
+// tokens created on one frame sit next to each other in memory (with plain
+// new/delete they are scattered over the heap); objects freed during pruning
+// go on a free list and are reused, as for the Elems of HashList.  Clear()
+// releases everything at once, without visiting the objects, and keeps the
+// blocks for the next utterance.  T must be trivially destructible.
+template <typename T>
+class TokenArena {
+ public:
+  TokenArena(): free_head_(NULL), block_(0), pos_(0), num_used_(0) { }
+
+  ~TokenArena() {
+    for (size_t i = 0; i < blocks_.size(); i++)
+      delete [] blocks_[i];
+  }
+
+  // Returns uninitialized memory for one T; construct it with placement new.
+  inline void *Allocate() {
+    num_used_++;
+    if (free_head_ != NULL) {
+      Slot *ans = free_head_;
+      free_head_ = ans->next;
+      return ans;
+    }
+    if (block_ == blocks_.size() || pos_ == kBlockSize) {
+      if (block_ < blocks_.size()) block_++;
+      if (block_ == blocks_.size())
+        blocks_.push_back(new Slot[kBlockSize]);
+      pos_ = 0;
+    }
+    return &(blocks_[block_][pos_++]);
+  }
+
+  inline void Free(T *t) {
+    Slot *s = reinterpret_cast<Slot*>(t);
+    s->next = free_head_;
+    free_head_ = s;
+    num_used_--;
+  }
+
+  // Frees all objects in one go.  The memory is kept for reuse.
+  void Clear() {
+    free_head_ = NULL;
+    block_ = 0;
+    pos_ = 0;
+    num_used_ = 0;
+  }
+
+  // Returns the number of objects currently allocated.
+  size_t NumUsed() const { return num_used_; }
+
+ private:
+  static_assert(std::is_trivially_destructible<T>::value,
+                "TokenArena::Clear() does not call destructors.");
+  union Slot {
+    Slot *next;  // used while the slot is on the free list.
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+  static const size_t kBlockSize = 4096;  // objects per block.
+
+  Slot *free_head_;  // head of the list of freed slots.
+  std::vector<Slot*> blocks_;
+  size_t block_;  // index of the block we are carving objects from.
+  size_t pos_;  // next unused slot in blocks_[block_].
+  size_t num_used_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(TokenArena);
+};
+
 }  // namespace decoder
 
 
+template <typename FST, typename Token> class LatticeFasterBatchDecoderTpl;
+
 /** This is the "normal" lattice-generating decoder.
     See \ref lattices_generation \ref decoders_faster and \ref decoders_simple
      for more information.
@@ -342,13 +429,21 @@ class LatticeFasterDecoderTpl {
   // whenever we call ProcessEmitting().
   inline int32 NumFramesDecoded() const { return active_toks_.size() - 1; }
 
+  /// If 'state_counts' is non-NULL, from now on the decoder adds one to
+  /// (*state_counts)[s] each time it expands the emitting arcs of graph
+  /// state s, resizing the vector as needed.  This profile is used by
+  /// "fstreorderstates --order=frequency".  NULL switches it off again.
+  void SetStateCounts(std::vector<int64> *state_counts) {
+    state_counts_ = state_counts;
+  }
+
  protected:
   // we make things protected instead of private, as code in
   // LatticeFasterOnlineDecoderTpl, which inherits from this, also uses the
   // internals.
 
   // Deletes the elements of the singly linked list tok->links.
-  inline static void DeleteForwardLinks(Token *tok);
+  inline void DeleteForwardLinks(Token *tok);
 
   // head of per-frame list of Tokens (list is in topological order),
   // and something saying whether we ever pruned it using PruneForwardLinks.
@@ -360,7 +455,7 @@ class LatticeFasterDecoderTpl {
                  must_prune_tokens(true) { }
   };
 
-  using Elem = typename HashList<StateId, Token*>::Elem;
+  using Elem = typename OpenHashList<StateId, Token*>::Elem;
   // Equivalent to:
   //  struct Elem {
   //    StateId key;
@@ -447,25 +542,117 @@ class LatticeFasterDecoderTpl {
   /// use.
   BaseFloat ProcessEmitting(DecodableInterface *decodable);
 
+  /// The part of ProcessEmitting() that comes before the loop over the tokens:
+  /// takes the tokens of the previous frame out of the hash and returns them,
+  /// works out the pruning cutoffs from them and from the arcs of the best
+  /// one, and records the cost offset of the frame.  The caller must expand
+  /// the returned tokens and delete their Elems, e.g. with
+  /// ReplayEmittingArcs().
+  Elem *BeginEmitting(DecodableInterface *decodable, int32 *frame,
+                      size_t *tok_cnt, BaseFloat *cur_cutoff,
+                      BaseFloat *adaptive_beam, BaseFloat *cost_offset,
+                      BaseFloat *next_cutoff);
+
+  /// An emitting arc that survived a preliminary pruning, recorded by
+  /// ExpandShard() (or LatticeFasterBatchDecoderTpl) so that the tokens and
+  /// links can be created afterwards by ReplayEmittingArcs().
+  struct EmittingArc {
+    Token *tok;  // the token we come from.
+    StateId nextstate;
+    Label ilabel;
+    Label olabel;
+    BaseFloat graph_cost;
+    BaseFloat ac_cost;
+    BaseFloat tot_cost;
+  };
+
+  /// Version of the main loop of ProcessEmitting() that splits the tokens
+  /// 'final_toks' into up to config_.emitting_threads consecutive shards and
+  /// expands their arcs in parallel, in shard_threads_ and the calling thread;
+  /// each shard prunes with its own running cutoff, which is never tighter
+  /// than the one the serial loop would have had at the same arc.  The
+  /// surviving arcs are then replayed in the serial order with the serial
+  /// pruning rule, so the tokens, links and return value are exactly those of
+  /// the serial loop.  Deletes the Elems of final_toks.
+  BaseFloat ProcessEmittingSharded(DecodableInterface *decodable,
+                                   int32 frame, Elem *final_toks,
+                                   size_t tok_cnt, BaseFloat cur_cutoff,
+                                   BaseFloat adaptive_beam,
+                                   BaseFloat cost_offset,
+                                   BaseFloat next_cutoff);
+
+  /// Expands the emitting arcs of the tokens from 'begin' up to (not
+  /// including) 'end', using the acoustic log-likelihoods in
+  /// frame_loglikes_.  Called from several threads at once; it only reads
+  /// the decoder.  If it meets an ilabel the decodable object does not
+  /// cover, it sets *bad_ilabel to it and stops.
+  void ExpandShard(const Elem *begin, const Elem *end,
+                   BaseFloat cur_cutoff, BaseFloat adaptive_beam,
+                   BaseFloat cost_offset, BaseFloat next_cutoff,
+                   std::vector<EmittingArc> *arcs, Label *bad_ilabel) const;
+
+  /// Creates the tokens and links for 'arcs', which are the surviving
+  /// emitting arcs of the tokens from 'begin' up to (not including) 'end', in
+  /// the order in which the loop in ProcessEmitting() would have visited
+  /// them.  Applies the pruning rule of that loop, starting from
+  /// 'next_cutoff', and returns the final cutoff.  Deletes the Elems.
+  BaseFloat ReplayEmittingArcs(int32 frame, Elem *begin, Elem *end,
+                               const std::vector<EmittingArc> &arcs,
+                               BaseFloat adaptive_beam, BaseFloat next_cutoff);
+
+  /// Returns true if arc iterators on fst_ may be used from several threads
+  /// at once, i.e. if the FST is fully expanded (VectorFst, ConstFst).
+  bool FstIsThreadSafe() const;
+
+  /// Called from InitDecoding(): starts config_.emitting_threads - 1 threads
+  /// for ProcessEmittingSharded() (none if FstIsThreadSafe() is false), unless
+  /// they are already running; they are kept until the destructor.
+  void StartShardThreads();
+  void StopShardThreads();
+  /// The loop of the thread that expands shard 'shard' (>= 1) of each frame
+  /// in ProcessEmittingSharded(); it waits for the frames after 'last_job'.
+  void ShardThread(int32 shard, int64 last_job);
+
   /// Processes nonemitting (epsilon) arcs for one frame.  Called after
   /// ProcessEmitting() on each frame.  The cost cutoff is computed by the
   /// preceding ProcessEmitting().
   void ProcessNonemitting(BaseFloat cost_cutoff);
 
-  // HashList defined in ../util/hash-list.h.  It actually allows us to maintain
+  // OpenHashList defined in ../util/open-hash-list.h (it has the same interface
+  // as HashList in ../util/hash-list.h).  It actually allows us to maintain
   // more than one list (e.g. for current and previous frames), but only one of
   // them at a time can be indexed by StateId.  It is indexed by frame-index
   // plus one, where the frame-index is zero-based, as used in decodable object.
   // That is, the emitting probs of frame t are accounted for in tokens at
   // toks_[t+1].  The zeroth frame is for nonemitting transition at the start of
   // the graph.
-  HashList<StateId, Token*> toks_;
+  OpenHashList<StateId, Token*> toks_;
 
   std::vector<TokenList> active_toks_; // Lists of tokens, indexed by
   // frame (members of TokenList are toks, must_prune_forward_links,
   // must_prune_tokens).
   std::vector<StateId> queue_;  // temp variable used in ProcessNonemitting,
   std::vector<BaseFloat> tmp_array_;  // used in GetCutoff.
+  // Used in ProcessEmittingSharded(): the surviving arcs of each shard, and
+  // the log-likelihoods of the current frame indexed by ilabel.
+  std::vector<std::vector<EmittingArc> > shard_arcs_;
+  std::vector<BaseFloat> frame_loglikes_;
+  // The work for the shard threads on the current frame: shard s is the
+  // tokens from shard_begin_[s] up to shard_begin_[s + 1], and the rest are
+  // the arguments of ExpandShard().
+  std::vector<Elem*> shard_begin_;
+  std::vector<Label> shard_bad_ilabel_;
+  BaseFloat shard_cur_cutoff_, shard_adaptive_beam_, shard_cost_offset_,
+      shard_next_cutoff_;
+  // The threads that expand shards 1, 2, ... (shard 0 is done by the thread
+  // that calls ProcessEmitting()).  shard_mutex_ protects the variables after
+  // it.
+  std::vector<std::thread> shard_threads_;
+  std::mutex shard_mutex_;
+  std::condition_variable shard_work_cond_, shard_done_cond_;
+  int64 shard_job_;  // incremented for each frame given to the threads.
+  int32 shard_num_running_;  // the threads still expanding their shard.
+  bool shard_stop_;
 
   // fst_ is a pointer to the FST we are decoding from.
   const FST *fst_;
@@ -479,6 +666,26 @@ class LatticeFasterDecoderTpl {
   // zero, to reduce roundoff errors.
   LatticeFasterDecoderConfig config_;
   int32 num_toks_; // current total #toks allocated...
+  std::vector<int64> *state_counts_;  // see SetStateCounts(); usually NULL.
+
+  // Memory for the Tokens and ForwardLinks; see TokenArena.  Tokens are
+  // created with NewToken()/NewForwardLink() and returned with
+  // token_arena_.Free() and link_arena_.Free().
+  decoder::TokenArena<Token> token_arena_;
+  decoder::TokenArena<ForwardLinkT> link_arena_;
+  inline Token *NewToken(BaseFloat tot_cost, BaseFloat extra_cost,
+                         ForwardLinkT *links, Token *next,
+                         Token *backpointer) {
+    return new (token_arena_.Allocate()) Token(tot_cost, extra_cost, links,
+                                               next, backpointer);
+  }
+  inline ForwardLinkT *NewForwardLink(Token *next_tok, Label ilabel,
+                                      Label olabel, BaseFloat graph_cost,
+                                      BaseFloat acoustic_cost,
+                                      ForwardLinkT *next) {
+    return new (link_arena_.Allocate()) ForwardLinkT(
+        next_tok, ilabel, olabel, graph_cost, acoustic_cost, next);
+  }
   bool warned_;
 
   /// decoding_finalized_ is true if someone called FinalizeDecoding().  [note,
@@ -519,6 +726,9 @@ class LatticeFasterDecoderTpl {
 
   void ClearActiveTokens();
 
+  // The batch decoder runs the emitting phase of several decoders at once.
+  friend class LatticeFasterBatchDecoderTpl<FST, Token>;
+
   KALDI_DISALLOW_COPY_AND_ASSIGN(LatticeFasterDecoderTpl);
 };
 
@@ -28,7 +28,7 @@
 #define KALDI_DECODER_LATTICE_FASTER_ONLINE_DECODER_H_
 
 #include "util/stl-utils.h"
-#include "util/hash-list.h"
+#include "util/open-hash-list.h"
 #include "fst/fstlib.h"
 #include "itf/decodable-itf.h"
 #include "fstext/fstext-lib.h"
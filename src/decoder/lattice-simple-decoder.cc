@@ -26,8 +26,7 @@ namespace kaldi {
 
 void LatticeSimpleDecoder::InitDecoding() {
   // clean up from last time:
-  cur_toks_.clear();
-  prev_toks_.clear();
+  DeleteElems(cur_toks_.Clear());
   ClearActiveTokens();
   warned_ = false;
   decoding_finalized_ = false;
@@ -38,7 +37,7 @@ void LatticeSimpleDecoder::InitDecoding() {
   active_toks_.resize(1);
   Token *start_tok = new Token(0.0, 0.0, NULL, NULL);
   active_toks_[0].toks = start_tok;
-  cur_toks_[start_state] = start_tok;
+  cur_toks_.Insert(start_state, start_tok);
   num_toks_++;
   ProcessNonemitting();
 }
@@ -197,8 +196,8 @@ inline LatticeSimpleDecoder::Token *LatticeSimpleDecoder::FindOrAddToken(
   KALDI_ASSERT(frame < active_toks_.size());
   Token *&toks = active_toks_[frame].toks;
     
-  unordered_map<StateId, Token*>::iterator find_iter = cur_toks_.find(state);
-  if (find_iter == cur_toks_.end()) { // no such token presently.
+  Elem *e_found = cur_toks_.Find(state);
+  if (e_found == NULL) { // no such token presently.
     // Create one.
     const BaseFloat extra_cost = 0.0;
     // tokens on the currently final frame have zero extra_cost
@@ -207,11 +206,11 @@ inline LatticeSimpleDecoder::Token *LatticeSimpleDecoder::FindOrAddToken(
     Token *new_tok = new Token (tot_cost, extra_cost, NULL, toks);
     toks = new_tok;
     num_toks_++;
-    cur_toks_[state] = new_tok;
+    cur_toks_.Insert(state, new_tok);
     if (changed) *changed = true;
     return new_tok;
   } else {
-    Token *tok = find_iter->second; // There is an existing Token for this state.
+    Token *tok = e_found->val; // There is an existing Token for this state.
     if (tok->tot_cost > tot_cost) {
       tok->tot_cost = tot_cost;
       if (changed) *changed = true;
@@ -301,10 +300,9 @@ void LatticeSimpleDecoder::ComputeFinalCosts(
   BaseFloat best_cost = infinity,
       best_cost_with_final = infinity;
   
-  for (unordered_map<StateId, Token*>::const_iterator iter = cur_toks_.begin();
-       iter != cur_toks_.end(); ++iter) {
-    StateId state = iter->first;
-    Token *tok = iter->second;
+  for (const Elem *e = cur_toks_.GetList(); e != NULL; e = e->tail) {
+    StateId state = e->key;
+    Token *tok = e->val;
     BaseFloat final_cost = fst_.Final(state).Value();
     BaseFloat cost = tok->tot_cost,
         cost_with_final = cost + final_cost;
@@ -347,7 +345,7 @@ void LatticeSimpleDecoder::PruneForwardLinksFinal() {
   decoding_finalized_ = true;
   // We're about to delete some of the tokens active on the final frame, so we
   // clear cur_toks_ because otherwise it would then contain dangling pointers.
-  cur_toks_.clear();
+  DeleteElems(cur_toks_.Clear());
   
   // Now go through tokens on this frame, pruning forward links...  may have to
   // iterate a few times until there is no more change, because the list is not
@@ -512,17 +510,14 @@ void LatticeSimpleDecoder::ProcessEmitting(DecodableInterface *decodable) {
                                          // (zero-based) used to get likelihoods
                                          // from the decodable object.
   active_toks_.resize(active_toks_.size() + 1);
-  prev_toks_.clear();
-  cur_toks_.swap(prev_toks_);
+  Elem *prev_toks = cur_toks_.Clear();
 
   // Processes emitting arcs for one frame.  Propagates from
-  // prev_toks_ to cur_toks_.
+  // prev_toks to cur_toks_.
   BaseFloat cutoff = std::numeric_limits<BaseFloat>::infinity();
-  for (unordered_map<StateId, Token*>::iterator iter = prev_toks_.begin();
-       iter != prev_toks_.end();
-       ++iter) {
-    StateId state = iter->first;
-    Token *tok = iter->second;
+  for (Elem *e = prev_toks, *e_tail; e != NULL; e = e_tail) {
+    StateId state = e->key;
+    Token *tok = e->val;
     for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
          !aiter.Done();
          aiter.Next()) {
@@ -544,6 +539,8 @@ void LatticeSimpleDecoder::ProcessEmitting(DecodableInterface *decodable) {
                                      graph_cost, ac_cost, tok->links);
       }
     }
+    e_tail = e->tail;
+    cur_toks_.Delete(e);  // done with this element.
   }
 }
 
@@ -561,13 +558,11 @@ void LatticeSimpleDecoder::ProcessNonemitting() {
   // problem did not improve overall speed.
   std::vector<StateId> queue;
   BaseFloat best_cost = std::numeric_limits<BaseFloat>::infinity();
-  for (unordered_map<StateId, Token*>::iterator iter = cur_toks_.begin();
-       iter != cur_toks_.end();
-       ++iter) {
-    StateId state = iter->first;
+  for (const Elem *e = cur_toks_.GetList(); e != NULL; e = e->tail) {
+    StateId state = e->key;
     if (fst_.NumInputEpsilons(state) != 0)
       queue.push_back(state);
-    best_cost = std::min(best_cost, iter->second->tot_cost);
+    best_cost = std::min(best_cost, e->val->tot_cost);
   }
   if (queue.empty()) {
     if (!warned_) {
@@ -581,7 +576,7 @@ void LatticeSimpleDecoder::ProcessNonemitting() {
   while (!queue.empty()) {
     StateId state = queue.back();
     queue.pop_back();
-    Token *tok = cur_toks_[state];
+    Token *tok = cur_toks_.Find(state)->val;  // state is always present.
     // If "tok" has any existing forward links, delete them,
     // because we're about to regenerate them.  This is a kind
     // of non-optimality (remember, this is the simple decoder),
@@ -633,31 +628,36 @@ void LatticeSimpleDecoder::ClearActiveTokens() { // a cleanup routine, at utt en
 // PruneCurrentTokens deletes the tokens from the "toks" map, but not
 // from the active_toks_ list, which could cause dangling forward pointers
 // (will delete it during regular pruning operation).
-void LatticeSimpleDecoder::PruneCurrentTokens(BaseFloat beam, unordered_map<StateId, Token*> *toks) {
-  if (toks->empty()) {
+void LatticeSimpleDecoder::PruneCurrentTokens(
+    BaseFloat beam, OpenHashList<StateId, Token*> *toks) {
+  if (toks->GetList() == NULL) {
     KALDI_VLOG(2) <<  "No tokens to prune.\n";
     return;
   }
   BaseFloat best_cost = 1.0e+10;  // positive == high cost == bad.
-  for (unordered_map<StateId, Token*>::iterator iter = toks->begin();
-       iter != toks->end(); ++iter) {
+  for (const Elem *e = toks->GetList(); e != NULL; e = e->tail) {
     best_cost =
         std::min(best_cost,
-                 static_cast<BaseFloat>(iter->second->tot_cost));
+                 static_cast<BaseFloat>(e->val->tot_cost));
   }
-  std::vector<StateId> retained;
+  size_t num_retained = 0;
   BaseFloat cutoff = best_cost + beam;
-  for (unordered_map<StateId, Token*>::iterator iter = toks->begin();
-       iter != toks->end(); ++iter) {
-    if (iter->second->tot_cost < cutoff)
-      retained.push_back(iter->first);
+  for (Elem *e = toks->Clear(), *e_tail; e != NULL; e = e_tail) {
+    if (e->val->tot_cost < cutoff) {
+      toks->Insert(e->key, e->val);
+      num_retained++;
+    }
+    e_tail = e->tail;
+    toks->Delete(e);
   }
-  unordered_map<StateId, Token*> tmp;
-  for (size_t i = 0; i < retained.size(); i++) {
-    tmp[retained[i]] = (*toks)[retained[i]];
+  KALDI_VLOG(2) <<  "Pruned to "<<num_retained<<" toks.\n";
+}
+
+void LatticeSimpleDecoder::DeleteElems(Elem *list) {
+  for (Elem *e = list, *e_tail; e != NULL; e = e_tail) {
+    e_tail = e->tail;
+    cur_toks_.Delete(e);
   }
-  KALDI_VLOG(2) <<  "Pruned to "<<(retained.size())<<" toks.\n";
-  tmp.swap(*toks);
 }
 
 
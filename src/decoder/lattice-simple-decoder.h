@@ -24,6 +24,7 @@
 
 
 #include "util/stl-utils.h"
+#include "util/open-hash-list.h"
 #include "fst/fstlib.h"
 #include "itf/decodable-itf.h"
 #include "fstext/fstext-lib.h"
@@ -82,9 +83,15 @@ class LatticeSimpleDecoder {
   // instantiate this class onece for each thing you have to decode.
   LatticeSimpleDecoder(const fst::Fst<fst::StdArc> &fst,
                        const LatticeSimpleDecoderConfig &config):
-      fst_(fst), config_(config), num_toks_(0) { config.Check(); }
-  
-  ~LatticeSimpleDecoder() { ClearActiveTokens(); }
+      fst_(fst), config_(config), num_toks_(0) {
+    config.Check();
+    cur_toks_.SetSize(1000);  // it grows as needed.
+  }
+
+  ~LatticeSimpleDecoder() {
+    DeleteElems(cur_toks_.Clear());
+    ClearActiveTokens();
+  }
 
   const LatticeSimpleDecoderConfig &GetOptions() const {
     return config_;
@@ -284,10 +291,15 @@ class LatticeSimpleDecoder {
   // PruneCurrentTokens deletes the tokens from the "toks" map, but not
   // from the active_toks_ list, which could cause dangling forward pointers
   // (will delete it during regular pruning operation).
-  void PruneCurrentTokens(BaseFloat beam, unordered_map<StateId, Token*> *toks);
-  
-  unordered_map<StateId, Token*> cur_toks_;
-  unordered_map<StateId, Token*> prev_toks_;
+  void PruneCurrentTokens(BaseFloat beam, OpenHashList<StateId, Token*> *toks);
+
+  typedef OpenHashList<StateId, Token*>::Elem Elem;
+  // Returns the Elems of a list obtained from cur_toks_.Clear() to cur_toks_.
+  void DeleteElems(Elem *list);
+
+  // The tokens active on the current frame, indexed by state.  The tokens of
+  // the previous frame are taken out of it with Clear() in ProcessEmitting().
+  OpenHashList<StateId, Token*> cur_toks_;
   std::vector<TokenList> active_toks_; // Lists of tokens, indexed by
   // frame_plus_one
   const fst::Fst<fst::StdArc> &fst_;
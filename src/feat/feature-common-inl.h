@@ -69,16 +69,33 @@ void OfflineFeatureTpl<F>::Compute(
     return;
   }
   output->Resize(rows_out, cols_out);
-  Vector<BaseFloat> window;  // windowed waveform.
+  // The frames are given to computer_ in blocks of this many, which it can
+  // process together (e.g. doing the FFTs with BatchedRealFft) while they are
+  // in the cache.
+  const int32 block_size = 32;
+  int32 padded_window_size = computer_.GetFrameOptions().PaddedWindowSize();
+  Matrix<BaseFloat> windows(std::min(block_size, rows_out),
+                            padded_window_size, kUndefined);
+  Vector<BaseFloat> window,  // windowed waveform.
+      raw_log_energies(windows.NumRows());
   bool use_raw_log_energy = computer_.NeedRawLogEnergy();
-  for (int32 r = 0; r < rows_out; r++) {  // r is frame index.
-    BaseFloat raw_log_energy = 0.0;
-    ExtractWindow(0, wave, r, computer_.GetFrameOptions(),
-                  feature_window_function_, &window,
-                  (use_raw_log_energy ? &raw_log_energy : NULL));
-
-    SubVector<BaseFloat> output_row(*output, r);
-    computer_.Compute(raw_log_energy, vtln_warp, &window, &output_row);
+  for (int32 r = 0; r < rows_out; r += block_size) {  // r is frame index.
+    int32 num_frames = std::min(block_size, rows_out - r);
+    for (int32 i = 0; i < num_frames; i++) {
+      BaseFloat raw_log_energy = 0.0;
+      ExtractWindow(0, wave, r + i, computer_.GetFrameOptions(),
+                    feature_window_function_, &window,
+                    (use_raw_log_energy ? &raw_log_energy : NULL));
+      windows.CopyRowFromVec(window, i);
+      raw_log_energies(i) = raw_log_energy;
+    }
+    SubMatrix<BaseFloat> block_windows(windows, 0, num_frames,
+                                       0, padded_window_size),
+        block_output(*output, r, num_frames, 0, cols_out);
+    SubVector<BaseFloat> block_raw_log_energies(raw_log_energies, 0,
+                                                num_frames);
+    computer_.ComputeFrames(block_raw_log_energies, vtln_warp,
+                            &block_windows, &block_output);
   }
 }
 
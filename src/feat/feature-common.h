@@ -94,6 +94,25 @@ class ExampleFeatureComputer {
                VectorBase<BaseFloat> *signal_frame,
                VectorBase<BaseFloat> *feature);
 
+  /**
+     Function that computes the features of a block of frames; it gives the
+     same result as calling Compute() for each of them (up to roundoff), but
+     it may process the frames together, e.g. doing all their FFTs at once
+     with BatchedRealFft.  OfflineFeatureTpl calls this one.
+
+     @param [in] signal_raw_log_energies  The raw log-energy of each frame,
+         as signal_raw_log_energy for Compute().
+     @param [in] vtln_warp  As for Compute().
+     @param [in] signal_frames  The frames of the signal, one per row, as
+         extracted by ExtractWindow(); may be used as a workspace.
+     @param [out] features  Pointer to a matrix with one row per frame and
+         this->Dim() columns, to which the computed features will be written.
+  */
+  void ComputeFrames(const VectorBase<BaseFloat> &signal_raw_log_energies,
+                     BaseFloat vtln_warp,
+                     MatrixBase<BaseFloat> *signal_frames,
+                     MatrixBase<BaseFloat> *features);
+
  private:
   // disallow assignment.
   ExampleFeatureComputer &operator = (const ExampleFeatureComputer &in);
@@ -24,13 +24,15 @@
 namespace kaldi {
 
 FbankComputer::FbankComputer(const FbankOptions &opts):
-    opts_(opts), srfft_(NULL) {
+    opts_(opts), srfft_(NULL), batched_fft_(NULL) {
   if (opts.energy_floor > 0.0)
     log_energy_floor_ = Log(opts.energy_floor);
 
   int32 padded_window_size = opts.frame_opts.PaddedWindowSize();
-  if ((padded_window_size & (padded_window_size-1)) == 0)  // Is a power of two...
+  if ((padded_window_size & (padded_window_size-1)) == 0) {  // Is a power of two...
     srfft_ = new SplitRadixRealFft<BaseFloat>(padded_window_size);
+    batched_fft_ = new BatchedRealFft<BaseFloat>(padded_window_size);
+  }
 
   // We'll definitely need the filterbanks info for VTLN warping factor 1.0.
   // [note: this call caches it.]
@@ -39,13 +41,15 @@ FbankComputer::FbankComputer(const FbankOptions &opts):
 
 FbankComputer::FbankComputer(const FbankComputer &other):
     opts_(other.opts_), log_energy_floor_(other.log_energy_floor_),
-    mel_banks_(other.mel_banks_), srfft_(NULL) {
+    mel_banks_(other.mel_banks_), srfft_(NULL), batched_fft_(NULL) {
   for (std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.begin();
       iter != mel_banks_.end();
       ++iter)
     iter->second = new MelBanks(*(iter->second));
   if (other.srfft_)
     srfft_ = new SplitRadixRealFft<BaseFloat>(*(other.srfft_));
+  if (other.batched_fft_)
+    batched_fft_ = new BatchedRealFft<BaseFloat>(*(other.batched_fft_));
 }
 
 FbankComputer::~FbankComputer() {
@@ -53,6 +57,7 @@ FbankComputer::~FbankComputer() {
       iter != mel_banks_.end(); ++iter)
     delete iter->second;
   delete srfft_;
+  delete batched_fft_;
 }
 
 const MelBanks* FbankComputer::GetMelBanks(BaseFloat vtln_warp) {
@@ -122,4 +127,63 @@ void FbankComputer::Compute(BaseFloat signal_log_energy,
   }
 }
 
+void FbankComputer::ComputeFrames(
+    const VectorBase<BaseFloat> &signal_raw_log_energies,
+    BaseFloat vtln_warp,
+    MatrixBase<BaseFloat> *signal_frames,
+    MatrixBase<BaseFloat> *features) {
+  int32 num_frames = signal_frames->NumRows();
+  KALDI_ASSERT(signal_raw_log_energies.Dim() == num_frames &&
+               signal_frames->NumCols() == opts_.frame_opts.PaddedWindowSize() &&
+               features->NumRows() == num_frames &&
+               features->NumCols() == this->Dim());
+  if (batched_fft_ == NULL) {  // Not a power of two; do it frame by frame.
+    for (int32 r = 0; r < num_frames; r++) {
+      SubVector<BaseFloat> signal_frame(*signal_frames, r),
+          feature(*features, r);
+      Compute(signal_raw_log_energies(r), vtln_warp, &signal_frame, &feature);
+    }
+    return;
+  }
+
+  const MelBanks &mel_banks = *(GetMelBanks(vtln_warp));
+
+  // The FFT and the power spectrum of all the frames; this leaves
+  // signal_frames unchanged.
+  power_spectra_.Resize(num_frames, signal_frames->NumCols() / 2 + 1,
+                        kUndefined);
+  batched_fft_->ComputePowerSpectra(*signal_frames, &power_spectra_);
+
+  // Use magnitude instead of power if requested.
+  if (!opts_.use_power)
+    power_spectra_.ApplyPow(0.5);
+
+  int32 mel_offset = ((opts_.use_energy && !opts_.htk_compat) ? 1 : 0);
+  SubMatrix<BaseFloat> mel_energies(*features, 0, num_frames,
+                                    mel_offset, opts_.mel_opts.num_bins);
+  mel_banks.Compute(power_spectra_, &mel_energies);
+  if (opts_.use_log_fbank) {
+    // Avoid log of zero (which should be prevented anyway by dithering).
+    mel_energies.ApplyFloor(std::numeric_limits<float>::epsilon());
+    mel_energies.ApplyLog();  // take the log.
+  }
+
+  if (opts_.use_energy) {
+    int32 energy_index = opts_.htk_compat ? opts_.mel_opts.num_bins : 0;
+    for (int32 r = 0; r < num_frames; r++) {
+      BaseFloat signal_log_energy = signal_raw_log_energies(r);
+      // Compute energy after window function (not the raw one).
+      if (!opts_.raw_energy) {
+        SubVector<BaseFloat> signal_frame(*signal_frames, r);
+        signal_log_energy = Log(std::max<BaseFloat>(
+            VecVec(signal_frame, signal_frame),
+            std::numeric_limits<float>::min()));
+      }
+      if (opts_.energy_floor > 0.0 && signal_log_energy < log_energy_floor_)
+        signal_log_energy = log_energy_floor_;
+      (*features)(r, energy_index) = signal_log_energy;
+    }
+  }
+}
+
 }  // namespace kaldi
@@ -126,6 +126,14 @@ class FbankComputer {
                VectorBase<BaseFloat> *signal_frame,
                VectorBase<BaseFloat> *feature);
 
+  /// Computes the features of a block of frames, one per row of
+  /// signal_frames; see ExampleFeatureComputer::ComputeFrames() in
+  /// feature-common.h.
+  void ComputeFrames(const VectorBase<BaseFloat> &signal_raw_log_energies,
+                     BaseFloat vtln_warp,
+                     MatrixBase<BaseFloat> *signal_frames,
+                     MatrixBase<BaseFloat> *features);
+
   ~FbankComputer();
 
  private:
@@ -136,6 +144,12 @@ class FbankComputer {
   BaseFloat log_energy_floor_;
   std::map<BaseFloat, MelBanks*> mel_banks_;  // BaseFloat is VTLN coefficient.
   SplitRadixRealFft<BaseFloat> *srfft_;
+  // Used by ComputeFrames(); NULL if the padded window size is not a power of
+  // two, like srfft_.
+  BatchedRealFft<BaseFloat> *batched_fft_;
+  // The power spectra of the block of frames in ComputeFrames(); just a
+  // temporary workspace.
+  Matrix<BaseFloat> power_spectra_;
   // Disallow assignment.
   FbankComputer &operator =(const FbankComputer &other);
 };
@@ -79,8 +79,75 @@ void MfccComputer::Compute(BaseFloat signal_log_energy,
   }
 }
 
+void MfccComputer::ComputeFrames(
+    const VectorBase<BaseFloat> &signal_raw_log_energies,
+    BaseFloat vtln_warp,
+    MatrixBase<BaseFloat> *signal_frames,
+    MatrixBase<BaseFloat> *features) {
+  int32 num_frames = signal_frames->NumRows();
+  KALDI_ASSERT(signal_raw_log_energies.Dim() == num_frames &&
+               signal_frames->NumCols() == opts_.frame_opts.PaddedWindowSize() &&
+               features->NumRows() == num_frames &&
+               features->NumCols() == this->Dim());
+  if (batched_fft_ == NULL) {  // Not a power of two; do it frame by frame.
+    for (int32 r = 0; r < num_frames; r++) {
+      SubVector<BaseFloat> signal_frame(*signal_frames, r),
+          feature(*features, r);
+      Compute(signal_raw_log_energies(r), vtln_warp, &signal_frame, &feature);
+    }
+    return;
+  }
+
+  const MelBanks &mel_banks = *(GetMelBanks(vtln_warp));
+
+  // The FFT and the power spectrum of all the frames; this leaves
+  // signal_frames unchanged.
+  power_spectra_.Resize(num_frames, signal_frames->NumCols() / 2 + 1,
+                        kUndefined);
+  batched_fft_->ComputePowerSpectra(*signal_frames, &power_spectra_);
+
+  block_mel_energies_.Resize(num_frames, opts_.mel_opts.num_bins, kUndefined);
+  mel_banks.Compute(power_spectra_, &block_mel_energies_);
+
+  // avoid log of zero (which should be prevented anyway by dithering).
+  block_mel_energies_.ApplyFloor(std::numeric_limits<float>::epsilon());
+  block_mel_energies_.ApplyLog();  // take the log.
+
+  features->SetZero();  // in case there were NaNs.
+  // features = mel_energies * dct_matrix_^T [which now have log]
+  features->AddMatMat(1.0, block_mel_energies_, kNoTrans,
+                      dct_matrix_, kTrans, 0.0);
+
+  if (opts_.cepstral_lifter != 0.0)
+    features->MulColsVec(lifter_coeffs_);
+
+  for (int32 r = 0; r < num_frames; r++) {
+    SubVector<BaseFloat> feature(*features, r);
+    if (opts_.use_energy) {
+      BaseFloat signal_log_energy = signal_raw_log_energies(r);
+      if (!opts_.raw_energy) {
+        SubVector<BaseFloat> signal_frame(*signal_frames, r);
+        signal_log_energy = Log(std::max<BaseFloat>(
+            VecVec(signal_frame, signal_frame),
+            std::numeric_limits<float>::min()));
+      }
+      if (opts_.energy_floor > 0.0 && signal_log_energy < log_energy_floor_)
+        signal_log_energy = log_energy_floor_;
+      feature(0) = signal_log_energy;
+    }
+    if (opts_.htk_compat) {
+      BaseFloat energy = feature(0);
+      for (int32 i = 0; i < opts_.num_ceps - 1; i++)
+        feature(i) = feature(i+1);
+      if (!opts_.use_energy)
+        energy *= M_SQRT2;  // see Compute().
+      feature(opts_.num_ceps - 1) = energy;
+    }
+  }
+}
+
 MfccComputer::MfccComputer(const MfccOptions &opts):
-    opts_(opts), srfft_(NULL),
+    opts_(opts), srfft_(NULL), batched_fft_(NULL),
     mel_energies_(opts.mel_opts.num_bins) {
 
   int32 num_bins = opts.mel_opts.num_bins;
@@ -106,8 +173,10 @@ MfccComputer::MfccComputer(const MfccOptions &opts):
     log_energy_floor_ = Log(opts.energy_floor);
 
   int32 padded_window_size = opts.frame_opts.PaddedWindowSize();
-  if ((padded_window_size & (padded_window_size-1)) == 0)  // Is a power of two...
+  if ((padded_window_size & (padded_window_size-1)) == 0) {  // Is a power of two...
     srfft_ = new SplitRadixRealFft<BaseFloat>(padded_window_size);
+    batched_fft_ = new BatchedRealFft<BaseFloat>(padded_window_size);
+  }
 
   // We'll definitely need the filterbanks info for VTLN warping factor 1.0.
   // [note: this call caches it.]
@@ -120,12 +189,15 @@ MfccComputer::MfccComputer(const MfccComputer &other):
     log_energy_floor_(other.log_energy_floor_),
     mel_banks_(other.mel_banks_),
     srfft_(NULL),
+    batched_fft_(NULL),
     mel_energies_(other.mel_energies_.Dim(), kUndefined) {
   for (std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.begin();
        iter != mel_banks_.end(); ++iter)
     iter->second = new MelBanks(*(iter->second));
   if (other.srfft_ != NULL)
     srfft_ = new SplitRadixRealFft<BaseFloat>(*(other.srfft_));
+  if (other.batched_fft_ != NULL)
+    batched_fft_ = new BatchedRealFft<BaseFloat>(*(other.batched_fft_));
 }
 
 
@@ -136,6 +208,7 @@ MfccComputer::~MfccComputer() {
       ++iter)
     delete iter->second;
   delete srfft_;
+  delete batched_fft_;
 }
 
 const MelBanks *MfccComputer::GetMelBanks(BaseFloat vtln_warp) {
@@ -124,6 +124,14 @@ class MfccComputer {
                VectorBase<BaseFloat> *signal_frame,
                VectorBase<BaseFloat> *feature);
 
+  /// Computes the features of a block of frames, one per row of
+  /// signal_frames; see ExampleFeatureComputer::ComputeFrames() in
+  /// feature-common.h.
+  void ComputeFrames(const VectorBase<BaseFloat> &signal_raw_log_energies,
+                     BaseFloat vtln_warp,
+                     MatrixBase<BaseFloat> *signal_frames,
+                     MatrixBase<BaseFloat> *features);
+
   ~MfccComputer();
  private:
   // disallow assignment.
@@ -137,10 +145,17 @@ class MfccComputer {
   BaseFloat log_energy_floor_;
   std::map<BaseFloat, MelBanks*> mel_banks_;  // BaseFloat is VTLN coefficient.
   SplitRadixRealFft<BaseFloat> *srfft_;
+  // Used by ComputeFrames(); NULL if the padded window size is not a power of
+  // two, like srfft_.
+  BatchedRealFft<BaseFloat> *batched_fft_;
 
   // note: mel_energies_ is specific to the frame we're processing, it's
   // just a temporary workspace.
   Vector<BaseFloat> mel_energies_;
+  // The same for ComputeFrames(), which processes a block of frames, with the
+  // power spectra too.
+  Matrix<BaseFloat> power_spectra_;
+  Matrix<BaseFloat> block_mel_energies_;
 };
 
 typedef OfflineFeatureTpl<MfccComputer> Mfcc;
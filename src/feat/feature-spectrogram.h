@@ -96,6 +96,14 @@ class SpectrogramComputer {
                VectorBase<BaseFloat> *signal_frame,
                VectorBase<BaseFloat> *feature);
 
+  /// Computes the features of a block of frames, one per row of
+  /// signal_frames; see ExampleFeatureComputer::ComputeFrames() in
+  /// feature-common.h.
+  void ComputeFrames(const VectorBase<BaseFloat> &signal_raw_log_energies,
+                     BaseFloat vtln_warp,
+                     MatrixBase<BaseFloat> *signal_frames,
+                     MatrixBase<BaseFloat> *features);
+
   ~SpectrogramComputer();
 
  private:
@@ -250,6 +250,39 @@ void MelBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
   }
 }
 
+void MelBanks::Compute(const MatrixBase<BaseFloat> &power_spectra,
+                       MatrixBase<BaseFloat> *mel_energies_out) const {
+  int32 num_bins = bins_.size(), num_frames = power_spectra.NumRows();
+  KALDI_ASSERT(mel_energies_out->NumRows() == num_frames &&
+               mel_energies_out->NumCols() == num_bins);
+
+  // The bins are narrow, so the dot products are done inline rather than by
+  // calling VecVec() for each one.
+  for (int32 r = 0; r < num_frames; r++) {
+    const BaseFloat *power_spectrum = power_spectra.RowData(r);
+    BaseFloat *mel_energies = mel_energies_out->RowData(r);
+    for (int32 i = 0; i < num_bins; i++) {
+      const BaseFloat *power = power_spectrum + bins_[i].first,
+          *weights = bins_[i].second.Data();
+      int32 dim = bins_[i].second.Dim();
+      BaseFloat energy = 0.0;
+      for (int32 j = 0; j < dim; j++)
+        energy += weights[j] * power[j];
+      if (htk_mode_ && energy < 1.0) energy = 1.0;
+      mel_energies[i] = energy;
+    }
+  }
+
+  if (debug_) {
+    fprintf(stderr, "MEL BANKS:\n");
+    for (int32 r = 0; r < num_frames; r++) {
+      for (int32 i = 0; i < num_bins; i++)
+        fprintf(stderr, " %f", (*mel_energies_out)(r, i));
+      fprintf(stderr, "\n");
+    }
+  }
+}
+
 void ComputeLifterCoeffs(BaseFloat Q, VectorBase<BaseFloat> *coeffs) {
   // Compute liftering coefficients (scaling on cepstral coeffs)
   // coeffs are numbered slightly differently from HTK: the zeroth
@@ -111,6 +111,13 @@ class MelBanks {
   void Compute(const VectorBase<BaseFloat> &fft_energies,
                VectorBase<BaseFloat> *mel_energies_out) const;
 
+  /// This version of Compute() does the same for each row of "fft_energies"
+  /// (e.g. the power spectra of a block of frames, from
+  /// BatchedRealFft::ComputePowerSpectra()), writing the corresponding row of
+  /// "mel_energies_out".
+  void Compute(const MatrixBase<BaseFloat> &fft_energies,
+               MatrixBase<BaseFloat> *mel_energies_out) const;
+
   int32 NumBins() const { return bins_.size(); }
 
   // returns vector of central freq of each bin; needed by plp code.
@@ -104,19 +104,32 @@ void OnlineGenericBaseFeature<C>::ComputeFeatures() {
                                  input_finished_);
   KALDI_ASSERT(num_frames_new >= num_frames_old);
 
+  // As in OfflineFeatureTpl::Compute(), the frames are given to computer_ in
+  // blocks; this also makes the features the same as the offline ones.
+  const int32 block_size = 32;
   Vector<BaseFloat> window;
   bool need_raw_log_energy = computer_.NeedRawLogEnergy();
-  for (int32 frame = num_frames_old; frame < num_frames_new; frame++) {
-    BaseFloat raw_log_energy = 0.0;
-    ExtractWindow(waveform_offset_, waveform_remainder_, frame,
-                  frame_opts, window_function_, &window,
-                  need_raw_log_energy ? &raw_log_energy : NULL);
-    Vector<BaseFloat> *this_feature = new Vector<BaseFloat>(computer_.Dim(),
-                                                            kUndefined);
+  for (int32 frame = num_frames_old; frame < num_frames_new;
+       frame += block_size) {
+    int32 num_frames = std::min(block_size, num_frames_new - frame);
+    Matrix<BaseFloat> windows(num_frames, frame_opts.PaddedWindowSize(),
+                              kUndefined),
+        block_features(num_frames, computer_.Dim(), kUndefined);
+    Vector<BaseFloat> raw_log_energies(num_frames);
+    for (int32 i = 0; i < num_frames; i++) {
+      BaseFloat raw_log_energy = 0.0;
+      ExtractWindow(waveform_offset_, waveform_remainder_, frame + i,
+                    frame_opts, window_function_, &window,
+                    need_raw_log_energy ? &raw_log_energy : NULL);
+      windows.CopyRowFromVec(window, i);
+      raw_log_energies(i) = raw_log_energy;
+    }
     // note: this online feature-extraction code does not support VTLN.
     BaseFloat vtln_warp = 1.0;
-    computer_.Compute(raw_log_energy, vtln_warp, &window, this_feature);
-    features_.PushBack(this_feature);
+    computer_.ComputeFrames(raw_log_energies, vtln_warp, &windows,
+                            &block_features);
+    for (int32 i = 0; i < num_frames; i++)
+      features_.PushBack(new Vector<BaseFloat>(block_features.Row(i)));
   }
   // OK, we will now discard any portion of the signal that will not be
   // necessary to compute frames in the future.
@@ -0,0 +1,149 @@
+// fstbin/fstreorderstates.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/kaldi-io.h"
+#include "util/parse-options.h"
+#include "fst/fstlib.h"
+#include "fstext/kaldi-fst-io.h"
+#include "fstext/reorder-states.h"
+
+namespace kaldi {
+
+// Simulates decoding with 'fst' and prints the cache miss rate.
+void ReportCacheMisses(const fst::StdVectorFst &fst, const std::string &name,
+                       int32 num_frames, int32 max_active, BaseFloat beam,
+                       int64 cache_bytes) {
+  int64 num_reads, num_misses;
+  fst::SimulateDecodingCacheMisses(fst, num_frames, max_active, beam,
+                                   cache_bytes, &num_reads, &num_misses);
+  KALDI_LOG << "Simulated decoding with the " << name << " graph: "
+            << num_reads << " cache-line reads, " << num_misses
+            << " misses (miss rate "
+            << (num_misses / static_cast<double>(std::max<int64>(num_reads, 1)))
+            << ")";
+}
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+    using kaldi::int32;
+    using kaldi::int64;
+
+    const char *usage =
+        "Renumbers the states of a decoding graph (e.g. HCLG.fst) so that\n"
+        "states that are used together are close together in memory, which\n"
+        "makes decoding with large graphs faster; the graph is otherwise\n"
+        "unchanged, and so is the decoding output.  The states are numbered\n"
+        "in breadth-first order from the start state, or with --order=frequency\n"
+        "by how often the decoder used them (see latgen-faster-mapped\n"
+        "--state-counts).  The arcs of each state are sorted with the\n"
+        "emitting arcs first.  The output is a ConstFst.\n"
+        "With --benchmark=true, prints the cache miss rate of a simulated\n"
+        "decoding with the graph before and after the renumbering.\n"
+        "\n"
+        "Usage:  fstreorderstates [options] <in-fst> <out-fst>\n"
+        " e.g.: latgen-faster-mapped --state-counts=counts ... HCLG.fst ...\n"
+        "       fstreorderstates --order=frequency --state-counts=counts "
+        "HCLG.fst HCLG.reordered.fst\n";
+
+    std::string order_type = "bfs", state_counts_rxfilename;
+    bool mappable = false, benchmark = false;
+    int32 benchmark_frames = 300, benchmark_max_active = 7000;
+    BaseFloat benchmark_beam = 15.0, cache_mb = 32.0;
+
+    ParseOptions po(usage);
+    po.Register("order", &order_type, "How to order the states: \"bfs\" or "
+                "\"frequency\".");
+    po.Register("state-counts", &state_counts_rxfilename, "For "
+                "--order=frequency: the number of times each state was used, "
+                "as written by latgen-faster-mapped --state-counts.");
+    po.Register("mappable", &mappable, "If true, write the output in the "
+                "format the decoders memory-map (see make-mappable-fst); "
+                "the output must then be a file.");
+    po.Register("benchmark", &benchmark, "If true, print the cache miss "
+                "rate of a simulated decoding before and after.");
+    po.Register("benchmark-frames", &benchmark_frames, "Number of frames "
+                "of the simulated decoding.");
+    po.Register("benchmark-max-active", &benchmark_max_active,
+                "Maximum number of active states in the simulated decoding.");
+    po.Register("benchmark-beam", &benchmark_beam, "Beam of the simulated "
+                "decoding (the pseudo-random acoustic costs are in [0, 10)).");
+    po.Register("cache-mb", &cache_mb, "Size of the simulated cache in MB "
+                "(e.g. the size of the last-level cache).");
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+    if (order_type != "bfs" && order_type != "frequency")
+      KALDI_ERR << "Invalid --order=" << order_type;
+    if ((order_type == "frequency") != (state_counts_rxfilename != ""))
+      KALDI_ERR << "--state-counts is needed with --order=frequency, "
+                << "and only then.";
+
+    std::string fst_rxfilename = po.GetArg(1),
+        fst_wxfilename = po.GetArg(2);
+
+    VectorFst<StdArc> *fst =
+        CastOrConvertToVectorFst(ReadFstKaldiGeneric(fst_rxfilename));
+    int64 cache_bytes = static_cast<int64>(cache_mb * 1024 * 1024);
+    if (benchmark)
+      ReportCacheMisses(*fst, "original", benchmark_frames,
+                        benchmark_max_active, benchmark_beam, cache_bytes);
+
+    std::vector<StdArc::StateId> order;
+    if (order_type == "bfs") {
+      BfsStateOrder(*fst, &order);
+    } else {
+      std::vector<int64> state_counts;
+      bool binary;
+      Input ki(state_counts_rxfilename, &binary);
+      ReadIntegerVector(ki.Stream(), binary, &state_counts);
+      if (state_counts.size() != static_cast<size_t>(fst->NumStates()))
+        KALDI_WARN << "The state counts have " << state_counts.size()
+                   << " entries but the graph has " << fst->NumStates()
+                   << " states; were they computed with this graph?";
+      FrequencyStateOrder(*fst, state_counts, &order);
+    }
+    ReorderStates(order, fst);
+
+    if (benchmark)
+      ReportCacheMisses(*fst, "reordered", benchmark_frames,
+                        benchmark_max_active, benchmark_beam, cache_bytes);
+
+    if (mappable) {
+      WriteConstFstMappable(*fst, fst_wxfilename);
+    } else {
+      ConstFst<StdArc> const_fst(*fst);
+      Output ko(fst_wxfilename, true, false);
+      FstWriteOptions wopts(PrintableWxfilename(fst_wxfilename));
+      if (!const_fst.Write(ko.Stream(), wopts))
+        KALDI_ERR << "Error writing FST to "
+                  << PrintableWxfilename(fst_wxfilename);
+    }
+    delete fst;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,62 @@
+// fstbin/make-mappable-fst.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/kaldi-io.h"
+#include "util/parse-options.h"
+#include "fst/fstlib.h"
+#include "fstext/kaldi-fst-io.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+    using kaldi::int32;
+
+    const char *usage =
+        "Converts an FST (e.g. HCLG.fst) to a ConstFst in the aligned format\n"
+        "that the decoders memory-map instead of reading: loading it takes no\n"
+        "time, and all decoding processes on a machine share one copy of it\n"
+        "in the page cache.  The output is an ordinary ConstFst that the\n"
+        "OpenFst tools can read, and must be a file (not a pipe).\n"
+        "\n"
+        "Usage:  make-mappable-fst <in-fst> <out-fst>\n"
+        " e.g.: make-mappable-fst exp/tri3/graph/HCLG.fst "
+        "exp/tri3/graph/HCLG.mapped.fst\n";
+
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string fst_rxfilename = po.GetArg(1),
+        fst_wxfilename = po.GetArg(2);
+
+    Fst<StdArc> *fst = ReadFstKaldiGeneric(fst_rxfilename);
+    WriteConstFstMappable(*fst, fst_wxfilename);
+    KALDI_LOG << "Wrote FST with " << CountStates(*fst) << " states to "
+              << PrintableWxfilename(fst_wxfilename);
+    delete fst;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
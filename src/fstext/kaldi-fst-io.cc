@@ -73,6 +73,13 @@ Fst<StdArc> *ReadFstKaldiGeneric(std::string rxfilename, bool throw_on_err) {
   FstReadOptions ropts("<unspecified>", &hdr);
   Fst<StdArc> *fst = NULL;
   if (hdr.FstType() == "const") {
+    if ((hdr.GetFlags() & FstHeader::IS_ALIGNED) != 0 &&
+        kaldi::ClassifyRxfilename(rxfilename) == kaldi::kFileInput) {
+      // Written by WriteConstFstMappable(): map the states and arcs straight
+      // from the file rather than copying them into memory.
+      ropts.mode = FstReadOptions::MAP;
+      ropts.source = rxfilename;
+    }
     fst = ConstFst<StdArc>::Read(ki.Stream(), ropts);
   } else if (hdr.FstType() == "vector") {
     fst = VectorFst<StdArc>::Read(ki.Stream(), ropts);
@@ -122,6 +129,26 @@ void WriteFstKaldi(const VectorFst<StdArc> &fst,
   fst.Write(ko.Stream(), wopts);
 }
 
+void WriteConstFstMappable(const Fst<StdArc> &fst, std::string wxfilename) {
+  if (kaldi::ClassifyWxfilename(wxfilename) != kaldi::kFileOutput)
+    KALDI_ERR << "A memory-mappable FST can only be written to a file, not to "
+              << kaldi::PrintableWxfilename(wxfilename);
+  bool write_binary = true, write_header = false;
+  kaldi::Output ko(wxfilename, write_binary, write_header);
+  FstWriteOptions wopts(kaldi::PrintableWxfilename(wxfilename));
+  wopts.align = true;
+  bool ok;
+  if (fst.Type() == "const") {
+    ok = fst.Write(ko.Stream(), wopts);
+  } else {
+    ConstFst<StdArc> const_fst(fst);
+    ok = const_fst.Write(ko.Stream(), wopts);
+  }
+  if (!ok || !ko.Close())
+    KALDI_ERR << "Error writing FST to "
+              << kaldi::PrintableWxfilename(wxfilename);
+}
+
 fst::VectorFst<fst::StdArc> *ReadAndPrepareLmFst(std::string rxfilename) {
   // ReadFstKaldi() will die with exception on failure.
   fst::VectorFst<fst::StdArc> *ans = fst::ReadFstKaldi(rxfilename);
@@ -47,6 +47,8 @@ VectorFst<StdArc> *ReadFstKaldi(std::string rxfilename);
 // doesn't support the text-mode option that we generally like to support.
 // This version currently supports ConstFst<StdArc> or VectorFst<StdArc>
 // (const-fst can give better performance for decoding).
+// If 'rxfilename' is an ordinary file containing a ConstFst written with
+// WriteConstFstMappable(), the FST is memory-mapped instead of read.
 Fst<StdArc> *ReadFstKaldiGeneric(std::string rxfilename,
                                  bool throw_on_err = true);
 
@@ -67,6 +69,16 @@ void ReadFstKaldi(std::string rxfilename, VectorFst<StdArc> *ofst);
 void WriteFstKaldi(const VectorFst<StdArc> &fst,
                    std::string wxfilename);
 
+// Writes 'fst' as a ConstFst<StdArc> in OpenFst's aligned format, in which
+// the state and arc arrays are laid out exactly as in memory.
+// ReadFstKaldiGeneric() memory-maps such files: loading takes no time
+// whatever the size of the graph, and all the processes that decode with it
+// share one copy in the page cache.  'wxfilename' must be an ordinary file
+// (the alignment is relative to the start of the file); replace such a file
+// rather than overwriting it while it is in use.  On error, throws using
+// KALDI_ERR.
+void WriteConstFstMappable(const Fst<StdArc> &fst, std::string wxfilename);
+
 // This is a more general Kaldi-type-IO mechanism of writing FSTs to
 // streams, supporting binary or text-mode writing.  (note: we just
 // write the integers, symbol tables are not supported).
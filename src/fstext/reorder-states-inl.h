@@ -0,0 +1,251 @@
+// fstext/reorder-states-inl.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FSTEXT_REORDER_STATES_INL_H_
+#define KALDI_FSTEXT_REORDER_STATES_INL_H_
+
+#include <algorithm>
+#include <list>
+#include <unordered_map>
+
+namespace fst {
+
+template<class Arc>
+void BfsStateOrder(const ExpandedFst<Arc> &fst,
+                   std::vector<typename Arc::StateId> *order) {
+  typedef typename Arc::StateId StateId;
+  StateId num_states = fst.NumStates(), next_id = 0;
+  order->assign(num_states, kNoStateId);
+  std::vector<StateId> queue;
+  queue.reserve(num_states);
+  if (fst.Start() != kNoStateId) {
+    (*order)[fst.Start()] = next_id++;
+    queue.push_back(fst.Start());
+  }
+  for (size_t i = 0; i < queue.size(); i++) {
+    for (ArcIterator<ExpandedFst<Arc> > aiter(fst, queue[i]);
+         !aiter.Done(); aiter.Next()) {
+      StateId nextstate = aiter.Value().nextstate;
+      if ((*order)[nextstate] == kNoStateId) {
+        (*order)[nextstate] = next_id++;
+        queue.push_back(nextstate);
+      }
+    }
+  }
+  for (StateId s = 0; s < num_states; s++)
+    if ((*order)[s] == kNoStateId)
+      (*order)[s] = next_id++;
+}
+
+template<class Arc>
+void FrequencyStateOrder(const ExpandedFst<Arc> &fst,
+                         const std::vector<kaldi::int64> &state_counts,
+                         std::vector<typename Arc::StateId> *order) {
+  typedef typename Arc::StateId StateId;
+  StateId num_states = fst.NumStates();
+  BfsStateOrder(fst, order);
+  // Sort the (count, bfs-number) pairs; the state is the bfs-number's
+  // preimage.
+  std::vector<std::pair<kaldi::int64, StateId> > pairs(num_states);
+  std::vector<StateId> bfs_to_state(num_states);
+  for (StateId s = 0; s < num_states; s++) {
+    kaldi::int64 count = (static_cast<size_t>(s) < state_counts.size() ?
+                          state_counts[s] : 0);
+    // Negate the count to get decreasing order.
+    pairs[s] = std::make_pair(-count, (*order)[s]);
+    bfs_to_state[(*order)[s]] = s;
+  }
+  std::sort(pairs.begin(), pairs.end());
+  for (StateId i = 0; i < num_states; i++)
+    (*order)[bfs_to_state[pairs[i].second]] = i;
+}
+
+template<class Arc>
+void ReorderStates(const std::vector<typename Arc::StateId> &order,
+                   MutableFst<Arc> *fst) {
+  KALDI_ASSERT(order.size() == static_cast<size_t>(fst->NumStates()));
+  StateSort(fst, order);
+  ArcSort(fst, EmittingFirstCompare<Arc>());
+}
+
+
+namespace internal {
+
+// A fully associative cache of 64-byte lines with least-recently-used
+// replacement; used in SimulateDecodingCacheMisses().
+class CacheSimulator {
+ public:
+  explicit CacheSimulator(kaldi::int64 cache_bytes):
+      num_lines_(std::max<kaldi::int64>(1, cache_bytes / kLineBytes)),
+      num_reads_(0), num_misses_(0) { }
+
+  // Reads the bytes [address, address + num_bytes) in the memory region
+  // 'region' (regions do not overlap).
+  void Read(int32 region, kaldi::int64 address, kaldi::int64 num_bytes) {
+    kaldi::int64 first = address / kLineBytes,
+        last = (address + num_bytes - 1) / kLineBytes;
+    for (kaldi::int64 line = first; line <= last; line++)
+      ReadLine((static_cast<kaldi::uint64>(region) << 56) | line);
+  }
+
+  kaldi::int64 NumReads() const { return num_reads_; }
+  kaldi::int64 NumMisses() const { return num_misses_; }
+
+ private:
+  void ReadLine(kaldi::uint64 line) {
+    num_reads_++;
+    std::unordered_map<kaldi::uint64,
+                       std::list<kaldi::uint64>::iterator>::iterator
+        iter = index_.find(line);
+    if (iter != index_.end()) {  // hit: move it to the front.
+      lru_.splice(lru_.begin(), lru_, iter->second);
+      return;
+    }
+    num_misses_++;
+    if (static_cast<kaldi::int64>(lru_.size()) == num_lines_) {
+      index_.erase(lru_.back());
+      lru_.pop_back();
+    }
+    lru_.push_front(line);
+    index_[line] = lru_.begin();
+  }
+
+  static const kaldi::int64 kLineBytes = 64;
+  kaldi::int64 num_lines_;
+  std::list<kaldi::uint64> lru_;  // most recently used first.
+  std::unordered_map<kaldi::uint64,
+                     std::list<kaldi::uint64>::iterator> index_;
+  kaldi::int64 num_reads_;
+  kaldi::int64 num_misses_;
+};
+
+// Returns a cost in [0, 10) that depends only on 'frame' and 'ilabel'.
+inline float PseudoAcousticCost(int32 frame, int32 ilabel) {
+  kaldi::uint64 x = (static_cast<kaldi::uint64>(frame) << 32) ^
+      static_cast<kaldi::uint32>(ilabel);
+  // The finalizer of the "splitmix64" generator.
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return 10.0 * static_cast<double>(x >> 11) / 9007199254740992.0;  // 2^53
+}
+
+}  // namespace internal
+
+
+template<class Arc>
+void SimulateDecodingCacheMisses(const ExpandedFst<Arc> &fst,
+                                 int32 num_frames, int32 max_active,
+                                 float beam, kaldi::int64 cache_bytes,
+                                 kaldi::int64 *num_reads,
+                                 kaldi::int64 *num_misses) {
+  typedef typename Arc::StateId StateId;
+  typedef std::unordered_map<StateId, float> CostMap;
+  // The sizes of the records of a ConstFst (the state record is the final
+  // weight and four counts).
+  const kaldi::int64 state_bytes = sizeof(typename Arc::Weight) +
+      4 * sizeof(uint32), arc_bytes = sizeof(Arc);
+  StateId num_states = fst.NumStates();
+  std::vector<kaldi::int64> arc_offset(num_states + 1, 0);
+  for (StateId s = 0; s < num_states; s++)
+    arc_offset[s + 1] = arc_offset[s] + fst.NumArcs(s);
+
+  internal::CacheSimulator cache(cache_bytes);
+  CostMap cur_costs, next_costs;
+  std::vector<StateId> queue;
+  std::vector<float> costs;
+
+  // Reads the state and its arcs, as ProcessEmitting() or
+  // ProcessNonemitting() would.
+  auto read_state = [&cache, &arc_offset, state_bytes, arc_bytes] (StateId s) {
+    cache.Read(0, s * state_bytes, state_bytes);
+    if (arc_offset[s + 1] > arc_offset[s])
+      cache.Read(1, arc_offset[s] * arc_bytes,
+                 (arc_offset[s + 1] - arc_offset[s]) * arc_bytes);
+  };
+
+  if (fst.Start() != kNoStateId)
+    next_costs[fst.Start()] = 0.0;
+  for (int32 t = -1; t < num_frames; t++) {
+    if (t >= 0) {  // Emitting arcs; frame -1 only has the epsilon closure.
+      next_costs.clear();
+      for (typename CostMap::const_iterator iter = cur_costs.begin();
+           iter != cur_costs.end(); ++iter) {
+        StateId s = iter->first;
+        read_state(s);
+        for (ArcIterator<ExpandedFst<Arc> > aiter(fst, s);
+             !aiter.Done(); aiter.Next()) {
+          const Arc &arc = aiter.Value();
+          if (arc.ilabel == 0) continue;
+          float cost = iter->second + arc.weight.Value() +
+              internal::PseudoAcousticCost(t, arc.ilabel);
+          typename CostMap::iterator next_iter =
+              next_costs.find(arc.nextstate);
+          if (next_iter == next_costs.end())
+            next_costs[arc.nextstate] = cost;
+          else if (cost < next_iter->second)
+            next_iter->second = cost;
+        }
+      }
+    }
+    // Epsilon arcs.
+    queue.clear();
+    for (typename CostMap::const_iterator iter = next_costs.begin();
+         iter != next_costs.end(); ++iter)
+      queue.push_back(iter->first);
+    while (!queue.empty()) {
+      StateId s = queue.back();
+      queue.pop_back();
+      read_state(s);
+      float cur_cost = next_costs[s];
+      for (ArcIterator<ExpandedFst<Arc> > aiter(fst, s);
+           !aiter.Done(); aiter.Next()) {
+        const Arc &arc = aiter.Value();
+        if (arc.ilabel != 0) continue;
+        float cost = cur_cost + arc.weight.Value();
+        typename CostMap::iterator next_iter = next_costs.find(arc.nextstate);
+        if (next_iter == next_costs.end() || cost < next_iter->second) {
+          next_costs[arc.nextstate] = cost;
+          queue.push_back(arc.nextstate);
+        }
+      }
+    }
+    // Pruning.
+    costs.clear();
+    for (typename CostMap::const_iterator iter = next_costs.begin();
+         iter != next_costs.end(); ++iter)
+      costs.push_back(iter->second);
+    if (costs.empty()) break;
+    float cutoff = *std::min_element(costs.begin(), costs.end()) + beam;
+    if (costs.size() > static_cast<size_t>(max_active)) {
+      std::nth_element(costs.begin(), costs.begin() + max_active, costs.end());
+      cutoff = std::min(cutoff, costs[max_active]);
+    }
+    cur_costs.clear();
+    for (typename CostMap::const_iterator iter = next_costs.begin();
+         iter != next_costs.end(); ++iter)
+      if (iter->second < cutoff)
+        cur_costs[iter->first] = iter->second;
+  }
+  *num_reads = cache.NumReads();
+  *num_misses = cache.NumMisses();
+}
+
+}  // namespace fst
+
+#endif  // KALDI_FSTEXT_REORDER_STATES_INL_H_
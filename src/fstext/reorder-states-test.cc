@@ -0,0 +1,95 @@
+// fstext/reorder-states-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fstext/fstext-utils.h"
+#include "fstext/rand-fst.h"
+#include "fstext/reorder-states.h"
+
+namespace fst {
+
+// Checks that 'order' is a permutation of the states.
+static void CheckPermutation(const std::vector<StdArc::StateId> &order) {
+  std::vector<bool> seen(order.size(), false);
+  for (size_t i = 0; i < order.size(); i++) {
+    KALDI_ASSERT(order[i] >= 0 && order[i] < order.size() && !seen[order[i]]);
+    seen[order[i]] = true;
+  }
+}
+
+void TestReorderStates() {
+  for (int32 i = 0; i < 10; i++) {
+    RandFstOptions opts;
+    VectorFst<StdArc> *fst = RandFst<StdArc>(opts);
+    if (fst->Start() == kNoStateId) {
+      delete fst;
+      continue;
+    }
+    typedef StdArc::StateId StateId;
+
+    std::vector<StateId> order;
+    BfsStateOrder(*fst, &order);
+    CheckPermutation(order);
+    KALDI_ASSERT(order[fst->Start()] == 0);
+    VectorFst<StdArc> bfs_fst(*fst);
+    ReorderStates(order, &bfs_fst);
+    KALDI_ASSERT(bfs_fst.Start() == 0);
+    KALDI_ASSERT(RandEquivalent(*fst, bfs_fst, 5, 0.01, kaldi::Rand(), 10));
+    // Emitting arcs come first, and the arcs are sorted on nextstate.
+    EmittingFirstCompare<StdArc> comp;
+    for (StateId s = 0; s < bfs_fst.NumStates(); s++) {
+      ArcIterator<VectorFst<StdArc> > aiter(bfs_fst, s);
+      if (aiter.Done()) continue;
+      StdArc prev_arc = aiter.Value();
+      for (aiter.Next(); !aiter.Done(); aiter.Next()) {
+        KALDI_ASSERT(!comp(aiter.Value(), prev_arc));
+        prev_arc = aiter.Value();
+      }
+    }
+
+    std::vector<kaldi::int64> counts(fst->NumStates());
+    for (size_t s = 0; s < counts.size(); s++)
+      counts[s] = kaldi::RandInt(0, 3);
+    FrequencyStateOrder(*fst, counts, &order);
+    CheckPermutation(order);
+    for (size_t s = 0; s < counts.size(); s++)
+      for (size_t t = 0; t < counts.size(); t++)
+        if (order[s] < order[t])
+          KALDI_ASSERT(counts[s] >= counts[t]);
+    VectorFst<StdArc> freq_fst(*fst);
+    ReorderStates(order, &freq_fst);
+    KALDI_ASSERT(RandEquivalent(*fst, freq_fst, 5, 0.01, kaldi::Rand(), 10));
+
+    // The renumbering does not change the search; a cache large enough for
+    // the whole graph only misses once per line.
+    kaldi::int64 num_reads, num_misses, num_reads2, num_misses2;
+    SimulateDecodingCacheMisses(*fst, 20, 100, 10.0, 1 << 20,
+                                &num_reads, &num_misses);
+    SimulateDecodingCacheMisses(bfs_fst, 20, 100, 10.0, 1 << 20,
+                                &num_reads2, &num_misses2);
+    KALDI_ASSERT(num_misses <= num_reads && num_misses2 <= num_reads2);
+    KALDI_ASSERT(num_misses <= 1 + (fst->NumStates() * 20 +
+                                    NumArcs(*fst) * sizeof(StdArc)) / 64 + 2);
+    delete fst;
+  }
+}
+
+}  // end namespace fst
+
+int main() {
+  fst::TestReorderStates();
+  std::cout << "Test OK\n";
+}
@@ -0,0 +1,95 @@
+// fstext/reorder-states.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FSTEXT_REORDER_STATES_H_
+#define KALDI_FSTEXT_REORDER_STATES_H_
+
+#include <fst/fstlib.h>
+#include <fst/fst-decl.h>
+#include "base/kaldi-common.h"
+
+// Functions to renumber the states of a decoding graph so that states that
+// are used together are close together in memory.  The decoders touch the
+// states and arcs of a large graph almost at random; with a better layout
+// more of those accesses hit the cache.  The output FST is equivalent to the
+// input (only the state numbers and the order of the arcs change), so the
+// decoding output does not change.
+
+namespace fst {
+
+/// Outputs in (*order)[s] the new number of state s (as StateSort() wants it)
+/// for numbering the states in breadth-first order from the start state.
+/// Unreachable states go at the end, in their original order.
+template<class Arc>
+void BfsStateOrder(const ExpandedFst<Arc> &fst,
+                   std::vector<typename Arc::StateId> *order);
+
+/// As BfsStateOrder(), but the states are numbered in decreasing order of
+/// state_counts[s] (e.g. the number of times the decoder expanded state s,
+/// see LatticeFasterDecoderTpl::SetStateCounts()), so that the states most
+/// used come first; states with the same count (e.g. never used) are in
+/// breadth-first order.  state_counts may be shorter than the number of
+/// states; missing entries count as zero.
+template<class Arc>
+void FrequencyStateOrder(const ExpandedFst<Arc> &fst,
+                         const std::vector<kaldi::int64> &state_counts,
+                         std::vector<typename Arc::StateId> *order);
+
+/// Compares arcs so that emitting arcs (nonzero ilabel) come before
+/// epsilon-input arcs, each sorted on the destination state.  The decoders
+/// go through the arcs of a state once for the emitting arcs and once for
+/// the epsilons, and this way each pass reads a contiguous range.
+template<class Arc>
+class EmittingFirstCompare {
+ public:
+  bool operator() (const Arc &arc1, const Arc &arc2) const {
+    bool eps1 = (arc1.ilabel == 0), eps2 = (arc2.ilabel == 0);
+    if (eps1 != eps2) return eps2;
+    return arc1.nextstate < arc2.nextstate;
+  }
+  uint64 Properties(uint64 props) const {
+    return props & kArcSortProperties;  // neither ilabel- nor olabel-sorted.
+  }
+};
+
+/// Renumbers the states of 'fst' according to 'order' (see
+/// BfsStateOrder()) and sorts the arcs of each state with
+/// EmittingFirstCompare.
+template<class Arc>
+void ReorderStates(const std::vector<typename Arc::StateId> &order,
+                   MutableFst<Arc> *fst);
+
+/// Estimates how often a decoder's reads of 'fst' would miss a cache of
+/// 'cache_bytes' bytes (fully associative, least-recently-used, with 64-byte
+/// lines), if the graph were stored as a ConstFst (one array of states, and
+/// one array of arcs ordered by state).  It runs a beam search like the
+/// decoders', keeping up to 'max_active' states within 'beam' of the best,
+/// with pseudo-random acoustic costs that depend on the frame and the ilabel
+/// only, so that graphs that differ only in their state numbering get the
+/// same search.  Outputs the number of cache-line reads and misses.
+template<class Arc>
+void SimulateDecodingCacheMisses(const ExpandedFst<Arc> &fst,
+                                 int32 num_frames, int32 max_active,
+                                 float beam, kaldi::int64 cache_bytes,
+                                 kaldi::int64 *num_reads,
+                                 kaldi::int64 *num_misses);
+
+}  // namespace fst
+
+#include "fstext/reorder-states-inl.h"
+
+#endif  // KALDI_FSTEXT_REORDER_STATES_H_
@@ -28,6 +28,7 @@
 #include "util/stl-utils.h"
 #include "base/kaldi-math.h"
 #include "hmm/hmm-utils.h"
+#include "matrix/simd-math.h"
 
 namespace kaldi {
 using std::map;
@@ -147,15 +148,99 @@ int32 CompactLatticeStateTimes(const CompactLattice &lat, vector<int32> *times)
   return utt_len;
 }
 
-bool ComputeCompactLatticeAlphas(const CompactLattice &clat,
-                                 vector<double> *alpha) {
-  using namespace fst;
+namespace {
+
+// Returns the log of the sum of the exponentials of x[0] ... x[n-1] (or their
+// maximum if viterbi == true).
+inline double LogSumExpOrMax(bool viterbi, const double *x, int32 n) {
+  if (n <= 2)  // the common cases.
+    return (n == 0 ? kLogZeroDouble : n == 1 ? x[0] :
+            viterbi ? std::max(x[0], x[1]) : LogAdd(x[0], x[1]));
+  if (!viterbi)
+    return SimdLogSumExp(x, n);
+  double ans = kLogZeroDouble;
+  for (int32 i = 0; i < n; i++)
+    ans = std::max(ans, x[i]);
+  return ans;
+}
 
-  // typedef the arc, weight types
-  typedef CompactLattice::Arc Arc;
-  typedef Arc::Weight Weight;
-  typedef Arc::StateId StateId;
+// Sets (*alpha)[s] to the total log-likelihood of the paths from the start
+// state to s (or of the best one, if viterbi == true), without the
+// final-prob of s; returns the total over the final states, including their
+// final-probs.  Requires that lat be topologically sorted.
+template<class LatticeType>
+double ComputeLatticeAlphas(const LatticeType &lat, bool viterbi,
+                            vector<double> *alpha) {
+  typedef typename LatticeType::Arc Arc;
+  int32 num_states = lat.NumStates();
+  // Until all the arcs entering state s have been seen, its alpha is
+  // (*alpha)[s] + log(sum[s]), where (*alpha)[s] is the largest term so far
+  // and sum[s] the sum of the exponentials of the terms relative to it, as in
+  // SimdLogSumExp(): that is one Exp() per arc and one Log() per state, where
+  // LogAdd() does an Exp() and a Log1p() per arc.
+  alpha->assign(num_states, kLogZeroDouble);
+  vector<double> sum(num_states, 1.0), final_likes;
+  if (num_states > 0)
+    (*alpha)[0] = 0.0;
+  for (int32 s = 0; s < num_states; s++) {
+    if (sum[s] != 1.0)
+      (*alpha)[s] += Log(sum[s]);
+    double this_alpha = (*alpha)[s];
+    for (fst::ArcIterator<LatticeType> aiter(lat, s); !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      double like = this_alpha - ConvertToCost(arc.weight),
+          &max = (*alpha)[arc.nextstate];
+      if (like <= max) {
+        double diff = like - max;
+        if (!viterbi && diff >= kMinLogDiffDouble)
+          sum[arc.nextstate] += Exp(diff);
+      } else {
+        double diff = max - like, &this_sum = sum[arc.nextstate];
+        this_sum = (!viterbi && diff >= kMinLogDiffDouble ?
+                    this_sum * Exp(diff) + 1.0 : 1.0);
+        max = like;
+      }
+    }
+    double final_cost = ConvertToCost(lat.Final(s));
+    if (final_cost != std::numeric_limits<double>::infinity())
+      final_likes.push_back(this_alpha - final_cost);
+  }
+  return LogSumExpOrMax(viterbi, final_likes.data(), final_likes.size());
+}
+
+// Sets (*beta)[s] to the total log-likelihood of the paths from s to the
+// end, including the final-probs (or that of the best one, if viterbi ==
+// true); returns that of the start state.  Requires that lat be
+// topologically sorted.
+template<class LatticeType>
+double ComputeLatticeBetas(const LatticeType &lat, bool viterbi,
+                           vector<double> *beta) {
+  typedef typename LatticeType::Arc Arc;
+  int32 num_states = lat.NumStates();
+  beta->resize(num_states);
+  // The log-likelihoods through the arcs of a state, and its final-prob.
+  vector<double> likes;
+  for (int32 s = num_states - 1; s >= 0; s--) {
+    likes.clear();
+    double final_like = -ConvertToCost(lat.Final(s));
+    if (final_like != kLogZeroDouble)
+      likes.push_back(final_like);
+    for (fst::ArcIterator<LatticeType> aiter(lat, s); !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      likes.push_back((*beta)[arc.nextstate] - ConvertToCost(arc.weight));
+    }
+    (*beta)[s] = LogSumExpOrMax(viterbi, likes.data(), likes.size());
+  }
+  return (num_states == 0 ? kLogZeroDouble : (*beta)[0]);
+}
 
+}  // namespace
+
+
+bool ComputeCompactLatticeAlphas(const CompactLattice &clat,
+                                 vector<double> *alpha) {
   //Make sure the lattice is topologically sorted.
   if (clat.Properties(fst::kTopSorted, true) == 0) {
     KALDI_WARN << "Input lattice must be topologically sorted.";
@@ -166,34 +251,14 @@ bool ComputeCompactLatticeAlphas(const CompactLattice &clat,
     return false;
   }
 
-  int32 num_states = clat.NumStates();
-  (*alpha).resize(0);
-  (*alpha).resize(num_states, kLogZeroDouble);
-
   // Now propagate alphas forward. Note that we don't acount the weight of the
   // final state to alpha[final_state] -- we acount it to beta[final_state];
-  (*alpha)[0] = 0.0;
-  for (StateId s = 0; s < num_states; s++) {
-    double this_alpha = (*alpha)[s];
-    for (ArcIterator<CompactLattice> aiter(clat, s); !aiter.Done(); aiter.Next()) {
-      const Arc &arc = aiter.Value();
-      double arc_like = -(arc.weight.Weight().Value1() + arc.weight.Weight().Value2());
-      (*alpha)[arc.nextstate] = LogAdd((*alpha)[arc.nextstate], this_alpha + arc_like);
-    }
-  }
-
+  ComputeLatticeAlphas(clat, false, alpha);
   return true;
 }
 
 bool ComputeCompactLatticeBetas(const CompactLattice &clat,
                                 vector<double> *beta) {
-  using namespace fst;
-
-  // typedef the arc, weight types
-  typedef CompactLattice::Arc Arc;
-  typedef Arc::Weight Weight;
-  typedef Arc::StateId StateId;
-
   // Make sure the lattice is topologically sorted.
   if (clat.Properties(fst::kTopSorted, true) == 0) {
     KALDI_WARN << "Input lattice must be topologically sorted.";
@@ -204,24 +269,9 @@ bool ComputeCompactLatticeBetas(const CompactLattice &clat,
     return false;
   }
 
-  int32 num_states = clat.NumStates();
-  (*beta).resize(0);
-  (*beta).resize(num_states, kLogZeroDouble);
-
   // Now propagate betas backward. Note that beta[final_state] contains the
   // weight of the final state in the lattice -- compare that with alpha.
-  for (StateId s = num_states-1; s >= 0; s--) {
-    Weight f = clat.Final(s);
-    double this_beta = -(f.Weight().Value1()+f.Weight().Value2());
-    for (ArcIterator<CompactLattice> aiter(clat, s); !aiter.Done(); aiter.Next()) {
-      const Arc &arc = aiter.Value();
-      double arc_like = -(arc.weight.Weight().Value1()+arc.weight.Weight().Value2());
-      double arc_beta = (*beta)[arc.nextstate] + arc_like;
-      this_beta = LogAdd(this_beta, arc_beta);
-    }
-    (*beta)[s] = this_beta;
-  }
-
+  ComputeLatticeBetas(clat, false, beta);
   return true;
 }
 
@@ -331,44 +381,26 @@ BaseFloat LatticeForwardBackward(const Lattice &lat, Posterior *post,
   int32 num_states = lat.NumStates();
   vector<int32> state_times;
   int32 max_time = LatticeStateTimes(lat, &state_times);
-  std::vector<double> alpha(num_states, kLogZeroDouble);
-  std::vector<double> &beta(alpha); // we re-use the same memory for
-  // this, but it's semantically distinct so we name it differently.
-  double tot_forward_prob = kLogZeroDouble;
+  // Propagate alphas forward and betas backward.
+  std::vector<double> alpha, beta;
+  double tot_forward_prob = ComputeLatticeAlphas(lat, false, &alpha),
+      tot_backward_prob = ComputeLatticeBetas(lat, false, &beta);
 
   post->clear();
   post->resize(max_time);
 
-  alpha[0] = 0.0;
-  // Propagate alphas forward.
-  for (StateId s = 0; s < num_states; s++) {
-    double this_alpha = alpha[s];
-    for (ArcIterator<Lattice> aiter(lat, s); !aiter.Done(); aiter.Next()) {
-      const Arc &arc = aiter.Value();
-      double arc_like = -ConvertToCost(arc.weight);
-      alpha[arc.nextstate] = LogAdd(alpha[arc.nextstate], this_alpha + arc_like);
-    }
-    Weight f = lat.Final(s);
-    if (f != Weight::Zero()) {
-      double final_like = this_alpha - (f.Value1() + f.Value2());
-      tot_forward_prob = LogAdd(tot_forward_prob, final_like);
-      KALDI_ASSERT(state_times[s] == max_time &&
-                   "Lattice is inconsistent (final-prob not at max_time)");
-    }
-  }
   for (StateId s = num_states-1; s >= 0; s--) {
     Weight f = lat.Final(s);
-    double this_beta = -(f.Value1() + f.Value2());
+    KALDI_ASSERT((f == Weight::Zero() || state_times[s] == max_time) &&
+                 "Lattice is inconsistent (final-prob not at max_time)");
     for (ArcIterator<Lattice> aiter(lat, s); !aiter.Done(); aiter.Next()) {
       const Arc &arc = aiter.Value();
-      double arc_like = -ConvertToCost(arc.weight),
-          arc_beta = beta[arc.nextstate] + arc_like;
-      this_beta = LogAdd(this_beta, arc_beta);
       int32 transition_id = arc.ilabel;
 
       // The following "if" is an optimization to avoid un-needed exp().
       if (transition_id != 0 || acoustic_like_sum != NULL) {
-        double posterior = Exp(alpha[s] + arc_beta - tot_forward_prob);
+        double arc_beta = beta[arc.nextstate] - ConvertToCost(arc.weight),
+            posterior = Exp(alpha[s] + arc_beta - tot_forward_prob);
 
         if (transition_id != 0) // Arc has a transition-id on it [not epsilon]
           (*post)[state_times[s]].push_back(std::make_pair(transition_id,
@@ -382,9 +414,7 @@ BaseFloat LatticeForwardBackward(const Lattice &lat, Posterior *post,
           posterior = Exp(alpha[s] + final_logprob - tot_forward_prob);
       *acoustic_like_sum -= posterior * f.Value2();
     }
-    beta[s] = this_beta;
   }
-  double tot_backward_prob = beta[0];
   if (!ApproxEqual(tot_forward_prob, tot_backward_prob, 1e-8)) {
     KALDI_WARN << "Total forward probability over lattice = " << tot_forward_prob
               << ", while total backward probability = " << tot_backward_prob;
@@ -441,59 +471,15 @@ void ConvertLatticeToPhones(const TransitionModel &trans,
 }
 
 
-static inline double LogAddOrMax(bool viterbi, double a, double b) {
-  if (viterbi)
-    return std::max(a, b);
-  else
-    return LogAdd(a, b);
-}
-
 template<typename LatticeType>
 double ComputeLatticeAlphasAndBetas(const LatticeType &lat,
                                     bool viterbi,
                                     vector<double> *alpha,
                                     vector<double> *beta) {
-  typedef typename LatticeType::Arc Arc;
-  typedef typename Arc::Weight Weight;
-  typedef typename Arc::StateId StateId;
-
-  StateId num_states = lat.NumStates();
   KALDI_ASSERT(lat.Properties(fst::kTopSorted, true) == fst::kTopSorted);
   KALDI_ASSERT(lat.Start() == 0);
-  alpha->clear();
-  beta->clear();
-  alpha->resize(num_states, kLogZeroDouble);
-  beta->resize(num_states, kLogZeroDouble);
-
-  double tot_forward_prob = kLogZeroDouble;
-  (*alpha)[0] = 0.0;
-  // Propagate alphas forward.
-  for (StateId s = 0; s < num_states; s++) {
-    double this_alpha = (*alpha)[s];
-    for (fst::ArcIterator<LatticeType> aiter(lat, s); !aiter.Done();
-         aiter.Next()) {
-      const Arc &arc = aiter.Value();
-      double arc_like = -ConvertToCost(arc.weight);
-      (*alpha)[arc.nextstate] = LogAddOrMax(viterbi, (*alpha)[arc.nextstate],
-                                                this_alpha + arc_like);
-    }
-    Weight f = lat.Final(s);
-    if (f != Weight::Zero()) {
-      double final_like = this_alpha - ConvertToCost(f);
-      tot_forward_prob = LogAddOrMax(viterbi, tot_forward_prob, final_like);
-    }
-  }
-  for (StateId s = num_states-1; s >= 0; s--) { // it's guaranteed signed.
-    double this_beta = -ConvertToCost(lat.Final(s));
-    for (fst::ArcIterator<LatticeType> aiter(lat, s); !aiter.Done();
-         aiter.Next()) {
-      const Arc &arc = aiter.Value();
-      double arc_like = -ConvertToCost(arc.weight),
-          arc_beta = (*beta)[arc.nextstate] + arc_like;
-      this_beta = LogAddOrMax(viterbi, this_beta, arc_beta);
-    }
-    (*beta)[s] = this_beta;
-  }
+  double tot_forward_prob = ComputeLatticeAlphas(lat, viterbi, alpha);
+  ComputeLatticeBetas(lat, viterbi, beta);
   double tot_backward_prob = (*beta)[lat.Start()];
   if (!ApproxEqual(tot_forward_prob, tot_backward_prob, 1e-8)) {
     KALDI_WARN << "Total forward probability over lattice = " << tot_forward_prob
@@ -815,48 +801,19 @@ BaseFloat LatticeForwardBackwardMpeVariants(
   vector<int32> state_times;
   int32 max_time = LatticeStateTimes(lat, &state_times);
   KALDI_ASSERT(max_time == static_cast<int32>(num_ali.size()));
-  std::vector<double> alpha(num_states, kLogZeroDouble),
+  std::vector<double> alpha, beta,
       alpha_smbr(num_states, 0), //forward variable for sMBR
-      beta(num_states, kLogZeroDouble),
       beta_smbr(num_states, 0); //backward variable for sMBR
 
-  double tot_forward_prob = kLogZeroDouble;
   double tot_forward_score = 0;
 
   post->clear();
   post->resize(max_time);
 
-  alpha[0] = 0.0;
-  // First Pass Forward,
-  for (StateId s = 0; s < num_states; s++) {
-    double this_alpha = alpha[s];
-    for (ArcIterator<Lattice> aiter(lat, s); !aiter.Done(); aiter.Next()) {
-      const Arc &arc = aiter.Value();
-      double arc_like = -ConvertToCost(arc.weight);
-      alpha[arc.nextstate] = LogAdd(alpha[arc.nextstate], this_alpha + arc_like);
-    }
-    Weight f = lat.Final(s);
-    if (f != Weight::Zero()) {
-      double final_like = this_alpha - (f.Value1() + f.Value2());
-      tot_forward_prob = LogAdd(tot_forward_prob, final_like);
-      KALDI_ASSERT(state_times[s] == max_time &&
-                   "Lattice is inconsistent (final-prob not at max_time)");
-    }
-  }
-  // First Pass Backward,
-  for (StateId s = num_states-1; s >= 0; s--) {
-    Weight f = lat.Final(s);
-    double this_beta = -(f.Value1() + f.Value2());
-    for (ArcIterator<Lattice> aiter(lat, s); !aiter.Done(); aiter.Next()) {
-      const Arc &arc = aiter.Value();
-      double arc_like = -ConvertToCost(arc.weight),
-          arc_beta = beta[arc.nextstate] + arc_like;
-      this_beta = LogAdd(this_beta, arc_beta);
-    }
-    beta[s] = this_beta;
-  }
+  // First Pass Forward and Backward,
+  double tot_forward_prob = ComputeLatticeAlphas(lat, false, &alpha),
+      tot_backward_prob = ComputeLatticeBetas(lat, false, &beta);
   // First Pass Forward-Backward Check
-  double tot_backward_prob = beta[0];
   // may loose the condition somehow here 1e-6 (was 1e-8)
   if (!ApproxEqual(tot_forward_prob, tot_backward_prob, 1e-6)) {
     KALDI_ERR << "Total forward probability over lattice = " << tot_forward_prob
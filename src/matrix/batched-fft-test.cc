@@ -0,0 +1,79 @@
+// matrix/batched-fft-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "matrix/matrix-lib.h"
+
+namespace kaldi {
+
+// Checks BatchedRealFft against SplitRadixRealFft, row by row.
+template<typename Real>
+static void UnitTestBatchedRealFft() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT N = 1 << RandInt(2, 10), num_frames = RandInt(1, 40);
+    Matrix<Real> frames(num_frames, N);
+    frames.SetRandn();
+    Matrix<Real> fft(frames), power(num_frames, N / 2 + 1);
+    BatchedRealFft<Real> batched_fft(N);
+    KALDI_ASSERT(batched_fft.Dim() == N);
+    batched_fft.Compute(&fft);
+    batched_fft.ComputePowerSpectra(frames, &power);
+
+    SplitRadixRealFft<Real> srfft(N);
+    Matrix<Real> fft2(frames), power2(num_frames, N / 2 + 1);
+    for (MatrixIndexT r = 0; r < num_frames; r++) {
+      Real *x = fft2.RowData(r);
+      srfft.Compute(x, true);
+      power2(r, 0) = x[0] * x[0];
+      power2(r, N / 2) = x[1] * x[1];
+      for (MatrixIndexT k = 1; k < N / 2; k++)
+        power2(r, k) = x[2 * k] * x[2 * k] + x[2 * k + 1] * x[2 * k + 1];
+    }
+    AssertEqual(fft, fft2, 1.0e-04);
+    AssertEqual(power, power2, 1.0e-04);
+  }
+}
+
+// The vectorized versions must agree with the plain C++ one (up to roundoff,
+// as they use fused multiply-add).
+static void UnitTestBatchedRealFftKernels() {
+  SimdLevel cpu_level = (SetSimdLevel(kSimdAvx512), GetSimdLevel());
+  MatrixIndexT N = 1 << RandInt(2, 10), num_frames = RandInt(1, 40);
+  Matrix<float> frames(num_frames, N), power(num_frames, N / 2 + 1);
+  frames.SetRandn();
+  BatchedRealFft<float> batched_fft(N);
+  SetSimdLevel(kSimdNone);
+  batched_fft.ComputePowerSpectra(frames, &power);
+  for (int32 level = kSimdAvx2; level <= cpu_level; level++) {
+    SetSimdLevel(static_cast<SimdLevel>(level));
+    Matrix<float> power2(num_frames, N / 2 + 1);
+    batched_fft.ComputePowerSpectra(frames, &power2);
+    AssertEqual(power, power2, 1.0e-05);
+  }
+  SetSimdLevel(cpu_level);
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::SetVerboseLevel(5);
+  kaldi::UnitTestBatchedRealFft<float>();
+  kaldi::UnitTestBatchedRealFft<double>();
+  for (kaldi::int32 i = 0; i < 5; i++)
+    kaldi::UnitTestBatchedRealFftKernels();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
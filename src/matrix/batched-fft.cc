@@ -0,0 +1,376 @@
+// matrix/batched-fft.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+
+#include "matrix/batched-fft.h"
+#include "matrix/simd-math.h"
+
+// As in simd-math.cc, the vectorized kernels are compiled with the target
+// options for just those functions.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KALDI_BATCHED_FFT_X86 1
+#include <immintrin.h>
+#endif
+
+namespace kaldi {
+
+// The number of sequences transformed together, one per lane.
+static const MatrixIndexT kLanes = 16;
+
+/*
+  The transform of a block of up to kLanes sequences x of N real points is done
+  as follows (see e.g. Numerical Recipes, "FFT of real functions").  The
+  sequence z[n] = x[2n] + i x[2n+1] of M = N/2 complex points, in bit-reversed
+  order (see LoadBlock()), is transformed to Z in natural order with log2(M)
+  radix-2 decimation-in-time passes; then for k = 0 ... M/2,
+     E = (Z[k] + conj(Z[M-k])) / 2,  O = (Z[k] - conj(Z[M-k])) / 2i,
+     X[k] = E + exp(-2 pi i k / N) O,  X[M-k] = conj(E - exp(-2 pi i k / N) O),
+  where Z[M] = Z[0].  X[k] and X[M-k] are written in place of Z[k] and Z[M-k],
+  except that X[0] and X[M], which are real, are written to the real and
+  imaginary parts of element 0, as in the output of SplitRadixRealFft.
+
+  The arguments of the TransformLanes*() functions below are:
+   re, im      The real and imaginary parts of z, element n of lane l being
+               at n * kLanes + l; overwritten with X.
+   half_n      M, at least 2.
+   tw_re, tw_im  exp(-2 pi i t / M) for t = 0 ... M/2 - 1.
+   post_re, post_im  exp(-2 pi i k / N) for k = 0 ... M/2.
+*/
+
+template<typename Real>
+static void TransformLanesGeneric(Real *re, Real *im, MatrixIndexT half_n,
+                                  const Real *tw_re, const Real *tw_im,
+                                  const Real *post_re, const Real *post_im) {
+  for (MatrixIndexT half = 1; half < half_n; half *= 2) {
+    MatrixIndexT tw_stride = half_n / (2 * half);
+    for (MatrixIndexT g = 0; g < half_n; g += 2 * half) {
+      for (MatrixIndexT j = 0; j < half; j++) {
+        Real w_re = tw_re[j * tw_stride], w_im = tw_im[j * tw_stride];
+        Real *a_re = re + (g + j) * kLanes, *a_im = im + (g + j) * kLanes,
+            *b_re = a_re + half * kLanes, *b_im = a_im + half * kLanes;
+        for (MatrixIndexT l = 0; l < kLanes; l++) {
+          Real t_re = w_re * b_re[l] - w_im * b_im[l],
+              t_im = w_re * b_im[l] + w_im * b_re[l];
+          b_re[l] = a_re[l] - t_re;
+          b_im[l] = a_im[l] - t_im;
+          a_re[l] += t_re;
+          a_im[l] += t_im;
+        }
+      }
+    }
+  }
+  for (MatrixIndexT l = 0; l < kLanes; l++) {
+    Real z_re = re[l], z_im = im[l];
+    re[l] = z_re + z_im;
+    im[l] = z_re - z_im;
+  }
+  const Real half_r = 0.5;
+  for (MatrixIndexT k = 1; 2 * k < half_n; k++) {
+    Real *k_re = re + k * kLanes, *k_im = im + k * kLanes,
+        *m_re = re + (half_n - k) * kLanes, *m_im = im + (half_n - k) * kLanes;
+    for (MatrixIndexT l = 0; l < kLanes; l++) {
+      Real e_re = half_r * (k_re[l] + m_re[l]),
+          e_im = half_r * (k_im[l] - m_im[l]),
+          o_re = half_r * (k_im[l] + m_im[l]),
+          o_im = half_r * (m_re[l] - k_re[l]),
+          t_re = post_re[k] * o_re - post_im[k] * o_im,
+          t_im = post_re[k] * o_im + post_im[k] * o_re;
+      k_re[l] = e_re + t_re;
+      k_im[l] = e_im + t_im;
+      m_re[l] = e_re - t_re;
+      m_im[l] = t_im - e_im;
+    }
+  }
+  // X[M/2] = conj(Z[M/2]).
+  Real *mid_im = im + (half_n / 2) * kLanes;
+  for (MatrixIndexT l = 0; l < kLanes; l++)
+    mid_im[l] = -mid_im[l];
+}
+
+#ifdef KALDI_BATCHED_FFT_X86
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+// As TransformLanesGeneric(), with each group of 16 lanes in two vectors.
+static void TransformLanesAvx2(float *re, float *im, MatrixIndexT half_n,
+                               const float *tw_re, const float *tw_im,
+                               const float *post_re, const float *post_im) {
+  for (MatrixIndexT half = 1; half < half_n; half *= 2) {
+    MatrixIndexT tw_stride = half_n / (2 * half);
+    for (MatrixIndexT g = 0; g < half_n; g += 2 * half) {
+      for (MatrixIndexT j = 0; j < half; j++) {
+        __m256 w_re = _mm256_set1_ps(tw_re[j * tw_stride]),
+            w_im = _mm256_set1_ps(tw_im[j * tw_stride]);
+        float *a_re = re + (g + j) * kLanes, *a_im = im + (g + j) * kLanes,
+            *b_re = a_re + half * kLanes, *b_im = a_im + half * kLanes;
+        for (MatrixIndexT l = 0; l < kLanes; l += 8) {
+          __m256 ar = _mm256_loadu_ps(a_re + l), ai = _mm256_loadu_ps(a_im + l),
+              br = _mm256_loadu_ps(b_re + l), bi = _mm256_loadu_ps(b_im + l),
+              tr = _mm256_fmsub_ps(w_re, br, _mm256_mul_ps(w_im, bi)),
+              ti = _mm256_fmadd_ps(w_re, bi, _mm256_mul_ps(w_im, br));
+          _mm256_storeu_ps(b_re + l, _mm256_sub_ps(ar, tr));
+          _mm256_storeu_ps(b_im + l, _mm256_sub_ps(ai, ti));
+          _mm256_storeu_ps(a_re + l, _mm256_add_ps(ar, tr));
+          _mm256_storeu_ps(a_im + l, _mm256_add_ps(ai, ti));
+        }
+      }
+    }
+  }
+  __m256 half_v = _mm256_set1_ps(0.5f), zero = _mm256_setzero_ps();
+  for (MatrixIndexT l = 0; l < kLanes; l += 8) {
+    __m256 zr = _mm256_loadu_ps(re + l), zi = _mm256_loadu_ps(im + l);
+    _mm256_storeu_ps(re + l, _mm256_add_ps(zr, zi));
+    _mm256_storeu_ps(im + l, _mm256_sub_ps(zr, zi));
+  }
+  for (MatrixIndexT k = 1; 2 * k < half_n; k++) {
+    float *k_re = re + k * kLanes, *k_im = im + k * kLanes,
+        *m_re = re + (half_n - k) * kLanes, *m_im = im + (half_n - k) * kLanes;
+    __m256 w_re = _mm256_set1_ps(post_re[k]), w_im = _mm256_set1_ps(post_im[k]);
+    for (MatrixIndexT l = 0; l < kLanes; l += 8) {
+      __m256 kr = _mm256_loadu_ps(k_re + l), ki = _mm256_loadu_ps(k_im + l),
+          mr = _mm256_loadu_ps(m_re + l), mi = _mm256_loadu_ps(m_im + l),
+          er = _mm256_mul_ps(half_v, _mm256_add_ps(kr, mr)),
+          ei = _mm256_mul_ps(half_v, _mm256_sub_ps(ki, mi)),
+          or_ = _mm256_mul_ps(half_v, _mm256_add_ps(ki, mi)),
+          oi = _mm256_mul_ps(half_v, _mm256_sub_ps(mr, kr)),
+          tr = _mm256_fmsub_ps(w_re, or_, _mm256_mul_ps(w_im, oi)),
+          ti = _mm256_fmadd_ps(w_re, oi, _mm256_mul_ps(w_im, or_));
+      _mm256_storeu_ps(k_re + l, _mm256_add_ps(er, tr));
+      _mm256_storeu_ps(k_im + l, _mm256_add_ps(ei, ti));
+      _mm256_storeu_ps(m_re + l, _mm256_sub_ps(er, tr));
+      _mm256_storeu_ps(m_im + l, _mm256_sub_ps(ti, ei));
+    }
+  }
+  float *mid_im = im + (half_n / 2) * kLanes;
+  for (MatrixIndexT l = 0; l < kLanes; l += 8)
+    _mm256_storeu_ps(mid_im + l,
+                     _mm256_sub_ps(zero, _mm256_loadu_ps(mid_im + l)));
+  _mm256_zeroupper();  // See ApplyKernel() in simd-math-inl.h.
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+// See simd-math.cc.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// As TransformLanesGeneric(), with each group of 16 lanes in one vector.
+static void TransformLanesAvx512(float *re, float *im, MatrixIndexT half_n,
+                                 const float *tw_re, const float *tw_im,
+                                 const float *post_re, const float *post_im) {
+  for (MatrixIndexT half = 1; half < half_n; half *= 2) {
+    MatrixIndexT tw_stride = half_n / (2 * half);
+    for (MatrixIndexT g = 0; g < half_n; g += 2 * half) {
+      for (MatrixIndexT j = 0; j < half; j++) {
+        __m512 w_re = _mm512_set1_ps(tw_re[j * tw_stride]),
+            w_im = _mm512_set1_ps(tw_im[j * tw_stride]);
+        float *a_re = re + (g + j) * kLanes, *a_im = im + (g + j) * kLanes,
+            *b_re = a_re + half * kLanes, *b_im = a_im + half * kLanes;
+        __m512 ar = _mm512_loadu_ps(a_re), ai = _mm512_loadu_ps(a_im),
+            br = _mm512_loadu_ps(b_re), bi = _mm512_loadu_ps(b_im),
+            tr = _mm512_fmsub_ps(w_re, br, _mm512_mul_ps(w_im, bi)),
+            ti = _mm512_fmadd_ps(w_re, bi, _mm512_mul_ps(w_im, br));
+        _mm512_storeu_ps(b_re, _mm512_sub_ps(ar, tr));
+        _mm512_storeu_ps(b_im, _mm512_sub_ps(ai, ti));
+        _mm512_storeu_ps(a_re, _mm512_add_ps(ar, tr));
+        _mm512_storeu_ps(a_im, _mm512_add_ps(ai, ti));
+      }
+    }
+  }
+  __m512 half_v = _mm512_set1_ps(0.5f);
+  {
+    __m512 zr = _mm512_loadu_ps(re), zi = _mm512_loadu_ps(im);
+    _mm512_storeu_ps(re, _mm512_add_ps(zr, zi));
+    _mm512_storeu_ps(im, _mm512_sub_ps(zr, zi));
+  }
+  for (MatrixIndexT k = 1; 2 * k < half_n; k++) {
+    float *k_re = re + k * kLanes, *k_im = im + k * kLanes,
+        *m_re = re + (half_n - k) * kLanes, *m_im = im + (half_n - k) * kLanes;
+    __m512 w_re = _mm512_set1_ps(post_re[k]), w_im = _mm512_set1_ps(post_im[k]),
+        kr = _mm512_loadu_ps(k_re), ki = _mm512_loadu_ps(k_im),
+        mr = _mm512_loadu_ps(m_re), mi = _mm512_loadu_ps(m_im),
+        er = _mm512_mul_ps(half_v, _mm512_add_ps(kr, mr)),
+        ei = _mm512_mul_ps(half_v, _mm512_sub_ps(ki, mi)),
+        or_ = _mm512_mul_ps(half_v, _mm512_add_ps(ki, mi)),
+        oi = _mm512_mul_ps(half_v, _mm512_sub_ps(mr, kr)),
+        tr = _mm512_fmsub_ps(w_re, or_, _mm512_mul_ps(w_im, oi)),
+        ti = _mm512_fmadd_ps(w_re, oi, _mm512_mul_ps(w_im, or_));
+    _mm512_storeu_ps(k_re, _mm512_add_ps(er, tr));
+    _mm512_storeu_ps(k_im, _mm512_add_ps(ei, ti));
+    _mm512_storeu_ps(m_re, _mm512_sub_ps(er, tr));
+    _mm512_storeu_ps(m_im, _mm512_sub_ps(ti, ei));
+  }
+  float *mid_im = im + (half_n / 2) * kLanes;
+  _mm512_storeu_ps(mid_im,
+                   _mm512_sub_ps(_mm512_setzero_ps(), _mm512_loadu_ps(mid_im)));
+  _mm256_zeroupper();
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+#endif  // KALDI_BATCHED_FFT_X86
+
+static void TransformLanes(double *re, double *im, MatrixIndexT half_n,
+                           const double *tw_re, const double *tw_im,
+                           const double *post_re, const double *post_im) {
+  TransformLanesGeneric(re, im, half_n, tw_re, tw_im, post_re, post_im);
+}
+
+static void TransformLanes(float *re, float *im, MatrixIndexT half_n,
+                           const float *tw_re, const float *tw_im,
+                           const float *post_re, const float *post_im) {
+#ifdef KALDI_BATCHED_FFT_X86
+  SimdLevel level = GetSimdLevel();
+  if (level == kSimdAvx512) {
+    TransformLanesAvx512(re, im, half_n, tw_re, tw_im, post_re, post_im);
+    return;
+  } else if (level == kSimdAvx2) {
+    TransformLanesAvx2(re, im, half_n, tw_re, tw_im, post_re, post_im);
+    return;
+  }
+#endif
+  TransformLanesGeneric(re, im, half_n, tw_re, tw_im, post_re, post_im);
+}
+
+template<typename Real>
+BatchedRealFft<Real>::BatchedRealFft(MatrixIndexT N): N_(N), half_N_(N / 2) {
+  if ((N & (N - 1)) != 0 || N < 4)
+    KALDI_ERR << "BatchedRealFft called with invalid number of points " << N;
+  int32 log_half_n = 0;
+  while ((1 << log_half_n) < half_N_)
+    log_half_n++;
+  bit_reverse_.resize(half_N_);
+  for (MatrixIndexT n = 0; n < half_N_; n++) {
+    MatrixIndexT r = 0;
+    for (int32 b = 0; b < log_half_n; b++)
+      if (n & (1 << b))
+        r |= 1 << (log_half_n - 1 - b);
+    bit_reverse_[n] = r;
+  }
+  twiddle_re_.resize(half_N_ / 2);
+  twiddle_im_.resize(half_N_ / 2);
+  for (MatrixIndexT t = 0; t < half_N_ / 2; t++) {
+    double angle = -2.0 * M_PI * t / half_N_;
+    twiddle_re_[t] = std::cos(angle);
+    twiddle_im_[t] = std::sin(angle);
+  }
+  post_re_.resize(half_N_ / 2 + 1);
+  post_im_.resize(half_N_ / 2 + 1);
+  for (MatrixIndexT k = 0; k <= half_N_ / 2; k++) {
+    double angle = -2.0 * M_PI * k / N_;
+    post_re_[k] = std::cos(angle);
+    post_im_[k] = std::sin(angle);
+  }
+  re_.resize(half_N_ * kLanes);
+  im_.resize(half_N_ * kLanes);
+}
+
+template<typename Real>
+void BatchedRealFft<Real>::LoadBlock(const MatrixBase<Real> &frames,
+                                     MatrixIndexT row_offset,
+                                     MatrixIndexT num_rows) {
+  if (num_rows < kLanes) {  // the unused lanes must not contain NaN's.
+    std::fill(re_.begin(), re_.end(), 0.0);
+    std::fill(im_.begin(), im_.end(), 0.0);
+  }
+  for (MatrixIndexT l = 0; l < num_rows; l++) {
+    const Real *x = frames.RowData(row_offset + l);
+    for (MatrixIndexT n = 0; n < half_N_; n++) {
+      MatrixIndexT i = bit_reverse_[n] * kLanes + l;
+      re_[i] = x[2 * n];
+      im_[i] = x[2 * n + 1];
+    }
+  }
+}
+
+template<typename Real>
+void BatchedRealFft<Real>::TransformBlock() {
+  TransformLanes(&(re_[0]), &(im_[0]), half_N_,
+                 &(twiddle_re_[0]), &(twiddle_im_[0]),
+                 &(post_re_[0]), &(post_im_[0]));
+}
+
+template<typename Real>
+void BatchedRealFft<Real>::Compute(MatrixBase<Real> *frames) {
+  KALDI_ASSERT(frames->NumCols() == N_);
+  MatrixIndexT num_frames = frames->NumRows();
+  for (MatrixIndexT r = 0; r < num_frames; r += kLanes) {
+    MatrixIndexT num_rows = std::min(kLanes, num_frames - r);
+    LoadBlock(*frames, r, num_rows);
+    TransformBlock();
+    for (MatrixIndexT l = 0; l < num_rows; l++) {
+      Real *x = frames->RowData(r + l);
+      for (MatrixIndexT k = 0; k < half_N_; k++) {
+        x[2 * k] = re_[k * kLanes + l];
+        x[2 * k + 1] = im_[k * kLanes + l];
+      }
+    }
+  }
+}
+
+template<typename Real>
+void BatchedRealFft<Real>::ComputePowerSpectra(
+    const MatrixBase<Real> &frames, MatrixBase<Real> *power_spectra) {
+  KALDI_ASSERT(frames.NumCols() == N_ &&
+               power_spectra->NumRows() == frames.NumRows() &&
+               power_spectra->NumCols() == half_N_ + 1);
+  MatrixIndexT num_frames = frames.NumRows();
+  for (MatrixIndexT r = 0; r < num_frames; r += kLanes) {
+    MatrixIndexT num_rows = std::min(kLanes, num_frames - r);
+    LoadBlock(frames, r, num_rows);
+    TransformBlock();
+    for (MatrixIndexT l = 0; l < num_rows; l++) {
+      Real *p = power_spectra->RowData(r + l);
+      p[0] = re_[l] * re_[l];
+      p[half_N_] = im_[l] * im_[l];
+      for (MatrixIndexT k = 1; k < half_N_; k++) {
+        Real x_re = re_[k * kLanes + l], x_im = im_[k * kLanes + l];
+        p[k] = x_re * x_re + x_im * x_im;
+      }
+    }
+  }
+}
+
+template class BatchedRealFft<float>;
+template class BatchedRealFft<double>;
+
+}  // namespace kaldi
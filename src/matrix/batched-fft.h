@@ -0,0 +1,99 @@
+// matrix/batched-fft.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_BATCHED_FFT_H_
+#define KALDI_MATRIX_BATCHED_FFT_H_
+
+#include <vector>
+
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+/// @addtogroup matrix_funcs_misc
+/// @{
+
+/*
+  BatchedRealFft does the forward FFT of many real sequences of the same
+  length at once, e.g. of all the windowed frames of an utterance in feature
+  extraction.  The rows of the input matrix are transformed 16 at a time, each
+  one in its own lane of the vectors (AVX-512 or AVX2 where the CPU has them,
+  see GetSimdLevel()), so every butterfly is done for 16 sequences with a few
+  vector instructions, and the twiddle factors are loaded once for all of them.
+  The result is the same as that of SplitRadixRealFft::Compute() for each
+  row, up to roundoff.
+
+  As for SplitRadixRealFft, in multi-threaded code you need one of these
+  objects per thread, because it has a workspace.
+*/
+template<typename Real>
+class BatchedRealFft {
+ public:
+  /// N is the number of real points in each sequence; it must be a power of
+  /// two and at least 4.  The constructor computes the tables, so it's best to
+  /// initialize the object once and use it many times.
+  explicit BatchedRealFft(MatrixIndexT N);
+
+  MatrixIndexT Dim() const { return N_; }
+
+  /// Does the forward FFT of each row of 'frames', which must have N columns,
+  /// in place.  Each row is set to the first half of the complex spectrum in
+  /// the format of SplitRadixRealFft::Compute(), i.e.
+  /// [real0, real_{N/2}, real1, im1, real2, im2, ...].
+  void Compute(MatrixBase<Real> *frames);
+
+  /// Sets each row of 'power_spectra', which must have N/2 + 1 columns, to
+  /// the power spectrum (the squared magnitudes of the FFT) of the
+  /// corresponding row of 'frames', without changing 'frames'.  This is the
+  /// same as Compute() followed by ComputePowerSpectrum() (see
+  /// ../feat/feature-functions.h) on each row, but the power spectrum is
+  /// computed while the FFT of each block of rows is still in the cache.
+  void ComputePowerSpectra(const MatrixBase<Real> &frames,
+                           MatrixBase<Real> *power_spectra);
+
+ private:
+  // Copies rows row_offset ... row_offset + num_rows - 1 of 'frames' (with
+  // num_rows <= 16) into re_ and im_, as the complex sequences of N/2 points
+  // whose real and imaginary parts are the even and odd elements, in
+  // bit-reversed order.
+  void LoadBlock(const MatrixBase<Real> &frames, MatrixIndexT row_offset,
+                 MatrixIndexT num_rows);
+
+  // Does the FFT of the block loaded by LoadBlock(); see the comment in the
+  // .cc file for the format of the output.
+  void TransformBlock();
+
+  MatrixIndexT N_;
+  MatrixIndexT half_N_;  // N_ / 2, the number of points of the complex FFT.
+  // bit_reverse_[n] is n with its log2(half_N_) bits reversed.
+  std::vector<MatrixIndexT> bit_reverse_;
+  // The real and imaginary parts of exp(-2 pi i t / half_N_), for
+  // t = 0 ... half_N_ / 2 - 1: the twiddle factors of the complex FFT.
+  std::vector<Real> twiddle_re_, twiddle_im_;
+  // The real and imaginary parts of exp(-2 pi i k / N_), for
+  // k = 0 ... half_N_ / 2: the factors that get the real FFT from the complex
+  // one.
+  std::vector<Real> post_re_, post_im_;
+  // The workspace: element n of the sequence in lane l is at n * 16 + l.
+  std::vector<Real> re_, im_;
+};
+
+/// @} end of "addtogroup matrix_funcs_misc"
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_BATCHED_FFT_H_
@@ -614,9 +614,18 @@ template<typename Real>
 void CompressedMatrix::CopyToMat(MatrixBase<Real> *mat,
                                  MatrixTransposeType trans) const {
   if (trans == kTrans) {
-    Matrix<Real> temp(this->NumCols(), this->NumRows());
-    CopyToMat(&temp, kNoTrans);
-    mat->CopyFromMat(temp, kTrans);
+    MatrixIndexT num_rows = NumRows(), num_cols = NumCols(),
+        block_rows = NumBlockRows();
+    KALDI_ASSERT(mat->NumRows() == num_cols && mat->NumCols() == num_rows);
+    if (num_rows == 0)
+      return;
+    Matrix<Real> block(block_rows, num_cols, kUndefined);
+    for (MatrixIndexT r = 0; r < num_rows; r += block_rows) {
+      MatrixIndexT n = std::min(block_rows, num_rows - r);
+      SubMatrix<Real> sub_block(block, 0, n, 0, num_cols);
+      CopyToMat(r, 0, &sub_block);
+      mat->ColRange(r, n).CopyFromMat(sub_block, kTrans);
+    }
     return;
   }
 
@@ -669,13 +678,49 @@ void CompressedMatrix::CopyToMat(MatrixBase<Real> *mat,
   }
 }
 
-// Instantiate the template for float and double.
+template<typename Real>
+void CompressedMatrix::AddToMat(Real alpha, MatrixBase<Real> *mat,
+                                MatrixTransposeType trans) const {
+  MatrixIndexT num_rows = NumRows(), num_cols = NumCols(),
+      block_rows = NumBlockRows();
+  if (trans == kNoTrans)
+    KALDI_ASSERT(mat->NumRows() == num_rows && mat->NumCols() == num_cols);
+  else
+    KALDI_ASSERT(mat->NumRows() == num_cols && mat->NumCols() == num_rows);
+  if (num_rows == 0)
+    return;
+  Matrix<Real> block(block_rows, num_cols, kUndefined);
+  for (MatrixIndexT r = 0; r < num_rows; r += block_rows) {
+    MatrixIndexT n = std::min(block_rows, num_rows - r);
+    SubMatrix<Real> sub_block(block, 0, n, 0, num_cols);
+    CopyToMat(r, 0, &sub_block);
+    if (trans == kNoTrans)
+      mat->RowRange(r, n).AddMat(alpha, sub_block);
+    else
+      mat->ColRange(r, n).AddMat(alpha, sub_block, kTrans);
+  }
+}
+
+MatrixIndexT CompressedMatrix::NumBlockRows() const {
+  MatrixIndexT num_rows = NumRows(), num_cols = NumCols();
+  if (num_rows == 0)
+    return 0;
+  return std::min(num_rows, std::max<MatrixIndexT>(128, 65536 / num_cols));
+}
+
+// Instantiate the templates for float and double.
 template
 void CompressedMatrix::CopyToMat(MatrixBase<float> *mat,
                                  MatrixTransposeType trans) const;
 template
 void CompressedMatrix::CopyToMat(MatrixBase<double> *mat,
                                  MatrixTransposeType trans) const;
+template
+void CompressedMatrix::AddToMat(float alpha, MatrixBase<float> *mat,
+                                MatrixTransposeType trans) const;
+template
+void CompressedMatrix::AddToMat(double alpha, MatrixBase<double> *mat,
+                                MatrixTransposeType trans) const;
 
 template<typename Real>
 void CompressedMatrix::CopyRowToVec(MatrixIndexT row,
@@ -133,11 +133,26 @@ class CompressedMatrix {
   CompressedMatrix &operator = (const MatrixBase<Real> &mat); // assignment operator.
 
   /// Copies contents to matrix.  Note: mat must have the correct size.
-  /// The kTrans case uses a temporary.
+  /// The kTrans case decompresses one block of rows at a time (see
+  /// NumBlockRows()) and transposes it from there.
   template<typename Real>
   void CopyToMat(MatrixBase<Real> *mat,
                  MatrixTransposeType trans = kNoTrans) const;
 
+  /// Does *mat += alpha * (*this) [or its transpose], decompressing one block
+  /// of rows at a time rather than into a full temporary matrix.
+  template<typename Real>
+  void AddToMat(Real alpha, MatrixBase<Real> *mat,
+                MatrixTransposeType trans = kNoTrans) const;
+
+  /// The number of rows that the code that works on a compressed matrix
+  /// without decompressing it in full (e.g. AddToMat(),
+  /// MatrixBase::AddCmatMat()) decompresses at a time: enough rows for about
+  /// 256KB of floats, which stays in cache, but at least 128 so that the
+  /// matrix multiplications on a block are efficient.  Never more than
+  /// NumRows(), and 0 for an empty matrix.
+  MatrixIndexT NumBlockRows() const;
+
   void Write(std::ostream &os, bool binary) const;
 
   void Read(std::istream &is, bool binary);
@@ -0,0 +1,144 @@
+// matrix/cpu-allocator-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "matrix/matrix-lib.h"
+
+namespace kaldi {
+
+static void UnitTestCpuAllocatorSizeClasses() {
+  for (int32 c = 1; c < CpuMemoryAllocator::kNumSizeClasses; c++) {
+    size_t prev = CpuMemoryAllocator::SizeOfClass(c - 1),
+        cur = CpuMemoryAllocator::SizeOfClass(c);
+    KALDI_ASSERT(cur > prev && cur <= prev + prev / 4 + 16 && cur % 16 == 0);
+  }
+}
+
+// Allocates blocks of random sizes, checks that they are aligned and don't
+// overlap, and that freeing them gives the memory back.
+static void UnitTestCpuAllocatorMalloc() {
+  CpuMemoryAllocator &allocator = CpuMemoryAllocator::Instantiate();
+  size_t allocated = allocator.GetAllocatedMemory();
+  std::vector<char*> blocks;
+  std::vector<size_t> sizes;
+  for (int32 i = 0; i < 100; i++) {
+    size_t size = RandInt(1, 1 << RandInt(1, 20));
+    char *block = static_cast<char*>(allocator.Malloc(size));
+    KALDI_ASSERT(reinterpret_cast<size_t>(block) % 64 == 0);
+    memset(block, i, size);
+    blocks.push_back(block);
+    sizes.push_back(size);
+  }
+  KALDI_ASSERT(allocator.GetAllocatedMemory() > allocated &&
+               allocator.GetMaxAllocatedMemory() >=
+               allocator.GetAllocatedMemory());
+  for (int32 i = 0; i < 100; i++) {
+    for (size_t j = 0; j < sizes[i]; j++)
+      KALDI_ASSERT(blocks[i][j] == static_cast<char>(i));
+    allocator.Free(blocks[i]);
+  }
+  KALDI_ASSERT(allocator.GetAllocatedMemory() == allocated);
+  allocator.Free(NULL);
+}
+
+// Without caching, the sizes should not be rounded up to the size classes.
+static void UnitTestCpuAllocatorNoCache() {
+  CpuMemoryAllocator &allocator = CpuMemoryAllocator::Instantiate();
+  g_cpu_allocator_options.cache_memory = false;
+  size_t allocated = allocator.GetAllocatedMemory();
+  size_t size = CpuMemoryAllocator::SizeOfClass(RandInt(1, 40)) + 1;
+  void *block = allocator.Malloc(size);
+  KALDI_ASSERT(allocator.GetAllocatedMemory() == allocated + size);
+  // Turning caching on before it is freed makes no difference.
+  g_cpu_allocator_options.cache_memory = true;
+  allocator.Free(block);
+  KALDI_ASSERT(allocator.GetAllocatedMemory() == allocated);
+}
+
+// Freed blocks should be reused, unless caching is turned off.
+static void UnitTestCpuAllocatorCache() {
+  CpuMemoryAllocator &allocator = CpuMemoryAllocator::Instantiate();
+  for (int32 cache = 0; cache < 2; cache++) {
+    g_cpu_allocator_options.cache_memory = (cache == 1);
+    Matrix<BaseFloat> m(RandInt(1, 100), RandInt(1, 100));
+    m.Resize(0, 0);
+    int64 num_hits = allocator.NumCacheHits();
+    int32 rows = RandInt(1, 100), cols = RandInt(1, 100);
+    Matrix<float> m2(rows, cols);
+    Vector<double> v(RandInt(1, 100));
+    m2.Resize(0, 0);
+    v.Resize(0);
+    Matrix<float> m3(rows, cols);
+    if (cache == 1)
+      KALDI_ASSERT(allocator.NumCacheHits() > num_hits);
+    else
+      KALDI_ASSERT(allocator.NumCacheHits() == num_hits);
+  }
+  g_cpu_allocator_options.cache_memory = true;
+  allocator.ReleaseCachedMemory();
+}
+
+// Matrices allocated in some threads and freed in others.
+static void UnitTestCpuAllocatorThreads() {
+  std::vector<Matrix<BaseFloat>*> matrices(200);
+  std::vector<std::thread> threads;
+  for (int32 t = 0; t < 4; t++) {
+    threads.push_back(std::thread([&matrices, t] {
+        for (int32 i = t; i < 200; i += 4) {
+          matrices[i] = new Matrix<BaseFloat>(RandInt(1, 50), RandInt(1, 50));
+          matrices[i]->Set(i);
+        }
+      }));
+  }
+  for (size_t t = 0; t < threads.size(); t++)
+    threads[t].join();
+  threads.clear();
+  for (int32 t = 0; t < 4; t++) {
+    threads.push_back(std::thread([&matrices, t] {
+        for (int32 i = 3 - t; i < 200; i += 4) {
+          KALDI_ASSERT((*matrices[i])(0, 0) == i);
+          delete matrices[i];
+          Vector<BaseFloat> v(RandInt(1, 1000));
+        }
+      }));
+  }
+  for (size_t t = 0; t < threads.size(); t++)
+    threads[t].join();
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  // Caching is off by default, but the programs that register the options
+  // turn it on.
+  KALDI_ASSERT(!g_cpu_allocator_options.cache_memory);
+  g_cpu_allocator_options.cache_memory = true;
+  UnitTestCpuAllocatorSizeClasses();
+  for (int32 i = 0; i < 5; i++) {
+    UnitTestCpuAllocatorMalloc();
+    UnitTestCpuAllocatorNoCache();
+    UnitTestCpuAllocatorCache();
+    UnitTestCpuAllocatorThreads();
+  }
+  CpuMemoryAllocator::Instantiate().PrintMemoryUsage();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,235 @@
+// matrix/cpu-allocator.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <new>
+
+#include "matrix/cpu-allocator.h"
+
+namespace kaldi {
+
+CpuAllocatorOptions g_cpu_allocator_options;
+
+// Each block starts with a header of this many bytes, which holds a
+// BlockHeader; the user gets the memory after it, which is then aligned like
+// the block.
+static const size_t kHeaderBytes = 64;
+
+struct BlockHeader {
+  int32 size_class;  // -1 for blocks too large to be cached.
+  size_t bytes;  // the size of the block, without the header.
+};
+
+// The maximum total size of the blocks in the cache of each thread.
+static const size_t kThreadCacheBytes = 16 << 20;
+
+// Returns the size class for 'bytes' > 0, or -1 if it is too large to be
+// cached.  Class 0 is up to 64 bytes; after that there are four classes for
+// each power of two, e.g. sizes 80, 96, 112 and 128 for 65 ... 128 bytes.
+static inline int32 GetSizeClass(size_t bytes) {
+  if (bytes <= 64)
+    return 0;
+  size_t b = bytes - 1;
+  int32 k = 0;  // the position of the highest bit of b.
+  while ((b >> k) > 1) k++;
+  int32 size_class = 1 + (k - 6) * 4 + static_cast<int32>((b >> (k - 2)) & 3);
+  return (size_class < CpuMemoryAllocator::kNumSizeClasses ? size_class : -1);
+}
+
+size_t CpuMemoryAllocator::SizeOfClass(int32 size_class) {
+  if (size_class == 0)
+    return 64;
+  int32 k = 6 + (size_class - 1) / 4, j = (size_class - 1) % 4;
+  return (static_cast<size_t>(1) << k) +
+      (j + 1) * (static_cast<size_t>(1) << (k - 2));
+}
+
+static inline BlockHeader *HeaderOfBlock(void *ptr) {
+  return reinterpret_cast<BlockHeader*>(static_cast<char*>(ptr) -
+                                        kHeaderBytes);
+}
+
+namespace {
+
+// The cache of a thread; it is returned to the shared cache when the thread
+// exits.
+struct ThreadCache {
+  std::vector<void*> free_blocks[CpuMemoryAllocator::kNumSizeClasses];
+  size_t cached_memory;
+  ThreadCache(): cached_memory(0) { }
+};
+
+// tls_cache is created on first use.  It is a plain pointer, which is still
+// valid to access while the thread's other thread_local objects are being
+// destroyed, so that matrices freed at that time don't use a cache that
+// doesn't exist any more; they go to the shared cache instead.
+thread_local ThreadCache *tls_cache = NULL;
+thread_local bool tls_cache_destroyed = false;
+
+struct ThreadCacheDeleter {
+  ~ThreadCacheDeleter() {
+    ThreadCache *cache = tls_cache;
+    tls_cache = NULL;
+    tls_cache_destroyed = true;
+    if (cache == NULL)
+      return;
+    CpuMemoryAllocator &allocator = CpuMemoryAllocator::Instantiate();
+    for (int32 c = 0; c < CpuMemoryAllocator::kNumSizeClasses; c++)
+      for (size_t i = 0; i < cache->free_blocks[c].size(); i++)
+        allocator.FreeShared(cache->free_blocks[c][i], c);
+    delete cache;
+  }
+};
+thread_local ThreadCacheDeleter tls_cache_deleter;
+
+inline ThreadCache *GetThreadCache() {
+  if (tls_cache == NULL && !tls_cache_destroyed) {
+    (void)&tls_cache_deleter;  // make sure it exists, so it will be destroyed.
+    tls_cache = new ThreadCache();
+  }
+  return tls_cache;
+}
+
+}  // namespace
+
+CpuMemoryAllocator &CpuMemoryAllocator::Instantiate() {
+  // This is never deleted, so it can still be used while the static objects
+  // (which may include matrices) are being destroyed.
+  static CpuMemoryAllocator *allocator = new CpuMemoryAllocator();
+  return *allocator;
+}
+
+CpuMemoryAllocator::CpuMemoryAllocator():
+    free_blocks_(kNumSizeClasses), cached_memory_(0), allocated_memory_(0),
+    max_allocated_memory_(0), num_allocations_(0), num_cache_hits_(0) { }
+
+void *CpuMemoryAllocator::SystemMalloc(size_t bytes, int32 size_class) {
+  void *block;
+  if (posix_memalign(&block, kHeaderBytes, kHeaderBytes + bytes) != 0)
+    throw std::bad_alloc();
+  void *ptr = static_cast<char*>(block) + kHeaderBytes;
+  HeaderOfBlock(ptr)->size_class = size_class;
+  HeaderOfBlock(ptr)->bytes = bytes;
+  return ptr;
+}
+
+void CpuMemoryAllocator::SystemFree(void *ptr) {
+  free(static_cast<char*>(ptr) - kHeaderBytes);
+}
+
+void *CpuMemoryAllocator::Malloc(size_t size) {
+  KALDI_ASSERT(size > 0);
+  num_allocations_++;
+  // Without caching, the size is not rounded up, and the block is freed as
+  // one too large to be cached, even if caching is turned on by then.
+  int32 size_class = (g_cpu_allocator_options.cache_memory ?
+                      GetSizeClass(size) : -1);
+  size_t bytes = (size_class >= 0 ? SizeOfClass(size_class) : size);
+  size_t allocated = (allocated_memory_ += bytes),
+      max_allocated = max_allocated_memory_;
+  while (allocated > max_allocated &&
+         !max_allocated_memory_.compare_exchange_weak(max_allocated,
+                                                      allocated));
+  if (size_class < 0)
+    return SystemMalloc(bytes, size_class);
+
+  ThreadCache *cache = GetThreadCache();
+  if (cache != NULL && !cache->free_blocks[size_class].empty()) {
+    void *ptr = cache->free_blocks[size_class].back();
+    cache->free_blocks[size_class].pop_back();
+    cache->cached_memory -= bytes;
+    num_cache_hits_++;
+    return ptr;
+  }
+  return MallocShared(size_class);
+}
+
+void *CpuMemoryAllocator::MallocShared(int32 size_class) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<void*> &blocks = free_blocks_[size_class];
+    if (!blocks.empty()) {
+      void *ptr = blocks.back();
+      blocks.pop_back();
+      cached_memory_ -= SizeOfClass(size_class);
+      num_cache_hits_++;
+      return ptr;
+    }
+  }
+  return SystemMalloc(SizeOfClass(size_class), size_class);
+}
+
+void CpuMemoryAllocator::Free(void *ptr) {
+  if (ptr == NULL)
+    return;
+  const BlockHeader *header = HeaderOfBlock(ptr);
+  int32 size_class = header->size_class;
+  size_t bytes = header->bytes;
+  allocated_memory_ -= bytes;
+  if (size_class < 0 || !g_cpu_allocator_options.cache_memory) {
+    SystemFree(ptr);
+    return;
+  }
+  ThreadCache *cache = GetThreadCache();
+  if (cache != NULL && cache->cached_memory + bytes <= kThreadCacheBytes) {
+    cache->free_blocks[size_class].push_back(ptr);
+    cache->cached_memory += bytes;
+    return;
+  }
+  FreeShared(ptr, size_class);
+}
+
+void CpuMemoryAllocator::FreeShared(void *ptr, int32 size_class) {
+  size_t bytes = SizeOfClass(size_class),
+      max_cached = static_cast<size_t>(g_cpu_allocator_options.max_cached_mb)
+      << 20;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cached_memory_ + bytes <= max_cached) {
+      free_blocks_[size_class].push_back(ptr);
+      cached_memory_ += bytes;
+      return;
+    }
+  }
+  SystemFree(ptr);
+}
+
+void CpuMemoryAllocator::ReleaseCachedMemory() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (int32 c = 0; c < kNumSizeClasses; c++) {
+    for (size_t i = 0; i < free_blocks_[c].size(); i++)
+      SystemFree(free_blocks_[c][i]);
+    free_blocks_[c].clear();
+  }
+  cached_memory_ = 0;
+}
+
+void CpuMemoryAllocator::PrintMemoryUsage() const {
+  int64 num_allocations = num_allocations_, num_hits = num_cache_hits_;
+  size_t cached_memory;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cached_memory = cached_memory_;
+  }
+  KALDI_LOG << "CPU matrix memory: " << num_allocations << " allocations, "
+            << (num_allocations == 0 ? 0.0 :
+                100.0 * num_hits / num_allocations)
+            << "% from the cache; current/maximum allocated "
+            << GetAllocatedMemory() << "/" << GetMaxAllocatedMemory()
+            << " bytes; " << cached_memory << " bytes in the shared cache.";
+}
+
+}  // namespace kaldi
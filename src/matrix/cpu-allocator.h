@@ -0,0 +1,155 @@
+// matrix/cpu-allocator.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_CPU_ALLOCATOR_H_
+#define KALDI_MATRIX_CPU_ALLOCATOR_H_
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+
+namespace kaldi {
+
+/// Options for CpuMemoryAllocator; c.f. CuAllocatorOptions.  They may be
+/// changed at any time, and take effect for the following allocations.
+struct CpuAllocatorOptions {
+  // True if freed blocks are kept for reuse.  This is off by default, as the
+  // cache keeps up to max_cached_mb plus a little per thread even when the
+  // program doesn't need it any more; see RegisterCpuAllocatorOptions().
+  bool cache_memory;
+
+  // The maximum amount of memory, in megabytes, that is kept in the cache
+  // shared by all threads (each thread also keeps a small cache of its own).
+  int32 max_cached_mb;
+
+  CpuAllocatorOptions(): cache_memory(false), max_cached_mb(256) { }
+
+  void Register(OptionsItf *po) {
+    po->Register("cpu-cache-memory", &cache_memory, "True if you want to "
+                 "reuse the memory of freed CPU matrices and vectors.  Set "
+                 "this to false to give the memory back to the system as "
+                 "soon as it is freed, or to look for memory errors, e.g. "
+                 "with valgrind.");
+    po->Register("cpu-max-cached-mb", &max_cached_mb, "Maximum amount of "
+                 "freed CPU matrix and vector memory, in megabytes, to keep "
+                 "for reuse");
+  }
+};
+
+extern CpuAllocatorOptions g_cpu_allocator_options;
+
+/// Registers the options and turns caching on by default.  Programs that
+/// allocate and free the same matrices over and over, like nnet3-train and
+/// nnet3-compute, call this; in the others caching stays off unless they set
+/// g_cpu_allocator_options.cache_memory.
+inline void RegisterCpuAllocatorOptions(OptionsItf *po) {
+  g_cpu_allocator_options.cache_memory = true;
+  g_cpu_allocator_options.Register(po);
+}
+
+
+/**
+   This class provides the memory of the CPU matrices and vectors (Matrix,
+   Vector, and CuMatrix and CuVector when not using a GPU).  It is for the CPU
+   what CuMemoryAllocator is for the GPU: the code that repeatedly allocates
+   and frees matrices of the same sizes, like NnetComputer, which frees all
+   its temporary matrices at the end of each computation, doesn't have to call
+   posix_memalign() and free() each time, or zero new pages.
+
+   The sizes are rounded up to one of a few size classes (four per power of
+   two, so at most 25% is wasted) and freed blocks are kept in a list per size
+   class: first in a small cache that belongs to the thread, which needs no
+   locking, and when that is full in a cache shared by all the threads, up to
+   CpuAllocatorOptions::max_cached_mb; when a thread exits, its cache goes to
+   the shared one, within the same limit.  Blocks are aligned to 64 bytes.
+   If CpuAllocatorOptions::cache_memory is false, which is the default for
+   programs that don't call RegisterCpuAllocatorOptions(), Malloc() and Free()
+   just call the system, for exactly the size asked for (plus the header that
+   Free() needs).
+*/
+class CpuMemoryAllocator {
+ public:
+  static CpuMemoryAllocator &Instantiate();
+
+  /// Returns a block of at least 'size' bytes (size > 0) aligned to 64 bytes;
+  /// throws std::bad_alloc if the memory can't be allocated.
+  void *Malloc(size_t size);
+
+  /// Frees memory returned by Malloc().  NULL is allowed.
+  void Free(void *ptr);
+
+  /// Frees the memory in the shared cache (not in the threads' caches).
+  void ReleaseCachedMemory();
+
+  /// Prints the statistics: the number of allocations, the proportion that
+  /// came from the cache, and the current and maximum amount of memory
+  /// allocated.
+  void PrintMemoryUsage() const;
+
+  /// Returns the amount of memory currently allocated (after rounding to the
+  /// size classes, for the blocks allocated with caching on).
+  size_t GetAllocatedMemory() const { return allocated_memory_; }
+
+  /// Returns the maximum of GetAllocatedMemory() so far.
+  size_t GetMaxAllocatedMemory() const { return max_allocated_memory_; }
+
+  /// Returns the number of calls to Malloc() and how many of them were served
+  /// from the cache.
+  int64 NumAllocations() const { return num_allocations_; }
+  int64 NumCacheHits() const { return num_cache_hits_; }
+
+  // The rest of the public interface is for the thread caches, which are
+  // defined in the .cc file.
+
+  // The number of size classes; larger blocks (over 256MB) are not cached.
+  static const int32 kNumSizeClasses = 89;
+  static size_t SizeOfClass(int32 size_class);
+  // Puts a free block in the shared cache (or frees it if the cache is full).
+  void FreeShared(void *ptr, int32 size_class);
+
+ private:
+  CpuMemoryAllocator();
+
+  // Allocates and frees memory from the system, with the header that
+  // records the size class.
+  static void *SystemMalloc(size_t bytes, int32 size_class);
+  static void SystemFree(void *ptr);
+
+  // Called when the thread cache doesn't have a block of this size class.
+  void *MallocShared(int32 size_class);
+
+  mutable std::mutex mutex_;
+  // The shared cache: free_blocks_[c] contains the free blocks of size class
+  // c; cached_memory_ is their total size.
+  std::vector<std::vector<void*> > free_blocks_;
+  size_t cached_memory_;
+
+  std::atomic<size_t> allocated_memory_;
+  std::atomic<size_t> max_allocated_memory_;
+  std::atomic<int64> num_allocations_;
+  std::atomic<int64> num_cache_hits_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CpuMemoryAllocator);
+};
+
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_CPU_ALLOCATOR_H_
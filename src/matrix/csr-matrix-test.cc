@@ -0,0 +1,169 @@
+// matrix/csr-matrix-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "matrix/matrix-lib.h"
+
+namespace kaldi {
+
+template <typename Real>
+static void UnitTestCsrMatrixCopy() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT num_rows = RandInt(1, 20), num_cols = RandInt(1, 30);
+    SparseMatrix<Real> smat(num_rows, num_cols);
+    smat.SetRandn(0.8);
+    Matrix<Real> mat(num_rows, num_cols);
+    smat.CopyToMat(&mat);
+
+    CsrMatrix<Real> csr(smat);
+    KALDI_ASSERT(csr.NumRows() == num_rows && csr.NumCols() == num_cols &&
+                 csr.NumElements() == smat.NumElements());
+    Matrix<Real> mat2(num_rows, num_cols);
+    csr.CopyToMat(&mat2);
+    AssertEqual(mat, mat2);
+
+    // The transpose, from each kind of matrix.
+    Matrix<Real> mat_trans(mat, kTrans), mat3(num_cols, num_rows);
+    CsrMatrix<Real> csr_trans(smat, kTrans);
+    csr_trans.CopyToMat(&mat3);
+    AssertEqual(mat_trans, mat3);
+    CsrMatrix<Real> csr2;
+    csr2.CopyFromMat(mat, kTrans);
+    csr2.CopyToMat(&mat3);
+    AssertEqual(mat_trans, mat3);
+    csr2.CopyFromCsr(csr, kTrans);
+    csr2.CopyToMat(&mat3);
+    AssertEqual(mat_trans, mat3);
+    csr2.CopyToMat(&mat2, kTrans);
+    AssertEqual(mat, mat2);
+    csr2.CopyFromCsr(csr2, kTrans);
+    csr2.CopyToMat(&mat2);
+    AssertEqual(mat, mat2);
+
+    SparseMatrix<Real> smat2;
+    csr.CopyToSmat(&smat2);
+    Matrix<Real> mat4(num_rows, num_cols);
+    smat2.CopyToMat(&mat4);
+    AssertEqual(mat, mat4);
+
+    Matrix<BaseFloat> fmat(mat);
+    GeneralMatrix gmat(fmat);
+    if (i % 3 == 0) gmat.Compress();
+    else if (i % 3 == 1) gmat = SparseMatrix<BaseFloat>(fmat);
+    CsrMatrix<Real> csr3;
+    csr3.CopyFromGeneralMatrix(gmat);
+    Matrix<BaseFloat> gmat_mat;
+    gmat.GetMatrix(&gmat_mat);
+    csr3.CopyToMat(&mat2);
+    AssertEqual(Matrix<Real>(gmat_mat), mat2);
+
+    csr3.Swap(&csr);
+    KALDI_ASSERT(csr3.NumElements() == smat.NumElements());
+    csr3.Clear();
+    KALDI_ASSERT(csr3.NumRows() == 0 && csr3.NumElements() == 0);
+  }
+}
+
+template <typename Real>
+static void UnitTestAddCsrMat() {
+  for (int32 i = 0; i < 20; i++) {
+    MatrixTransposeType transA = (i % 2 == 0 ? kNoTrans : kTrans);
+    MatrixIndexT m = RandInt(1, 20), k = RandInt(1, 30), n = RandInt(1, 150);
+    SparseMatrix<Real> smat(transA == kNoTrans ? m : k,
+                            transA == kNoTrans ? k : m);
+    smat.SetRandn(0.7);
+    Matrix<Real> A(smat.NumRows(), smat.NumCols()), B(k, n), C(m, n);
+    smat.CopyToMat(&A);
+    B.SetRandn();
+    C.SetRandn();
+    Real alpha = RandGauss(), beta = (i % 3 == 0 ? 0.0 : RandGauss());
+    Matrix<Real> C2(C), C3(C);
+    if (beta == 0.0)
+      C2.Set(std::numeric_limits<Real>::quiet_NaN());  // must be ignored.
+    AddCsrMat(alpha, CsrMatrix<Real>(smat), transA, B, beta, &C2);
+    C3.AddSmatMat(alpha, smat, transA, B, beta);
+    C.AddMatMat(alpha, A, transA, B, kNoTrans, beta);
+    AssertEqual(C, C2);
+    AssertEqual(C, C3);
+  }
+}
+
+template <typename Real>
+static void UnitTestAddMatCsr() {
+  for (int32 i = 0; i < 20; i++) {
+    MatrixTransposeType transB = (i % 2 == 0 ? kNoTrans : kTrans);
+    MatrixIndexT m = RandInt(1, 20), k = RandInt(1, 60), n = RandInt(1, 40);
+    SparseMatrix<Real> smat(transB == kNoTrans ? k : n,
+                            transB == kNoTrans ? n : k);
+    smat.SetRandn(i % 4 < 2 ? 0.2 : 0.9);
+    Matrix<Real> A(m, k), B(smat.NumRows(), smat.NumCols()), C(m, n);
+    smat.CopyToMat(&B);
+    A.SetRandn();
+    C.SetRandn();
+    Real alpha = RandGauss(), beta = (i % 3 == 0 ? 0.0 : RandGauss());
+    Matrix<Real> C2(C), C3(C);
+    if (beta == 0.0)
+      C2.Set(std::numeric_limits<Real>::quiet_NaN());
+    AddMatCsr(alpha, A, CsrMatrix<Real>(smat), transB, beta, &C2);
+    C3.AddMatSmat(alpha, A, smat, transB, beta);
+    C.AddMatMat(alpha, A, kNoTrans, B, transB, beta);
+    AssertEqual(C, C2);
+    AssertEqual(C, C3);
+  }
+}
+
+// All instruction sets should give the same result, up to roundoff.
+static void UnitTestCsrKernels() {
+  SimdLevel cpu_level = (SetSimdLevel(kSimdAvx512), GetSimdLevel());
+  MatrixIndexT m = RandInt(1, 20), k = RandInt(1, 100), n = RandInt(1, 200);
+  SparseMatrix<float> smat(m, k);
+  smat.SetRandn(0.5);
+  Matrix<float> A(n, k), B(k, n), C(m, n), D(n, m);
+  A.SetRandn();
+  B.SetRandn();
+  CsrMatrix<float> csr(smat);
+  SetSimdLevel(kSimdNone);
+  AddCsrMat(1.0f, csr, kNoTrans, B, 0.0f, &C);
+  AddMatCsr(1.0f, A, csr, kTrans, 0.0f, &D);
+  for (int32 level = kSimdAvx2; level <= cpu_level; level++) {
+    SetSimdLevel(static_cast<SimdLevel>(level));
+    Matrix<float> C2(m, n), D2(n, m);
+    AddCsrMat(1.0f, csr, kNoTrans, B, 0.0f, &C2);
+    AddMatCsr(1.0f, A, csr, kTrans, 0.0f, &D2);
+    AssertEqual(C, C2);
+    AssertEqual(D, D2);
+  }
+  SetSimdLevel(cpu_level);
+}
+
+template <typename Real>
+static void CsrMatrixUnitTest() {
+  UnitTestCsrMatrixCopy<Real>();
+  UnitTestAddCsrMat<Real>();
+  UnitTestAddMatCsr<Real>();
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::SetVerboseLevel(5);
+  kaldi::CsrMatrixUnitTest<float>();
+  kaldi::CsrMatrixUnitTest<double>();
+  for (kaldi::int32 i = 0; i < 5; i++)
+    kaldi::UnitTestCsrKernels();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,630 @@
+// matrix/csr-matrix.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "matrix/csr-matrix.h"
+#include "matrix/cblas-wrappers.h"
+#include "matrix/simd-math.h"
+
+// As in simd-math.cc, the vectorized kernels are compiled with the target
+// options for just those functions.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KALDI_CSR_MATRIX_X86 1
+#include <immintrin.h>
+#endif
+
+namespace kaldi {
+
+template <typename Real>
+void CsrMatrix<Real>::Init(MatrixIndexT num_cols,
+                           const std::vector<int32> &row_sizes) {
+  num_rows_ = row_sizes.size();
+  num_cols_ = num_cols;
+  row_offsets_.resize(num_rows_ + 1);
+  row_offsets_[0] = 0;
+  for (MatrixIndexT r = 0; r < num_rows_; r++)
+    row_offsets_[r + 1] = row_offsets_[r] + row_sizes[r];
+  col_indexes_.resize(row_offsets_.back());
+  values_.resize(row_offsets_.back());
+}
+
+template <typename Real>
+template <typename OtherReal>
+void CsrMatrix<Real>::CopyFromSmat(const SparseMatrix<OtherReal> &smat,
+                                   MatrixTransposeType trans) {
+  MatrixIndexT num_rows = smat.NumRows(), num_cols = smat.NumCols();
+  if (trans == kNoTrans) {
+    std::vector<int32> row_sizes(num_rows);
+    for (MatrixIndexT r = 0; r < num_rows; r++)
+      row_sizes[r] = smat.Row(r).NumElements();
+    Init(num_cols, row_sizes);
+    int32 i = 0;
+    for (MatrixIndexT r = 0; r < num_rows; r++) {
+      const SparseVector<OtherReal> &row = smat.Row(r);
+      for (MatrixIndexT e = 0; e < row.NumElements(); e++, i++) {
+        const std::pair<MatrixIndexT, OtherReal> &p = row.GetElement(e);
+        col_indexes_[i] = p.first;
+        values_[i] = p.second;
+      }
+    }
+  } else {
+    // Row c of the transpose has the elements of column c, in the order of
+    // the rows.
+    std::vector<int32> row_sizes(num_cols, 0);
+    for (MatrixIndexT r = 0; r < num_rows; r++) {
+      const SparseVector<OtherReal> &row = smat.Row(r);
+      for (MatrixIndexT e = 0; e < row.NumElements(); e++)
+        row_sizes[row.GetElement(e).first]++;
+    }
+    Init(num_rows, row_sizes);
+    std::vector<int32> next(row_offsets_.begin(), row_offsets_.end() - 1);
+    for (MatrixIndexT r = 0; r < num_rows; r++) {
+      const SparseVector<OtherReal> &row = smat.Row(r);
+      for (MatrixIndexT e = 0; e < row.NumElements(); e++) {
+        const std::pair<MatrixIndexT, OtherReal> &p = row.GetElement(e);
+        int32 i = next[p.first]++;
+        col_indexes_[i] = r;
+        values_[i] = p.second;
+      }
+    }
+  }
+}
+
+template <typename Real>
+template <typename OtherReal>
+void CsrMatrix<Real>::CopyFromMat(const MatrixBase<OtherReal> &mat,
+                                  MatrixTransposeType trans) {
+  MatrixIndexT num_rows = mat.NumRows(), num_cols = mat.NumCols();
+  if (trans == kNoTrans) {
+    std::vector<int32> row_sizes(num_rows, 0);
+    for (MatrixIndexT r = 0; r < num_rows; r++) {
+      const OtherReal *row_data = mat.RowData(r);
+      for (MatrixIndexT c = 0; c < num_cols; c++)
+        if (row_data[c] != 0.0) row_sizes[r]++;
+    }
+    Init(num_cols, row_sizes);
+    int32 i = 0;
+    for (MatrixIndexT r = 0; r < num_rows; r++) {
+      const OtherReal *row_data = mat.RowData(r);
+      for (MatrixIndexT c = 0; c < num_cols; c++) {
+        if (row_data[c] != 0.0) {
+          col_indexes_[i] = c;
+          values_[i++] = row_data[c];
+        }
+      }
+    }
+  } else {
+    std::vector<int32> row_sizes(num_cols, 0);
+    for (MatrixIndexT r = 0; r < num_rows; r++) {
+      const OtherReal *row_data = mat.RowData(r);
+      for (MatrixIndexT c = 0; c < num_cols; c++)
+        if (row_data[c] != 0.0) row_sizes[c]++;
+    }
+    Init(num_rows, row_sizes);
+    std::vector<int32> next(row_offsets_.begin(), row_offsets_.end() - 1);
+    for (MatrixIndexT r = 0; r < num_rows; r++) {
+      const OtherReal *row_data = mat.RowData(r);
+      for (MatrixIndexT c = 0; c < num_cols; c++) {
+        if (row_data[c] != 0.0) {
+          int32 i = next[c]++;
+          col_indexes_[i] = r;
+          values_[i] = row_data[c];
+        }
+      }
+    }
+  }
+}
+
+template <typename Real>
+void CsrMatrix<Real>::CopyFromGeneralMatrix(const GeneralMatrix &gmat,
+                                            MatrixTransposeType trans) {
+  switch (gmat.Type()) {
+    case kSparseMatrix:
+      CopyFromSmat(gmat.GetSparseMatrix(), trans);
+      break;
+    case kFullMatrix:
+      CopyFromMat(gmat.GetFullMatrix(), trans);
+      break;
+    case kCompressedMatrix: {
+      Matrix<BaseFloat> mat;
+      gmat.GetMatrix(&mat);
+      CopyFromMat(mat, trans);
+      break;
+    }
+    default:
+      KALDI_ERR << "Bad matrix type.";
+  }
+}
+
+template <typename Real>
+void CsrMatrix<Real>::CopyFromCsr(const CsrMatrix<Real> &other,
+                                  MatrixTransposeType trans) {
+  if (trans == kNoTrans) {
+    if (this != &other)
+      *this = other;
+    return;
+  }
+  if (this == &other) {
+    CsrMatrix<Real> tmp(other);
+    CopyFromCsr(tmp, trans);
+    return;
+  }
+  std::vector<int32> row_sizes(other.num_cols_, 0);
+  for (size_t i = 0; i < other.col_indexes_.size(); i++)
+    row_sizes[other.col_indexes_[i]]++;
+  Init(other.num_rows_, row_sizes);
+  std::vector<int32> next(row_offsets_.begin(), row_offsets_.end() - 1);
+  for (MatrixIndexT r = 0; r < other.num_rows_; r++) {
+    for (int32 e = other.row_offsets_[r]; e < other.row_offsets_[r + 1];
+         e++) {
+      int32 i = next[other.col_indexes_[e]]++;
+      col_indexes_[i] = r;
+      values_[i] = other.values_[e];
+    }
+  }
+}
+
+template <typename Real>
+template <typename OtherReal>
+void CsrMatrix<Real>::CopyToSmat(SparseMatrix<OtherReal> *smat) const {
+  smat->Resize(num_rows_, num_cols_);
+  std::vector<std::pair<MatrixIndexT, OtherReal> > pairs;
+  for (MatrixIndexT r = 0; r < num_rows_; r++) {
+    pairs.clear();
+    for (int32 e = row_offsets_[r]; e < row_offsets_[r + 1]; e++)
+      pairs.push_back(std::make_pair(static_cast<MatrixIndexT>(
+          col_indexes_[e]), static_cast<OtherReal>(values_[e])));
+    smat->SetRow(r, SparseVector<OtherReal>(num_cols_, pairs));
+  }
+}
+
+template <typename Real>
+template <typename OtherReal>
+void CsrMatrix<Real>::CopyToMat(MatrixBase<OtherReal> *mat,
+                                MatrixTransposeType trans) const {
+  if (trans == kNoTrans) {
+    KALDI_ASSERT(mat->NumRows() == num_rows_ && mat->NumCols() == num_cols_);
+    mat->SetZero();
+    for (MatrixIndexT r = 0; r < num_rows_; r++) {
+      OtherReal *row_data = mat->RowData(r);
+      for (int32 e = row_offsets_[r]; e < row_offsets_[r + 1]; e++)
+        row_data[col_indexes_[e]] = values_[e];
+    }
+  } else {
+    KALDI_ASSERT(mat->NumRows() == num_cols_ && mat->NumCols() == num_rows_);
+    mat->SetZero();
+    for (MatrixIndexT r = 0; r < num_rows_; r++)
+      for (int32 e = row_offsets_[r]; e < row_offsets_[r + 1]; e++)
+        (*mat)(col_indexes_[e], r) = values_[e];
+  }
+}
+
+template <typename Real>
+void CsrMatrix<Real>::Swap(CsrMatrix<Real> *other) {
+  std::swap(num_rows_, other->num_rows_);
+  std::swap(num_cols_, other->num_cols_);
+  row_offsets_.swap(other->row_offsets_);
+  col_indexes_.swap(other->col_indexes_);
+  values_.swap(other->values_);
+}
+
+template <typename Real>
+void CsrMatrix<Real>::Clear() {
+  num_rows_ = 0;
+  num_cols_ = 0;
+  row_offsets_.assign(1, 0);
+  col_indexes_.clear();
+  values_.clear();
+}
+
+
+// The kernels.  A "row kernel" sets the row c (of dimension 'dim') of the
+// product of a CSR matrix and B to beta * c + alpha * (the sum of the rows
+// cols[e] of B times vals[e], for e < n).  A "dot kernel" sets c[j], for
+// each row j of a block of rows of a CSR matrix, to beta * c[j] + alpha *
+// (the dot product of row j with the dense vector a); 'offsets' are the row
+// offsets of the block, so its row j has the elements offsets[j] ...
+// offsets[j + 1] - 1 of 'cols' and 'vals'.
+
+typedef void (*CsrRowKernel)(const int32 *cols, const float *vals, int32 n,
+                             const float *b, MatrixIndexT b_stride,
+                             MatrixIndexT dim, float alpha, float beta,
+                             float *c);
+
+typedef void (*CsrDotKernel)(const int32 *offsets, MatrixIndexT num_rows,
+                             const int32 *cols, const float *vals,
+                             const float *a, float alpha, float beta,
+                             float *c);
+
+template <typename Real>
+static void CsrRowGeneric(const int32 *cols, const Real *vals, int32 n,
+                          const Real *b, MatrixIndexT b_stride,
+                          MatrixIndexT dim, Real alpha, Real beta, Real *c) {
+  if (beta == 0.0)
+    std::fill(c, c + dim, Real(0.0));
+  else if (beta != 1.0)
+    cblas_Xscal(dim, beta, c, 1);
+  for (int32 e = 0; e < n; e++)
+    cblas_Xaxpy(dim, alpha * vals[e],
+                b + static_cast<size_t>(cols[e]) * b_stride, 1, c, 1);
+}
+
+template <typename Real>
+static void CsrDotGeneric(const int32 *offsets, MatrixIndexT num_rows,
+                          const int32 *cols, const Real *vals,
+                          const Real *a, Real alpha, Real beta, Real *c) {
+  for (MatrixIndexT j = 0; j < num_rows; j++) {
+    Real sum = 0.0;
+    for (int32 e = offsets[j]; e < offsets[j + 1]; e++)
+      sum += vals[e] * a[cols[e]];
+    c[j] = (beta == 0.0 ? alpha * sum : beta * c[j] + alpha * sum);
+  }
+}
+
+#ifdef KALDI_CSR_MATRIX_X86
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+static inline __m256 CombineAvx2(__m256 acc, float alpha, float beta,
+                                 const float *c) {
+  __m256 ans = _mm256_mul_ps(_mm256_set1_ps(alpha), acc);
+  if (beta != 0.0f)
+    ans = _mm256_fmadd_ps(_mm256_set1_ps(beta), _mm256_loadu_ps(c), ans);
+  return ans;
+}
+
+static void CsrRowAvx2(const int32 *cols, const float *vals, int32 n,
+                       const float *b, MatrixIndexT b_stride,
+                       MatrixIndexT dim, float alpha, float beta, float *c) {
+  MatrixIndexT j = 0;
+  // Blocks of 32 columns are summed in four registers.
+  for (; j + 32 <= dim; j += 32) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+    for (int32 e = 0; e < n; e++) {
+      const float *b_row = b + static_cast<size_t>(cols[e]) * b_stride + j;
+      __m256 v = _mm256_set1_ps(vals[e]);
+      acc0 = _mm256_fmadd_ps(v, _mm256_loadu_ps(b_row), acc0);
+      acc1 = _mm256_fmadd_ps(v, _mm256_loadu_ps(b_row + 8), acc1);
+      acc2 = _mm256_fmadd_ps(v, _mm256_loadu_ps(b_row + 16), acc2);
+      acc3 = _mm256_fmadd_ps(v, _mm256_loadu_ps(b_row + 24), acc3);
+    }
+    _mm256_storeu_ps(c + j, CombineAvx2(acc0, alpha, beta, c + j));
+    _mm256_storeu_ps(c + j + 8, CombineAvx2(acc1, alpha, beta, c + j + 8));
+    _mm256_storeu_ps(c + j + 16, CombineAvx2(acc2, alpha, beta, c + j + 16));
+    _mm256_storeu_ps(c + j + 24, CombineAvx2(acc3, alpha, beta, c + j + 24));
+  }
+  for (; j < dim; j += 8) {
+    // The last block may be partial; it is loaded and stored with a mask.
+    __m256i mask = _mm256_cmpgt_epi32(
+        _mm256_set1_epi32(dim - j),
+        _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256 acc = _mm256_setzero_ps();
+    for (int32 e = 0; e < n; e++) {
+      const float *b_row = b + static_cast<size_t>(cols[e]) * b_stride + j;
+      acc = _mm256_fmadd_ps(_mm256_set1_ps(vals[e]),
+                            _mm256_maskload_ps(b_row, mask), acc);
+    }
+    __m256 ans = _mm256_mul_ps(_mm256_set1_ps(alpha), acc);
+    if (beta != 0.0f)
+      ans = _mm256_fmadd_ps(_mm256_set1_ps(beta),
+                            _mm256_maskload_ps(c + j, mask), ans);
+    _mm256_maskstore_ps(c + j, mask, ans);
+  }
+  _mm256_zeroupper();  // See ApplyKernel() in simd-math-inl.h.
+}
+
+static void CsrDotAvx2(const int32 *offsets, MatrixIndexT num_rows,
+                       const int32 *cols, const float *vals,
+                       const float *a, float alpha, float beta, float *c) {
+  for (MatrixIndexT j = 0; j < num_rows; j++) {
+    int32 e = offsets[j], end = offsets[j + 1];
+    float sum = 0.0f;
+    if (end - e >= 8) {
+      __m256 acc = _mm256_setzero_ps();
+      for (; e + 8 <= end; e += 8) {
+        __m256i idx = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(cols + e));
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(vals + e),
+                              _mm256_i32gather_ps(a, idx, 4), acc);
+      }
+      __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc),
+                            _mm256_extractf128_ps(acc, 1));
+      s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+      s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+      sum = _mm_cvtss_f32(s);
+    }
+    for (; e < end; e++)
+      sum += vals[e] * a[cols[e]];
+    c[j] = (beta == 0.0f ? alpha * sum : beta * c[j] + alpha * sum);
+  }
+  _mm256_zeroupper();
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+// See simd-math.cc.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+static inline __m512 CombineAvx512(__m512 acc, float alpha, float beta,
+                                   __mmask16 mask, const float *c) {
+  __m512 ans = _mm512_mul_ps(_mm512_set1_ps(alpha), acc);
+  if (beta != 0.0f)
+    ans = _mm512_fmadd_ps(_mm512_set1_ps(beta),
+                          _mm512_maskz_loadu_ps(mask, c), ans);
+  return ans;
+}
+
+static void CsrRowAvx512(const int32 *cols, const float *vals, int32 n,
+                         const float *b, MatrixIndexT b_stride,
+                         MatrixIndexT dim, float alpha, float beta,
+                         float *c) {
+  const __mmask16 all = 0xffff;
+  MatrixIndexT j = 0;
+  // Blocks of 64 columns are summed in four registers.
+  for (; j + 64 <= dim; j += 64) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+    for (int32 e = 0; e < n; e++) {
+      const float *b_row = b + static_cast<size_t>(cols[e]) * b_stride + j;
+      __m512 v = _mm512_set1_ps(vals[e]);
+      acc0 = _mm512_fmadd_ps(v, _mm512_loadu_ps(b_row), acc0);
+      acc1 = _mm512_fmadd_ps(v, _mm512_loadu_ps(b_row + 16), acc1);
+      acc2 = _mm512_fmadd_ps(v, _mm512_loadu_ps(b_row + 32), acc2);
+      acc3 = _mm512_fmadd_ps(v, _mm512_loadu_ps(b_row + 48), acc3);
+    }
+    _mm512_storeu_ps(c + j, CombineAvx512(acc0, alpha, beta, all, c + j));
+    _mm512_storeu_ps(c + j + 16,
+                     CombineAvx512(acc1, alpha, beta, all, c + j + 16));
+    _mm512_storeu_ps(c + j + 32,
+                     CombineAvx512(acc2, alpha, beta, all, c + j + 32));
+    _mm512_storeu_ps(c + j + 48,
+                     CombineAvx512(acc3, alpha, beta, all, c + j + 48));
+  }
+  for (; j < dim; j += 16) {
+    __mmask16 mask = (dim - j >= 16 ? all :
+                      static_cast<__mmask16>((1 << (dim - j)) - 1));
+    __m512 acc = _mm512_setzero_ps();
+    for (int32 e = 0; e < n; e++) {
+      const float *b_row = b + static_cast<size_t>(cols[e]) * b_stride + j;
+      acc = _mm512_fmadd_ps(_mm512_set1_ps(vals[e]),
+                            _mm512_maskz_loadu_ps(mask, b_row), acc);
+    }
+    _mm512_mask_storeu_ps(c + j, mask,
+                          CombineAvx512(acc, alpha, beta, mask, c + j));
+  }
+  _mm256_zeroupper();
+}
+
+static void CsrDotAvx512(const int32 *offsets, MatrixIndexT num_rows,
+                         const int32 *cols, const float *vals,
+                         const float *a, float alpha, float beta, float *c) {
+  for (MatrixIndexT j = 0; j < num_rows; j++) {
+    int32 e = offsets[j], end = offsets[j + 1];
+    float sum;
+    if (end - e >= 8) {
+      __m512 acc = _mm512_setzero_ps();
+      for (; e < end; e += 16) {
+        __mmask16 mask = (end - e >= 16 ? 0xffff :
+                          static_cast<__mmask16>((1 << (end - e)) - 1));
+        __m512i idx = _mm512_maskz_loadu_epi32(mask, cols + e);
+        __m512 g = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, idx,
+                                            a, 4);
+        acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, vals + e), g, acc);
+      }
+      sum = _mm512_reduce_add_ps(acc);
+    } else {
+      sum = 0.0f;
+      for (; e < end; e++)
+        sum += vals[e] * a[cols[e]];
+    }
+    c[j] = (beta == 0.0f ? alpha * sum : beta * c[j] + alpha * sum);
+  }
+  _mm256_zeroupper();
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+#endif  // KALDI_CSR_MATRIX_X86
+
+// These set the kernels for the CPU and return true, or return false if
+// there are no vectorized kernels for it (or for Real == double).
+static bool GetCsrKernels(CsrRowKernel *row_kernel,
+                          CsrDotKernel *dot_kernel) {
+#ifdef KALDI_CSR_MATRIX_X86
+  SimdLevel level = GetSimdLevel();
+  if (level == kSimdAvx512) {
+    *row_kernel = CsrRowAvx512;
+    *dot_kernel = CsrDotAvx512;
+    return true;
+  } else if (level == kSimdAvx2) {
+    *row_kernel = CsrRowAvx2;
+    *dot_kernel = CsrDotAvx2;
+    return true;
+  }
+#endif
+  return false;
+}
+
+static void AddCsrMatRows(float alpha, const CsrMatrix<float> &A,
+                          const MatrixBase<float> &B, float beta,
+                          MatrixBase<float> *C) {
+  const int32 *offsets = A.RowOffsets(), *cols = A.ColIndexes();
+  const float *vals = A.Values(), *b = B.Data();
+  MatrixIndexT b_stride = B.Stride(), dim = C->NumCols();
+  CsrRowKernel row_kernel;
+  CsrDotKernel dot_kernel;
+  if (!GetCsrKernels(&row_kernel, &dot_kernel))
+    row_kernel = CsrRowGeneric<float>;
+  for (MatrixIndexT i = 0; i < A.NumRows(); i++)
+    row_kernel(cols + offsets[i], vals + offsets[i],
+               offsets[i + 1] - offsets[i], b, b_stride, dim, alpha, beta,
+               C->RowData(i));
+}
+
+static void AddCsrMatRows(double alpha, const CsrMatrix<double> &A,
+                          const MatrixBase<double> &B, double beta,
+                          MatrixBase<double> *C) {
+  const int32 *offsets = A.RowOffsets(), *cols = A.ColIndexes();
+  const double *vals = A.Values(), *b = B.Data();
+  for (MatrixIndexT i = 0; i < A.NumRows(); i++)
+    CsrRowGeneric(cols + offsets[i], vals + offsets[i],
+                  offsets[i + 1] - offsets[i], b, B.Stride(), C->NumCols(),
+                  alpha, beta, C->RowData(i));
+}
+
+template <typename Real>
+void AddCsrMat(Real alpha, const CsrMatrix<Real> &A,
+               MatrixTransposeType transA, const MatrixBase<Real> &B,
+               Real beta, MatrixBase<Real> *C) {
+  if (transA == kTrans) {
+    // Summing the rows of B for each row of C, in registers, is much faster
+    // than adding each row of B to the rows of C it goes to.
+    CsrMatrix<Real> A_trans;
+    A_trans.CopyFromCsr(A, kTrans);
+    AddCsrMat(alpha, A_trans, kNoTrans, B, beta, C);
+    return;
+  }
+  KALDI_ASSERT(C->NumRows() == A.NumRows() && C->NumCols() == B.NumCols() &&
+               A.NumCols() == B.NumRows());
+  if (C->NumCols() == 0)
+    return;
+  AddCsrMatRows(alpha, A, B, beta, C);
+}
+
+// The number of elements of B in each block of AddMatCsr(); with their
+// column indexes, they take 64K bytes for float.
+static const int32 kCsrBlockElements = 8192;
+
+// Does *C = alpha * A * B^T + beta * *C.  'dot_kernel' is for Real == float.
+template <typename Real, typename DotKernel>
+static void AddMatCsrBlocks(Real alpha, const MatrixBase<Real> &A,
+                            const CsrMatrix<Real> &B, Real beta,
+                            const DotKernel &dot_kernel,
+                            MatrixBase<Real> *C) {
+  const int32 *offsets = B.RowOffsets(), *cols = B.ColIndexes();
+  const Real *vals = B.Values();
+  MatrixIndexT num_rows = C->NumRows(), num_cols = C->NumCols();
+  // The rows j ... j_end - 1 of B are multiplied by all rows of A while they
+  // are in the cache.
+  for (MatrixIndexT j = 0; j < num_cols; ) {
+    MatrixIndexT j_end = j + 1;
+    while (j_end < num_cols &&
+           offsets[j_end + 1] - offsets[j] <= kCsrBlockElements)
+      j_end++;
+    for (MatrixIndexT i = 0; i < num_rows; i++)
+      dot_kernel(offsets + j, j_end - j, cols, vals, A.RowData(i), alpha,
+                 beta, C->RowData(i) + j);
+    j = j_end;
+  }
+}
+
+static void AddMatCsrTrans(float alpha, const MatrixBase<float> &A,
+                           const CsrMatrix<float> &B, float beta,
+                           MatrixBase<float> *C) {
+  CsrRowKernel row_kernel;
+  CsrDotKernel dot_kernel;
+  if (!GetCsrKernels(&row_kernel, &dot_kernel))
+    dot_kernel = CsrDotGeneric<float>;
+  AddMatCsrBlocks(alpha, A, B, beta, dot_kernel, C);
+}
+
+static void AddMatCsrTrans(double alpha, const MatrixBase<double> &A,
+                           const CsrMatrix<double> &B, double beta,
+                           MatrixBase<double> *C) {
+  AddMatCsrBlocks(alpha, A, B, beta, CsrDotGeneric<double>, C);
+}
+
+template <typename Real>
+void AddMatCsr(Real alpha, const MatrixBase<Real> &A,
+               const CsrMatrix<Real> &B, MatrixTransposeType transB,
+               Real beta, MatrixBase<Real> *C) {
+  if (transB == kNoTrans) {
+    // Each element of C is then the dot product of a row of A and a row of
+    // B^T.
+    CsrMatrix<Real> B_trans;
+    B_trans.CopyFromCsr(B, kTrans);
+    AddMatCsr(alpha, A, B_trans, kTrans, beta, C);
+    return;
+  }
+  KALDI_ASSERT(C->NumRows() == A.NumRows() && C->NumCols() == B.NumRows() &&
+               A.NumCols() == B.NumCols());
+  AddMatCsrTrans(alpha, A, B, beta, C);
+}
+
+
+template class CsrMatrix<float>;
+template class CsrMatrix<double>;
+
+#define KALDI_CSR_MATRIX_INSTANTIATE(Real, OtherReal)                         \
+  template void CsrMatrix<Real>::CopyFromSmat(                                \
+      const SparseMatrix<OtherReal> &smat, MatrixTransposeType trans);        \
+  template void CsrMatrix<Real>::CopyFromMat(                                 \
+      const MatrixBase<OtherReal> &mat, MatrixTransposeType trans);           \
+  template void CsrMatrix<Real>::CopyToSmat(                                  \
+      SparseMatrix<OtherReal> *smat) const;                                   \
+  template void CsrMatrix<Real>::CopyToMat(                                   \
+      MatrixBase<OtherReal> *mat, MatrixTransposeType trans) const;
+
+KALDI_CSR_MATRIX_INSTANTIATE(float, float)
+KALDI_CSR_MATRIX_INSTANTIATE(float, double)
+KALDI_CSR_MATRIX_INSTANTIATE(double, float)
+KALDI_CSR_MATRIX_INSTANTIATE(double, double)
+
+#undef KALDI_CSR_MATRIX_INSTANTIATE
+
+template
+void AddCsrMat(float alpha, const CsrMatrix<float> &A,
+               MatrixTransposeType transA, const MatrixBase<float> &B,
+               float beta, MatrixBase<float> *C);
+template
+void AddCsrMat(double alpha, const CsrMatrix<double> &A,
+               MatrixTransposeType transA, const MatrixBase<double> &B,
+               double beta, MatrixBase<double> *C);
+template
+void AddMatCsr(float alpha, const MatrixBase<float> &A,
+               const CsrMatrix<float> &B, MatrixTransposeType transB,
+               float beta, MatrixBase<float> *C);
+template
+void AddMatCsr(double alpha, const MatrixBase<double> &A,
+               const CsrMatrix<double> &B, MatrixTransposeType transB,
+               double beta, MatrixBase<double> *C);
+
+}  // namespace kaldi
@@ -0,0 +1,150 @@
+// matrix/csr-matrix.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_CSR_MATRIX_H_
+#define KALDI_MATRIX_CSR_MATRIX_H_
+
+#include <vector>
+
+#include "matrix/kaldi-matrix.h"
+#include "matrix/sparse-matrix.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_group
+/// @{
+
+/*
+  CsrMatrix stores a sparse matrix in the compressed sparse row (CSR) format:
+  the column indexes and values of all the nonzero elements, row after row,
+  each in one contiguous array, and for each row the offset of its first
+  element in them.  This is the layout that CuSparseMatrix uses on the GPU.
+  SparseMatrix, which is more convenient to build and modify, keeps a
+  separate SparseVector for each row instead.
+
+  CsrMatrix is meant for multiplication: AddCsrMat() and AddMatCsr() multiply
+  it with a dense matrix, with vectorized kernels.  Copying from a matrix
+  with trans == kTrans gives the CSR form of its transpose, which is the
+  compressed sparse column (CSC) form of the matrix itself.
+*/
+template <typename Real>
+class CsrMatrix {
+ public:
+  CsrMatrix(): num_rows_(0), num_cols_(0), row_offsets_(1, 0) { }
+
+  template <typename OtherReal>
+  explicit CsrMatrix(const SparseMatrix<OtherReal> &smat,
+                     MatrixTransposeType trans = kNoTrans) {
+    CopyFromSmat(smat, trans);
+  }
+
+  /// Copies the elements of smat, or of its transpose if trans == kTrans.
+  /// Elements that are stored in smat are kept even if they are zero.
+  template <typename OtherReal>
+  void CopyFromSmat(const SparseMatrix<OtherReal> &smat,
+                    MatrixTransposeType trans = kNoTrans);
+
+  /// Copies the nonzero elements of mat, or of its transpose.
+  template <typename OtherReal>
+  void CopyFromMat(const MatrixBase<OtherReal> &mat,
+                   MatrixTransposeType trans = kNoTrans);
+
+  /// Copies the nonzero elements of gmat, or of its transpose, whatever its
+  /// type; a compressed matrix is uncompressed first.
+  void CopyFromGeneralMatrix(const GeneralMatrix &gmat,
+                             MatrixTransposeType trans = kNoTrans);
+
+  /// Copies other, or its transpose, to *this.
+  void CopyFromCsr(const CsrMatrix<Real> &other,
+                   MatrixTransposeType trans = kNoTrans);
+
+  /// Copies to smat, which this resizes.
+  template <typename OtherReal>
+  void CopyToSmat(SparseMatrix<OtherReal> *smat) const;
+
+  /// Copies to mat, which must already have the correct size.
+  template <typename OtherReal>
+  void CopyToMat(MatrixBase<OtherReal> *mat,
+                 MatrixTransposeType trans = kNoTrans) const;
+
+  MatrixIndexT NumRows() const { return num_rows_; }
+  MatrixIndexT NumCols() const { return num_cols_; }
+  MatrixIndexT NumElements() const { return row_offsets_.back(); }
+
+  /// Returns NumRows() + 1 offsets; the elements of row r are
+  /// RowOffsets()[r] ... RowOffsets()[r + 1] - 1.
+  const int32 *RowOffsets() const { return &(row_offsets_[0]); }
+
+  /// Returns the column indexes of the elements (or NULL if there are none).
+  const int32 *ColIndexes() const {
+    return col_indexes_.empty() ? NULL : &(col_indexes_[0]);
+  }
+
+  /// Returns the values of the elements (or NULL if there are none).
+  const Real *Values() const {
+    return values_.empty() ? NULL : &(values_[0]);
+  }
+
+  void Swap(CsrMatrix<Real> *other);
+
+  /// Sets to the empty matrix.
+  void Clear();
+
+ private:
+  // Sets up the sizes and row_offsets_ for a matrix with 'row_sizes[r]'
+  // elements in row r, and sizes the element arrays.
+  void Init(MatrixIndexT num_cols, const std::vector<int32> &row_sizes);
+
+  MatrixIndexT num_rows_;
+  MatrixIndexT num_cols_;
+  std::vector<int32> row_offsets_;  // of dimension num_rows_ + 1.
+  std::vector<int32> col_indexes_;
+  std::vector<Real> values_;
+};
+
+
+/**
+   Does *C = alpha * op(A) * B + beta * *C, where A is sparse.  For each row of
+   C, the rows of B selected by the elements of a row of A are summed in
+   registers, a block of columns at a time, and C is written once.  For
+   transA == kTrans, A is first transposed, which takes time proportional to
+   its number of elements.  As in BLAS, if beta == 0 the previous contents of
+   C are ignored.  See also MatrixBase::AddSmatMat().
+ */
+template <typename Real>
+void AddCsrMat(Real alpha, const CsrMatrix<Real> &A,
+               MatrixTransposeType transA, const MatrixBase<Real> &B,
+               Real beta, MatrixBase<Real> *C);
+
+/**
+   Does *C = alpha * A * op(B) + beta * *C, where B is sparse.  Each element
+   of C is the dot product of a row of A and a row of op(B)^T, with the
+   elements of the row of A that it needs gathered by the indexes of the
+   sparse row; B is processed in blocks that fit in the cache.  For
+   transB == kNoTrans, B is first transposed.  See also
+   MatrixBase::AddMatSmat().
+ */
+template <typename Real>
+void AddMatCsr(Real alpha, const MatrixBase<Real> &A,
+               const CsrMatrix<Real> &B, MatrixTransposeType transB,
+               Real beta, MatrixBase<Real> *C);
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_CSR_MATRIX_H_
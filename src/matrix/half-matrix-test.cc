@@ -0,0 +1,209 @@
+// matrix/half-matrix-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "matrix/matrix-lib.h"
+
+namespace kaldi {
+
+static void UnitTestHalfConversion() {
+  // Every number converts back to itself.
+  for (int32 i = 0; i < 65536; i++) {
+    uint16 h = i;
+    float f = HalfToFloat(h), g = Bfloat16ToFloat(h);
+    if (f == f)  // not NaN
+      KALDI_ASSERT(FloatToHalf(f) == h);
+    else
+      KALDI_ASSERT(KALDI_ISNAN(HalfToFloat(FloatToHalf(f))));
+    if (g == g)
+      KALDI_ASSERT(FloatToBfloat16(g) == h);
+    else
+      KALDI_ASSERT(KALDI_ISNAN(Bfloat16ToFloat(FloatToBfloat16(g))));
+  }
+  // Other numbers go to the nearest one.
+  for (int32 i = 0; i < 10000; i++) {
+    float f = RandGauss() * std::pow(2.0, RandInt(-28, 14));
+    if (std::abs(f) >= 65504.0f)
+      continue;
+    uint16 h = FloatToHalf(f), b = FloatToBfloat16(f);
+    float err = std::abs(HalfToFloat(h) - f);
+    KALDI_ASSERT(err <= std::abs(HalfToFloat(h + 1) - f) &&
+                 (h % 0x8000 == 0 || err <= std::abs(HalfToFloat(h - 1) - f)));
+    err = std::abs(Bfloat16ToFloat(b) - f);
+    KALDI_ASSERT(err <= std::abs(Bfloat16ToFloat(b + 1) - f) &&
+                 err <= std::abs(Bfloat16ToFloat(b - 1) - f));
+  }
+  // Ties go to even.
+  KALDI_ASSERT(FloatToBfloat16(1.0f + 1.0f / 256) == FloatToBfloat16(1.0f));
+  KALDI_ASSERT(Bfloat16ToFloat(FloatToBfloat16(1.0f + 3.0f / 256)) ==
+               1.0f + 1.0f / 64);
+  KALDI_ASSERT(FloatToHalf(1.0f + 1.0f / 2048) == FloatToHalf(1.0f));
+  // Large numbers.
+  KALDI_ASSERT(HalfToFloat(FloatToHalf(65504.0f)) == 65504.0f);
+  KALDI_ASSERT(HalfToFloat(FloatToHalf(65519.0f)) == 65504.0f);
+  KALDI_ASSERT(KALDI_ISINF(HalfToFloat(FloatToHalf(-65520.0f))));
+  KALDI_ASSERT(std::abs(Bfloat16ToFloat(FloatToBfloat16(1.0e+30f)) /
+                        1.0e+30f - 1.0f) <= 1.0f / 256);
+  HalfMatrixType type;
+  KALDI_ASSERT(ParseHalfMatrixType("bf16", &type) && type == kBfloat16 &&
+               ParseHalfMatrixType(HalfMatrixTypeName(kFloat16), &type) &&
+               type == kFloat16 && !ParseHalfMatrixType("fp32", &type));
+}
+
+template<typename Real>
+static void UnitTestHalfMatrixCopy() {
+  for (int32 i = 0; i < 10; i++) {
+    HalfMatrixType type = (i % 2 == 0 ? kFloat16 : kBfloat16);
+    MatrixIndexT num_rows = RandInt(1, 40), num_cols = RandInt(1, 100);
+    Matrix<Real> M(num_rows, num_cols);
+    M.SetRandn();
+    HalfMatrix H(M, type);
+    KALDI_ASSERT(H.NumRows() == num_rows && H.NumCols() == num_cols &&
+                 H.Type() == type);
+    KALDI_ASSERT(H.SizeInBytes() <= (num_rows + 15) * (num_cols + 1) * 2);
+    Matrix<Real> M2(num_rows, num_cols);
+    H.CopyToMat(&M2);
+    // The relative error of each element is at most 2^-11 for fp16 (for
+    // numbers this large) and 2^-8 for bf16.
+    Real max_error = (type == kFloat16 ? 1.0 / 2048 : 1.0 / 256);
+    for (MatrixIndexT r = 0; r < num_rows; r++)
+      for (MatrixIndexT c = 0; c < num_cols; c++)
+        KALDI_ASSERT(std::abs(M(r, c) - M2(r, c)) <=
+                     max_error * std::abs(M(r, c)) + 1.0e-04);
+    // Converting again changes nothing.
+    HalfMatrix H2(M2, type);
+    Matrix<Real> M3(num_rows, num_cols);
+    H2.CopyToMat(&M3);
+    KALDI_ASSERT(M2.ApproxEqual(M3, 0.0));
+
+    // Read() and Write() use the format of Matrix.
+    bool binary = (i % 4 < 2);
+    std::ostringstream os;
+    H.Write(os, binary);
+    std::istringstream is(os.str());
+    Matrix<float> M4;
+    M4.Read(is, binary);
+    AssertEqual(Matrix<float>(M2), M4);
+    std::istringstream is2(os.str());
+    H2.Read(is2, binary, type);
+    Matrix<Real> M5(num_rows, num_cols);
+    H2.CopyToMat(&M5);
+    AssertEqual(M2, M5);
+  }
+  // fp16 clips large numbers.
+  Matrix<Real> M(1, 2);
+  M(0, 0) = 1.0e+06;
+  M(0, 1) = -1.0e+06;
+  HalfMatrix H(M, kFloat16);
+  H.CopyToMat(&M);
+  KALDI_ASSERT(M(0, 0) == 65504.0 && M(0, 1) == -65504.0);
+
+  Matrix<Real> empty;
+  HalfMatrix H2(empty, kBfloat16);
+  KALDI_ASSERT(H2.NumRows() == 0 && H2.NumCols() == 0);
+  H.Swap(&H2);
+  KALDI_ASSERT(H.NumRows() == 0 && H2.NumCols() == 2);
+  H2.Clear();
+  KALDI_ASSERT(H2.NumRows() == 0 && H2.SizeInBytes() == 0);
+}
+
+// Checks that C2 is within 'tolerance' * |alpha| * |A| * |B|^T of C, plus
+// roundoff.
+template<typename Real>
+static void AssertProductsClose(Real alpha, const MatrixBase<Real> &A,
+                                const MatrixBase<Real> &B,
+                                const MatrixBase<Real> &C,
+                                const MatrixBase<Real> &C2, Real tolerance) {
+  Matrix<Real> A_abs(A), B_abs(B), bound(C.NumRows(), C.NumCols());
+  A_abs.ApplyPowAbs(1.0);
+  B_abs.ApplyPowAbs(1.0);
+  bound.AddMatMat(std::abs(alpha) * tolerance, A_abs, kNoTrans, B_abs, kTrans,
+                  0.0);
+  for (MatrixIndexT r = 0; r < C.NumRows(); r++)
+    for (MatrixIndexT c = 0; c < C.NumCols(); c++)
+      KALDI_ASSERT(std::abs(C(r, c) - C2(r, c)) <=
+                   bound(r, c) + 1.0e-05 * (1.0 + std::abs(C(r, c))));
+}
+
+template<typename Real>
+static void UnitTestAddMatHalfMat() {
+  for (int32 i = 0; i < 20; i++) {
+    HalfMatrixType type = (i % 2 == 0 ? kFloat16 : kBfloat16);
+    MatrixIndexT num_rows = RandInt(1, 40), num_cols = RandInt(1, 300),
+        dim = RandInt(1, 200);
+    Matrix<Real> A(num_rows, dim), B(num_cols, dim), C(num_rows, num_cols);
+    A.SetRandn();
+    B.SetRandn();
+    C.SetRandn();
+    Real alpha = RandGauss(), beta = (i % 3 == 0 ? 0.0 : RandGauss());
+    HalfMatrix H(B, type);
+    H.CopyToMat(&B);
+    Matrix<Real> C2(C);
+    if (beta == 0.0)
+      C2.Set(std::numeric_limits<Real>::quiet_NaN());  // must be ignored.
+    // A sub-matrix, to test strides.
+    SubMatrix<Real> A_sub(A, 0, num_rows, 0, dim);
+    AddMatHalfMat(alpha, A_sub, H, beta, &C2);
+    C.AddMatMat(alpha, A, kNoTrans, B, kTrans, beta);
+    // With bf16, A may have been rounded to bf16 too.
+    AssertProductsClose<Real>(alpha, A, B, C, C2,
+                              type == kFloat16 ? 1.0e-05 : 1.0 / 256);
+  }
+}
+
+// All instruction sets should give about the same result.
+static void UnitTestHalfKernels() {
+  SimdLevel cpu_level = (SetSimdLevel(kSimdAvx512), GetSimdLevel());
+  for (int32 t = 0; t < 2; t++) {
+    HalfMatrixType type = (t == 0 ? kFloat16 : kBfloat16);
+    MatrixIndexT num_rows = RandInt(1, 20), num_cols = RandInt(1, 100),
+        dim = RandInt(1, 500);
+    Matrix<float> A(num_rows, dim), B(num_cols, dim), C(num_rows, num_cols);
+    A.SetRandn();
+    B.SetRandn();
+    HalfMatrix H(B, type);
+    H.CopyToMat(&B);
+    SetSimdLevel(kSimdNone);
+    AddMatHalfMat(1.0f, A, H, 0.0f, &C);
+    for (int32 level = kSimdAvx2; level <= cpu_level; level++) {
+      SetSimdLevel(static_cast<SimdLevel>(level));
+      Matrix<float> C2(num_rows, num_cols);
+      AddMatHalfMat(1.0f, A, H, 0.0f, &C2);
+      AssertProductsClose<float>(1.0f, A, B, C, C2,
+                                 type == kFloat16 ? 1.0e-05 : 1.0 / 256);
+    }
+  }
+  SetSimdLevel(cpu_level);
+}
+
+template<typename Real>
+static void HalfMatrixUnitTest() {
+  UnitTestHalfMatrixCopy<Real>();
+  UnitTestAddMatHalfMat<Real>();
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::SetVerboseLevel(5);
+  kaldi::UnitTestHalfConversion();
+  kaldi::HalfMatrixUnitTest<float>();
+  kaldi::HalfMatrixUnitTest<double>();
+  for (kaldi::int32 i = 0; i < 5; i++)
+    kaldi::UnitTestHalfKernels();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,644 @@
+// matrix/half-matrix.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "matrix/half-matrix.h"
+#include "matrix/simd-math.h"
+
+// As in simd-math.cc, the vectorized kernels are compiled with the target
+// options for just those functions.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KALDI_HALF_MATRIX_X86 1
+#include <immintrin.h>
+#endif
+
+namespace kaldi {
+
+bool ParseHalfMatrixType(const std::string &str, HalfMatrixType *type) {
+  if (str == "fp16") {
+    *type = kFloat16;
+    return true;
+  } else if (str == "bf16") {
+    *type = kBfloat16;
+    return true;
+  }
+  return false;
+}
+
+const char *HalfMatrixTypeName(HalfMatrixType type) {
+  return (type == kFloat16 ? "fp16" : "bf16");
+}
+
+uint16 FloatToHalf(float f) {
+  uint32 x;
+  memcpy(&x, &f, sizeof(x));
+  uint32 sign = (x >> 16) & 0x8000, abs_x = x & 0x7fffffff;
+  if (abs_x > 0x7f800000)  // NaN; keep it quiet.
+    return sign | 0x7e00 | ((abs_x >> 13) & 0x3ff);
+  if (abs_x >= 0x477ff000)  // 65520 and above round to infinity.
+    return sign | 0x7c00;
+  if (abs_x < 0x38800000) {
+    // Below 2^-14, the smallest normal fp16: a denormal, which is an integer
+    // times 2^-24.  The multiplication is exact, and rint() rounds to even.
+    float abs_f;
+    memcpy(&abs_f, &abs_x, sizeof(abs_f));
+    return sign | static_cast<uint16>(std::rint(abs_f * 16777216.0f));
+  }
+  // Change the exponent bias from 127 to 15 and round off 13 bits of the
+  // mantissa, to even; a carry into the exponent gives the right answer.
+  uint32 h = abs_x - 0x38000000;
+  h += 0xfff + ((h >> 13) & 1);
+  return sign | (h >> 13);
+}
+
+float HalfToFloat(uint16 h) {
+  uint32 sign = static_cast<uint32>(h & 0x8000) << 16,
+      exponent = (h >> 10) & 0x1f, mantissa = h & 0x3ff, x;
+  if (exponent == 0x1f) {  // infinity or NaN.
+    x = sign | 0x7f800000 | (mantissa << 13);
+  } else if (exponent == 0) {  // zero or denormal.
+    float f = mantissa * (1.0f / 16777216.0f);
+    memcpy(&x, &f, sizeof(x));
+    x |= sign;
+  } else {
+    x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+  float f;
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+uint16 FloatToBfloat16(float f) {
+  uint32 x;
+  memcpy(&x, &f, sizeof(x));
+  if ((x & 0x7fffffff) > 0x7f800000)  // NaN; keep it quiet.
+    return (x >> 16) | 0x40;
+  x += 0x7fff + ((x >> 16) & 1);
+  return x >> 16;
+}
+
+float Bfloat16ToFloat(uint16 h) {
+  uint32 x = static_cast<uint32>(h) << 16;
+  float f;
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+
+// The kernels below compute a tile of up to kTileRows rows of A times one
+// panel of kPanelRows rows of B (see HalfMatrix::data_), as in
+// panel-matrix.cc.
+static const MatrixIndexT kTileRows = 4, kPanelRows = 16;
+
+// The arguments of the kernels that convert B to float, which are templated
+// on the number of rows R of the tile (1 to kTileRows):
+//  a, a_stride     the R rows of A, 'a_stride' floats apart.
+//  b               a panel of B.
+//  dim             the number of columns of A and of B.
+//  out             out[i * kPanelRows + j] is set to the product of row i of
+//                  A and row j of the panel.
+typedef void (*HalfKernel)(const float *a, MatrixIndexT a_stride,
+                           const uint16 *b, MatrixIndexT dim, float *out);
+
+// The kernels that use the AVX-512 BF16 instructions take A rounded to bf16,
+// with a 32-bit word for each pair of columns, and 'num_pairs' instead of
+// 'dim'.
+typedef void (*Bf16DotKernel)(const uint32 *a, MatrixIndexT a_stride,
+                              const uint16 *b, MatrixIndexT num_pairs,
+                              float *out);
+
+inline size_t HalfMatrix::Index(MatrixIndexT r, MatrixIndexT c) const {
+  size_t panel_start = static_cast<size_t>(r / kPanelRows) * kPanelRows *
+      (num_cols_ + num_cols_ % 2);
+  MatrixIndexT i = r % kPanelRows;
+  if (type_ == kFloat16)
+    return panel_start + c * kPanelRows + i;
+  else
+    return panel_start + (c / 2) * 2 * kPanelRows + 2 * i + c % 2;
+}
+
+// Converts the panel 'b' of a HalfMatrix of type 'type' with 'dim' columns
+// to float, in the layout of PanelMatrix (column by column).
+static void WidenPanel(HalfMatrixType type, const uint16 *b, MatrixIndexT dim,
+                       float *out) {
+  if (type == kFloat16) {
+    for (MatrixIndexT k = 0; k < dim * kPanelRows; k++)
+      out[k] = HalfToFloat(b[k]);
+  } else {
+    for (MatrixIndexT k = 0; k < dim; k++)
+      for (MatrixIndexT j = 0; j < kPanelRows; j++)
+        out[k * kPanelRows + j] =
+            Bfloat16ToFloat(b[(k / 2) * 2 * kPanelRows + 2 * j + k % 2]);
+  }
+}
+
+#ifdef KALDI_HALF_MATRIX_X86
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma,f16c"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma,f16c")
+#endif
+
+template<int R>
+static void Fp16KernelAvx2(const float *a, MatrixIndexT a_stride,
+                           const uint16 *b, MatrixIndexT dim, float *out) {
+  // acc[i][h] holds the products of row i of A with rows 8h...8h+7 of the
+  // panel.
+  __m256 acc[R][2];
+  for (int i = 0; i < R; i++)
+    acc[i][0] = acc[i][1] = _mm256_setzero_ps();
+  for (MatrixIndexT k = 0; k < dim; k++) {
+    const __m128i *b_col = reinterpret_cast<const __m128i*>(b +
+                                                             k * kPanelRows);
+    __m256 b0 = _mm256_cvtph_ps(_mm_loadu_si128(b_col)),
+        b1 = _mm256_cvtph_ps(_mm_loadu_si128(b_col + 1));
+    for (int i = 0; i < R; i++) {
+      __m256 a_ik = _mm256_broadcast_ss(a + i * a_stride + k);
+      acc[i][0] = _mm256_fmadd_ps(a_ik, b0, acc[i][0]);
+      acc[i][1] = _mm256_fmadd_ps(a_ik, b1, acc[i][1]);
+    }
+  }
+  for (int i = 0; i < R; i++) {
+    _mm256_storeu_ps(out + i * kPanelRows, acc[i][0]);
+    _mm256_storeu_ps(out + i * kPanelRows + 8, acc[i][1]);
+  }
+  _mm256_zeroupper();  // See ApplyKernel() in simd-math-inl.h.
+}
+
+template<int R>
+static void Bf16KernelAvx2(const float *a, MatrixIndexT a_stride,
+                           const uint16 *b, MatrixIndexT dim, float *out) {
+  // A bf16 number is converted to float by putting it in the top 16 bits.
+  // Each 32-bit word of a panel holds columns k and k + 1 of a row, so the
+  // shift gives column k and the mask column k + 1.
+  const __m256i high = _mm256_set1_epi32(0xffff0000);
+  __m256 acc[R][2];
+  for (int i = 0; i < R; i++)
+    acc[i][0] = acc[i][1] = _mm256_setzero_ps();
+  MatrixIndexT k = 0;
+  for (; k + 2 <= dim; k += 2) {
+    const __m256i *b_pair = reinterpret_cast<const __m256i*>(b +
+                                                             k * kPanelRows);
+    __m256i w0 = _mm256_loadu_si256(b_pair),
+        w1 = _mm256_loadu_si256(b_pair + 1);
+    __m256 b0 = _mm256_castsi256_ps(_mm256_slli_epi32(w0, 16)),
+        b1 = _mm256_castsi256_ps(_mm256_slli_epi32(w1, 16)),
+        c0 = _mm256_castsi256_ps(_mm256_and_si256(w0, high)),
+        c1 = _mm256_castsi256_ps(_mm256_and_si256(w1, high));
+    for (int i = 0; i < R; i++) {
+      __m256 a_ik = _mm256_broadcast_ss(a + i * a_stride + k),
+          a_ik1 = _mm256_broadcast_ss(a + i * a_stride + k + 1);
+      acc[i][0] = _mm256_fmadd_ps(a_ik, b0, acc[i][0]);
+      acc[i][1] = _mm256_fmadd_ps(a_ik, b1, acc[i][1]);
+      acc[i][0] = _mm256_fmadd_ps(a_ik1, c0, acc[i][0]);
+      acc[i][1] = _mm256_fmadd_ps(a_ik1, c1, acc[i][1]);
+    }
+  }
+  if (k < dim) {  // the last column, which has no partner.
+    const __m256i *b_pair = reinterpret_cast<const __m256i*>(b +
+                                                             k * kPanelRows);
+    __m256 b0 = _mm256_castsi256_ps(
+        _mm256_slli_epi32(_mm256_loadu_si256(b_pair), 16)),
+        b1 = _mm256_castsi256_ps(
+            _mm256_slli_epi32(_mm256_loadu_si256(b_pair + 1), 16));
+    for (int i = 0; i < R; i++) {
+      __m256 a_ik = _mm256_broadcast_ss(a + i * a_stride + k);
+      acc[i][0] = _mm256_fmadd_ps(a_ik, b0, acc[i][0]);
+      acc[i][1] = _mm256_fmadd_ps(a_ik, b1, acc[i][1]);
+    }
+  }
+  for (int i = 0; i < R; i++) {
+    _mm256_storeu_ps(out + i * kPanelRows, acc[i][0]);
+    _mm256_storeu_ps(out + i * kPanelRows + 8, acc[i][1]);
+  }
+  _mm256_zeroupper();
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+// See simd-math.cc.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+template<int R>
+static void Fp16KernelAvx512(const float *a, MatrixIndexT a_stride,
+                             const uint16 *b, MatrixIndexT dim, float *out) {
+  // As in PanelKernelAvx512(), the even and odd columns go into separate
+  // sums.
+  __m512 acc[R][2];
+  for (int i = 0; i < R; i++)
+    acc[i][0] = acc[i][1] = _mm512_setzero_ps();
+  MatrixIndexT k = 0;
+  for (; k + 2 <= dim; k += 2) {
+    const __m256i *b_col = reinterpret_cast<const __m256i*>(b +
+                                                             k * kPanelRows);
+    __m512 b0 = _mm512_cvtph_ps(_mm256_loadu_si256(b_col)),
+        b1 = _mm512_cvtph_ps(_mm256_loadu_si256(b_col + 1));
+    for (int i = 0; i < R; i++) {
+      const float *a_row = a + i * a_stride + k;
+      acc[i][0] = _mm512_fmadd_ps(_mm512_set1_ps(a_row[0]), b0, acc[i][0]);
+      acc[i][1] = _mm512_fmadd_ps(_mm512_set1_ps(a_row[1]), b1, acc[i][1]);
+    }
+  }
+  if (k < dim) {
+    __m512 b0 = _mm512_cvtph_ps(_mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(b + k * kPanelRows)));
+    for (int i = 0; i < R; i++)
+      acc[i][0] = _mm512_fmadd_ps(_mm512_set1_ps(a[i * a_stride + k]), b0,
+                                  acc[i][0]);
+  }
+  for (int i = 0; i < R; i++)
+    _mm512_storeu_ps(out + i * kPanelRows,
+                     _mm512_add_ps(acc[i][0], acc[i][1]));
+  _mm256_zeroupper();
+}
+
+template<int R>
+static void Bf16KernelAvx512(const float *a, MatrixIndexT a_stride,
+                             const uint16 *b, MatrixIndexT dim, float *out) {
+  // See Bf16KernelAvx2().
+  const __m512i high = _mm512_set1_epi32(0xffff0000);
+  __m512 acc[R][2];
+  for (int i = 0; i < R; i++)
+    acc[i][0] = acc[i][1] = _mm512_setzero_ps();
+  MatrixIndexT k = 0;
+  for (; k + 2 <= dim; k += 2) {
+    __m512i w = _mm512_loadu_si512(b + k * kPanelRows);
+    __m512 b0 = _mm512_castsi512_ps(_mm512_slli_epi32(w, 16)),
+        b1 = _mm512_castsi512_ps(_mm512_and_si512(w, high));
+    for (int i = 0; i < R; i++) {
+      const float *a_row = a + i * a_stride + k;
+      acc[i][0] = _mm512_fmadd_ps(_mm512_set1_ps(a_row[0]), b0, acc[i][0]);
+      acc[i][1] = _mm512_fmadd_ps(_mm512_set1_ps(a_row[1]), b1, acc[i][1]);
+    }
+  }
+  if (k < dim) {
+    __m512 b0 = _mm512_castsi512_ps(
+        _mm512_slli_epi32(_mm512_loadu_si512(b + k * kPanelRows), 16));
+    for (int i = 0; i < R; i++)
+      acc[i][0] = _mm512_fmadd_ps(_mm512_set1_ps(a[i * a_stride + k]), b0,
+                                  acc[i][0]);
+  }
+  for (int i = 0; i < R; i++)
+    _mm512_storeu_ps(out + i * kPanelRows,
+                     _mm512_add_ps(acc[i][0], acc[i][1]));
+  _mm256_zeroupper();
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push( \
+    __attribute__((target("avx512f,avx512bf16"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bf16")
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+template<int R>
+static void Bf16DotKernelAvx512(const uint32 *a, MatrixIndexT a_stride,
+                                const uint16 *b, MatrixIndexT num_pairs,
+                                float *out) {
+  // vdpbf16ps multiplies the two bf16 numbers in each 32-bit word of one
+  // operand by those of the other, and adds both products to a float; so
+  // with a pair of columns of A in all the words of one operand, it does the
+  // work of two multiply-adds of the other kernels.
+  __m512 acc[R][2];
+  for (int i = 0; i < R; i++)
+    acc[i][0] = acc[i][1] = _mm512_setzero_ps();
+  MatrixIndexT k = 0;
+  for (; k + 2 <= num_pairs; k += 2) {
+    __m512i b0 = _mm512_loadu_si512(b + k * 2 * kPanelRows),
+        b1 = _mm512_loadu_si512(b + (k + 1) * 2 * kPanelRows);
+    for (int i = 0; i < R; i++) {
+      const uint32 *a_row = a + i * a_stride + k;
+      acc[i][0] = _mm512_dpbf16_ps(acc[i][0], (__m512bh)b0,
+                                   (__m512bh)_mm512_set1_epi32(a_row[0]));
+      acc[i][1] = _mm512_dpbf16_ps(acc[i][1], (__m512bh)b1,
+                                   (__m512bh)_mm512_set1_epi32(a_row[1]));
+    }
+  }
+  if (k < num_pairs) {
+    __m512i b0 = _mm512_loadu_si512(b + k * 2 * kPanelRows);
+    for (int i = 0; i < R; i++)
+      acc[i][0] = _mm512_dpbf16_ps(
+          acc[i][0], (__m512bh)b0,
+          (__m512bh)_mm512_set1_epi32(a[i * a_stride + k]));
+  }
+  for (int i = 0; i < R; i++)
+    _mm512_storeu_ps(out + i * kPanelRows,
+                     _mm512_add_ps(acc[i][0], acc[i][1]));
+  _mm256_zeroupper();
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+#endif  // KALDI_HALF_MATRIX_X86
+
+#define KALDI_SET_HALF_KERNELS(kernels, Kernel) \
+  do {                                          \
+    kernels[0] = Kernel<1>;                     \
+    kernels[1] = Kernel<2>;                     \
+    kernels[2] = Kernel<3>;                     \
+    kernels[3] = Kernel<4>;                     \
+  } while (0)
+
+// Sets kernels[R - 1] to the kernel that converts B of type 'type' to float
+// for tiles of R rows, and returns true; or returns false if there are no
+// vectorized kernels for this type and CPU.
+static bool GetHalfKernels(HalfMatrixType type,
+                           HalfKernel kernels[kTileRows]) {
+#ifdef KALDI_HALF_MATRIX_X86
+  SimdLevel level = GetSimdLevel();
+  // F16C came with AVX2 in practice, but it is a separate feature.
+  static const bool has_f16c = __builtin_cpu_supports("f16c");
+  if (level == kSimdAvx512) {
+    if (type == kFloat16)
+      KALDI_SET_HALF_KERNELS(kernels, Fp16KernelAvx512);
+    else
+      KALDI_SET_HALF_KERNELS(kernels, Bf16KernelAvx512);
+    return true;
+  } else if (level == kSimdAvx2) {
+    if (type == kFloat16 && has_f16c) {
+      KALDI_SET_HALF_KERNELS(kernels, Fp16KernelAvx2);
+      return true;
+    } else if (type == kBfloat16) {
+      KALDI_SET_HALF_KERNELS(kernels, Bf16KernelAvx2);
+      return true;
+    }
+  }
+#endif
+  return false;
+}
+
+// Like GetHalfKernels(), for the kernels that use the AVX-512 BF16
+// instructions.
+static bool GetBf16DotKernels(Bf16DotKernel kernels[kTileRows]) {
+#ifdef KALDI_HALF_MATRIX_X86
+  static const bool has_avx512_bf16 = __builtin_cpu_supports("avx512bf16");
+  if (GetSimdLevel() == kSimdAvx512 && has_avx512_bf16) {
+    KALDI_SET_HALF_KERNELS(kernels, Bf16DotKernelAvx512);
+    return true;
+  }
+#endif
+  return false;
+}
+
+#undef KALDI_SET_HALF_KERNELS
+
+// Calls tile(p, i, num_rows, out), which sets 'out' to the product of rows
+// i ... i + num_rows - 1 of A (num_rows <= kTileRows) and panel p of B, for
+// each tile of the product, and adds the results to C.
+template<typename Real, typename TileFunction>
+static void AddTiles(Real alpha, MatrixIndexT num_panels,
+                     const TileFunction &tile, Real beta,
+                     MatrixBase<Real> *C) {
+  MatrixIndexT num_rows = C->NumRows(), num_cols = C->NumCols();
+  Real out[kTileRows * kPanelRows];
+  // Each panel of B is read once, and multiplied by all rows of A while it
+  // is in the cache.
+  for (MatrixIndexT p = 0; p < num_panels; p++) {
+    MatrixIndexT j = p * kPanelRows,
+        tile_cols = std::min(kPanelRows, num_cols - j);
+    for (MatrixIndexT i = 0; i < num_rows; i += kTileRows) {
+      MatrixIndexT tile_rows = std::min(kTileRows, num_rows - i);
+      tile(p, i, tile_rows, out);
+      for (MatrixIndexT ii = 0; ii < tile_rows; ii++) {
+        Real *c_data = C->RowData(i + ii) + j;
+        const Real *out_data = out + ii * kPanelRows;
+        // As in BLAS, beta == 0 ignores the previous contents of C.
+        if (beta == 0.0) {
+          for (MatrixIndexT jj = 0; jj < tile_cols; jj++)
+            c_data[jj] = alpha * out_data[jj];
+        } else {
+          for (MatrixIndexT jj = 0; jj < tile_cols; jj++)
+            c_data[jj] = beta * c_data[jj] + alpha * out_data[jj];
+        }
+      }
+    }
+  }
+}
+
+// The vectorized versions of AddMatHalfMat(); they return false if there
+// are none for this type and CPU.  'b' is the data of B, in panels of
+// 'panel_size' elements.
+static bool AddMatHalfMatSimd(float alpha, const MatrixBase<float> &A,
+                              HalfMatrixType type, const uint16 *b,
+                              size_t panel_size, MatrixIndexT num_panels,
+                              float beta, MatrixBase<float> *C) {
+  MatrixIndexT num_rows = A.NumRows(), dim = A.NumCols();
+  Bf16DotKernel dot_kernels[kTileRows];
+  HalfKernel kernels[kTileRows];
+  if (type == kBfloat16 && GetBf16DotKernels(dot_kernels)) {
+    // Round A to bf16, in pairs of columns (the last one padded with zero).
+    MatrixIndexT num_pairs = (dim + 1) / 2;
+    std::vector<uint32> a_pairs(static_cast<size_t>(num_rows) * num_pairs, 0);
+    for (MatrixIndexT r = 0; r < num_rows; r++) {
+      const float *a_row = A.RowData(r);
+      uint32 *pairs = &(a_pairs[static_cast<size_t>(r) * num_pairs]);
+      for (MatrixIndexT k = 0; k < dim; k++)
+        pairs[k / 2] |= static_cast<uint32>(FloatToBfloat16(a_row[k]))
+            << (16 * (k % 2));
+    }
+    AddTiles(alpha, num_panels,
+             [&](MatrixIndexT p, MatrixIndexT i, MatrixIndexT tile_rows,
+                 float *out) {
+               dot_kernels[tile_rows - 1](
+                   &(a_pairs[static_cast<size_t>(i) * num_pairs]), num_pairs,
+                   b + p * panel_size, num_pairs, out);
+             }, beta, C);
+    return true;
+  } else if (GetHalfKernels(type, kernels)) {
+    AddTiles(alpha, num_panels,
+             [&](MatrixIndexT p, MatrixIndexT i, MatrixIndexT tile_rows,
+                 float *out) {
+               kernels[tile_rows - 1](A.RowData(i), A.Stride(),
+                                      b + p * panel_size, dim, out);
+             }, beta, C);
+    return true;
+  }
+  return false;
+}
+
+static bool AddMatHalfMatSimd(double alpha, const MatrixBase<double> &A,
+                              HalfMatrixType type, const uint16 *b,
+                              size_t panel_size, MatrixIndexT num_panels,
+                              double beta, MatrixBase<double> *C) {
+  return false;
+}
+
+template<typename Real>
+void HalfMatrix::CopyFromMat(const MatrixBase<Real> &mat,
+                             HalfMatrixType type) {
+  type_ = type;
+  num_rows_ = mat.NumRows();
+  num_cols_ = mat.NumCols();
+  MatrixIndexT num_panels = (num_rows_ + kPanelRows - 1) / kPanelRows;
+  data_.assign(static_cast<size_t>(num_panels) * kPanelRows *
+               (num_cols_ + num_cols_ % 2), 0);
+  // The largest finite fp16 number.
+  const Real max_half = 65504.0;
+  int64 num_clipped = 0;
+  for (MatrixIndexT r = 0; r < num_rows_; r++) {
+    const Real *row_data = mat.RowData(r);
+    for (MatrixIndexT c = 0; c < num_cols_; c++) {
+      Real value = row_data[c];
+      if (type == kFloat16) {
+        if (std::abs(value) > max_half) {
+          value = (value > 0 ? max_half : -max_half);
+          num_clipped++;
+        }
+        data_[Index(r, c)] = FloatToHalf(value);
+      } else {
+        data_[Index(r, c)] = FloatToBfloat16(value);
+      }
+    }
+  }
+  if (num_clipped != 0)
+    KALDI_WARN << "Clipped " << num_clipped << " elements of a "
+               << num_rows_ << " x " << num_cols_
+               << " matrix to the range of fp16";
+}
+
+template<typename Real>
+void HalfMatrix::CopyToMat(MatrixBase<Real> *mat) const {
+  KALDI_ASSERT(mat->NumRows() == num_rows_ && mat->NumCols() == num_cols_);
+  for (MatrixIndexT r = 0; r < num_rows_; r++) {
+    Real *row_data = mat->RowData(r);
+    for (MatrixIndexT c = 0; c < num_cols_; c++) {
+      uint16 h = data_[Index(r, c)];
+      row_data[c] = (type_ == kFloat16 ? HalfToFloat(h) : Bfloat16ToFloat(h));
+    }
+  }
+}
+
+void HalfMatrix::Read(std::istream &is, bool binary, HalfMatrixType type) {
+  Matrix<float> mat;
+  mat.Read(is, binary);
+  CopyFromMat(mat, type);
+}
+
+void HalfMatrix::Write(std::ostream &os, bool binary) const {
+  Matrix<float> mat(num_rows_, num_cols_, kUndefined);
+  CopyToMat(&mat);
+  mat.Write(os, binary);
+}
+
+void HalfMatrix::Swap(HalfMatrix *other) {
+  std::swap(type_, other->type_);
+  std::swap(num_rows_, other->num_rows_);
+  std::swap(num_cols_, other->num_cols_);
+  data_.swap(other->data_);
+}
+
+void HalfMatrix::Clear() {
+  HalfMatrix empty;
+  Swap(&empty);
+}
+
+template<typename Real>
+void AddMatHalfMat(Real alpha, const MatrixBase<Real> &A,
+                   const HalfMatrix &B, Real beta,
+                   MatrixBase<Real> *C) {
+  KALDI_ASSERT(A.NumCols() == B.num_cols_ && C->NumRows() == A.NumRows() &&
+               C->NumCols() == B.num_rows_);
+  MatrixIndexT num_rows = A.NumRows(), dim = B.num_cols_,
+      num_panels = (B.num_rows_ + kPanelRows - 1) / kPanelRows;
+  if (num_rows == 0 || B.num_rows_ == 0)
+    return;
+  const uint16 *b = &(B.data_[0]);
+  size_t panel_size = static_cast<size_t>(kPanelRows) * (dim + dim % 2);
+  if (AddMatHalfMatSimd(alpha, A, B.type_, b, panel_size, num_panels, beta,
+                        C))
+    return;
+  // Convert each panel to float once, and multiply it by all rows of A.
+  HalfMatrixType type = B.type_;
+  std::vector<float> panel(static_cast<size_t>(kPanelRows) * dim);
+  MatrixIndexT panel_index = -1;
+  AddTiles(alpha, num_panels,
+           [&](MatrixIndexT p, MatrixIndexT i, MatrixIndexT tile_rows,
+               Real *out) {
+             if (p != panel_index) {
+               WidenPanel(type, b + p * panel_size, dim, &(panel[0]));
+               panel_index = p;
+             }
+             for (MatrixIndexT ii = 0; ii < tile_rows; ii++) {
+               const Real *a_row = A.RowData(i + ii);
+               Real acc[kPanelRows] = { 0.0 };
+               for (MatrixIndexT k = 0; k < dim; k++) {
+                 Real a_ik = a_row[k];
+                 const float *b_col = &(panel[k * kPanelRows]);
+                 for (MatrixIndexT j = 0; j < kPanelRows; j++)
+                   acc[j] += a_ik * b_col[j];
+               }
+               for (MatrixIndexT j = 0; j < kPanelRows; j++)
+                 out[ii * kPanelRows + j] = acc[j];
+             }
+           }, beta, C);
+}
+
+template
+void HalfMatrix::CopyFromMat(const MatrixBase<float> &mat,
+                             HalfMatrixType type);
+template
+void HalfMatrix::CopyFromMat(const MatrixBase<double> &mat,
+                             HalfMatrixType type);
+template
+void HalfMatrix::CopyToMat(MatrixBase<float> *mat) const;
+template
+void HalfMatrix::CopyToMat(MatrixBase<double> *mat) const;
+template
+void AddMatHalfMat(float alpha, const MatrixBase<float> &A,
+                   const HalfMatrix &B, float beta,
+                   MatrixBase<float> *C);
+template
+void AddMatHalfMat(double alpha, const MatrixBase<double> &A,
+                   const HalfMatrix &B, double beta,
+                   MatrixBase<double> *C);
+
+}  // namespace kaldi
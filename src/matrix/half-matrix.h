@@ -0,0 +1,150 @@
+// matrix/half-matrix.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_HALF_MATRIX_H_
+#define KALDI_MATRIX_HALF_MATRIX_H_
+
+#include <string>
+#include <vector>
+
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_group
+/// @{
+
+/// The 16-bit floating point formats of HalfMatrix.
+enum HalfMatrixType {
+  kFloat16 = 0,   // IEEE half precision: 5 bits of exponent, 10 of mantissa.
+  kBfloat16 = 1   // bfloat16: the top 16 bits of a float (8 bits of exponent,
+                  // 7 of mantissa).
+};
+
+/// Converts "fp16" or "bf16" to the type; returns false for anything else.
+bool ParseHalfMatrixType(const std::string &str, HalfMatrixType *type);
+
+/// Returns "fp16" or "bf16".
+const char *HalfMatrixTypeName(HalfMatrixType type);
+
+/// Conversions between float and the 16-bit formats, rounding to nearest
+/// even.  Floats too large for fp16 (from 65520 on) become infinity;
+/// NaN stays NaN.
+uint16 FloatToHalf(float f);
+float HalfToFloat(uint16 h);
+uint16 FloatToBfloat16(float f);
+float Bfloat16ToFloat(uint16 h);
+
+/*
+  HalfMatrix stores a matrix in 16-bit floating point, fp16 or bf16, which
+  takes half the memory of a float matrix.  It is meant for the weights of
+  neural network layers at test time (stored with one row per output
+  dimension, as in AffineComponent), when the memory of the models matters
+  more than the last bits of their parameters, e.g. for a server that keeps
+  many models loaded.  AddMatHalfMat() multiplies by it without converting
+  it back to float in memory; as it reads half as many bytes of B, it is
+  faster than AddMatMat() on CPUs with AVX2 or AVX-512, especially for few
+  rows of A.
+
+  fp16 keeps three more bits of mantissa than bf16 (relative error at most
+  2^-11 instead of 2^-8) but can only represent magnitudes up to 65504, and
+  below about 6e-5 it loses precision; CopyFromMat() clips larger values,
+  with a warning.  bf16 has the range of float.
+
+  Read() and Write() use the format of Matrix, so a HalfMatrix can be written
+  in place of a float matrix and read back as one, and vice versa.
+*/
+class HalfMatrix {
+ public:
+  HalfMatrix(): type_(kFloat16), num_rows_(0), num_cols_(0) { }
+
+  template<typename Real>
+  HalfMatrix(const MatrixBase<Real> &mat, HalfMatrixType type) {
+    CopyFromMat(mat, type);
+  }
+
+  /// This will resize *this and copy the contents of mat to *this.
+  template<typename Real>
+  void CopyFromMat(const MatrixBase<Real> &mat, HalfMatrixType type);
+
+  /// Copies the (rounded) contents to mat, which must have the correct size.
+  template<typename Real>
+  void CopyToMat(MatrixBase<Real> *mat) const;
+
+  HalfMatrixType Type() const { return type_; }
+  MatrixIndexT NumRows() const { return num_rows_; }
+  MatrixIndexT NumCols() const { return num_cols_; }
+
+  /// Returns the memory used, in bytes.
+  size_t SizeInBytes() const { return data_.size() * sizeof(uint16); }
+
+  /// Reads a matrix written by Matrix::Write() (or by Write()), converting
+  /// it to 'type'.
+  void Read(std::istream &is, bool binary, HalfMatrixType type);
+
+  /// Writes the matrix as a float Matrix.
+  void Write(std::ostream &os, bool binary) const;
+
+  void Swap(HalfMatrix *other);
+
+  void Clear();
+
+ private:
+  template<typename Real>
+  friend void AddMatHalfMat(Real alpha, const MatrixBase<Real> &A,
+                            const HalfMatrix &B, Real beta,
+                            MatrixBase<Real> *C);
+
+  // Returns the index in data_ of element (r, c).
+  inline size_t Index(MatrixIndexT r, MatrixIndexT c) const;
+
+  HalfMatrixType type_;
+  MatrixIndexT num_rows_;
+  MatrixIndexT num_cols_;
+  // The elements, in panels of 16 rows (the last one padded with zero rows),
+  // and within each panel in the order the kernels of AddMatHalfMat() read
+  // them: for fp16, column by column, so one column of a panel is 32 bytes;
+  // for bf16, in pairs of columns (the last one padded with a zero column if
+  // there is an odd number), and for each pair, the two elements of each of
+  // the 16 rows, so one 32-bit word holds the two elements of a row, as the
+  // AVX-512 BF16 instructions need.
+  std::vector<uint16> data_;
+};
+
+
+/**
+   Does *C = alpha * A * B^T + beta * *C, like AddMatMat() with B transposed,
+   where B is stored in 16-bit floating point.  Each panel of 16 rows of B is
+   read once for each four rows of A and converted to float in registers
+   (with AVX-512 or AVX2 and F16C where the CPU has them, see
+   GetSimdLevel()); the result is then the same as that of AddMatMat() with
+   the float version of B, up to roundoff.
+
+   One exception: if B is bf16 and the CPU has the AVX-512 BF16 instructions,
+   which multiply pairs of bf16 numbers, A is rounded to bf16 as well, so the
+   products have a relative error of up to about 2^-8 for each element of A.
+ */
+template<typename Real>
+void AddMatHalfMat(Real alpha, const MatrixBase<Real> &A,
+                   const HalfMatrix &B, Real beta,
+                   MatrixBase<Real> *C);
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_HALF_MATRIX_H_
@@ -26,7 +26,10 @@
 #include "matrix/jama-svd.h"
 #include "matrix/jama-eig.h"
 #include "matrix/compressed-matrix.h"
+#include "matrix/cpu-allocator.h"
+#include "matrix/csr-matrix.h"
 #include "matrix/sparse-matrix.h"
+#include "matrix/simd-math.h"
 
 static_assert(int(kaldi::kNoTrans) == int(CblasNoTrans) && int(kaldi::kTrans) == int(CblasTrans), 
     "kaldi::kNoTrans and kaldi::kTrans must be equal to the appropriate CBLAS library constants!");
@@ -440,50 +443,17 @@ void MatrixBase<Real>::AddSmatMat(Real alpha, const SparseMatrix<Real> &A,
     KALDI_ASSERT(NumRows() == A.NumRows());
     KALDI_ASSERT(NumCols() == B.NumCols());
     KALDI_ASSERT(A.NumCols() == B.NumRows());
-
-    this->Scale(beta);
-    MatrixIndexT a_num_rows = A.NumRows(),
-        this_num_cols = this->NumCols();
-    for (MatrixIndexT i = 0; i < a_num_rows; ++i) {
-      Real *this_row_i = this->RowData(i);
-      const SparseVector<Real> &A_row_i = A.Row(i);
-      MatrixIndexT num_elems = A_row_i.NumElements();
-      for (MatrixIndexT e = 0; e < num_elems; ++e) {
-        const std::pair<MatrixIndexT, Real> &p = A_row_i.GetElement(e);
-        MatrixIndexT k = p.first;
-        Real alpha_A_ik = alpha * p.second;
-        const Real *b_row_k = B.RowData(k);
-        cblas_Xaxpy(this_num_cols, alpha_A_ik, b_row_k, 1,
-                    this_row_i, 1);
-        //for (MatrixIndexT j = 0; j < this_num_cols; ++j)
-        //  this_row_i[j] += alpha_A_ik * b_row_k[j];
-      }
-    }
   } else {
     KALDI_ASSERT(NumRows() == A.NumCols());
     KALDI_ASSERT(NumCols() == B.NumCols());
     KALDI_ASSERT(A.NumRows() == B.NumRows());
-
-    this->Scale(beta);
-    Matrix<Real> buf(NumRows(), NumCols(), kSetZero);
-    MatrixIndexT a_num_rows = A.NumRows(),
-        this_num_cols = this->NumCols();
-    for (int k = 0; k < a_num_rows; ++k) {
-      const Real *b_row_k = B.RowData(k);
-      const SparseVector<Real> &A_row_k = A.Row(k);
-      MatrixIndexT num_elems = A_row_k.NumElements();
-      for (MatrixIndexT e = 0; e < num_elems; ++e) {
-        const std::pair<MatrixIndexT, Real> &p = A_row_k.GetElement(e);
-        MatrixIndexT i = p.first;
-        Real alpha_A_ki = alpha * p.second;
-        Real *this_row_i = this->RowData(i);
-        cblas_Xaxpy(this_num_cols, alpha_A_ki, b_row_k, 1,
-                    this_row_i, 1);
-        //for (MatrixIndexT j = 0; j < this_num_cols; ++j)
-        // this_row_i[j] += alpha_A_ki * b_row_k[j];
-      }
-    }
   }
+  // Copying A to the CSR format takes time proportional to its number of
+  // elements, which is small compared with the multiplication; the kernels
+  // of AddCsrMat() then sum the rows of B for each row of *this in
+  // registers.  For transA == kTrans we copy the transpose directly.
+  CsrMatrix<Real> csr(A, transA);
+  AddCsrMat(alpha, csr, kNoTrans, B, beta, this);
 }
 
 template<typename Real>
@@ -494,53 +464,102 @@ void MatrixBase<Real>::AddMatSmat(Real alpha, const MatrixBase<Real> &A,
     KALDI_ASSERT(NumRows() == A.NumRows());
     KALDI_ASSERT(NumCols() == B.NumCols());
     KALDI_ASSERT(A.NumCols() == B.NumRows());
-
-    this->Scale(beta);
-    MatrixIndexT b_num_rows = B.NumRows(),
-        this_num_rows = this->NumRows();
-    // Iterate over the rows of sparse matrix B and columns of A.
-    for (MatrixIndexT k = 0; k < b_num_rows; ++k) {
-      const SparseVector<Real> &B_row_k = B.Row(k);
-      MatrixIndexT num_elems = B_row_k.NumElements();
-      const Real *a_col_k = A.Data() + k;
-      for (MatrixIndexT e = 0; e < num_elems; ++e) {
-        const std::pair<MatrixIndexT, Real> &p = B_row_k.GetElement(e);
-        MatrixIndexT j = p.first;
-        Real alpha_B_kj = alpha * p.second;
-        Real *this_col_j = this->Data() + j;
-        // Add to entire 'j'th column of *this at once using cblas_Xaxpy.
-        // pass stride to write a colmun as matrices are stored in row major order.
-        cblas_Xaxpy(this_num_rows, alpha_B_kj, a_col_k, A.stride_,
-                    this_col_j, this->stride_);
-        //for (MatrixIndexT i = 0; i < this_num_rows; ++i)
-        // this_col_j[i*this->stride_] +=  alpha_B_kj * a_col_k[i*A.stride_];
-      }
-    }
   } else {
     KALDI_ASSERT(NumRows() == A.NumRows());
     KALDI_ASSERT(NumCols() == B.NumRows());
     KALDI_ASSERT(A.NumCols() == B.NumCols());
+  }
+  // Each element of *this is the dot product of a row of A with a row of
+  // op(B)^T, which for transB == kNoTrans is a column of B, so in that case
+  // we copy the transpose of B to the CSR format.  This avoids adding to
+  // the columns of *this with a stride, as we used to.
+  CsrMatrix<Real> csr(B, transB == kNoTrans ? kTrans : kNoTrans);
+  AddMatCsr(alpha, A, csr, kTrans, beta, this);
+}
 
-    this->Scale(beta);
-    MatrixIndexT b_num_rows = B.NumRows(),
-        this_num_rows = this->NumRows();
-    // Iterate over the rows of sparse matrix B and columns of *this.
-    for (MatrixIndexT j = 0; j < b_num_rows; ++j) {
-      const SparseVector<Real> &B_row_j = B.Row(j);
-      MatrixIndexT num_elems = B_row_j.NumElements();
-      Real *this_col_j = this->Data() + j;
-      for (MatrixIndexT e = 0; e < num_elems; ++e) {
-        const std::pair<MatrixIndexT, Real> &p = B_row_j.GetElement(e);
-        MatrixIndexT k = p.first;
-        Real alpha_B_jk = alpha * p.second;
-        const Real *a_col_k = A.Data() + k;
-        // Add to entire 'j'th column of *this at once using cblas_Xaxpy.
-        // pass stride to write a column as matrices are stored in row major order.
-        cblas_Xaxpy(this_num_rows, alpha_B_jk, a_col_k, A.stride_,
-                    this_col_j, this->stride_);
-        //for (MatrixIndexT i = 0; i < this_num_rows; ++i) 
-        // this_col_j[i*this->stride_] +=  alpha_B_jk * a_col_k[i*A.stride_];
-      }
+template<typename Real>
+void MatrixBase<Real>::AddCmatMat(Real alpha, const CompressedMatrix &A,
+                                  MatrixTransposeType transA,
+                                  const MatrixBase<Real> &B,
+                                  MatrixTransposeType transB, Real beta) {
+  MatrixIndexT a_num_rows = A.NumRows(), a_num_cols = A.NumCols(),
+      block_rows = A.NumBlockRows();
+  if (a_num_rows == 0) {  // *this is empty, or it is a sum over nothing.
+    if (beta == 0.0) SetZero();
+    else Scale(beta);
+    return;
+  }
+  if (num_rows_ == 0 || num_cols_ == 0)
+    return;
+  if (transA == kNoTrans) {
+    KALDI_ASSERT(NumRows() == a_num_rows);
+    // Each block of rows of A gives the same rows of *this.
+    Matrix<Real> block(block_rows, a_num_cols, kUndefined);
+    for (MatrixIndexT r = 0; r < a_num_rows; r += block_rows) {
+      MatrixIndexT n = std::min(block_rows, a_num_rows - r);
+      SubMatrix<Real> a_block(block, 0, n, 0, a_num_cols),
+          this_block(*this, r, n, 0, num_cols_);
+      A.CopyToMat(r, 0, &a_block);
+      this_block.AddMatMat(alpha, a_block, kNoTrans, B, transB, beta);
+    }
+  } else {
+    KALDI_ASSERT(NumRows() == a_num_cols);
+    // Each block of rows of A is a block of the dimension we sum over;
+    // beta applies only to the first.
+    Matrix<Real> block(block_rows, a_num_cols, kUndefined);
+    for (MatrixIndexT r = 0; r < a_num_rows; r += block_rows) {
+      MatrixIndexT n = std::min(block_rows, a_num_rows - r);
+      SubMatrix<Real> a_block(block, 0, n, 0, a_num_cols);
+      A.CopyToMat(r, 0, &a_block);
+      if (transB == kNoTrans)
+        AddMatMat(alpha, a_block, kTrans, B.RowRange(r, n), kNoTrans,
+                  r == 0 ? beta : 1.0);
+      else
+        AddMatMat(alpha, a_block, kTrans, B.ColRange(r, n), kTrans,
+                  r == 0 ? beta : 1.0);
+    }
+  }
+}
+
+template<typename Real>
+void MatrixBase<Real>::AddMatCmat(Real alpha, const MatrixBase<Real> &A,
+                                  MatrixTransposeType transA,
+                                  const CompressedMatrix &B,
+                                  MatrixTransposeType transB, Real beta) {
+  MatrixIndexT b_num_rows = B.NumRows(), b_num_cols = B.NumCols(),
+      block_rows = B.NumBlockRows();
+  if (b_num_rows == 0) {  // *this is empty, or it is a sum over nothing.
+    if (beta == 0.0) SetZero();
+    else Scale(beta);
+    return;
+  }
+  if (num_rows_ == 0 || num_cols_ == 0)
+    return;
+  if (transB == kTrans) {
+    KALDI_ASSERT(NumCols() == b_num_rows);
+    // Each block of rows of B gives the same columns of *this.
+    Matrix<Real> block(block_rows, b_num_cols, kUndefined);
+    for (MatrixIndexT r = 0; r < b_num_rows; r += block_rows) {
+      MatrixIndexT n = std::min(block_rows, b_num_rows - r);
+      SubMatrix<Real> b_block(block, 0, n, 0, b_num_cols),
+          this_block(*this, 0, num_rows_, r, n);
+      B.CopyToMat(r, 0, &b_block);
+      this_block.AddMatMat(alpha, A, transA, b_block, kTrans, beta);
+    }
+  } else {
+    KALDI_ASSERT(NumCols() == b_num_cols);
+    // Each block of rows of B is a block of the dimension we sum over.
+    Matrix<Real> block(block_rows, b_num_cols, kUndefined);
+    for (MatrixIndexT r = 0; r < b_num_rows; r += block_rows) {
+      MatrixIndexT n = std::min(block_rows, b_num_rows - r);
+      SubMatrix<Real> b_block(block, 0, n, 0, b_num_cols);
+      B.CopyToMat(r, 0, &b_block);
+      if (transA == kNoTrans)
+        AddMatMat(alpha, A.ColRange(r, n), kNoTrans, b_block, kNoTrans,
+                  r == 0 ? beta : 1.0);
+      else
+        AddMatMat(alpha, A.RowRange(r, n), kTrans, b_block, kNoTrans,
+                  r == 0 ? beta : 1.0);
     }
   }
 }
@@ -793,8 +812,6 @@ inline void Matrix<Real>::Init(const MatrixIndexT rows,
   KALDI_ASSERT(rows > 0 && cols > 0);
   MatrixIndexT skip, stride;
   size_t size;
-  void *data;  // aligned memory block
-  void *temp;  // memory block to be really freed
 
   // compute the size of skip and real cols
   skip = ((16 / sizeof(Real)) - cols % (16 / sizeof(Real)))
@@ -803,15 +820,13 @@ inline void Matrix<Real>::Init(const MatrixIndexT rows,
   size = static_cast<size_t>(rows) * static_cast<size_t>(stride)
       * sizeof(Real);
 
-  // allocate the memory and set the right dimensions and parameters
-  if (NULL != (data = KALDI_MEMALIGN(16, size, &temp))) {
-    MatrixBase<Real>::data_        = static_cast<Real *> (data);
-    MatrixBase<Real>::num_rows_      = rows;
-    MatrixBase<Real>::num_cols_      = cols;
-    MatrixBase<Real>::stride_  = (stride_type == kDefaultStride ? stride : cols);
-  } else {
-    throw std::bad_alloc();
-  }
+  // allocate the memory (this throws std::bad_alloc on failure) and set the
+  // right dimensions and parameters
+  MatrixBase<Real>::data_ = static_cast<Real *>(
+      CpuMemoryAllocator::Instantiate().Malloc(size));
+  MatrixBase<Real>::num_rows_      = rows;
+  MatrixBase<Real>::num_cols_      = cols;
+  MatrixBase<Real>::stride_  = (stride_type == kDefaultStride ? stride : cols);
 }
 
 template<typename Real>
@@ -1127,7 +1142,7 @@ template<typename Real>
 void Matrix<Real>::Destroy() {
   // we need to free the data block if it was defined
   if (NULL != MatrixBase<Real>::data_)
-    KALDI_MEMALIGN_FREE( MatrixBase<Real>::data_);
+    CpuMemoryAllocator::Instantiate().Free(MatrixBase<Real>::data_);
   MatrixBase<Real>::data_ = NULL;
   MatrixBase<Real>::num_rows_ = MatrixBase<Real>::num_cols_
       = MatrixBase<Real>::stride_ = 0;
@@ -2712,6 +2727,17 @@ Real MatrixBase<Real>::ApplySoftMax() {
   return max + Log(sum);
 }
 
+template<>
+float MatrixBase<float>::ApplySoftMax() {
+  float max = this->Max(), sum = 0.0;
+  for (MatrixIndexT i = 0; i < num_rows_; i++) {
+    float *row_data = this->RowData(i);
+    sum += SimdExpShiftSum(row_data, max, row_data, num_cols_);
+  }
+  this->Scale(1.0 / sum);
+  return max + Log(sum);
+}
+
 template<typename Real>
 void MatrixBase<Real>::Tanh(const MatrixBase<Real> &src) {
   KALDI_ASSERT(SameDim(*this, src));
@@ -570,6 +570,8 @@ class MatrixBase {
 
   /// (*this) = alpha * op(A) * B + beta * (*this), where A is sparse.
   /// Multiplication of sparse with dense matrix.  See also AddMatSmat.
+  /// A is copied to a CsrMatrix for AddCsrMat(); if you multiply by the
+  /// same sparse matrix many times, it is faster to do that once yourself.
   void AddSmatMat(Real alpha, const SparseMatrix<Real> &A,
                   MatrixTransposeType transA, const MatrixBase<Real> &B,
                   Real beta);
@@ -577,11 +579,26 @@ class MatrixBase {
   /// (*this) = alpha * A * op(B) + beta * (*this), where B is sparse
   /// and op(B) is either B or trans(B) depending on the 'transB' argument.
   /// This is multiplication of a dense by a sparse matrix.  See also
-  /// AddSmatMat.
+  /// AddSmatMat.  B is copied to a CsrMatrix for AddMatCsr().
   void AddMatSmat(Real alpha, const MatrixBase<Real> &A,
                   const SparseMatrix<Real> &B, MatrixTransposeType transB,
                   Real beta);
 
+  /// (*this) = alpha * op(A) * op(B) + beta * (*this), where A is compressed.
+  /// A is decompressed a block of rows at a time (see
+  /// CompressedMatrix::NumBlockRows()), each block going straight into
+  /// AddMatMat() while it is in cache, so A is never decompressed in full.
+  /// The result is the same as decompressing A first, up to roundoff.
+  void AddCmatMat(Real alpha, const CompressedMatrix &A,
+                  MatrixTransposeType transA, const MatrixBase<Real> &B,
+                  MatrixTransposeType transB, Real beta);
+
+  /// (*this) = alpha * op(A) * op(B) + beta * (*this), where B is compressed;
+  /// see AddCmatMat().
+  void AddMatCmat(Real alpha, const MatrixBase<Real> &A,
+                  MatrixTransposeType transA, const CompressedMatrix &B,
+                  MatrixTransposeType transB, Real beta);
+
   /// *this = beta * *this + alpha * M M^T, for symmetric matrices.  It only
   /// updates the lower triangle of *this.  It will leave the matrix asymmetric;
   /// if you need it symmetric as a regular matrix, do CopyLowerToUpper().
@@ -26,8 +26,10 @@
 #include <algorithm>
 #include <string>
 #include "matrix/cblas-wrappers.h"
+#include "matrix/cpu-allocator.h"
 #include "matrix/kaldi-vector.h"
 #include "matrix/kaldi-matrix.h"
+#include "matrix/simd-math.h"
 #include "matrix/sp-matrix.h"
 #include "matrix/sparse-matrix.h"
 
@@ -171,18 +173,10 @@ inline void Vector<Real>::Init(const MatrixIndexT dim) {
     this->data_ = NULL;
     return;
   }
-  MatrixIndexT size;
-  void *data;
-  void *free_data;
-
-  size = dim * sizeof(Real);
-
-  if ((data = KALDI_MEMALIGN(16, size, &free_data)) != NULL) {
-    this->data_ = static_cast<Real*> (data);
-    this->dim_ = dim;
-  } else {
-    throw std::bad_alloc();
-  }
+  // this throws std::bad_alloc on failure.
+  this->data_ = static_cast<Real*>(
+      CpuMemoryAllocator::Instantiate().Malloc(dim * sizeof(Real)));
+  this->dim_ = dim;
 }
 
 
@@ -279,7 +273,7 @@ template<typename Real>
 void Vector<Real>::Destroy() {
   /// we need to free the data block if it was defined
   if (this->data_ != NULL)
-    KALDI_MEMALIGN_FREE(this->data_);
+    CpuMemoryAllocator::Instantiate().Free(this->data_);
   this->data_ = NULL;
   this->dim_ = 0;
 }
@@ -793,6 +787,14 @@ void VectorBase<Real>::ApplyLog() {
   }
 }
 
+template<>
+void VectorBase<float>::ApplyLog() {
+  for (MatrixIndexT i = 0; i < dim_; i++)
+    if (data_[i] < 0.0)
+      KALDI_ERR << "Trying to take log of a negative number.";
+  SimdLog(data_, data_, dim_);
+}
+
 template<typename Real>
 void VectorBase<Real>::ApplyLogAndCopy(const VectorBase<Real> &v) {
   KALDI_ASSERT(dim_ == v.Dim());
@@ -808,6 +810,11 @@ void VectorBase<Real>::ApplyExp() {
   }
 }
 
+template<>
+void VectorBase<float>::ApplyExp() {
+  SimdExp(data_, data_, dim_);
+}
+
 template<typename Real>
 void VectorBase<Real>::ApplyAbs() {
   for (MatrixIndexT i = 0; i < dim_; i++) { data_[i] = std::abs(data_[i]); }
@@ -883,6 +890,23 @@ Real VectorBase<Real>::ApplyLogSoftMax() {
   return max + sum;
 }
 
+template<>
+float VectorBase<float>::ApplySoftMax() {
+  float max = this->Max(),
+      sum = SimdExpShiftSum(data_, max, data_, dim_);
+  this->Scale(1.0 / sum);
+  return max + Log(sum);
+}
+
+template<>
+float VectorBase<float>::ApplyLogSoftMax() {
+  float max = this->Max();
+  this->Add(-1.0 * max);
+  float sum = Log(SimdExpShiftSum(data_, 0.0, NULL, dim_));
+  this->Add(-1.0 * sum);
+  return max + sum;
+}
+
 #ifdef HAVE_MKL
 template<>
 void VectorBase<float>::Tanh(const VectorBase<float> &src) {
@@ -910,6 +934,12 @@ void VectorBase<Real>::Tanh(const VectorBase<Real> &src) {
     data_[i] = x;
   }
 }
+
+template<>
+void VectorBase<float>::Tanh(const VectorBase<float> &src) {
+  KALDI_ASSERT(dim_ == src.dim_);
+  SimdTanh(src.data_, data_, dim_);
+}
 #endif
 
 #ifdef HAVE_MKL
@@ -948,6 +978,12 @@ void VectorBase<Real>::Sigmoid(const VectorBase<Real> &src) {
     data_[i] = x;
   }
 }
+
+template<>
+void VectorBase<float>::Sigmoid(const VectorBase<float> &src) {
+  KALDI_ASSERT(dim_ == src.dim_);
+  SimdSigmoid(src.data_, data_, dim_);
+}
 #endif
 
 
@@ -60,6 +60,18 @@ template<typename Real> static void UnitTestSplitRadixRealFftSpeed() {
   CsvResult<Real>(__func__, 512, t.Elapsed(), "seconds");
 }
 
+// The same number of frames as UnitTestSplitRadixRealFftSpeed(), in blocks of
+// 100 as feature extraction does them.
+template<typename Real> static void UnitTestBatchedRealFftSpeed() {
+  Timer t;
+  MatrixIndexT sz = 512;
+  BatchedRealFft<Real> batched_fft(sz);
+  Matrix<Real> frames(100, sz);
+  for (MatrixIndexT i = 0; i < 60; i++)
+    batched_fft.Compute(&frames);
+  CsvResult<Real>(__func__, 512, t.Elapsed(), "seconds");
+}
+
 template<typename Real>
 static void UnitTestSvdSpeed() {
   Timer t;
@@ -254,15 +266,313 @@ static void UnitTestAddVecToColsSpeed() {
   CsvResult<Real>(__func__, sizes.size(), t.Elapsed(), "seconds");
 }
 
+// Times the functions of simd-math.h at each instruction set the CPU
+// supports, and checks their accuracy against double precision.
+static void UnitTestSimdMathSpeed() {
+  typedef void (*SimdFunction)(const float*, float*, MatrixIndexT);
+  const char *names[] = { "Exp", "Log", "Sigmoid", "Tanh" };
+  SimdFunction functions[] = { SimdExp, SimdLog, SimdSigmoid, SimdTanh };
+  const char *level_names[] = { "none", "avx2", "avx512" };
+  MatrixIndexT dim = 4096;
+  Vector<float> x(dim), y(dim);
+  SimdLevel cpu_level = (SetSimdLevel(kSimdAvx512), GetSimdLevel());
+  for (int32 level = kSimdNone; level <= cpu_level; level++) {
+    SetSimdLevel(static_cast<SimdLevel>(level));
+    for (int32 f = 0; f < 4; f++) {
+      for (MatrixIndexT i = 0; i < dim; i++) {
+        if (f == 1)  // log: positive numbers over a wide range.
+          x(i) = std::exp(RandUniform() * 160.0 - 80.0);
+        else
+          x(i) = RandUniform() * 40.0 - 20.0;
+      }
+      int32 iter = 0;
+      Timer t1;
+      for (; t1.Elapsed() < 0.05; iter++)
+        functions[f](x.Data(), y.Data(), dim);
+      BaseFloat gvalues = (static_cast<BaseFloat>(dim) * iter) /
+          (t1.Elapsed() * 1.0e+09);
+      double max_err = 0.0;
+      for (MatrixIndexT i = 0; i < dim; i++) {
+        double xi = x(i), ref;
+        switch (f) {
+          case 0: ref = std::exp(xi); break;
+          case 1: ref = std::log(xi); break;
+          case 2: ref = 1.0 / (1.0 + std::exp(-xi)); break;
+          default: ref = std::tanh(xi);
+        }
+        float yref = ref, ulp = std::nextafter(
+            std::abs(yref), std::numeric_limits<float>::max()) - std::abs(yref);
+        max_err = std::max(max_err, std::abs(y(i) - ref) / ulp);
+      }
+      std::string name = std::string("Simd") + names[f] + "," +
+          level_names[level];
+      CsvResult<float>(name, dim, gvalues, "gigavalues/sec");
+      CsvResult<float>(name, dim, max_err, "max ulp error");
+      // The scalar tanh loses precision near zero; see simd-math.h for the
+      // bounds of the vectorized versions.
+      if (level != kSimdNone)
+        KALDI_ASSERT(max_err <= (f < 2 ? 2.0 : 3.0));
+    }
+  }
+  SetSimdLevel(cpu_level);
+}
+
+// Compares SimdLogSumExp() on doubles with the loop of LogAdd() calls it
+// replaces in the lattice forward-backward code, for arrays of the sizes of
+// the numbers of arcs of lattice states.
+static void UnitTestLogSumExpSpeed() {
+  const char *level_names[] = { "none", "avx2", "avx512" };
+  SimdLevel cpu_level = (SetSimdLevel(kSimdAvx512), GetSimdLevel());
+  for (MatrixIndexT dim = 4; dim <= 256; dim *= 4) {
+    Vector<double> x(dim);
+    for (MatrixIndexT i = 0; i < dim; i++)
+      x(i) = RandUniform() * 20.0 - 10.0;
+    int32 iter = 0;
+    double sum = 0.0;
+    Timer t1;
+    for (; t1.Elapsed() < 0.05; iter++) {
+      double log_sum = kLogZeroDouble;
+      for (MatrixIndexT i = 0; i < dim; i++)
+        log_sum = LogAdd(log_sum, x(i));
+      sum += log_sum;
+    }
+    BaseFloat gvalues = (static_cast<BaseFloat>(dim) * iter) /
+        (t1.Elapsed() * 1.0e+09);
+    CsvResult<double>("LogAdd", dim, gvalues, "gigavalues/sec");
+    for (int32 level = kSimdNone; level <= cpu_level; level++) {
+      SetSimdLevel(static_cast<SimdLevel>(level));
+      iter = 0;
+      Timer t2;
+      for (; t2.Elapsed() < 0.05; iter++)
+        sum += SimdLogSumExp(x.Data(), dim);
+      gvalues = (static_cast<BaseFloat>(dim) * iter) /
+          (t2.Elapsed() * 1.0e+09);
+      CsvResult<double>(std::string("SimdLogSumExp,") + level_names[level],
+                        dim, gvalues, "gigavalues/sec");
+    }
+    KALDI_ASSERT(sum == sum);  // so the loops are not optimized away.
+  }
+  SetSimdLevel(cpu_level);
+}
+
+// Compares AddMatQuantizedMat() with AddMatMat() on the shapes of the
+// forward pass of a neural-net layer: a batch of frames times the weights.
+static void UnitTestQuantizedMatMatSpeed() {
+  const char *level_names[] = { "none", "avx2", "avx512" };
+  SimdLevel cpu_level = (SetSimdLevel(kSimdAvx512), GetSimdLevel());
+  MatrixIndexT num_frames = 256;
+  for (MatrixIndexT dim = 256; dim <= 2048; dim *= 2) {
+    Matrix<float> input(num_frames, dim), weights(dim, dim),
+        output(num_frames, dim);
+    input.SetRandn();
+    input.ApplyFloor(0.0);
+    weights.SetRandn();
+    QuantizedMatrix quantized(weights);
+    BaseFloat fdim = dim;
+    int32 iter = 0;
+    Timer t1;
+    for (; t1.Elapsed() < 0.1; iter++)
+      output.AddMatMat(1.0, input, kNoTrans, weights, kTrans, 0.0);
+    BaseFloat gflops = (2.0 * num_frames * fdim * fdim * iter) /
+        (t1.Elapsed() * 1.0e+09);
+    CsvResult<float>("AddMatMat", dim, gflops, "gigaflops");
+    for (int32 level = kSimdNone; level <= cpu_level; level++) {
+      SetSimdLevel(static_cast<SimdLevel>(level));
+      iter = 0;
+      Timer t2;
+      for (; t2.Elapsed() < 0.1; iter++)
+        AddMatQuantizedMat(1.0f, input, quantized, 0.0f, &output);
+      gflops = (2.0 * num_frames * fdim * fdim * iter) /
+          (t2.Elapsed() * 1.0e+09);
+      CsvResult<float>(std::string("AddMatQuantizedMat,") +
+                       level_names[level], dim, gflops, "gigaflops");
+    }
+    SetSimdLevel(cpu_level);
+  }
+}
+
+// Compares decompressing a minibatch of compressed features and multiplying,
+// with doing it a block at a time with AddCmatMat().
+template<typename Real>
+static void UnitTestCompressedMatMatSpeed() {
+  MatrixIndexT num_frames = 4096, output_dim = 512;
+  for (MatrixIndexT dim = 40; dim <= 1280; dim *= 2) {
+    Matrix<Real> features(num_frames, dim), weights(output_dim, dim),
+        output(num_frames, output_dim);
+    features.SetRandn();
+    weights.SetRandn();
+    CompressedMatrix cmat(features);
+    int32 iter = 0;
+    Timer t1;
+    for (; t1.Elapsed() < 0.2; iter++) {
+      Matrix<Real> full(cmat);
+      output.AddMatMat(1.0, full, kNoTrans, weights, kTrans, 0.0);
+    }
+    BaseFloat fdim = dim,
+        gflops = (2.0 * num_frames * fdim * output_dim * iter) /
+        (t1.Elapsed() * 1.0e+09);
+    CsvResult<Real>("CompressedMatrix::CopyToMat+AddMatMat", dim, gflops,
+                    "gigaflops");
+    iter = 0;
+    Timer t2;
+    for (; t2.Elapsed() < 0.2; iter++)
+      output.AddCmatMat(1.0, cmat, kNoTrans, weights, kTrans, 0.0);
+    gflops = (2.0 * num_frames * fdim * output_dim * iter) /
+        (t2.Elapsed() * 1.0e+09);
+    CsvResult<Real>("AddCmatMat", dim, gflops, "gigaflops");
+  }
+}
+
+// Compares AddMatMat() with AddMatPanelMat() for a few rows times a
+// weight matrix, as in online decoding.
+static void UnitTestPanelMatMatSpeed() {
+  const char *level_names[] = { "none", "avx2", "avx512" };
+  SimdLevel cpu_level = (SetSimdLevel(kSimdAvx512), GetSimdLevel());
+  for (MatrixIndexT dim = 256; dim <= 1024; dim *= 2) {
+    for (MatrixIndexT num_frames = 1; num_frames <= 64; num_frames *= 2) {
+      Matrix<float> input(num_frames, dim), weights(dim, dim),
+          output(num_frames, dim);
+      input.SetRandn();
+      weights.SetRandn();
+      PanelMatrix packed(weights);
+      BaseFloat fdim = dim;
+      int32 iter = 0;
+      Timer t1;
+      for (; t1.Elapsed() < 0.05; iter++)
+        output.AddMatMat(1.0, input, kNoTrans, weights, kTrans, 0.0);
+      BaseFloat gflops = (2.0 * num_frames * fdim * fdim * iter) /
+          (t1.Elapsed() * 1.0e+09);
+      std::ostringstream name;
+      name << "AddMatMat," << num_frames << "-rows";
+      CsvResult<float>(name.str(), dim, gflops, "gigaflops");
+      for (int32 level = kSimdNone; level <= cpu_level; level++) {
+        SetSimdLevel(static_cast<SimdLevel>(level));
+        iter = 0;
+        Timer t2;
+        for (; t2.Elapsed() < 0.05; iter++)
+          AddMatPanelMat(1.0f, input, packed, 0.0f, &output);
+        gflops = (2.0 * num_frames * fdim * fdim * iter) /
+            (t2.Elapsed() * 1.0e+09);
+        std::ostringstream name2;
+        name2 << "AddMatPanelMat," << level_names[level] << ","
+              << num_frames << "-rows";
+        CsvResult<float>(name2.str(), dim, gflops, "gigaflops");
+      }
+      SetSimdLevel(cpu_level);
+    }
+  }
+}
+
+// Compares AddMatHalfMat() with AddMatMat() for batches of a few to many
+// frames times a weight matrix.
+static void UnitTestHalfMatMatSpeed() {
+  const char *level_names[] = { "none", "avx2", "avx512" };
+  SimdLevel cpu_level = (SetSimdLevel(kSimdAvx512), GetSimdLevel());
+  for (MatrixIndexT dim = 256; dim <= 2048; dim *= 2) {
+    for (MatrixIndexT num_frames = 1; num_frames <= 256; num_frames *= 16) {
+      Matrix<float> input(num_frames, dim), weights(dim, dim),
+          output(num_frames, dim);
+      input.SetRandn();
+      weights.SetRandn();
+      BaseFloat fdim = dim;
+      int32 iter = 0;
+      Timer t1;
+      for (; t1.Elapsed() < 0.05; iter++)
+        output.AddMatMat(1.0, input, kNoTrans, weights, kTrans, 0.0);
+      BaseFloat gflops = (2.0 * num_frames * fdim * fdim * iter) /
+          (t1.Elapsed() * 1.0e+09);
+      std::ostringstream name;
+      name << "AddMatMat," << num_frames << "-rows";
+      CsvResult<float>(name.str(), dim, gflops, "gigaflops");
+      for (int32 t = 0; t < 2; t++) {
+        HalfMatrixType type = (t == 0 ? kFloat16 : kBfloat16);
+        HalfMatrix half(weights, type);
+        for (int32 level = kSimdNone; level <= cpu_level; level++) {
+          SetSimdLevel(static_cast<SimdLevel>(level));
+          iter = 0;
+          Timer t2;
+          for (; t2.Elapsed() < 0.05; iter++)
+            AddMatHalfMat(1.0f, input, half, 0.0f, &output);
+          gflops = (2.0 * num_frames * fdim * fdim * iter) /
+              (t2.Elapsed() * 1.0e+09);
+          std::ostringstream name2;
+          name2 << "AddMatHalfMat," << HalfMatrixTypeName(type) << ","
+                << level_names[level] << "," << num_frames << "-rows";
+          CsvResult<float>(name2.str(), dim, gflops, "gigaflops");
+        }
+        SetSimdLevel(cpu_level);
+      }
+    }
+  }
+}
+
+// Times AddSmatMat() and AddMatSmat(), which use the CSR kernels, for sparse
+// matrices with 1 or 8 elements per row (like one-hot word inputs and word
+// features), for each instruction set.
+static void UnitTestSparseMatMatSpeed() {
+  const char *level_names[] = { "none", "avx2", "avx512" };
+  SimdLevel cpu_level = (SetSimdLevel(kSimdAvx512), GetSimdLevel());
+  const MatrixIndexT num_rows = 1024, sparse_dim = 4096;
+  for (MatrixIndexT dim = 64; dim <= 1024; dim *= 4) {
+    for (int32 per_row = 1; per_row <= 8; per_row *= 8) {
+      std::vector<std::vector<std::pair<MatrixIndexT, float> > > pairs(
+          num_rows);
+      for (MatrixIndexT r = 0; r < num_rows; r++)
+        for (int32 e = 0; e < per_row; e++)
+          pairs[r].push_back(std::make_pair(RandInt(0, sparse_dim - 1),
+                                            RandGauss()));
+      SparseMatrix<float> smat(sparse_dim, pairs);
+      Matrix<float> B(sparse_dim, dim), C(num_rows, dim), D(dim, sparse_dim);
+      B.SetRandn();
+      C.SetRandn();
+      Matrix<float> C_trans(C, kTrans);
+      BaseFloat flops = 2.0 * smat.NumElements() * dim;
+      for (int32 level = kSimdNone; level <= cpu_level; level++) {
+        SetSimdLevel(static_cast<SimdLevel>(level));
+        for (int32 t = 0; t < 3; t++) {
+          int32 iter = 0;
+          Timer timer;
+          for (; timer.Elapsed() < 0.05; iter++) {
+            if (t == 0)  // C = A B.
+              C.AddSmatMat(1.0, smat, kNoTrans, B, 0.0);
+            else if (t == 1)  // B = A^T C, e.g. the derivative of B.
+              B.AddSmatMat(1.0, smat, kTrans, C, 0.0);
+            else  // D = C^T A.
+              D.AddMatSmat(1.0, C_trans, smat, kNoTrans, 0.0);
+          }
+          BaseFloat gflops = flops * iter / (timer.Elapsed() * 1.0e+09);
+          const char *names[] = { "AddSmatMat", "AddSmatMat-trans",
+                                  "AddMatSmat" };
+          std::ostringstream name;
+          name << names[t] << "," << level_names[level] << "," << per_row
+               << "-per-row";
+          CsvResult<float>(name.str(), dim, gflops, "gigaflops");
+        }
+      }
+      SetSimdLevel(cpu_level);
+    }
+  }
+}
+
 template<typename Real> static void MatrixUnitSpeedTest() {
   UnitTestRealFftSpeed<Real>();
   UnitTestSplitRadixRealFftSpeed<Real>();
+  UnitTestBatchedRealFftSpeed<Real>();
   UnitTestSvdSpeed<Real>();
   UnitTestAddMatMatSpeed<Real>();
   UnitTestAddRowSumMatSpeed<Real>();
   UnitTestAddColSumMatSpeed<Real>();
   UnitTestAddVecToRowsSpeed<Real>();
   UnitTestAddVecToColsSpeed<Real>();
+  UnitTestCompressedMatMatSpeed<Real>();
+  if (sizeof(Real) == sizeof(float)) {
+    UnitTestSimdMathSpeed();
+    UnitTestLogSumExpSpeed();
+    UnitTestQuantizedMatMatSpeed();
+    UnitTestPanelMatMatSpeed();
+    UnitTestHalfMatMatSpeed();
+    UnitTestSparseMatMatSpeed();
+  }
 }
 
 } // namespace kaldi
@@ -2811,6 +2811,107 @@ template<typename Real> static void UnitTestApplyExpSpecial() {
   AssertEqual(mat, A);
 }
 
+// Returns the error of 'f' in units of the last place of the float nearest
+// 'ref'.
+static double UlpError(float f, double ref) {
+  float r = static_cast<float>(ref);
+  if (KALDI_ISNAN(r)) return (KALDI_ISNAN(f) ? 0.0 : 1.0e+10);
+  if (KALDI_ISINF(r)) return (f == r ? 0.0 : 1.0e+10);
+  float ulp = std::nextafter(std::abs(r), std::numeric_limits<float>::max()) -
+      std::abs(r);
+  return std::abs(f - ref) / ulp;
+}
+
+static void UnitTestSimdMath() {
+  SimdLevel cpu_level = (SetSimdLevel(kSimdAvx512), GetSimdLevel());
+  for (int32 level = kSimdNone; level <= cpu_level; level++) {
+    SetSimdLevel(static_cast<SimdLevel>(level));
+    // Odd sizes, to exercise the partial vectors at the end.
+    MatrixIndexT dim = RandInt(1, 100);
+    Vector<float> x(dim), y(dim);
+    for (MatrixIndexT i = 0; i < dim; i++)
+      x(i) = RandUniform() * 170.0 - 85.0;
+    SimdExp(x.Data(), y.Data(), dim);
+    for (MatrixIndexT i = 0; i < dim; i++)
+      KALDI_ASSERT(UlpError(y(i), std::exp(static_cast<double>(x(i)))) <= 2.0);
+    float sum = SimdExpShiftSum(x.Data(), 10.0, NULL, dim);
+    double ref_sum = 0.0;
+    for (MatrixIndexT i = 0; i < dim; i++)
+      ref_sum += std::exp(static_cast<double>(x(i)) - 10.0);
+    KALDI_ASSERT(std::abs(sum - ref_sum) <= 1.0e-05 * ref_sum);
+    KALDI_ASSERT(std::abs(SimdLogSumExp(x.Data(), dim) -
+                          (10.0 + std::log(ref_sum))) <= 1.0e-04);
+
+    // The double log-sum-exp should be about as exact as LogAdd().
+    Vector<double> xd(dim);
+    for (MatrixIndexT i = 0; i < dim; i++)
+      xd(i) = RandUniform() * (i % 2 == 0 ? 40.0 : 1500.0) - 700.0;
+    double log_sum = kLogZeroDouble;
+    for (MatrixIndexT i = 0; i < dim; i++)
+      log_sum = LogAdd(log_sum, xd(i));
+    KALDI_ASSERT(std::abs(SimdLogSumExp(xd.Data(), dim) - log_sum) <=
+                 1.0e-13 * std::abs(log_sum));
+    double dinf = std::numeric_limits<double>::infinity(),
+        dspecial[] = { -dinf, -1.0, -dinf, 2.0, 1.0e+300, -1.0e+300 };
+    KALDI_ASSERT(SimdLogSumExp(dspecial, 0) == -dinf &&
+                 SimdLogSumExp(dspecial, 1) == -dinf &&
+                 SimdLogSumExp(dspecial, 2) == -1.0 &&
+                 std::abs(SimdLogSumExp(dspecial, 4) -
+                          (2.0 + std::log1p(std::exp(-3.0)))) <= 1.0e-14 &&
+                 SimdLogSumExp(dspecial, 6) == 1.0e+300);
+    dspecial[0] = dinf;
+    KALDI_ASSERT(SimdLogSumExp(dspecial, 6) == dinf);
+
+    for (MatrixIndexT i = 0; i < dim; i++)
+      x(i) = std::exp(RandUniform() * 160.0 - 80.0);
+    SimdLog(x.Data(), y.Data(), dim);
+    for (MatrixIndexT i = 0; i < dim; i++)
+      KALDI_ASSERT(UlpError(y(i), std::log(static_cast<double>(x(i)))) <= 2.0);
+
+    for (MatrixIndexT i = 0; i < dim; i++)
+      x(i) = RandUniform() * 40.0 - 20.0;
+    if (level != kSimdNone) {  // the scalar tanh is less exact near zero.
+      SimdTanh(x.Data(), y.Data(), dim);
+      for (MatrixIndexT i = 0; i < dim; i++) {
+        double xi = x(i);
+        KALDI_ASSERT(UlpError(y(i), std::tanh(xi)) <= 3.0);
+      }
+    }
+    SimdSigmoid(x.Data(), y.Data(), dim);
+    for (MatrixIndexT i = 0; i < dim; i++) {
+      double xi = x(i);
+      KALDI_ASSERT(UlpError(y(i), 1.0 / (1.0 + std::exp(-xi))) <= 3.0);
+    }
+
+    float inf = std::numeric_limits<float>::infinity(),
+        nan = std::numeric_limits<float>::quiet_NaN(),
+        special[] = { 0.0, -inf, inf, nan, -1.0, 1.0e-40 }, out[6];
+    SimdExp(special, out, 6);
+    KALDI_ASSERT(out[0] == 1.0 && out[1] == 0.0 && out[2] == inf &&
+                 KALDI_ISNAN(out[3]));
+    SimdLog(special, out, 6);
+    KALDI_ASSERT(out[0] == -inf && KALDI_ISNAN(out[1]) && out[2] == inf &&
+                 KALDI_ISNAN(out[3]) && KALDI_ISNAN(out[4]) &&
+                 UlpError(out[5], std::log(1.0e-40)) <= 2.0);
+    SimdTanh(special, out, 6);
+    KALDI_ASSERT(out[0] == 0.0 && out[1] == -1.0 && out[2] == 1.0 &&
+                 KALDI_ISNAN(out[3]));
+    SimdSigmoid(special, out, 6);
+    KALDI_ASSERT(out[0] == 0.5 && out[1] == 0.0 && out[2] == 1.0 &&
+                 KALDI_ISNAN(out[3]));
+
+    // The float and double softmax should agree.
+    Vector<float> v(dim);
+    v.SetRandn();
+    v.Scale(10.0);
+    Vector<double> w(v);
+    AssertEqual(v.ApplySoftMax(), static_cast<float>(w.ApplySoftMax()));
+    Vector<float> w_float(w);
+    AssertEqual(v, w_float);
+  }
+  SetSimdLevel(cpu_level);
+}
+
 template<typename Real> static void UnitTestInnerProd() {
 
   MatrixIndexT N = 1 + Rand() % 10;
@@ -4464,6 +4565,73 @@ static void UnitTestExtractCompressedMatrix() {
 }
 
 
+// Tests the functions that use a CompressedMatrix without decompressing it in
+// full, against the same operations on the decompressed matrix.
+template<typename Real>
+static void UnitTestCompressedMatrixProducts() {
+  for (int32 i = 0; i < 20; i++) {
+    MatrixIndexT num_rows = RandInt(1, 300), num_cols = RandInt(1, 600),
+        other_dim = RandInt(1, 50);
+    Matrix<Real> mat(num_rows, num_cols);
+    mat.SetRandn();
+    CompressedMatrix cmat(mat);
+    Matrix<Real> full(cmat);
+    KALDI_ASSERT(cmat.NumBlockRows() >= 1 &&
+                 cmat.NumBlockRows() <= num_rows);
+
+    Matrix<Real> full_trans(num_cols, num_rows), full_trans2(num_cols, num_rows);
+    cmat.CopyToMat(&full_trans, kTrans);
+    full_trans2.CopyFromMat(full, kTrans);
+    AssertEqual(full_trans, full_trans2);
+
+    Real alpha = RandGauss(), beta = (i % 3 == 0 ? 0.0 : RandGauss());
+    MatrixTransposeType trans_c = (i % 2 == 0 ? kNoTrans : kTrans),
+        trans_o = (i % 4 < 2 ? kNoTrans : kTrans);
+
+    Matrix<Real> sum(full), sum2(full);
+    cmat.AddToMat(alpha, &sum);
+    sum2.AddMat(alpha, full);
+    AssertEqual(sum, sum2);
+    sum.Resize(num_cols, num_rows);
+    sum2.Resize(num_cols, num_rows);
+    cmat.AddToMat(alpha, &sum, kTrans);
+    sum2.AddMat(alpha, full, kTrans);
+    AssertEqual(sum, sum2);
+
+    {  // C = alpha op(cmat) op(other) + beta C.
+      MatrixIndexT c_rows = (trans_c == kNoTrans ? num_rows : num_cols),
+          inner = (trans_c == kNoTrans ? num_cols : num_rows);
+      Matrix<Real> other(trans_o == kNoTrans ? inner : other_dim,
+                         trans_o == kNoTrans ? other_dim : inner),
+          C(c_rows, other_dim);
+      other.SetRandn();
+      C.SetRandn();
+      Matrix<Real> C2(C);
+      if (beta == 0.0)
+        C.Set(std::numeric_limits<Real>::quiet_NaN());  // must be ignored.
+      C.AddCmatMat(alpha, cmat, trans_c, other, trans_o, beta);
+      C2.AddMatMat(alpha, full, trans_c, other, trans_o, beta);
+      AssertEqual(C, C2);
+    }
+    {  // C = alpha op(other) op(cmat) + beta C.
+      MatrixIndexT c_cols = (trans_c == kNoTrans ? num_cols : num_rows),
+          inner = (trans_c == kNoTrans ? num_rows : num_cols);
+      Matrix<Real> other(trans_o == kNoTrans ? other_dim : inner,
+                         trans_o == kNoTrans ? inner : other_dim),
+          C(other_dim, c_cols);
+      other.SetRandn();
+      C.SetRandn();
+      Matrix<Real> C2(C);
+      if (beta == 0.0)
+        C.Set(std::numeric_limits<Real>::quiet_NaN());
+      C.AddMatCmat(alpha, other, trans_o, cmat, trans_c, beta);
+      C2.AddMatMat(alpha, other, trans_o, full, trans_c, beta);
+      AssertEqual(C, C2);
+    }
+  }
+}
+
+
 template<typename Real>
 static void UnitTestTridiag() {
   SpMatrix<Real> A(3);
@@ -4603,6 +4771,7 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   UnitTestCompressedMatrix<Real>();
   UnitTestCompressedMatrix2<Real>();
   UnitTestExtractCompressedMatrix<Real>();
+  UnitTestCompressedMatrixProducts<Real>();
   UnitTestResize<Real>();
   UnitTestResizeCopyDataDifferentStrideType<Real>();
   UnitTestNonsymmetricPower<Real>();
@@ -4699,6 +4868,7 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   UnitTestMaxMin<Real>();
   UnitTestInnerProd<Real>();
   UnitTestApplyExpSpecial<Real>();
+  UnitTestSimdMath();
   UnitTestScaleDiag<Real>();
   UnitTestSetDiag<Real>();
   UnitTestSetRandn<Real>();
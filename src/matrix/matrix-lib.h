@@ -29,9 +29,16 @@
 #include "matrix/tp-matrix.h"
 #include "matrix/matrix-functions.h"
 #include "matrix/srfft.h"
+#include "matrix/batched-fft.h"
 #include "matrix/compressed-matrix.h"
+#include "matrix/cpu-allocator.h"
 #include "matrix/sparse-matrix.h"
 #include "matrix/optimization.h"
+#include "matrix/simd-math.h"
+#include "matrix/quantized-matrix.h"
+#include "matrix/panel-matrix.h"
+#include "matrix/half-matrix.h"
+#include "matrix/csr-matrix.h"
 
 #endif
 
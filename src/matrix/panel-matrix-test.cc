@@ -0,0 +1,100 @@
+// matrix/panel-matrix-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "matrix/matrix-lib.h"
+
+namespace kaldi {
+
+template<typename Real>
+static void UnitTestPanelMatrixCopy() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT num_rows = RandInt(1, 40), num_cols = RandInt(1, 100);
+    Matrix<Real> M(num_rows, num_cols);
+    M.SetRandn();
+    PanelMatrix P(M);
+    KALDI_ASSERT(P.NumRows() == num_rows && P.NumCols() == num_cols);
+    Matrix<Real> M2(num_rows, num_cols);
+    P.CopyToMat(&M2);
+    AssertEqual(M, M2, 1.0e-06);
+  }
+  Matrix<Real> empty;
+  PanelMatrix P(empty);
+  KALDI_ASSERT(P.NumRows() == 0 && P.NumCols() == 0);
+}
+
+template<typename Real>
+static void UnitTestAddMatPanelMat() {
+  for (int32 i = 0; i < 20; i++) {
+    MatrixIndexT num_rows = RandInt(1, 40), num_cols = RandInt(1, 300),
+        dim = RandInt(1, 200);
+    Matrix<Real> A(num_rows, dim), B(num_cols, dim), C(num_rows, num_cols);
+    A.SetRandn();
+    B.SetRandn();
+    C.SetRandn();
+    // Make B exactly representable in single precision.
+    Matrix<float> B_float(B);
+    B.CopyFromMat(B_float);
+    Real alpha = RandGauss(), beta = (i % 3 == 0 ? 0.0 : RandGauss());
+    PanelMatrix P(B);
+    Matrix<Real> C2(C);
+    if (beta == 0.0)
+      C2.Set(std::numeric_limits<Real>::quiet_NaN());  // must be ignored.
+    // A sub-matrix, to test strides.
+    SubMatrix<Real> A_sub(A, 0, num_rows, 0, dim);
+    AddMatPanelMat(alpha, A_sub, P, beta, &C2);
+    C.AddMatMat(alpha, A, kNoTrans, B, kTrans, beta);
+    AssertEqual(C, C2, 1.0e-04);
+  }
+}
+
+// All instruction sets should give the same result up to roundoff.
+static void UnitTestPanelKernels() {
+  SimdLevel cpu_level = (SetSimdLevel(kSimdAvx512), GetSimdLevel());
+  MatrixIndexT num_rows = RandInt(1, 20), num_cols = RandInt(1, 100),
+      dim = RandInt(1, 500);
+  Matrix<float> A(num_rows, dim), B(num_cols, dim), C(num_rows, num_cols);
+  A.SetRandn();
+  B.SetRandn();
+  PanelMatrix P(B);
+  SetSimdLevel(kSimdNone);
+  AddMatPanelMat(1.0f, A, P, 0.0f, &C);
+  for (int32 level = kSimdAvx2; level <= cpu_level; level++) {
+    SetSimdLevel(static_cast<SimdLevel>(level));
+    Matrix<float> C2(num_rows, num_cols);
+    AddMatPanelMat(1.0f, A, P, 0.0f, &C2);
+    AssertEqual(C, C2, 1.0e-05);
+  }
+  SetSimdLevel(cpu_level);
+}
+
+template<typename Real>
+static void PanelMatrixUnitTest() {
+  UnitTestPanelMatrixCopy<Real>();
+  UnitTestAddMatPanelMat<Real>();
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::SetVerboseLevel(5);
+  kaldi::PanelMatrixUnitTest<float>();
+  kaldi::PanelMatrixUnitTest<double>();
+  for (kaldi::int32 i = 0; i < 5; i++)
+    kaldi::UnitTestPanelKernels();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
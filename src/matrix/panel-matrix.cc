@@ -0,0 +1,304 @@
+// matrix/panel-matrix.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "matrix/panel-matrix.h"
+#include "matrix/simd-math.h"
+
+// As in simd-math.cc, the vectorized kernels are compiled with the target
+// options for just those functions.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KALDI_PANEL_MATRIX_X86 1
+#include <immintrin.h>
+#endif
+
+namespace kaldi {
+
+// The kernels below compute a tile of up to kTileRows rows of A times one
+// panel of kPanelRows rows of B (see PanelMatrix::data_).
+static const MatrixIndexT kTileRows = 4, kPanelRows = 16;
+
+// The arguments of the kernels, which are templated on the number of rows R
+// of the tile (1 to kTileRows):
+//  a, a_stride     the R rows of A, 'a_stride' floats apart.
+//  b               a panel of B.
+//  dim             the number of columns of A and of B.
+//  out             out[i * kPanelRows + j] is set to the product of row i of
+//                  A and row j of the panel.
+typedef void (*PanelKernel)(const float *a, MatrixIndexT a_stride,
+                            const float *b, MatrixIndexT dim, float *out);
+
+template<int R>
+static void PanelKernelScalar(const float *a, MatrixIndexT a_stride,
+                              const float *b, MatrixIndexT dim, float *out) {
+  float acc[R][kPanelRows] = { { 0.0f } };
+  for (MatrixIndexT k = 0; k < dim; k++) {
+    const float *b_col = b + k * kPanelRows;
+    for (int i = 0; i < R; i++) {
+      float a_ik = a[i * a_stride + k];
+      for (MatrixIndexT j = 0; j < kPanelRows; j++)
+        acc[i][j] += a_ik * b_col[j];
+    }
+  }
+  for (int i = 0; i < R; i++)
+    for (MatrixIndexT j = 0; j < kPanelRows; j++)
+      out[i * kPanelRows + j] = acc[i][j];
+}
+
+#ifdef KALDI_PANEL_MATRIX_X86
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+template<int R>
+static void PanelKernelAvx2(const float *a, MatrixIndexT a_stride,
+                            const float *b, MatrixIndexT dim, float *out) {
+  // acc[i][h] holds the products of row i of A with rows 8h...8h+7 of the
+  // panel.
+  __m256 acc[R][2];
+  for (int i = 0; i < R; i++)
+    acc[i][0] = acc[i][1] = _mm256_setzero_ps();
+  for (MatrixIndexT k = 0; k < dim; k++) {
+    const float *b_col = b + k * kPanelRows;
+    __m256 b0 = _mm256_loadu_ps(b_col), b1 = _mm256_loadu_ps(b_col + 8);
+    for (int i = 0; i < R; i++) {
+      __m256 a_ik = _mm256_broadcast_ss(a + i * a_stride + k);
+      acc[i][0] = _mm256_fmadd_ps(a_ik, b0, acc[i][0]);
+      acc[i][1] = _mm256_fmadd_ps(a_ik, b1, acc[i][1]);
+    }
+  }
+  for (int i = 0; i < R; i++) {
+    _mm256_storeu_ps(out + i * kPanelRows, acc[i][0]);
+    _mm256_storeu_ps(out + i * kPanelRows + 8, acc[i][1]);
+  }
+  _mm256_zeroupper();  // See ApplyKernel() in simd-math-inl.h.
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+// See simd-math.cc.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+template<int R>
+static void PanelKernelAvx512(const float *a, MatrixIndexT a_stride,
+                              const float *b, MatrixIndexT dim, float *out) {
+  // A panel is one vector wide, so to have enough independent additions in
+  // flight, the even and odd columns go into separate sums acc[i][0] and
+  // acc[i][1].
+  __m512 acc[R][2];
+  for (int i = 0; i < R; i++)
+    acc[i][0] = acc[i][1] = _mm512_setzero_ps();
+  MatrixIndexT k = 0;
+  for (; k + 2 <= dim; k += 2) {
+    const float *b_col = b + k * kPanelRows;
+    __m512 b0 = _mm512_loadu_ps(b_col),
+        b1 = _mm512_loadu_ps(b_col + kPanelRows);
+    for (int i = 0; i < R; i++) {
+      const float *a_row = a + i * a_stride + k;
+      acc[i][0] = _mm512_fmadd_ps(_mm512_set1_ps(a_row[0]), b0, acc[i][0]);
+      acc[i][1] = _mm512_fmadd_ps(_mm512_set1_ps(a_row[1]), b1, acc[i][1]);
+    }
+  }
+  if (k < dim) {
+    __m512 b0 = _mm512_loadu_ps(b + k * kPanelRows);
+    for (int i = 0; i < R; i++)
+      acc[i][0] = _mm512_fmadd_ps(_mm512_set1_ps(a[i * a_stride + k]), b0,
+                                  acc[i][0]);
+  }
+  for (int i = 0; i < R; i++)
+    _mm512_storeu_ps(out + i * kPanelRows,
+                     _mm512_add_ps(acc[i][0], acc[i][1]));
+  _mm256_zeroupper();
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+#endif  // KALDI_PANEL_MATRIX_X86
+
+// Sets kernels[R - 1] to the kernel for tiles of R rows.
+static void GetPanelKernels(PanelKernel kernels[kTileRows]) {
+#ifdef KALDI_PANEL_MATRIX_X86
+  SimdLevel level = GetSimdLevel();
+  if (level == kSimdAvx512) {
+    kernels[0] = PanelKernelAvx512<1>;
+    kernels[1] = PanelKernelAvx512<2>;
+    kernels[2] = PanelKernelAvx512<3>;
+    kernels[3] = PanelKernelAvx512<4>;
+    return;
+  } else if (level == kSimdAvx2) {
+    kernels[0] = PanelKernelAvx2<1>;
+    kernels[1] = PanelKernelAvx2<2>;
+    kernels[2] = PanelKernelAvx2<3>;
+    kernels[3] = PanelKernelAvx2<4>;
+    return;
+  }
+#endif
+  kernels[0] = PanelKernelScalar<1>;
+  kernels[1] = PanelKernelScalar<2>;
+  kernels[2] = PanelKernelScalar<3>;
+  kernels[3] = PanelKernelScalar<4>;
+}
+
+// Computes a tile of the product: a version of the kernels for double, which
+// has no vectorized version.
+static void PanelTile(const double *a, MatrixIndexT a_stride,
+                      MatrixIndexT num_rows, const float *b, MatrixIndexT dim,
+                      const PanelKernel *, double *out) {
+  for (MatrixIndexT i = 0; i < num_rows; i++) {
+    double acc[kPanelRows] = { 0.0 };
+    for (MatrixIndexT k = 0; k < dim; k++) {
+      double a_ik = a[i * a_stride + k];
+      const float *b_col = b + k * kPanelRows;
+      for (MatrixIndexT j = 0; j < kPanelRows; j++)
+        acc[j] += a_ik * b_col[j];
+    }
+    for (MatrixIndexT j = 0; j < kPanelRows; j++)
+      out[i * kPanelRows + j] = acc[j];
+  }
+}
+
+static void PanelTile(const float *a, MatrixIndexT a_stride,
+                      MatrixIndexT num_rows, const float *b, MatrixIndexT dim,
+                      const PanelKernel *kernels, float *out) {
+  kernels[num_rows - 1](a, a_stride, b, dim, out);
+}
+
+template<typename Real>
+void PanelMatrix::CopyFromMat(const MatrixBase<Real> &mat) {
+  num_rows_ = mat.NumRows();
+  num_cols_ = mat.NumCols();
+  MatrixIndexT num_panels = (num_rows_ + kPanelRows - 1) / kPanelRows;
+  data_.assign(static_cast<size_t>(num_panels) * kPanelRows * num_cols_, 0.0);
+  for (MatrixIndexT r = 0; r < num_rows_; r++) {
+    const Real *row_data = mat.RowData(r);
+    // (data_.data(), not &data_[...], as data_ is empty if num_cols_ == 0.)
+    float *panel = data_.data() + static_cast<size_t>(r / kPanelRows) *
+        kPanelRows * num_cols_ + r % kPanelRows;
+    for (MatrixIndexT c = 0; c < num_cols_; c++)
+      panel[c * kPanelRows] = row_data[c];
+  }
+}
+
+template<typename Real>
+void PanelMatrix::CopyToMat(MatrixBase<Real> *mat) const {
+  KALDI_ASSERT(mat->NumRows() == num_rows_ && mat->NumCols() == num_cols_);
+  for (MatrixIndexT r = 0; r < num_rows_; r++) {
+    Real *row_data = mat->RowData(r);
+    const float *panel = data_.data() + static_cast<size_t>(r / kPanelRows) *
+        kPanelRows * num_cols_ + r % kPanelRows;
+    for (MatrixIndexT c = 0; c < num_cols_; c++)
+      row_data[c] = panel[c * kPanelRows];
+  }
+}
+
+void PanelMatrix::Swap(PanelMatrix *other) {
+  std::swap(num_rows_, other->num_rows_);
+  std::swap(num_cols_, other->num_cols_);
+  data_.swap(other->data_);
+}
+
+void PanelMatrix::Clear() {
+  PanelMatrix empty;
+  Swap(&empty);
+}
+
+bool PanelMatrixIsFaster(MatrixIndexT num_rows) {
+  return num_rows <= 32 && GetSimdLevel() != kSimdNone;
+}
+
+template<typename Real>
+void AddMatPanelMat(Real alpha, const MatrixBase<Real> &A,
+                    const PanelMatrix &B, Real beta,
+                    MatrixBase<Real> *C) {
+  KALDI_ASSERT(A.NumCols() == B.num_cols_ && C->NumRows() == A.NumRows() &&
+               C->NumCols() == B.num_rows_);
+  MatrixIndexT num_rows = A.NumRows(), num_cols = B.num_rows_,
+      dim = B.num_cols_,
+      num_panels = (num_cols + kPanelRows - 1) / kPanelRows;
+  if (num_rows == 0 || num_cols == 0)
+    return;
+  PanelKernel kernels[kTileRows];
+  GetPanelKernels(kernels);
+  Real out[kTileRows * kPanelRows];
+  // Each panel of B is read once, and multiplied by all rows of A while it
+  // is in the cache.
+  for (MatrixIndexT p = 0; p < num_panels; p++) {
+    const float *panel = B.data_.data() +
+        static_cast<size_t>(p) * kPanelRows * dim;
+    MatrixIndexT j = p * kPanelRows,
+        tile_cols = std::min(kPanelRows, num_cols - j);
+    for (MatrixIndexT i = 0; i < num_rows; i += kTileRows) {
+      MatrixIndexT tile_rows = std::min(kTileRows, num_rows - i);
+      PanelTile(A.RowData(i), A.Stride(), tile_rows, panel, dim, kernels, out);
+      for (MatrixIndexT ii = 0; ii < tile_rows; ii++) {
+        Real *c_data = C->RowData(i + ii) + j;
+        const Real *out_data = out + ii * kPanelRows;
+        // As in BLAS, beta == 0 ignores the previous contents of C.
+        if (beta == 0.0) {
+          for (MatrixIndexT jj = 0; jj < tile_cols; jj++)
+            c_data[jj] = alpha * out_data[jj];
+        } else {
+          for (MatrixIndexT jj = 0; jj < tile_cols; jj++)
+            c_data[jj] = beta * c_data[jj] + alpha * out_data[jj];
+        }
+      }
+    }
+  }
+}
+
+template
+void PanelMatrix::CopyFromMat(const MatrixBase<float> &mat);
+template
+void PanelMatrix::CopyFromMat(const MatrixBase<double> &mat);
+template
+void PanelMatrix::CopyToMat(MatrixBase<float> *mat) const;
+template
+void PanelMatrix::CopyToMat(MatrixBase<double> *mat) const;
+template
+void AddMatPanelMat(float alpha, const MatrixBase<float> &A,
+                    const PanelMatrix &B, float beta,
+                    MatrixBase<float> *C);
+template
+void AddMatPanelMat(double alpha, const MatrixBase<double> &A,
+                    const PanelMatrix &B, double beta,
+                    MatrixBase<double> *C);
+
+}  // namespace kaldi
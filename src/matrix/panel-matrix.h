@@ -0,0 +1,99 @@
+// matrix/panel-matrix.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_PANEL_MATRIX_H_
+#define KALDI_MATRIX_PANEL_MATRIX_H_
+
+#include <vector>
+
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_group
+/// @{
+
+/*
+  PanelMatrix is a copy of a matrix in single precision, rearranged ("packed")
+  in the order in which AddMatPanelMat() reads it: in panels of 16 rows, and
+  within each panel column by column, so that each column of a panel is one
+  64-byte vector.  BLAS does this rearrangement of its operands inside each
+  call to gemm, which is a large part of the time when the other operand has
+  only a few rows; for the weights of a neural network, which are multiplied
+  by a few frames at a time in online decoding, it can be done once when the
+  model is loaded.
+*/
+class PanelMatrix {
+ public:
+  PanelMatrix(): num_rows_(0), num_cols_(0) { }
+
+  template<typename Real>
+  explicit PanelMatrix(const MatrixBase<Real> &mat) { CopyFromMat(mat); }
+
+  /// This will resize *this and copy the contents of mat to *this.
+  template<typename Real>
+  void CopyFromMat(const MatrixBase<Real> &mat);
+
+  /// Copies the contents to mat, which must have the correct size.
+  template<typename Real>
+  void CopyToMat(MatrixBase<Real> *mat) const;
+
+  MatrixIndexT NumRows() const { return num_rows_; }
+  MatrixIndexT NumCols() const { return num_cols_; }
+
+  void Swap(PanelMatrix *other);
+
+  void Clear();
+
+ private:
+  template<typename Real>
+  friend void AddMatPanelMat(Real alpha, const MatrixBase<Real> &A,
+                             const PanelMatrix &B, Real beta,
+                             MatrixBase<Real> *C);
+
+  MatrixIndexT num_rows_;
+  MatrixIndexT num_cols_;
+  // For each panel of 16 rows (the last one padded with zero rows), for each
+  // column, the elements of that column in the 16 rows.
+  std::vector<float> data_;
+};
+
+/// Returns true if AddMatPanelMat() is expected to be faster than AddMatMat()
+/// for an A with num_rows rows: if num_rows is small (at most 32; measured
+/// with matrix-lib-speed-test against OpenBLAS) and the CPU has AVX2 (see
+/// GetSimdLevel()), as the plain C++ version is slower than BLAS.  The
+/// callers that choose between the two (e.g. cu::AddMatPanelMat()) use this.
+bool PanelMatrixIsFaster(MatrixIndexT num_rows);
+
+/**
+   Does *C = alpha * A * B^T + beta * *C, like AddMatMat() with B transposed,
+   where B has been packed into a PanelMatrix.  It is meant for A with few
+   rows (see PanelMatrixIsFaster()): each panel of B is read from memory once
+   and multiplied by all rows of A, with AVX-512 or AVX2 where the CPU has
+   them (see GetSimdLevel()).  The result differs from that of AddMatMat()
+   only by roundoff (B is stored in single precision, though).
+ */
+template<typename Real>
+void AddMatPanelMat(Real alpha, const MatrixBase<Real> &A,
+                    const PanelMatrix &B, Real beta,
+                    MatrixBase<Real> *C);
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_PANEL_MATRIX_H_
@@ -0,0 +1,130 @@
+// matrix/quantized-matrix-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "matrix/matrix-lib.h"
+
+namespace kaldi {
+
+template<typename Real>
+static void UnitTestQuantizedMatrixCopy() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT num_rows = RandInt(1, 20), num_cols = RandInt(1, 150);
+    Matrix<Real> M(num_rows, num_cols);
+    M.SetRandn();
+    M.Row(RandInt(0, num_rows - 1)).SetZero();
+    QuantizedMatrix Q(M);
+    KALDI_ASSERT(Q.NumRows() == num_rows && Q.NumCols() == num_cols);
+    Matrix<Real> M2(num_rows, num_cols);
+    Q.CopyToMat(&M2);
+    for (MatrixIndexT r = 0; r < num_rows; r++) {
+      Real max_abs = M.Row(r).Max() > -M.Row(r).Min() ? M.Row(r).Max() :
+          -M.Row(r).Min();
+      for (MatrixIndexT c = 0; c < num_cols; c++)
+        KALDI_ASSERT(std::abs(M(r, c) - M2(r, c)) <= max_abs / 254.0 * 1.001);
+    }
+    // Quantizing again changes nothing.
+    QuantizedMatrix Q2(M2);
+    Matrix<Real> M3(num_rows, num_cols);
+    Q2.CopyToMat(&M3);
+    AssertEqual(M2, M3, 1.0e-05);
+  }
+  Matrix<Real> empty;
+  QuantizedMatrix Q(empty);
+  KALDI_ASSERT(Q.NumRows() == 0 && Q.NumCols() == 0);
+}
+
+template<typename Real>
+static void UnitTestAddMatQuantizedMat() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT num_rows = RandInt(1, 40), num_cols = RandInt(1, 300),
+        dim = RandInt(1, 200);
+    Matrix<Real> A(num_rows, dim), B(num_cols, dim), C(num_rows, num_cols);
+    A.SetRandn();
+    if (i % 2 == 0)
+      A.ApplyFloor(0.0);  // like the output of a ReLU.
+    B.SetRandn();
+    C.SetRandn();
+    Real alpha = RandGauss(), beta = (i % 3 == 0 ? 0.0 : RandGauss());
+    QuantizedMatrix Q(B);
+    Matrix<Real> C2(C), C3(C);
+    if (beta == 0.0)
+      C2.Set(std::numeric_limits<Real>::quiet_NaN());  // must be ignored.
+    AddMatQuantizedMat(alpha, A, Q, beta, &C2);
+    C3.AddMatMat(alpha, A, kNoTrans, B, kTrans, beta);
+
+    // The bound on the error from the quantization steps; see the header.
+    Matrix<Real> B_abs(B);
+    B_abs.ApplyPowAbs(1.0);
+    for (MatrixIndexT r = 0; r < num_rows; r++) {
+      Real a_step = (std::max<Real>(A.Row(r).Max(), 0.0) -
+                     std::min<Real>(A.Row(r).Min(), 0.0)) / 127.0,
+          a_abs_sum = 0.0;
+      for (MatrixIndexT k = 0; k < dim; k++)
+        a_abs_sum += std::abs(A(r, k)) + a_step / 2;
+      for (MatrixIndexT c = 0; c < num_cols; c++) {
+        Real b_step = B_abs.Row(c).Max() / 127.0,
+            bound = std::abs(alpha) * (a_step / 2 * B_abs.Row(c).Sum() +
+                                       b_step / 2 * a_abs_sum) + 1.0e-04;
+        KALDI_ASSERT(std::abs(C2(r, c) - C3(r, c)) <= bound);
+      }
+    }
+    // And overall it should be quite close.
+    C2.AddMat(-1.0, C3);
+    C3.AddMat(-beta, C);
+    KALDI_ASSERT(C2.FrobeniusNorm() <= 0.03 * C3.FrobeniusNorm() + 1.0e-04);
+  }
+}
+
+// The result must not depend on the instruction set.
+static void UnitTestQuantizedKernels() {
+  SimdLevel cpu_level = (SetSimdLevel(kSimdAvx512), GetSimdLevel());
+  MatrixIndexT num_rows = RandInt(1, 20), num_cols = RandInt(1, 100),
+      dim = RandInt(1, 500);
+  Matrix<float> A(num_rows, dim), B(num_cols, dim), C(num_rows, num_cols);
+  A.SetRandn();
+  B.SetRandn();
+  QuantizedMatrix Q(B);
+  SetSimdLevel(kSimdNone);
+  AddMatQuantizedMat(1.0f, A, Q, 0.0f, &C);
+  for (int32 level = kSimdAvx2; level <= cpu_level; level++) {
+    SetSimdLevel(static_cast<SimdLevel>(level));
+    Matrix<float> C2(num_rows, num_cols);
+    AddMatQuantizedMat(1.0f, A, Q, 0.0f, &C2);
+    for (MatrixIndexT r = 0; r < num_rows; r++)
+      for (MatrixIndexT c = 0; c < num_cols; c++)
+        KALDI_ASSERT(C(r, c) == C2(r, c));
+  }
+  SetSimdLevel(cpu_level);
+}
+
+template<typename Real>
+static void QuantizedMatrixUnitTest() {
+  UnitTestQuantizedMatrixCopy<Real>();
+  UnitTestAddMatQuantizedMat<Real>();
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::SetVerboseLevel(5);
+  kaldi::QuantizedMatrixUnitTest<float>();
+  kaldi::QuantizedMatrixUnitTest<double>();
+  for (kaldi::int32 i = 0; i < 5; i++)
+    kaldi::UnitTestQuantizedKernels();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,367 @@
+// matrix/quantized-matrix.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "matrix/quantized-matrix.h"
+#include "matrix/simd-math.h"
+
+// As in simd-math.cc, the vectorized kernels are compiled with the target
+// options for just those functions.  The VNNI instructions need GCC 9.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KALDI_QUANTIZED_MATRIX_X86 1
+#include <immintrin.h>
+#if defined(__clang__) || __GNUC__ >= 9
+#define KALDI_QUANTIZED_MATRIX_VNNI 1
+#endif
+#endif
+
+namespace kaldi {
+
+// The kernels below compute a tile of kTileRows rows of A times one panel of
+// kPanelRows rows of B (see QuantizedMatrix::data_).  The quantized A has
+// its rows padded to a multiple of kTileRows.
+static const MatrixIndexT kTileRows = 4, kPanelRows = 16, kGroupSize = 4;
+
+// The arguments of the kernels:
+//  a, a_stride     the quantized rows of A, num_groups * kGroupSize bytes
+//                  each, 'a_stride' bytes apart.
+//  a_zeros, a_scales  their zero points and scales.
+//  b, b_sums, b_scales  a panel of the quantized B, and the row sums and
+//                  scales of its rows.
+//  out             out[i * kPanelRows + j] is set to the product of row i of
+//                  A and row j of B, with the zero points and scales applied.
+typedef void (*QuantizedKernel)(const uint8 *a, MatrixIndexT a_stride,
+                                const int32 *a_zeros, const float *a_scales,
+                                const int8 *b, const int32 *b_sums,
+                                const float *b_scales,
+                                MatrixIndexT num_groups, float *out);
+
+static void QuantizedKernelScalar(const uint8 *a, MatrixIndexT a_stride,
+                                  const int32 *a_zeros, const float *a_scales,
+                                  const int8 *b, const int32 *b_sums,
+                                  const float *b_scales,
+                                  MatrixIndexT num_groups, float *out) {
+  int32 dots[kTileRows][kPanelRows] = { { 0 } };
+  for (MatrixIndexT g = 0; g < num_groups; g++) {
+    const int8 *b_group = b + g * kPanelRows * kGroupSize;
+    for (MatrixIndexT i = 0; i < kTileRows; i++) {
+      const uint8 *a_group = a + i * a_stride + g * kGroupSize;
+      for (MatrixIndexT j = 0; j < kPanelRows; j++)
+        for (MatrixIndexT k = 0; k < kGroupSize; k++)
+          dots[i][j] += static_cast<int32>(a_group[k]) *
+              static_cast<int32>(b_group[j * kGroupSize + k]);
+    }
+  }
+  // The vectorized kernels do the same float operations, so the results are
+  // the same.
+  for (MatrixIndexT i = 0; i < kTileRows; i++)
+    for (MatrixIndexT j = 0; j < kPanelRows; j++)
+      out[i * kPanelRows + j] =
+          static_cast<float>(dots[i][j] - a_zeros[i] * b_sums[j]) *
+          (a_scales[i] * b_scales[j]);
+}
+
+#ifdef KALDI_QUANTIZED_MATRIX_X86
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+static void QuantizedKernelAvx2(const uint8 *a, MatrixIndexT a_stride,
+                                const int32 *a_zeros, const float *a_scales,
+                                const int8 *b, const int32 *b_sums,
+                                const float *b_scales,
+                                MatrixIndexT num_groups, float *out) {
+  const __m256i ones = _mm256_set1_epi16(1);
+  // acc[i][h] holds the dot products of row i of A with rows 8h...8h+7 of B.
+  __m256i acc[kTileRows][2];
+  for (int i = 0; i < kTileRows; i++)
+    acc[i][0] = acc[i][1] = _mm256_setzero_si256();
+  for (MatrixIndexT g = 0; g < num_groups; g++) {
+    const int8 *b_group = b + g * kPanelRows * kGroupSize;
+    __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b_group)),
+        b1 = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(b_group + 32));
+    for (int i = 0; i < kTileRows; i++) {
+      int32 a_group;
+      memcpy(&a_group, a + i * a_stride + g * kGroupSize, sizeof(a_group));
+      __m256i ai = _mm256_set1_epi32(a_group);
+      // maddubs adds pairs of u8 x s8 products in 16 bits, which cannot
+      // overflow as the elements of A are less than 128; madd with ones
+      // adds the pairs of those.
+      acc[i][0] = _mm256_add_epi32(acc[i][0], _mm256_madd_epi16(
+          _mm256_maddubs_epi16(ai, b0), ones));
+      acc[i][1] = _mm256_add_epi32(acc[i][1], _mm256_madd_epi16(
+          _mm256_maddubs_epi16(ai, b1), ones));
+    }
+  }
+  for (int i = 0; i < kTileRows; i++) {
+    for (int h = 0; h < 2; h++) {
+      __m256i sums = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(b_sums + 8 * h));
+      __m256i dots = _mm256_sub_epi32(
+          acc[i][h], _mm256_mullo_epi32(_mm256_set1_epi32(a_zeros[i]), sums));
+      __m256 scales = _mm256_mul_ps(_mm256_set1_ps(a_scales[i]),
+                                    _mm256_loadu_ps(b_scales + 8 * h));
+      _mm256_storeu_ps(out + i * kPanelRows + 8 * h,
+                       _mm256_mul_ps(_mm256_cvtepi32_ps(dots), scales));
+    }
+  }
+  _mm256_zeroupper();  // See ApplyKernel() in simd-math-inl.h.
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#ifdef KALDI_QUANTIZED_MATRIX_VNNI
+
+#if defined(__clang__)
+#pragma clang attribute push( \
+    __attribute__((target("avx512f,avx512bw,avx512vnni"))), \
+    apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx512vnni")
+// See simd-math.cc.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+static void QuantizedKernelVnni(const uint8 *a, MatrixIndexT a_stride,
+                                const int32 *a_zeros, const float *a_scales,
+                                const int8 *b, const int32 *b_sums,
+                                const float *b_scales,
+                                MatrixIndexT num_groups, float *out) {
+  // acc[i] holds the dot products of row i of A with the 16 rows of B.
+  __m512i acc[kTileRows];
+  for (int i = 0; i < kTileRows; i++)
+    acc[i] = _mm512_setzero_si512();
+  for (MatrixIndexT g = 0; g < num_groups; g++) {
+    __m512i bg = _mm512_loadu_si512(b + g * kPanelRows * kGroupSize);
+    for (int i = 0; i < kTileRows; i++) {
+      int32 a_group;
+      memcpy(&a_group, a + i * a_stride + g * kGroupSize, sizeof(a_group));
+      acc[i] = _mm512_dpbusd_epi32(acc[i], _mm512_set1_epi32(a_group), bg);
+    }
+  }
+  __m512i sums = _mm512_loadu_si512(b_sums);
+  __m512 b_scale_vec = _mm512_loadu_ps(b_scales);
+  for (int i = 0; i < kTileRows; i++) {
+    __m512i dots = _mm512_sub_epi32(
+        acc[i], _mm512_mullo_epi32(_mm512_set1_epi32(a_zeros[i]), sums));
+    __m512 scales = _mm512_mul_ps(_mm512_set1_ps(a_scales[i]), b_scale_vec);
+    _mm512_storeu_ps(out + i * kPanelRows,
+                     _mm512_mul_ps(_mm512_cvtepi32_ps(dots), scales));
+  }
+  _mm256_zeroupper();
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+#endif  // KALDI_QUANTIZED_MATRIX_VNNI
+#endif  // KALDI_QUANTIZED_MATRIX_X86
+
+static QuantizedKernel GetQuantizedKernel() {
+#ifdef KALDI_QUANTIZED_MATRIX_X86
+  SimdLevel level = GetSimdLevel();
+#ifdef KALDI_QUANTIZED_MATRIX_VNNI
+  static const bool has_vnni = __builtin_cpu_supports("avx512bw") &&
+      __builtin_cpu_supports("avx512vnni");
+  if (level == kSimdAvx512 && has_vnni)
+    return QuantizedKernelVnni;
+#endif
+  if (level >= kSimdAvx2)
+    return QuantizedKernelAvx2;
+#endif
+  return QuantizedKernelScalar;
+}
+
+static inline int32 RoundToInt(float f) {
+  return static_cast<int32>(std::floor(f + 0.5f));
+}
+
+template<typename Real>
+void QuantizedMatrix::CopyFromMat(const MatrixBase<Real> &mat) {
+  num_rows_ = mat.NumRows();
+  num_cols_ = mat.NumCols();
+  num_groups_ = (num_cols_ + kGroupSize - 1) / kGroupSize;
+  MatrixIndexT padded_rows = (num_rows_ + kPanelRows - 1) / kPanelRows *
+      kPanelRows;
+  data_.assign(static_cast<size_t>(padded_rows) * num_groups_ * kGroupSize,
+               0);
+  scales_.assign(padded_rows, 0.0);
+  row_sums_.assign(padded_rows, 0);
+  for (MatrixIndexT r = 0; r < num_rows_; r++) {
+    const Real *row_data = mat.RowData(r);
+    Real max_abs = 0.0;
+    for (MatrixIndexT c = 0; c < num_cols_; c++)
+      max_abs = std::max<Real>(max_abs, std::abs(row_data[c]));
+    if (max_abs == 0.0)
+      continue;  // leave the row as zeros.
+    float inv_scale = 127.0 / max_abs;
+    int8 *panel = &(data_[static_cast<size_t>(r / kPanelRows) * num_groups_ *
+                          kPanelRows * kGroupSize]) +
+        (r % kPanelRows) * kGroupSize;
+    int32 sum = 0;
+    for (MatrixIndexT c = 0; c < num_cols_; c++) {
+      int32 i = std::max(-127, std::min(127, RoundToInt(row_data[c] *
+                                                        inv_scale)));
+      panel[(c / kGroupSize) * kPanelRows * kGroupSize + c % kGroupSize] = i;
+      sum += i;
+    }
+    scales_[r] = max_abs / 127.0;
+    row_sums_[r] = sum;
+  }
+}
+
+template<typename Real>
+void QuantizedMatrix::CopyToMat(MatrixBase<Real> *mat) const {
+  KALDI_ASSERT(mat->NumRows() == num_rows_ && mat->NumCols() == num_cols_);
+  for (MatrixIndexT r = 0; r < num_rows_; r++) {
+    Real *row_data = mat->RowData(r), scale = scales_[r];
+    const int8 *panel = &(data_[static_cast<size_t>(r / kPanelRows) *
+                                num_groups_ * kPanelRows * kGroupSize]) +
+        (r % kPanelRows) * kGroupSize;
+    for (MatrixIndexT c = 0; c < num_cols_; c++)
+      row_data[c] = scale *
+          panel[(c / kGroupSize) * kPanelRows * kGroupSize + c % kGroupSize];
+  }
+}
+
+void QuantizedMatrix::Swap(QuantizedMatrix *other) {
+  std::swap(num_rows_, other->num_rows_);
+  std::swap(num_cols_, other->num_cols_);
+  std::swap(num_groups_, other->num_groups_);
+  data_.swap(other->data_);
+  scales_.swap(other->scales_);
+  row_sums_.swap(other->row_sums_);
+}
+
+void QuantizedMatrix::Clear() {
+  QuantizedMatrix empty;
+  Swap(&empty);
+}
+
+template<typename Real>
+void AddMatQuantizedMat(Real alpha, const MatrixBase<Real> &A,
+                        const QuantizedMatrix &B, Real beta,
+                        MatrixBase<Real> *C) {
+  KALDI_ASSERT(A.NumCols() == B.num_cols_ && C->NumRows() == A.NumRows() &&
+               C->NumCols() == B.num_rows_);
+  MatrixIndexT num_rows = A.NumRows(), num_cols = B.num_rows_,
+      dim = B.num_cols_, num_groups = B.num_groups_,
+      a_stride = num_groups * kGroupSize,
+      padded_rows = (num_rows + kTileRows - 1) / kTileRows * kTileRows;
+  if (num_rows == 0 || num_cols == 0)
+    return;
+
+  // Quantize the rows of A to [0, 127] with a zero point: A(i, k) is
+  // approximately a_scales[i] * (a_data(i, k) - a_zeros[i]).  The range
+  // includes zero, so that zero is exact.
+  std::vector<uint8> a_data(static_cast<size_t>(padded_rows) * a_stride, 0);
+  std::vector<float> a_scales(padded_rows, 0.0);
+  std::vector<int32> a_zeros(padded_rows, 0);
+  for (MatrixIndexT i = 0; i < num_rows; i++) {
+    const Real *row_data = A.RowData(i);
+    Real min = 0.0, max = 0.0;
+    for (MatrixIndexT k = 0; k < dim; k++) {
+      min = std::min(min, row_data[k]);
+      max = std::max(max, row_data[k]);
+    }
+    if (max == min)
+      continue;  // an all-zero row.
+    float inv_scale = 127.0 / (max - min);
+    int32 zero = RoundToInt(-min * inv_scale);
+    uint8 *q = &(a_data[static_cast<size_t>(i) * a_stride]);
+    for (MatrixIndexT k = 0; k < dim; k++) {
+      int32 n = RoundToInt(row_data[k] * inv_scale) + zero;
+      q[k] = static_cast<uint8>(std::max(0, std::min(127, n)));
+    }
+    a_scales[i] = (max - min) / 127.0;
+    a_zeros[i] = zero;
+  }
+
+  // The panels of B are taken in blocks of about 128KB, to stay in the cache
+  // while they are multiplied by all rows of A.
+  QuantizedKernel kernel = GetQuantizedKernel();
+  MatrixIndexT panel_bytes = kPanelRows * a_stride,
+      panels_per_block = std::max<MatrixIndexT>(
+          1, 131072 / std::max<MatrixIndexT>(panel_bytes, 1)),
+      num_panels = (num_cols + kPanelRows - 1) / kPanelRows;
+  float out[kTileRows * kPanelRows];
+  for (MatrixIndexT p0 = 0; p0 < num_panels; p0 += panels_per_block) {
+    MatrixIndexT p1 = std::min(num_panels, p0 + panels_per_block);
+    for (MatrixIndexT i = 0; i < num_rows; i += kTileRows) {
+      for (MatrixIndexT p = p0; p < p1; p++) {
+        MatrixIndexT j = p * kPanelRows;
+        kernel(&(a_data[static_cast<size_t>(i) * a_stride]), a_stride,
+               &(a_zeros[i]), &(a_scales[i]),
+               &(B.data_[static_cast<size_t>(p) * panel_bytes]),
+               &(B.row_sums_[j]), &(B.scales_[j]), num_groups, out);
+        MatrixIndexT tile_rows = std::min(kTileRows, num_rows - i),
+            tile_cols = std::min(kPanelRows, num_cols - j);
+        for (MatrixIndexT ii = 0; ii < tile_rows; ii++) {
+          Real *c_data = C->RowData(i + ii) + j;
+          const float *out_data = out + ii * kPanelRows;
+          // As in BLAS, beta == 0 ignores the previous contents of C.
+          if (beta == 0.0) {
+            for (MatrixIndexT jj = 0; jj < tile_cols; jj++)
+              c_data[jj] = alpha * out_data[jj];
+          } else {
+            for (MatrixIndexT jj = 0; jj < tile_cols; jj++)
+              c_data[jj] = beta * c_data[jj] + alpha * out_data[jj];
+          }
+        }
+      }
+    }
+  }
+}
+
+template
+void QuantizedMatrix::CopyFromMat(const MatrixBase<float> &mat);
+template
+void QuantizedMatrix::CopyFromMat(const MatrixBase<double> &mat);
+template
+void QuantizedMatrix::CopyToMat(MatrixBase<float> *mat) const;
+template
+void QuantizedMatrix::CopyToMat(MatrixBase<double> *mat) const;
+template
+void AddMatQuantizedMat(float alpha, const MatrixBase<float> &A,
+                        const QuantizedMatrix &B, float beta,
+                        MatrixBase<float> *C);
+template
+void AddMatQuantizedMat(double alpha, const MatrixBase<double> &A,
+                        const QuantizedMatrix &B, double beta,
+                        MatrixBase<double> *C);
+
+}  // namespace kaldi
@@ -0,0 +1,112 @@
+// matrix/quantized-matrix.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_QUANTIZED_MATRIX_H_
+#define KALDI_MATRIX_QUANTIZED_MATRIX_H_
+
+#include <vector>
+
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_group
+/// @{
+
+/*
+  QuantizedMatrix stores a matrix as signed 8-bit integers with one scale per
+  row: row r is approximated by scale[r] * q[r], with q[r] in [-127, 127] and
+  scale[r] = max_c |M(r, c)| / 127.  It is meant for the weights of neural
+  network layers at test time, stored with one row per output dimension as
+  in AffineComponent; it takes a quarter of the memory of the float matrix,
+  and AddMatQuantizedMat() multiplies by it much faster than AddMatMat().
+*/
+class QuantizedMatrix {
+ public:
+  QuantizedMatrix(): num_rows_(0), num_cols_(0), num_groups_(0) { }
+
+  template<typename Real>
+  explicit QuantizedMatrix(const MatrixBase<Real> &mat) { CopyFromMat(mat); }
+
+  /// This will resize *this and copy the contents of mat to *this.
+  template<typename Real>
+  void CopyFromMat(const MatrixBase<Real> &mat);
+
+  /// Copies the (approximated) contents to mat, which must have the correct
+  /// size.
+  template<typename Real>
+  void CopyToMat(MatrixBase<Real> *mat) const;
+
+  MatrixIndexT NumRows() const { return num_rows_; }
+  MatrixIndexT NumCols() const { return num_cols_; }
+
+  /// Returns the memory used, in bytes.
+  size_t SizeInBytes() const {
+    return data_.size() + scales_.size() * sizeof(float) +
+        row_sums_.size() * sizeof(int32);
+  }
+
+  void Swap(QuantizedMatrix *other);
+
+  void Clear();
+
+ private:
+  template<typename Real>
+  friend void AddMatQuantizedMat(Real alpha, const MatrixBase<Real> &A,
+                                 const QuantizedMatrix &B, Real beta,
+                                 MatrixBase<Real> *C);
+
+  MatrixIndexT num_rows_;
+  MatrixIndexT num_cols_;
+  // The columns in groups of 4, the last one padded with zeros.
+  MatrixIndexT num_groups_;
+  // The integers, in panels of 16 rows (the last one padded with zero rows):
+  // for each panel, for each group of 4 columns, the 4 integers of each of
+  // the 16 rows.  So AddMatQuantizedMat() gets 4 columns of 16 rows with one
+  // 64-byte load, which is how the vector instructions multiply them.
+  std::vector<int8> data_;
+  std::vector<float> scales_;  // the scale of each row (and padding row).
+  std::vector<int32> row_sums_;  // the sum of the integers in each row.
+};
+
+
+/**
+   Does *C = alpha * A * B^T + beta * *C, like AddMatMat() with B transposed,
+   but with both A and B quantized: B is already, and each row of A (e.g.
+   one frame of the input of a layer whose weights are B) is quantized to
+   unsigned 7-bit integers, with its own scale and zero point.  The products
+   are then computed exactly in integer arithmetic (u8 x s8 -> s32, with
+   AVX-512 VNNI or AVX2 where the CPU has them, see GetSimdLevel()), and
+   scaled back.  Seven bits are used so that the AVX2 instruction, which adds
+   pairs of products in 16 bits, cannot overflow; the result is the same
+   whichever instructions are used.
+
+   Each element of A is changed by at most half a quantization step, i.e.
+   (max - min of its row, including 0) / 254, and each element of B by at most
+   (max abs value of its row) / 254; the error of the products follows from
+   that, and is usually much smaller as the rounding errors mostly cancel.
+ */
+template<typename Real>
+void AddMatQuantizedMat(Real alpha, const MatrixBase<Real> &A,
+                        const QuantizedMatrix &B, Real beta,
+                        MatrixBase<Real> *C);
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_QUANTIZED_MATRIX_H_
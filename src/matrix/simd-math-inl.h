@@ -0,0 +1,245 @@
+// matrix/simd-math-inl.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+// Do not include this file directly.  It holds the vectorized kernels, which
+// simd-math.cc includes once for each instruction set, inside a namespace
+// that defines the class 'Ops' (the vector, integer-vector and mask types and
+// their operations) and with
+// the matching target options in effect; hence there is no include guard.
+// The constants are those of the Cephes expf, logf and tanhf.  LogSumExp()
+// works on doubles, with the types and operations of Ops whose names end in
+// D.
+
+typedef Ops::V V;
+typedef Ops::VI VI;
+typedef Ops::M M;  // the result of a comparison.
+
+// exp(x); see SimdExp().
+static inline V ExpKernel(V x) {
+  V nan_mask_x = x;
+  // Below -104 the result is zero and above 89 it is inf; clamping keeps the
+  // exponent arithmetic below in range.
+  x = Ops::Min(Ops::Max(x, Ops::Set1(-104.0f)), Ops::Set1(89.0f));
+  // x = n ln(2) + r with |r| <= ln(2)/2; ln(2) is split in two for accuracy.
+  V n = Ops::Round(Ops::Mul(x, Ops::Set1(1.44269504088896341f)));
+  V r = Ops::Fnmadd(n, Ops::Set1(0.693359375f), x);
+  r = Ops::Fnmadd(n, Ops::Set1(-2.12194440e-4f), r);
+  V p = Ops::Set1(1.9875691500e-4f);
+  p = Ops::Fmadd(p, r, Ops::Set1(1.3981999507e-3f));
+  p = Ops::Fmadd(p, r, Ops::Set1(8.3334519073e-3f));
+  p = Ops::Fmadd(p, r, Ops::Set1(4.1665795894e-2f));
+  p = Ops::Fmadd(p, r, Ops::Set1(1.6666665459e-1f));
+  p = Ops::Fmadd(p, r, Ops::Set1(5.0000001201e-1f));
+  V y = Ops::Fmadd(Ops::Mul(p, r), r, Ops::Add(r, Ops::Set1(1.0f)));
+  // Multiply by 2^n in two steps, so that each power of two is a normal
+  // float: this gives denormals and inf where the result needs them.
+  VI ni = Ops::ToInt(n), n1 = Ops::ShiftRightArith(ni, 1),
+      n2 = Ops::SubInt(ni, n1);
+  y = Ops::Mul(Ops::Mul(y, Ops::Pow2(n1)), Ops::Pow2(n2));
+  return Ops::Select(Ops::IsNan(nan_mask_x), nan_mask_x, y);
+}
+
+// log(x); see SimdLog().
+static inline V LogKernel(V x) {
+  V orig_x = x;
+  // Scale denormals up by 2^23 so that the mantissa extraction works.
+  M is_denormal = Ops::Less(x, Ops::Set1(1.17549435e-38f));
+  x = Ops::Select(is_denormal, Ops::Mul(x, Ops::Set1(8388608.0f)), x);
+  VI xi = Ops::AsInt(x);
+  // x = m * 2^e with m in [0.5, 1), as frexp() gives it.
+  VI ei = Ops::SubInt(Ops::ShiftRightLogical(xi, 23), Ops::Set1Int(126));
+  V e = Ops::Sub(Ops::ToFloat(ei),
+                 Ops::Select(is_denormal, Ops::Set1(23.0f), Ops::Set1(0.0f)));
+  V m = Ops::AsFloat(Ops::OrInt(Ops::AndInt(xi, Ops::Set1Int(0x007fffff)),
+                                Ops::Set1Int(0x3f000000)));
+  // If m < sqrt(0.5), use 2m - 1 and e - 1, else m - 1.
+  M small = Ops::Less(m, Ops::Set1(0.707106781186547524f));
+  e = Ops::Sub(e, Ops::Select(small, Ops::Set1(1.0f), Ops::Set1(0.0f)));
+  m = Ops::Sub(Ops::Add(m, Ops::Select(small, m, Ops::Set1(0.0f))),
+               Ops::Set1(1.0f));
+  V z = Ops::Mul(m, m);
+  V p = Ops::Set1(7.0376836292e-2f);
+  p = Ops::Fmadd(p, m, Ops::Set1(-1.1514610310e-1f));
+  p = Ops::Fmadd(p, m, Ops::Set1(1.1676998740e-1f));
+  p = Ops::Fmadd(p, m, Ops::Set1(-1.2420140846e-1f));
+  p = Ops::Fmadd(p, m, Ops::Set1(1.4249322787e-1f));
+  p = Ops::Fmadd(p, m, Ops::Set1(-1.6668057665e-1f));
+  p = Ops::Fmadd(p, m, Ops::Set1(2.0000714765e-1f));
+  p = Ops::Fmadd(p, m, Ops::Set1(-2.4999993993e-1f));
+  p = Ops::Fmadd(p, m, Ops::Set1(3.3333331174e-1f));
+  V y = Ops::Mul(Ops::Mul(p, m), z);
+  y = Ops::Fmadd(e, Ops::Set1(-2.12194440e-4f), y);
+  y = Ops::Fnmadd(Ops::Set1(0.5f), z, y);
+  y = Ops::Add(m, y);
+  y = Ops::Fmadd(e, Ops::Set1(0.693359375f), y);
+  // Special values: log(0) = -inf, log(inf) = inf, log(x < 0) = NaN, and
+  // NaN stays NaN.
+  V inf = Ops::Set1(std::numeric_limits<float>::infinity());
+  y = Ops::Select(Ops::Equal(orig_x, Ops::Set1(0.0f)),
+                  Ops::Set1(-std::numeric_limits<float>::infinity()), y);
+  y = Ops::Select(Ops::Equal(orig_x, inf), inf, y);
+  y = Ops::Select(Ops::Less(orig_x, Ops::Set1(0.0f)),
+                  Ops::Set1(std::numeric_limits<float>::quiet_NaN()), y);
+  return Ops::Select(Ops::IsNan(orig_x), orig_x, y);
+}
+
+// 1 / (1 + exp(-x)); see SimdSigmoid().
+static inline V SigmoidKernel(V x) {
+  // With e = exp(-|x|), sigmoid(x) is 1 / (1 + e) for x >= 0 and e / (1 + e)
+  // for x < 0, neither of which loses precision.
+  V e = ExpKernel(Ops::Neg(Ops::Abs(x))),
+      s = Ops::Div(Ops::Set1(1.0f), Ops::Add(Ops::Set1(1.0f), e));
+  return Ops::Select(Ops::Less(x, Ops::Set1(0.0f)), Ops::Mul(e, s), s);
+}
+
+// tanh(x); see SimdTanh().
+static inline V TanhKernel(V x) {
+  V a = Ops::Abs(x);
+  // For |x| >= 0.625, tanh(|x|) = 1 - 2 / (exp(2|x|) + 1).
+  V e = ExpKernel(Ops::Add(a, a));
+  V big = Ops::Sub(Ops::Set1(1.0f),
+                   Ops::Div(Ops::Set1(2.0f), Ops::Add(e, Ops::Set1(1.0f))));
+  big = Ops::CopySign(big, x);
+  // For |x| < 0.625 a polynomial, as the above would lose precision.
+  V s = Ops::Mul(x, x);
+  V p = Ops::Set1(-5.70498872745e-3f);
+  p = Ops::Fmadd(p, s, Ops::Set1(2.06390887954e-2f));
+  p = Ops::Fmadd(p, s, Ops::Set1(-5.37397155531e-2f));
+  p = Ops::Fmadd(p, s, Ops::Set1(1.33314422036e-1f));
+  p = Ops::Fmadd(p, s, Ops::Set1(-3.33332819422e-1f));
+  V small = Ops::Fmadd(Ops::Mul(p, s), x, x);
+  return Ops::Select(Ops::Less(a, Ops::Set1(0.625f)), small, big);
+}
+
+// Applies 'kernel' to x[0..n-1], writing y[0..n-1]; the last partial vector
+// goes through a buffer.  Like all the functions here, it ends with
+// Ops::ZeroUpper(): GCC does not emit vzeroupper for functions compiled with
+// "#pragma GCC target", and without it the SSE code that follows (everything
+// compiled with the default options, and libm) can be many times slower.
+template<V (*kernel)(V)>
+static void ApplyKernel(const float *x, float *y, MatrixIndexT n) {
+  MatrixIndexT i = 0;
+  for (; i + Ops::kWidth <= n; i += Ops::kWidth)
+    Ops::Store(y + i, kernel(Ops::Load(x + i)));
+  if (i < n) {
+    float buf[Ops::kWidth] = { 0.0f };
+    for (MatrixIndexT j = i; j < n; j++) buf[j - i] = x[j];
+    Ops::Store(buf, kernel(Ops::Load(buf)));
+    for (MatrixIndexT j = i; j < n; j++) y[j] = buf[j - i];
+  }
+  Ops::ZeroUpper();
+}
+
+static void Exp(const float *x, float *y, MatrixIndexT n) {
+  ApplyKernel<ExpKernel>(x, y, n);
+}
+static void Log(const float *x, float *y, MatrixIndexT n) {
+  ApplyKernel<LogKernel>(x, y, n);
+}
+static void Sigmoid(const float *x, float *y, MatrixIndexT n) {
+  ApplyKernel<SigmoidKernel>(x, y, n);
+}
+static void Tanh(const float *x, float *y, MatrixIndexT n) {
+  ApplyKernel<TanhKernel>(x, y, n);
+}
+
+static float ExpShiftSum(const float *x, float offset, float *y,
+                         MatrixIndexT n) {
+  V offset_vec = Ops::Set1(offset), sum = Ops::Set1(0.0f);
+  MatrixIndexT i = 0;
+  for (; i + Ops::kWidth <= n; i += Ops::kWidth) {
+    V e = ExpKernel(Ops::Sub(Ops::Load(x + i), offset_vec));
+    if (y != NULL) Ops::Store(y + i, e);
+    sum = Ops::Add(sum, e);
+  }
+  float ans = Ops::Sum(sum);
+  if (i < n) {
+    float buf[Ops::kWidth] = { 0.0f };
+    for (MatrixIndexT j = i; j < n; j++) buf[j - i] = x[j];
+    Ops::Store(buf, ExpKernel(Ops::Sub(Ops::Load(buf), offset_vec)));
+    for (MatrixIndexT j = i; j < n; j++) {
+      ans += buf[j - i];
+      if (y != NULL) y[j] = buf[j - i];
+    }
+  }
+  Ops::ZeroUpper();
+  return ans;
+}
+
+// exp(x) for doubles x <= 0; see LogSumExp().  Results that would be below
+// the smallest normal double (x < -708) are zero.
+static inline Ops::VD ExpKernelD(Ops::VD x) {
+  typedef Ops::VD VD;
+  VD orig_x = x;
+  // Clamp, so 2^n stays a normal number; NaN stays NaN (MaxD() returns its
+  // second argument).
+  x = Ops::MaxD(Ops::Set1D(-708.0), x);
+  // x = n ln(2) + r with |r| <= ln(2)/2, with ln(2) in two parts as in fdlibm.
+  VD n = Ops::RoundD(Ops::MulD(x, Ops::Set1D(1.4426950408889634)));
+  VD r = Ops::FnmaddD(n, Ops::Set1D(6.93147180369123816490e-01), x);
+  r = Ops::FnmaddD(n, Ops::Set1D(1.90821492927058770002e-10), r);
+  // The Taylor series of exp(r) up to r^13, whose remainder is below 2^-57
+  // for |r| <= ln(2)/2.
+  VD p = Ops::Set1D(1.0 / 6227020800.0);
+  p = Ops::FmaddD(p, r, Ops::Set1D(1.0 / 479001600.0));
+  p = Ops::FmaddD(p, r, Ops::Set1D(1.0 / 39916800.0));
+  p = Ops::FmaddD(p, r, Ops::Set1D(1.0 / 3628800.0));
+  p = Ops::FmaddD(p, r, Ops::Set1D(1.0 / 362880.0));
+  p = Ops::FmaddD(p, r, Ops::Set1D(1.0 / 40320.0));
+  p = Ops::FmaddD(p, r, Ops::Set1D(1.0 / 5040.0));
+  p = Ops::FmaddD(p, r, Ops::Set1D(1.0 / 720.0));
+  p = Ops::FmaddD(p, r, Ops::Set1D(1.0 / 120.0));
+  p = Ops::FmaddD(p, r, Ops::Set1D(1.0 / 24.0));
+  p = Ops::FmaddD(p, r, Ops::Set1D(1.0 / 6.0));
+  p = Ops::FmaddD(p, r, Ops::Set1D(0.5));
+  p = Ops::FmaddD(p, r, Ops::Set1D(1.0));
+  p = Ops::FmaddD(p, r, Ops::Set1D(1.0));
+  return Ops::SelectLessD(orig_x, Ops::Set1D(-708.0), Ops::Set1D(0.0),
+                          Ops::MulD(p, Ops::Pow2D(n)));
+}
+
+static double LogSumExp(const double *x, MatrixIndexT n) {
+  typedef Ops::VD VD;
+  const int kWidthD = Ops::kWidthD;
+  const double inf = std::numeric_limits<double>::infinity();
+  double max = -inf;
+  MatrixIndexT i = 0;
+  if (n >= kWidthD) {
+    VD m = Ops::LoadD(x);
+    for (i = kWidthD; i + kWidthD <= n; i += kWidthD)
+      m = Ops::MaxD(m, Ops::LoadD(x + i));
+    max = Ops::MaxOfD(m);
+  }
+  for (; i < n; i++)
+    if (x[i] > max) max = x[i];
+  if (max == -inf || max == inf) {
+    Ops::ZeroUpper();
+    return max;
+  }
+  VD offset = Ops::Set1D(max), sum = Ops::Set1D(0.0);
+  for (i = 0; i + kWidthD <= n; i += kWidthD)
+    sum = Ops::AddD(sum, ExpKernelD(Ops::SubD(Ops::LoadD(x + i), offset)));
+  if (i < n) {
+    double buf[kWidthD];
+    for (MatrixIndexT j = 0; j < kWidthD; j++)
+      buf[j] = (i + j < n ? x[i + j] : -inf);
+    sum = Ops::AddD(sum, ExpKernelD(Ops::SubD(Ops::LoadD(buf), offset)));
+  }
+  double ans = Ops::SumD(sum);
+  Ops::ZeroUpper();
+  return max + kaldi::Log(ans);
+}
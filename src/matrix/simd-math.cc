@@ -0,0 +1,460 @@
+// matrix/simd-math.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <limits>
+
+#include "base/kaldi-math.h"
+#include "matrix/simd-math.h"
+
+// The vectorized code is compiled with the AVX2 or AVX-512 target enabled
+// for just those functions, so the rest of the library does not require
+// these instruction sets; GetSimdLevel() checks the CPU before they are used.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KALDI_SIMD_MATH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace kaldi {
+
+namespace simd_scalar {
+
+static void Exp(const float *x, float *y, MatrixIndexT n) {
+  for (MatrixIndexT i = 0; i < n; i++)
+    y[i] = kaldi::Exp(x[i]);
+}
+
+static void Log(const float *x, float *y, MatrixIndexT n) {
+  for (MatrixIndexT i = 0; i < n; i++)
+    y[i] = kaldi::Log(x[i]);
+}
+
+static void Sigmoid(const float *x, float *y, MatrixIndexT n) {
+  for (MatrixIndexT i = 0; i < n; i++) {
+    float f = x[i];
+    // We aim to avoid floating-point overflow here.
+    if (f > 0.0) {
+      f = 1.0 / (1.0 + kaldi::Exp(-f));
+    } else {
+      float ef = kaldi::Exp(f);
+      f = ef / (ef + 1.0);
+    }
+    y[i] = f;
+  }
+}
+
+static void Tanh(const float *x, float *y, MatrixIndexT n) {
+  for (MatrixIndexT i = 0; i < n; i++) {
+    float f = x[i];
+    if (f > 0.0) {
+      float inv_expf = kaldi::Exp(-f);
+      f = -1.0 + 2.0 / (1.0 + inv_expf * inv_expf);
+    } else {
+      float expf = kaldi::Exp(f);
+      f = 1.0 - 2.0 / (1.0 + expf * expf);
+    }
+    y[i] = f;
+  }
+}
+
+static float ExpShiftSum(const float *x, float offset, float *y,
+                         MatrixIndexT n) {
+  float sum = 0.0;
+  for (MatrixIndexT i = 0; i < n; i++) {
+    float e = kaldi::Exp(x[i] - offset);
+    if (y != NULL) y[i] = e;
+    sum += e;
+  }
+  return sum;
+}
+
+// This is also used for short arrays at all instruction sets.
+static double LogSumExp(const double *x, MatrixIndexT n) {
+  if (n <= 1)
+    return (n == 0 ? kLogZeroDouble : x[0]);
+  MatrixIndexT m = 0;
+  for (MatrixIndexT i = 1; i < n; i++)
+    if (x[i] > x[m]) m = i;
+  double max = x[m];
+  if (max == kLogZeroDouble || max == -kLogZeroDouble)
+    return max;
+  // As in LogAdd(), skip the exp() of the numbers too small to matter.
+  double sum = 0.0;
+  for (MatrixIndexT i = 0; i < n; i++) {
+    double diff = x[i] - max;
+    if (i != m && diff >= kMinLogDiffDouble)
+      sum += kaldi::Exp(diff);
+  }
+  return (sum == 0.0 ? max : max + kaldi::Log1p(sum));
+}
+
+}  // namespace simd_scalar
+
+
+#ifdef KALDI_SIMD_MATH_X86
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+namespace simd_avx2 {
+
+struct Ops {
+  typedef __m256 V;
+  typedef __m256i VI;
+  typedef __m256 M;
+  static const int kWidth = 8;
+
+  static inline V Load(const float *x) { return _mm256_loadu_ps(x); }
+  static inline void Store(float *y, V v) { _mm256_storeu_ps(y, v); }
+  static inline V Set1(float f) { return _mm256_set1_ps(f); }
+  static inline VI Set1Int(int32 i) { return _mm256_set1_epi32(i); }
+
+  static inline V Add(V a, V b) { return _mm256_add_ps(a, b); }
+  static inline V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+  static inline V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  static inline V Div(V a, V b) { return _mm256_div_ps(a, b); }
+  // a * b + c and c - a * b.
+  static inline V Fmadd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+  static inline V Fnmadd(V a, V b, V c) { return _mm256_fnmadd_ps(a, b, c); }
+  static inline V Min(V a, V b) { return _mm256_min_ps(a, b); }
+  static inline V Max(V a, V b) { return _mm256_max_ps(a, b); }
+  static inline V Round(V a) {
+    return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  static inline V Abs(V a) {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);
+  }
+  static inline V Neg(V a) { return _mm256_xor_ps(_mm256_set1_ps(-0.0f), a); }
+  // The magnitude of 'mag' with the sign of 'sign'.
+  static inline V CopySign(V mag, V sign) {
+    V sign_bit = _mm256_set1_ps(-0.0f);
+    return _mm256_or_ps(_mm256_andnot_ps(sign_bit, mag),
+                        _mm256_and_ps(sign_bit, sign));
+  }
+
+  // mask ? a : b.
+  static inline V Select(M mask, V a, V b) {
+    return _mm256_blendv_ps(b, a, mask);
+  }
+  static inline M Less(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static inline M Equal(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+  static inline M IsNan(V a) { return _mm256_cmp_ps(a, a, _CMP_UNORD_Q); }
+
+  static inline VI ToInt(V a) { return _mm256_cvtps_epi32(a); }
+  static inline V ToFloat(VI a) { return _mm256_cvtepi32_ps(a); }
+  static inline VI AsInt(V a) { return _mm256_castps_si256(a); }
+  static inline V AsFloat(VI a) { return _mm256_castsi256_ps(a); }
+  static inline VI ShiftRightArith(VI a, int n) {
+    return _mm256_srai_epi32(a, n);
+  }
+  static inline VI ShiftRightLogical(VI a, int n) {
+    return _mm256_srli_epi32(a, n);
+  }
+  static inline VI SubInt(VI a, VI b) { return _mm256_sub_epi32(a, b); }
+  static inline VI AndInt(VI a, VI b) { return _mm256_and_si256(a, b); }
+  static inline VI OrInt(VI a, VI b) { return _mm256_or_si256(a, b); }
+  // 2^n, for -126 <= n <= 127.
+  static inline V Pow2(VI n) {
+    return _mm256_castsi256_ps(_mm256_slli_epi32(
+        _mm256_add_epi32(n, _mm256_set1_epi32(127)), 23));
+  }
+  static inline float Sum(V a) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(a),
+                          _mm256_extractf128_ps(a, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+  }
+  // Clears the upper halves of the vector registers; see ApplyKernel().
+  static inline void ZeroUpper() { _mm256_zeroupper(); }
+
+  // Doubles, for LogSumExp().
+  typedef __m256d VD;
+  static const int kWidthD = 4;
+  static inline VD LoadD(const double *x) { return _mm256_loadu_pd(x); }
+  static inline VD Set1D(double d) { return _mm256_set1_pd(d); }
+  static inline VD AddD(VD a, VD b) { return _mm256_add_pd(a, b); }
+  static inline VD SubD(VD a, VD b) { return _mm256_sub_pd(a, b); }
+  static inline VD MulD(VD a, VD b) { return _mm256_mul_pd(a, b); }
+  static inline VD FmaddD(VD a, VD b, VD c) { return _mm256_fmadd_pd(a, b, c); }
+  static inline VD FnmaddD(VD a, VD b, VD c) {
+    return _mm256_fnmadd_pd(a, b, c);
+  }
+  // max(a, b); b if either is NaN.
+  static inline VD MaxD(VD a, VD b) { return _mm256_max_pd(a, b); }
+  static inline VD RoundD(VD a) {
+    return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  // a < b ? c : d.
+  static inline VD SelectLessD(VD a, VD b, VD c, VD d) {
+    return _mm256_blendv_pd(d, c, _mm256_cmp_pd(a, b, _CMP_LT_OQ));
+  }
+  // 2^n, for integer n with -1022 <= n <= 1023.
+  static inline VD Pow2D(VD n) {
+    __m256i e = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n));
+    return _mm256_castsi256_pd(_mm256_slli_epi64(
+        _mm256_add_epi64(e, _mm256_set1_epi64x(1023)), 52));
+  }
+  static inline double SumD(VD a) {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(a),
+                           _mm256_extractf128_pd(a, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+  }
+  static inline double MaxOfD(VD a) {
+    __m128d m = _mm_max_pd(_mm256_castpd256_pd128(a),
+                           _mm256_extractf128_pd(a, 1));
+    return _mm_cvtsd_f64(_mm_max_sd(m, _mm_unpackhi_pd(m, m)));
+  }
+};
+
+#include "matrix/simd-math-inl.h"
+
+}  // namespace simd_avx2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push(__attribute__((target("avx512f,avx2,fma"))), \
+                             apply_to = function)
+#else
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx2,fma")
+// Some versions of GCC warn about the deliberately undefined vectors in the
+// AVX-512 intrinsics.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace simd_avx512 {
+
+struct Ops {
+  typedef __m512 V;
+  typedef __m512i VI;
+  typedef __mmask16 M;
+  static const int kWidth = 16;
+
+  static inline V Load(const float *x) { return _mm512_loadu_ps(x); }
+  static inline void Store(float *y, V v) { _mm512_storeu_ps(y, v); }
+  static inline V Set1(float f) { return _mm512_set1_ps(f); }
+  static inline VI Set1Int(int32 i) { return _mm512_set1_epi32(i); }
+
+  static inline V Add(V a, V b) { return _mm512_add_ps(a, b); }
+  static inline V Sub(V a, V b) { return _mm512_sub_ps(a, b); }
+  static inline V Mul(V a, V b) { return _mm512_mul_ps(a, b); }
+  static inline V Div(V a, V b) { return _mm512_div_ps(a, b); }
+  // a * b + c and c - a * b.
+  static inline V Fmadd(V a, V b, V c) { return _mm512_fmadd_ps(a, b, c); }
+  static inline V Fnmadd(V a, V b, V c) { return _mm512_fnmadd_ps(a, b, c); }
+  static inline V Min(V a, V b) { return _mm512_min_ps(a, b); }
+  static inline V Max(V a, V b) { return _mm512_max_ps(a, b); }
+  static inline V Round(V a) {
+    return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT |
+                                _MM_FROUND_NO_EXC);
+  }
+  // The bitwise float operations are AVX-512DQ, so these use the integer
+  // ones.
+  static inline V Abs(V a) {
+    return AsFloat(_mm512_and_epi32(AsInt(a), _mm512_set1_epi32(0x7fffffff)));
+  }
+  static inline V Neg(V a) {
+    return AsFloat(_mm512_xor_epi32(AsInt(a), _mm512_set1_epi32(0x80000000)));
+  }
+  // The magnitude of 'mag' with the sign of 'sign'.
+  static inline V CopySign(V mag, V sign) {
+    VI sign_bit = _mm512_set1_epi32(0x80000000);
+    return AsFloat(_mm512_or_epi32(_mm512_andnot_epi32(sign_bit, AsInt(mag)),
+                                   _mm512_and_epi32(sign_bit, AsInt(sign))));
+  }
+
+  // mask ? a : b.
+  static inline V Select(M mask, V a, V b) {
+    return _mm512_mask_blend_ps(mask, b, a);
+  }
+  static inline M Less(V a, V b) {
+    return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+  }
+  static inline M Equal(V a, V b) {
+    return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ);
+  }
+  static inline M IsNan(V a) { return _mm512_cmp_ps_mask(a, a, _CMP_UNORD_Q); }
+
+  static inline VI ToInt(V a) { return _mm512_cvtps_epi32(a); }
+  static inline V ToFloat(VI a) { return _mm512_cvtepi32_ps(a); }
+  static inline VI AsInt(V a) { return _mm512_castps_si512(a); }
+  static inline V AsFloat(VI a) { return _mm512_castsi512_ps(a); }
+  static inline VI ShiftRightArith(VI a, int n) {
+    return _mm512_srai_epi32(a, n);
+  }
+  static inline VI ShiftRightLogical(VI a, int n) {
+    return _mm512_srli_epi32(a, n);
+  }
+  static inline VI SubInt(VI a, VI b) { return _mm512_sub_epi32(a, b); }
+  static inline VI AndInt(VI a, VI b) { return _mm512_and_epi32(a, b); }
+  static inline VI OrInt(VI a, VI b) { return _mm512_or_epi32(a, b); }
+  // 2^n, for -126 <= n <= 127.
+  static inline V Pow2(VI n) {
+    return _mm512_castsi512_ps(_mm512_slli_epi32(
+        _mm512_add_epi32(n, _mm512_set1_epi32(127)), 23));
+  }
+  static inline float Sum(V a) {
+    __m256 s = _mm256_add_ps(_mm512_castps512_ps256(a),
+                             _mm256_castpd_ps(_mm512_extractf64x4_pd(
+                                 _mm512_castps_pd(a), 1)));
+    return simd_avx2::Ops::Sum(s);
+  }
+  static inline void ZeroUpper() { _mm256_zeroupper(); }
+
+  typedef __m512d VD;
+  static const int kWidthD = 8;
+  static inline VD LoadD(const double *x) { return _mm512_loadu_pd(x); }
+  static inline VD Set1D(double d) { return _mm512_set1_pd(d); }
+  static inline VD AddD(VD a, VD b) { return _mm512_add_pd(a, b); }
+  static inline VD SubD(VD a, VD b) { return _mm512_sub_pd(a, b); }
+  static inline VD MulD(VD a, VD b) { return _mm512_mul_pd(a, b); }
+  static inline VD FmaddD(VD a, VD b, VD c) { return _mm512_fmadd_pd(a, b, c); }
+  static inline VD FnmaddD(VD a, VD b, VD c) {
+    return _mm512_fnmadd_pd(a, b, c);
+  }
+  static inline VD MaxD(VD a, VD b) { return _mm512_max_pd(a, b); }
+  static inline VD RoundD(VD a) {
+    return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEAREST_INT |
+                                _MM_FROUND_NO_EXC);
+  }
+  static inline VD SelectLessD(VD a, VD b, VD c, VD d) {
+    return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(a, b, _CMP_LT_OQ), d, c);
+  }
+  static inline VD Pow2D(VD n) {
+    __m512i e = _mm512_cvtepi32_epi64(_mm512_cvtpd_epi32(n));
+    return _mm512_castsi512_pd(_mm512_slli_epi64(
+        _mm512_add_epi64(e, _mm512_set1_epi64(1023)), 52));
+  }
+  static inline double SumD(VD a) {
+    return simd_avx2::Ops::SumD(_mm256_add_pd(_mm512_castpd512_pd256(a),
+                                              _mm512_extractf64x4_pd(a, 1)));
+  }
+  static inline double MaxOfD(VD a) {
+    return simd_avx2::Ops::MaxOfD(_mm256_max_pd(_mm512_castpd512_pd256(a),
+                                                _mm512_extractf64x4_pd(a, 1)));
+  }
+};
+
+#include "matrix/simd-math-inl.h"
+
+}  // namespace simd_avx512
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+#endif  // KALDI_SIMD_MATH_X86
+
+
+static SimdLevel DetectSimdLevel() {
+#ifdef KALDI_SIMD_MATH_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return kSimdAvx512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return kSimdAvx2;
+#endif
+  return kSimdNone;
+}
+
+// The level the CPU supports, and the one in use.
+static SimdLevel cpu_simd_level = DetectSimdLevel();
+static SimdLevel simd_level = cpu_simd_level;
+
+SimdLevel GetSimdLevel() { return simd_level; }
+
+void SetSimdLevel(SimdLevel level) {
+  simd_level = std::min(level, cpu_simd_level);
+}
+
+void SimdExp(const float *x, float *y, MatrixIndexT n) {
+#ifdef KALDI_SIMD_MATH_X86
+  if (simd_level == kSimdAvx512) return simd_avx512::Exp(x, y, n);
+  if (simd_level == kSimdAvx2) return simd_avx2::Exp(x, y, n);
+#endif
+  simd_scalar::Exp(x, y, n);
+}
+
+float SimdExpShiftSum(const float *x, float offset, float *y,
+                      MatrixIndexT n) {
+#ifdef KALDI_SIMD_MATH_X86
+  if (simd_level == kSimdAvx512)
+    return simd_avx512::ExpShiftSum(x, offset, y, n);
+  if (simd_level == kSimdAvx2)
+    return simd_avx2::ExpShiftSum(x, offset, y, n);
+#endif
+  return simd_scalar::ExpShiftSum(x, offset, y, n);
+}
+
+float SimdLogSumExp(const float *x, MatrixIndexT n) {
+  float max = kLogZeroFloat;
+  for (MatrixIndexT i = 0; i < n; i++)
+    if (x[i] > max) max = x[i];
+  if (max == kLogZeroFloat || max == -kLogZeroFloat)
+    return max;
+  return max + Log(SimdExpShiftSum(x, max, NULL, n));
+}
+
+double SimdLogSumExp(const double *x, MatrixIndexT n) {
+#ifdef KALDI_SIMD_MATH_X86
+  // With fewer numbers than this, the vectors are mostly padding.
+  const MatrixIndexT kMinVectorized = 8;
+  if (n < kMinVectorized)
+    return simd_scalar::LogSumExp(x, n);
+  if (simd_level == kSimdAvx512) return simd_avx512::LogSumExp(x, n);
+  if (simd_level == kSimdAvx2) return simd_avx2::LogSumExp(x, n);
+#endif
+  return simd_scalar::LogSumExp(x, n);
+}
+
+void SimdLog(const float *x, float *y, MatrixIndexT n) {
+#ifdef KALDI_SIMD_MATH_X86
+  if (simd_level == kSimdAvx512) return simd_avx512::Log(x, y, n);
+  if (simd_level == kSimdAvx2) return simd_avx2::Log(x, y, n);
+#endif
+  simd_scalar::Log(x, y, n);
+}
+
+void SimdSigmoid(const float *x, float *y, MatrixIndexT n) {
+#ifdef KALDI_SIMD_MATH_X86
+  if (simd_level == kSimdAvx512) return simd_avx512::Sigmoid(x, y, n);
+  if (simd_level == kSimdAvx2) return simd_avx2::Sigmoid(x, y, n);
+#endif
+  simd_scalar::Sigmoid(x, y, n);
+}
+
+void SimdTanh(const float *x, float *y, MatrixIndexT n) {
+#ifdef KALDI_SIMD_MATH_X86
+  if (simd_level == kSimdAvx512) return simd_avx512::Tanh(x, y, n);
+  if (simd_level == kSimdAvx2) return simd_avx2::Tanh(x, y, n);
+#endif
+  simd_scalar::Tanh(x, y, n);
+}
+
+}  // namespace kaldi
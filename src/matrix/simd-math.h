@@ -0,0 +1,92 @@
+// matrix/simd-math.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_SIMD_MATH_H_
+#define KALDI_MATRIX_SIMD_MATH_H_
+
+#include "matrix/matrix-common.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_funcs_misc
+/// @{
+
+/**
+   Element-wise exp, log, sigmoid and tanh of float arrays, used by the
+   float versions of VectorBase and MatrixBase ApplyExp(), ApplyLog(),
+   ApplySoftMax(), ApplyLogSoftMax(), Sigmoid() and Tanh().
+
+   On x86 CPUs with AVX2 and FMA, or AVX-512, these use polynomial
+   approximations (after Cephes) on 8 or 16 floats at a time; the
+   instruction set is chosen at run time, so the binaries still run on older
+   CPUs, where, as on other architectures, the functions are plain loops
+   calling Exp() and Log() from base/kaldi-math.h.
+
+   Accuracy of the vectorized versions: exp and log are within 2 ulp
+   (log for all positive inputs, including denormals; exp for inputs
+   whose result is a normal float, below which it goes smoothly to zero);
+   sigmoid and tanh are within 3 ulp.  Special values behave as in libm:
+   exp(-inf) = 0, exp of large inputs is inf, log(0) = -inf, log of
+   negative numbers is NaN, and NaN inputs give NaN.
+
+   In all of these, 'y' may be the same array as 'x'.
+*/
+
+enum SimdLevel {
+  kSimdNone = 0,    // scalar code.
+  kSimdAvx2 = 1,    // AVX2 and FMA, 8 floats at a time.
+  kSimdAvx512 = 2   // AVX-512F, 16 floats at a time.
+};
+
+/// Returns the instruction set these functions use: the best one the CPU
+/// supports, unless SetSimdLevel() was called.
+SimdLevel GetSimdLevel();
+
+/// Makes these functions use 'level', or the best the CPU supports if that
+/// is lower.  For testing; it's not thread safe.
+void SetSimdLevel(SimdLevel level);
+
+/// Sets y[i] = exp(x[i]) for 0 <= i < n.
+void SimdExp(const float *x, float *y, MatrixIndexT n);
+
+/// Sets y[i] = exp(x[i] - offset) for 0 <= i < n and returns the sum of the
+/// y[i].  If y is NULL it just returns the sum.  This is the inner loop of a
+/// softmax, with 'offset' the maximum of the x[i].
+float SimdExpShiftSum(const float *x, float offset, float *y, MatrixIndexT n);
+
+/// Returns log(sum_i exp(x[i])) over 0 <= i < n, computed as in a softmax,
+/// relative to the maximum, with one Log() for the whole array; this is much
+/// faster than n - 1 calls to LogAdd().  Returns -inf if n == 0.  The double
+/// version is vectorized too (with a polynomial exp() accurate to about 1
+/// ulp), for the lattice forward-backward code.
+float SimdLogSumExp(const float *x, MatrixIndexT n);
+double SimdLogSumExp(const double *x, MatrixIndexT n);
+
+/// Sets y[i] = log(x[i]) for 0 <= i < n.
+void SimdLog(const float *x, float *y, MatrixIndexT n);
+
+/// Sets y[i] = 1 / (1 + exp(-x[i])) for 0 <= i < n.
+void SimdSigmoid(const float *x, float *y, MatrixIndexT n);
+
+/// Sets y[i] = tanh(x[i]) for 0 <= i < n.
+void SimdTanh(const float *x, float *y, MatrixIndexT n);
+
+/// @} end of "addtogroup matrix_funcs_misc"
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_SIMD_MATH_H_
@@ -1153,8 +1153,7 @@ void GeneralMatrix::AddToMat(BaseFloat alpha, MatrixBase<BaseFloat> *mat,
       break;
     }
     case kCompressedMatrix: {
-      Matrix<BaseFloat> temp_mat(cmat_);
-      mat->AddMat(alpha, temp_mat, trans);
+      cmat_.AddToMat(alpha, mat, trans);
       break;
     }
     default:
@@ -20,6 +20,8 @@
 #include "nnet3/decodable-simple-looped.h"
 #include "nnet3/nnet-utils.h"
 #include "nnet3/nnet-compile-looped.h"
+#include "matrix/panel-matrix.h"
+#include "cudamatrix/cu-device.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -71,6 +73,20 @@ void DecodableNnetSimpleLoopedInfo::Init(
   int32 ivector_period = frames_per_chunk;
   if (has_ivectors)
     ModifyNnetIvectorPeriod(ivector_period, nnet);
+  // The chunks are small, so packing the weights once here can make each
+  // multiplication by them faster; but not on the GPU, and only for as many
+  // rows as PanelMatrixIsFaster() allows, else the copies just take memory.
+  if (opts.pack_weights) {
+    bool use_gpu = false;
+#if HAVE_CUDA == 1
+    use_gpu = CuDevice::Instantiate().Enabled();
+#endif
+    if (!use_gpu && PanelMatrixIsFaster(frames_per_chunk))
+      SetPackedTestMode(true, nnet);
+    else
+      KALDI_LOG << "Not packing the weights, as it would not be faster "
+                << (use_gpu ? "on the GPU." : "for this chunk size or CPU.");
+  }
 
   int32 num_sequences = 1;  // we're processing one utterance at a time.
 
@@ -49,6 +49,7 @@ struct NnetSimpleLoopedComputationOptions {
   int32 frames_per_chunk;
   BaseFloat acoustic_scale;
   bool debug_computation;
+  bool pack_weights;
   NnetOptimizeOptions optimize_config;
   NnetComputeOptions compute_config;
   NnetSimpleLoopedComputationOptions():
@@ -56,7 +57,8 @@ struct NnetSimpleLoopedComputationOptions {
       frame_subsampling_factor(1),
       frames_per_chunk(20),
       acoustic_scale(0.1),
-      debug_computation(false) { }
+      debug_computation(false),
+      pack_weights(false) { }
 
   void Check() const {
     KALDI_ASSERT(extra_left_context_initial >= 0 &&
@@ -83,6 +85,13 @@ struct NnetSimpleLoopedComputationOptions {
                    "if needed.");
     opts->Register("debug-computation", &debug_computation, "If true, turn on "
                    "debug for the actual computation (very verbose!)");
+    opts->Register("pack-weights", &pack_weights, "If true, keep copies of "
+                   "the weights of the affine and TDNN layers in a layout "
+                   "that is faster to multiply by a few frames at a time "
+                   "on the CPU (see SetPackedTestMode()); uses extra memory "
+                   "about the size of those weights.  Ignored when using a "
+                   "GPU, or if --frames-per-chunk is too large or the CPU "
+                   "has no AVX2 for it to help.");
 
     // register the optimization options with the prefix "optimization".
     ParseOptions optimization_opts("optimization", opts);
@@ -457,9 +457,14 @@ class TdnnComponent: public UpdatableComponent {
   TdnnComponent(const TdnnComponent &other);
 
   virtual int32 InputDim() const {
+    if (!half_params_.empty())
+      return half_params_[0].NumCols();
     return linear_params_.NumCols() / static_cast<int32>(time_offsets_.size());
   }
-  virtual int32 OutputDim() const { return linear_params_.NumRows(); }
+  virtual int32 OutputDim() const {
+    return (half_params_.empty() ? linear_params_.NumRows() :
+            half_params_[0].NumRows());
+  }
 
   virtual std::string Info() const;
   virtual void InitFromConfig(ConfigLine *cfl);
@@ -551,7 +556,12 @@ class TdnnComponent: public UpdatableComponent {
     std::vector<int32> row_offsets;
   };
 
-  CuMatrixBase<BaseFloat> &LinearParams() { return linear_params_; }
+  // The caller may change the parameters, so this discards the copies made by
+  // SetQuantized() and SetPacked().
+  CuMatrixBase<BaseFloat> &LinearParams() {
+    ClearParamCopies();
+    return linear_params_;
+  }
 
   // This allows you to resize the vector in order to add a bias where
   // there previously was none-- obviously this should be done carefully.
@@ -560,8 +570,36 @@ class TdnnComponent: public UpdatableComponent {
   BaseFloat OrthonormalConstraint() const { return orthonormal_constraint_; }
 
   void ConsolidateMemory();
+
+  /// If quantized == true, makes Propagate() use 8-bit copies of the linear
+  /// parameters (one per time offset) when running on the CPU; test time
+  /// only, as for AffineComponent::SetQuantized().
+  void SetQuantized(bool quantized);
+
+  /// If packed == true, makes Propagate() use copies of the linear parameters
+  /// (one per time offset) in the layout of PanelMatrix, as for
+  /// AffineComponent::SetPacked().
+  void SetPacked(bool packed);
+
+  bool IsQuantized() const { return !quantized_params_.empty(); }
+  bool IsPacked() const { return !packed_params_.empty(); }
+
+  /// Keeps the linear parameters only in 16-bit floating point (one
+  /// HalfMatrix per time offset), or converts them back to float; test time
+  /// only, see AffineComponent::SetHalfPrecision().
+  void SetHalfPrecision(bool half, HalfMatrixType type);
  private:
 
+  // Discards the copies made by SetQuantized() and SetPacked(); called by
+  // the functions that change linear_params_, as the copies would be stale.
+  void ClearParamCopies() {
+    quantized_params_.clear();
+    packed_params_.clear();
+  }
+
+  // Converts half_params_ back to float, in the layout of linear_params_.
+  void GetHalfParams(Matrix<BaseFloat> *linear_params) const;
+
   // This static function is a utility function that extracts a CuSubMatrix
   // representing a subset of rows of 'input_matrix'.
   // The numpy syntax would be:
@@ -626,6 +664,17 @@ class TdnnComponent: public UpdatableComponent {
   // Preconditioner for the output space, of dimension
   // linear_params_.NumRows().
   OnlineNaturalGradient preconditioner_out_;
+
+  // Empty unless SetQuantized(true) was called; otherwise element i is the
+  // quantized version of the columns of linear_params_ for time_offsets_[i].
+  std::vector<QuantizedMatrix> quantized_params_;
+  // Empty unless SetPacked(true) was called; otherwise like quantized_params_,
+  // but packed.
+  std::vector<PanelMatrix> packed_params_;
+  // Empty unless SetHalfPrecision(true, ...) was called, in which case
+  // linear_params_ is empty; otherwise like quantized_params_, but in 16-bit
+  // floating point.
+  std::vector<HalfMatrix> half_params_;
 };
 
 
@@ -1090,6 +1090,7 @@ void RectifiedLinearComponent::StoreStats(
 }
 
 void AffineComponent::Scale(BaseFloat scale) {
+  ClearLinearParamCopies();
   if (scale == 0.0) {
     // If scale == 0.0 we call SetZero() which will get rid of NaN's and inf's.
     linear_params_.SetZero();
@@ -1101,12 +1102,14 @@ void AffineComponent::Scale(BaseFloat scale) {
 }
 
 void AffineComponent::Resize(int32 input_dim, int32 output_dim) {
+  ClearLinearParamCopies();
   KALDI_ASSERT(input_dim > 0 && output_dim > 0);
   bias_params_.Resize(output_dim);
   linear_params_.Resize(output_dim, input_dim);
 }
 
 void AffineComponent::Add(BaseFloat alpha, const Component &other_in) {
+  ClearLinearParamCopies();
   const AffineComponent *other =
       dynamic_cast<const AffineComponent*>(&other_in);
   KALDI_ASSERT(other != NULL);
@@ -1118,7 +1121,10 @@ AffineComponent::AffineComponent(const AffineComponent &component):
     UpdatableComponent(component),
     linear_params_(component.linear_params_),
     bias_params_(component.bias_params_),
-    orthonormal_constraint_(component.orthonormal_constraint_) { }
+    orthonormal_constraint_(component.orthonormal_constraint_),
+    quantized_linear_params_(component.quantized_linear_params_),
+    packed_linear_params_(component.packed_linear_params_),
+    half_linear_params_(component.half_linear_params_) { }
 
 AffineComponent::AffineComponent(const CuMatrixBase<BaseFloat> &linear_params,
                                  const CuVectorBase<BaseFloat> &bias_params,
@@ -1133,12 +1139,14 @@ AffineComponent::AffineComponent(const CuMatrixBase<BaseFloat> &linear_params,
 
 void AffineComponent::SetParams(const CuVectorBase<BaseFloat> &bias,
                                 const CuMatrixBase<BaseFloat> &linear) {
+  ClearLinearParamCopies();
   bias_params_ = bias;
   linear_params_ = linear;
   KALDI_ASSERT(bias_params_.Dim() == linear_params_.NumRows());
 }
 
 void AffineComponent::PerturbParams(BaseFloat stddev) {
+  ClearLinearParamCopies();
   CuMatrix<BaseFloat> temp_linear_params(linear_params_);
   temp_linear_params.SetRandn();
   linear_params_.AddMat(stddev, temp_linear_params);
@@ -1153,11 +1161,15 @@ std::string AffineComponent::Info() const {
   stream << UpdatableComponent::Info();
   if (orthonormal_constraint_ != 0.0)
     stream << ", orthonormal-constraint=" << orthonormal_constraint_;
-  PrintParameterStats(stream, "linear-params", linear_params_,
-                      false, // include_mean
-                      true, // include_row_norms
-                      true, // include_column_norms
-                      GetVerboseLevel() >= 2); // include_singular_values
+  if (half_linear_params_.NumRows() != 0)
+    stream << ", linear-params-type="
+           << HalfMatrixTypeName(half_linear_params_.Type());
+  else
+    PrintParameterStats(stream, "linear-params", linear_params_,
+                        false, // include_mean
+                        true, // include_row_norms
+                        true, // include_column_norms
+                        GetVerboseLevel() >= 2); // include_singular_values
   PrintParameterStats(stream, "bias", bias_params_, true);
   return stream.str();
 }
@@ -1176,6 +1188,7 @@ BaseFloat AffineComponent::DotProduct(const UpdatableComponent &other_in) const
 
 void AffineComponent::Init(int32 input_dim, int32 output_dim,
                            BaseFloat param_stddev, BaseFloat bias_stddev) {
+  ClearLinearParamCopies();
   linear_params_.Resize(output_dim, input_dim);
   bias_params_.Resize(output_dim);
   KALDI_ASSERT(output_dim > 0 && input_dim > 0 && param_stddev >= 0.0);
@@ -1186,6 +1199,7 @@ void AffineComponent::Init(int32 input_dim, int32 output_dim,
 }
 
 void AffineComponent::Init(std::string matrix_filename) {
+  ClearLinearParamCopies();
   CuMatrix<BaseFloat> mat;
   ReadKaldiObject(matrix_filename, &mat); // will abort on failure.
   KALDI_ASSERT(mat.NumCols() >= 2);
@@ -1238,12 +1252,55 @@ void* AffineComponent::Propagate(const ComponentPrecomputedIndexes *indexes,
   // No need for asserts as they'll happen within the matrix operations.
   out->CopyRowsFromVec(bias_params_); // copies bias_params_ to each row
   // of *out.
-  out->AddMatMat(1.0, in, kNoTrans, linear_params_, kTrans, 1.0);
+  if (half_linear_params_.NumRows() != 0)
+    cu::AddMatHalfMat<BaseFloat>(1.0, in, half_linear_params_, 1.0, out);
+  else if (packed_linear_params_.NumRows() != 0)
+    cu::AddMatPanelMat<BaseFloat>(1.0, in, linear_params_,
+                                  packed_linear_params_, 1.0, out);
+  else
+    cu::AddMatQuantizedMat<BaseFloat>(1.0, in, linear_params_,
+                                      quantized_linear_params_, 1.0, out);
   return NULL;
 }
 
+void AffineComponent::SetQuantized(bool quantized) {
+  if (quantized)
+    quantized_linear_params_.CopyFromMat(Matrix<BaseFloat>(linear_params_));
+  else
+    quantized_linear_params_.Clear();
+}
+
+void AffineComponent::SetPacked(bool packed) {
+  if (packed)
+    packed_linear_params_.CopyFromMat(Matrix<BaseFloat>(linear_params_));
+  else
+    packed_linear_params_.Clear();
+}
+
+void AffineComponent::SetHalfPrecision(bool half, HalfMatrixType type) {
+  ClearLinearParamCopies();
+  if (half) {
+    if (half_linear_params_.NumRows() == 0) {
+      half_linear_params_.CopyFromMat(Matrix<BaseFloat>(linear_params_),
+                                      type);
+      linear_params_.Resize(0, 0);
+    } else if (half_linear_params_.Type() != type) {
+      KALDI_ERR << "The parameters are already in "
+                << HalfMatrixTypeName(half_linear_params_.Type());
+    }
+  } else if (half_linear_params_.NumRows() != 0) {
+    Matrix<BaseFloat> linear_params(half_linear_params_.NumRows(),
+                                    half_linear_params_.NumCols(),
+                                    kUndefined);
+    half_linear_params_.CopyToMat(&linear_params);
+    linear_params_.Swap(&linear_params);
+    half_linear_params_.Clear();
+  }
+}
+
 void AffineComponent::UpdateSimple(const CuMatrixBase<BaseFloat> &in_value,
                                    const CuMatrixBase<BaseFloat> &out_deriv) {
+  ClearLinearParamCopies();
   bias_params_.AddRowSumMat(learning_rate_, out_deriv, 1.0);
   linear_params_.AddMatMat(learning_rate_, out_deriv, kTrans,
                            in_value, kNoTrans, 1.0);
@@ -1278,6 +1335,10 @@ void AffineComponent::Backprop(const std::string &debug_info,
 }
 
 void AffineComponent::Read(std::istream &is, bool binary) {
+  ClearLinearParamCopies();
+  // The parameters are read as float; an old half-precision copy would
+  // otherwise still be used by Propagate().
+  half_linear_params_.Clear();
   ReadUpdatableCommon(is, binary);  // read opening tag and learning rate.
   ExpectToken(is, binary, "<LinearParams>");
   linear_params_.Read(is, binary);
@@ -1301,7 +1362,10 @@ void AffineComponent::Read(std::istream &is, bool binary) {
 void AffineComponent::Write(std::ostream &os, bool binary) const {
   WriteUpdatableCommon(os, binary);  // Write opening tag and learning rate
   WriteToken(os, binary, "<LinearParams>");
-  linear_params_.Write(os, binary);
+  if (half_linear_params_.NumRows() != 0)
+    half_linear_params_.Write(os, binary);
+  else
+    linear_params_.Write(os, binary);
   WriteToken(os, binary, "<BiasParams>");
   bias_params_.Write(os, binary);
   if (orthonormal_constraint_ != 0.0) {
@@ -1321,6 +1385,7 @@ void AffineComponent::Vectorize(VectorBase<BaseFloat> *params) const {
                 OutputDim()).CopyFromVec(bias_params_);
 }
 void AffineComponent::UnVectorize(const VectorBase<BaseFloat> &params) {
+  ClearLinearParamCopies();
   KALDI_ASSERT(params.Dim() == this->NumParameters());
   linear_params_.CopyRowsFromVec(params.Range(0, InputDim() * OutputDim()));
   bias_params_.CopyFromVec(params.Range(InputDim() * OutputDim(),
@@ -2769,6 +2834,8 @@ void ConstantFunctionComponent::ConsolidateMemory() {
 }
 
 void NaturalGradientAffineComponent::Read(std::istream &is, bool binary) {
+  ClearLinearParamCopies();
+  half_linear_params_.Clear();  // c.f. AffineComponent::Read().
   ReadUpdatableCommon(is, binary);  // Read the opening tag and learning rate
   ExpectToken(is, binary, "<LinearParams>");
   linear_params_.Read(is, binary);
@@ -2934,7 +3001,10 @@ void NaturalGradientAffineComponent::Write(std::ostream &os,
                                            bool binary) const {
   WriteUpdatableCommon(os, binary);  // Write the opening tag and learning rate
   WriteToken(os, binary, "<LinearParams>");
-  linear_params_.Write(os, binary);
+  if (half_linear_params_.NumRows() != 0)
+    half_linear_params_.Write(os, binary);
+  else
+    linear_params_.Write(os, binary);
   WriteToken(os, binary, "<BiasParams>");
   bias_params_.Write(os, binary);
   WriteToken(os, binary, "<RankIn>");
@@ -2979,6 +3049,7 @@ void NaturalGradientAffineComponent::Update(
     const std::string &debug_info,
     const CuMatrixBase<BaseFloat> &in_value,
     const CuMatrixBase<BaseFloat> &out_deriv) {
+  ClearLinearParamCopies();
   CuMatrix<BaseFloat> in_value_temp;
 
   in_value_temp.Resize(in_value.NumRows(),
@@ -3022,6 +3093,7 @@ void NaturalGradientAffineComponent::Update(
 }
 
 void NaturalGradientAffineComponent::Scale(BaseFloat scale) {
+  ClearLinearParamCopies();
   if (scale == 0.0) {
     linear_params_.SetZero();
     bias_params_.SetZero();
@@ -3032,6 +3104,7 @@ void NaturalGradientAffineComponent::Scale(BaseFloat scale) {
 }
 
 void NaturalGradientAffineComponent::Add(BaseFloat alpha, const Component &other_in) {
+  ClearLinearParamCopies();
   const NaturalGradientAffineComponent *other =
       dynamic_cast<const NaturalGradientAffineComponent*>(&other_in);
   KALDI_ASSERT(other != NULL);
@@ -3052,6 +3125,7 @@ void NaturalGradientAffineComponent::ConsolidateMemory() {
 }
 
 void LinearComponent::Read(std::istream &is, bool binary) {
+  half_params_.Clear();  // c.f. AffineComponent::Read().
   std::string token = ReadUpdatableCommon(is, binary);
   KALDI_ASSERT(token == "");
   ExpectToken(is, binary, "<Params>");
@@ -3160,7 +3234,10 @@ void LinearComponent::Write(std::ostream &os,
                             bool binary) const {
   WriteUpdatableCommon(os, binary);  // Write the opening tag and learning rate
   WriteToken(os, binary, "<Params>");
-  params_.Write(os, binary);
+  if (half_params_.NumRows() != 0)
+    half_params_.Write(os, binary);
+  else
+    params_.Write(os, binary);
   if (orthonormal_constraint_ != 0.0) {
     WriteToken(os, binary, "<OrthonormalConstraint>");
     WriteBasicType(os, binary, orthonormal_constraint_);
@@ -3188,11 +3265,14 @@ void LinearComponent::Write(std::ostream &os,
 std::string LinearComponent::Info() const {
   std::ostringstream stream;
   stream << UpdatableComponent::Info();
-  PrintParameterStats(stream, "params", params_,
-                      false, // include_mean
-                      true, // include_row_norms
-                      true, // include_column_norms
-                      GetVerboseLevel() >= 2); // include_singular_values
+  if (half_params_.NumRows() != 0)
+    stream << ", params-type=" << HalfMatrixTypeName(half_params_.Type());
+  else
+    PrintParameterStats(stream, "params", params_,
+                        false, // include_mean
+                        true, // include_row_norms
+                        true, // include_column_norms
+                        GetVerboseLevel() >= 2); // include_singular_values
   if (orthonormal_constraint_ != 0.0)
     stream << ", orthonormal-constraint=" << orthonormal_constraint_;
   stream << ", use-natural-gradient="
@@ -3209,10 +3289,31 @@ std::string LinearComponent::Info() const {
 void* LinearComponent::Propagate(const ComponentPrecomputedIndexes *indexes,
                                  const CuMatrixBase<BaseFloat> &in,
                                  CuMatrixBase<BaseFloat> *out) const {
-  out->AddMatMat(1.0, in, kNoTrans, params_, kTrans, 1.0);
+  if (half_params_.NumRows() != 0)
+    cu::AddMatHalfMat<BaseFloat>(1.0, in, half_params_, 1.0, out);
+  else
+    out->AddMatMat(1.0, in, kNoTrans, params_, kTrans, 1.0);
   return NULL;
 }
 
+void LinearComponent::SetHalfPrecision(bool half, HalfMatrixType type) {
+  if (half) {
+    if (half_params_.NumRows() == 0) {
+      half_params_.CopyFromMat(Matrix<BaseFloat>(params_), type);
+      params_.Resize(0, 0);
+    } else if (half_params_.Type() != type) {
+      KALDI_ERR << "The parameters are already in "
+                << HalfMatrixTypeName(half_params_.Type());
+    }
+  } else if (half_params_.NumRows() != 0) {
+    Matrix<BaseFloat> params(half_params_.NumRows(), half_params_.NumCols(),
+                             kUndefined);
+    half_params_.CopyToMat(&params);
+    params_.Swap(&params);
+    half_params_.Clear();
+  }
+}
+
 void LinearComponent::Backprop(const std::string &debug_info,
                                const ComponentPrecomputedIndexes *indexes,
                                const CuMatrixBase<BaseFloat> &in_value,
@@ -3260,6 +3361,7 @@ LinearComponent::LinearComponent(
     const LinearComponent &other):
     UpdatableComponent(other),
     params_(other.params_),
+    half_params_(other.half_params_),
     orthonormal_constraint_(other.orthonormal_constraint_),
     use_natural_gradient_(other.use_natural_gradient_),
     preconditioner_in_(other.preconditioner_in_),
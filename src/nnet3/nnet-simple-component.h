@@ -405,8 +405,14 @@ class PerElementOffsetComponent;
 */
 class AffineComponent: public UpdatableComponent {
  public:
-  virtual int32 InputDim() const { return linear_params_.NumCols(); }
-  virtual int32 OutputDim() const { return linear_params_.NumRows(); }
+  virtual int32 InputDim() const {
+    return (half_linear_params_.NumRows() != 0 ?
+            half_linear_params_.NumCols() : linear_params_.NumCols());
+  }
+  virtual int32 OutputDim() const {
+    return (half_linear_params_.NumRows() != 0 ?
+            half_linear_params_.NumRows() : linear_params_.NumRows());
+  }
 
   BaseFloat OrthonormalConstraint() const { return orthonormal_constraint_; }
 
@@ -455,7 +461,12 @@ class AffineComponent: public UpdatableComponent {
   const CuVector<BaseFloat> &BiasParams() const { return bias_params_; }
   CuVector<BaseFloat> &BiasParams() { return bias_params_; }
   const CuMatrix<BaseFloat> &LinearParams() const { return linear_params_; }
-  CuMatrix<BaseFloat> &LinearParams() { return linear_params_; }
+  // The caller may change the parameters, so this discards the copies made by
+  // SetQuantized() and SetPacked().
+  CuMatrix<BaseFloat> &LinearParams() {
+    ClearLinearParamCopies();
+    return linear_params_;
+  }
   explicit AffineComponent(const AffineComponent &other);
   // The next constructor is used in converting from nnet1.
   AffineComponent(const CuMatrixBase<BaseFloat> &linear_params,
@@ -467,6 +478,32 @@ class AffineComponent: public UpdatableComponent {
 
   void Init(int32 input_dim, int32 output_dim,
             BaseFloat param_stddev, BaseFloat bias_stddev);
+
+  /// If quantized == true, makes Propagate() use an 8-bit copy of the linear
+  /// parameters when running on the CPU (see AddMatQuantizedMat()); this is
+  /// faster but slightly less accurate, and is for test time only: the copy
+  /// is discarded, not updated, if the parameters change afterwards.
+  void SetQuantized(bool quantized);
+
+  /// If packed == true, makes Propagate() keep a copy of the linear
+  /// parameters in the layout of PanelMatrix, which is faster to multiply by
+  /// on the CPU when there are only a few rows (frames) at a time, e.g. in
+  /// online decoding (see cu::AddMatPanelMat()).  Test time only, as for
+  /// SetQuantized(); if both are set, the packed copy is used.
+  void SetPacked(bool packed);
+
+  bool IsQuantized() const { return quantized_linear_params_.NumRows() != 0; }
+  bool IsPacked() const { return packed_linear_params_.NumRows() != 0; }
+
+  /// If half == true, makes the component keep its linear parameters only
+  /// in 16-bit floating point of type 'type' (see HalfMatrix), which halves
+  /// their memory, and Propagate() multiply by them in that form (see
+  /// cu::AddMatHalfMat()).  This is for test time only: afterwards
+  /// LinearParams() is empty, so the component can't be trained or changed,
+  /// but Propagate() and Write() (which writes the parameters as float) work.
+  /// With half == false, the parameters are converted back to float.
+  /// Copies made by SetQuantized() or SetPacked() are discarded.
+  void SetHalfPrecision(bool half, HalfMatrixType type);
  protected:
   void Init(std::string matrix_filename);
 
@@ -485,12 +522,26 @@ class AffineComponent: public UpdatableComponent {
       const CuMatrixBase<BaseFloat> &in_value,
       const CuMatrixBase<BaseFloat> &out_deriv);
 
+  // Discards the copies made by SetQuantized() and SetPacked(); called by
+  // the functions that change linear_params_, as the copies would be stale.
+  void ClearLinearParamCopies() {
+    quantized_linear_params_.Clear();
+    packed_linear_params_.Clear();
+  }
+
   const AffineComponent &operator = (const AffineComponent &other); // Disallow.
   CuMatrix<BaseFloat> linear_params_;
   CuVector<BaseFloat> bias_params_;
   // see documentation at the top of this class for more information on the
   // following.
   BaseFloat orthonormal_constraint_;
+  // Empty unless SetQuantized(true) was called.
+  QuantizedMatrix quantized_linear_params_;
+  // Empty unless SetPacked(true) was called.
+  PanelMatrix packed_linear_params_;
+  // Empty unless SetHalfPrecision(true, ...) was called, in which case
+  // linear_params_ is empty.
+  HalfMatrix half_linear_params_;
 };
 
 class RepeatedAffineComponent;
@@ -926,8 +977,14 @@ class NaturalGradientAffineComponent: public AffineComponent {
 */
 class LinearComponent: public UpdatableComponent {
  public:
-  virtual int32 InputDim() const { return params_.NumCols(); }
-  virtual int32 OutputDim() const { return params_.NumRows(); }
+  virtual int32 InputDim() const {
+    return (half_params_.NumRows() != 0 ? half_params_.NumCols() :
+            params_.NumCols());
+  }
+  virtual int32 OutputDim() const {
+    return (half_params_.NumRows() != 0 ? half_params_.NumRows() :
+            params_.NumRows());
+  }
 
   virtual std::string Type() const { return "LinearComponent"; }
   virtual int32 Properties() const {
@@ -971,6 +1028,10 @@ class LinearComponent: public UpdatableComponent {
   BaseFloat OrthonormalConstraint() const { return orthonormal_constraint_; }
   CuMatrixBase<BaseFloat> &Params() { return params_; }
   const CuMatrixBase<BaseFloat> &Params() const { return params_; }
+
+  /// Keeps the parameters only in 16-bit floating point, or converts them
+  /// back to float; test time only, see AffineComponent::SetHalfPrecision().
+  void SetHalfPrecision(bool half, HalfMatrixType type);
  private:
 
   // disallow assignment operator.
@@ -978,6 +1039,9 @@ class LinearComponent: public UpdatableComponent {
       const LinearComponent&);
 
   CuMatrix<BaseFloat> params_;
+  // Empty unless SetHalfPrecision(true, ...) was called, in which case
+  // params_ is empty.
+  HalfMatrix half_params_;
 
   BaseFloat orthonormal_constraint_;
   // If true (and if no this->is_gradient_), use natural gradient updates.
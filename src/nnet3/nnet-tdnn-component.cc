@@ -25,6 +25,7 @@
 #include "nnet3/nnet-convolutional-component.h"
 #include "nnet3/nnet-computation-graph.h"
 #include "nnet3/nnet-parse.h"
+#include "cudamatrix/cu-math.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -44,20 +45,30 @@ TdnnComponent::TdnnComponent(
     orthonormal_constraint_(other.orthonormal_constraint_),
     use_natural_gradient_(other.use_natural_gradient_),
     preconditioner_in_(other.preconditioner_in_),
-    preconditioner_out_(other.preconditioner_out_) {
+    preconditioner_out_(other.preconditioner_out_),
+    quantized_params_(other.quantized_params_),
+    packed_params_(other.packed_params_),
+    half_params_(other.half_params_) {
   Check();
 }
 
 
 void TdnnComponent::Check() const {
-  KALDI_ASSERT(linear_params_.NumRows() > 0 &&
+  // After SetHalfPrecision(true, ...), linear_params_ is empty.
+  int32 num_rows = (half_params_.empty() ? linear_params_.NumRows() :
+                    half_params_[0].NumRows()),
+      num_cols = (half_params_.empty() ? linear_params_.NumCols() :
+                  half_params_[0].NumCols() * half_params_.size());
+  KALDI_ASSERT(num_rows > 0 &&
                !time_offsets_.empty() &&
                std::set<int32>(time_offsets_.begin(),
                                time_offsets_.end()).size() ==
                time_offsets_.size() &&
-               linear_params_.NumCols() % time_offsets_.size() == 0 &&
+               num_cols % time_offsets_.size() == 0 &&
+               (half_params_.empty() ||
+                half_params_.size() == time_offsets_.size()) &&
                (bias_params_.Dim() == 0 ||
-                bias_params_.Dim() == linear_params_.NumRows()));
+                bias_params_.Dim() == num_rows));
 }
 
 std::string TdnnComponent::Info() const {
@@ -70,11 +81,15 @@ std::string TdnnComponent::Info() const {
     if (i != 0) stream << ',';
     stream << time_offsets_[i];
   }
-  PrintParameterStats(stream, "linear-params", linear_params_,
-                      false, // include_mean
-                      true, // include_row_norms
-                      true, // include_column_norms
-                      GetVerboseLevel() >= 2); // include_singular_values
+  if (!half_params_.empty())
+    stream << ", linear-params-type="
+           << HalfMatrixTypeName(half_params_[0].Type());
+  else
+    PrintParameterStats(stream, "linear-params", linear_params_,
+                        false, // include_mean
+                        true, // include_row_norms
+                        true, // include_column_norms
+                        GetVerboseLevel() >= 2); // include_singular_values
   if (bias_params_.Dim() == 0) {
     stream << ", has-bias=false";
   } else {
@@ -95,6 +110,7 @@ std::string TdnnComponent::Info() const {
 
 
 void TdnnComponent::InitFromConfig(ConfigLine *cfl) {
+  ClearParamCopies();
   // 1. Config values inherited from UpdatableComponent.
   InitLearningRatesFromConfig(cfl);
 
@@ -202,14 +218,97 @@ void* TdnnComponent::Propagate(
     CuSubMatrix<BaseFloat> in_part = GetInputPart(in, out->NumRows(),
                                                   indexes->row_stride,
                                                   indexes->row_offsets[i]);
+    if (!half_params_.empty()) {
+      cu::AddMatHalfMat<BaseFloat>(1.0, in_part, half_params_[i], 1.0, out);
+      continue;
+    }
     CuSubMatrix<BaseFloat> linear_params_part(linear_params_,
                                               0, linear_params_.NumRows(),
                                               i * input_dim, input_dim);
-    out->AddMatMat(1.0, in_part, kNoTrans, linear_params_part, kTrans, 1.0);
+    if (!packed_params_.empty())
+      cu::AddMatPanelMat<BaseFloat>(1.0, in_part, linear_params_part,
+                                    packed_params_[i], 1.0, out);
+    else if (!quantized_params_.empty())
+      cu::AddMatQuantizedMat<BaseFloat>(1.0, in_part, linear_params_part,
+                                        quantized_params_[i], 1.0, out);
+    else
+      out->AddMatMat(1.0, in_part, kNoTrans, linear_params_part, kTrans, 1.0);
   }
   return NULL;
 }
 
+void TdnnComponent::SetQuantized(bool quantized) {
+  quantized_params_.clear();
+  if (!quantized || !half_params_.empty())
+    return;
+  int32 num_offsets = time_offsets_.size(),
+      input_dim = InputDim();
+  Matrix<BaseFloat> linear_params(linear_params_);
+  quantized_params_.resize(num_offsets);
+  for (int32 i = 0; i < num_offsets; i++) {
+    SubMatrix<BaseFloat> linear_params_part(linear_params,
+                                            0, linear_params.NumRows(),
+                                            i * input_dim, input_dim);
+    quantized_params_[i].CopyFromMat(linear_params_part);
+  }
+}
+
+void TdnnComponent::SetPacked(bool packed) {
+  packed_params_.clear();
+  if (!packed || !half_params_.empty())
+    return;
+  int32 num_offsets = time_offsets_.size(),
+      input_dim = InputDim();
+  Matrix<BaseFloat> linear_params(linear_params_);
+  packed_params_.resize(num_offsets);
+  for (int32 i = 0; i < num_offsets; i++) {
+    SubMatrix<BaseFloat> linear_params_part(linear_params,
+                                            0, linear_params.NumRows(),
+                                            i * input_dim, input_dim);
+    packed_params_[i].CopyFromMat(linear_params_part);
+  }
+}
+
+void TdnnComponent::SetHalfPrecision(bool half, HalfMatrixType type) {
+  ClearParamCopies();
+  int32 num_offsets = time_offsets_.size(),
+      input_dim = InputDim();
+  if (half) {
+    if (!half_params_.empty()) {
+      if (half_params_[0].Type() != type)
+        KALDI_ERR << "The parameters are already in "
+                  << HalfMatrixTypeName(half_params_[0].Type());
+      return;
+    }
+    Matrix<BaseFloat> linear_params(linear_params_);
+    half_params_.resize(num_offsets);
+    for (int32 i = 0; i < num_offsets; i++) {
+      SubMatrix<BaseFloat> linear_params_part(linear_params,
+                                              0, linear_params.NumRows(),
+                                              i * input_dim, input_dim);
+      half_params_[i].CopyFromMat(linear_params_part, type);
+    }
+    linear_params_.Resize(0, 0);
+  } else if (!half_params_.empty()) {
+    Matrix<BaseFloat> linear_params;
+    GetHalfParams(&linear_params);
+    half_params_.clear();
+    linear_params_.Swap(&linear_params);
+  }
+}
+
+void TdnnComponent::GetHalfParams(Matrix<BaseFloat> *linear_params) const {
+  int32 num_offsets = half_params_.size(),
+      input_dim = InputDim();
+  linear_params->Resize(OutputDim(), input_dim * num_offsets, kUndefined);
+  for (int32 i = 0; i < num_offsets; i++) {
+    SubMatrix<BaseFloat> linear_params_part(*linear_params,
+                                            0, linear_params->NumRows(),
+                                            i * input_dim, input_dim);
+    half_params_[i].CopyToMat(&linear_params_part);
+  }
+}
+
 void TdnnComponent::Backprop(
     const std::string &debug_info,
     const ComponentPrecomputedIndexes *indexes_in,
@@ -262,6 +361,7 @@ void TdnnComponent::UpdateSimple(
     const PrecomputedIndexes &indexes,
     const CuMatrixBase<BaseFloat> &in_value,
     const CuMatrixBase<BaseFloat> &out_deriv) {
+  ClearParamCopies();
 
   if (bias_params_.Dim() != 0)
     bias_params_.AddRowSumMat(learning_rate_, out_deriv);
@@ -285,6 +385,7 @@ void TdnnComponent::UpdateNaturalGradient(
     const PrecomputedIndexes &indexes,
     const CuMatrixBase<BaseFloat> &in_value,
     const CuMatrixBase<BaseFloat> &out_deriv) {
+  ClearParamCopies();
 
   int32 num_offsets = time_offsets_.size(),
       num_rows = out_deriv.NumRows(),
@@ -381,7 +482,13 @@ void TdnnComponent::Write(std::ostream &os, bool binary) const {
   WriteToken(os, binary, "<TimeOffsets>");
   WriteIntegerVector(os, binary, time_offsets_);
   WriteToken(os, binary, "<LinearParams>");
-  linear_params_.Write(os, binary);
+  if (!half_params_.empty()) {
+    Matrix<BaseFloat> linear_params;
+    GetHalfParams(&linear_params);
+    linear_params.Write(os, binary);
+  } else {
+    linear_params_.Write(os, binary);
+  }
   WriteToken(os, binary, "<BiasParams>");
   bias_params_.Write(os, binary);
   WriteToken(os, binary, "<OrthonormalConstraint>");
@@ -405,6 +512,8 @@ void TdnnComponent::Write(std::ostream &os, bool binary) const {
 }
 
 void TdnnComponent::Read(std::istream &is, bool binary) {
+  ClearParamCopies();
+  half_params_.clear();  // c.f. AffineComponent::Read().
   std::string token = ReadUpdatableCommon(is, binary);
   ExpectToken(is, binary, "<TimeOffsets>");
   ReadIntegerVector(is, binary, &time_offsets_);
@@ -595,6 +704,7 @@ ComponentPrecomputedIndexes* TdnnComponent::PrecomputeIndexes(
 }
 
 void TdnnComponent::Scale(BaseFloat scale) {
+  ClearParamCopies();
   if (scale == 0.0) {
     linear_params_.SetZero();
     bias_params_.SetZero();
@@ -606,6 +716,7 @@ void TdnnComponent::Scale(BaseFloat scale) {
 
 void TdnnComponent::Add(BaseFloat alpha,
                         const Component &other_in) {
+  ClearParamCopies();
   const TdnnComponent *other =
       dynamic_cast<const TdnnComponent*>(&other_in);
   KALDI_ASSERT(other != NULL);
@@ -615,6 +726,7 @@ void TdnnComponent::Add(BaseFloat alpha,
 }
 
 void TdnnComponent::PerturbParams(BaseFloat stddev) {
+  ClearParamCopies();
   CuMatrix<BaseFloat> temp_mat(linear_params_.NumRows(),
                                linear_params_.NumCols(), kUndefined);
   temp_mat.SetRandn();
@@ -655,6 +767,7 @@ void TdnnComponent::Vectorize(
 
 void TdnnComponent::UnVectorize(
     const VectorBase<BaseFloat> &params) {
+  ClearParamCopies();
   KALDI_ASSERT(params.Dim() == NumParameters());
   int32 linear_size = linear_params_.NumRows() * linear_params_.NumCols(),
       bias_size = bias_params_.Dim();
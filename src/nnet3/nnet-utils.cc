@@ -570,6 +570,70 @@ void SetDropoutTestMode(bool test_mode,  Nnet *nnet) {
   }
 }
 
+// Returns true if any of the components affected by SetQuantizedTestMode() and
+// SetPackedTestMode() is in packed test mode (if packed == true), or in
+// quantized test mode (if packed == false).
+static bool HasPackedOrQuantizedComponent(const Nnet &nnet, bool packed) {
+  for (int32 c = 0; c < nnet.NumComponents(); c++) {
+    const Component *comp = nnet.GetComponent(c);
+    const AffineComponent *ac = dynamic_cast<const AffineComponent*>(comp);
+    if (ac != NULL && (packed ? ac->IsPacked() : ac->IsQuantized()))
+      return true;
+    const TdnnComponent *tc = dynamic_cast<const TdnnComponent*>(comp);
+    if (tc != NULL && (packed ? tc->IsPacked() : tc->IsQuantized()))
+      return true;
+  }
+  return false;
+}
+
+void SetQuantizedTestMode(bool test_mode, Nnet *nnet) {
+  if (test_mode && HasPackedOrQuantizedComponent(*nnet, true))
+    KALDI_WARN << "Quantizing a model whose weights are packed (see "
+               << "SetPackedTestMode()): the packed weights are used instead, "
+               << "so the quantization has no effect.";
+  for (int32 c = 0; c < nnet->NumComponents(); c++) {
+    Component *comp = nnet->GetComponent(c);
+    AffineComponent *ac = dynamic_cast<AffineComponent*>(comp);
+    if (ac != NULL)
+      ac->SetQuantized(test_mode);
+    TdnnComponent *tc = dynamic_cast<TdnnComponent*>(comp);
+    if (tc != NULL)
+      tc->SetQuantized(test_mode);
+  }
+}
+
+void SetPackedTestMode(bool test_mode, Nnet *nnet) {
+  if (test_mode && HasPackedOrQuantizedComponent(*nnet, false))
+    KALDI_WARN << "Packing the weights of a quantized model (see "
+               << "SetQuantizedTestMode()): the packed weights are used "
+               << "instead, so the quantization has no effect.";
+  for (int32 c = 0; c < nnet->NumComponents(); c++) {
+    Component *comp = nnet->GetComponent(c);
+    AffineComponent *ac = dynamic_cast<AffineComponent*>(comp);
+    if (ac != NULL)
+      ac->SetPacked(test_mode);
+    TdnnComponent *tc = dynamic_cast<TdnnComponent*>(comp);
+    if (tc != NULL)
+      tc->SetPacked(test_mode);
+  }
+}
+
+void SetHalfPrecisionTestMode(bool test_mode, HalfMatrixType type,
+                              Nnet *nnet) {
+  for (int32 c = 0; c < nnet->NumComponents(); c++) {
+    Component *comp = nnet->GetComponent(c);
+    AffineComponent *ac = dynamic_cast<AffineComponent*>(comp);
+    if (ac != NULL)
+      ac->SetHalfPrecision(test_mode, type);
+    LinearComponent *lc = dynamic_cast<LinearComponent*>(comp);
+    if (lc != NULL)
+      lc->SetHalfPrecision(test_mode, type);
+    TdnnComponent *tc = dynamic_cast<TdnnComponent*>(comp);
+    if (tc != NULL)
+      tc->SetHalfPrecision(test_mode, type);
+  }
+}
+
 void ResetGenerators(Nnet *nnet){
   for (int32 c = 0; c < nnet->NumComponents(); c++) {
     Component *comp = nnet->GetComponent(c);
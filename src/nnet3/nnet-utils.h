@@ -196,6 +196,43 @@ void RecomputeStats(const std::vector<NnetExample> &egs, Nnet *nnet);
 /// elements.
 void SetDropoutTestMode(bool test_mode, Nnet *nnet);
 
+/// This function affects AffineComponent (and its child classes) and
+/// TdnnComponent.  If test_mode == true, it makes them multiply by 8-bit
+/// quantized copies of their linear parameters when running on the CPU,
+/// which is faster but slightly less accurate (see AddMatQuantizedMat());
+/// with test_mode == false it discards those copies.  Call it after any
+/// other modification of the model, e.g. after CollapseModel(), as the
+/// copies are not updated when the parameters change.
+void SetQuantizedTestMode(bool test_mode, Nnet *nnet);
+
+/// This function affects AffineComponent (and its child classes) and
+/// TdnnComponent.  If test_mode == true, it makes them keep copies of their
+/// linear parameters in the layout of PanelMatrix, which they multiply by
+/// when running on the CPU with only a few rows (frames) at a time, as in
+/// online decoding, where that is faster than AddMatMat() (see
+/// cu::AddMatPanelMat()); the results are the same up to roundoff.  With
+/// test_mode == false it discards those copies.  As for
+/// SetQuantizedTestMode(), call it after any other modification of the model.
+/// The two should not be combined: the packed copies take precedence, so it
+/// warns if the model is already in quantized test mode (and
+/// SetQuantizedTestMode() warns if it is in packed test mode).
+void SetPackedTestMode(bool test_mode, Nnet *nnet);
+
+/// This function affects AffineComponent (and its child classes),
+/// LinearComponent and TdnnComponent.  If test_mode == true, it makes them
+/// keep their linear parameters only in 16-bit floating point of type 'type'
+/// (see HalfMatrix), which halves the memory of most models, e.g. for a
+/// server that keeps many of them loaded; the results change by about the
+/// rounding error of that format.  The model can then only be used to
+/// compute the output (and be written, with the parameters as float); it is
+/// for test time only.  With test_mode == false the parameters are converted
+/// back to float.  Call it after any other modification of the model, e.g.
+/// after CollapseModel().  It discards the copies made by
+/// SetQuantizedTestMode() and SetPackedTestMode(), and they do nothing if it
+/// is in effect.
+void SetHalfPrecisionTestMode(bool test_mode, HalfMatrixType type,
+                              Nnet *nnet);
+
 /**
   \brief  This function calls 'ResetGenerator()' on all components in 'nnet'
      that inherit from class RandomComponent.  It's used when you need
@@ -51,7 +51,8 @@ int main(int argc, char *argv[]) {
     opts.acoustic_scale = 1.0; // by default do no scaling.
 
     bool apply_exp = false, use_priors = false;
-    std::string use_gpu = "yes";
+    std::string use_gpu = "yes", quantize, half_precision;
+    int32 cpu_threads = 1;
 
     std::string ivector_rspecifier,
                 online_ivector_rspecifier,
@@ -74,13 +75,24 @@ int main(int argc, char *argv[]) {
                 "output");
     po.Register("use-gpu", &use_gpu,
                 "yes|no|optional|wait, only has effect if compiled with CUDA");
+    po.Register("cpu-threads", &cpu_threads, "Number of threads for the "
+                "matrix operations when not using the GPU (best with a "
+                "single-threaded BLAS).");
     po.Register("use-priors", &use_priors, "If true, subtract the logs of the "
                 "priors stored with the model (in this case, "
                 "a .mdl file is expected as input).");
+    po.Register("quantize", &quantize, "If 'int8', multiply by 8-bit "
+                "copies of the parameters of the affine and TDNN layers "
+                "(faster on CPU, slightly less accurate; ignored on GPU).");
+    po.Register("half-precision", &half_precision, "If 'fp16' or 'bf16', "
+                "keep the parameters of the affine, linear and TDNN layers "
+                "only in that 16-bit format, which halves their memory "
+                "(slightly less accurate; slow on GPU).");
 
 #if HAVE_CUDA==1
     CuDevice::RegisterDeviceOptions(&po);
 #endif
+    RegisterCpuAllocatorOptions(&po);
 
     po.Read(argc, argv);
 
@@ -92,6 +104,7 @@ int main(int argc, char *argv[]) {
 #if HAVE_CUDA==1
     CuDevice::Instantiate().SelectGpuId(use_gpu);
 #endif
+    CuThreadPool::Instantiate().SetNumThreads(cpu_threads);
 
     std::string nnet_rxfilename = po.GetArg(1),
                 feature_rspecifier = po.GetArg(2),
@@ -112,6 +125,16 @@ int main(int argc, char *argv[]) {
     SetBatchnormTestMode(true, &nnet);
     SetDropoutTestMode(true, &nnet);
     CollapseModel(CollapseModelConfig(), &nnet);
+    if (quantize == "int8")
+      SetQuantizedTestMode(true, &nnet);
+    else if (quantize != "")
+      KALDI_ERR << "Invalid --quantize option: " << quantize;
+    if (half_precision != "") {
+      HalfMatrixType type;
+      if (!ParseHalfMatrixType(half_precision, &type))
+        KALDI_ERR << "Invalid --half-precision option: " << half_precision;
+      SetHalfPrecisionTestMode(true, type, &nnet);
+    }
 
     Vector<BaseFloat> priors;
     if (use_priors)
@@ -185,6 +208,8 @@ int main(int argc, char *argv[]) {
 #if HAVE_CUDA==1
     CuDevice::Instantiate().PrintProfile();
 #endif
+    if (GetVerboseLevel() >= 1)
+      CpuMemoryAllocator::Instantiate().PrintMemoryUsage();
     double elapsed = timer.Elapsed();
     KALDI_LOG << "Time taken "<< elapsed
               << "s: real-time factor assuming 100 frames/sec is "
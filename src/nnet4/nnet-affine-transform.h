@@ -45,6 +45,7 @@ class AffineTransform : public UpdatableComponent {
   ComponentType GetType() const { return kAffineTransform; }
 
   void InitData(std::istream &is) {
+    quantized_linearity_.Clear();  // it would be stale.
     // define options
     float bias_mean = -2.0, bias_range = 2.0, param_stddev = 0.1;
     // parse config
@@ -65,14 +66,15 @@ class AffineTransform : public UpdatableComponent {
     // Initialize trainable parameters,
     //
     // Gaussian with given std_dev (mean = 0),
-    linearity_.Resize(OutputDim(), InputDim());
-    RandGauss(0.0, param_stddev, &linearity_);
+    linearity_->Resize(OutputDim(), InputDim());
+    RandGauss(0.0, param_stddev, &(*linearity_));
     // Uniform,
-    bias_.Resize(OutputDim());
-    RandUniform(bias_mean, bias_range, &bias_);
+    bias_->Resize(OutputDim());
+    RandUniform(bias_mean, bias_range, &(*bias_));
   }
 
   void ReadData(std::istream &is, bool binary) {
+    quantized_linearity_.Clear();  // it would be stale.
     // Read all the '<Tokens>' in arbitrary order,
     while ('<' == Peek(is, binary)) {
       int first_char = PeekToken(is, binary);
@@ -95,13 +97,13 @@ class AffineTransform : public UpdatableComponent {
     // Read the data (data follow the tokens),
 
     // weight matrix,
-    linearity_.Read(is, binary);
+    linearity_->Read(is, binary);
     // bias vector,
-    bias_.Read(is, binary);
+    bias_->Read(is, binary);
 
-    KALDI_ASSERT(linearity_.NumRows() == output_dim_);
-    KALDI_ASSERT(linearity_.NumCols() == input_dim_);
-    KALDI_ASSERT(bias_.Dim() == output_dim_);
+    KALDI_ASSERT(linearity_->NumRows() == output_dim_);
+    KALDI_ASSERT(linearity_->NumCols() == input_dim_);
+    KALDI_ASSERT(bias_->Dim() == output_dim_);
   }
 
   void WriteData(std::ostream &os, bool binary) const {
@@ -113,41 +115,53 @@ class AffineTransform : public UpdatableComponent {
     WriteBasicType(os, binary, max_norm_);
     if (!binary) os << "\n";
     // weights
-    linearity_.Write(os, binary);
-    bias_.Write(os, binary);
+    if (half_linearity_.NumRows() != 0)
+      half_linearity_.Write(os, binary);
+    else
+      linearity_->Write(os, binary);
+    bias_->Write(os, binary);
   }
 
   int32 NumParams() const {
-    return linearity_.NumRows()*linearity_.NumCols() + bias_.Dim();
+    return linearity_->NumRows()*linearity_->NumCols() + bias_->Dim();
   }
 
   void GetGradient(VectorBase<BaseFloat>* gradient) const {
     KALDI_ASSERT(gradient->Dim() == NumParams());
-    int32 linearity_num_elem = linearity_.NumRows() * linearity_.NumCols();
+    int32 linearity_num_elem = linearity_->NumRows() * linearity_->NumCols();
     gradient->Range(0, linearity_num_elem).CopyRowsFromMat(linearity_corr_);
-    gradient->Range(linearity_num_elem, bias_.Dim()).CopyFromVec(bias_corr_);
+    gradient->Range(linearity_num_elem, bias_->Dim()).CopyFromVec(bias_corr_);
   }
 
   void GetParams(VectorBase<BaseFloat>* params) const {
     KALDI_ASSERT(params->Dim() == NumParams());
-    int32 linearity_num_elem = linearity_.NumRows() * linearity_.NumCols();
-    params->Range(0, linearity_num_elem).CopyRowsFromMat(linearity_);
-    params->Range(linearity_num_elem, bias_.Dim()).CopyFromVec(bias_);
+    int32 linearity_num_elem = linearity_->NumRows() * linearity_->NumCols();
+    params->Range(0, linearity_num_elem).CopyRowsFromMat(*linearity_);
+    params->Range(linearity_num_elem, bias_->Dim()).CopyFromVec(*bias_);
   }
 
   void SetParams(const VectorBase<BaseFloat>& params) {
+    quantized_linearity_.Clear();  // it would be stale.
     KALDI_ASSERT(params.Dim() == NumParams());
-    int32 linearity_num_elem = linearity_.NumRows() * linearity_.NumCols();
-    linearity_.CopyRowsFromVec(params.Range(0, linearity_num_elem));
-    bias_.CopyFromVec(params.Range(linearity_num_elem, bias_.Dim()));
+    int32 linearity_num_elem = linearity_->NumRows() * linearity_->NumCols();
+    linearity_->CopyRowsFromVec(params.Range(0, linearity_num_elem));
+    bias_->CopyFromVec(params.Range(linearity_num_elem, bias_->Dim()));
+  }
+
+  void ShareParams(UpdatableComponent *other) {
+    quantized_linearity_.Clear();  // it would be stale.
+    AffineTransform *o = dynamic_cast<AffineTransform*>(other);
+    KALDI_ASSERT(o != NULL && o != this && NumParams() == o->NumParams());
+    linearity_.Share(&o->linearity_);
+    bias_.Share(&o->bias_);
   }
 
   std::string Info() const {
     return std::string("\n  linearity") +
-      MomentStatistics(linearity_) +
+      LinearityStatistics() +
       ", lr-coef " + ToString(learn_rate_coef_) +
       ", max-norm " + ToString(max_norm_) +
-      "\n  bias" + MomentStatistics(bias_) +
+      "\n  bias" + MomentStatistics(*bias_) +
       ", lr-coef " + ToString(bias_learn_rate_coef_);
   }
   std::string InfoGradient() const {
@@ -162,9 +176,13 @@ class AffineTransform : public UpdatableComponent {
   void PropagateFnc(const CuMatrixBase<BaseFloat> &in,
                     CuMatrixBase<BaseFloat> *out) {
     // precopy bias
-    out->AddVecToRows(1.0, bias_, 0.0);
+    out->AddVecToRows(1.0, *bias_, 0.0);
     // multiply by weights^t
-    out->AddMatMat(1.0, in, kNoTrans, linearity_, kTrans, 1.0);
+    if (half_linearity_.NumRows() != 0)
+      cu::AddMatHalfMat<BaseFloat>(1.0, in, half_linearity_, 1.0, out);
+    else
+      cu::AddMatQuantizedMat<BaseFloat>(1.0, in, *linearity_,
+                                        quantized_linearity_, 1.0, out);
   }
 
   void BackpropagateFnc(const CuMatrixBase<BaseFloat> &in,
@@ -172,7 +190,7 @@ class AffineTransform : public UpdatableComponent {
                         const CuMatrixBase<BaseFloat> &out_diff,
                         CuMatrixBase<BaseFloat> *in_diff) {
     // multiply error derivative by weights
-    in_diff->AddMatMat(1.0, out_diff, kNoTrans, linearity_, kNoTrans, 0.0);
+    in_diff->AddMatMat(1.0, out_diff, kNoTrans, *linearity_, kNoTrans, 0.0);
   }
 
 
@@ -191,19 +209,20 @@ class AffineTransform : public UpdatableComponent {
     bias_corr_.AddRowSumMat(1.0, diff, mmt);
     // l2 regularization
     if (l2 != 0.0) {
-      linearity_.AddMat(-lr*l2*num_frames, linearity_);
+      linearity_->AddMat(-lr*l2*num_frames, *linearity_);
     }
     // l1 regularization
     if (l1 != 0.0) {
-      cu::RegularizeL1(&linearity_, &linearity_corr_, lr*l1*num_frames, lr);
+      cu::RegularizeL1(&(*linearity_), &linearity_corr_, lr*l1*num_frames, lr);
     }
-    // update
-    linearity_.AddMat(-lr, linearity_corr_);
-    bias_.AddVec(-lr_bias, bias_corr_);
+    // update (a quantized copy would be stale now)
+    quantized_linearity_.Clear();
+    linearity_->AddMat(-lr, linearity_corr_);
+    bias_->AddVec(-lr_bias, bias_corr_);
     // max-norm
     if (max_norm_ > 0.0) {
-      CuMatrix<BaseFloat> lin_sqr(linearity_);
-      lin_sqr.MulElements(linearity_);
+      CuMatrix<BaseFloat> lin_sqr(*linearity_);
+      lin_sqr.MulElements(*linearity_);
       CuVector<BaseFloat> l2(OutputDim());
       l2.AddColSumMat(1.0, lin_sqr, 0.0);
       l2.ApplyPow(0.5);  // we have per-neuron L2 norms,
@@ -211,29 +230,85 @@ class AffineTransform : public UpdatableComponent {
       scl.Scale(1.0/max_norm_);
       scl.ApplyFloor(1.0);
       scl.InvertElements();
-      linearity_.MulRowsVec(scl);  // shink to sphere!
+      linearity_->MulRowsVec(scl);  // shink to sphere!
     }
   }
 
   /// Accessors to the component parameters,
-  const CuVectorBase<BaseFloat>& GetBias() const { return bias_; }
+  const CuVectorBase<BaseFloat>& GetBias() const { return *bias_; }
 
   void SetBias(const CuVectorBase<BaseFloat>& bias) {
-    KALDI_ASSERT(bias.Dim() == bias_.Dim());
-    bias_.CopyFromVec(bias);
+    KALDI_ASSERT(bias.Dim() == bias_->Dim());
+    bias_->CopyFromVec(bias);
   }
 
-  const CuMatrixBase<BaseFloat>& GetLinearity() const { return linearity_; }
+  const CuMatrixBase<BaseFloat>& GetLinearity() const { return *linearity_; }
 
   void SetLinearity(const CuMatrixBase<BaseFloat>& linearity) {
-    KALDI_ASSERT(linearity.NumRows() == linearity_.NumRows());
-    KALDI_ASSERT(linearity.NumCols() == linearity_.NumCols());
-    linearity_.CopyFromMat(linearity);
+    KALDI_ASSERT(linearity.NumRows() == linearity_->NumRows());
+    KALDI_ASSERT(linearity.NumCols() == linearity_->NumCols());
+    linearity_->CopyFromMat(linearity);
+    quantized_linearity_.Clear();
+  }
+
+  /// Makes PropagateFnc() use an 8-bit copy of the weights on the CPU (see
+  /// AddMatQuantizedMat()), or stops it; for test-time use only, as
+  /// anything that changes the weights (training, SetParams(), ReadData()
+  /// etc.) discards the copy.
+  void SetQuantized(bool quantized) {
+    if (half_linearity_.NumRows() != 0)
+      return;  // the 16-bit weights are used instead.
+    if (quantized)
+      quantized_linearity_.CopyFromMat(Matrix<BaseFloat>(*linearity_));
+    else
+      quantized_linearity_.Clear();
+  }
+
+  /// Keeps the weights only in 16-bit floating point (see HalfMatrix), which
+  /// halves their memory, or converts them back to float; for test-time use
+  /// only, as the component can't be trained while its weights are 16-bit.
+  void SetHalfPrecision(bool half, HalfMatrixType type) {
+    quantized_linearity_.Clear();
+    if (half) {
+      if (half_linearity_.NumRows() != 0) {
+        if (half_linearity_.Type() != type)
+          KALDI_ERR << "The weights are already in "
+                    << HalfMatrixTypeName(half_linearity_.Type());
+        return;
+      }
+      if (linearity_.IsShared())
+        KALDI_ERR << "Cannot convert shared weights to 16 bits.";
+      half_linearity_.CopyFromMat(Matrix<BaseFloat>(*linearity_), type);
+      linearity_->Resize(0, 0);
+      linearity_corr_.Resize(0, 0);
+    } else if (half_linearity_.NumRows() != 0) {
+      Matrix<BaseFloat> linearity(half_linearity_.NumRows(),
+                                  half_linearity_.NumCols(), kUndefined);
+      half_linearity_.CopyToMat(&linearity);
+      half_linearity_.Clear();
+      linearity_corr_.Resize(linearity.NumRows(), linearity.NumCols());
+      linearity_->Swap(&linearity);
+    }
   }
 
  private:
-  CuMatrix<BaseFloat> linearity_;
-  CuVector<BaseFloat> bias_;
+  // The statistics of the weights, wherever they are stored.
+  std::string LinearityStatistics() const {
+    if (half_linearity_.NumRows() == 0)
+      return MomentStatistics(*linearity_);
+    Matrix<BaseFloat> linearity(half_linearity_.NumRows(),
+                                half_linearity_.NumCols(), kUndefined);
+    half_linearity_.CopyToMat(&linearity);
+    return MomentStatistics(linearity) + ", " +
+        HalfMatrixTypeName(half_linearity_.Type());
+  }
+
+  SharedParam<CuMatrix<BaseFloat> > linearity_;
+  QuantizedMatrix quantized_linearity_;  // empty unless SetQuantized(true).
+  // If SetHalfPrecision(true, ..) was called, the weights (and linearity_ is
+  // empty).
+  HalfMatrix half_linearity_;
+  SharedParam<CuVector<BaseFloat> > bias_;
 
   CuMatrix<BaseFloat> linearity_corr_;
   CuVector<BaseFloat> bias_corr_;
@@ -86,46 +86,46 @@ class BlstmProjected : public MultistreamComponent {
 
     // init the weights and biases (from uniform dist.),
     // forward direction,
-    f_w_gifo_x_.Resize(4*cell_dim_, input_dim_, kUndefined);
-    f_w_gifo_r_.Resize(4*cell_dim_, proj_dim_, kUndefined);
-    f_bias_.Resize(4*cell_dim_, kUndefined);
-    f_peephole_i_c_.Resize(cell_dim_, kUndefined);
-    f_peephole_f_c_.Resize(cell_dim_, kUndefined);
-    f_peephole_o_c_.Resize(cell_dim_, kUndefined);
-    f_w_r_m_.Resize(proj_dim_, cell_dim_, kUndefined);
+    f_w_gifo_x_->Resize(4*cell_dim_, input_dim_, kUndefined);
+    f_w_gifo_r_->Resize(4*cell_dim_, proj_dim_, kUndefined);
+    f_bias_->Resize(4*cell_dim_, kUndefined);
+    f_peephole_i_c_->Resize(cell_dim_, kUndefined);
+    f_peephole_f_c_->Resize(cell_dim_, kUndefined);
+    f_peephole_o_c_->Resize(cell_dim_, kUndefined);
+    f_w_r_m_->Resize(proj_dim_, cell_dim_, kUndefined);
     //       (mean), (range)
-    RandUniform(0.0, 2.0 * param_range, &f_w_gifo_x_);
-    RandUniform(0.0, 2.0 * param_range, &f_w_gifo_r_);
-    RandUniform(0.0, 2.0 * param_range, &f_bias_);
-    RandUniform(0.0, 2.0 * param_range, &f_peephole_i_c_);
-    RandUniform(0.0, 2.0 * param_range, &f_peephole_f_c_);
-    RandUniform(0.0, 2.0 * param_range, &f_peephole_o_c_);
-    RandUniform(0.0, 2.0 * param_range, &f_w_r_m_);
+    RandUniform(0.0, 2.0 * param_range, &(*f_w_gifo_x_));
+    RandUniform(0.0, 2.0 * param_range, &(*f_w_gifo_r_));
+    RandUniform(0.0, 2.0 * param_range, &(*f_bias_));
+    RandUniform(0.0, 2.0 * param_range, &(*f_peephole_i_c_));
+    RandUniform(0.0, 2.0 * param_range, &(*f_peephole_f_c_));
+    RandUniform(0.0, 2.0 * param_range, &(*f_peephole_o_c_));
+    RandUniform(0.0, 2.0 * param_range, &(*f_w_r_m_));
 
     // Add 1.0 to forget-gate bias
     // [Miao IS16: AN EMPIRICAL EXPLORATION...]
-    f_bias_.Range(2*cell_dim_, cell_dim_).Add(1.0);
+    f_bias_->Range(2*cell_dim_, cell_dim_).Add(1.0);
 
     // backward direction,
-    b_w_gifo_x_.Resize(4*cell_dim_, input_dim_, kUndefined);
-    b_w_gifo_r_.Resize(4*cell_dim_, proj_dim_, kUndefined);
-    b_bias_.Resize(4*cell_dim_, kUndefined);
-    b_peephole_i_c_.Resize(cell_dim_, kUndefined);
-    b_peephole_f_c_.Resize(cell_dim_, kUndefined);
-    b_peephole_o_c_.Resize(cell_dim_, kUndefined);
-    b_w_r_m_.Resize(proj_dim_, cell_dim_, kUndefined);
-
-    RandUniform(0.0, 2.0 * param_range, &b_w_gifo_x_);
-    RandUniform(0.0, 2.0 * param_range, &b_w_gifo_r_);
-    RandUniform(0.0, 2.0 * param_range, &b_bias_);
-    RandUniform(0.0, 2.0 * param_range, &b_peephole_i_c_);
-    RandUniform(0.0, 2.0 * param_range, &b_peephole_f_c_);
-    RandUniform(0.0, 2.0 * param_range, &b_peephole_o_c_);
-    RandUniform(0.0, 2.0 * param_range, &b_w_r_m_);
+    b_w_gifo_x_->Resize(4*cell_dim_, input_dim_, kUndefined);
+    b_w_gifo_r_->Resize(4*cell_dim_, proj_dim_, kUndefined);
+    b_bias_->Resize(4*cell_dim_, kUndefined);
+    b_peephole_i_c_->Resize(cell_dim_, kUndefined);
+    b_peephole_f_c_->Resize(cell_dim_, kUndefined);
+    b_peephole_o_c_->Resize(cell_dim_, kUndefined);
+    b_w_r_m_->Resize(proj_dim_, cell_dim_, kUndefined);
+
+    RandUniform(0.0, 2.0 * param_range, &(*b_w_gifo_x_));
+    RandUniform(0.0, 2.0 * param_range, &(*b_w_gifo_r_));
+    RandUniform(0.0, 2.0 * param_range, &(*b_bias_));
+    RandUniform(0.0, 2.0 * param_range, &(*b_peephole_i_c_));
+    RandUniform(0.0, 2.0 * param_range, &(*b_peephole_f_c_));
+    RandUniform(0.0, 2.0 * param_range, &(*b_peephole_o_c_));
+    RandUniform(0.0, 2.0 * param_range, &(*b_w_r_m_));
 
     // Add 1.0 to forget-gate bias,
     // [Miao IS16: AN EMPIRICAL EXPLORATION...]
-    b_bias_.Range(2*cell_dim_, cell_dim_).Add(1.0);
+    b_bias_->Range(2*cell_dim_, cell_dim_).Add(1.0);
 
     KALDI_ASSERT(cell_dim_ > 0);
     KALDI_ASSERT(learn_rate_coef_ >= 0.0);
@@ -165,26 +165,26 @@ class BlstmProjected : public MultistreamComponent {
     // Read the data (data follow the tokens),
 
     // reading parameters corresponding to forward direction
-    f_w_gifo_x_.Read(is, binary);
-    f_w_gifo_r_.Read(is, binary);
-    f_bias_.Read(is, binary);
+    f_w_gifo_x_->Read(is, binary);
+    f_w_gifo_r_->Read(is, binary);
+    f_bias_->Read(is, binary);
 
-    f_peephole_i_c_.Read(is, binary);
-    f_peephole_f_c_.Read(is, binary);
-    f_peephole_o_c_.Read(is, binary);
+    f_peephole_i_c_->Read(is, binary);
+    f_peephole_f_c_->Read(is, binary);
+    f_peephole_o_c_->Read(is, binary);
 
-    f_w_r_m_.Read(is, binary);
+    f_w_r_m_->Read(is, binary);
 
     // reading parameters corresponding to backward direction
-    b_w_gifo_x_.Read(is, binary);
-    b_w_gifo_r_.Read(is, binary);
-    b_bias_.Read(is, binary);
+    b_w_gifo_x_->Read(is, binary);
+    b_w_gifo_r_->Read(is, binary);
+    b_bias_->Read(is, binary);
 
-    b_peephole_i_c_.Read(is, binary);
-    b_peephole_f_c_.Read(is, binary);
-    b_peephole_o_c_.Read(is, binary);
+    b_peephole_i_c_->Read(is, binary);
+    b_peephole_f_c_->Read(is, binary);
+    b_peephole_o_c_->Read(is, binary);
 
-    b_w_r_m_.Read(is, binary);
+    b_w_r_m_->Read(is, binary);
   }
 
   void WriteData(std::ostream &os, bool binary) const {
@@ -207,37 +207,37 @@ class BlstmProjected : public MultistreamComponent {
 
     if (!binary) os << "\n";
     // writing parameters, forward direction,
-    f_w_gifo_x_.Write(os, binary);
-    f_w_gifo_r_.Write(os, binary);
-    f_bias_.Write(os, binary);
+    f_w_gifo_x_->Write(os, binary);
+    f_w_gifo_r_->Write(os, binary);
+    f_bias_->Write(os, binary);
 
-    f_peephole_i_c_.Write(os, binary);
-    f_peephole_f_c_.Write(os, binary);
-    f_peephole_o_c_.Write(os, binary);
+    f_peephole_i_c_->Write(os, binary);
+    f_peephole_f_c_->Write(os, binary);
+    f_peephole_o_c_->Write(os, binary);
 
-    f_w_r_m_.Write(os, binary);
+    f_w_r_m_->Write(os, binary);
 
     if (!binary) os << "\n";
     // writing parameters, backward direction,
-    b_w_gifo_x_.Write(os, binary);
-    b_w_gifo_r_.Write(os, binary);
-    b_bias_.Write(os, binary);
+    b_w_gifo_x_->Write(os, binary);
+    b_w_gifo_r_->Write(os, binary);
+    b_bias_->Write(os, binary);
 
-    b_peephole_i_c_.Write(os, binary);
-    b_peephole_f_c_.Write(os, binary);
-    b_peephole_o_c_.Write(os, binary);
+    b_peephole_i_c_->Write(os, binary);
+    b_peephole_f_c_->Write(os, binary);
+    b_peephole_o_c_->Write(os, binary);
 
-    b_w_r_m_.Write(os, binary);
+    b_w_r_m_->Write(os, binary);
   }
 
   int32 NumParams() const {
-    return 2 * ( f_w_gifo_x_.NumRows() * f_w_gifo_x_.NumCols() +
-      f_w_gifo_r_.NumRows() * f_w_gifo_r_.NumCols() +
-      f_bias_.Dim() +
-      f_peephole_i_c_.Dim() +
-      f_peephole_f_c_.Dim() +
-      f_peephole_o_c_.Dim() +
-      f_w_r_m_.NumRows() * f_w_r_m_.NumCols() );
+    return 2 * ( f_w_gifo_x_->NumRows() * f_w_gifo_x_->NumCols() +
+      f_w_gifo_r_->NumRows() * f_w_gifo_r_->NumCols() +
+      f_bias_->Dim() +
+      f_peephole_i_c_->Dim() +
+      f_peephole_f_c_->Dim() +
+      f_peephole_o_c_->Dim() +
+      f_w_r_m_->NumRows() * f_w_r_m_->NumCols() );
   }
 
   void GetGradient(VectorBase<BaseFloat>* gradient) const {
@@ -245,47 +245,47 @@ class BlstmProjected : public MultistreamComponent {
     int32 offset, len;
 
     // Copying parameters corresponding to forward direction
-    offset = 0;    len = f_w_gifo_x_.NumRows() * f_w_gifo_x_.NumCols();
+    offset = 0;    len = f_w_gifo_x_->NumRows() * f_w_gifo_x_->NumCols();
     gradient->Range(offset, len).CopyRowsFromMat(f_w_gifo_x_corr_);
 
-    offset += len; len = f_w_gifo_r_.NumRows() * f_w_gifo_r_.NumCols();
+    offset += len; len = f_w_gifo_r_->NumRows() * f_w_gifo_r_->NumCols();
     gradient->Range(offset, len).CopyRowsFromMat(f_w_gifo_r_corr_);
 
-    offset += len; len = f_bias_.Dim();
+    offset += len; len = f_bias_->Dim();
     gradient->Range(offset, len).CopyFromVec(f_bias_corr_);
 
-    offset += len; len = f_peephole_i_c_.Dim();
+    offset += len; len = f_peephole_i_c_->Dim();
     gradient->Range(offset, len).CopyFromVec(f_peephole_i_c_corr_);
 
-    offset += len; len = f_peephole_f_c_.Dim();
+    offset += len; len = f_peephole_f_c_->Dim();
     gradient->Range(offset, len).CopyFromVec(f_peephole_f_c_corr_);
 
-    offset += len; len = f_peephole_o_c_.Dim();
+    offset += len; len = f_peephole_o_c_->Dim();
     gradient->Range(offset, len).CopyFromVec(f_peephole_o_c_corr_);
 
-    offset += len; len = f_w_r_m_.NumRows() * f_w_r_m_.NumCols();
+    offset += len; len = f_w_r_m_->NumRows() * f_w_r_m_->NumCols();
     gradient->Range(offset, len).CopyRowsFromMat(f_w_r_m_corr_);
 
     // Copying parameters corresponding to backward direction
-    offset += len; len = b_w_gifo_x_.NumRows() * b_w_gifo_x_.NumCols();
+    offset += len; len = b_w_gifo_x_->NumRows() * b_w_gifo_x_->NumCols();
     gradient->Range(offset, len).CopyRowsFromMat(b_w_gifo_x_corr_);
 
-    offset += len; len = b_w_gifo_r_.NumRows() * b_w_gifo_r_.NumCols();
+    offset += len; len = b_w_gifo_r_->NumRows() * b_w_gifo_r_->NumCols();
     gradient->Range(offset, len).CopyRowsFromMat(b_w_gifo_r_corr_);
 
-    offset += len; len = b_bias_.Dim();
+    offset += len; len = b_bias_->Dim();
     gradient->Range(offset, len).CopyFromVec(b_bias_corr_);
 
-    offset += len; len = b_peephole_i_c_.Dim();
+    offset += len; len = b_peephole_i_c_->Dim();
     gradient->Range(offset, len).CopyFromVec(b_peephole_i_c_corr_);
 
-    offset += len; len = b_peephole_f_c_.Dim();
+    offset += len; len = b_peephole_f_c_->Dim();
     gradient->Range(offset, len).CopyFromVec(b_peephole_f_c_corr_);
 
-    offset += len; len = b_peephole_o_c_.Dim();
+    offset += len; len = b_peephole_o_c_->Dim();
     gradient->Range(offset, len).CopyFromVec(b_peephole_o_c_corr_);
 
-    offset += len; len = b_w_r_m_.NumRows() * b_w_r_m_.NumCols();
+    offset += len; len = b_w_r_m_->NumRows() * b_w_r_m_->NumCols();
     gradient->Range(offset, len).CopyRowsFromMat(b_w_r_m_corr_);
 
     // check the dim,
@@ -298,48 +298,48 @@ class BlstmProjected : public MultistreamComponent {
     int32 offset, len;
 
     // Copying parameters corresponding to forward direction
-    offset = 0;    len = f_w_gifo_x_.NumRows() * f_w_gifo_x_.NumCols();
-    params->Range(offset, len).CopyRowsFromMat(f_w_gifo_x_);
+    offset = 0;    len = f_w_gifo_x_->NumRows() * f_w_gifo_x_->NumCols();
+    params->Range(offset, len).CopyRowsFromMat(*f_w_gifo_x_);
 
-    offset += len; len = f_w_gifo_r_.NumRows() * f_w_gifo_r_.NumCols();
-    params->Range(offset, len).CopyRowsFromMat(f_w_gifo_r_);
+    offset += len; len = f_w_gifo_r_->NumRows() * f_w_gifo_r_->NumCols();
+    params->Range(offset, len).CopyRowsFromMat(*f_w_gifo_r_);
 
-    offset += len; len = f_bias_.Dim();
-    params->Range(offset, len).CopyFromVec(f_bias_);
+    offset += len; len = f_bias_->Dim();
+    params->Range(offset, len).CopyFromVec(*f_bias_);
 
-    offset += len; len = f_peephole_i_c_.Dim();
-    params->Range(offset, len).CopyFromVec(f_peephole_i_c_);
+    offset += len; len = f_peephole_i_c_->Dim();
+    params->Range(offset, len).CopyFromVec(*f_peephole_i_c_);
 
-    offset += len; len = f_peephole_f_c_.Dim();
-    params->Range(offset, len).CopyFromVec(f_peephole_f_c_);
+    offset += len; len = f_peephole_f_c_->Dim();
+    params->Range(offset, len).CopyFromVec(*f_peephole_f_c_);
 
-    offset += len; len = f_peephole_o_c_.Dim();
-    params->Range(offset, len).CopyFromVec(f_peephole_o_c_);
+    offset += len; len = f_peephole_o_c_->Dim();
+    params->Range(offset, len).CopyFromVec(*f_peephole_o_c_);
 
-    offset += len; len = f_w_r_m_.NumRows() * f_w_r_m_.NumCols();
-    params->Range(offset, len).CopyRowsFromMat(f_w_r_m_);
+    offset += len; len = f_w_r_m_->NumRows() * f_w_r_m_->NumCols();
+    params->Range(offset, len).CopyRowsFromMat(*f_w_r_m_);
 
     // Copying parameters corresponding to backward direction
-    offset += len; len = b_w_gifo_x_.NumRows() * b_w_gifo_x_.NumCols();
-    params->Range(offset, len).CopyRowsFromMat(b_w_gifo_x_);
+    offset += len; len = b_w_gifo_x_->NumRows() * b_w_gifo_x_->NumCols();
+    params->Range(offset, len).CopyRowsFromMat(*b_w_gifo_x_);
 
-    offset += len; len = b_w_gifo_r_.NumRows() * b_w_gifo_r_.NumCols();
-    params->Range(offset, len).CopyRowsFromMat(b_w_gifo_r_);
+    offset += len; len = b_w_gifo_r_->NumRows() * b_w_gifo_r_->NumCols();
+    params->Range(offset, len).CopyRowsFromMat(*b_w_gifo_r_);
 
-    offset += len; len = b_bias_.Dim();
-    params->Range(offset, len).CopyFromVec(b_bias_);
+    offset += len; len = b_bias_->Dim();
+    params->Range(offset, len).CopyFromVec(*b_bias_);
 
-    offset += len; len = b_peephole_i_c_.Dim();
-    params->Range(offset, len).CopyFromVec(b_peephole_i_c_);
+    offset += len; len = b_peephole_i_c_->Dim();
+    params->Range(offset, len).CopyFromVec(*b_peephole_i_c_);
 
-    offset += len; len = b_peephole_f_c_.Dim();
-    params->Range(offset, len).CopyFromVec(b_peephole_f_c_);
+    offset += len; len = b_peephole_f_c_->Dim();
+    params->Range(offset, len).CopyFromVec(*b_peephole_f_c_);
 
-    offset += len; len = b_peephole_o_c_.Dim();
-    params->Range(offset, len).CopyFromVec(b_peephole_o_c_);
+    offset += len; len = b_peephole_o_c_->Dim();
+    params->Range(offset, len).CopyFromVec(*b_peephole_o_c_);
 
-    offset += len; len = b_w_r_m_.NumRows() * b_w_r_m_.NumCols();
-    params->Range(offset, len).CopyRowsFromMat(b_w_r_m_);
+    offset += len; len = b_w_r_m_->NumRows() * b_w_r_m_->NumCols();
+    params->Range(offset, len).CopyRowsFromMat(*b_w_r_m_);
 
     // check the dim,
     offset += len;
@@ -351,54 +351,73 @@ class BlstmProjected : public MultistreamComponent {
     int32 offset, len;
 
     // Copying parameters corresponding to forward direction
-    offset = 0;    len = f_w_gifo_x_.NumRows() * f_w_gifo_x_.NumCols();
-    f_w_gifo_x_.CopyRowsFromVec(params.Range(offset, len));
+    offset = 0;    len = f_w_gifo_x_->NumRows() * f_w_gifo_x_->NumCols();
+    f_w_gifo_x_->CopyRowsFromVec(params.Range(offset, len));
 
-    offset += len; len = f_w_gifo_r_.NumRows() * f_w_gifo_r_.NumCols();
-    f_w_gifo_r_.CopyRowsFromVec(params.Range(offset, len));
+    offset += len; len = f_w_gifo_r_->NumRows() * f_w_gifo_r_->NumCols();
+    f_w_gifo_r_->CopyRowsFromVec(params.Range(offset, len));
 
-    offset += len; len = f_bias_.Dim();
-    f_bias_.CopyFromVec(params.Range(offset, len));
+    offset += len; len = f_bias_->Dim();
+    f_bias_->CopyFromVec(params.Range(offset, len));
 
-    offset += len; len = f_peephole_i_c_.Dim();
-    f_peephole_i_c_.CopyFromVec(params.Range(offset, len));
+    offset += len; len = f_peephole_i_c_->Dim();
+    f_peephole_i_c_->CopyFromVec(params.Range(offset, len));
 
-    offset += len; len = f_peephole_f_c_.Dim();
-    f_peephole_f_c_.CopyFromVec(params.Range(offset, len));
+    offset += len; len = f_peephole_f_c_->Dim();
+    f_peephole_f_c_->CopyFromVec(params.Range(offset, len));
 
-    offset += len; len = f_peephole_o_c_.Dim();
-    f_peephole_o_c_.CopyFromVec(params.Range(offset, len));
+    offset += len; len = f_peephole_o_c_->Dim();
+    f_peephole_o_c_->CopyFromVec(params.Range(offset, len));
 
-    offset += len; len = f_w_r_m_.NumRows() * f_w_r_m_.NumCols();
-    f_w_r_m_.CopyRowsFromVec(params.Range(offset, len));
+    offset += len; len = f_w_r_m_->NumRows() * f_w_r_m_->NumCols();
+    f_w_r_m_->CopyRowsFromVec(params.Range(offset, len));
 
     // Copying parameters corresponding to backward direction
-    offset += len; len = b_w_gifo_x_.NumRows() * b_w_gifo_x_.NumCols();
-    b_w_gifo_x_.CopyRowsFromVec(params.Range(offset, len));
+    offset += len; len = b_w_gifo_x_->NumRows() * b_w_gifo_x_->NumCols();
+    b_w_gifo_x_->CopyRowsFromVec(params.Range(offset, len));
 
-    offset += len; len = b_w_gifo_r_.NumRows() * b_w_gifo_r_.NumCols();
-    b_w_gifo_r_.CopyRowsFromVec(params.Range(offset, len));
+    offset += len; len = b_w_gifo_r_->NumRows() * b_w_gifo_r_->NumCols();
+    b_w_gifo_r_->CopyRowsFromVec(params.Range(offset, len));
 
-    offset += len; len = b_bias_.Dim();
-    b_bias_.CopyFromVec(params.Range(offset, len));
+    offset += len; len = b_bias_->Dim();
+    b_bias_->CopyFromVec(params.Range(offset, len));
 
-    offset += len; len = b_peephole_i_c_.Dim();
-    b_peephole_i_c_.CopyFromVec(params.Range(offset, len));
+    offset += len; len = b_peephole_i_c_->Dim();
+    b_peephole_i_c_->CopyFromVec(params.Range(offset, len));
 
-    offset += len; len = b_peephole_f_c_.Dim();
-    b_peephole_f_c_.CopyFromVec(params.Range(offset, len));
+    offset += len; len = b_peephole_f_c_->Dim();
+    b_peephole_f_c_->CopyFromVec(params.Range(offset, len));
 
-    offset += len; len = b_peephole_o_c_.Dim();
-    b_peephole_o_c_.CopyFromVec(params.Range(offset, len));
+    offset += len; len = b_peephole_o_c_->Dim();
+    b_peephole_o_c_->CopyFromVec(params.Range(offset, len));
 
-    offset += len; len = b_w_r_m_.NumRows() * b_w_r_m_.NumCols();
-    b_w_r_m_.CopyRowsFromVec(params.Range(offset, len));
+    offset += len; len = b_w_r_m_->NumRows() * b_w_r_m_->NumCols();
+    b_w_r_m_->CopyRowsFromVec(params.Range(offset, len));
 
     // check the dim,
     offset += len;
     KALDI_ASSERT(offset == NumParams());
   }
 
+  void ShareParams(UpdatableComponent *other) {
+    BlstmProjected *o = dynamic_cast<BlstmProjected*>(other);
+    KALDI_ASSERT(o != NULL && o != this && NumParams() == o->NumParams());
+    f_w_gifo_x_.Share(&o->f_w_gifo_x_);
+    f_w_gifo_r_.Share(&o->f_w_gifo_r_);
+    f_bias_.Share(&o->f_bias_);
+    f_peephole_i_c_.Share(&o->f_peephole_i_c_);
+    f_peephole_f_c_.Share(&o->f_peephole_f_c_);
+    f_peephole_o_c_.Share(&o->f_peephole_o_c_);
+    f_w_r_m_.Share(&o->f_w_r_m_);
+    b_w_gifo_x_.Share(&o->b_w_gifo_x_);
+    b_w_gifo_r_.Share(&o->b_w_gifo_r_);
+    b_bias_.Share(&o->b_bias_);
+    b_peephole_i_c_.Share(&o->b_peephole_i_c_);
+    b_peephole_f_c_.Share(&o->b_peephole_f_c_);
+    b_peephole_o_c_.Share(&o->b_peephole_o_c_);
+    b_w_r_m_.Share(&o->b_w_r_m_);
+  }
+
 
   std::string Info() const {
     return std::string("cell-dim 2x") + ToString(cell_dim_) + " " +
@@ -408,21 +427,21 @@ class BlstmProjected : public MultistreamComponent {
       ", diff_clip_ " + ToString(diff_clip_) +
       ", grad_clip_ " + ToString(grad_clip_) + " )" +
       "\n  Forward Direction weights:" +
-      "\n  f_w_gifo_x_  "     + MomentStatistics(f_w_gifo_x_) +
-      "\n  f_w_gifo_r_  "     + MomentStatistics(f_w_gifo_r_) +
-      "\n  f_bias_  "         + MomentStatistics(f_bias_) +
-      "\n  f_peephole_i_c_  " + MomentStatistics(f_peephole_i_c_) +
-      "\n  f_peephole_f_c_  " + MomentStatistics(f_peephole_f_c_) +
-      "\n  f_peephole_o_c_  " + MomentStatistics(f_peephole_o_c_) +
-      "\n  f_w_r_m_  "        + MomentStatistics(f_w_r_m_) +
+      "\n  f_w_gifo_x_  "     + MomentStatistics(*f_w_gifo_x_) +
+      "\n  f_w_gifo_r_  "     + MomentStatistics(*f_w_gifo_r_) +
+      "\n  f_bias_  "         + MomentStatistics(*f_bias_) +
+      "\n  f_peephole_i_c_  " + MomentStatistics(*f_peephole_i_c_) +
+      "\n  f_peephole_f_c_  " + MomentStatistics(*f_peephole_f_c_) +
+      "\n  f_peephole_o_c_  " + MomentStatistics(*f_peephole_o_c_) +
+      "\n  f_w_r_m_  "        + MomentStatistics(*f_w_r_m_) +
       "\n  Backward Direction weights:" +
-      "\n  b_w_gifo_x_  "     + MomentStatistics(b_w_gifo_x_) +
-      "\n  b_w_gifo_r_  "     + MomentStatistics(b_w_gifo_r_) +
-      "\n  b_bias_  "         + MomentStatistics(b_bias_) +
-      "\n  b_peephole_i_c_  " + MomentStatistics(b_peephole_i_c_) +
-      "\n  b_peephole_f_c_  " + MomentStatistics(b_peephole_f_c_) +
-      "\n  b_peephole_o_c_  " + MomentStatistics(b_peephole_o_c_) +
-      "\n  b_w_r_m_  "        + MomentStatistics(b_w_r_m_);
+      "\n  b_w_gifo_x_  "     + MomentStatistics(*b_w_gifo_x_) +
+      "\n  b_w_gifo_r_  "     + MomentStatistics(*b_w_gifo_r_) +
+      "\n  b_bias_  "         + MomentStatistics(*b_bias_) +
+      "\n  b_peephole_i_c_  " + MomentStatistics(*b_peephole_i_c_) +
+      "\n  b_peephole_f_c_  " + MomentStatistics(*b_peephole_f_c_) +
+      "\n  b_peephole_o_c_  " + MomentStatistics(*b_peephole_o_c_) +
+      "\n  b_w_r_m_  "        + MomentStatistics(*b_w_r_m_);
   }
 
 
@@ -564,10 +583,10 @@ class BlstmProjected : public MultistreamComponent {
 
     // FORWARD DIRECTION,
     // x -> g, i, f, o, not recurrent, do it all in once
-    F_YGIFO.RowRange(1*S, T*S).AddMatMat(1.0, in, kNoTrans, f_w_gifo_x_, kTrans, 0.0);
+    F_YGIFO.RowRange(1*S, T*S).AddMatMat(1.0, in, kNoTrans, *f_w_gifo_x_, kTrans, 0.0);
 
     // bias -> g, i, f, o
-    F_YGIFO.RowRange(1*S, T*S).AddVecToRows(1.0, f_bias_);
+    F_YGIFO.RowRange(1*S, T*S).AddVecToRows(1.0, *f_bias_);
 
     // BufferPadding [T0]:dummy, [1, T]:current sequence, [T+1]:dummy
     for (int t = 1; t <= T; t++) {
@@ -584,13 +603,13 @@ class BlstmProjected : public MultistreamComponent {
       CuSubMatrix<BaseFloat> y_gifo(F_YGIFO.RowRange(t*S, S));
 
       // r(t-1) -> g, i, f, o
-      y_gifo.AddMatMat(1.0, F_YR.RowRange((t-1)*S, S), kNoTrans, f_w_gifo_r_, kTrans, 1.0);
+      y_gifo.AddMatMat(1.0, F_YR.RowRange((t-1)*S, S), kNoTrans, *f_w_gifo_r_, kTrans, 1.0);
 
       // c(t-1) -> i(t) via peephole
-      y_i.AddMatDiagVec(1.0, F_YC.RowRange((t-1)*S, S), kNoTrans, f_peephole_i_c_, 1.0);
+      y_i.AddMatDiagVec(1.0, F_YC.RowRange((t-1)*S, S), kNoTrans, *f_peephole_i_c_, 1.0);
 
       // c(t-1) -> f(t) via peephole
-      y_f.AddMatDiagVec(1.0, F_YC.RowRange((t-1)*S, S), kNoTrans, f_peephole_f_c_, 1.0);
+      y_f.AddMatDiagVec(1.0, F_YC.RowRange((t-1)*S, S), kNoTrans, *f_peephole_f_c_, 1.0);
 
       // i, f sigmoid squashing
       y_i.Sigmoid(y_i);
@@ -610,7 +629,7 @@ class BlstmProjected : public MultistreamComponent {
       }
 
       // c(t) -> o(t) via peephole (not recurrent, using c(t))
-      y_o.AddMatDiagVec(1.0, y_c, kNoTrans, f_peephole_o_c_, 1.0);
+      y_o.AddMatDiagVec(1.0, y_c, kNoTrans, *f_peephole_o_c_, 1.0);
 
       // o sigmoid squashing,
       y_o.Sigmoid(y_o);
@@ -622,7 +641,7 @@ class BlstmProjected : public MultistreamComponent {
       y_m.AddMatMatElements(1.0, y_h, y_o, 0.0);
 
       // m -> r
-      y_r.AddMatMat(1.0, y_m, kNoTrans, f_w_r_m_, kTrans, 0.0);
+      y_r.AddMatMat(1.0, y_m, kNoTrans, *f_w_r_m_, kTrans, 0.0);
 
       // set zeros to padded frames,
       if (sequence_lengths_.size() > 0) {
@@ -636,10 +655,10 @@ class BlstmProjected : public MultistreamComponent {
 
     // BACKWARD DIRECTION,
     // x -> g, i, f, o, not recurrent, do it all in once
-    B_YGIFO.RowRange(1*S, T*S).AddMatMat(1.0, in, kNoTrans, b_w_gifo_x_, kTrans, 0.0);
+    B_YGIFO.RowRange(1*S, T*S).AddMatMat(1.0, in, kNoTrans, *b_w_gifo_x_, kTrans, 0.0);
 
     // bias -> g, i, f, o
-    B_YGIFO.RowRange(1*S, T*S).AddVecToRows(1.0, b_bias_);
+    B_YGIFO.RowRange(1*S, T*S).AddVecToRows(1.0, *b_bias_);
 
     // BufferPadding [T0]:dummy, [1, T]:current sequence, [T+1]:dummy
     for (int t = T; t >= 1; t--) {
@@ -656,13 +675,13 @@ class BlstmProjected : public MultistreamComponent {
       CuSubMatrix<BaseFloat> y_gifo(B_YGIFO.RowRange(t*S, S));
 
       // r(t+1) -> g, i, f, o
-      y_gifo.AddMatMat(1.0, B_YR.RowRange((t+1)*S, S), kNoTrans, b_w_gifo_r_, kTrans, 1.0);
+      y_gifo.AddMatMat(1.0, B_YR.RowRange((t+1)*S, S), kNoTrans, *b_w_gifo_r_, kTrans, 1.0);
 
       // c(t+1) -> i(t) via peephole
-      y_i.AddMatDiagVec(1.0, B_YC.RowRange((t+1)*S, S), kNoTrans, b_peephole_i_c_, 1.0);
+      y_i.AddMatDiagVec(1.0, B_YC.RowRange((t+1)*S, S), kNoTrans, *b_peephole_i_c_, 1.0);
 
       // c(t+1) -> f(t) via peephole
-      y_f.AddMatDiagVec(1.0, B_YC.RowRange((t+1)*S, S), kNoTrans, b_peephole_f_c_, 1.0);
+      y_f.AddMatDiagVec(1.0, B_YC.RowRange((t+1)*S, S), kNoTrans, *b_peephole_f_c_, 1.0);
 
       // i, f sigmoid squashing
       y_i.Sigmoid(y_i);
@@ -682,7 +701,7 @@ class BlstmProjected : public MultistreamComponent {
       }
 
       // c(t) -> o(t) via peephole (not recurrent, using c(t))
-      y_o.AddMatDiagVec(1.0, y_c, kNoTrans, b_peephole_o_c_, 1.0);
+      y_o.AddMatDiagVec(1.0, y_c, kNoTrans, *b_peephole_o_c_, 1.0);
 
       // o sigmoid squashing,
       y_o.Sigmoid(y_o);
@@ -694,7 +713,7 @@ class BlstmProjected : public MultistreamComponent {
       y_m.AddMatMatElements(1.0, y_h, y_o, 0.0);
 
       // m -> r
-      y_r.AddMatMat(1.0, y_m, kNoTrans, b_w_r_m_, kTrans, 0.0);
+      y_r.AddMatMat(1.0, y_m, kNoTrans, *b_w_r_m_, kTrans, 0.0);
 
       // set zeros to padded frames,
       if (sequence_lengths_.size() > 0) {
@@ -780,7 +799,7 @@ class BlstmProjected : public MultistreamComponent {
       // r
       //   Version 1 (precise gradients):
       //   backprop error from g(t+1), i(t+1), f(t+1), o(t+1) to r(t)
-      d_r.AddMatMat(1.0, F_DGIFO.RowRange((t+1)*S, S), kNoTrans, f_w_gifo_r_, kNoTrans, 1.0);
+      d_r.AddMatMat(1.0, F_DGIFO.RowRange((t+1)*S, S), kNoTrans, *f_w_gifo_r_, kNoTrans, 1.0);
 
       /*
       //   Version 2 (Alex Graves' PhD dissertation):
@@ -797,7 +816,7 @@ class BlstmProjected : public MultistreamComponent {
       */
 
       // r -> m
-      d_m.AddMatMat(1.0, d_r, kNoTrans, f_w_r_m_, kNoTrans, 0.0);
+      d_m.AddMatMat(1.0, d_r, kNoTrans, *f_w_r_m_, kNoTrans, 0.0);
 
       // m -> h, via output gate
       d_h.AddMatMatElements(1.0, d_m, y_o, 0.0);
@@ -815,9 +834,9 @@ class BlstmProjected : public MultistreamComponent {
       // 5. diff from o(t)   (via peephole, not recurrent)
       d_c.AddMat(1.0, d_h);
       d_c.AddMatMatElements(1.0, F_DC.RowRange((t+1)*S, S), F_YF.RowRange((t+1)*S, S), 1.0);
-      d_c.AddMatDiagVec(1.0, F_DI.RowRange((t+1)*S, S), kNoTrans, f_peephole_i_c_, 1.0);
-      d_c.AddMatDiagVec(1.0, F_DF.RowRange((t+1)*S, S), kNoTrans, f_peephole_f_c_, 1.0);
-      d_c.AddMatDiagVec(1.0, d_o                      , kNoTrans, f_peephole_o_c_, 1.0);
+      d_c.AddMatDiagVec(1.0, F_DI.RowRange((t+1)*S, S), kNoTrans, *f_peephole_i_c_, 1.0);
+      d_c.AddMatDiagVec(1.0, F_DF.RowRange((t+1)*S, S), kNoTrans, *f_peephole_f_c_, 1.0);
+      d_c.AddMatDiagVec(1.0, d_o                      , kNoTrans, *f_peephole_o_c_, 1.0);
       // optionally clip the cell_derivative,
       if (cell_diff_clip_ > 0.0) {
         d_c.ApplyFloor(-cell_diff_clip_);
@@ -909,7 +928,7 @@ class BlstmProjected : public MultistreamComponent {
       // r
       //   Version 1 (precise gradients):
       //   backprop error from g(t-1), i(t-1), f(t-1), o(t-1) to r(t)
-      d_r.AddMatMat(1.0, B_DGIFO.RowRange((t-1)*S, S), kNoTrans, b_w_gifo_r_, kNoTrans, 1.0);
+      d_r.AddMatMat(1.0, B_DGIFO.RowRange((t-1)*S, S), kNoTrans, *b_w_gifo_r_, kNoTrans, 1.0);
 
       /*
       //   Version 2 (Alex Graves' PhD dissertation):
@@ -925,7 +944,7 @@ class BlstmProjected : public MultistreamComponent {
       */
 
       // r -> m
-      d_m.AddMatMat(1.0, d_r, kNoTrans, b_w_r_m_, kNoTrans, 0.0);
+      d_m.AddMatMat(1.0, d_r, kNoTrans, *b_w_r_m_, kNoTrans, 0.0);
 
       // m -> h via output gate
       d_h.AddMatMatElements(1.0, d_m, y_o, 0.0);
@@ -943,9 +962,9 @@ class BlstmProjected : public MultistreamComponent {
       // 5. diff from o(t)   (via peephole, not recurrent)
       d_c.AddMat(1.0, d_h);
       d_c.AddMatMatElements(1.0, B_DC.RowRange((t-1)*S, S), B_YF.RowRange((t-1)*S, S), 1.0);
-      d_c.AddMatDiagVec(1.0, B_DI.RowRange((t-1)*S, S), kNoTrans, b_peephole_i_c_, 1.0);
-      d_c.AddMatDiagVec(1.0, B_DF.RowRange((t-1)*S, S), kNoTrans, b_peephole_f_c_, 1.0);
-      d_c.AddMatDiagVec(1.0, d_o                      , kNoTrans, b_peephole_o_c_, 1.0);
+      d_c.AddMatDiagVec(1.0, B_DI.RowRange((t-1)*S, S), kNoTrans, *b_peephole_i_c_, 1.0);
+      d_c.AddMatDiagVec(1.0, B_DF.RowRange((t-1)*S, S), kNoTrans, *b_peephole_f_c_, 1.0);
+      d_c.AddMatDiagVec(1.0, d_o                      , kNoTrans, *b_peephole_o_c_, 1.0);
       // optionally clip the cell_derivative,
       if (cell_diff_clip_ > 0.0) {
         d_c.ApplyFloor(-cell_diff_clip_);
@@ -989,9 +1008,9 @@ class BlstmProjected : public MultistreamComponent {
 
     // g,i,f,o -> x, calculating input derivatives,
     // forward direction difference
-    in_diff->AddMatMat(1.0, F_DGIFO.RowRange(1*S, T*S), kNoTrans, f_w_gifo_x_, kNoTrans, 0.0);
+    in_diff->AddMatMat(1.0, F_DGIFO.RowRange(1*S, T*S), kNoTrans, *f_w_gifo_x_, kNoTrans, 0.0);
     // backward direction difference
-    in_diff->AddMatMat(1.0, B_DGIFO.RowRange(1*S, T*S), kNoTrans, b_w_gifo_x_, kNoTrans, 1.0);
+    in_diff->AddMatMat(1.0, B_DGIFO.RowRange(1*S, T*S), kNoTrans, *b_w_gifo_x_, kNoTrans, 1.0);
 
     // lazy initialization of udpate buffers,
     if (f_w_gifo_x_corr_.NumRows() == 0) {
@@ -1103,26 +1122,26 @@ class BlstmProjected : public MultistreamComponent {
     const BaseFloat lr = opts_.learn_rate;
 
     // forward direction update
-    f_w_gifo_x_.AddMat(-lr * learn_rate_coef_, f_w_gifo_x_corr_);
-    f_w_gifo_r_.AddMat(-lr * learn_rate_coef_, f_w_gifo_r_corr_);
-    f_bias_.AddVec(-lr * bias_learn_rate_coef_, f_bias_corr_, 1.0);
+    f_w_gifo_x_->AddMat(-lr * learn_rate_coef_, f_w_gifo_x_corr_);
+    f_w_gifo_r_->AddMat(-lr * learn_rate_coef_, f_w_gifo_r_corr_);
+    f_bias_->AddVec(-lr * bias_learn_rate_coef_, f_bias_corr_, 1.0);
 
-    f_peephole_i_c_.AddVec(-lr * bias_learn_rate_coef_, f_peephole_i_c_corr_, 1.0);
-    f_peephole_f_c_.AddVec(-lr * bias_learn_rate_coef_, f_peephole_f_c_corr_, 1.0);
-    f_peephole_o_c_.AddVec(-lr * bias_learn_rate_coef_, f_peephole_o_c_corr_, 1.0);
+    f_peephole_i_c_->AddVec(-lr * bias_learn_rate_coef_, f_peephole_i_c_corr_, 1.0);
+    f_peephole_f_c_->AddVec(-lr * bias_learn_rate_coef_, f_peephole_f_c_corr_, 1.0);
+    f_peephole_o_c_->AddVec(-lr * bias_learn_rate_coef_, f_peephole_o_c_corr_, 1.0);
 
-    f_w_r_m_.AddMat(-lr * learn_rate_coef_, f_w_r_m_corr_);
+    f_w_r_m_->AddMat(-lr * learn_rate_coef_, f_w_r_m_corr_);
 
     // backward direction update
-    b_w_gifo_x_.AddMat(-lr * learn_rate_coef_, b_w_gifo_x_corr_);
-    b_w_gifo_r_.AddMat(-lr * learn_rate_coef_, b_w_gifo_r_corr_);
-    b_bias_.AddVec(-lr * bias_learn_rate_coef_, b_bias_corr_, 1.0);
+    b_w_gifo_x_->AddMat(-lr * learn_rate_coef_, b_w_gifo_x_corr_);
+    b_w_gifo_r_->AddMat(-lr * learn_rate_coef_, b_w_gifo_r_corr_);
+    b_bias_->AddVec(-lr * bias_learn_rate_coef_, b_bias_corr_, 1.0);
 
-    b_peephole_i_c_.AddVec(-lr * bias_learn_rate_coef_, b_peephole_i_c_corr_, 1.0);
-    b_peephole_f_c_.AddVec(-lr * bias_learn_rate_coef_, b_peephole_f_c_corr_, 1.0);
-    b_peephole_o_c_.AddVec(-lr * bias_learn_rate_coef_, b_peephole_o_c_corr_, 1.0);
+    b_peephole_i_c_->AddVec(-lr * bias_learn_rate_coef_, b_peephole_i_c_corr_, 1.0);
+    b_peephole_f_c_->AddVec(-lr * bias_learn_rate_coef_, b_peephole_f_c_corr_, 1.0);
+    b_peephole_o_c_->AddVec(-lr * bias_learn_rate_coef_, b_peephole_o_c_corr_, 1.0);
 
-    b_w_r_m_.AddMat(-lr * learn_rate_coef_, b_w_r_m_corr_);
+    b_w_r_m_->AddMat(-lr * learn_rate_coef_, b_w_r_m_corr_);
   }
 
  private:
@@ -1137,38 +1156,38 @@ class BlstmProjected : public MultistreamComponent {
 
   // feed-forward connections: from x to [g, i, f, o]
   // forward direction
-  CuMatrix<BaseFloat> f_w_gifo_x_;
+  SharedParam<CuMatrix<BaseFloat> > f_w_gifo_x_;
   CuMatrix<BaseFloat> f_w_gifo_x_corr_;
   // backward direction
-  CuMatrix<BaseFloat> b_w_gifo_x_;
+  SharedParam<CuMatrix<BaseFloat> > b_w_gifo_x_;
   CuMatrix<BaseFloat> b_w_gifo_x_corr_;
 
   // recurrent projection connections: from r to [g, i, f, o]
   // forward direction
-  CuMatrix<BaseFloat> f_w_gifo_r_;
+  SharedParam<CuMatrix<BaseFloat> > f_w_gifo_r_;
   CuMatrix<BaseFloat> f_w_gifo_r_corr_;
   // backward direction
-  CuMatrix<BaseFloat> b_w_gifo_r_;
+  SharedParam<CuMatrix<BaseFloat> > b_w_gifo_r_;
   CuMatrix<BaseFloat> b_w_gifo_r_corr_;
 
   // biases of [g, i, f, o]
   // forward direction
-  CuVector<BaseFloat> f_bias_;
+  SharedParam<CuVector<BaseFloat> > f_bias_;
   CuVector<BaseFloat> f_bias_corr_;
   // backward direction
-  CuVector<BaseFloat> b_bias_;
+  SharedParam<CuVector<BaseFloat> > b_bias_;
   CuVector<BaseFloat> b_bias_corr_;
 
   // peephole from c to i, f, g
   // peephole connections are diagonal, so we use vector form,
   // forward direction
-  CuVector<BaseFloat> f_peephole_i_c_;
-  CuVector<BaseFloat> f_peephole_f_c_;
-  CuVector<BaseFloat> f_peephole_o_c_;
+  SharedParam<CuVector<BaseFloat> > f_peephole_i_c_;
+  SharedParam<CuVector<BaseFloat> > f_peephole_f_c_;
+  SharedParam<CuVector<BaseFloat> > f_peephole_o_c_;
   // backward direction
-  CuVector<BaseFloat> b_peephole_i_c_;
-  CuVector<BaseFloat> b_peephole_f_c_;
-  CuVector<BaseFloat> b_peephole_o_c_;
+  SharedParam<CuVector<BaseFloat> > b_peephole_i_c_;
+  SharedParam<CuVector<BaseFloat> > b_peephole_f_c_;
+  SharedParam<CuVector<BaseFloat> > b_peephole_o_c_;
 
   // forward direction
   CuVector<BaseFloat> f_peephole_i_c_corr_;
@@ -1181,10 +1200,10 @@ class BlstmProjected : public MultistreamComponent {
 
   // projection layer r: from m to r
   // forward direction
-  CuMatrix<BaseFloat> f_w_r_m_;
+  SharedParam<CuMatrix<BaseFloat> > f_w_r_m_;
   CuMatrix<BaseFloat> f_w_r_m_corr_;
   // backward direction
-  CuMatrix<BaseFloat> b_w_r_m_;
+  SharedParam<CuMatrix<BaseFloat> > b_w_r_m_;
   CuMatrix<BaseFloat> b_w_r_m_corr_;
 
   // propagate buffer: output of [g, i, f, o, c, h, m, r]
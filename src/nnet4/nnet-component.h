@@ -202,6 +202,50 @@ class Component {
 };
 
 
+/**
+ * Class SharedParam holds one trainable parameter (a CuMatrix or CuVector)
+ * of an UpdatableComponent.  Normally it owns the data; after Share(other)
+ * it releases its own copy and refers to the data of 'other' instead,
+ * which is how several per-thread copies of a Nnet update one set of
+ * weights in place (Hogwild training, see UpdatableComponent::ShareParams).
+ * Copying a SharedParam makes a deep copy of the current values.
+ */
+template<class T>
+class SharedParam {
+ public:
+  SharedParam(): ptr_(&data_) { }
+  explicit SharedParam(MatrixIndexT dim): data_(dim), ptr_(&data_) { }
+  SharedParam(MatrixIndexT rows, MatrixIndexT cols):
+    data_(rows, cols), ptr_(&data_) { }
+  SharedParam(const SharedParam &other): data_(*other.ptr_), ptr_(&data_) { }
+  SharedParam& operator = (const SharedParam &other) {
+    if (this != &other) {
+      data_ = *other.ptr_;
+      ptr_ = &data_;
+    }
+    return *this;
+  }
+
+  /// Use the data of 'other' (which must outlive 'this'),
+  void Share(SharedParam *other) {
+    ptr_ = other->ptr_;
+    T empty;
+    data_.Swap(&empty);  // release our own copy,
+  }
+  /// True if the data belongs to another component,
+  bool IsShared() const { return ptr_ != &data_; }
+
+  T& operator * () { return *ptr_; }
+  const T& operator * () const { return *ptr_; }
+  T* operator -> () { return ptr_; }
+  const T* operator -> () const { return ptr_; }
+
+ private:
+  T data_;
+  T *ptr_;
+};
+
+
 /**
  * Class UpdatableComponent is a Component which has trainable parameters,
  * it contains SGD training hyper-parameters in NnetTrainOptions.
@@ -240,6 +284,16 @@ class UpdatableComponent : public Component {
   virtual void Update(const CuMatrixBase<BaseFloat> &input,
                       const CuMatrixBase<BaseFloat> &diff) = 0;
 
+  /// Make this component use the trainable parameters of 'other' (a
+  /// component of the same type, which must outlive 'this') instead of
+  /// its own copy.  The gradient and forward/backward buffers stay
+  /// private, so several threads can each run a copy of the component
+  /// and update the shared weights in place without locks (Hogwild).
+  virtual void ShareParams(UpdatableComponent *other) {
+    KALDI_ERR << TypeToMarker(GetType())
+              << " does not support sharing its parameters (hogwild).";
+  }
+
   /// Set the training options to the component,
   virtual void SetTrainOptions(const NnetTrainOptions &opts) {
     opts_ = opts;
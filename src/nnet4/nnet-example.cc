@@ -40,46 +40,11 @@ NnetExample::NnetExample(std::string key, Matrix<BaseFloat>& feature,
 
 }
 
-void ExamplesRepository::AcceptExamples(NnetExample *example) {
-  empty_semaphore_.Wait();
-  examples_.push_back(example);
-  full_semaphore_.Signal();
-}
-
-void ExamplesRepository::ExamplesAcceptDone() {
-  done_ = true;
-}
-
-bool ExamplesRepository::ExamplesEnd(){
-
-  if(done_){
-    if(examples_.empty()){
-      return true;
-    }else{
-      return false;
-    }
-  }else{
-    return false;
-  }
-}
-
-bool ExamplesRepository::ProvideExamples(NnetExample *example) {
-  full_semaphore_.Wait();
-  if (done_) {
-    if(examples_.empty()){
-      full_semaphore_.Signal();
-      return false;
-    }else{
-      example = examples_.front();
-  	  examples_.erase(examples_.begin());
-      return true;
-    }
-  } else {
-  	example = examples_.front();
-  	examples_.erase(examples_.begin());
-    empty_semaphore_.Signal();
-    return true;
-  }
+void NnetExample::Swap(NnetExample *other) {
+  tgt_.swap(other->tgt_);
+  mat_.Swap(&other->mat_);
+  weight_.Swap(&other->weight_);
+  key_.swap(other->key_);
 }
 
 }// end of namespace nnet4
@@ -25,7 +25,7 @@
 
 #include "nnet4/nnet-nnet.h"
 #include "util/table-types.h"
-#include "util/kaldi-semaphore.h"
+#include "util/kaldi-mpmc-queue.h"
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "nnet4/nnet-randomizer.h"
@@ -46,29 +46,45 @@ struct NnetExample
 	NnetExample(){}
 
 	NnetExample(std::string key, Matrix<BaseFloat>& feature, Posterior& post, Vector<BaseFloat>& weight);
+
+	/// Exchange the contents with 'other' (no copying of the data),
+	void Swap(NnetExample *other);
+
+	/// Examples are moved (not copied) through the ExamplesRepository,
+	NnetExample(NnetExample &&other) { Swap(&other); }
+	NnetExample& operator = (NnetExample &&other) {
+		NnetExample old;  // releases our data, and leaves 'other' empty,
+		Swap(&old);
+		Swap(&other);
+		return *this;
+	}
+	NnetExample(const NnetExample &other) = default;
+	NnetExample& operator = (const NnetExample &other) = default;
 	
 };
 
+/// Hands examples from the thread that reads the data to the
+/// training threads.  It is a bounded lock-free queue, so the reader can
+/// run up to 'queue_size' utterances ahead of the trainers.
 class ExamplesRepository{
 
 public:
 
-	void AcceptExamples(NnetExample* example);
-
-	void ExamplesAcceptDone();
+	/// Called by the reader thread; takes the contents of "example"
+	/// (it is left empty).  Waits while the queue is full.
+	void AcceptExamples(NnetExample* example) { queue_.Push(example); }
 
-	bool ExamplesEnd();
+	/// Called by the reader thread when there are no more examples.
+	void ExamplesAcceptDone() { queue_.Close(); }
 
-	bool ProvideExamples(NnetExample* example);
+	/// Called by the training threads.  Waits for an example; returns false
+	/// once all examples are consumed and ExamplesAcceptDone() was called.
+	bool ProvideExamples(NnetExample* example) { return queue_.Pop(example); }
 
-	ExamplesRepository():empty_semaphore_(1),done_(false) {}
+	explicit ExamplesRepository(int32 queue_size = 1): queue_(queue_size) {}
 
 private:
-	Semaphore full_semaphore_;
-	Semaphore empty_semaphore_;
-
-	std::vector<NnetExample*> examples_;
-	bool done_;
+	MpmcQueue<NnetExample> queue_;
 
 	KALDI_DISALLOW_COPY_AND_ASSIGN(ExamplesRepository);
 };
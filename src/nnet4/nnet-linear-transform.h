@@ -45,6 +45,7 @@ class LinearTransform : public UpdatableComponent {
   ComponentType GetType() const { return kLinearTransform; }
 
   void InitData(std::istream &is) {
+    quantized_linearity_.Clear();  // it would be stale.
     // define options
     float param_stddev = 0.1;
     std::string read_matrix_file;
@@ -62,16 +63,16 @@ class LinearTransform : public UpdatableComponent {
     if (read_matrix_file != "") {  // load from file,
       bool binary;
       Input in(read_matrix_file, &binary);
-      linearity_.Read(in.Stream(), binary);
+      linearity_->Read(in.Stream(), binary);
       in.Close();
       // check dims,
-      if (OutputDim() != linearity_.NumRows() ||
-          InputDim() != linearity_.NumCols()) {
+      if (OutputDim() != linearity_->NumRows() ||
+          InputDim() != linearity_->NumCols()) {
         KALDI_ERR << "Dimensionality mismatch! Expected matrix"
                   << " r=" << OutputDim() << " c=" << InputDim()
                   << ", loaded matrix " << read_matrix_file
-                  << " with r=" << linearity_.NumRows()
-                  << " c=" << linearity_.NumCols();
+                  << " with r=" << linearity_->NumRows()
+                  << " c=" << linearity_->NumCols();
       }
       KALDI_LOG << "Loaded <LinearTransform> matrix from file : "
                 << read_matrix_file;
@@ -82,11 +83,12 @@ class LinearTransform : public UpdatableComponent {
     // Initialize trainable parameters,
     //
     // Gaussian with given std_dev (mean = 0),
-    linearity_.Resize(OutputDim(), InputDim());
-    RandGauss(0.0, param_stddev, &linearity_);
+    linearity_->Resize(OutputDim(), InputDim());
+    RandGauss(0.0, param_stddev, &(*linearity_));
   }
 
   void ReadData(std::istream &is, bool binary) {
+    quantized_linearity_.Clear();  // it would be stale.
     // Read all the '<Tokens>' in arbitrary order,
     while ('<' == Peek(is, binary)) {
       int first_char = PeekToken(is, binary);
@@ -103,21 +105,24 @@ class LinearTransform : public UpdatableComponent {
     // Read the data (data follow the tokens),
 
     // weights
-    linearity_.Read(is, binary);
+    linearity_->Read(is, binary);
 
-    KALDI_ASSERT(linearity_.NumRows() == output_dim_);
-    KALDI_ASSERT(linearity_.NumCols() == input_dim_);
+    KALDI_ASSERT(linearity_->NumRows() == output_dim_);
+    KALDI_ASSERT(linearity_->NumCols() == input_dim_);
   }
 
   void WriteData(std::ostream &os, bool binary) const {
     WriteToken(os, binary, "<LearnRateCoef>");
     WriteBasicType(os, binary, learn_rate_coef_);
     if (!binary) os << "\n";
-    linearity_.Write(os, binary);
+    if (half_linearity_.NumRows() != 0)
+      half_linearity_.Write(os, binary);
+    else
+      linearity_->Write(os, binary);
   }
 
   int32 NumParams() const {
-    return linearity_.NumRows()*linearity_.NumCols();
+    return linearity_->NumRows()*linearity_->NumCols();
   }
 
   void GetGradient(VectorBase<BaseFloat>* gradient) const {
@@ -127,23 +132,32 @@ class LinearTransform : public UpdatableComponent {
 
   void GetParams(VectorBase<BaseFloat>* params) const {
     KALDI_ASSERT(params->Dim() == NumParams());
-    params->CopyRowsFromMat(linearity_);
+    params->CopyRowsFromMat(*linearity_);
   }
 
   void SetParams(const VectorBase<BaseFloat>& params) {
+    quantized_linearity_.Clear();  // it would be stale.
     KALDI_ASSERT(params.Dim() == NumParams());
-    linearity_.CopyRowsFromVec(params);
+    linearity_->CopyRowsFromVec(params);
+  }
+
+  void ShareParams(UpdatableComponent *other) {
+    quantized_linearity_.Clear();  // it would be stale.
+    LinearTransform *o = dynamic_cast<LinearTransform*>(other);
+    KALDI_ASSERT(o != NULL && o != this && NumParams() == o->NumParams());
+    linearity_.Share(&o->linearity_);
   }
 
   void SetLinearity(const MatrixBase<BaseFloat>& l) {
-    KALDI_ASSERT(l.NumCols() == linearity_.NumCols());
-    KALDI_ASSERT(l.NumRows() == linearity_.NumRows());
-    linearity_.CopyFromMat(l);
+    KALDI_ASSERT(l.NumCols() == linearity_->NumCols());
+    KALDI_ASSERT(l.NumRows() == linearity_->NumRows());
+    linearity_->CopyFromMat(l);
+    quantized_linearity_.Clear();
   }
 
   std::string Info() const {
     return std::string("\n  linearity") +
-      MomentStatistics(linearity_) +
+      LinearityStatistics() +
       ", lr-coef " + ToString(learn_rate_coef_);
   }
   std::string InfoGradient() const {
@@ -155,7 +169,11 @@ class LinearTransform : public UpdatableComponent {
   void PropagateFnc(const CuMatrixBase<BaseFloat> &in,
                     CuMatrixBase<BaseFloat> *out) {
     // multiply by weights^t
-    out->AddMatMat(1.0, in, kNoTrans, linearity_, kTrans, 0.0);
+    if (half_linearity_.NumRows() != 0)
+      cu::AddMatHalfMat<BaseFloat>(1.0, in, half_linearity_, 0.0, out);
+    else
+      cu::AddMatQuantizedMat<BaseFloat>(1.0, in, *linearity_,
+                                        quantized_linearity_, 0.0, out);
   }
 
   void BackpropagateFnc(const CuMatrixBase<BaseFloat> &in,
@@ -163,7 +181,7 @@ class LinearTransform : public UpdatableComponent {
                         const CuMatrixBase<BaseFloat> &out_diff,
                         CuMatrixBase<BaseFloat> *in_diff) {
     // multiply error derivative by weights
-    in_diff->AddMatMat(1.0, out_diff, kNoTrans, linearity_, kNoTrans, 0.0);
+    in_diff->AddMatMat(1.0, out_diff, kNoTrans, *linearity_, kNoTrans, 0.0);
   }
 
 
@@ -180,29 +198,86 @@ class LinearTransform : public UpdatableComponent {
     linearity_corr_.AddMatMat(1.0, diff, kTrans, input, kNoTrans, mmt);
     // l2 regularization
     if (l2 != 0.0) {
-      linearity_.AddMat(-lr*l2*num_frames, linearity_);
+      linearity_->AddMat(-lr*l2*num_frames, *linearity_);
     }
     // l1 regularization
     if (l1 != 0.0) {
-      cu::RegularizeL1(&linearity_, &linearity_corr_, lr*l1*num_frames, lr);
+      cu::RegularizeL1(&(*linearity_), &linearity_corr_, lr*l1*num_frames, lr);
     }
-    // update
-    linearity_.AddMat(-lr*learn_rate_coef_, linearity_corr_);
+    // update (a quantized copy would be stale now)
+    quantized_linearity_.Clear();
+    linearity_->AddMat(-lr*learn_rate_coef_, linearity_corr_);
   }
 
   /// Accessors to the component parameters
-  const CuMatrixBase<BaseFloat>& GetLinearity() { return linearity_; }
+  const CuMatrixBase<BaseFloat>& GetLinearity() { return *linearity_; }
 
   void SetLinearity(const CuMatrixBase<BaseFloat>& linearity) {
-    KALDI_ASSERT(linearity.NumRows() == linearity_.NumRows());
-    KALDI_ASSERT(linearity.NumCols() == linearity_.NumCols());
-    linearity_.CopyFromMat(linearity);
+    KALDI_ASSERT(linearity.NumRows() == linearity_->NumRows());
+    KALDI_ASSERT(linearity.NumCols() == linearity_->NumCols());
+    linearity_->CopyFromMat(linearity);
+    quantized_linearity_.Clear();
+  }
+
+  /// Makes PropagateFnc() use an 8-bit copy of the weights on the CPU (see
+  /// AddMatQuantizedMat()), or stops it; for test-time use only, as
+  /// anything that changes the weights (training, SetParams(), ReadData()
+  /// etc.) discards the copy.
+  void SetQuantized(bool quantized) {
+    if (half_linearity_.NumRows() != 0)
+      return;  // the 16-bit weights are used instead.
+    if (quantized)
+      quantized_linearity_.CopyFromMat(Matrix<BaseFloat>(*linearity_));
+    else
+      quantized_linearity_.Clear();
+  }
+
+  /// Keeps the weights only in 16-bit floating point (see HalfMatrix), which
+  /// halves their memory, or converts them back to float; for test-time use
+  /// only, as the component can't be trained while its weights are 16-bit.
+  void SetHalfPrecision(bool half, HalfMatrixType type) {
+    quantized_linearity_.Clear();
+    if (half) {
+      if (half_linearity_.NumRows() != 0) {
+        if (half_linearity_.Type() != type)
+          KALDI_ERR << "The weights are already in "
+                    << HalfMatrixTypeName(half_linearity_.Type());
+        return;
+      }
+      if (linearity_.IsShared())
+        KALDI_ERR << "Cannot convert shared weights to 16 bits.";
+      half_linearity_.CopyFromMat(Matrix<BaseFloat>(*linearity_), type);
+      linearity_->Resize(0, 0);
+      linearity_corr_.Resize(0, 0);
+    } else if (half_linearity_.NumRows() != 0) {
+      Matrix<BaseFloat> linearity(half_linearity_.NumRows(),
+                                  half_linearity_.NumCols(), kUndefined);
+      half_linearity_.CopyToMat(&linearity);
+      half_linearity_.Clear();
+      linearity_corr_.Resize(linearity.NumRows(), linearity.NumCols());
+      linearity_->Swap(&linearity);
+    }
   }
 
   const CuMatrixBase<BaseFloat>& GetLinearityCorr() { return linearity_corr_; }
 
  private:
-  CuMatrix<BaseFloat> linearity_;
+  // The statistics of the weights, wherever they are stored.
+  std::string LinearityStatistics() const {
+    if (half_linearity_.NumRows() == 0)
+      return MomentStatistics(*linearity_);
+    Matrix<BaseFloat> linearity(half_linearity_.NumRows(),
+                                half_linearity_.NumCols(), kUndefined);
+    half_linearity_.CopyToMat(&linearity);
+    return MomentStatistics(linearity) + ", " +
+        HalfMatrixTypeName(half_linearity_.Type());
+  }
+
+  SharedParam<CuMatrix<BaseFloat> > linearity_;
+  QuantizedMatrix quantized_linearity_;  // empty unless SetQuantized(true).
+  // If SetHalfPrecision(true, ..) was called, the weights (and linearity_ is
+  // empty).
+  HalfMatrix half_linearity_;
   CuMatrix<BaseFloat> linearity_corr_;
 };
 
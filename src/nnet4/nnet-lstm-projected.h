@@ -83,21 +83,21 @@ class LstmProjected : public MultistreamComponent {
     }
 
     // init the weights and biases (from uniform dist.),
-    w_gifo_x_.Resize(4*cell_dim_, input_dim_, kUndefined);
-    w_gifo_r_.Resize(4*cell_dim_, proj_dim_, kUndefined);
-    bias_.Resize(4*cell_dim_, kUndefined);
-    peephole_i_c_.Resize(cell_dim_, kUndefined);
-    peephole_f_c_.Resize(cell_dim_, kUndefined);
-    peephole_o_c_.Resize(cell_dim_, kUndefined);
-    w_r_m_.Resize(proj_dim_, cell_dim_, kUndefined);
+    w_gifo_x_->Resize(4*cell_dim_, input_dim_, kUndefined);
+    w_gifo_r_->Resize(4*cell_dim_, proj_dim_, kUndefined);
+    bias_->Resize(4*cell_dim_, kUndefined);
+    peephole_i_c_->Resize(cell_dim_, kUndefined);
+    peephole_f_c_->Resize(cell_dim_, kUndefined);
+    peephole_o_c_->Resize(cell_dim_, kUndefined);
+    w_r_m_->Resize(proj_dim_, cell_dim_, kUndefined);
     //       (mean), (range)
-    RandUniform(0.0, 2.0 * param_range, &w_gifo_x_);
-    RandUniform(0.0, 2.0 * param_range, &w_gifo_r_);
-    RandUniform(0.0, 2.0 * param_range, &bias_);
-    RandUniform(0.0, 2.0 * param_range, &peephole_i_c_);
-    RandUniform(0.0, 2.0 * param_range, &peephole_f_c_);
-    RandUniform(0.0, 2.0 * param_range, &peephole_o_c_);
-    RandUniform(0.0, 2.0 * param_range, &w_r_m_);
+    RandUniform(0.0, 2.0 * param_range, &(*w_gifo_x_));
+    RandUniform(0.0, 2.0 * param_range, &(*w_gifo_r_));
+    RandUniform(0.0, 2.0 * param_range, &(*bias_));
+    RandUniform(0.0, 2.0 * param_range, &(*peephole_i_c_));
+    RandUniform(0.0, 2.0 * param_range, &(*peephole_f_c_));
+    RandUniform(0.0, 2.0 * param_range, &(*peephole_o_c_));
+    RandUniform(0.0, 2.0 * param_range, &(*w_r_m_));
 
     KALDI_ASSERT(cell_dim_ > 0);
     KALDI_ASSERT(learn_rate_coef_ >= 0.0);
@@ -136,15 +136,15 @@ class LstmProjected : public MultistreamComponent {
     KALDI_ASSERT(cell_dim_ != 0);
 
     // Read the model parameters,
-    w_gifo_x_.Read(is, binary);
-    w_gifo_r_.Read(is, binary);
-    bias_.Read(is, binary);
+    w_gifo_x_->Read(is, binary);
+    w_gifo_r_->Read(is, binary);
+    bias_->Read(is, binary);
 
-    peephole_i_c_.Read(is, binary);
-    peephole_f_c_.Read(is, binary);
-    peephole_o_c_.Read(is, binary);
+    peephole_i_c_->Read(is, binary);
+    peephole_f_c_->Read(is, binary);
+    peephole_o_c_->Read(is, binary);
 
-    w_r_m_.Read(is, binary);
+    w_r_m_->Read(is, binary);
   }
 
   void WriteData(std::ostream &os, bool binary) const {
@@ -167,50 +167,50 @@ class LstmProjected : public MultistreamComponent {
 
     // write model parameters,
     if (!binary) os << "\n";
-    w_gifo_x_.Write(os, binary);
-    w_gifo_r_.Write(os, binary);
-    bias_.Write(os, binary);
+    w_gifo_x_->Write(os, binary);
+    w_gifo_r_->Write(os, binary);
+    bias_->Write(os, binary);
 
-    peephole_i_c_.Write(os, binary);
-    peephole_f_c_.Write(os, binary);
-    peephole_o_c_.Write(os, binary);
+    peephole_i_c_->Write(os, binary);
+    peephole_f_c_->Write(os, binary);
+    peephole_o_c_->Write(os, binary);
 
-    w_r_m_.Write(os, binary);
+    w_r_m_->Write(os, binary);
   }
 
   int32 NumParams() const {
-    return ( w_gifo_x_.NumRows() * w_gifo_x_.NumCols() +
-         w_gifo_r_.NumRows() * w_gifo_r_.NumCols() +
-         bias_.Dim() +
-         peephole_i_c_.Dim() +
-         peephole_f_c_.Dim() +
-         peephole_o_c_.Dim() +
-         w_r_m_.NumRows() * w_r_m_.NumCols() );
+    return ( w_gifo_x_->NumRows() * w_gifo_x_->NumCols() +
+         w_gifo_r_->NumRows() * w_gifo_r_->NumCols() +
+         bias_->Dim() +
+         peephole_i_c_->Dim() +
+         peephole_f_c_->Dim() +
+         peephole_o_c_->Dim() +
+         w_r_m_->NumRows() * w_r_m_->NumCols() );
   }
 
   void GetGradient(VectorBase<BaseFloat>* gradient) const {
     KALDI_ASSERT(gradient->Dim() == NumParams());
     int32 offset, len;
 
-    offset = 0;    len = w_gifo_x_.NumRows() * w_gifo_x_.NumCols();
+    offset = 0;    len = w_gifo_x_->NumRows() * w_gifo_x_->NumCols();
     gradient->Range(offset, len).CopyRowsFromMat(w_gifo_x_corr_);
 
-    offset += len; len = w_gifo_r_.NumRows() * w_gifo_r_.NumCols();
+    offset += len; len = w_gifo_r_->NumRows() * w_gifo_r_->NumCols();
     gradient->Range(offset, len).CopyRowsFromMat(w_gifo_r_corr_);
 
-    offset += len; len = bias_.Dim();
+    offset += len; len = bias_->Dim();
     gradient->Range(offset, len).CopyFromVec(bias_corr_);
 
-    offset += len; len = peephole_i_c_.Dim();
+    offset += len; len = peephole_i_c_->Dim();
     gradient->Range(offset, len).CopyFromVec(peephole_i_c_corr_);
 
-    offset += len; len = peephole_f_c_.Dim();
+    offset += len; len = peephole_f_c_->Dim();
     gradient->Range(offset, len).CopyFromVec(peephole_f_c_corr_);
 
-    offset += len; len = peephole_o_c_.Dim();
+    offset += len; len = peephole_o_c_->Dim();
     gradient->Range(offset, len).CopyFromVec(peephole_o_c_corr_);
 
-    offset += len; len = w_r_m_.NumRows() * w_r_m_.NumCols();
+    offset += len; len = w_r_m_->NumRows() * w_r_m_->NumCols();
     gradient->Range(offset, len).CopyRowsFromMat(w_r_m_corr_);
 
     offset += len;
@@ -221,26 +221,26 @@ class LstmProjected : public MultistreamComponent {
     KALDI_ASSERT(params->Dim() == NumParams());
     int32 offset, len;
 
-    offset = 0;    len = w_gifo_x_.NumRows() * w_gifo_x_.NumCols();
-    params->Range(offset, len).CopyRowsFromMat(w_gifo_x_);
+    offset = 0;    len = w_gifo_x_->NumRows() * w_gifo_x_->NumCols();
+    params->Range(offset, len).CopyRowsFromMat(*w_gifo_x_);
 
-    offset += len; len = w_gifo_r_.NumRows() * w_gifo_r_.NumCols();
-    params->Range(offset, len).CopyRowsFromMat(w_gifo_r_);
+    offset += len; len = w_gifo_r_->NumRows() * w_gifo_r_->NumCols();
+    params->Range(offset, len).CopyRowsFromMat(*w_gifo_r_);
 
-    offset += len; len = bias_.Dim();
-    params->Range(offset, len).CopyFromVec(bias_);
+    offset += len; len = bias_->Dim();
+    params->Range(offset, len).CopyFromVec(*bias_);
 
-    offset += len; len = peephole_i_c_.Dim();
-    params->Range(offset, len).CopyFromVec(peephole_i_c_);
+    offset += len; len = peephole_i_c_->Dim();
+    params->Range(offset, len).CopyFromVec(*peephole_i_c_);
 
-    offset += len; len = peephole_f_c_.Dim();
-    params->Range(offset, len).CopyFromVec(peephole_f_c_);
+    offset += len; len = peephole_f_c_->Dim();
+    params->Range(offset, len).CopyFromVec(*peephole_f_c_);
 
-    offset += len; len = peephole_o_c_.Dim();
-    params->Range(offset, len).CopyFromVec(peephole_o_c_);
+    offset += len; len = peephole_o_c_->Dim();
+    params->Range(offset, len).CopyFromVec(*peephole_o_c_);
 
-    offset += len; len = w_r_m_.NumRows() * w_r_m_.NumCols();
-    params->Range(offset, len).CopyRowsFromMat(w_r_m_);
+    offset += len; len = w_r_m_->NumRows() * w_r_m_->NumCols();
+    params->Range(offset, len).CopyRowsFromMat(*w_r_m_);
 
     offset += len;
     KALDI_ASSERT(offset == NumParams());
@@ -250,31 +250,43 @@ class LstmProjected : public MultistreamComponent {
     KALDI_ASSERT(params.Dim() == NumParams());
     int32 offset, len;
 
-    offset = 0;    len = w_gifo_x_.NumRows() * w_gifo_x_.NumCols();
-    w_gifo_x_.CopyRowsFromVec(params.Range(offset, len));
+    offset = 0;    len = w_gifo_x_->NumRows() * w_gifo_x_->NumCols();
+    w_gifo_x_->CopyRowsFromVec(params.Range(offset, len));
 
-    offset += len; len = w_gifo_r_.NumRows() * w_gifo_r_.NumCols();
-    w_gifo_r_.CopyRowsFromVec(params.Range(offset, len));
+    offset += len; len = w_gifo_r_->NumRows() * w_gifo_r_->NumCols();
+    w_gifo_r_->CopyRowsFromVec(params.Range(offset, len));
 
-    offset += len; len = bias_.Dim();
-    bias_.CopyFromVec(params.Range(offset, len));
+    offset += len; len = bias_->Dim();
+    bias_->CopyFromVec(params.Range(offset, len));
 
-    offset += len; len = peephole_i_c_.Dim();
-    peephole_i_c_.CopyFromVec(params.Range(offset, len));
+    offset += len; len = peephole_i_c_->Dim();
+    peephole_i_c_->CopyFromVec(params.Range(offset, len));
 
-    offset += len; len = peephole_f_c_.Dim();
-    peephole_f_c_.CopyFromVec(params.Range(offset, len));
+    offset += len; len = peephole_f_c_->Dim();
+    peephole_f_c_->CopyFromVec(params.Range(offset, len));
 
-    offset += len; len = peephole_o_c_.Dim();
-    peephole_o_c_.CopyFromVec(params.Range(offset, len));
+    offset += len; len = peephole_o_c_->Dim();
+    peephole_o_c_->CopyFromVec(params.Range(offset, len));
 
-    offset += len; len = w_r_m_.NumRows() * w_r_m_.NumCols();
-    w_r_m_.CopyRowsFromVec(params.Range(offset, len));
+    offset += len; len = w_r_m_->NumRows() * w_r_m_->NumCols();
+    w_r_m_->CopyRowsFromVec(params.Range(offset, len));
 
     offset += len;
     KALDI_ASSERT(offset == NumParams());
   }
 
+  void ShareParams(UpdatableComponent *other) {
+    LstmProjected *o = dynamic_cast<LstmProjected*>(other);
+    KALDI_ASSERT(o != NULL && o != this && NumParams() == o->NumParams());
+    w_gifo_x_.Share(&o->w_gifo_x_);
+    w_gifo_r_.Share(&o->w_gifo_r_);
+    bias_.Share(&o->bias_);
+    peephole_i_c_.Share(&o->peephole_i_c_);
+    peephole_f_c_.Share(&o->peephole_f_c_);
+    peephole_o_c_.Share(&o->peephole_o_c_);
+    w_r_m_.Share(&o->w_r_m_);
+  }
+
   std::string Info() const {
     return std::string("cell-dim ") + ToString(cell_dim_) + " " +
       "( learn_rate_coef_ " + ToString(learn_rate_coef_) +
@@ -282,13 +294,13 @@ class LstmProjected : public MultistreamComponent {
       ", cell_clip_ " + ToString(cell_clip_) +
       ", diff_clip_ " + ToString(diff_clip_) +
       ", grad_clip_ " + ToString(grad_clip_) + " )" +
-      "\n  w_gifo_x_  "   + MomentStatistics(w_gifo_x_) +
-      "\n  w_gifo_r_  "   + MomentStatistics(w_gifo_r_) +
-      "\n  bias_  "     + MomentStatistics(bias_) +
-      "\n  peephole_i_c_  " + MomentStatistics(peephole_i_c_) +
-      "\n  peephole_f_c_  " + MomentStatistics(peephole_f_c_) +
-      "\n  peephole_o_c_  " + MomentStatistics(peephole_o_c_) +
-      "\n  w_r_m_  "    + MomentStatistics(w_r_m_);
+      "\n  w_gifo_x_  "   + MomentStatistics(*w_gifo_x_) +
+      "\n  w_gifo_r_  "   + MomentStatistics(*w_gifo_r_) +
+      "\n  bias_  "     + MomentStatistics(*bias_) +
+      "\n  peephole_i_c_  " + MomentStatistics(*peephole_i_c_) +
+      "\n  peephole_f_c_  " + MomentStatistics(*peephole_f_c_) +
+      "\n  peephole_o_c_  " + MomentStatistics(*peephole_o_c_) +
+      "\n  w_r_m_  "    + MomentStatistics(*w_r_m_);
   }
 
   std::string InfoGradient() const {
@@ -395,10 +407,10 @@ class LstmProjected : public MultistreamComponent {
     CuSubMatrix<BaseFloat> YGIFO(propagate_buf_.ColRange(0, 4*cell_dim_));
 
     // x -> g, i, f, o, not recurrent, do it all in once
-    YGIFO.RowRange(1*S, T*S).AddMatMat(1.0, in, kNoTrans, w_gifo_x_, kTrans, 0.0);
+    YGIFO.RowRange(1*S, T*S).AddMatMat(1.0, in, kNoTrans, *w_gifo_x_, kTrans, 0.0);
 
     // bias -> g, i, f, o
-    YGIFO.RowRange(1*S, T*S).AddVecToRows(1.0, bias_);
+    YGIFO.RowRange(1*S, T*S).AddVecToRows(1.0, *bias_);
 
     // BufferPadding [T0]:dummy, [1, T]:current sequence, [T+1]:dummy
     for (int t = 1; t <= T; t++) {
@@ -415,13 +427,13 @@ class LstmProjected : public MultistreamComponent {
       CuSubMatrix<BaseFloat> y_gifo(YGIFO.RowRange(t*S, S));
 
       // r(t-1) -> g, i, f, o
-      y_gifo.AddMatMat(1.0, YR.RowRange((t-1)*S, S), kNoTrans, w_gifo_r_, kTrans,  1.0);
+      y_gifo.AddMatMat(1.0, YR.RowRange((t-1)*S, S), kNoTrans, *w_gifo_r_, kTrans,  1.0);
 
       // c(t-1) -> i(t) via peephole
-      y_i.AddMatDiagVec(1.0, YC.RowRange((t-1)*S, S), kNoTrans, peephole_i_c_, 1.0);
+      y_i.AddMatDiagVec(1.0, YC.RowRange((t-1)*S, S), kNoTrans, *peephole_i_c_, 1.0);
 
       // c(t-1) -> f(t) via peephole
-      y_f.AddMatDiagVec(1.0, YC.RowRange((t-1)*S, S), kNoTrans, peephole_f_c_, 1.0);
+      y_f.AddMatDiagVec(1.0, YC.RowRange((t-1)*S, S), kNoTrans, *peephole_f_c_, 1.0);
 
       // i, f sigmoid squashing
       y_i.Sigmoid(y_i);
@@ -441,7 +453,7 @@ class LstmProjected : public MultistreamComponent {
       }
 
       // c(t) -> o(t) via peephole (non-recurrent, using c(t))
-      y_o.AddMatDiagVec(1.0, y_c, kNoTrans, peephole_o_c_, 1.0);
+      y_o.AddMatDiagVec(1.0, y_c, kNoTrans, *peephole_o_c_, 1.0);
 
       // o sigmoid squashing,
       y_o.Sigmoid(y_o);
@@ -453,7 +465,7 @@ class LstmProjected : public MultistreamComponent {
       y_m.AddMatMatElements(1.0, y_h, y_o, 0.0);
 
       // m -> r
-      y_r.AddMatMat(1.0, y_m, kNoTrans, w_r_m_, kTrans, 0.0);
+      y_r.AddMatMat(1.0, y_m, kNoTrans, *w_r_m_, kTrans, 0.0);
 
       // set zeros to padded frames,
       if (sequence_lengths_.size() > 0) {
@@ -533,12 +545,12 @@ class LstmProjected : public MultistreamComponent {
       // r
       //   Version 1 (precise gradients):
       //   backprop error from g(t+1), i(t+1), f(t+1), o(t+1) to r(t)
-      d_r.AddMatMat(1.0, DGIFO.RowRange((t+1)*S, S), kNoTrans, w_gifo_r_, kNoTrans, 1.0);
+      d_r.AddMatMat(1.0, DGIFO.RowRange((t+1)*S, S), kNoTrans, *w_gifo_r_, kNoTrans, 1.0);
 
       /*
       //   Version 2 (Alex Graves' PhD dissertation):
       //   only backprop g(t+1) to r(t)
-      CuSubMatrix<BaseFloat> w_g_r_(w_gifo_r_.RowRange(0, cell_dim_));
+      CuSubMatrix<BaseFloat> w_g_r_(w_gifo_r_->RowRange(0, cell_dim_));
       d_r.AddMatMat(1.0, DG.RowRange((t+1)*S,S), kNoTrans, w_g_r_, kNoTrans, 1.0);
       */
 
@@ -549,7 +561,7 @@ class LstmProjected : public MultistreamComponent {
       */
 
       // r -> m
-      d_m.AddMatMat(1.0, d_r, kNoTrans, w_r_m_, kNoTrans, 0.0);
+      d_m.AddMatMat(1.0, d_r, kNoTrans, *w_r_m_, kNoTrans, 0.0);
 
       // m -> h via output gate
       d_h.AddMatMatElements(1.0, d_m, y_o, 0.0);
@@ -567,9 +579,9 @@ class LstmProjected : public MultistreamComponent {
       // 5. diff from o(t)   (via peephole, not recurrent)
       d_c.AddMat(1.0, d_h);
       d_c.AddMatMatElements(1.0, DC.RowRange((t+1)*S, S), YF.RowRange((t+1)*S,S), 1.0);
-      d_c.AddMatDiagVec(1.0, DI.RowRange((t+1)*S, S), kNoTrans, peephole_i_c_, 1.0);
-      d_c.AddMatDiagVec(1.0, DF.RowRange((t+1)*S, S), kNoTrans, peephole_f_c_, 1.0);
-      d_c.AddMatDiagVec(1.0, d_o                    , kNoTrans, peephole_o_c_, 1.0);
+      d_c.AddMatDiagVec(1.0, DI.RowRange((t+1)*S, S), kNoTrans, *peephole_i_c_, 1.0);
+      d_c.AddMatDiagVec(1.0, DF.RowRange((t+1)*S, S), kNoTrans, *peephole_f_c_, 1.0);
+      d_c.AddMatDiagVec(1.0, d_o                    , kNoTrans, *peephole_o_c_, 1.0);
       // optionally clip the cell_derivative,
       if (cell_diff_clip_ > 0.0) {
         d_c.ApplyFloor(-cell_diff_clip_);
@@ -612,7 +624,7 @@ class LstmProjected : public MultistreamComponent {
     }
 
     // g,i,f,o -> x, calculating input derivatives,
-    in_diff->AddMatMat(1.0, DGIFO.RowRange(1*S,T*S), kNoTrans, w_gifo_x_, kNoTrans, 0.0);
+    in_diff->AddMatMat(1.0, DGIFO.RowRange(1*S,T*S), kNoTrans, *w_gifo_x_, kNoTrans, 0.0);
 
     // lazy initialization of udpate buffers,
     if (w_gifo_x_corr_.NumRows() == 0) {
@@ -674,15 +686,15 @@ class LstmProjected : public MultistreamComponent {
 
     const BaseFloat lr  = opts_.learn_rate;
 
-    w_gifo_x_.AddMat(-lr * learn_rate_coef_, w_gifo_x_corr_);
-    w_gifo_r_.AddMat(-lr * learn_rate_coef_, w_gifo_r_corr_);
-    bias_.AddVec(-lr * bias_learn_rate_coef_, bias_corr_, 1.0);
+    w_gifo_x_->AddMat(-lr * learn_rate_coef_, w_gifo_x_corr_);
+    w_gifo_r_->AddMat(-lr * learn_rate_coef_, w_gifo_r_corr_);
+    bias_->AddVec(-lr * bias_learn_rate_coef_, bias_corr_, 1.0);
 
-    peephole_i_c_.AddVec(-lr * bias_learn_rate_coef_, peephole_i_c_corr_, 1.0);
-    peephole_f_c_.AddVec(-lr * bias_learn_rate_coef_, peephole_f_c_corr_, 1.0);
-    peephole_o_c_.AddVec(-lr * bias_learn_rate_coef_, peephole_o_c_corr_, 1.0);
+    peephole_i_c_->AddVec(-lr * bias_learn_rate_coef_, peephole_i_c_corr_, 1.0);
+    peephole_f_c_->AddVec(-lr * bias_learn_rate_coef_, peephole_f_c_corr_, 1.0);
+    peephole_o_c_->AddVec(-lr * bias_learn_rate_coef_, peephole_o_c_corr_, 1.0);
 
-    w_r_m_.AddMat(-lr * learn_rate_coef_, w_r_m_corr_);
+    w_r_m_->AddMat(-lr * learn_rate_coef_, w_r_m_corr_);
   }
 
  private:
@@ -699,29 +711,29 @@ class LstmProjected : public MultistreamComponent {
   CuMatrix<BaseFloat> prev_nnet_state_;
 
   // feed-forward connections: from x to [g, i, f, o]
-  CuMatrix<BaseFloat> w_gifo_x_;
+  SharedParam<CuMatrix<BaseFloat> > w_gifo_x_;
   CuMatrix<BaseFloat> w_gifo_x_corr_;
 
   // recurrent projection connections: from r to [g, i, f, o]
-  CuMatrix<BaseFloat> w_gifo_r_;
+  SharedParam<CuMatrix<BaseFloat> > w_gifo_r_;
   CuMatrix<BaseFloat> w_gifo_r_corr_;
 
   // biases of [g, i, f, o]
-  CuVector<BaseFloat> bias_;
+  SharedParam<CuVector<BaseFloat> > bias_;
   CuVector<BaseFloat> bias_corr_;
 
   // peephole from c to i, f, g
   // peephole connections are block-internal, so we use vector form
-  CuVector<BaseFloat> peephole_i_c_;
-  CuVector<BaseFloat> peephole_f_c_;
-  CuVector<BaseFloat> peephole_o_c_;
+  SharedParam<CuVector<BaseFloat> > peephole_i_c_;
+  SharedParam<CuVector<BaseFloat> > peephole_f_c_;
+  SharedParam<CuVector<BaseFloat> > peephole_o_c_;
 
   CuVector<BaseFloat> peephole_i_c_corr_;
   CuVector<BaseFloat> peephole_f_c_corr_;
   CuVector<BaseFloat> peephole_o_c_corr_;
 
   // projection layer r: from m to r
-  CuMatrix<BaseFloat> w_r_m_;
+  SharedParam<CuMatrix<BaseFloat> > w_r_m_;
   CuMatrix<BaseFloat> w_r_m_corr_;
 
   // propagate buffer: output of [g, i, f, o, c, h, m, r]
@@ -23,6 +23,7 @@
 #include "nnet4/nnet-multibasis-component.h"
 #include "nnet4/nnet-activation.h"
 #include "nnet4/nnet-affine-transform.h"
+#include "nnet4/nnet-linear-transform.h"
 #include "nnet4/nnet-various.h"
 
 namespace kaldi {
@@ -265,6 +266,19 @@ void Nnet::SetParams(const VectorBase<BaseFloat>& params) {
   KALDI_ASSERT(pos == NumParams());
 }
 
+void Nnet::ShareParams(Nnet *other) {
+  KALDI_ASSERT(other != this && NumComponents() == other->NumComponents());
+  for (int32 i = 0; i < components_.size(); i++) {
+    if (components_[i]->IsUpdatable()) {
+      KALDI_ASSERT(components_[i]->GetType() ==
+                   other->components_[i]->GetType());
+      UpdatableComponent& c =
+        dynamic_cast<UpdatableComponent&>(*components_[i]);
+      c.ShareParams(dynamic_cast<UpdatableComponent*>(other->components_[i]));
+    }
+  }
+}
+
 void Nnet::SetDropoutRate(BaseFloat r)  {
   for (int32 c = 0; c < NumComponents(); c++) {
     if (GetComponent(c).GetType() == Component::kDropout) {
@@ -278,6 +292,40 @@ void Nnet::SetDropoutRate(BaseFloat r)  {
 }
 
 
+void Nnet::SetQuantized(bool quantized) {
+  int32 num_quantized = 0;
+  for (int32 c = 0; c < NumComponents(); c++) {
+    if (GetComponent(c).GetType() == Component::kAffineTransform) {
+      dynamic_cast<AffineTransform&>(GetComponent(c)).SetQuantized(quantized);
+      num_quantized++;
+    } else if (GetComponent(c).GetType() == Component::kLinearTransform) {
+      dynamic_cast<LinearTransform&>(GetComponent(c)).SetQuantized(quantized);
+      num_quantized++;
+    }
+  }
+  KALDI_LOG << (quantized ? "Quantized " : "Unquantized ") << num_quantized
+            << " components.";
+}
+
+
+void Nnet::SetHalfPrecision(bool half, HalfMatrixType type) {
+  int32 num_converted = 0;
+  for (int32 c = 0; c < NumComponents(); c++) {
+    if (GetComponent(c).GetType() == Component::kAffineTransform) {
+      dynamic_cast<AffineTransform&>(GetComponent(c)).SetHalfPrecision(half,
+                                                                       type);
+      num_converted++;
+    } else if (GetComponent(c).GetType() == Component::kLinearTransform) {
+      dynamic_cast<LinearTransform&>(GetComponent(c)).SetHalfPrecision(half,
+                                                                       type);
+      num_converted++;
+    }
+  }
+  KALDI_LOG << "Converted " << num_converted << " components to "
+            << (half ? HalfMatrixTypeName(type) : "float") << ".";
+}
+
+
 void Nnet::ResetStreams(const std::vector<int32> &stream_reset_flag) {
   for (int32 c = 0; c < NumComponents(); c++) {
     if (GetComponent(c).IsMultistream()) {
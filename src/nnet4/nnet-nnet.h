@@ -122,9 +122,24 @@ class Nnet {
   /// Set the network weights from a supervector,
   void SetParams(const VectorBase<BaseFloat>& params);
 
+  /// Use the trainable parameters of 'other' (an Nnet with the same
+  /// topology, which must outlive 'this') instead of our own copy, so that
+  /// several threads can train one model in place (Hogwild).  The
+  /// forward/backward buffers and gradients stay private,
+  void ShareParams(Nnet *other);
+
   /// Set the dropout rate
   void SetDropoutRate(BaseFloat r);
 
+  /// Set (or unset) the 8-bit quantized weights of the AffineTransform and
+  /// LinearTransform components, for faster CPU inference,
+  void SetQuantized(bool quantized);
+
+  /// Keep the weights of the AffineTransform and LinearTransform components
+  /// only in 16-bit floating point (or restore them to float), to halve the
+  /// memory of the model at test time,
+  void SetHalfPrecision(bool half, HalfMatrixType type);
+
   /// Reset streams in multi-stream training,
   void ResetStreams(const std::vector<int32> &stream_reset_flag);
 
@@ -21,239 +21,411 @@
 #include "nnet4/nnet-example.h"
 #include "util/kaldi-thread.h"
 #include "nnet4/nnet-loss.h"
+#include "base/timer.h"
 
 
 namespace kaldi{
 namespace nnet4{
 
-class DNNDoBackpropParallelClass: public MultiThreadable{
-
-public:
-	DNNDoBackpropParallelClass(const Nnet &nnet,
-							   ExamplesRepository* repository,
-							   NnetTrainOptions& trn_opts,
-								 LossOptions& loss_opts,
-							   NnetDataRandomizerOptions& rnd_opts,
-							   NnetParallelTrainOptions& parallel_opts,
-							   std::string target_model_filename):
-			nnet_(nnet), repository_(repository), trn_opts_(trn_opts),loss_opts_(loss_opts),
-			rnd_opts_(rnd_opts), parallel_opts_(parallel_opts),target_model_filename_(target_model_filename){}
-
-	void operator () (){
-		using namespace kaldi;
-		using namespace kaldi::nnet4;
-		typedef kaldi::int32 int32;
-
-		#if HAVE_CUDA == 1
-			CuDevice::Instantiate().AllowMultithreading();
-			CuDevice::Instantiate().SelectGpuId(parallel_opts_.use_gpu);
-		#endif
-			Nnet nnet_transf;
-			if(parallel_opts_.feature_transform !=""){
-				nnet_transf.Read(parallel_opts_.feature_transform);
-			}
-
-			CuMatrix<BaseFloat> feats_transf, nnet_out, obj_diff;
-	    RandomizerMask randomizer_mask(rnd_opts_);
-	    MatrixRandomizer feature_randomizer(rnd_opts_);
-	    PosteriorRandomizer targets_randomizer(rnd_opts_);
-	    VectorRandomizer weights_randomizer(rnd_opts_);
-    	Xent xent(loss_opts_);
-    	Mse mse(loss_opts_);
-    	MultiTaskLoss multitask(loss_opts_);
-	    if (0 == parallel_opts_.objective_function.compare(0, 9, "multitask")) {
-	      // objective_function contains something like :
-	      // 'multitask,xent,2456,1.0,mse,440,0.001'
-	      //
-	      // the meaning is following:
-	      // 'multitask,<type1>,<dim1>,<weight1>,...,<typeN>,<dimN>,<weightN>'
-	      multitask.InitFromString(parallel_opts_.objective_function);
-	    }
-		int32 num_done = 0;
-		int32 total_frames = 0;
-		while(1){
-
-			NnetExample example;
-			while(repository_->ProvideExamples(&example)){
-
-				Matrix<BaseFloat> mat = example.mat_;
-				Posterior targets = example.tgt_;
-				Vector<BaseFloat> weights = example.weight_;
-				std::string utt = example.key_;
-        // correct small length mismatch or drop sentence,
-        {
-          // add lengths to vector,
-          std::vector<int32> length;
-          length.push_back(mat.NumRows());
-          length.push_back(targets.size());
-          length.push_back(weights.Dim());
-          // find min, max,
-          int32 min = *std::min_element(length.begin(), length.end());
-          int32 max = *std::max_element(length.begin(), length.end());
-          // fix or drop ?
-          if (max - min < parallel_opts_.length_tolerance) {
-            // we truncate to shortest,
-            if (mat.NumRows() != min) mat.Resize(min, mat.NumCols(), kCopyData);
-            if (targets.size() != min) targets.resize(min);
-            if (weights.Dim() != min) weights.Resize(min, kCopyData);
-          } else {
-            KALDI_WARN << "Length mismatch! Targets " << targets.size()
-                       << ", features " << mat.NumRows() << ", " << utt;
-            continue;
+
+NnetParamStore::NnetParamStore(const Nnet &nnet, int32 num_replicas):
+    scale_(1.0 / std::max<int32>(1, num_replicas)), num_syncs_(0) {
+  params_.Resize(nnet.NumParams(), kUndefined);
+  nnet.GetParams(&params_);
+}
+
+void NnetParamStore::Sync(Vector<BaseFloat> *params,
+                          Vector<BaseFloat> *last_synced) {
+  KALDI_ASSERT(params->Dim() == params_.Dim() &&
+               last_synced->Dim() == params_.Dim());
+  // the update done by the replica since its last Sync(),
+  params->AddVec(-1.0, *last_synced);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    params_.AddVec(scale_, *params);
+    params->CopyFromVec(params_);
+    num_syncs_++;
+  }
+  last_synced->CopyFromVec(*params);
+}
+
+void NnetParamStore::GetParams(Vector<BaseFloat> *params) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  params->Resize(params_.Dim(), kUndefined);
+  params->CopyFromVec(params_);
+}
+
+
+class DNNDoBackpropParallelClass: public MultiThreadable {
+ public:
+  // 'nnets' holds one network per thread; in hogwild mode they share
+  // their parameters, in replica mode 'param_store' is used to average them.
+  DNNDoBackpropParallelClass(std::vector<Nnet*> *nnets,
+                             ExamplesRepository *repository,
+                             NnetParamStore *param_store,
+                             const LossOptions &loss_opts,
+                             const NnetDataRandomizerOptions &rnd_opts,
+                             const NnetParallelTrainOptions &parallel_opts,
+                             NnetParallelTrainStats *stats):
+      nnets_(nnets), repository_(repository), param_store_(param_store),
+      loss_opts_(loss_opts), rnd_opts_(rnd_opts),
+      parallel_opts_(parallel_opts), stats_(stats), num_done_(0),
+      total_frames_(0), num_minibatches_(0), avg_loss_(0.0),
+      time_wait_(0.0) { }
+
+  void operator () () {
+    Nnet &nnet = *((*nnets_)[thread_id_]);
+#if HAVE_CUDA == 1
+    CuDevice::Instantiate().AllowMultithreading();
+    CuDevice::Instantiate().SelectGpuId(parallel_opts_.use_gpu);
+#endif
+    Nnet nnet_transf;
+    if (parallel_opts_.feature_transform != "") {
+      nnet_transf.Read(parallel_opts_.feature_transform);
+    }
+    if (parallel_opts_.crossvalidate) {
+      nnet_transf.SetDropoutRate(0.0);
+    }
+
+    // each thread shuffles its own data differently,
+    NnetDataRandomizerOptions rnd_opts(rnd_opts_);
+    rnd_opts.randomizer_seed += thread_id_;
+
+    CuMatrix<BaseFloat> feats_transf, nnet_out, obj_diff;
+    RandomizerMask randomizer_mask(rnd_opts);
+    MatrixRandomizer feature_randomizer(rnd_opts);
+    PosteriorRandomizer targets_randomizer(rnd_opts);
+    VectorRandomizer weights_randomizer(rnd_opts);
+
+    LossOptions loss_opts(loss_opts_);
+    Xent xent(loss_opts);
+    Mse mse(loss_opts);
+    MultiTaskLoss multitask(loss_opts);
+    if (0 == parallel_opts_.objective_function.compare(0, 9, "multitask")) {
+      // objective_function contains something like :
+      // 'multitask,xent,2456,1.0,mse,440,0.001'
+      //
+      // the meaning is following:
+      // 'multitask,<type1>,<dim1>,<weight1>,...,<typeN>,<dimN>,<weightN>'
+      multitask.InitFromString(parallel_opts_.objective_function);
+    }
+
+    // the replica parameters, and the shared parameters at the last sync
+    // (not used in hogwild mode, where param_store_ is NULL),
+    Vector<BaseFloat> params, last_synced;
+    const bool sync = (!parallel_opts_.crossvalidate && param_store_ != NULL);
+    if (sync) {
+      param_store_->GetParams(&last_synced);
+      params.Resize(last_synced.Dim(), kUndefined);
+    }
+    const int32 average_interval = std::max<int32>(1,
+                                       parallel_opts_.average_interval);
+    int32 minibatches_since_sync = 0;
+
+    Timer time_wait;
+    NnetExample example;
+    bool examples_left = true;
+    while (examples_left) {
+      // fill the randomizer,
+      while (!feature_randomizer.IsFull()) {
+        time_wait.Reset();
+        examples_left = repository_->ProvideExamples(&example);
+        time_wait_ += time_wait.Elapsed();
+        if (!examples_left) break;
+        // apply feature transform (if empty, input is copied),
+        nnet_transf.Feedforward(CuMatrix<BaseFloat>(example.mat_),
+                                &feats_transf);
+        // pass data to randomizers,
+        KALDI_ASSERT(feats_transf.NumRows() == example.tgt_.size());
+        feature_randomizer.AddData(feats_transf);
+        targets_randomizer.AddData(example.tgt_);
+        weights_randomizer.AddData(example.weight_);
+        num_done_++;
+      }
+
+      // randomize,
+      if (!parallel_opts_.crossvalidate && parallel_opts_.randomize) {
+        const std::vector<int32>& mask =
+          randomizer_mask.Generate(feature_randomizer.NumFrames());
+        feature_randomizer.Randomize(mask);
+        targets_randomizer.Randomize(mask);
+        weights_randomizer.Randomize(mask);
+      }
+
+      // train with data from randomizers (using mini-batches),
+      for ( ; !feature_randomizer.Done(); feature_randomizer.Next(),
+                                          targets_randomizer.Next(),
+                                          weights_randomizer.Next()) {
+        // get block of feature/target pairs,
+        const CuMatrixBase<BaseFloat>& nnet_in = feature_randomizer.Value();
+        const Posterior& nnet_tgt = targets_randomizer.Value();
+        const Vector<BaseFloat>& frm_weights = weights_randomizer.Value();
+
+        // forward pass,
+        nnet.Propagate(nnet_in, &nnet_out);
+
+        // evaluate objective function we've chosen,
+        if (parallel_opts_.objective_function == "xent") {
+          // gradients re-scaled by weights in Eval,
+          xent.Eval(frm_weights, nnet_out, nnet_tgt, &obj_diff);
+        } else if (parallel_opts_.objective_function == "mse") {
+          // gradients re-scaled by weights in Eval,
+          mse.Eval(frm_weights, nnet_out, nnet_tgt, &obj_diff);
+        } else if (0 == parallel_opts_.objective_function.compare(0, 9,
+                                                                "multitask")) {
+          // gradients re-scaled by weights in Eval,
+          multitask.Eval(frm_weights, nnet_out, nnet_tgt, &obj_diff);
+        } else {
+          KALDI_ERR << "Unknown objective function code : "
+                    << parallel_opts_.objective_function;
+        }
+
+        if (!parallel_opts_.crossvalidate) {
+          // back-propagate, and do the update,
+          nnet.Backpropagate(obj_diff, NULL);
+          // merge our updates with the other threads,
+          if (sync && ++minibatches_since_sync == average_interval) {
+            Sync(&nnet, &params, &last_synced);
+            minibatches_since_sync = 0;
+          }
+        }
+
+        // 1st mini-batch : show what happens in network,
+        if (thread_id_ == 0 && total_frames_ == 0) {
+          KALDI_LOG << "### After " << total_frames_ << " frames,";
+          KALDI_LOG << nnet.InfoPropagate();
+          if (!parallel_opts_.crossvalidate) {
+            KALDI_LOG << nnet.InfoBackPropagate();
+            KALDI_LOG << nnet.InfoGradient();
           }
         }
+        total_frames_ += nnet_in.NumRows();
+        num_minibatches_++;
+      }
+    }
+    // hand over the updates from the last (partial) interval,
+    if (sync && minibatches_since_sync > 0) {
+      Sync(&nnet, &params, &last_synced);
+    }
 
+    if (parallel_opts_.objective_function == "xent") {
+      avg_loss_ = xent.AvgLoss();
+      KALDI_VLOG(1) << "Thread " << thread_id_ << ": " << xent.Report();
+    } else if (parallel_opts_.objective_function == "mse") {
+      avg_loss_ = mse.AvgLoss();
+      KALDI_VLOG(1) << "Thread " << thread_id_ << ": " << mse.Report();
+    } else {
+      avg_loss_ = multitask.AvgLoss();
+      KALDI_VLOG(1) << "Thread " << thread_id_ << ": " << multitask.Report();
+    }
+  }
 
-				nnet_transf.Feedforward(CuMatrix<BaseFloat>(mat), &feats_transf);
-		    // pass data to randomizers,
-		    KALDI_ASSERT(feats_transf.NumRows() == targets.size());
-		    feature_randomizer.AddData(feats_transf);
-		    targets_randomizer.AddData(targets);
-		    weights_randomizer.AddData(weights);
-		    num_done++;
-		    if (feature_randomizer.IsFull()) {
-		      // break the loop without calling Next(),
-		      // we keep the 'utt' for next round,
-		      break;
-		    }
-			}
-		  // randomize,
-		  if (!parallel_opts_.crossvalidate && parallel_opts_.randomize) {
-		      const std::vector<int32>& mask =
-		      randomizer_mask.Generate(feature_randomizer.NumFrames());
-		      feature_randomizer.Randomize(mask);
-		      targets_randomizer.Randomize(mask);
-		      weights_randomizer.Randomize(mask);
-		  }
-		  for(; !feature_randomizer.Done(); feature_randomizer.Next(),
-		    								  targets_randomizer.Next(),
-		    								  weights_randomizer.Next()){
-
-		        // get block of feature/target pairs,
-		        const CuMatrixBase<BaseFloat>& nnet_in = feature_randomizer.Value();
-		        const Posterior& nnet_tgt = targets_randomizer.Value();
-		        const Vector<BaseFloat>& frm_weights = weights_randomizer.Value();
-		        // forward pass,
-		        nnet_.Propagate(nnet_in, &nnet_out);
-
-		        // evaluate objective function we've chosen,
-		        if (parallel_opts_.objective_function == "xent") {
-		          // gradients re-scaled by weights in Eval,
-		          xent.Eval(frm_weights, nnet_out, nnet_tgt, &obj_diff);
-		        } else if (parallel_opts_.objective_function == "mse") {
-		          // gradients re-scaled by weights in Eval,
-		          mse.Eval(frm_weights, nnet_out, nnet_tgt, &obj_diff);
-		        } else if (0 == parallel_opts_.objective_function.compare(0, 9, "multitask")) {
-		          // gradients re-scaled by weights in Eval,
-		          multitask.Eval(frm_weights, nnet_out, nnet_tgt, &obj_diff);
-		        } else {
-		          KALDI_ERR << "Unknown objective function code : " << parallel_opts_.objective_function;
-		        }
-
-		        if (!parallel_opts_.crossvalidate) {
-		          // back-propagate, and do the update,
-		          nnet_.Backpropagate(obj_diff, NULL);
-		        }
-
-		        // 1st mini-batch : show what happens in network,
-		        if (total_frames == 0) {
-		          KALDI_LOG << "### After " << total_frames << " frames,";
-		          KALDI_LOG << nnet_.InfoPropagate();
-		          if (!parallel_opts_.crossvalidate) {
-		            KALDI_LOG << nnet_.InfoBackPropagate();
-		            KALDI_LOG << nnet_.InfoGradient();
-		          }
-		        }
-		        total_frames += nnet_in.NumRows();
-		  }
-
-			if(repository_->ExamplesEnd()){
-				break;
-			}
-		}
-
-
-	}
-
-~DNNDoBackpropParallelClass(){}
-
-private:
-	Nnet nnet_;
-	ExamplesRepository* repository_;
-	NnetTrainOptions trn_opts_;
-	LossOptions loss_opts_;
-	NnetDataRandomizerOptions rnd_opts_;
-	NnetParallelTrainOptions parallel_opts_;
-	std::string target_model_filename_;
+  ~DNNDoBackpropParallelClass() {
+    stats_->num_done += num_done_;
+    stats_->total_frames += total_frames_;
+    stats_->num_minibatches += num_minibatches_;
+    stats_->tot_loss += avg_loss_ * total_frames_;
+    stats_->time_wait += time_wait_;
+  }
 
+ private:
+  void Sync(Nnet *nnet, Vector<BaseFloat> *params,
+            Vector<BaseFloat> *last_synced) {
+    nnet->GetParams(params);
+    param_store_->Sync(params, last_synced);
+    nnet->SetParams(*params);
+  }
+
+  std::vector<Nnet*> *nnets_;
+  ExamplesRepository *repository_;
+  NnetParamStore *param_store_;
+  LossOptions loss_opts_;
+  NnetDataRandomizerOptions rnd_opts_;
+  NnetParallelTrainOptions parallel_opts_;
+  NnetParallelTrainStats *stats_;
+
+  // per-thread statistics,
+  int64 num_done_;
+  int64 total_frames_;
+  int64 num_minibatches_;
+  double avg_loss_;
+  double time_wait_;
 };
 
+
 void DNNDoBackpropParallel(const Nnet& nnet,
-						  SequentialBaseFloatMatrixReader& feature_reader,
-						  RandomAccessPosteriorReader& targets_reader,
-						  RandomAccessBaseFloatVectorReader& weights_reader,
-						  RandomAccessBaseFloatReader& utt_weights_reader,
-						  NnetTrainOptions& trn_opts,
-							LossOptions& loss_opts,
-						  NnetDataRandomizerOptions& rnd_opts,
-						  NnetParallelTrainOptions& parallel_opts,
-						  std::string target_model_filename){
-
-	ExamplesRepository repository;
-	int32 num_no_tgt_mat = 0;
-	int32 num_other_error = 0;
-	DNNDoBackpropParallelClass c(nnet,
-								 &repository,
-								 trn_opts,
-								 loss_opts,
-								 rnd_opts,
-								 parallel_opts,
-								 target_model_filename);
-
-		MultiThreader<DNNDoBackpropParallelClass> m(parallel_opts.num_threads, c);
-		for(; !feature_reader.Done(); feature_reader.Next()){
-					std::string utt = feature_reader.Key();
-					Matrix<BaseFloat> mat = feature_reader.Value();
-	        KALDI_VLOG(3) << "Reading " << utt;
-	        // check that we have targets,
-	        if (!targets_reader.HasKey(utt)) {
-	          KALDI_WARN << utt << ", missing targets";
-	          num_no_tgt_mat++;
-	          continue;
-	        }
-					Posterior targets = targets_reader.Value(utt);
-	        // check we have per-frame weights,
-	        if (parallel_opts.frame_weights != "" && !weights_reader.HasKey(utt)) {
-	          KALDI_WARN << utt << ", missing per-frame weights";
-	          num_other_error++;
-	          continue;
-	        }
-	        // check we have per-utterance weights,
-	        if (parallel_opts.utt_weights != "" && !utt_weights_reader.HasKey(utt)) {
-	          KALDI_WARN << utt << ", missing per-utterance weight";
-	          num_other_error++;
-	          continue;
-	        }
-	        Vector<BaseFloat> weights;
-	        if (parallel_opts.frame_weights != "") {
-	          weights = weights_reader.Value(utt);
-	        } else {  // all per-frame weights are 1.0,
-	          weights.Resize(mat.NumRows());
-	          weights.Set(1.0);
-	        }
-	        // multiply with per-utterance weight,
-	        if (parallel_opts.utt_weights != "") {
-	          BaseFloat w = utt_weights_reader.Value(utt);
-	          KALDI_ASSERT(w >= 0.0);
-	          if (w == 0.0) continue;  // remove sentence from training,
-	          weights.Scale(w);
-	        }
-					NnetExample example(utt, mat, targets, weights);
-
-					repository.AcceptExamples(&example);
-		}
-		repository.ExamplesAcceptDone();
+                           SequentialBaseFloatMatrixReader& feature_reader,
+                           RandomAccessPosteriorReader& targets_reader,
+                           RandomAccessBaseFloatVectorReader& weights_reader,
+                           RandomAccessBaseFloatReader& utt_weights_reader,
+                           NnetTrainOptions& trn_opts,
+                           LossOptions& loss_opts,
+                           NnetDataRandomizerOptions& rnd_opts,
+                           NnetParallelTrainOptions& parallel_opts,
+                           std::string target_model_filename,
+                           NnetParallelTrainStats *stats_out) {
+  Timer time;
+  KALDI_LOG << (parallel_opts.crossvalidate ? "CROSS-VALIDATION" : "TRAINING")
+            << " STARTED, with " << parallel_opts.num_threads << " threads, "
+            << parallel_opts.parallel_mode << " mode";
+
+  bool hogwild;
+  if (parallel_opts.parallel_mode == "hogwild") {
+    hogwild = true;
+  } else if (parallel_opts.parallel_mode == "replica") {
+    hogwild = false;
+  } else {
+    KALDI_ERR << "Unknown --parallel-mode " << parallel_opts.parallel_mode
+              << ", expected replica|hogwild";
+  }
+
+  ExamplesRepository repository(parallel_opts.examples_queue_size);
+  // In replica mode, the shared parameters the threads average into (a copy
+  // of the parameters, which hogwild mode doesn't need).
+  NnetParamStore *param_store = (hogwild ? NULL :
+      new NnetParamStore(nnet, parallel_opts.num_threads));
+  NnetParallelTrainStats stats;
+
+  // The networks the threads work with.  In hogwild mode they all use the
+  // parameters of 'shared_nnet', so only their buffers are per-thread
+  // (we create them one by one, to keep the peak memory low).
+  Nnet shared_nnet;
+  if (hogwild) shared_nnet = nnet;
+  std::vector<Nnet*> nnets(std::max<int32>(1, parallel_opts.num_threads));
+  for (size_t i = 0; i < nnets.size(); i++) {
+    nnets[i] = new Nnet(nnet);
+    if (hogwild) nnets[i]->ShareParams(&shared_nnet);
+  }
+  int32 num_no_tgt_mat = 0,
+        num_other_error = 0;
+
+  DNNDoBackpropParallelClass c(&nnets, &repository,
+                               param_store,
+                               loss_opts, rnd_opts, parallel_opts, &stats);
+  {
+    // The initialization of the following class spawns the threads that
+    // process the examples.  They get re-joined in its destructor.
+    MultiThreader<DNNDoBackpropParallelClass> m(parallel_opts.num_threads, c);
+
+    for (; !feature_reader.Done(); feature_reader.Next()) {
+      std::string utt = feature_reader.Key();
+      KALDI_VLOG(3) << "Reading " << utt;
+      // check that we have targets,
+      if (!targets_reader.HasKey(utt)) {
+        KALDI_WARN << utt << ", missing targets";
+        num_no_tgt_mat++;
+        continue;
+      }
+      // check we have per-frame weights,
+      if (parallel_opts.frame_weights != "" && !weights_reader.HasKey(utt)) {
+        KALDI_WARN << utt << ", missing per-frame weights";
+        num_other_error++;
+        continue;
+      }
+      // check we have per-utterance weights,
+      if (parallel_opts.utt_weights != "" && !utt_weights_reader.HasKey(utt)) {
+        KALDI_WARN << utt << ", missing per-utterance weight";
+        num_other_error++;
+        continue;
+      }
+      NnetExample example;
+      example.key_ = utt;
+      example.mat_ = feature_reader.Value();
+      example.tgt_ = targets_reader.Value(utt);
+      Matrix<BaseFloat> &mat = example.mat_;
+      Posterior &targets = example.tgt_;
+      Vector<BaseFloat> &weights = example.weight_;
+      if (parallel_opts.frame_weights != "") {
+        weights = weights_reader.Value(utt);
+      } else {  // all per-frame weights are 1.0,
+        weights.Resize(mat.NumRows());
+        weights.Set(1.0);
+      }
+      // multiply with per-utterance weight,
+      if (parallel_opts.utt_weights != "") {
+        BaseFloat w = utt_weights_reader.Value(utt);
+        KALDI_ASSERT(w >= 0.0);
+        if (w == 0.0) continue;  // remove sentence from training,
+        weights.Scale(w);
+      }
+      // skip too long utterances (or we run out of memory),
+      if (mat.NumRows() > parallel_opts.max_frames) {
+        KALDI_WARN << "Utterance too long, skipping! " << utt
+                   << " (length " << mat.NumRows() << ", max_frames "
+                   << parallel_opts.max_frames << ")";
+        num_other_error++;
+        continue;
+      }
+      // correct small length mismatch or drop sentence,
+      {
+        // add lengths to vector,
+        std::vector<int32> length;
+        length.push_back(mat.NumRows());
+        length.push_back(targets.size());
+        length.push_back(weights.Dim());
+        // find min, max,
+        int32 min = *std::min_element(length.begin(), length.end());
+        int32 max = *std::max_element(length.begin(), length.end());
+        // fix or drop ?
+        if (max - min < parallel_opts.length_tolerance) {
+          // we truncate to shortest,
+          if (mat.NumRows() != min) mat.Resize(min, mat.NumCols(), kCopyData);
+          if (targets.size() != min) targets.resize(min);
+          if (weights.Dim() != min) weights.Resize(min, kCopyData);
+        } else {
+          KALDI_WARN << "Length mismatch! Targets " << targets.size()
+                     << ", features " << mat.NumRows() << ", " << utt;
+          num_other_error++;
+          continue;
+        }
+      }
+      repository.AcceptExamples(&example);
+    }
+    repository.ExamplesAcceptDone();
+    // Here, the destructor of "m" re-joins the threads and sums their
+    // statistics into "stats".
+  }
+
+  DeletePointers(&nnets);
+
+  if (!parallel_opts.crossvalidate && target_model_filename != "") {
+    if (hogwild) {
+      shared_nnet.Write(target_model_filename, parallel_opts.binary);
+    } else {
+      Vector<BaseFloat> params;
+      param_store->GetParams(&params);
+      Nnet nnet_out(nnet);
+      nnet_out.SetParams(params);
+      nnet_out.Write(target_model_filename, parallel_opts.binary);
+    }
+  }
+
+  double elapsed = time.Elapsed();
+  stats.elapsed = elapsed;
+  KALDI_LOG << "Done " << stats.num_done << " files, "
+            << num_no_tgt_mat << " with no tgt_mats, "
+            << num_other_error << " with other errors. "
+            << "[" << (parallel_opts.crossvalidate ? "CROSS-VALIDATION"
+                                                   : "TRAINING")
+            << ", " << (parallel_opts.randomize ? "RANDOMIZED"
+                                                : "NOT-RANDOMIZED")
+            << ", " << elapsed / 60 << " min, processing "
+            << stats.total_frames / elapsed << " frames per sec;"
+            << " " << stats.num_minibatches << " mini-batches, "
+            << (hogwild ? "hogwild" : "replica") << " mode, "
+            << (hogwild ? 0 : param_store->NumSyncs()) << " model syncs;"
+            << " threads waited for data "
+            << 100.0 * stats.time_wait /
+               (elapsed * std::max<int32>(1, parallel_opts.num_threads))
+            << "% of the time]";
+  delete param_store;
 
+  // the loss averaged over all the threads (weighted by frames),
+  std::string loss_name =
+      (parallel_opts.objective_function == "xent" ? "Xent" :
+       (parallel_opts.objective_function == "mse" ? "Mse" : "MultiTaskLoss"));
+  KALDI_LOG << "AvgLoss: " << stats.AvgLoss() << " (" << loss_name << ")";
+  if (stats_out != NULL) *stats_out = stats;
 }
 
 }// end of namespace kaldi
@@ -18,6 +18,8 @@
 #define KALDI_NNET4_NNET_UPDATE_PARALLEL_H_
 
 
+#include <mutex>
+
 #include "util/table-types.h"
 #include "util/kaldi-semaphore.h"
 #include "util/kaldi-thread.h"
@@ -35,84 +37,137 @@ namespace kaldi{
 namespace nnet4{
 
 
-struct NnetParallelTrainOptions{
-
-	bool binary;
-	bool crossvalidate;
-	bool randomize;
-	std::string feature_transform;
-	std::string objective_function;
-	std::string frame_weights;
-	std::string utt_weights;
-	std::string use_gpu;
-	int32 max_frames;
-	int32 length_tolerance;
-	int32 num_threads;
-
-	NnetParallelTrainOptions():
-		binary(true),
-		crossvalidate(false),
-		randomize(true),
-		feature_transform(""),
-		objective_function("xent"),
-		frame_weights(""),
-		utt_weights(""),
-		use_gpu("yes"),
-		max_frames(360000),
-		length_tolerance(5),
-		num_threads(1)
-	{}
-
-	void Register(OptionsItf *opts){
-
-	    bool binary = true;
-	    opts->Register("binary", &binary, "Write output in binary mode");
-
-	    bool crossvalidate = false;
-	    opts->Register("cross-validate", &crossvalidate,
-	        "Perform cross-validation (don't back-propagate)");
-
-	    bool randomize = true;
-	    opts->Register("randomize", &randomize,
-	        "Perform the frame-level shuffling within the Cache::");
-
-	    std::string feature_transform;
-	    opts->Register("feature-transform", &feature_transform,
-	        "Feature transform in Nnet format");
-
-	    std::string objective_function = "xent";
-	    opts->Register("objective-function", &objective_function,
-	        "Objective function : xent|mse|multitask");
-
-	    int32 max_frames = 360000;
-	    opts->Register("max-frames", &max_frames,
-	        "Maximum number of frames an utterance can have (skipped if longer)");
-
-	    int32 length_tolerance = 5;
-	    opts->Register("length-tolerance", &length_tolerance,
-	        "Allowed length mismatch of features/targets/weights "
-	        "(in frames, we truncate to the shortest)");
-
-	    int32 num_threads = 1;
-	    opts->Register("num-threads", &num_threads,
-	    			"number of threads to training neural network");
-
-	    std::string frame_weights;
-	    opts->Register("frame-weights", &frame_weights,
-	        "Per-frame weights, used to re-scale gradients.");
-
-	    std::string utt_weights;
-	    opts->Register("utt-weights", &utt_weights,
-	        "Per-utterance weights, used to re-scale frame-weights.");
-
-	    std::string use_gpu="yes";
-	    opts->Register("use-gpu", &use_gpu,
-	        "yes|no|optional, only has effect if compiled with CUDA");
-	}
+struct NnetParallelTrainOptions {
+  bool binary;
+  bool crossvalidate;
+  bool randomize;
+  std::string feature_transform;
+  std::string objective_function;
+  std::string frame_weights;
+  std::string utt_weights;
+  std::string use_gpu;
+  int32 max_frames;
+  int32 length_tolerance;
+  int32 num_threads;
+  int32 average_interval;
+  int32 examples_queue_size;
+  std::string parallel_mode;
+
+  NnetParallelTrainOptions():
+    binary(true),
+    crossvalidate(false),
+    randomize(true),
+    feature_transform(""),
+    objective_function("xent"),
+    frame_weights(""),
+    utt_weights(""),
+    use_gpu("yes"),
+    max_frames(360000),
+    length_tolerance(5),
+    num_threads(1),
+    average_interval(16),
+    examples_queue_size(64),
+    parallel_mode("replica")
+  { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("binary", &binary, "Write output in binary mode");
+    opts->Register("cross-validate", &crossvalidate,
+        "Perform cross-validation (don't back-propagate)");
+    opts->Register("randomize", &randomize,
+        "Perform the frame-level shuffling within the Cache::");
+    opts->Register("feature-transform", &feature_transform,
+        "Feature transform in Nnet format");
+    opts->Register("objective-function", &objective_function,
+        "Objective function : xent|mse|multitask");
+    opts->Register("max-frames", &max_frames,
+        "Maximum number of frames an utterance can have (skipped if longer)");
+    opts->Register("length-tolerance", &length_tolerance,
+        "Allowed length mismatch of features/targets/weights "
+        "(in frames, we truncate to the shortest)");
+    opts->Register("num-threads", &num_threads,
+        "Number of threads to train the neural network with");
+    opts->Register("average-interval", &average_interval,
+        "Number of mini-batches each thread trains on its own model replica "
+        "before averaging its updates into the shared model");
+    opts->Register("parallel-mode", &parallel_mode,
+        "replica|hogwild. replica: each thread trains a copy of the model, "
+        "the copies are averaged every --average-interval mini-batches; "
+        "hogwild: all threads update one shared model in place, without "
+        "locks (AffineTransform, LinearTransform, LstmProjected, "
+        "BlstmProjected only)");
+    opts->Register("examples-queue-size", &examples_queue_size,
+        "Number of utterances the reading thread may read ahead of the "
+        "training threads");
+    opts->Register("frame-weights", &frame_weights,
+        "Per-frame weights, used to re-scale gradients.");
+    opts->Register("utt-weights", &utt_weights,
+        "Per-utterance weights, used to re-scale frame-weights.");
+    opts->Register("use-gpu", &use_gpu,
+        "yes|no|optional, only has effect if compiled with CUDA");
+  }
+};
+
+
+/**
+ * The shared copy of the network parameters used by the data-parallel
+ * trainer.  Each thread trains a private replica of the Nnet and every
+ * 'average_interval' mini-batches calls Sync(), which adds the change
+ * the replica made since its previous Sync(), scaled by 1/num-replicas,
+ * to the shared parameters and hands the result back to the replica.
+ * When the replicas run in lock-step this is exactly model averaging
+ * (as in nnet2/nnet3 parallel training), done asynchronously so that no
+ * thread ever waits for the others.
+ */
+class NnetParamStore {
+ public:
+  NnetParamStore(const Nnet &nnet, int32 num_replicas);
+
+  /// 'params' holds the current parameters of a replica and 'last_synced'
+  /// the parameters it received at its previous Sync().  On exit both
+  /// contain the updated shared parameters.
+  void Sync(Vector<BaseFloat> *params, Vector<BaseFloat> *last_synced);
+
+  /// Copy out the shared parameters,
+  void GetParams(Vector<BaseFloat> *params) const;
+
+  /// Number of Sync() calls so far,
+  int64 NumSyncs() const { return num_syncs_; }
+
+ private:
+  Vector<BaseFloat> params_;
+  BaseFloat scale_;  // 1 / num_replicas,
+  int64 num_syncs_;
+  mutable std::mutex mutex_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(NnetParamStore);
+};
+
 
+/// Statistics summed over the training threads (the summing is done
+/// in the destructors, which MultiThreader runs in the main thread).
+struct NnetParallelTrainStats {
+  int64 num_done;
+  int64 total_frames;
+  int64 num_minibatches;
+  double tot_loss;  ///< frame-weighted sum of the per-thread AvgLoss(),
+  double time_wait;  ///< seconds the threads spent waiting for examples,
+  double elapsed;  ///< wall-clock seconds of the whole run,
+  NnetParallelTrainStats(): num_done(0), total_frames(0), num_minibatches(0),
+                            tot_loss(0.0), time_wait(0.0), elapsed(0.0) { }
+
+  BaseFloat AvgLoss() const {
+    return (total_frames > 0 ? tot_loss / total_frames : 0.0);
+  }
+  BaseFloat FramesPerSec() const {
+    return (elapsed > 0.0 ? total_frames / elapsed : 0.0);
+  }
 };
 
 
+/// Trains 'nnet' with parallel_opts.num_threads threads, in the mode
+/// selected by parallel_opts.parallel_mode, and writes the resulting model
+/// to 'target_model_filename' (unless cross-validating, or if it is empty).
+/// The statistics of the run are returned in 'stats' if it is not NULL.
 void DNNDoBackpropParallel(const Nnet& nnet,
 						  SequentialBaseFloatMatrixReader& feature_reader,
 						  RandomAccessPosteriorReader& targets_reader,
@@ -122,7 +177,8 @@ void DNNDoBackpropParallel(const Nnet& nnet,
 						  LossOptions& loss_opts,
 						  NnetDataRandomizerOptions& rnd_opts,
 						  NnetParallelTrainOptions& parallel_opts,
-						  std::string target_model_filename);
+						  std::string target_model_filename,
+						  NnetParallelTrainStats *stats = NULL);
 
 
 
@@ -1,4 +1,4 @@
-// nnet4bin/nnet-forward.cc
+// nnet4bin/nnet-forward-parallel.cc
 
 // Copyright 2011-2013  Brno University of Technology (Author: Karel Vesely)
 
@@ -18,29 +18,247 @@
 // limitations under the License.
 
 #include <limits>
+#include <mutex>
 
 #include "nnet4/nnet-nnet.h"
 #include "nnet4/nnet-loss.h"
 #include "nnet4/nnet-pdf-prior.h"
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
+#include "util/kaldi-thread.h"
 #include "base/timer.h"
 
+namespace kaldi {
+namespace nnet4 {
+
+/// Returns true if every component of 'nnet' maps each input frame to one
+/// output frame independently of its neighbours, so that several
+/// utterances can be stacked into one matrix and propagated together
+/// (no splicing, no recurrence, no pooling over time).
+bool IsFrameLevelNnet(const Nnet &nnet) {
+  for (int32 c = 0; c < nnet.NumComponents(); c++) {
+    switch (nnet.GetComponent(c).GetType()) {
+      case Component::kAffineTransform:
+      case Component::kLinearTransform:
+      case Component::kSoftmax:
+      case Component::kBlockSoftmax:
+      case Component::kSigmoid:
+      case Component::kTanh:
+      case Component::kParametricRelu:
+      case Component::kDropout:
+      case Component::kLengthNormComponent:
+      case Component::kRbm:
+      case Component::kCopy:
+      case Component::kBlockLinearity:
+      case Component::kAddShift:
+      case Component::kRescale:
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+/// A set of copies of the network (feature transform + nnet), one for each
+/// thread that may be computing at the same time.  The components keep
+/// their propagation buffers inside, so a copy cannot be shared by two
+/// threads.
+class NnetForwardPool {
+ public:
+  NnetForwardPool(const Nnet &nnet_transf, const Nnet &nnet,
+                  int32 num_copies) {
+    KALDI_ASSERT(num_copies > 0);
+    for (int32 i = 0; i < num_copies; i++) {
+      nnet_transf_.push_back(new Nnet(nnet_transf));
+      nnet_.push_back(new Nnet(nnet));
+      free_.push_back(i);
+    }
+  }
+  ~NnetForwardPool() {
+    DeletePointers(&nnet_transf_);
+    DeletePointers(&nnet_);
+  }
+  /// Returns the index of an unused copy.  TaskSequencer never runs more
+  /// than --num-threads tasks at once, so there is always one available.
+  int32 Acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    KALDI_ASSERT(!free_.empty());
+    int32 i = free_.back();
+    free_.pop_back();
+    return i;
+  }
+  void Release(int32 i) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(i);
+  }
+  Nnet &Transf(int32 i) { return *nnet_transf_[i]; }
+  Nnet &Main(int32 i) { return *nnet_[i]; }
+
+ private:
+  std::vector<Nnet*> nnet_transf_;
+  std::vector<Nnet*> nnet_;
+  std::vector<int32> free_;
+  std::mutex mutex_;
+};
+
+struct NnetForwardOptions {
+  bool apply_log;
+  bool subtract_prior;
+  NnetForwardOptions(): apply_log(false), subtract_prior(false) { }
+};
+
+/// Forwards one batch of utterances.  The work happens in operator (),
+/// the output is written in the destructor (in input order, this is
+/// guaranteed by TaskSequencer).  If 'stack_utts' is true, the batch is
+/// propagated as a single matrix.  Both run in the worker threads, so errors
+/// are not thrown but stored in '*error' (the first one wins; the destructors
+/// run one at a time), and nothing more is written after an error; the caller
+/// reports it once the sequencer is done.
+class NnetForwardTask {
+ public:
+  NnetForwardTask(const NnetForwardOptions &opts,
+                  NnetForwardPool *pool,
+                  PdfPrior *pdf_prior,
+                  bool stack_utts,
+                  std::vector<std::string> *keys,
+                  std::vector<Matrix<BaseFloat> > *feats,
+                  BaseFloatMatrixWriter *writer,
+                  std::string *error):
+      opts_(opts), pool_(pool), pdf_prior_(pdf_prior),
+      stack_utts_(stack_utts), writer_(writer), error_(error) {
+    keys_.swap(*keys);
+    feats_.swap(*feats);
+  }
+
+  void operator () () {
+    int32 i = pool_->Acquire();
+    try {
+      Propagate(i);
+    } catch (const std::exception &e) {
+      task_error_ = e.what();
+    }
+    pool_->Release(i);
+  }
+
+  ~NnetForwardTask() {
+    if (error_->empty())
+      *error_ = task_error_;
+    if (!error_->empty())
+      return;
+    try {
+      for (size_t u = 0; u < keys_.size(); u++)
+        writer_->Write(keys_[u], outputs_[u]);
+    } catch (const std::exception &e) {
+      *error_ = e.what();
+    }
+  }
+
+ private:
+  void Propagate(int32 i) {
+    Nnet &nnet_transf = pool_->Transf(i), &nnet = pool_->Main(i);
+    outputs_.resize(feats_.size());
+    if (stack_utts_ && feats_.size() > 1) {
+      int32 num_rows = 0;
+      for (size_t u = 0; u < feats_.size(); u++)
+        num_rows += feats_[u].NumRows();
+      Matrix<BaseFloat> stacked(num_rows, feats_[0].NumCols(), kUndefined);
+      for (size_t u = 0, offset = 0; u < feats_.size(); u++) {
+        stacked.RowRange(offset, feats_[u].NumRows()).CopyFromMat(feats_[u]);
+        offset += feats_[u].NumRows();
+      }
+      Matrix<BaseFloat> stacked_out;
+      Forward(nnet_transf, &nnet, stacked, keys_[0], &stacked_out);
+      for (size_t u = 0, offset = 0; u < feats_.size(); u++) {
+        outputs_[u] = stacked_out.RowRange(offset, feats_[u].NumRows());
+        offset += feats_[u].NumRows();
+      }
+    } else {
+      for (size_t u = 0; u < feats_.size(); u++)
+        Forward(nnet_transf, &nnet, feats_[u], keys_[u], &outputs_[u]);
+    }
+    for (size_t u = 0; u < keys_.size(); u++) {
+      if (!KALDI_ISFINITE(outputs_[u].Sum())) {  // check there's no nan/inf,
+        KALDI_ERR << "NaN or inf found in final output nn-output for "
+                  << keys_[u];
+      }
+    }
+  }
+
+  void Forward(Nnet &nnet_transf, Nnet *nnet,
+               const Matrix<BaseFloat> &mat, const std::string &utt,
+               Matrix<BaseFloat> *out) {
+    CuMatrix<BaseFloat> feats(mat), feats_transf, nnet_out;
+
+    // fwd-pass, feature transform,
+    nnet_transf.Feedforward(feats, &feats_transf);
+    if (!KALDI_ISFINITE(feats_transf.Sum())) {  // check there's no nan/inf,
+      KALDI_ERR << "NaN or inf found in transformed-features for " << utt;
+    }
+
+    // fwd-pass, nnet,
+    nnet->Feedforward(feats_transf, &nnet_out);
+    if (!KALDI_ISFINITE(nnet_out.Sum())) {  // check there's no nan/inf,
+      KALDI_ERR << "NaN or inf found in nn-output for " << utt;
+    }
+
+    // convert posteriors to log-posteriors,
+    if (opts_.apply_log) {
+      if (!(nnet_out.Min() >= 0.0 && nnet_out.Max() <= 1.0)) {
+        KALDI_WARN << "Applying 'log()' to data which don't seem to be "
+                   << "probabilities," << utt;
+      }
+      nnet_out.Add(1e-20);  // avoid log(0),
+      nnet_out.ApplyLog();
+    }
+
+    // subtract log-priors from log-posteriors or pre-softmax,
+    if (opts_.subtract_prior) {
+      pdf_prior_->SubtractOnLogpost(&nnet_out);
+    }
+
+    // download from GPU,
+    out->Resize(nnet_out.NumRows(), nnet_out.NumCols(), kUndefined);
+    nnet_out.CopyToMat(out);
+  }
+
+  const NnetForwardOptions &opts_;
+  NnetForwardPool *pool_;
+  PdfPrior *pdf_prior_;  // only reads the priors, safe to share.
+  bool stack_utts_;
+  BaseFloatMatrixWriter *writer_;
+  std::string *error_;
+  std::string task_error_;  // set by operator () on failure.
+  std::vector<std::string> keys_;
+  std::vector<Matrix<BaseFloat> > feats_;
+  std::vector<Matrix<BaseFloat> > outputs_;
+};
+
+}  // namespace nnet4
+}  // namespace kaldi
+
 
 int main(int argc, char *argv[]) {
   using namespace kaldi;
   using namespace kaldi::nnet4;
   try {
     const char *usage =
-      "Perform forward pass through Neural Network.\n"
-      "Usage: nnet-forward [options] <nnet1-in> <feature-rspecifier> <feature-wspecifier>\n"
-      "e.g.: nnet-forward final.nnet ark:input.ark ark:output.ark\n";
+      "Perform forward pass through Neural Network, using multiple threads.\n"
+      "Utterances are forwarded in parallel (each thread has its own copy\n"
+      "of the network), and short utterances are stacked into batches of\n"
+      "about --batch-frames frames, if the network has no temporal context.\n"
+      "The outputs are written in the input order.\n"
+      "Usage: nnet-forward-parallel [options] <nnet1-in> <feature-rspecifier> <feature-wspecifier>\n"
+      "e.g.: nnet-forward-parallel --num-threads=8 final.nnet ark:input.ark ark:output.ark\n";
 
     ParseOptions po(usage);
 
     PdfPriorOptions prior_opts;
     prior_opts.Register(&po);
 
+    TaskSequencerConfig sequencer_config;  // has --num-threads option,
+    sequencer_config.Register(&po);
+
     std::string feature_transform;
     po.Register("feature-transform", &feature_transform,
         "Feature transform in front of main network (in nnet format)");
@@ -54,6 +272,13 @@ int main(int argc, char *argv[]) {
     bool apply_log = false;
     po.Register("apply-log", &apply_log, "Transform NN output by log()");
 
+    int32 batch_frames = 1024;
+    po.Register("batch-frames", &batch_frames,
+        "Stack consecutive utterances into one forward pass until the batch "
+        "has at least this many frames (only for networks without temporal "
+        "context: no splicing, recurrence or pooling over time). "
+        "If <= 0, each utterance is forwarded separately.");
+
     std::string use_gpu="no";
     po.Register("use-gpu", &use_gpu,
         "yes|no|optional, only has effect if compiled with CUDA");
@@ -76,6 +301,10 @@ int main(int argc, char *argv[]) {
     // Select the GPU
 #if HAVE_CUDA == 1
     CuDevice::Instantiate().SelectGpuId(use_gpu);
+    if (CuDevice::Instantiate().Enabled() && sequencer_config.num_threads > 1) {
+      KALDI_WARN << "The GPU is used, forwarding in a single thread.";
+      sequencer_config.num_threads = 1;
+    }
 #endif
 
     Nnet nnet_transf;
@@ -112,85 +341,95 @@ int main(int argc, char *argv[]) {
     nnet_transf.SetDropoutRate(0.0);
     nnet.SetDropoutRate(0.0);
 
+    // stacking utterances changes the context seen at the utterance
+    // boundaries, so it is only done for frame-level networks,
+    bool stack_utts = (batch_frames > 0 &&
+                       IsFrameLevelNnet(nnet_transf) && IsFrameLevelNnet(nnet));
+    if (batch_frames > 0 && !stack_utts) {
+      KALDI_LOG << "The network has temporal context, "
+                << "forwarding the utterances one by one.";
+    }
+
+    NnetForwardOptions forward_opts;
+    forward_opts.apply_log = apply_log;
+    forward_opts.subtract_prior = (prior_opts.class_frame_counts != "");
+
     kaldi::int64 tot_t = 0;
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
     BaseFloatMatrixWriter feature_writer(feature_wspecifier);
 
-    CuMatrix<BaseFloat> feats, feats_transf, nnet_out;
-    Matrix<BaseFloat> nnet_out_host;
-
     Timer time;
     double time_now = 0;
-    int32 num_done = 0;
-
-    // main loop,
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      // read
-      Matrix<BaseFloat> mat = feature_reader.Value();
-      std::string utt = feature_reader.Key();
-      KALDI_VLOG(2) << "Processing utterance " << num_done+1
-                    << ", " << utt
-                    << ", " << mat.NumRows() << "frm";
-
-
-      if (!KALDI_ISFINITE(mat.Sum())) {  // check there's no nan/inf,
-        KALDI_ERR << "NaN or inf found in features for " << utt;
-      }
-
-      // push it to gpu,
-      feats = mat;
-
-      // fwd-pass, feature transform,
-      nnet_transf.Feedforward(feats, &feats_transf);
-      if (!KALDI_ISFINITE(feats_transf.Sum())) {  // check there's no nan/inf,
-        KALDI_ERR << "NaN or inf found in transformed-features for " << utt;
-      }
-
-      // fwd-pass, nnet,
-      nnet.Feedforward(feats_transf, &nnet_out);
-      if (!KALDI_ISFINITE(nnet_out.Sum())) {  // check there's no nan/inf,
-        KALDI_ERR << "NaN or inf found in nn-output for " << utt;
-      }
-
-      // convert posteriors to log-posteriors,
-      if (apply_log) {
-        if (!(nnet_out.Min() >= 0.0 && nnet_out.Max() <= 1.0)) {
-          KALDI_WARN << "Applying 'log()' to data which don't seem to be "
-                     << "probabilities," << utt;
+    int32 num_done = 0, num_batches = 0;
+    std::string error;  // the first error in the worker threads.
+
+    {
+      // TaskSequencer runs the job in the main thread if num-threads is 0,
+      NnetForwardPool pool(nnet_transf, nnet,
+                           std::max(sequencer_config.num_threads, 1));
+      TaskSequencer<NnetForwardTask> sequencer(sequencer_config);
+
+      std::vector<std::string> keys;
+      std::vector<Matrix<BaseFloat> > feats;
+      int32 batch_t = 0;
+
+      // main loop,
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        // read
+        std::string utt = feature_reader.Key();
+        const Matrix<BaseFloat> &mat = feature_reader.Value();
+        KALDI_VLOG(2) << "Processing utterance " << num_done+1
+                      << ", " << utt
+                      << ", " << mat.NumRows() << "frm";
+
+        if (!KALDI_ISFINITE(mat.Sum())) {  // check there's no nan/inf,
+          KALDI_ERR << "NaN or inf found in features for " << utt;
+        }
+        if (!feats.empty() && mat.NumCols() != feats[0].NumCols()) {
+          KALDI_ERR << "Feature dimension changed at " << utt << ", "
+                    << mat.NumCols() << " vs. " << feats[0].NumCols();
         }
-        nnet_out.Add(1e-20);  // avoid log(0),
-        nnet_out.ApplyLog();
-      }
-
-      // subtract log-priors from log-posteriors or pre-softmax,
-      if (prior_opts.class_frame_counts != "") {
-        pdf_prior.SubtractOnLogpost(&nnet_out);
-      }
 
-      // download from GPU,
-      nnet_out_host = Matrix<BaseFloat>(nnet_out);
+        keys.push_back(utt);
+        feats.resize(feats.size() + 1);
+        feats.back() = mat;
+        batch_t += mat.NumRows();
+
+        if (!stack_utts || batch_t >= batch_frames) {
+          sequencer.Run(new NnetForwardTask(forward_opts, &pool, &pdf_prior,
+                                            stack_utts, &keys, &feats,
+                                            &feature_writer, &error));
+          keys.clear();
+          feats.clear();
+          batch_t = 0;
+          num_batches++;
+        }
 
-      // write,
-      if (!KALDI_ISFINITE(nnet_out_host.Sum())) {  // check there's no nan/inf,
-        KALDI_ERR << "NaN or inf found in final output nn-output for " << utt;
+        // progress log,
+        if (num_done % 100 == 0) {
+          time_now = time.Elapsed();
+          KALDI_VLOG(1) << "After " << num_done << " utterances: time elapsed = "
+                        << time_now/60 << " min; processed " << tot_t/time_now
+                        << " frames per second.";
+        }
+        num_done++;
+        tot_t += mat.NumRows();
       }
-      feature_writer.Write(feature_reader.Key(), nnet_out_host);
-
-      // progress log,
-      if (num_done % 100 == 0) {
-        time_now = time.Elapsed();
-        KALDI_VLOG(1) << "After " << num_done << " utterances: time elapsed = "
-                      << time_now/60 << " min; processed " << tot_t/time_now
-                      << " frames per second.";
+      if (!keys.empty()) {
+        sequencer.Run(new NnetForwardTask(forward_opts, &pool, &pdf_prior,
+                                          stack_utts, &keys, &feats,
+                                          &feature_writer, &error));
+        num_batches++;
       }
-      num_done++;
-      tot_t += mat.NumRows();
+      sequencer.Wait();
     }
+    if (!error.empty())
+      KALDI_ERR << "Forwarding failed: " << error;
 
     // final message,
-    KALDI_LOG << "Done " << num_done << " files"
-              << " in " << time.Elapsed()/60 << "min,"
+    KALDI_LOG << "Done " << num_done << " files in " << num_batches
+              << " batches, in " << time.Elapsed()/60 << "min,"
               << " (fps " << tot_t/time.Elapsed() << ")";
 
 #if HAVE_CUDA == 1
@@ -58,6 +58,17 @@ int main(int argc, char *argv[]) {
     po.Register("use-gpu", &use_gpu,
         "yes|no|optional, only has effect if compiled with CUDA");
 
+    std::string quantize = "";
+    po.Register("quantize", &quantize,
+        "If 'int8', multiply by 8-bit copies of the weights of the affine "
+        "and linear layers (faster on CPU, slightly less accurate)");
+
+    std::string half_precision = "";
+    po.Register("half-precision", &half_precision,
+        "If 'fp16' or 'bf16', keep the weights of the affine and linear "
+        "layers only in that 16-bit format, which halves their memory "
+        "(slightly less accurate)");
+
     using namespace kaldi;
     using namespace kaldi::nnet4;
     typedef kaldi::int32 int32;
@@ -112,6 +123,18 @@ int main(int argc, char *argv[]) {
     nnet_transf.SetDropoutRate(0.0);
     nnet.SetDropoutRate(0.0);
 
+    if (quantize == "int8") {
+      nnet.SetQuantized(true);
+    } else if (quantize != "") {
+      KALDI_ERR << "Invalid --quantize option: " << quantize;
+    }
+    if (half_precision != "") {
+      HalfMatrixType type;
+      if (!ParseHalfMatrixType(half_precision, &type))
+        KALDI_ERR << "Invalid --half-precision option: " << half_precision;
+      nnet.SetHalfPrecision(true, type);
+    }
+
     kaldi::int64 tot_t = 0;
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
@@ -50,6 +50,12 @@ int main(int argc, char *argv[]) {
     NnetParallelTrainOptions parallel_opts;
     parallel_opts.Register(&po);
 
+    bool compare_parallel_modes = false;
+    po.Register("compare-parallel-modes", &compare_parallel_modes,
+        "Train twice from <model-in>, in replica and in hogwild mode, and "
+        "compare the loss and the speed (<model-out> is written by the "
+        "mode selected with --parallel-mode)");
+
     po.Read(argc, argv);
     if (po.NumArgs() != 3 + (parallel_opts.crossvalidate ? 0 : 1)) {
       po.PrintUsage();
@@ -78,27 +84,53 @@ int main(int argc, char *argv[]) {
       nnet.SetDropoutRate(0.0);
     }
 
-    SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
-    RandomAccessPosteriorReader targets_reader(targets_rspecifier);
-    RandomAccessBaseFloatVectorReader weights_reader;
-    if (parallel_opts.frame_weights != "") {
-      weights_reader.Open(parallel_opts.frame_weights);
+    std::vector<std::string> modes;
+    if (compare_parallel_modes) {
+      modes.push_back("replica");
+      modes.push_back("hogwild");
+    } else {
+      modes.push_back(parallel_opts.parallel_mode);
     }
-    RandomAccessBaseFloatReader utt_weights_reader;
-    if (parallel_opts.utt_weights != "") {
-      utt_weights_reader.Open(parallel_opts.utt_weights);
+    std::vector<NnetParallelTrainStats> stats(modes.size());
+
+    for (size_t i = 0; i < modes.size(); i++) {
+      NnetParallelTrainOptions mode_opts(parallel_opts);
+      mode_opts.parallel_mode = modes[i];
+
+      SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+      RandomAccessPosteriorReader targets_reader(targets_rspecifier);
+      RandomAccessBaseFloatVectorReader weights_reader;
+      if (parallel_opts.frame_weights != "") {
+        weights_reader.Open(parallel_opts.frame_weights);
+      }
+      RandomAccessBaseFloatReader utt_weights_reader;
+      if (parallel_opts.utt_weights != "") {
+        utt_weights_reader.Open(parallel_opts.utt_weights);
+      }
+
+      DNNDoBackpropParallel(nnet,
+                            feature_reader,
+                            targets_reader,
+                            weights_reader,
+                            utt_weights_reader,
+                            trn_opts,
+                            loss_opts,
+                            rnd_opts,
+                            mode_opts,
+                            (modes[i] == parallel_opts.parallel_mode ?
+                             target_model_filename : ""),
+                            &stats[i]);
     }
 
-    DNNDoBackpropParallel(nnet,
-    				   feature_reader,
-    				   targets_reader,
-    				   weights_reader,
-    				   utt_weights_reader,
-    				   trn_opts,
-               loss_opts,
-    				   rnd_opts,
-    				   parallel_opts,
-    				   target_model_filename);
+    if (compare_parallel_modes) {
+      KALDI_LOG << "PARALLEL-MODE COMPARISON (" << parallel_opts.num_threads
+                << " threads):";
+      for (size_t i = 0; i < modes.size(); i++) {
+        KALDI_LOG << modes[i] << ": AvgLoss " << stats[i].AvgLoss()
+                  << ", " << stats[i].FramesPerSec() << " frames per sec, "
+                  << stats[i].num_minibatches << " mini-batches";
+      }
+    }
 
     return 0;
   } catch(const std::exception &e) {
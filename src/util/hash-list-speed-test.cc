@@ -0,0 +1,108 @@
+// util/hash-list-speed-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/timer.h"
+#include "util/hash-list.h"
+#include "util/open-hash-list.h"
+
+namespace kaldi {
+
+// Mimics how the decoders use the hash: on each frame the list of the
+// previous frame is taken with Clear(), and each of its states looks up and
+// (if absent) inserts a few successor states, whose numbers are spread over
+// [0, key_range).  (There are only num_active * num_succ distinct states, so
+// a larger key_range just spreads the keys more; the hash doesn't care about
+// the size of the graph.)  Outputs the number of elements seen in the lists
+// and the sum of their values, which only depend on the order of the lists.
+template<class HashType>
+double TimeHash(int32 key_range, int32 num_active, int32 num_succ,
+                int32 num_frames, size_t *num_elems, size_t *checksum) {
+  typedef typename HashType::Elem Elem;
+  std::vector<int32> succ(num_active * num_succ);
+  for (size_t i = 0; i < succ.size(); i++)
+    succ[i] = RandInt(0, key_range - 1);
+
+  HashType hash;
+  hash.SetSize(num_active * 2);
+  for (int32 i = 0; i < num_active; i++)
+    if (hash.Find(succ[i]) == NULL)
+      hash.Insert(succ[i], 0);
+
+  Timer timer;
+  size_t sum = 0, count = 0;
+  for (int32 f = 0; f < num_frames; f++) {
+    Elem *list = hash.Clear(), *tail;
+    hash.SetSize(num_active * 2);
+    int32 num_inserted = 0;
+    for (Elem *e = list; e != NULL; e = tail) {
+      int32 offset = (static_cast<int32>(e->key) + f) % num_active;
+      for (int32 s = 0; s < num_succ; s++) {
+        int32 state = succ[offset * num_succ + s];
+        Elem *e_found = hash.Find(state);
+        if (e_found == NULL) {
+          if (num_inserted < num_active) {  // like max-active.
+            hash.Insert(state, f);
+            num_inserted++;
+          }
+        } else {
+          e_found->val++;
+        }
+      }
+      tail = e->tail;
+      hash.Delete(e);
+    }
+    for (const Elem *e = hash.GetList(); e != NULL; e = e->tail, count++)
+      sum += e->val;
+  }
+  double ans = timer.Elapsed();
+  for (Elem *e = hash.Clear(), *tail; e != NULL; e = tail) {
+    tail = e->tail;
+    hash.Delete(e);
+  }
+  *num_elems = count;
+  *checksum = sum;
+  return ans;
+}
+
+void TestHashListSpeed() {
+  int32 num_active = 20000, num_succ = 8, num_frames = 200;
+  for (int32 i = 0; i < 2; i++) {
+    int32 key_range = (i == 0 ? 100000 : 100000000), seed = Rand();
+    size_t count1, count2, sum1, sum2;
+    srand(seed);
+    double t1 = TimeHash<HashList<int32, int32> >(
+        key_range, num_active, num_succ, num_frames, &count1, &sum1);
+    srand(seed);
+    double t2 = TimeHash<OpenHashList<int32, int32> >(
+        key_range, num_active, num_succ, num_frames, &count2, &sum2);
+    // The two must behave the same, including the order of the lists.
+    KALDI_ASSERT(count1 == count2 && sum1 == sum2);
+    double lookups = static_cast<double>(num_active) * num_succ * num_frames;
+    KALDI_LOG << "For keys in [0, " << key_range << "), lookups per second: "
+              << "HashList " << (lookups / t1) << ", OpenHashList "
+              << (lookups / t2) << " (speedup " << (t1 / t2) << ")";
+  }
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  TestHashListSpeed();
+  std::cout << "Test OK.\n";
+}
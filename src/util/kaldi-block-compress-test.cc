@@ -0,0 +1,262 @@
+// util/kaldi-block-compress-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+#include "base/kaldi-math.h"
+#include "util/kaldi-block-compress.h"
+#include "util/kaldi-io.h"
+#include "util/kaldi-table.h"
+#include "util/table-types.h"
+
+namespace kaldi {
+
+// Makes data that compresses to a varying degree: random bytes, runs of one
+// byte, and copies of earlier data.
+static void RandomData(size_t size, std::string *data) {
+  data->clear();
+  while (data->size() < size) {
+    size_t n = std::min<size_t>(size - data->size(), RandInt(1, 2000));
+    switch (RandInt(0, 2)) {
+      case 0:
+        for (size_t i = 0; i < n; i++)
+          data->push_back(static_cast<char>(RandInt(0, 255)));
+        break;
+      case 1:
+        data->append(n, static_cast<char>(RandInt(0, 255)));
+        break;
+      default:
+        if (data->empty())
+          break;
+        size_t start = RandInt(0, data->size() - 1);
+        for (size_t i = 0; i < n; i++)
+          data->push_back((*data)[start + i]);  // may overlap.
+    }
+  }
+}
+
+void UnitTestBlockCodec() {
+  for (int32 i = 0; i < 50; i++) {
+    std::string data;
+    RandomData(i == 0 ? 0 : RandInt(1, i % 5 == 0 ? 300000 : 100), &data);
+    std::vector<char> compressed(BlockCompressBound(data.size()));
+    size_t size = BlockCompress(data.data(), data.size(), compressed.data());
+    KALDI_ASSERT(size <= compressed.size());
+    std::vector<char> decompressed(data.size() + 1);
+    KALDI_ASSERT(BlockDecompress(compressed.data(), size,
+                                 decompressed.data(), data.size()));
+    KALDI_ASSERT(std::string(decompressed.data(), data.size()) == data);
+    // Wrong sizes are errors.
+    KALDI_ASSERT(!BlockDecompress(compressed.data(), size,
+                                  decompressed.data(), data.size() + 1));
+    if (!data.empty())
+      KALDI_ASSERT(!BlockDecompress(compressed.data(), size - 1,
+                                    decompressed.data(), data.size()));
+    // Corrupt data must not make it crash.
+    for (int32 j = 0; j < 10 && size != 0; j++) {
+      std::vector<char> corrupt(compressed.begin(), compressed.begin() + size);
+      corrupt[RandInt(0, size - 1)] = static_cast<char>(RandInt(0, 255));
+      BlockDecompress(corrupt.data(), size, decompressed.data(), data.size());
+    }
+  }
+  // Data that compresses well should compress well.
+  std::string data(100000, 'a');
+  std::vector<char> compressed(BlockCompressBound(data.size()));
+  KALDI_ASSERT(BlockCompress(data.data(), data.size(), compressed.data()) <
+               1000);
+}
+
+void UnitTestBlockCompressedFile() {
+  KALDI_ASSERT(IsBlockCompressedFilename("foo.ark.z") &&
+               IsBlockCompressedFilename("foo.ark.z:1234") &&
+               !IsBlockCompressedFilename("foo.ark") &&
+               !IsBlockCompressedFilename("foo.ark:1234") &&
+               !IsBlockCompressedFilename("gunzip -c foo.z|") &&
+               !IsBlockCompressedFilename("z"));
+  for (int32 i = 0; i < 4; i++) {
+    std::string data;
+    RandomData(RandInt(0, 3 * kBlockCompressedBlockSize), &data);
+    {
+      Output ko("tmpf.z", true, false);
+      for (size_t pos = 0; pos < data.size(); ) {
+        KALDI_ASSERT(ko.Stream().tellp() == std::streampos(pos));
+        size_t n = std::min<size_t>(data.size() - pos, RandInt(1, 100000));
+        ko.Stream().write(data.data() + pos, n);
+        pos += n;
+        if (RandInt(0, 4) == 0)
+          ko.Stream().flush();  // ends the block.
+      }
+      KALDI_ASSERT(ko.Close());
+    }
+    {
+      Input ki("tmpf.z");
+      std::string contents((std::istreambuf_iterator<char>(ki.Stream())),
+                           std::istreambuf_iterator<char>());
+      KALDI_ASSERT(contents == data);
+    }
+    for (int32 pass = 0; pass < 2; pass++) {
+      if (pass == 1) {
+        // Cut off the index, as if the writer had died; it should still be
+        // possible to read the data, and to seek in it.
+        std::ifstream is("tmpf.z", std::ios::binary);
+        std::string contents((std::istreambuf_iterator<char>(is)),
+                             std::istreambuf_iterator<char>());
+        std::ofstream os("tmpf.z", std::ios::binary | std::ios::trunc);
+        os.write(contents.data(), contents.size() - 40);
+      }
+      Input ki;
+      for (int32 j = 0; j < 20; j++) {
+        size_t offset = RandInt(0, data.size()),
+            n = std::min<size_t>(data.size() - offset, RandInt(0, 100000));
+        std::ostringstream rxfilename;
+        rxfilename << "tmpf.z:" << offset;
+        KALDI_ASSERT(ki.Open(rxfilename.str()));
+        std::string contents(n, '\0');
+        if (n > 0)
+          ki.Stream().read(&(contents[0]), n);
+        KALDI_ASSERT(ki.Stream().good() &&
+                     contents == data.substr(offset, n));
+        KALDI_ASSERT(ki.Stream().tellg() == std::streampos(offset + n));
+        if (j % 5 == 0) {
+          ki.Stream().seekg(0, std::ios::end);
+          KALDI_ASSERT(ki.Stream().tellg() == std::streampos(data.size()) &&
+                       ki.Stream().peek() == EOF);
+        }
+      }
+      std::ostringstream rxfilename;
+      rxfilename << "tmpf.z:" << (data.size() + 1);
+      KALDI_ASSERT(!ki.Open(rxfilename.str()));
+    }
+  }
+  // A file that is not block-compressed.
+  {
+    std::ofstream os("tmpf.z");
+    os << "hello\n";
+  }
+  Input ki;
+  KALDI_ASSERT(!ki.Open("tmpf.z"));
+  unlink("tmpf.z");
+}
+
+// A token that straddles a block boundary; PeekToken() has to unget() the
+// '<' from the end of the previous block.
+void UnitTestBlockCompressedUnget() {
+  {
+    Output ko("tmpf.z", false, false);
+    ko.Stream() << std::string(kBlockCompressedBlockSize - 1, ' ')
+                << "<Foo> <Bar> ";
+    KALDI_ASSERT(ko.Close());
+  }
+  for (int32 i = 0; i < 3; i++) {
+    // Sequentially, and from offsets in the first and the second block.
+    std::ostringstream rxfilename;
+    rxfilename << "tmpf.z";
+    if (i > 0)
+      rxfilename << ':' << (kBlockCompressedBlockSize - 2 + i);
+    Input ki(rxfilename.str());
+    std::istream &is = ki.Stream();
+    if (i == 2) {
+      // We went straight to the second block, so the '<' is not there yet.
+      KALDI_ASSERT(is.unget() && is.peek() == '<');
+    }
+    KALDI_ASSERT(PeekToken(is, false) == 'F');
+    std::string token;
+    ReadToken(is, false, &token);
+    KALDI_ASSERT(token == "<Foo>");
+    KALDI_ASSERT(PeekToken(is, false) == 'B');
+    ExpectToken(is, false, "<Bar>");
+    KALDI_ASSERT(is.good() && is.peek() == EOF);
+  }
+  unlink("tmpf.z");
+}
+
+void UnitTestBlockCompressedTable(bool binary) {
+  int32 sz = RandInt(0, 300);
+  std::vector<std::string> k(sz);
+  std::vector<std::vector<int32> > v(sz);
+  for (int32 i = 0; i < sz; i++) {
+    std::ostringstream key;
+    key << "key" << i;
+    k[i] = key.str();
+    v[i].resize(RandInt(0, 2000));
+    for (size_t j = 0; j < v[i].size(); j++)
+      v[i][j] = RandInt(0, 100);
+  }
+  {
+    Int32VectorWriter writer(std::string(binary ? "ark,scp,b,idx" :
+                                         "ark,scp,t,idx") +
+                             ":tmpf.ark.z,tmpf.scp");
+    for (int32 i = 0; i < sz; i++)
+      writer.Write(k[i], v[i]);
+    KALDI_ASSERT(writer.Close());
+  }
+  {
+    SequentialInt32VectorReader reader("ark:tmpf.ark.z");
+    for (int32 i = 0; i < sz; i++, reader.Next())
+      KALDI_ASSERT(!reader.Done() && reader.Key() == k[i] &&
+                   reader.Value() == v[i]);
+    KALDI_ASSERT(reader.Done() && reader.Close());
+  }
+  {
+    // Read the scp entries, which are like tmpf.ark.z:1234, in a random
+    // order.
+    std::vector<std::pair<std::string, std::string> > script;
+    KALDI_ASSERT(ReadScriptFile("tmpf.scp", true, &script) &&
+                 static_cast<int32>(script.size()) == sz);
+    std::vector<int32> order(sz);
+    for (int32 i = 0; i < sz; i++) order[i] = i;
+    for (int32 i = sz - 1; i > 0; i--)
+      std::swap(order[i], order[RandInt(0, i)]);
+    {
+      Output ko("tmpf2.scp", false);
+      for (int32 i = 0; i < sz; i++)
+        ko.Stream() << script[order[i]].first << ' '
+                    << script[order[i]].second << '\n';
+    }
+    SequentialInt32VectorReader reader("scp:tmpf2.scp");
+    for (int32 i = 0; i < sz; i++, reader.Next())
+      KALDI_ASSERT(!reader.Done() && reader.Key() == k[order[i]] &&
+                   reader.Value() == v[order[i]]);
+    KALDI_ASSERT(reader.Done() && reader.Close());
+  }
+  {
+    ArchiveIndex index;
+    KALDI_ASSERT(index.Read("tmpf.ark.z") && index.NumKeys() == sz);
+    RandomAccessInt32VectorReader reader("ark:tmpf.ark.z");
+    for (int32 n = 0; n < 20 && sz != 0; n++) {
+      int32 i = RandInt(0, sz - 1);
+      KALDI_ASSERT(reader.HasKey(k[i]) && reader.Value(k[i]) == v[i]);
+    }
+    KALDI_ASSERT(!reader.HasKey("foo"));
+  }
+  unlink("tmpf.ark.z");
+  unlink("tmpf.ark.z.idx");
+  unlink("tmpf.scp");
+  unlink("tmpf2.scp");
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestBlockCodec();
+  UnitTestBlockCompressedFile();
+  UnitTestBlockCompressedUnget();
+  for (int32 i = 0; i < 2; i++)
+    UnitTestBlockCompressedTable(i == 0);
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,798 @@
+// util/kaldi-block-compress.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/kaldi-block-compress.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "util/kaldi-io.h"
+#include "util/kaldi-thread.h"
+
+namespace kaldi {
+
+bool IsBlockCompressedFilename(const std::string &rxfilename) {
+  InputType type = ClassifyRxfilename(rxfilename);
+  if (type != kFileInput && type != kOffsetFileInput)
+    return false;
+  size_t end = rxfilename.size();
+  if (type == kOffsetFileInput)
+    end = rxfilename.find_last_of(':');
+  return end >= 2 && rxfilename.compare(end - 2, 2, ".z") == 0;
+}
+
+
+// The codec.  A compressed block is a sequence of (literals, match) pairs,
+// each starting with a token byte whose high 4 bits are the number of
+// literals and whose low 4 bits are the match length minus kMinMatch; the
+// value 15 means that more length bytes follow, each added to it, until one
+// that is not 255.  Then come the literals, then the match offset (the
+// distance back into the output, as 2 bytes, low byte first), then any more
+// match length bytes.  The last pair has only literals, and ends the block.
+
+static const size_t kMinMatch = 4;
+static const size_t kMaxOffset = 65535;
+static const int32 kHashBits = 14;
+
+static inline uint32 Load32(const char *p) {
+  uint32 ans;
+  memcpy(&ans, p, sizeof(ans));
+  return ans;
+}
+
+static inline uint64 Load64(const char *p) {
+  uint64 ans;
+  memcpy(&ans, p, sizeof(ans));
+  return ans;
+}
+
+static inline uint32 HashSequence(uint32 sequence) {
+  return (sequence * 2654435761U) >> (32 - kHashBits);
+}
+
+static inline char *WriteLength(size_t length, char *dest) {
+  for (; length >= 255; length -= 255)
+    *(dest++) = static_cast<char>(255);
+  *(dest++) = static_cast<char>(length);
+  return dest;
+}
+
+// Writes the literals, and the match if match_length != 0.
+static char *WriteSequence(const char *literals, size_t num_literals,
+                           size_t match_offset, size_t match_length,
+                           char *dest) {
+  size_t extra_length = (match_length != 0 ? match_length - kMinMatch : 0);
+  *(dest++) = static_cast<char>((std::min<size_t>(num_literals, 15) << 4) |
+                                std::min<size_t>(extra_length, 15));
+  if (num_literals >= 15)
+    dest = WriteLength(num_literals - 15, dest);
+  memcpy(dest, literals, num_literals);
+  dest += num_literals;
+  if (match_length != 0) {
+    *(dest++) = static_cast<char>(match_offset & 255);
+    *(dest++) = static_cast<char>(match_offset >> 8);
+    if (extra_length >= 15)
+      dest = WriteLength(extra_length - 15, dest);
+  }
+  return dest;
+}
+
+size_t BlockCompress(const char *src, size_t size, char *dest) {
+  // Positions of recent 4-byte sequences, by hash value; entries that are out
+  // of date are caught by comparing the data.
+  std::vector<uint32> table(1 << kHashBits, 0);
+  char *d = dest;
+  size_t anchor = 0, pos = 0;  // anchor is the start of the pending literals.
+  while (pos + kMinMatch <= size) {
+    uint32 sequence = Load32(src + pos);
+    uint32 &entry = table[HashSequence(sequence)];
+    size_t match = entry;
+    entry = pos;
+    if (match >= pos || pos - match > kMaxOffset ||
+        Load32(src + match) != sequence) {
+      // No match; skip ahead faster the longer we go without one, so
+      // incompressible data does not take long.
+      pos += 1 + ((pos - anchor) >> 6);
+      continue;
+    }
+    size_t length = kMinMatch;
+    while (pos + length + 8 <= size &&
+           Load64(src + pos + length) == Load64(src + match + length))
+      length += 8;
+    while (pos + length < size && src[pos + length] == src[match + length])
+      length++;
+    while (pos > anchor && match > 0 && src[pos - 1] == src[match - 1]) {
+      pos--;
+      match--;
+      length++;
+    }
+    d = WriteSequence(src + anchor, pos - anchor, pos - match, length, d);
+    pos += length;
+    anchor = pos;
+    if (pos + 2 <= size)  // Helps to find the next match.
+      table[HashSequence(Load32(src + pos - 2))] = pos - 2;
+  }
+  d = WriteSequence(src + anchor, size - anchor, 0, 0, d);
+  KALDI_ASSERT(static_cast<size_t>(d - dest) <= BlockCompressBound(size));
+  return d - dest;
+}
+
+static inline bool ReadLength(const unsigned char **src,
+                              const unsigned char *end, size_t *length) {
+  unsigned char c;
+  do {
+    if (*src == end || *length > std::numeric_limits<uint32>::max())
+      return false;
+    c = *((*src)++);
+    *length += c;
+  } while (c == 255);
+  return true;
+}
+
+bool BlockDecompress(const char *src, size_t size, char *dest,
+                     size_t dest_size) {
+  const unsigned char *s = reinterpret_cast<const unsigned char*>(src),
+      *s_end = s + size;
+  char *d = dest, *d_end = dest + dest_size;
+  while (true) {
+    if (s == s_end)
+      return false;  // Missing the last sequence.
+    unsigned char token = *(s++);
+    size_t num_literals = token >> 4;
+    if (num_literals == 15 && !ReadLength(&s, s_end, &num_literals))
+      return false;
+    if (num_literals > static_cast<size_t>(s_end - s) ||
+        num_literals > static_cast<size_t>(d_end - d))
+      return false;
+    memcpy(d, s, num_literals);
+    d += num_literals;
+    s += num_literals;
+    if (s == s_end)  // The last sequence, which has no match.
+      return d == d_end;
+    if (s_end - s < 2)
+      return false;
+    size_t offset = s[0] | (static_cast<size_t>(s[1]) << 8),
+        length = token & 15;
+    s += 2;
+    if (length == 15 && !ReadLength(&s, s_end, &length))
+      return false;
+    length += kMinMatch;
+    if (offset == 0 || offset > static_cast<size_t>(d - dest) ||
+        length > static_cast<size_t>(d_end - d))
+      return false;
+    // The match may overlap the output, e.g. for a run of the same byte;
+    // copy it in pieces that don't overlap, which grow as we go.
+    const char *match = d - offset;
+    while (length > 0) {
+      size_t n = std::min<size_t>(length, d - match);
+      memcpy(d, match, n);
+      d += n;
+      length -= n;
+    }
+  }
+}
+
+
+// The file format; see kaldi-block-compress.h.
+static const char kFileMagic[4] = { 'K', 'B', 'Z', '1' };
+static const char kFooterMagic[8] = { 'K', 'B', 'Z', 'I', 'N', 'D', 'E', 'X' };
+static const size_t kFileHeaderSize = 8;
+static const size_t kBlockHeaderSize = 12;
+static const size_t kIndexEntrySize = 16;
+static const size_t kFooterSize = 32;
+enum {
+  kStoredBlock = 0,
+  kCompressedBlock = 1,
+  kEndMarker = 2
+};
+// Blocks bigger than this are taken to mean that the file is corrupt.
+static const uint32 kMaxBlockSize = 1 << 28;
+
+static inline void WriteUint32(uint32 value, char *dest) {
+  memcpy(dest, &value, sizeof(value));
+}
+
+static inline void WriteInt64(int64 value, char *dest) {
+  memcpy(dest, &value, sizeof(value));
+}
+
+static inline int64 ReadInt64(const char *src) {
+  int64 ans;
+  memcpy(&ans, src, sizeof(ans));
+  return ans;
+}
+
+
+BlockCompressedOutputStreambuf::BlockCompressedOutputStreambuf():
+    ok_(false), file_offset_(0), offset_(0) { }
+
+bool BlockCompressedOutputStreambuf::Open(const std::string &filename) {
+  if (IsOpen())
+    KALDI_ERR << "BlockCompressedOutputStreambuf::Open(), already open.";
+  if (file_.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc |
+                 std::ios_base::binary) == NULL)
+    return false;
+  ok_ = true;
+  file_offset_ = 0;
+  offset_ = 0;
+  index_.clear();
+  buffer_.resize(kBlockCompressedBlockSize);
+  compressed_.resize(kBlockHeaderSize +
+                     BlockCompressBound(kBlockCompressedBlockSize));
+  setp(buffer_.data(), buffer_.data() + buffer_.size());
+  char header[kFileHeaderSize];
+  memcpy(header, kFileMagic, sizeof(kFileMagic));
+  WriteUint32(kBlockCompressedBlockSize, header + sizeof(kFileMagic));
+  return WriteBytes(header, kFileHeaderSize);
+}
+
+bool BlockCompressedOutputStreambuf::WriteBytes(const char *data,
+                                                size_t size) {
+  if (ok_ && file_.sputn(data, size) != static_cast<std::streamsize>(size))
+    ok_ = false;
+  file_offset_ += size;
+  return ok_;
+}
+
+bool BlockCompressedOutputStreambuf::WriteBlock() {
+  size_t size = pptr() - pbase();
+  if (size == 0)
+    return ok_;
+  char *stored = compressed_.data() + kBlockHeaderSize;
+  size_t stored_size = BlockCompress(pbase(), size, stored);
+  uint32 method = kCompressedBlock;
+  if (stored_size >= size) {  // Not worth it.
+    memcpy(stored, pbase(), size);
+    stored_size = size;
+    method = kStoredBlock;
+  }
+  WriteUint32(stored_size, compressed_.data());
+  WriteUint32(size, compressed_.data() + 4);
+  WriteUint32(method, compressed_.data() + 8);
+  index_.push_back(std::make_pair(offset_, file_offset_));
+  offset_ += size;
+  setp(buffer_.data(), buffer_.data() + buffer_.size());
+  return WriteBytes(compressed_.data(), kBlockHeaderSize + stored_size);
+}
+
+BlockCompressedOutputStreambuf::int_type
+BlockCompressedOutputStreambuf::overflow(int_type c) {
+  if (!IsOpen() || !WriteBlock())
+    return traits_type::eof();
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+int BlockCompressedOutputStreambuf::sync() {
+  if (!IsOpen() || !WriteBlock() || file_.pubsync() != 0)
+    return -1;
+  return 0;
+}
+
+BlockCompressedOutputStreambuf::pos_type
+BlockCompressedOutputStreambuf::seekoff(off_type off,
+                                        std::ios_base::seekdir dir,
+                                        std::ios_base::openmode which) {
+  // We only support tellp().
+  if ((which & std::ios_base::out) && dir == std::ios_base::cur && off == 0)
+    return pos_type(offset_ + (pptr() - pbase()));
+  return pos_type(off_type(-1));
+}
+
+bool BlockCompressedOutputStreambuf::Close() {
+  if (!IsOpen())
+    KALDI_ERR << "BlockCompressedOutputStreambuf::Close(), not open.";
+  WriteBlock();
+  std::vector<char> end(kBlockHeaderSize + index_.size() * kIndexEntrySize +
+                        kFooterSize);
+  char *p = end.data();
+  WriteUint32(index_.size() * kIndexEntrySize, p);
+  WriteUint32(0, p + 4);
+  WriteUint32(kEndMarker, p + 8);
+  p += kBlockHeaderSize;
+  int64 index_file_offset = file_offset_ + kBlockHeaderSize;
+  for (size_t i = 0; i < index_.size(); i++, p += kIndexEntrySize) {
+    WriteInt64(index_[i].first, p);
+    WriteInt64(index_[i].second, p + 8);
+  }
+  WriteInt64(index_file_offset, p);
+  WriteInt64(index_.size(), p + 8);
+  WriteInt64(offset_, p + 16);
+  memcpy(p + 24, kFooterMagic, sizeof(kFooterMagic));
+  WriteBytes(end.data(), end.size());
+  if (file_.close() == NULL)
+    ok_ = false;
+  setp(NULL, NULL);
+  return ok_;
+}
+
+BlockCompressedOutputStreambuf::~BlockCompressedOutputStreambuf() {
+  if (IsOpen())
+    Close();  // The caller will have checked for errors if it cared.
+}
+
+
+BlockCompressedInputStreambuf::BlockCompressedInputStreambuf():
+    file_pos_(0), block_size_(0), next_file_offset_(0), next_offset_(0),
+    at_end_(false), error_(false), have_index_(false), total_size_(0),
+    current_(NULL), current_offset_(0), depth_(0), stop_(false) {
+  int32 num_cpus = static_cast<int32>(std::thread::hardware_concurrency());
+  num_threads_ = std::max(1, std::min(g_num_threads,
+                                      num_cpus > 0 ? num_cpus : 1));
+}
+
+bool BlockCompressedInputStreambuf::Open(const std::string &filename) {
+  Close();
+  if (file_.open(filename.c_str(),
+                 std::ios_base::in | std::ios_base::binary) == NULL) {
+    KALDI_WARN << "Could not open " << filename << " for reading";
+    return false;
+  }
+  filename_ = filename;
+  file_pos_ = 0;
+  char header[kFileHeaderSize];
+  if (!ReadBytes(0, header, kFileHeaderSize) ||
+      memcmp(header, kFileMagic, sizeof(kFileMagic)) != 0) {
+    KALDI_WARN << filename << " is not a block-compressed file";
+    file_.close();
+    return false;
+  }
+  memcpy(&block_size_, header + sizeof(kFileMagic), sizeof(block_size_));
+  if (block_size_ == 0 || block_size_ > kMaxBlockSize) {
+    KALDI_WARN << "Bad block size " << block_size_ << " in " << filename;
+    file_.close();
+    return false;
+  }
+  next_file_offset_ = kFileHeaderSize;
+  next_offset_ = 0;
+  current_offset_ = 0;
+  at_end_ = false;
+  error_ = false;
+  depth_ = 0;
+  return true;
+}
+
+bool BlockCompressedInputStreambuf::ReadBytes(int64 file_offset, char *data,
+                                              size_t size) {
+  if (file_pos_ != file_offset) {
+    if (file_.pubseekpos(file_offset, std::ios_base::in) !=
+        pos_type(file_offset)) {
+      file_pos_ = -1;  // Unknown.
+      return false;
+    }
+    file_pos_ = file_offset;
+  }
+  std::streamsize n = file_.sgetn(data, size);
+  file_pos_ += n;
+  return n == static_cast<std::streamsize>(size);
+}
+
+BlockCompressedInputStreambuf::Block*
+BlockCompressedInputStreambuf::ReadBlock() {
+  if (at_end_ || error_)
+    return NULL;
+  char header[kBlockHeaderSize];
+  if (!ReadBytes(next_file_offset_, header, kBlockHeaderSize)) {
+    KALDI_WARN << "Block-compressed file " << filename_ << " ends "
+               << "unexpectedly (not closed properly?)";
+    error_ = true;
+    return NULL;
+  }
+  uint32 stored_size, size, method;
+  memcpy(&stored_size, header, 4);
+  memcpy(&size, header + 4, 4);
+  memcpy(&method, header + 8, 4);
+  if (method == kEndMarker) {
+    at_end_ = true;
+    return NULL;
+  }
+  if ((method != kStoredBlock && method != kCompressedBlock) || size == 0 ||
+      size > block_size_ || stored_size == 0 ||
+      stored_size > BlockCompressBound(block_size_) ||
+      (method == kStoredBlock && stored_size != size)) {
+    KALDI_WARN << "Corrupt block header at byte " << next_file_offset_
+               << " of " << filename_;
+    error_ = true;
+    return NULL;
+  }
+  Block *block;
+  if (free_blocks_.empty()) {
+    block = new Block();
+  } else {
+    block = free_blocks_.back();
+    free_blocks_.pop_back();
+  }
+  block->offset = next_offset_;
+  block->size = size;
+  block->method = method;
+  block->done = false;
+  block->ok = false;
+  // The first byte is spare, so that a stored block can become 'data' as it
+  // is (see Block::data).
+  block->stored.resize(stored_size + 1);
+  if (!ReadBytes(next_file_offset_ + kBlockHeaderSize,
+                 block->stored.data() + 1, stored_size)) {
+    KALDI_WARN << "Block-compressed file " << filename_ << " ends "
+               << "unexpectedly (not closed properly?)";
+    FreeBlock(block);
+    error_ = true;
+    return NULL;
+  }
+  next_file_offset_ += kBlockHeaderSize + stored_size;
+  next_offset_ += size;
+  return block;
+}
+
+void BlockCompressedInputStreambuf::Decompress(Block *block) {
+  if (block->method == kStoredBlock) {
+    block->data.swap(block->stored);
+    block->ok = true;
+  } else {
+    block->data.resize(block->size + 1);
+    block->ok = BlockDecompress(block->stored.data() + 1,
+                                block->stored.size() - 1,
+                                block->data.data() + 1, block->size);
+  }
+}
+
+void BlockCompressedInputStreambuf::FreeBlock(Block *block) {
+  free_blocks_.push_back(block);
+}
+
+void BlockCompressedInputStreambuf::RunThread() {
+  while (true) {
+    Block *block;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (queue_.empty() && !stop_)
+        queued_cond_.wait(lock);
+      if (stop_)
+        return;
+      block = queue_.front();
+      queue_.pop_front();
+    }
+    Decompress(block);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      block->done = true;
+    }
+    done_cond_.notify_all();
+  }
+}
+
+void BlockCompressedInputStreambuf::ReadAhead() {
+  while (static_cast<int32>(pending_.size()) < depth_) {
+    Block *block = ReadBlock();
+    if (block == NULL)
+      return;  // Any error will be found when we get to that point.
+    while (static_cast<int32>(threads_.size()) <
+           std::min(depth_, num_threads_))
+      threads_.push_back(
+          std::thread(&BlockCompressedInputStreambuf::RunThread, this));
+    pending_.push_back(block);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(block);
+    }
+    queued_cond_.notify_one();
+  }
+}
+
+void BlockCompressedInputStreambuf::WaitFor(Block *block) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!block->done)
+    done_cond_.wait(lock);
+}
+
+void BlockCompressedInputStreambuf::ClearPending() {
+  {
+    // Blocks no thread has started on can go straight away.
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < queue_.size(); i++)
+      queue_[i]->done = true;
+    queue_.clear();
+  }
+  for (size_t i = 0; i < pending_.size(); i++) {
+    WaitFor(pending_[i]);
+    FreeBlock(pending_[i]);
+  }
+  pending_.clear();
+}
+
+bool BlockCompressedInputStreambuf::SetCurrent(Block *block, int64 offset) {
+  Block *previous = current_;
+  current_ = block;
+  current_offset_ = block->offset;
+  if (!block->ok) {
+    KALDI_WARN << "Corrupt block at offset " << block->offset << " of the "
+               << "uncompressed data in " << filename_;
+    setg(NULL, NULL, NULL);
+    error_ = true;
+    if (previous != NULL)
+      FreeBlock(previous);
+    return false;
+  }
+  char *data = block->data.data();
+  if (previous != NULL && previous->ok &&
+      previous->offset + previous->size == block->offset) {
+    // Put the last byte of the previous block in front, so that the stream
+    // can unget() it.
+    data[0] = previous->data[previous->size];
+    current_offset_--;
+    setg(data, data + 1 + offset, data + 1 + block->size);
+  } else {
+    setg(data + 1, data + 1 + offset, data + 1 + block->size);
+  }
+  if (previous != NULL)
+    FreeBlock(previous);
+  return true;
+}
+
+bool BlockCompressedInputStreambuf::NextBlock() {
+  if (error_)
+    return false;
+  // After a Seek(), depth_ is -1 and we do not read ahead until reading
+  // goes on past the block after the one that was sought to, so reading a
+  // single object at an offset does not start the threads.
+  depth_ = (depth_ < 0 ? 0 : std::min(std::max(2 * depth_, 1),
+                                      2 * num_threads_));
+  Block *block;
+  bool read_ahead = !pending_.empty();
+  if (read_ahead) {
+    block = pending_.front();
+    pending_.pop_front();
+  } else {
+    block = ReadBlock();
+    if (block == NULL)
+      return false;
+  }
+  // Keep the threads busy while we wait for this block, or decompress it
+  // here.
+  ReadAhead();
+  if (read_ahead)
+    WaitFor(block);
+  else
+    Decompress(block);
+  return SetCurrent(block, 0);
+}
+
+BlockCompressedInputStreambuf::int_type
+BlockCompressedInputStreambuf::underflow() {
+  if (gptr() == egptr() && !NextBlock())
+    return traits_type::eof();
+  return traits_type::to_int_type(*gptr());
+}
+
+BlockCompressedInputStreambuf::int_type
+BlockCompressedInputStreambuf::pbackfail(int_type c) {
+  // We get here at the start of a block we went straight to, whose previous
+  // byte we do not have (see SetCurrent()), or if 'c' is not the previous
+  // byte.
+  int64 pos = current_offset_ + (gptr() - eback());
+  if (!IsOpen() || pos == 0 || !Seek(pos - 1) || gptr() == egptr())
+    return traits_type::eof();
+  if (!traits_type::eq_int_type(c, traits_type::eof()) &&
+      !traits_type::eq_int_type(c, traits_type::to_int_type(*gptr())))
+    return traits_type::eof();  // We can't change the data.
+  return traits_type::to_int_type(*gptr());
+}
+
+bool BlockCompressedInputStreambuf::ReadIndex() {
+  if (have_index_)
+    return true;
+  index_.clear();
+  int64 file_size = static_cast<int64>(
+      file_.pubseekoff(0, std::ios_base::end, std::ios_base::in));
+  file_pos_ = file_size;
+  char footer[kFooterSize];
+  if (file_size >= static_cast<int64>(kFileHeaderSize + kBlockHeaderSize +
+                                      kFooterSize) &&
+      ReadBytes(file_size - kFooterSize, footer, kFooterSize) &&
+      memcmp(footer + 24, kFooterMagic, sizeof(kFooterMagic)) == 0) {
+    int64 index_file_offset = ReadInt64(footer),
+        num_blocks = ReadInt64(footer + 8);
+    total_size_ = ReadInt64(footer + 16);
+    std::vector<char> index;
+    if (num_blocks >= 0 && index_file_offset >= static_cast<int64>(
+            kFileHeaderSize + kBlockHeaderSize) &&
+        index_file_offset + num_blocks * static_cast<int64>(kIndexEntrySize) +
+        static_cast<int64>(kFooterSize) == file_size) {
+      index.resize(num_blocks * kIndexEntrySize);
+      if (index.empty() ||
+          ReadBytes(index_file_offset, index.data(), index.size())) {
+        bool ok = true;
+        for (int64 i = 0; i < num_blocks; i++) {
+          int64 offset = ReadInt64(&(index[i * kIndexEntrySize])),
+              file_offset = ReadInt64(&(index[i * kIndexEntrySize + 8]));
+          if (offset < 0 || offset >= total_size_ || file_offset >=
+              index_file_offset || (i == 0 ? offset != 0 :
+                                    offset <= index_.back().first ||
+                                    file_offset <= index_.back().second)) {
+            ok = false;
+            break;
+          }
+          index_.push_back(std::make_pair(offset, file_offset));
+        }
+        if (ok && (num_blocks != 0 || total_size_ == 0)) {
+          have_index_ = true;
+          return true;
+        }
+      }
+    }
+    index_.clear();
+  }
+  // There is no usable index; read the block headers.
+  KALDI_WARN << "Block-compressed file " << filename_ << " has no valid "
+             << "index (not closed properly?); reading the block headers";
+  int64 file_offset = kFileHeaderSize, offset = 0;
+  while (true) {
+    char header[kBlockHeaderSize];
+    if (!ReadBytes(file_offset, header, kBlockHeaderSize))
+      break;  // Truncated file; we can still read the blocks before this.
+    uint32 stored_size, size, method;
+    memcpy(&stored_size, header, 4);
+    memcpy(&size, header + 4, 4);
+    memcpy(&method, header + 8, 4);
+    if (method == kEndMarker)
+      break;
+    if ((method != kStoredBlock && method != kCompressedBlock) ||
+        size == 0 || size > block_size_) {
+      KALDI_WARN << "Corrupt block header at byte " << file_offset << " of "
+                 << filename_;
+      return false;
+    }
+    index_.push_back(std::make_pair(offset, file_offset));
+    offset += size;
+    file_offset += kBlockHeaderSize + stored_size;
+  }
+  total_size_ = offset;
+  have_index_ = true;
+  return true;
+}
+
+bool BlockCompressedInputStreambuf::UncompressedSize(int64 *size) {
+  if (!IsOpen() || !ReadIndex())
+    return false;
+  *size = total_size_;
+  return true;
+}
+
+bool BlockCompressedInputStreambuf::Seek(int64 offset) {
+  if (!IsOpen())
+    return false;
+  int64 buffer_end = current_offset_ + (egptr() - eback());
+  if (!error_ && offset >= current_offset_ && offset <= buffer_end) {
+    // In the current block, or at the start of the next one (the point where
+    // the data that follows is read from).
+    setg(eback(), eback() + (offset - current_offset_), egptr());
+    return true;
+  }
+  // In a block we have read ahead?  Then the read-ahead was worth it, and we
+  // go on reading ahead.
+  while (!error_ && !pending_.empty() && offset >= pending_.front()->offset) {
+    Block *block = pending_.front();
+    pending_.pop_front();
+    if (offset < block->offset + block->size) {
+      ReadAhead();
+      WaitFor(block);
+      return SetCurrent(block, offset - block->offset);
+    }
+    WaitFor(block);
+    FreeBlock(block);
+  }
+
+  // Otherwise go straight to the block that contains 'offset'.
+  ClearPending();
+  if (current_ != NULL) {
+    FreeBlock(current_);
+    current_ = NULL;
+  }
+  setg(NULL, NULL, NULL);
+  depth_ = -1;
+  error_ = false;
+  if (!ReadIndex() || offset < 0 || offset > total_size_)
+    return false;
+  current_offset_ = offset;
+  if (offset == total_size_) {  // At the end.
+    at_end_ = true;
+    return true;
+  }
+  size_t i = std::upper_bound(index_.begin(), index_.end(),
+                              std::make_pair(offset,
+                                  std::numeric_limits<int64>::max())) -
+      index_.begin() - 1;
+  next_offset_ = index_[i].first;
+  next_file_offset_ = index_[i].second;
+  at_end_ = false;
+  Block *block = ReadBlock();
+  if (block == NULL)
+    return false;
+  if (offset >= block->offset + block->size) {
+    KALDI_WARN << "Corrupt index in " << filename_;
+    FreeBlock(block);
+    error_ = true;
+    return false;
+  }
+  Decompress(block);
+  return SetCurrent(block, offset - block->offset);
+}
+
+BlockCompressedInputStreambuf::pos_type
+BlockCompressedInputStreambuf::seekoff(off_type off,
+                                       std::ios_base::seekdir dir,
+                                       std::ios_base::openmode which) {
+  if (!(which & std::ios_base::in))
+    return pos_type(off_type(-1));
+  int64 pos = current_offset_ + (gptr() - eback()), target;
+  if (dir == std::ios_base::cur) {
+    if (off == 0)
+      return pos_type(pos);  // tellg().
+    target = pos + off;
+  } else if (dir == std::ios_base::beg) {
+    target = off;
+  } else {
+    int64 size;
+    if (!UncompressedSize(&size))
+      return pos_type(off_type(-1));
+    target = size + off;
+  }
+  if (!Seek(target))
+    return pos_type(off_type(-1));
+  return pos_type(target);
+}
+
+BlockCompressedInputStreambuf::pos_type
+BlockCompressedInputStreambuf::seekpos(pos_type pos,
+                                       std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+std::streamsize BlockCompressedInputStreambuf::showmanyc() {
+  return egptr() - gptr();  // 0 means we don't know.
+}
+
+void BlockCompressedInputStreambuf::Close() {
+  ClearPending();
+  if (current_ != NULL) {
+    FreeBlock(current_);
+    current_ = NULL;
+  }
+  setg(NULL, NULL, NULL);
+  if (file_.is_open())
+    file_.close();
+  have_index_ = false;
+  index_.clear();
+}
+
+BlockCompressedInputStreambuf::~BlockCompressedInputStreambuf() {
+  Close();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  queued_cond_.notify_all();
+  for (size_t i = 0; i < threads_.size(); i++)
+    threads_[i].join();
+  for (size_t i = 0; i < free_blocks_.size(); i++)
+    delete free_blocks_[i];
+}
+
+}  // namespace kaldi
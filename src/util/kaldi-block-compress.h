@@ -0,0 +1,253 @@
+// util/kaldi-block-compress.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_KALDI_BLOCK_COMPRESS_H_
+#define KALDI_UTIL_KALDI_BLOCK_COMPRESS_H_
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// \addtogroup io_group
+/// @{
+
+/*
+   Block-compressed files.
+
+   Output and Input (see kaldi-io.h) read and write files whose names end in
+   ".z", e.g. "foo.ark.z", in a block-compressed format, so archives can be
+   stored compressed without going through a "| gzip -c > foo.ark.gz" pipe.
+   The data is cut into blocks of kBlockCompressedBlockSize bytes, which are
+   compressed independently with a simple LZ77 codec in the style of LZ4
+   (BlockCompress()); it is fast rather than strong, but it does well on
+   lattices and on the integer parts of egs.
+
+   Unlike a gzipped file, a block-compressed file can be read from any offset
+   into the uncompressed data, by decompressing just the block that contains
+   it.  Offsets are always offsets into the uncompressed data, so
+   "foo.ark.z:1234" refers to the same object as "foo.ark:1234" would, and
+   the scp files and indexes written by TableWriter for a ".z" archive work as
+   usual.  When a file is read sequentially, the blocks that follow are
+   decompressed in background threads (up to g_num_threads of them).
+
+   The format, with integers in the machine's byte order, is:
+     - the file header: "KBZ1", then the block size as a uint32.
+     - for each block: a block header of three uint32's: the number of bytes
+       stored, the number of uncompressed bytes and the method (0 = stored
+       uncompressed, 1 = compressed), then the stored bytes.
+     - an end marker: a block header with method 2, whose first field is the
+       size of the index that follows.
+     - the index: for each block, the offset of its data in the uncompressed
+       data and of its header in the file, as int64's.
+     - a 32-byte footer: the offset of the index, the number of blocks and the
+       uncompressed size as int64's, then "KBZINDEX".
+   Readers that find no valid index (e.g. because the writer did not finish)
+   read the block headers instead.
+*/
+
+/// Returns true if 'rxfilename' is a file (not a pipe or the standard
+/// input/output) whose name ends in ".z", possibly followed by an offset, e.g.
+/// "foo.ark.z" or "foo.ark.z:1234".
+bool IsBlockCompressedFilename(const std::string &rxfilename);
+
+/// The size of the blocks written by BlockCompressedOutputStreambuf.
+static const int32 kBlockCompressedBlockSize = 1 << 16;
+
+/// Returns the maximum size of the output of BlockCompress() for 'size' bytes.
+inline size_t BlockCompressBound(size_t size) {
+  return size + size / 255 + 16;
+}
+
+/// Compresses the 'size' bytes at 'src' into 'dest', which must have space for
+/// BlockCompressBound(size) bytes, and returns the compressed size.
+size_t BlockCompress(const char *src, size_t size, char *dest);
+
+/// Decompresses the 'size' bytes at 'src', written by BlockCompress(), into
+/// 'dest'.  Returns false if the data is corrupt or does not decompress to
+/// exactly 'dest_size' bytes.
+bool BlockDecompress(const char *src, size_t size, char *dest,
+                     size_t dest_size);
+
+
+/// A stream buffer that writes a block-compressed file.
+/// tellp() on a stream that uses it returns the offset into the uncompressed
+/// data.  Flushing the stream ends the current block early, so the data
+/// written so far can be read by other processes.
+class BlockCompressedOutputStreambuf: public std::streambuf {
+ public:
+  BlockCompressedOutputStreambuf();
+
+  /// Opens 'filename' (an actual filename) for writing and writes the file
+  /// header; returns false on error.
+  bool Open(const std::string &filename);
+
+  bool IsOpen() const { return file_.is_open(); }
+
+  /// Writes the last block and the index, and closes the file.  Returns false
+  /// if there was an error writing any part of the file.
+  bool Close();
+
+  ~BlockCompressedOutputStreambuf();
+
+ protected:
+  virtual int_type overflow(int_type c);
+  virtual int sync();
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which);
+
+ private:
+  // Compresses and writes the data in the put area, if any.
+  bool WriteBlock();
+  bool WriteBytes(const char *data, size_t size);
+
+  std::filebuf file_;
+  bool ok_;  // False after a write error.
+  int64 file_offset_;  // Bytes written to file_.
+  int64 offset_;  // Offset of the put area in the uncompressed data.
+  std::vector<char> buffer_;  // The put area.
+  std::vector<char> compressed_;
+  // (uncompressed offset, file offset) for each block written.
+  std::vector<std::pair<int64, int64> > index_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BlockCompressedOutputStreambuf);
+};
+
+
+/// A stream buffer that reads a block-compressed file, from any offset into
+/// the uncompressed data.  Seek() to a position in the block being read, or in
+/// a block that has been read ahead, costs nothing; other seeks read and
+/// decompress the block that contains the new position.  Each time reading
+/// goes on to the following block, more blocks are read ahead and decompressed
+/// in background threads, up to 2 per thread.  After a seek to another block,
+/// this only starts again once reading has gone past the block after it, so
+/// reading one object at an offset does not start the threads.
+class BlockCompressedInputStreambuf: public std::streambuf {
+ public:
+  BlockCompressedInputStreambuf();
+
+  /// Opens 'filename' (an actual filename) and reads the file header; returns
+  /// false, with a warning, if it could not be opened or is not a
+  /// block-compressed file.  The position is then the start of the data.
+  bool Open(const std::string &filename);
+
+  bool IsOpen() const { return file_.is_open(); }
+
+  const std::string &Filename() const { return filename_; }
+
+  /// Sets the position to 'offset' in the uncompressed data; returns false if
+  /// the offset is past the end, or the file is corrupt.
+  bool Seek(int64 offset);
+
+  /// Gets the size of the uncompressed data; returns false if the file is
+  /// corrupt.
+  bool UncompressedSize(int64 *size);
+
+  void Close();
+
+  ~BlockCompressedInputStreambuf();
+
+ protected:
+  virtual int_type underflow();
+  virtual int_type pbackfail(int_type c);
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which);
+  virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+  virtual std::streamsize showmanyc();
+
+ private:
+  struct Block {
+    int64 offset;  // Offset of the block in the uncompressed data.
+    uint32 size;  // Size of the uncompressed block.
+    uint32 method;
+    bool done;  // True once 'data' is ready (protected by mutex_).
+    bool ok;  // False if the block could not be decompressed.
+    std::vector<char> stored;  // With a spare byte in front.
+    // The uncompressed data, after a byte that SetCurrent() sets to the last
+    // byte of the previous block, so the stream can unget() into it.
+    std::vector<char> data;
+  };
+
+  // Reads the next block from the file, without decompressing it.  Returns
+  // NULL at the end of the data (and sets at_end_) or on error.
+  Block *ReadBlock();
+  // Decompresses a block read by ReadBlock().
+  static void Decompress(Block *block);
+  // Reads blocks ahead and hands them to the threads, until depth_ of them
+  // are pending.
+  void ReadAhead();
+  // Makes 'block' the current block, positioned 'offset' bytes into it, and
+  // frees the previous one; returns false if it could not be decompressed.
+  bool SetCurrent(Block *block, int64 offset);
+  // Goes on to the block after the current one; returns false at the end of
+  // the data or on error.
+  bool NextBlock();
+  // Waits until a block handed to the threads has been decompressed.
+  void WaitFor(Block *block);
+  // Waits for blocks being decompressed, and frees the pending ones.
+  void ClearPending();
+  // Reads the index, or builds it by reading the block headers.
+  bool ReadIndex();
+  bool ReadBytes(int64 file_offset, char *data, size_t size);
+  void FreeBlock(Block *block);
+  void RunThread();
+
+  std::string filename_;
+  std::filebuf file_;
+  int64 file_pos_;  // The position in file_.
+  uint32 block_size_;  // From the file header.
+  int64 next_file_offset_;  // Where ReadBlock() reads the next block header.
+  int64 next_offset_;  // The offset of the next block in the uncompressed data.
+  bool at_end_;  // True if ReadBlock() has reached the end marker.
+  bool error_;  // True if the file was found to be corrupt or truncated.
+
+  bool have_index_;
+  int64 total_size_;  // The uncompressed size, if have_index_.
+  // (uncompressed offset, file offset) for each block, if have_index_.
+  std::vector<std::pair<int64, int64> > index_;
+
+  Block *current_;  // The block in the get area, or NULL.
+  int64 current_offset_;  // The offset of eback() in the uncompressed data.
+  std::vector<Block*> free_blocks_;
+  int32 depth_;  // Number of blocks to read ahead; -1 after a Seek().
+  int32 num_threads_;
+
+  // Blocks that have been read ahead, in order.
+  std::deque<Block*> pending_;
+  // The following, and Block::done, are protected by mutex_.
+  std::deque<Block*> queue_;  // Pending blocks no thread has started on.
+  bool stop_;
+  std::mutex mutex_;
+  std::condition_variable queued_cond_;  // Signaled when queue_ grows.
+  std::condition_variable done_cond_;  // Signaled when a block is done.
+  std::vector<std::thread> threads_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BlockCompressedInputStreambuf);
+};
+
+/// @}
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_KALDI_BLOCK_COMPRESS_H_
@@ -29,6 +29,7 @@
 
 #include "base/kaldi-utils.h"
 #include "util/kaldi-io.h"
+#include "util/kaldi-mmap.h"
 #include "util/text-utils.h"
 #include "matrix/kaldi-matrix.h"
 
@@ -119,6 +120,139 @@ template<class KaldiType> class KaldiObjectHolder {
 };
 
 
+template<class Real> class MatrixViewHolder {
+ public:
+  typedef SubMatrix<Real> T;
+
+  MatrixViewHolder(): view_(NULL) { }
+
+  static bool Write(std::ostream &os, bool binary, const T &t) {
+    InitKaldiOutputStream(os, binary);  // Puts binary header if binary mode.
+    try {
+      t.Write(os, binary);
+      return os.good();
+    } catch(const std::exception &e) {
+      KALDI_WARN << "Exception caught writing Table object. " << e.what();
+      return false;  // Write failure.
+    }
+  }
+
+  void Clear() {
+    delete view_;
+    view_ = NULL;
+    mat_.Resize(0, 0);
+    file_.reset();
+  }
+
+  bool Read(std::istream &is) {
+    Clear();
+    bool is_binary;
+    if (!InitKaldiInputStream(is, &is_binary)) {
+      KALDI_WARN << "Reading Table object, failed reading binary header\n";
+      return false;
+    }
+    MemoryMappedStreambuf *buf =
+        dynamic_cast<MemoryMappedStreambuf*>(is.rdbuf());
+    if (is_binary && buf != NULL && ReadInPlace(buf))
+      return true;
+    try {
+      mat_.Read(is, is_binary);
+      view_ = new SubMatrix<Real>(mat_.Data(), mat_.NumRows(), mat_.NumCols(),
+                                  mat_.Stride());
+      return true;
+    } catch(const std::exception &e) {
+      KALDI_WARN << "Exception caught reading Table object. " << e.what();
+      mat_.Resize(0, 0);
+      return false;
+    }
+  }
+
+  static bool IsReadInBinary() { return true; }
+
+  T &Value() {
+    if (!view_) KALDI_ERR << "MatrixViewHolder::Value() called wrongly.";
+    return *view_;
+  }
+
+  void Swap(MatrixViewHolder<Real> *other) {
+    // Swapping Matrix objects swaps their data pointers, so views of mat_
+    // stay valid.
+    std::swap(view_, other->view_);
+    mat_.Swap(&(other->mat_));
+    file_.swap(other->file_);
+  }
+
+  bool ExtractRange(const MatrixViewHolder<Real> &other,
+                    const std::string &range) {
+    KALDI_ASSERT(other.view_ != NULL);
+    Clear();
+    const SubMatrix<Real> &input = *(other.view_);
+    std::vector<int32> row_range, col_range;
+    if (!ParseMatrixRangeSpecifier(range, input.NumRows(), input.NumCols(),
+                                   &row_range, &col_range)) {
+      KALDI_WARN << "Could not parse range specifier \"" << range << "\".";
+      return false;
+    }
+    int32 row_size = std::min(row_range[1], input.NumRows() - 1)
+                     - row_range[0] + 1,
+          col_size = col_range[1] - col_range[0] + 1;
+    if (other.file_ != NULL) {
+      // Share the mapping.
+      file_ = other.file_;
+      view_ = new SubMatrix<Real>(input, row_range[0], row_size,
+                                  col_range[0], col_size);
+    } else {
+      // 'other' may be cleared before we are, so copy.
+      mat_.Resize(row_size, col_size, kUndefined);
+      mat_.CopyFromMat(input.Range(row_range[0], row_size,
+                                   col_range[0], col_size));
+      view_ = new SubMatrix<Real>(mat_.Data(), mat_.NumRows(), mat_.NumCols(),
+                                  mat_.Stride());
+    }
+    return true;
+  }
+
+  ~MatrixViewHolder() { delete view_; }
+
+ private:
+  // Points view_ directly at the next object in 'buf' if it is a binary
+  // matrix of type Real whose data is aligned, and moves past it; otherwise
+  // returns false without consuming anything.  The layout is that of
+  // Matrix<Real>::Write(): the token "FM " or "DM ", then the number of rows
+  // and columns, each as a size byte and an int32, then the data.
+  bool ReadInPlace(MemoryMappedStreambuf *buf) {
+    const size_t header_size = 3 + 2 * (1 + sizeof(int32));
+    const char *header = buf->Current();
+    if (buf->Remaining() < header_size ||
+        header[0] != (sizeof(Real) == 4 ? 'F' : 'D') || header[1] != 'M' ||
+        header[2] != ' ' || header[3] != sizeof(int32) ||
+        header[8] != sizeof(int32))
+      return false;
+    int32 num_rows, num_cols;
+    memcpy(&num_rows, header + 4, sizeof(int32));
+    memcpy(&num_cols, header + 9, sizeof(int32));
+    const char *data = header + header_size;
+    if (num_rows <= 0 || num_cols <= 0 ||
+        reinterpret_cast<size_t>(data) % sizeof(Real) != 0 ||
+        static_cast<size_t>(num_rows) * num_cols >
+        (buf->Remaining() - header_size) / sizeof(Real))
+      return false;  // Let Matrix::Read() handle it, or report the error.
+    // The mapping is read-only; callers must not write through the view.
+    view_ = new SubMatrix<Real>(reinterpret_cast<Real*>(const_cast<char*>(data)),
+                                num_rows, num_cols, num_cols);
+    file_ = buf->File();
+    buf->Advance(header_size + sizeof(Real) * num_rows * num_cols);
+    return true;
+  }
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MatrixViewHolder);
+  SubMatrix<Real> *view_;  // NULL if not holding anything.
+  Matrix<Real> mat_;  // Holds the data if it is not used in place.
+  std::shared_ptr<const MemoryMappedFile> file_;  // Non-NULL if view_ points
+                                                  // into the mapping.
+};
+
+
 // BasicHolder is valid for float, double, bool, and integer
 // types.  There will be a compile time error otherwise, because
 // we make sure that the {Write, Read}BasicType functions do not
@@ -219,6 +219,15 @@ class HtkMatrixHolder;
 /// A class for reading/writing Sphinx format matrices.
 template<int kFeatDim = 13> class SphinxMatrixHolder;
 
+/// MatrixViewHolder reads matrices written by KaldiObjectHolder<Matrix<Real> >
+/// as T == SubMatrix<Real>.  When the stream was opened with
+/// Input::OpenMapped() (the "mmap" rspecifier option) and the matrix is stored
+/// uncompressed in binary form, with type Real and suitably aligned, the
+/// SubMatrix points directly into the mapped file and nothing is copied.
+/// Otherwise it is read into a Matrix owned by the holder.  The data must not
+/// be modified.
+template<class Real> class MatrixViewHolder;
+
 /// This templated function exists so that we can write .scp files with
 /// 'object ranges' specified: the canonical example is a [first:last] range
 /// of rows of a matrix, or [first-row:last-row,first-column,last-column]
@@ -248,6 +257,14 @@ template <class Real>
 bool ExtractObjectRange(const Vector<Real> &input, const std::string &range,
                         Vector<Real> *output);
 
+/// Parses a matrix range specifier of the form r1:r2,c1:c2 (see
+/// ExtractObjectRange()) for a matrix with the given dimensions; returns
+/// false if it is invalid.
+bool ParseMatrixRangeSpecifier(const std::string &range,
+                               const int rows, const int cols,
+                               std::vector<int32> *row_range,
+                               std::vector<int32> *col_range);
+
 /// GeneralMatrix is always of type BaseFloat
 bool ExtractObjectRange(const GeneralMatrix &input, const std::string &range,
                         GeneralMatrix *output);
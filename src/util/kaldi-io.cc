@@ -23,7 +23,9 @@
 #include "base/kaldi-math.h"
 #include "util/text-utils.h"
 #include "util/parse-options.h"
+#include "util/kaldi-block-compress.h"
 #include "util/kaldi-holder.h"
+#include "util/kaldi-mmap.h"
 #include "util/kaldi-pipebuf.h"
 #include "util/kaldi-table.h"  // for Classify{W,R}specifier
 #include <stdio.h>
@@ -234,6 +236,43 @@ class FileOutputImpl: public OutputImplBase {
   std::ofstream os_;
 };
 
+// Writes a block-compressed file (see kaldi-block-compress.h); this is for
+// filenames ending in ".z".
+class BlockCompressedOutputImpl: public OutputImplBase {
+ public:
+  BlockCompressedOutputImpl(): os_(&buf_) { }
+
+  // 'binary' is ignored: the file is always written in binary mode.
+  virtual bool Open(const std::string &filename, bool binary) {
+    if (buf_.IsOpen()) KALDI_ERR << "BlockCompressedOutputImpl::Open(), "
+                                 << "open called on already open file.";
+    filename_ = filename;
+    return buf_.Open(MapOsPath(filename_));
+  }
+
+  virtual std::ostream &Stream() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "BlockCompressedOutputImpl::Stream(), file is not open.";
+    return os_;
+  }
+
+  virtual bool Close() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "BlockCompressedOutputImpl::Close(), file is not open.";
+    bool ok = !os_.fail();
+    return buf_.Close() && ok;
+  }
+
+  virtual ~BlockCompressedOutputImpl() {
+    if (buf_.IsOpen() && !Close())
+      KALDI_ERR << "Error closing output file " << filename_;
+  }
+ private:
+  std::string filename_;
+  BlockCompressedOutputStreambuf buf_;
+  std::ostream os_;
+};
+
 class StandardOutputImpl: public OutputImplBase {
  public:
   StandardOutputImpl(): is_open_(false) { }
@@ -374,6 +413,9 @@ class InputImplBase {
   virtual InputType MyType() = 0;  // Because if it's kOffsetFileInput, we may
                                    // call Open twice
   // (has efficiency benefits).
+  virtual bool IsMapped() { return false; }  // True for MappedInputImpl.
+  // True for BlockCompressedInputImpl.
+  virtual bool IsBlockCompressed() { return false; }
 
   virtual ~InputImplBase() { }
 };
@@ -662,6 +704,109 @@ class OffsetFileInputImpl: public InputImplBase {
 };
 
 
+// Reads a file, or a file at an offset, from a MemoryMappedFile.  Like
+// OffsetFileInputImpl, it may be opened again, and if the file is the same it
+// just seeks (which for a mapping costs nothing).
+class MappedInputImpl: public InputImplBase {
+ public:
+  MappedInputImpl(): type_(kFileInput), is_(&buf_) { }
+
+  // 'binary' is ignored: we only support this on systems that don't
+  // distinguish text and binary mode.
+  virtual bool Open(const std::string &rxfilename, bool binary) {
+    type_ = ClassifyRxfilename(rxfilename);
+    KALDI_ASSERT(type_ == kFileInput || type_ == kOffsetFileInput);
+    std::string filename;
+    size_t offset = 0;
+    if (type_ == kOffsetFileInput)
+      OffsetFileInputImpl::SplitFilename(rxfilename, &filename, &offset);
+    else
+      filename = rxfilename;
+    if (buf_.File() == NULL || buf_.File()->Filename() != filename) {
+      std::shared_ptr<const MemoryMappedFile> file =
+          MemoryMappedFile::Open(filename);
+      if (file == NULL) return false;
+      buf_.SetFile(file);
+    }
+    is_.clear();
+    return buf_.Seek(offset);
+  }
+
+  virtual std::istream &Stream() {
+    if (buf_.File() == NULL)
+      KALDI_ERR << "MappedInputImpl::Stream(), file is not open.";
+    return is_;
+  }
+
+  virtual int32 Close() {
+    if (buf_.File() == NULL)
+      KALDI_ERR << "MappedInputImpl::Close(), file is not open.";
+    buf_.SetFile(std::shared_ptr<const MemoryMappedFile>());
+    return 0;
+  }
+
+  virtual InputType MyType() { return type_; }
+
+  virtual bool IsMapped() { return true; }
+
+ private:
+  InputType type_;
+  MemoryMappedStreambuf buf_;
+  std::istream is_;
+};
+
+
+// Reads a block-compressed file (see kaldi-block-compress.h), or one at an
+// offset into the uncompressed data; this is for filenames ending in ".z".
+// Like OffsetFileInputImpl, it may be opened again, and if the file is the
+// same it just seeks.
+class BlockCompressedInputImpl: public InputImplBase {
+ public:
+  BlockCompressedInputImpl(): type_(kFileInput), is_(&buf_) { }
+
+  // 'binary' is ignored, as for MappedInputImpl.
+  virtual bool Open(const std::string &rxfilename, bool binary) {
+    type_ = ClassifyRxfilename(rxfilename);
+    KALDI_ASSERT(type_ == kFileInput || type_ == kOffsetFileInput);
+    std::string filename;
+    size_t offset = 0;
+    if (type_ == kOffsetFileInput)
+      OffsetFileInputImpl::SplitFilename(rxfilename, &filename, &offset);
+    else
+      filename = rxfilename;
+    filename = MapOsPath(filename);
+    if (!buf_.IsOpen() || buf_.Filename() != filename) {
+      if (!buf_.Open(filename))
+        return false;
+    }
+    is_.clear();
+    return buf_.Seek(offset);
+  }
+
+  virtual std::istream &Stream() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "BlockCompressedInputImpl::Stream(), file is not open.";
+    return is_;
+  }
+
+  virtual int32 Close() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "BlockCompressedInputImpl::Close(), file is not open.";
+    buf_.Close();
+    return 0;
+  }
+
+  virtual InputType MyType() { return type_; }
+
+  virtual bool IsBlockCompressed() { return true; }
+
+ private:
+  InputType type_;
+  BlockCompressedInputStreambuf buf_;
+  std::istream is_;
+};
+
+
 Output::Output(const std::string &wxfilename, bool binary,
                bool write_header):impl_(NULL) {
   if (!Open(wxfilename, binary, write_header)) {
@@ -719,7 +864,9 @@ bool Output::Open(const std::string &wxfn, bool binary, bool header) {
   OutputType type = ClassifyWxfilename(wxfn);
   KALDI_ASSERT(impl_ == NULL);
 
-  if (type ==  kFileOutput) {
+  if (type == kFileOutput && IsBlockCompressedFilename(wxfn)) {
+    impl_ = new BlockCompressedOutputImpl();
+  } else if (type ==  kFileOutput) {
     impl_ = new FileOutputImpl();
   } else if (type == kStandardOutput) {
     impl_ = new StandardOutputImpl();
@@ -771,11 +918,19 @@ int32 Input::Close() {
 
 bool Input::OpenInternal(const std::string &rxfilename,
                          bool file_binary,
-                         bool *contents_binary) {
+                         bool *contents_binary,
+                         bool mapped) {
   InputType type = ClassifyRxfilename(rxfilename);
+  bool compressed = IsBlockCompressedFilename(rxfilename);
+  // Pipes and the standard input can't be mapped; they are read as usual, and
+  // so are block-compressed files, whose data has to be decompressed anyway.
+  mapped = mapped && !compressed &&
+      (type == kFileInput || type == kOffsetFileInput);
   if (IsOpen()) {
     // May have to close the stream first.
-    if (type == kOffsetFileInput && impl_->MyType() == kOffsetFileInput) {
+    if (type == kOffsetFileInput && impl_->MyType() == kOffsetFileInput &&
+        impl_->IsMapped() == mapped &&
+        impl_->IsBlockCompressed() == compressed) {
       // We want to use the same object to Open... this is in case
       // the files are the same, so we can just seek.
       if (!impl_->Open(rxfilename, file_binary)) {  // true is binary mode--
@@ -794,7 +949,22 @@ bool Input::OpenInternal(const std::string &rxfilename,
       // and fall through to code below which actually opens the file.
     }
   }
-  if (type ==  kFileInput) {
+  if (mapped) {
+    impl_ = new MappedInputImpl();
+    if (impl_->Open(rxfilename, file_binary)) {
+      if (contents_binary != NULL)
+        return InitKaldiInputStream(impl_->Stream(), contents_binary);
+      else
+        return true;
+    }
+    // MemoryMappedFile::Open() will have warned; fall back to reading the
+    // file the normal way, which will fail too if the file is not there.
+    delete impl_;
+    impl_ = NULL;
+  }
+  if (compressed) {
+    impl_ = new BlockCompressedInputImpl();
+  } else if (type ==  kFileInput) {
     impl_ = new FileInputImpl();
   } else if (type == kStandardInput) {
     impl_ = new StandardInputImpl();
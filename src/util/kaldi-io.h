@@ -70,6 +70,11 @@ class InputImplBase;  // Forward decl; defined in a .cc file
 //   [these are created by the Table and TableWriter classes; I may also write
 //    a program that creates them for arbitrary files]
 //
+// Files whose names end in ".z", e.g. "/mnt/blah/data/1.ark.z", are written
+// and read in a block-compressed format (see kaldi-block-compress.h); an offset
+// into such a file, e.g. "/mnt/blah/data/1.ark.z:24871", is an offset into the
+// uncompressed data.
+//
 
 
 // Typical usage:
@@ -213,6 +218,15 @@ class Input {
   // binary mode (and ignore the \r).
   inline bool OpenTextMode(const std::string &rxfilename);
 
+  // As Open, but files and offsets into files (e.g. "foo.ark:1234") are read
+  // from a MemoryMappedFile (see kaldi-mmap.h) that is shared by all Inputs
+  // that read the same file, so reading them costs no system calls and
+  // seeking is free; the stream's rdbuf() is then a MemoryMappedStreambuf.
+  // Pipes and the standard input are opened as by Open(), as are files that
+  // cannot be mapped (with a warning).
+  inline bool OpenMapped(const std::string &rxfilename,
+                         bool *contents_binary = NULL);
+
   // Return true if currently open for reading and Stream() will
   // succeed.  Does not guarantee that the stream is good.
   inline bool IsOpen();
@@ -231,7 +245,7 @@ class Input {
   ~Input();
  private:
   bool OpenInternal(const std::string &rxfilename, bool file_binary,
-                    bool *contents_binary);
+                    bool *contents_binary, bool mapped = false);
   InputImplBase *impl_;
   KALDI_DISALLOW_COPY_AND_ASSIGN(Input);
 };
@@ -0,0 +1,154 @@
+// util/kaldi-mmap.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/kaldi-mmap.h"
+
+#include <map>
+#include <mutex>
+
+#ifndef _MSC_VER
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kaldi {
+
+#ifndef _MSC_VER
+
+// The mappings that are in use, by filename.
+static std::mutex g_mapped_files_mutex;
+static std::map<std::string, std::weak_ptr<const MemoryMappedFile> >
+    g_mapped_files;
+
+std::shared_ptr<const MemoryMappedFile> MemoryMappedFile::Open(
+    const std::string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    KALDI_WARN << "Could not open " << filename << " for reading: "
+               << strerror(errno);
+    return std::shared_ptr<const MemoryMappedFile>();
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    KALDI_WARN << "Cannot map " << filename << " into memory: not a regular "
+               << "file";
+    close(fd);
+    return std::shared_ptr<const MemoryMappedFile>();
+  }
+
+  std::lock_guard<std::mutex> lock(g_mapped_files_mutex);
+  std::shared_ptr<const MemoryMappedFile> ans = g_mapped_files[filename].lock();
+  if (ans != NULL && ans->size_ == static_cast<size_t>(st.st_size) &&
+      ans->device_ == static_cast<uint64>(st.st_dev) &&
+      ans->inode_ == static_cast<uint64>(st.st_ino) &&
+      ans->mtime_ == static_cast<int64>(st.st_mtime)) {
+    close(fd);
+    return ans;
+  }
+  std::shared_ptr<MemoryMappedFile> file(new MemoryMappedFile());
+  file->filename_ = filename;
+  file->size_ = st.st_size;
+  file->device_ = st.st_dev;
+  file->inode_ = st.st_ino;
+  file->mtime_ = st.st_mtime;
+  if (file->size_ != 0) {  // mmap() does not accept empty mappings.
+    void *data = mmap(NULL, file->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      KALDI_WARN << "Could not map " << filename << " into memory: "
+                 << strerror(errno);
+      close(fd);
+      return std::shared_ptr<const MemoryMappedFile>();
+    }
+    file->data_ = static_cast<char*>(data);
+  }
+  close(fd);  // The mapping stays valid.
+  g_mapped_files[filename] = file;
+  return file;
+}
+
+MemoryMappedFile::~MemoryMappedFile() {
+  if (data_ != NULL)
+    munmap(data_, size_);
+  std::lock_guard<std::mutex> lock(g_mapped_files_mutex);
+  // Forget this mapping, unless the file was mapped again since.
+  std::map<std::string, std::weak_ptr<const MemoryMappedFile> >::iterator
+      iter = g_mapped_files.find(filename_);
+  if (iter != g_mapped_files.end() && iter->second.expired())
+    g_mapped_files.erase(iter);
+}
+
+#else  // _MSC_VER
+
+std::shared_ptr<const MemoryMappedFile> MemoryMappedFile::Open(
+    const std::string &filename) {
+  KALDI_WARN << "Memory-mapped files are not supported on this platform.";
+  return std::shared_ptr<const MemoryMappedFile>();
+}
+
+MemoryMappedFile::~MemoryMappedFile() { }
+
+#endif  // _MSC_VER
+
+
+void MemoryMappedStreambuf::SetFile(
+    const std::shared_ptr<const MemoryMappedFile> &file) {
+  file_ = file;
+  // The buffer is never written to, but std::streambuf wants char*.
+  char *data = (file_ != NULL ? const_cast<char*>(file_->Data()) : NULL);
+  size_t size = (file_ != NULL ? file_->Size() : 0);
+  setg(data, data, data + size);
+}
+
+bool MemoryMappedStreambuf::Seek(size_t offset) {
+  if (offset > static_cast<size_t>(egptr() - eback()))
+    return false;
+  setg(eback(), eback() + offset, egptr());
+  return true;
+}
+
+void MemoryMappedStreambuf::Advance(size_t n) {
+  KALDI_ASSERT(n <= Remaining());
+  setg(eback(), gptr() + n, egptr());
+}
+
+MemoryMappedStreambuf::pos_type MemoryMappedStreambuf::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  if (!(which & std::ios_base::in))
+    return pos_type(off_type(-1));
+  off_type base = (dir == std::ios_base::beg ? 0 :
+                   dir == std::ios_base::cur ? gptr() - eback() :
+                   egptr() - eback());
+  if (base + off < 0 || !Seek(base + off))
+    return pos_type(off_type(-1));
+  return pos_type(base + off);
+}
+
+MemoryMappedStreambuf::pos_type MemoryMappedStreambuf::seekpos(
+    pos_type pos, std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+std::streamsize MemoryMappedStreambuf::showmanyc() {
+  std::streamsize n = egptr() - gptr();
+  return (n > 0 ? n : -1);
+}
+
+}  // namespace kaldi
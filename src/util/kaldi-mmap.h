@@ -0,0 +1,118 @@
+// util/kaldi-mmap.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_KALDI_MMAP_H_
+#define KALDI_UTIL_KALDI_MMAP_H_
+
+#include <memory>
+#include <streambuf>
+#include <string>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// \addtogroup io_group
+/// @{
+
+/**
+   MemoryMappedFile maps a whole file into memory, read-only.  Open() keeps
+   one mapping per file for the whole process, shared by everything that
+   holds it: the Input objects reading entries of an archive, and any
+   matrices read from it without copying (see MatrixViewHolder).  The mapping
+   goes away when the last of them releases it.
+
+   If the file has changed since it was mapped (its size, modification time
+   or inode differ), Open() maps it again; objects that still hold the old
+   mapping keep seeing the old contents.  Truncating a file while it is
+   mapped makes accesses to the missing part crash with SIGBUS, as for any
+   mmap'ed file, so archives should not be rewritten in place while they are
+   being read this way.
+ */
+class MemoryMappedFile {
+ public:
+  /// Returns the mapping of 'filename', or NULL (with a warning) if it could
+  /// not be opened or mapped, e.g. because it is not a regular file, or on
+  /// platforms without mmap().
+  static std::shared_ptr<const MemoryMappedFile> Open(
+      const std::string &filename);
+
+  const std::string &Filename() const { return filename_; }
+
+  /// Returns the contents, or NULL if the file is empty.
+  const char *Data() const { return data_; }
+
+  size_t Size() const { return size_; }
+
+  ~MemoryMappedFile();
+
+ private:
+  MemoryMappedFile(): data_(NULL), size_(0), device_(0), inode_(0),
+                      mtime_(0) { }
+
+  std::string filename_;
+  char *data_;
+  size_t size_;
+  // These identify the version of the file that was mapped.
+  uint64 device_;
+  uint64 inode_;
+  int64 mtime_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MemoryMappedFile);
+};
+
+
+/// A read-only stream buffer that reads from a MemoryMappedFile; seeking in it
+/// costs nothing.  Readers that know about it (see MatrixViewHolder) can get
+/// the current position in the mapping from the std::istream and use the
+/// data in place.
+class MemoryMappedStreambuf: public std::streambuf {
+ public:
+  MemoryMappedStreambuf() { }
+
+  /// Starts reading 'file' (which may be NULL, to release the previous one)
+  /// from the beginning.
+  void SetFile(const std::shared_ptr<const MemoryMappedFile> &file);
+
+  const std::shared_ptr<const MemoryMappedFile> &File() const { return file_; }
+
+  /// Sets the position; returns false if offset > File()->Size().
+  bool Seek(size_t offset);
+
+  /// The current position in the mapping, and the number of bytes left after
+  /// it.
+  const char *Current() const { return gptr(); }
+  size_t Remaining() const { return egptr() - gptr(); }
+
+  /// Skips n <= Remaining() bytes.
+  void Advance(size_t n);
+
+ protected:
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which);
+  virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+  virtual std::streamsize showmanyc();
+
+ private:
+  std::shared_ptr<const MemoryMappedFile> file_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MemoryMappedStreambuf);
+};
+
+/// @}
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_KALDI_MMAP_H_
@@ -0,0 +1,100 @@
+// util/kaldi-mpmc-queue-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <thread>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "util/kaldi-mpmc-queue.h"
+
+namespace kaldi {
+
+void TestMpmcQueueSingleThreaded() {
+  MpmcQueue<std::vector<int32> > queue(3);
+  KALDI_ASSERT(queue.Capacity() == 4);
+  std::vector<int32> v;
+  KALDI_ASSERT(!queue.TryPop(&v));
+  for (int32 i = 0; i < 4; i++) {
+    v.assign(1000, i);
+    KALDI_ASSERT(queue.TryPush(&v));
+  }
+  v.assign(1, -1);
+  KALDI_ASSERT(!queue.TryPush(&v) && v.size() == 1);  // full.
+  for (int32 i = 0; i < 4; i++) {
+    KALDI_ASSERT(queue.TryPop(&v));
+    KALDI_ASSERT(v.size() == 1000 && v[0] == i);
+  }
+  queue.Close();
+  KALDI_ASSERT(!queue.Pop(&v));
+}
+
+// Each producer pushes the numbers 0 .. num_items-1 tagged with its id; we
+// check that every item arrives exactly once, and that the items of each
+// producer arrive in order at each consumer.
+void TestMpmcQueueMultiThreaded() {
+  int32 num_producers = 1 + Rand() % 4, num_consumers = 1 + Rand() % 4,
+      num_items = 1000 + Rand() % 10000, capacity = 1 + Rand() % 64;
+  MpmcQueue<std::pair<int32, int32> > queue(capacity);
+
+  std::vector<std::vector<int32> > count(num_producers,
+                                         std::vector<int32>(num_items, 0));
+  std::vector<std::vector<std::pair<int32, int32> > > received(num_consumers);
+
+  std::vector<std::thread> producers, consumers;
+  for (int32 c = 0; c < num_consumers; c++) {
+    consumers.push_back(std::thread([&queue, &received, c]() {
+      std::pair<int32, int32> item;
+      while (queue.Pop(&item))
+        received[c].push_back(item);
+    }));
+  }
+  for (int32 p = 0; p < num_producers; p++) {
+    producers.push_back(std::thread([&queue, p, num_items]() {
+      for (int32 i = 0; i < num_items; i++) {
+        std::pair<int32, int32> item(p, i);
+        queue.Push(&item);
+      }
+    }));
+  }
+  for (size_t p = 0; p < producers.size(); p++)
+    producers[p].join();
+  queue.Close();
+  for (size_t c = 0; c < consumers.size(); c++)
+    consumers[c].join();
+
+  for (int32 c = 0; c < num_consumers; c++) {
+    std::vector<int32> last(num_producers, -1);
+    for (size_t i = 0; i < received[c].size(); i++) {
+      int32 p = received[c][i].first, n = received[c][i].second;
+      KALDI_ASSERT(n > last[p]);
+      last[p] = n;
+      count[p][n]++;
+    }
+  }
+  for (int32 p = 0; p < num_producers; p++)
+    for (int32 i = 0; i < num_items; i++)
+      KALDI_ASSERT(count[p][i] == 1);
+}
+
+}  // end namespace kaldi.
+
+int main() {
+  using namespace kaldi;
+  TestMpmcQueueSingleThreaded();
+  for (int32 i = 0; i < 10; i++)
+    TestMpmcQueueMultiThreaded();
+  KALDI_LOG << "Test OK.";
+}
@@ -0,0 +1,173 @@
+// util/kaldi-mpmc-queue.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_KALDI_MPMC_QUEUE_H_
+#define KALDI_UTIL_KALDI_MPMC_QUEUE_H_ 1
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/**
+   MpmcQueue is a bounded multi-producer / multi-consumer FIFO queue,
+   implemented as a lock-free ring buffer (D. Vyukov's algorithm: every
+   cell carries a sequence number that tells producers and consumers
+   whether it is free or filled for the current lap).  Objects are moved
+   in and out with std::move, so e.g. matrices are never copied.
+
+   The blocking Push() and Pop() spin briefly and then back off to
+   yielding and sleeping; they never take a lock.  A producer calls
+   Close() after its last Push(); after that Pop() returns false once the
+   queue has been drained.
+
+   T must be default-constructible and move-assignable.
+*/
+template<class T>
+class MpmcQueue {
+ public:
+  /// 'capacity' is rounded up to a power of two (and at least 2).
+  explicit MpmcQueue(int32 capacity): closed_(false) {
+    KALDI_ASSERT(capacity > 0);
+    size_t size = 2;
+    while (size < static_cast<size_t>(capacity)) size <<= 1;
+    mask_ = size - 1;
+    cells_ = new Cell[size];
+    for (size_t i = 0; i < size; i++)
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    enqueue_pos_.store(0, std::memory_order_relaxed);
+    dequeue_pos_.store(0, std::memory_order_relaxed);
+  }
+
+  ~MpmcQueue() { delete [] cells_; }
+
+  /// Moves *item into the queue and returns true, or returns false
+  /// (leaving *item untouched) if the queue is full.
+  bool TryPush(T *item) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell *cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          cell->data = std::move(*item);
+          cell->sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // full.
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /// Moves the oldest element into *item and returns true, or returns
+  /// false if the queue is empty.
+  bool TryPop(T *item) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell *cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) -
+          static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          *item = std::move(cell->data);
+          cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // empty.
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /// Moves *item into the queue, waiting while the queue is full.
+  /// It is an error to call this after Close().
+  void Push(T *item) {
+    KALDI_ASSERT(!closed_.load(std::memory_order_relaxed));
+    for (int32 n = 0; !TryPush(item); n = Backoff(n)) { }
+  }
+
+  /// Waits for an element and moves it into *item.  Returns false if
+  /// the queue is empty and Close() has been called.
+  bool Pop(T *item) {
+    for (int32 n = 0; ; n = Backoff(n)) {
+      if (TryPop(item)) return true;
+      if (closed_.load(std::memory_order_acquire))
+        return TryPop(item);  // a Push() may have landed before Close().
+    }
+  }
+
+  /// Called by the producer(s) after the last Push().
+  void Close() { closed_.store(true, std::memory_order_release); }
+
+  bool Closed() const { return closed_.load(std::memory_order_acquire); }
+
+  int32 Capacity() const { return static_cast<int32>(mask_ + 1); }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  // Spin for a while, then yield the CPU, then sleep, so that a consumer
+  // waiting for slow I/O does not take cycles away from the workers.
+  // Returns the next value of the retry counter 'n'.
+  static int32 Backoff(int32 n) {
+    if (n < 64) {
+      return n + 1;
+    } else if (n < 128) {
+      std::this_thread::yield();
+      return n + 1;
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      return n;
+    }
+  }
+
+  // The producer and consumer positions are kept on separate cache lines
+  // to avoid false sharing.
+  static const size_t kCacheLineSize = 64;
+  char pad0_[kCacheLineSize];
+  Cell *cells_;
+  size_t mask_;
+  char pad1_[kCacheLineSize];
+  std::atomic<size_t> enqueue_pos_;
+  char pad2_[kCacheLineSize];
+  std::atomic<size_t> dequeue_pos_;
+  char pad3_[kCacheLineSize];
+  std::atomic<bool> closed_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MpmcQueue);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_KALDI_MPMC_QUEUE_H_
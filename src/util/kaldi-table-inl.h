@@ -24,8 +24,12 @@
 #define KALDI_UTIL_KALDI_TABLE_INL_H_
 
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <errno.h>
@@ -302,7 +306,8 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
       bool ans;
       // note, NULL means it doesn't read the binary-mode header
       if (Holder::IsReadInBinary()) {
-        ans = data_input_.Open(data_rxfilename_, NULL);
+        ans = (opts_.mmap ? data_input_.OpenMapped(data_rxfilename_, NULL) :
+               data_input_.Open(data_rxfilename_, NULL));
       } else {
         ans = data_input_.OpenTextMode(data_rxfilename_);
       }
@@ -506,7 +511,8 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
     bool ans;
     // NULL means don't expect binary-mode header
     if (Holder::IsReadInBinary())
-      ans = input_.Open(archive_rxfilename_, NULL);
+      ans = (opts_.mmap ? input_.OpenMapped(archive_rxfilename_, NULL) :
+             input_.Open(archive_rxfilename_, NULL));
     else
       ans = input_.OpenTextMode(archive_rxfilename_);
     if (!ans) {  // header.
@@ -853,6 +859,287 @@ class SequentialTableReaderBackgroundImpl:
 
 };
 
+// This is for scp files with the 'bg=N' modifier (N > 1).  The script file is
+// read in the main thread, as it is cheap, and its entries are loaded by N
+// background threads, each with its own Input object.  At most 2N entries
+// are in progress or ready ahead of the current one, and they are returned in
+// the order of the script file.  Unlike SequentialTableReaderScriptImpl, it
+// does not reuse an object when consecutive lines of the script file refer to
+// the same rxfilename with different ranges; each line is loaded separately.
+template<class Holder>
+class SequentialTableReaderParallelScriptImpl:
+      public SequentialTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  SequentialTableReaderParallelScriptImpl(): current_(NULL), eof_(false),
+                                            error_(false), closing_(false) { }
+
+  virtual bool Open(const std::string &rspecifier) {
+    KALDI_ASSERT(!IsOpen());  // only called on a just-allocated object.
+    bool binary;
+    rspecifier_ = rspecifier;
+    RspecifierType rs = ClassifyRspecifier(rspecifier, &script_rxfilename_,
+                                           &opts_);
+    KALDI_ASSERT(rs == kScriptRspecifier && opts_.background_threads > 1);
+    if (!script_input_.Open(script_rxfilename_, &binary)) {
+      KALDI_WARN << "Failed to open script file "
+                 << PrintableRxfilename(script_rxfilename_);
+      return false;
+    }
+    if (binary) {
+      KALDI_WARN << "Script file should not be binary file.";
+      script_input_.Close();
+      return false;
+    }
+    for (int32 i = 0; i < opts_.background_threads; i++)
+      threads_.push_back(std::thread(
+          SequentialTableReaderParallelScriptImpl<Holder>::run, this));
+    Next();
+    return true;
+  }
+
+  virtual bool IsOpen() const { return !threads_.empty(); }
+
+  virtual bool Done() const { return current_ == NULL; }
+
+  virtual std::string Key() {
+    if (current_ == NULL)
+      KALDI_ERR << "Key() called on TableReader object at the wrong time.";
+    return current_->key;
+  }
+
+  virtual T &Value() {
+    if (current_ == NULL)
+      KALDI_ERR << "Value() called on TableReader object at the wrong time.";
+    if (!current_->loaded)
+      KALDI_ERR << "Failed to load object from "
+                << PrintableRxfilename(current_->data_rxfilename)
+                << " (to suppress this error, add the permissive "
+                << "(p, ) option to the rspecifier.";
+    return (current_->range.empty() ? current_->holder.Value() :
+            current_->range_holder.Value());
+  }
+
+  virtual void FreeCurrent() {
+    if (current_ == NULL)
+      KALDI_ERR << "Calling FreeCurrent() at the wrong time.";
+    current_->holder.Clear();
+    current_->range_holder.Clear();
+  }
+
+  virtual void SwapHolder(Holder *other_holder) {
+    (void) Value();  // Dies if we couldn't get the value.
+    if (current_->range.empty())
+      current_->holder.Swap(other_holder);
+    else
+      current_->range_holder.Swap(other_holder);
+  }
+
+  virtual void Next() {
+    delete current_;
+    current_ = NULL;
+    while (true) {
+      FillWindow();
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (window_.empty())
+        return;  // Done().
+      Entry *entry = window_.front();
+      while (!entry->finished)
+        finished_cond_.wait(lock);
+      window_.pop_front();
+      lock.unlock();
+      if (entry->loaded || !opts_.permissive) {
+        current_ = entry;
+        // Give the threads more work while the caller uses this object.
+        FillWindow();
+        return;
+      }
+      // In permissive mode, entries that can't be read are skipped.
+      delete entry;
+    }
+  }
+
+  virtual bool Close() {
+    KALDI_ASSERT(IsOpen());
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closing_ = true;
+    }
+    queued_cond_.notify_all();
+    for (size_t i = 0; i < threads_.size(); i++)
+      threads_[i].join();
+    threads_.clear();
+    // Now nobody else is using the entries.
+    delete current_;
+    current_ = NULL;
+    for (size_t i = 0; i < window_.size(); i++)
+      delete window_[i];
+    window_.clear();
+    queue_.clear();
+    int32 status = 0;
+    if (script_input_.IsOpen())
+      status = script_input_.Close();
+    if (error_ || (eof_ && status != 0)) {
+      if (opts_.permissive) {
+        KALDI_WARN << "Close() called on scp file with read error, ignoring the"
+            " error because permissive mode specified.";
+        return true;
+      }
+      return false;
+    }
+    return true;
+  }
+
+  virtual ~SequentialTableReaderParallelScriptImpl() {
+    if (IsOpen() && !Close())
+      KALDI_ERR << "TableReader: reading script file failed: from scp "
+                << PrintableRxfilename(script_rxfilename_);
+  }
+
+ private:
+  struct Entry {
+    std::string key;
+    std::string data_rxfilename;
+    std::string range;
+    Holder holder;
+    Holder range_holder;  // Used if 'range' is nonempty.
+    bool finished;  // True once a thread has tried to load the object.
+    bool loaded;  // True if it succeeded.
+    Entry(): finished(false), loaded(false) { }
+  };
+
+  // Reads lines of the script file until the window is full or the script
+  // file is finished.  Called only from the main thread.
+  void FillWindow() {
+    size_t window_size = 2 * threads_.size();
+    while (!eof_ && !error_) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (window_.size() >= window_size)
+          return;
+      }
+      std::string line;
+      if (!getline(script_input_.Stream(), line)) {
+        eof_ = true;
+        break;
+      }
+      Entry *entry = new Entry();
+      std::string rest;
+      SplitStringOnFirstSpace(line, &(entry->key), &rest);
+      bool ok = !entry->key.empty() && !rest.empty();
+      if (ok && rest[rest.size() - 1] == ']')
+        ok = ExtractRangeSpecifier(rest, &(entry->data_rxfilename),
+                                   &(entry->range));
+      else
+        entry->data_rxfilename = rest;
+      if (!ok) {
+        KALDI_WARN << "We got an invalid line in the scp file. "
+                   << "It should look like: some_key 1.ark:10, got: "
+                   << line;
+        delete entry;
+        error_ = true;  // Done() once the entries before it are used.
+        break;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        window_.push_back(entry);
+        queue_.push_back(entry);
+      }
+      queued_cond_.notify_one();
+    }
+  }
+
+  // Loads the object for 'entry', using 'input' to read it.
+  bool LoadEntry(Entry *entry, Input *input) {
+    bool ans;
+    // NULL means it doesn't read the binary-mode header
+    if (Holder::IsReadInBinary()) {
+      ans = (opts_.mmap ? input->OpenMapped(entry->data_rxfilename, NULL) :
+             input->Open(entry->data_rxfilename, NULL));
+    } else {
+      ans = input->OpenTextMode(entry->data_rxfilename);
+    }
+    if (!ans) {
+      KALDI_WARN << "Failed to open file "
+                 << PrintableRxfilename(entry->data_rxfilename);
+      return false;
+    }
+    if (!entry->holder.Read(input->Stream())) {
+      KALDI_WARN << "Failed to load object from "
+                 << PrintableRxfilename(entry->data_rxfilename);
+      return false;
+    }
+    if (!entry->range.empty()) {
+      if (!entry->range_holder.ExtractRange(entry->holder, entry->range)) {
+        KALDI_WARN << "Failed to load object from "
+                   << PrintableRxfilename(entry->data_rxfilename)
+                   << "[" << entry->range << "]";
+        return false;
+      }
+      entry->holder.Clear();
+    }
+    return true;
+  }
+
+  void RunInBackground() {
+    Input input;  // Kept open, so offsets into the same archive just seek.
+    while (true) {
+      Entry *entry;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (queue_.empty() && !closing_)
+          queued_cond_.wait(lock);
+        if (closing_)
+          return;
+        entry = queue_.front();
+        queue_.pop_front();
+      }
+      bool loaded = false;
+      try {
+        loaded = LoadEntry(entry, &input);
+      } catch (const std::exception &e) {
+        // e.g. ExtractRange() for a type that doesn't support ranges.  Value()
+        // will report the failure in the main thread.
+        KALDI_WARN << "Exception caught loading object from "
+                   << PrintableRxfilename(entry->data_rxfilename) << ": "
+                   << e.what();
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entry->loaded = loaded;
+        entry->finished = true;
+      }
+      finished_cond_.notify_all();
+    }
+  }
+
+  static void run(SequentialTableReaderParallelScriptImpl<Holder> *object) {
+    object->RunInBackground();
+  }
+
+  std::string rspecifier_;
+  RspecifierOptions opts_;
+  std::string script_rxfilename_;
+  Input script_input_;  // Only used by the main thread.
+
+  Entry *current_;  // The entry returned by Key() and Value(); NULL if Done().
+  bool eof_;  // True if we reached the end of the script file.
+  bool error_;  // True if there was an error reading the script file.
+
+  // The following are protected by mutex_.
+  std::mutex mutex_;
+  // Entries read from the script file that come after current_, in order.
+  std::deque<Entry*> window_;
+  // The entries in window_ that no thread has started loading yet.
+  std::deque<Entry*> queue_;
+  bool closing_;  // Tells the threads to exit.
+  std::condition_variable queued_cond_;  // Signaled when queue_ grows.
+  std::condition_variable finished_cond_;  // Signaled when an entry finishes.
+
+  std::vector<std::thread> threads_;
+};
+
 template<class Holder>
 SequentialTableReader<Holder>::SequentialTableReader(const std::string
                                                      &rspecifier): impl_(NULL) {
@@ -874,7 +1161,10 @@ bool SequentialTableReader<Holder>::Open(const std::string &rspecifier) {
       impl_ = new SequentialTableReaderArchiveImpl<Holder>();
       break;
     case kScriptRspecifier:
-      impl_ = new SequentialTableReaderScriptImpl<Holder>();
+      if (opts.background_threads > 1)
+        impl_ = new SequentialTableReaderParallelScriptImpl<Holder>();
+      else
+        impl_ = new SequentialTableReaderScriptImpl<Holder>();
       break;
     case kNoRspecifier: default:
       KALDI_WARN << "Invalid rspecifier " << rspecifier;
@@ -885,7 +1175,10 @@ bool SequentialTableReader<Holder>::Open(const std::string &rspecifier) {
     impl_ = NULL;
     return false;  // sub-object will have printed warnings.
   }
-  if (opts.background) {
+  // Archives can only be read in order, so for them "bg=N" is the same as
+  // "bg".
+  if (opts.background &&
+      !(wt == kScriptRspecifier && opts.background_threads > 1)) {
     impl_ = new SequentialTableReaderBackgroundImpl<Holder>(
         impl_);
     if (!impl_->Open("")) {
@@ -959,6 +1252,66 @@ SequentialTableReader<Holder>::~SequentialTableReader() {
 
 
 
+// The TableWriter implementations write objects with
+// TableObjectWriter<Holder>::Write(), which is Holder::Write() except that
+// with the "compress" wspecifier option, matrices are written in compressed
+// form (see the specializations below).  The "compress" option has no effect
+// for other types.
+template<class Holder> struct TableObjectWriter {
+  static bool Write(std::ostream &os, const WspecifierOptions &opts,
+                    const typename Holder::T &t) {
+    return Holder::Write(os, opts.binary, t);
+  }
+};
+
+// Matrices are written as CompressedMatrix, which readers of Matrix read
+// transparently.
+template<class Real>
+struct TableObjectWriter<KaldiObjectHolder<Matrix<Real> > > {
+  static bool Write(std::ostream &os, const WspecifierOptions &opts,
+                    const Matrix<Real> &t) {
+    if (!opts.compress || t.NumRows() == 0)
+      return KaldiObjectHolder<Matrix<Real> >::Write(os, opts.binary, t);
+    return KaldiObjectHolder<CompressedMatrix>::Write(os, opts.binary,
+                                                      CompressedMatrix(t));
+  }
+};
+
+template<>
+struct TableObjectWriter<KaldiObjectHolder<GeneralMatrix> > {
+  static bool Write(std::ostream &os, const WspecifierOptions &opts,
+                    const GeneralMatrix &t) {
+    if (!opts.compress || t.Type() != kFullMatrix)
+      return KaldiObjectHolder<GeneralMatrix>::Write(os, opts.binary, t);
+    GeneralMatrix compressed(t);
+    compressed.Compress();
+    return KaldiObjectHolder<GeneralMatrix>::Write(os, opts.binary,
+                                                   compressed);
+  }
+};
+
+
+// Used by the archive-writing TableWriter implementations for the "idx"
+// option.  If the archive is not an actual file we can't seek in it, so the
+// index would be useless; we warn and don't write it.  Returns false if the
+// index could not be opened.
+inline bool OpenIndex(ArchiveIndexWriter *index,
+                      const std::string &archive_wxfilename,
+                      const std::string &wspecifier) {
+  if (ClassifyWxfilename(archive_wxfilename) != kFileOutput) {
+    KALDI_WARN << "Not writing an index for an archive that is not a file: "
+               << "wspecifier is " << wspecifier;
+    return true;
+  }
+  if (!index->Open(archive_wxfilename)) {
+    KALDI_WARN << "Could not open "
+               << ArchiveIndex::IndexFilename(archive_wxfilename)
+               << " for writing.";
+    return false;
+  }
+  return true;
+}
+
 template<class Holder> class TableWriterImplBase {
  public:
   typedef typename Holder::T T;
@@ -1017,6 +1370,11 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
 
     if (output_.Open(archive_wxfilename_, opts_.binary, false)) {  // false
                                                       // means no binary header.
+      if (opts_.index && !OpenIndex(&index_, archive_wxfilename_, wspecifier)) {
+        output_.Close();
+        state_ = kUninitialized;
+        return false;
+      }
       state_ = kOpen;
       return true;
     } else {
@@ -1053,7 +1411,9 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
     if (!IsToken(key))  // e.g. empty string or has spaces...
       KALDI_ERR << "Using invalid key " << key;
     output_.Stream() << key << ' ';
-    if (!Holder::Write(output_.Stream(), opts_.binary, value)) {
+    int64 offset = (index_.IsOpen() ? output_.Stream().tellp() :
+                    std::streampos(0));
+    if (!TableObjectWriter<Holder>::Write(output_.Stream(), opts_, value)) {
       KALDI_WARN << "Write failure to "
                  << PrintableWxfilename(archive_wxfilename_);
       state_ = kWriteError;
@@ -1062,6 +1422,9 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
     if (state_ == kWriteError) return false;  // Even if this Write seems to
     // have succeeded, we fail because a previous Write failed and the archive
     // may be corrupted and unreadable.
+    if (index_.IsOpen())
+      index_.Add(key, offset,
+                 static_cast<int64>(output_.Stream().tellp()) - offset);
 
     if (opts_.flush)
       Flush();
@@ -1074,6 +1437,7 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
     switch (state_) {
       case kWriteError: case kOpen:
         output_.Stream().flush();  // Don't check error status.
+        if (index_.IsOpen()) index_.Flush();
         return;
       default:
         KALDI_WARN << "Flush called on not-open writer.";
@@ -1084,19 +1448,25 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
     if (!this->IsOpen() || !output_.IsOpen())
       KALDI_ERR << "Close called on a stream that was not open."
                 << this->IsOpen() << ", " << output_.IsOpen();
+    int64 archive_size = (index_.IsOpen() ? output_.Stream().tellp() :
+                          std::streampos(0));
     bool close_success = output_.Close();
     if (!close_success) {
       KALDI_WARN << "Error closing stream: wspecifier is " << wspecifier_;
+      index_.Abandon();
       state_ = kUninitialized;
       return false;
     }
     if (state_ == kWriteError) {
       KALDI_WARN << "Closing writer in error state: wspecifier is "
                  << wspecifier_;
+      index_.Abandon();
       state_ = kUninitialized;
       return false;
     }
     state_ = kUninitialized;
+    if (index_.IsOpen())
+      return index_.Close(archive_size);
     return true;
   }
 
@@ -1112,6 +1482,7 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
 
  private:
   Output output_;
+  ArchiveIndexWriter index_;  // Open if we have the "idx" option.
   WspecifierOptions opts_;
   std::string wspecifier_;
   std::string archive_wxfilename_;
@@ -1216,7 +1587,7 @@ class TableWriterScriptImpl: public TableWriterImplBase<Holder> {
                  << PrintableWxfilename(wxfilename);
       return false;
     }
-    if (!Holder::Write(output.Stream(), opts_.binary, value)
+    if (!TableObjectWriter<Holder>::Write(output.Stream(), opts_, value)
         || !output.Close()) {
       KALDI_WARN << "Failed to write data to "
                  << PrintableWxfilename(wxfilename);
@@ -1324,6 +1695,12 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
       state_ = kUninitialized;
       return false;
     }
+    if (opts_.index && !OpenIndex(&index_, archive_wxfilename_, wspecifier)) {
+      archive_output_.Close();
+      script_output_.Close();
+      state_ = kUninitialized;
+      return false;
+    }
     state_ = kOpen;
     return true;
   }
@@ -1381,7 +1758,8 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
     std::ostream &script_os = script_output_.Stream();
     script_output_.Stream() << key << ' ' << offset_rxfilename << '\n';
 
-    if (!Holder::Write(archive_output_.Stream(), opts_.binary, value)) {
+    if (!TableObjectWriter<Holder>::Write(archive_output_.Stream(), opts_,
+                                          value)) {
       KALDI_WARN << "Write failure to"
                  << PrintableWxfilename(archive_wxfilename_);
       state_ = kWriteError;
@@ -1405,6 +1783,8 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
     if (state_ == kWriteError) return false;  // Even if this Write seems to
     // have succeeded, we fail because a previous Write failed and the archive
     // may be corrupted and unreadable.
+    if (index_.IsOpen())
+      index_.Add(key, archive_os_pos, archive_os.tellp() - archive_os_pos);
 
     if (opts_.flush)
       Flush();
@@ -1418,6 +1798,7 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
       case kWriteError: case kOpen:
         archive_output_.Stream().flush();  // Don't check error status.
         script_output_.Stream().flush();  // Don't check error status.
+        if (index_.IsOpen()) index_.Flush();
         return;
       default:
         KALDI_WARN << "Flush called on not-open writer.";
@@ -1428,11 +1809,19 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
     if (!this->IsOpen())
       KALDI_ERR << "Close called on a stream that was not open.";
     bool close_success = true;
-    if (archive_output_.IsOpen())
+    int64 archive_size = 0;
+    if (archive_output_.IsOpen()) {
+      if (index_.IsOpen())
+        archive_size = archive_output_.Stream().tellp();
       if (!archive_output_.Close()) close_success = false;
+    }
     if (script_output_.IsOpen())
       if (!script_output_.Close()) close_success = false;
     bool ans = close_success && (state_ != kWriteError);
+    if (index_.IsOpen()) {
+      if (ans) ans = index_.Close(archive_size);
+      else index_.Abandon();
+    }
     state_ = kUninitialized;
     return ans;
   }
@@ -1451,6 +1840,7 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
  private:
   Output archive_output_;
   Output script_output_;
+  ArchiveIndexWriter index_;  // Open if we have the "idx" option.
   WspecifierOptions opts_;
   std::string archive_wxfilename_;
   std::string script_wxfilename_;
@@ -1463,6 +1853,154 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
 };
 
 
+// This is for when someone adds the 'bg' modifier to a wspecifier; it wraps
+// around one of the other implementations and does the writing, including
+// serialization and any compression, in a background thread.  Write() copies
+// the object and queues it, waiting if two objects are already pending (one
+// being written and one waiting), and returns; objects are written in the
+// order of the calls.  Objects of types that can't be copied are written in the
+// calling thread, once the queue is empty.  An error writing an object in the
+// background is reported by the next call to Write() or Close().  Flush()
+// waits until everything queued has been written.
+template<class Holder>
+class TableWriterBackgroundImpl: public TableWriterImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  explicit TableWriterBackgroundImpl(TableWriterImplBase<Holder> *base_writer):
+      base_writer_(base_writer), num_pending_(0), failed_(false),
+      closing_(false) { }
+
+  // This function ignores the wspecifier argument; base_writer_ must already
+  // be open.
+  virtual bool Open(const std::string &wspecifier) {
+    KALDI_ASSERT(base_writer_ != NULL &&
+                 base_writer_->IsOpen());  // or code error.
+    thread_ = std::thread(TableWriterBackgroundImpl<Holder>::run, this);
+    return true;
+  }
+
+  virtual bool IsOpen() const { return base_writer_ != NULL; }
+
+  virtual bool Write(const std::string &key, const T &value) {
+    if (!IsToken(key))  // e.g. empty string or has spaces...
+      KALDI_ERR << "Using invalid key " << key;
+    T *copy = CopyObject(value,
+                         typename std::is_copy_constructible<T>::type());
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Make room for 'copy', or wait for the queue to drain if there is none.
+    int32 max_pending = (copy != NULL ? kMaxPending - 1 : 0);
+    while (num_pending_ > max_pending)
+      done_cond_.wait(lock);
+    if (failed_) {
+      delete copy;
+      KALDI_WARN << "Not writing " << key << " as an earlier write failed.";
+      return false;
+    }
+    if (copy == NULL) {
+      // The background thread is idle, so we can write it here.
+      lock.unlock();
+      bool ans = base_writer_->Write(key, value);
+      if (!ans) failed_ = true;
+      return ans;
+    }
+    queue_.push_back(std::make_pair(key, copy));
+    num_pending_++;
+    lock.unlock();
+    queued_cond_.notify_one();
+    return true;
+  }
+
+  virtual void Flush() {
+    WaitForPending();
+    base_writer_->Flush();
+  }
+
+  virtual bool Close() {
+    KALDI_ASSERT(base_writer_ != NULL && thread_.joinable());
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closing_ = true;  // The thread exits after writing the queue.
+    }
+    queued_cond_.notify_one();
+    thread_.join();
+    bool ans = !failed_;
+    try {
+      if (!base_writer_->Close())
+        ans = false;
+    } catch (...) {
+      ans = false;
+    }
+    delete base_writer_;
+    base_writer_ = NULL;
+    return ans;
+  }
+
+  virtual ~TableWriterBackgroundImpl() {
+    if (base_writer_ != NULL && !Close())
+      KALDI_ERR << "Error detected closing background writer "
+                << "(relates to ',bg' modifier)";
+  }
+
+ private:
+  static const int32 kMaxPending = 2;
+
+  static T *CopyObject(const T &t, std::true_type) { return new T(t); }
+  static T *CopyObject(const T &t, std::false_type) { return NULL; }
+
+  void WaitForPending() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (num_pending_ > 0)
+      done_cond_.wait(lock);
+  }
+
+  void RunInBackground() {
+    while (true) {
+      std::pair<std::string, T*> item;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (queue_.empty() && !closing_)
+          queued_cond_.wait(lock);
+        if (queue_.empty())
+          return;  // closing_, and everything has been written.
+        item = queue_.front();
+        queue_.pop_front();
+      }
+      bool ans;
+      try {
+        ans = base_writer_->Write(item.first, *(item.second));
+      } catch (const std::exception &e) {
+        KALDI_WARN << "Exception caught writing " << item.first << ": "
+                   << e.what();
+        ans = false;
+      }
+      delete item.second;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!ans) failed_ = true;
+        num_pending_--;
+      }
+      done_cond_.notify_all();
+    }
+  }
+
+  static void run(TableWriterBackgroundImpl<Holder> *object) {
+    object->RunInBackground();
+  }
+
+  TableWriterImplBase<Holder> *base_writer_;
+  // The following are protected by mutex_ (failed_ is also written by Write()
+  // when the background thread is idle).
+  std::mutex mutex_;
+  std::deque<std::pair<std::string, T*> > queue_;
+  int32 num_pending_;  // Objects in queue_ or being written.
+  bool failed_;  // True if writing an object failed.
+  bool closing_;
+  std::condition_variable queued_cond_;  // Signaled when queue_ grows.
+  std::condition_variable done_cond_;  // Signaled when num_pending_ shrinks.
+  std::thread thread_;
+};
+
 template<class Holder>
 TableWriter<Holder>::TableWriter(const std::string &wspecifier): impl_(NULL) {
   if (wspecifier != "" && !Open(wspecifier))
@@ -1483,7 +2021,8 @@ bool TableWriter<Holder>::Open(const std::string &wspecifier) {
       KALDI_ERR << "Failed to close previously open writer.";
   }
   KALDI_ASSERT(impl_ == NULL);
-  WspecifierType wtype = ClassifyWspecifier(wspecifier, NULL, NULL, NULL);
+  WspecifierOptions opts;
+  WspecifierType wtype = ClassifyWspecifier(wspecifier, NULL, NULL, &opts);
   switch (wtype) {
     case kBothWspecifier:
       impl_ = new TableWriterBothImpl<Holder>();
@@ -1499,6 +2038,11 @@ bool TableWriter<Holder>::Open(const std::string &wspecifier) {
       return false;
   }
   if (impl_->Open(wspecifier)) {
+    if (opts.background) {
+      impl_ = new TableWriterBackgroundImpl<Holder>(impl_);
+      if (!impl_->Open(wspecifier))  // only fails on code error.
+        return false;
+    }
     return true;
   } else {  // The class will have printed a more specific warning.
     delete impl_;
@@ -1765,7 +2309,8 @@ class RandomAccessTableReaderScriptImpl:
         range_ = range;
         if (state_ == kNotHaveObject) {
           // we need to read the object.
-          if (!input_.Open(data_rxfilename)) {
+          if (!(opts_.mmap ? input_.OpenMapped(data_rxfilename) :
+                input_.Open(data_rxfilename))) {
             KALDI_WARN << "Error opening stream "
                        << PrintableRxfilename(data_rxfilename);
             return false;
@@ -1913,7 +2458,8 @@ class RandomAccessTableReaderArchiveImplBase:
     // NULL means don't expect binary-mode header
     bool ans;
     if (Holder::IsReadInBinary())
-      ans = input_.Open(archive_rxfilename_, NULL);
+      ans = (opts_.mmap ? input_.OpenMapped(archive_rxfilename_, NULL) :
+             input_.Open(archive_rxfilename_, NULL));
     else
       ans = input_.OpenTextMode(archive_rxfilename_);
     if (!ans) {  // header.
@@ -2504,6 +3050,117 @@ class RandomAccessTableReaderUnsortedArchiveImpl:
 
 
 
+// RandomAccessTableReaderIndexedArchiveImpl is for random-access reading of
+// archives that have an index (see ArchiveIndex), written with the "idx"
+// wspecifier option.  It reads the index when opened and then seeks directly to
+// each object that is asked for, like RandomAccessTableReaderScriptImpl does
+// with the offsets in an scp file, so it keeps only one object in memory and
+// the sorting options make no difference.
+
+template<class Holder>
+class RandomAccessTableReaderIndexedArchiveImpl:
+      public RandomAccessTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  RandomAccessTableReaderIndexedArchiveImpl(): state_(kUninitialized) { }
+
+  // Returns false if the index could not be used (it will have warned); the
+  // caller should then read the archive the normal way.
+  virtual bool Open(const std::string &rspecifier) {
+    if (state_ != kUninitialized)
+      KALDI_ERR << "Opening already open RandomAccessTableReader:"
+                   " call Close first.";
+    rspecifier_ = rspecifier;
+    RspecifierType rs = ClassifyRspecifier(rspecifier, &archive_rxfilename_,
+                                           &opts_);
+    KALDI_ASSERT(rs == kArchiveRspecifier);  // or wrongly called.
+    if (!index_.Read(archive_rxfilename_))
+      return false;
+    state_ = kNoObject;
+    return true;
+  }
+
+  virtual bool HasKey(const std::string &key) {
+    // In permissive mode, we have to check that we can read the object before
+    // we assert that the key is there.
+    return HasKeyInternal(key, opts_.permissive);
+  }
+
+  virtual const T &Value(const std::string &key) {
+    if (!HasKeyInternal(key, true))  // true == preload.
+      KALDI_ERR << "Could not get item for key " << key
+                << ", rspecifier is " << rspecifier_ << " [to ignore this, "
+                << "add the p, (permissive) option to the rspecifier.";
+    return holder_.Value();
+  }
+
+  virtual bool Close() {
+    if (state_ == kUninitialized)
+      KALDI_ERR << "Close() called on RandomAccessTableReader that was not"
+                   " open.";
+    holder_.Clear();
+    if (input_.IsOpen())
+      input_.Close();
+    state_ = kUninitialized;
+    return true;
+  }
+
+  virtual ~RandomAccessTableReaderIndexedArchiveImpl() { }
+
+ private:
+  bool HasKeyInternal(const std::string &key, bool preload) {
+    if (state_ == kUninitialized)
+      KALDI_ERR << "HasKey called on RandomAccessTableReader object that is"
+                   " not open.";
+    if (state_ == kHaveObject && key == key_)
+      return true;
+    int64 offset, size;
+    if (!index_.Lookup(key, &offset, &size))
+      return false;
+    if (!preload)
+      return true;
+    holder_.Clear();
+    state_ = kNoObject;
+    std::ostringstream data_rxfilename;
+    data_rxfilename << archive_rxfilename_ << ':' << offset;
+    bool ans;
+    // NULL means don't expect binary-mode header
+    if (Holder::IsReadInBinary())
+      ans = (opts_.mmap ? input_.OpenMapped(data_rxfilename.str(), NULL) :
+             input_.Open(data_rxfilename.str(), NULL));
+    else
+      ans = input_.OpenTextMode(data_rxfilename.str());
+    if (!ans) {
+      KALDI_WARN << "Error opening stream "
+                 << PrintableRxfilename(data_rxfilename.str());
+      return false;
+    }
+    if (!holder_.Read(input_.Stream())) {
+      KALDI_WARN << "Error reading object from stream "
+                 << PrintableRxfilename(data_rxfilename.str());
+      return false;
+    }
+    key_ = key;
+    state_ = kHaveObject;
+    return true;
+  }
+
+  Input input_;  // Kept open between objects, so we just seek in the archive.
+  RspecifierOptions opts_;
+  std::string rspecifier_;
+  std::string archive_rxfilename_;
+  ArchiveIndex index_;
+  std::string key_;  // The key of the object in holder_, if kHaveObject.
+  Holder holder_;
+  enum {
+    kUninitialized,
+    kNoObject,
+    kHaveObject
+  } state_;
+};
+
+
 template<class Holder>
 RandomAccessTableReader<Holder>::RandomAccessTableReader(const
                                                        std::string &rspecifier):
@@ -2518,12 +3175,20 @@ bool RandomAccessTableReader<Holder>::Open(const std::string &rspecifier) {
   if (IsOpen())
     KALDI_ERR << "Already open.";
   RspecifierOptions opts;
-  RspecifierType rs = ClassifyRspecifier(rspecifier, NULL, &opts);
+  std::string rxfilename;
+  RspecifierType rs = ClassifyRspecifier(rspecifier, &rxfilename, &opts);
   switch (rs) {
     case kScriptRspecifier:
       impl_ = new RandomAccessTableReaderScriptImpl<Holder>();
       break;
     case kArchiveRspecifier:
+      if (ArchiveIndex::Exists(rxfilename)) {
+        impl_ = new RandomAccessTableReaderIndexedArchiveImpl<Holder>();
+        if (impl_->Open(rspecifier))
+          return true;
+        // The index was out of date or unreadable; read the archive as usual.
+        delete impl_;
+      }
       if (opts.sorted) {
         if (opts.called_sorted)  // "doubly" sorted case.
           impl_ = new RandomAccessTableReaderDSortedArchiveImpl<Holder>();
@@ -16,8 +16,11 @@
 // MERCHANTABLITY OR NON-INFRINGEMENT.
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
+#include <fcntl.h>
+#include <sys/stat.h>
 #include "base/io-funcs.h"
 #include "util/kaldi-io.h"
+#include "util/kaldi-mmap.h"
 #include "base/kaldi-math.h"
 #include "util/kaldi-table.h"
 #include "util/kaldi-holder.h"
@@ -107,6 +110,24 @@ void UnitTestClassifyWspecifier() {
                  opts.binary == false);
   }
 
+  {
+    std::string a = "ark,scp,bg,compress:foo,bar";
+    std::string ark = "x", scp = "y";
+    WspecifierOptions opts;
+    WspecifierType ans = ClassifyWspecifier(a, &ark, &scp, &opts);
+    KALDI_ASSERT(ans == kBothWspecifier && ark == "foo" && scp == "bar" &&
+                 opts.background && opts.compress && !opts.index);
+  }
+
+  {
+    std::string a = "ark,idx,t:foo";
+    std::string ark = "x", scp = "y";
+    WspecifierOptions opts;
+    WspecifierType ans = ClassifyWspecifier(a, &ark, &scp, &opts);
+    KALDI_ASSERT(ans == kArchiveWspecifier && ark == "foo" && scp == "" &&
+                 opts.index && !opts.binary);
+  }
+
   {
     std::string a = "t,scp:a b c d";
     std::string ark = "x", scp = "y";
@@ -303,6 +324,26 @@ void UnitTestClassifyRspecifier() {
     KALDI_ASSERT(ans == kNoRspecifier);
   }
 
+  {
+    std::string a = "scp,mmap,s:foo", fname;
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &fname, &opts);
+    KALDI_ASSERT(ans == kScriptRspecifier && fname == "foo");
+    KALDI_ASSERT(opts.mmap && opts.sorted && !opts.once);
+  }
+
+  {
+    std::string a = "scp,bg=4:foo", fname;
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &fname, &opts);
+    KALDI_ASSERT(ans == kScriptRspecifier && fname == "foo");
+    KALDI_ASSERT(opts.background && opts.background_threads == 4);
+    KALDI_ASSERT(ClassifyRspecifier("scp,bg=0:foo", NULL, NULL) ==
+                 kNoRspecifier);
+    KALDI_ASSERT(ClassifyRspecifier("scp,bg=x:foo", NULL, NULL) ==
+                 kNoRspecifier);
+  }
+
   // Testing it accepts the meaningless t, and b, prefixes.
   {
     std::string a = "b,scp:a", b;
@@ -938,6 +979,8 @@ void UnitTestRangesMatrix(bool binary) {
     RandomAccessDoubleMatrixReader reader(permissive ?
                                           "scp,p:tmpf_ranges.scp" :
                                           "scp:tmpf_ranges.scp");
+    RandomAccessBaseFloatMatrixViewReader view_reader(
+        "scp,mmap:tmpf_ranges.scp");
 
     int32 num_queries = RandInt(0, 10);
     for (int32 n = 0; n < num_queries; n++) {
@@ -950,6 +993,8 @@ void UnitTestRangesMatrix(bool binary) {
           KALDI_ASSERT(reader.HasKey(key));
         Matrix<BaseFloat> value (reader.Value(key));
         KALDI_ASSERT(value.ApproxEqual(scp_intended_contents[i].second));
+        Matrix<BaseFloat> view_value(view_reader.Value(key));
+        KALDI_ASSERT(view_value.ApproxEqual(scp_intended_contents[i].second));
       }
     }
   }
@@ -975,6 +1020,290 @@ void UnitTestRangesMatrix(bool binary) {
   unlink("tmpf_ranges.scp");
 }
 
+void UnitTestTableMatrixView(bool binary, bool read_scp, bool mmap) {
+  int32 sz = RandInt(0, 10);
+  std::vector<std::string> k(sz);
+  std::vector<Matrix<BaseFloat> > v(sz);
+  for (int32 i = 0; i < sz; i++) {
+    // Keys of 4 characters put the data of binary float matrices at aligned
+    // offsets, so they can be used in place; a 5th makes them unaligned.
+    k[i] = std::string("utt") + static_cast<char>('a' + i);
+    if (i == sz - 1 && RandInt(0, 1) == 0) k[i] += 'x';
+    v[i].Resize(RandInt(1, 5), RandInt(1, 5));
+    v[i].SetRandn();
+  }
+  {
+    BaseFloatMatrixWriter writer(binary ? "ark,scp,b:tmpf,tmpf.scp" :
+                                 "ark,scp,t:tmpf,tmpf.scp");
+    for (int32 i = 0; i < sz; i++)
+      writer.Write(k[i], v[i]);
+  }
+  BaseFloat tolerance = (binary ? 1.0e-06 : 0.01);
+  std::string rspecifier = std::string(read_scp ? "scp" : "ark") +
+      (mmap ? ",mmap:" : ":") + (read_scp ? "tmpf.scp" : "tmpf");
+  std::shared_ptr<const MemoryMappedFile> file;
+  if (mmap && sz != 0) file = MemoryMappedFile::Open("tmpf");
+
+  {
+    SequentialBaseFloatMatrixViewReader reader(rspecifier);
+    int32 i = 0;
+    for (; !reader.Done(); reader.Next(), i++) {
+      KALDI_ASSERT(reader.Key() == k[i]);
+      const SubMatrix<BaseFloat> &value = reader.Value();
+      KALDI_ASSERT(v[i].ApproxEqual(value, tolerance));
+      // Check that aligned binary data is used in place.
+      bool in_place = (file != NULL &&
+                       reinterpret_cast<const char*>(value.Data()) >=
+                       file->Data() &&
+                       reinterpret_cast<const char*>(value.Data()) <
+                       file->Data() + file->Size());
+      KALDI_ASSERT(in_place == (mmap && binary && k[i].size() == 4));
+    }
+    KALDI_ASSERT(i == sz);
+  }
+  {
+    // Read through the usual holder too.
+    SequentialBaseFloatMatrixReader reader(rspecifier);
+    for (int32 i = 0; i < sz; i++, reader.Next())
+      KALDI_ASSERT(v[i].ApproxEqual(reader.Value(), tolerance));
+    KALDI_ASSERT(reader.Done());
+  }
+  {
+    RandomAccessBaseFloatMatrixViewReader reader(rspecifier);
+    for (int32 n = 0; n < 10 && sz != 0; n++) {
+      int32 i = RandInt(0, sz - 1);
+      KALDI_ASSERT(v[i].ApproxEqual(reader.Value(k[i]), tolerance));
+    }
+    KALDI_ASSERT(!reader.HasKey("foo"));
+  }
+  unlink("tmpf");
+  unlink("tmpf.scp");
+}
+
+// Overwrites the start of 'filename' with 'data', then sets its modification
+// time back to what it was plus 'mtime_nsec' nanoseconds.
+static void OverwriteFileStart(const char *filename, const std::string &data,
+                               int64 mtime_nsec) {
+  struct stat st;
+  KALDI_ASSERT(stat(filename, &st) == 0);
+  {
+    std::fstream fs(filename, std::ios::in | std::ios::out | std::ios::binary);
+    fs.write(data.data(), data.size());
+    KALDI_ASSERT(fs.good());
+  }
+  struct timespec times[2];
+#ifdef __APPLE__
+  times[0] = st.st_atimespec;
+  times[1] = st.st_mtimespec;
+#else
+  times[0] = st.st_atim;
+  times[1] = st.st_mtim;
+#endif
+  times[1].tv_nsec += mtime_nsec;
+  if (times[1].tv_nsec >= 1000000000) {
+    times[1].tv_sec++;
+    times[1].tv_nsec -= 1000000000;
+  }
+  KALDI_ASSERT(utimensat(AT_FDCWD, filename, times, 0) == 0);
+}
+
+void UnitTestTableIndexedArchive(bool binary, bool write_scp) {
+  int32 sz = RandInt(1, 10);
+  std::vector<std::string> k(sz);
+  std::vector<Matrix<double> > v(sz);
+  for (int32 i = 0; i < sz; i++) {
+    k[i] = CharToString('a' + static_cast<char>(i));
+    v[i].Resize(RandInt(1, 3), RandInt(1, 3));
+    v[i].SetRandn();
+  }
+  RandomizeVector(&k);
+  std::string wspecifier = std::string(write_scp ? "ark,scp" : "ark") +
+      (binary ? ",b,idx:tmpf" : ",t,idx:tmpf") +
+      (write_scp ? ",tmpf.scp" : "");
+  {
+    DoubleMatrixWriter writer(wspecifier);
+    for (int32 i = 0; i < sz; i++)
+      writer.Write(k[i], v[i]);
+    KALDI_ASSERT(writer.Close());
+  }
+  {
+    ArchiveIndex index;
+    KALDI_ASSERT(ArchiveIndex::Exists("tmpf") && index.Read("tmpf") &&
+                 index.NumKeys() == sz);
+  }
+  double tolerance = (binary ? 1.0e-10 : 0.01);
+  for (int32 pass = 0; pass < 4; pass++) {
+    if (pass == 1) {
+      // Garble the first key, keeping the size and modification time of the
+      // archive, so the index is still used.  The key is before the first
+      // object, so only a reader that reads the archive itself would notice.
+      OverwriteFileStart("tmpf", std::string(k[0].size(), '\0'), 0);
+      ArchiveIndex index;
+      KALDI_ASSERT(index.Read("tmpf"));
+    } else if (pass == 2) {
+      // Put the key back, with a modification time that differs by 1ns, as if
+      // the archive had been rewritten in the same second; the index should
+      // then be ignored.
+      OverwriteFileStart("tmpf", k[0], 1);
+      ArchiveIndex index;
+      KALDI_ASSERT(!index.Read("tmpf"));
+    } else if (pass == 3) {
+      // Make the index out of date by changing the size.
+      Output ko("tmpf_extra", false);
+      ko.Stream() << "z ";
+      KALDI_ASSERT(ko.Close());
+      KALDI_ASSERT(system("cat tmpf_extra >> tmpf") == 0);
+      ArchiveIndex index;
+      KALDI_ASSERT(!index.Read("tmpf"));
+    }
+    // The "z" we appended is not a valid object, so in pass 3 don't ask for
+    // keys that are not there.
+    RandomAccessDoubleMatrixReader reader(pass < 3 ? "ark:tmpf" :
+                                          "ark,p:tmpf");
+    if (pass == 1) {
+      // Without the index, the garbled key would make this fail.
+      KALDI_ASSERT(reader.HasKey(k[0]) &&
+                   v[0].ApproxEqual(reader.Value(k[0]), tolerance));
+    }
+    for (int32 n = 0; n < 10 && sz != 0; n++) {
+      int32 i = RandInt(0, sz - 1);
+      if (RandInt(0, 1) == 0)
+        KALDI_ASSERT(reader.HasKey(k[i]));
+      KALDI_ASSERT(v[i].ApproxEqual(reader.Value(k[i]), tolerance));
+    }
+    if (pass < 3)
+      KALDI_ASSERT(!reader.HasKey("foo"));
+  }
+  unlink("tmpf");
+  unlink("tmpf.idx");
+  unlink("tmpf.scp");
+  unlink("tmpf_extra");
+}
+
+void UnitTestTableSequentialParallel(bool binary, bool permissive) {
+  // Write the objects to several archives, and an scp file that refers to
+  // them in a different order, with some ranges and (if 'permissive') some
+  // entries that can't be read.
+  int32 num_archives = RandInt(1, 3), sz = RandInt(0, 30);
+  std::vector<std::string> scp_lines;
+  std::vector<std::pair<std::string, Matrix<BaseFloat> > > expected;
+  for (int32 a = 0; a < num_archives; a++) {
+    std::ostringstream wspecifier;
+    wspecifier << "ark,scp," << (binary ? "b" : "t") << ":tmpf" << a
+               << ",tmpf" << a << ".scp";
+    BaseFloatMatrixWriter writer(wspecifier.str());
+    for (int32 i = a; i < sz; i += num_archives) {
+      std::ostringstream key;
+      key << "key" << i;
+      Matrix<BaseFloat> mat(RandInt(1, 4), RandInt(1, 4));
+      mat.SetRandn();
+      writer.Write(key.str(), mat);
+    }
+  }
+  for (int32 a = 0; a < num_archives; a++) {
+    std::ostringstream scp_name;
+    scp_name << "tmpf" << a << ".scp";
+    std::vector<std::pair<std::string, std::string> > script;
+    KALDI_ASSERT(ReadScriptFile(scp_name.str(), true, &script));
+    SequentialBaseFloatMatrixReader reader("scp:" + scp_name.str());
+    for (size_t i = 0; i < script.size(); i++, reader.Next()) {
+      const Matrix<BaseFloat> &mat = reader.Value();
+      std::string line = script[i].first + " " + script[i].second;
+      if (RandInt(0, 2) == 0 && mat.NumRows() > 1) {
+        line += "[1:1]";
+        expected.push_back(std::make_pair(
+            script[i].first, Matrix<BaseFloat>(mat.RowRange(1, 1))));
+      } else {
+        expected.push_back(std::make_pair(script[i].first, mat));
+      }
+      scp_lines.push_back(line);
+    }
+    KALDI_ASSERT(reader.Done());
+    unlink(scp_name.str().c_str());
+  }
+  std::vector<int32> order(scp_lines.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  RandomizeVector(&order);
+  {
+    Output ko("tmpf.scp", false);
+    for (size_t i = 0; i < order.size(); i++) {
+      if (permissive && RandInt(0, 3) == 0)
+        ko.Stream() << "bad" << i << " nonexistent_file\n";
+      ko.Stream() << scp_lines[order[i]] << '\n';
+    }
+  }
+  std::ostringstream rspecifier;
+  rspecifier << "scp," << (permissive ? "p," : "") << "bg=" << RandInt(2, 5)
+             << ":tmpf.scp";
+  SequentialBaseFloatMatrixReader reader(rspecifier.str());
+  for (size_t i = 0; i < order.size(); i++, reader.Next()) {
+    KALDI_ASSERT(!reader.Done() && reader.Key() == expected[order[i]].first);
+    KALDI_ASSERT(reader.Value().ApproxEqual(expected[order[i]].second,
+                                            binary ? 1.0e-06 : 0.01));
+    if (RandInt(0, 1) == 0)
+      reader.FreeCurrent();
+  }
+  KALDI_ASSERT(reader.Done() && reader.Close());
+  for (int32 a = 0; a < num_archives; a++) {
+    std::ostringstream name;
+    name << "tmpf" << a;
+    unlink(name.str().c_str());
+  }
+  unlink("tmpf.scp");
+}
+
+void UnitTestTableBackgroundWriter(bool binary, bool write_scp,
+                                   bool compress) {
+  int32 sz = RandInt(0, 20);
+  std::vector<std::string> k(sz);
+  std::vector<Matrix<BaseFloat> > v(sz);
+  for (int32 i = 0; i < sz; i++) {
+    std::ostringstream key;
+    key << "key" << i;
+    k[i] = key.str();
+    v[i].Resize(RandInt(1, 10), RandInt(1, 10));
+    v[i].SetRandn();
+  }
+  std::string wspecifier = std::string(write_scp ? "ark,scp" : "ark") +
+      (binary ? ",b" : ",t") + (compress ? ",compress" : "") + ",bg:tmpf" +
+      (write_scp ? ",tmpf.scp" : "");
+  BaseFloatMatrixWriter writer(wspecifier);
+  int32 num_flushed = RandInt(0, sz);
+  for (int32 i = 0; i < sz; i++) {
+    if (i == num_flushed)
+      writer.Flush();
+    writer.Write(k[i], v[i]);
+    // The writer has its own copy.
+    v[i].Scale(2.0);
+  }
+  if (num_flushed != sz) {
+    // Everything written before Flush() must be in the file by now.
+    SequentialBaseFloatMatrixReader reader("ark:tmpf");
+    int32 n = 0;
+    for (; !reader.Done() && n < num_flushed; reader.Next(), n++)
+      KALDI_ASSERT(reader.Key() == k[n]);
+    KALDI_ASSERT(n == num_flushed);
+  }
+  KALDI_ASSERT(writer.Close());
+
+  for (int32 pass = 0; pass < (write_scp ? 2 : 1); pass++) {
+    SequentialBaseFloatMatrixReader reader(pass == 0 ? "ark:tmpf" :
+                                           "scp:tmpf.scp");
+    for (int32 i = 0; i < sz; i++, reader.Next()) {
+      KALDI_ASSERT(!reader.Done() && reader.Key() == k[i]);
+      Matrix<BaseFloat> expected(v[i]);
+      expected.Scale(0.5);
+      if (compress)
+        CompressedMatrix(expected).CopyToMat(&expected);
+      KALDI_ASSERT(expected.ApproxEqual(reader.Value(),
+                                        binary ? 1.0e-05 : 0.01));
+    }
+    KALDI_ASSERT(reader.Done() && reader.Close());
+  }
+  unlink("tmpf");
+  unlink("tmpf.scp");
+}
+
 void UnitTestTableRandomBothDoubleMatrix(bool binary, bool read_scp,
                                          bool sorted, bool called_sorted,
                                          bool once) {
@@ -1074,6 +1403,12 @@ int main() {
       UnitTestTableSequentialInt32PairVectorBoth(b, c);
       UnitTestTableSequentialInt32VectorVectorBoth(b, c);
       UnitTestTableSequentialBaseFloatVectorBoth(b, c);
+      UnitTestTableMatrixView(b, c, false);
+      UnitTestTableMatrixView(b, c, true);
+      UnitTestTableIndexedArchive(b, c);
+      UnitTestTableSequentialParallel(b, c);
+      UnitTestTableBackgroundWriter(b, c, false);
+      UnitTestTableBackgroundWriter(b, c, true);
       for (int k = 0; k < 2; k++) {
         bool d = (k == 0);
         for (int l = 0; l < 2; l++) {
@@ -18,6 +18,8 @@
 // limitations under the License.
 
 #include "util/kaldi-table.h"
+#include <sys/stat.h>
+#include "util/kaldi-block-compress.h"
 #include "util/text-utils.h"
 
 namespace kaldi {
@@ -183,6 +185,12 @@ WspecifierType ClassifyWspecifier(const std::string &wspecifier,
       if (opts) opts->binary = false;
     } else if (!strcmp(c, "p")) {
       if (opts) opts->permissive = true;
+    } else if (!strcmp(c, "idx")) {
+      if (opts) opts->index = true;
+    } else if (!strcmp(c, "bg")) {
+      if (opts) opts->background = true;
+    } else if (!strcmp(c, "compress")) {
+      if (opts) opts->compress = true;
     } else if (!strcmp(c, "ark")) {
       if (ws == kNoWspecifier) ws = kArchiveWspecifier;
       else
@@ -293,6 +301,16 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
       if (opts) opts->called_sorted = false;
     } else if (!strcmp(c, "bg")) {
       if (opts) opts->background = true;
+    } else if (!strncmp(c, "bg=", 3)) {
+      int32 num_threads;
+      if (!ConvertStringToInteger(c + 3, &num_threads) || num_threads < 1)
+        return kNoRspecifier;
+      if (opts) {
+        opts->background = true;
+        opts->background_threads = num_threads;
+      }
+    } else if (!strcmp(c, "mmap")) {
+      if (opts) opts->mmap = true;
     } else if (!strcmp(c, "ark")) {
       if (rs == kNoRspecifier) rs = kArchiveRspecifier;
       else
@@ -314,8 +332,133 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
 }
 
 
+// Gets the size and the modification time of 'filename'; returns false if it
+// could not be stat'ed.  The nanoseconds are zero where stat() does not
+// provide them.
+static bool StatArchive(const std::string &filename, int64 *file_size,
+                        int64 *mtime_sec, int64 *mtime_nsec) {
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0)
+    return false;
+  *file_size = st.st_size;
+  *mtime_sec = st.st_mtime;
+#if defined(__APPLE__)
+  *mtime_nsec = st.st_mtimespec.tv_nsec;
+#elif defined(_MSC_VER)
+  *mtime_nsec = 0;
+#else
+  *mtime_nsec = st.st_mtim.tv_nsec;
+#endif
+  return true;
+}
+
+bool ArchiveIndex::Exists(const std::string &archive_rxfilename) {
+  if (ClassifyRxfilename(archive_rxfilename) != kFileInput)
+    return false;
+  struct stat st;
+  return stat(IndexFilename(archive_rxfilename).c_str(), &st) == 0;
+}
+
+bool ArchiveIndex::Read(const std::string &archive_filename) {
+  entries_.clear();
+  std::string index_filename = IndexFilename(archive_filename);
+  int64 file_size, mtime_sec, mtime_nsec;
+  if (!StatArchive(archive_filename, &file_size, &mtime_sec, &mtime_nsec)) {
+    KALDI_WARN << "Could not stat archive " << archive_filename;
+    return false;
+  }
+  int64 archive_size = file_size;
+  if (IsBlockCompressedFilename(archive_filename)) {
+    // The offsets are into the uncompressed data.
+    BlockCompressedInputStreambuf buf;
+    if (!buf.Open(archive_filename) || !buf.UncompressedSize(&archive_size))
+      return false;
+  }
+  Input ki;
+  if (!ki.OpenTextMode(index_filename)) {
+    KALDI_WARN << "Could not open index " << index_filename;
+    return false;
+  }
+  std::istream &is = ki.Stream();
+  std::string line;
+  std::vector<std::string> fields;
+  bool finished = false;
+  while (std::getline(is, line)) {
+    SplitStringToVector(line, " \t\r", true, &fields);
+    int64 offset, size, end_fields[4];
+    if (!finished && fields.size() == 3 && IsToken(fields[0]) &&
+        ConvertStringToInteger(fields[1], &offset) &&
+        ConvertStringToInteger(fields[2], &size) &&
+        offset >= 0 && size >= 0 && offset + size <= archive_size) {
+      // insert() keeps the first entry for a key.
+      entries_.insert(std::make_pair(fields[0], std::make_pair(offset, size)));
+    } else if (!finished && fields.size() == 5 && fields[0] == "#end" &&
+               ConvertStringToInteger(fields[1], &end_fields[0]) &&
+               ConvertStringToInteger(fields[2], &end_fields[1]) &&
+               ConvertStringToInteger(fields[3], &end_fields[2]) &&
+               ConvertStringToInteger(fields[4], &end_fields[3])) {
+      if (end_fields[0] != archive_size || end_fields[1] != file_size ||
+          end_fields[2] != mtime_sec || end_fields[3] != mtime_nsec) {
+        KALDI_WARN << "Ignoring index " << index_filename << " as the archive "
+                   << "has been modified since it was written.";
+        entries_.clear();
+        return false;
+      }
+      finished = true;
+    } else {
+      KALDI_WARN << "Ignoring index " << index_filename << ": bad line '"
+                 << line << "' (written by a writer that failed, or for a "
+                 << "different archive?)";
+      entries_.clear();
+      return false;
+    }
+  }
+  if (!finished) {
+    KALDI_WARN << "Ignoring index " << index_filename << " as it is "
+               << "incomplete (archive not closed properly?)";
+    entries_.clear();
+    return false;
+  }
+  return true;
+}
+
+bool ArchiveIndex::Lookup(const std::string &key, int64 *offset,
+                          int64 *size) const {
+  unordered_map<std::string, std::pair<int64, int64>,
+                StringHasher>::const_iterator iter = entries_.find(key);
+  if (iter == entries_.end())
+    return false;
+  *offset = iter->second.first;
+  *size = iter->second.second;
+  return true;
+}
 
+bool ArchiveIndexWriter::Open(const std::string &archive_filename) {
+  archive_filename_ = archive_filename;
+  filename_ = ArchiveIndex::IndexFilename(archive_filename);
+  return output_.Open(filename_, false, false);  // text mode, no header.
+}
 
+bool ArchiveIndexWriter::Close(int64 archive_size) {
+  int64 file_size, mtime_sec, mtime_nsec;
+  if (!StatArchive(archive_filename_, &file_size, &mtime_sec, &mtime_nsec)) {
+    KALDI_WARN << "Could not stat archive " << archive_filename_
+               << "; not finishing its index " << filename_;
+    Abandon();
+    return false;
+  }
+  output_.Stream() << "#end " << archive_size << ' ' << file_size << ' '
+                   << mtime_sec << ' ' << mtime_nsec << '\n';
+  if (!output_.Close()) {
+    KALDI_WARN << "Error closing archive index " << filename_;
+    return false;
+  }
+  return true;
+}
 
+void ArchiveIndexWriter::Abandon() {
+  if (output_.IsOpen())
+    output_.Close();  // Don't care about status.
+}
 
 }  // end namespace kaldi
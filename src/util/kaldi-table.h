@@ -27,6 +27,7 @@
 
 #include "base/kaldi-common.h"
 #include "util/kaldi-holder.h"
+#include "util/stl-utils.h"
 
 namespace kaldi {
 
@@ -71,12 +72,25 @@ typedef std::vector<std::string> KeyList;
 //  p means permissive mode, when writing to an "scp" file only: will ignore
 //     missing scp entries, i.e. won't write anything for those files but will
 //     return success status).
+//  bg means "background": objects are written, and compressed if requested,
+//     by a background thread, so Write() returns as soon as the object is
+//     queued (see TableWriterBackgroundImpl).  Objects are still written in
+//     order, and Flush() and Close() wait until they have been written.
+//  compress means write matrices (of type Matrix or GeneralMatrix) in
+//     compressed form, as CompressedMatrix; readers of Matrix read them
+//     transparently.  Has no effect for other types.
+//  idx means write an index of the archive to <archive-filename>.idx, when
+//     writing an archive that is an actual file (see ArchiveIndex).
+//     RandomAccessTableReader uses it to go straight to the requested key,
+//     instead of reading the archive up to it.
 //
 //  So the following are valid wspecifiers:
 //  ark,b,f:foo
 //  "ark,b,b:| gzip -c > foo"
 //  "ark,scp,t,nf:foo.ark,|gzip -c > foo.scp.gz"
 //  ark,b:-
+//  ark,idx:foo.ark
+//  "ark,bg,compress:| gzip -c > foo.ark.gz"
 //
 //  The meanings of rxfilename and wxfilename are as described in
 //  kaldi-stream.h (they are filenames but include pipes, stdin/stdout
@@ -114,7 +128,11 @@ struct WspecifierOptions {
   bool binary;
   bool flush;
   bool permissive;  // will ignore absent scp entries.
-  WspecifierOptions(): binary(true), flush(false), permissive(false) { }
+  bool index;  // write <archive-filename>.idx.
+  bool background;  // write in a background thread.
+  bool compress;  // write matrices as CompressedMatrix.
+  WspecifierOptions(): binary(true), flush(false), permissive(false),
+                       index(false), background(false), compress(false) { }
 };
 
 // ClassifyWspecifier returns the type of the wspecifier string,
@@ -189,6 +207,16 @@ bool WriteScriptFile(std::ostream &os,
 //       value, in a background thread.  Recommended when reading larger objects
 //       such as neural-net training examples, especially when you want to
 //       maximize GPU usage.
+//   bg=N (e.g. bg=8), for sequential reading of scp files, loads up to N
+//       objects at a time in N background threads, with up to 2N objects
+//       read ahead; they are still returned in the order of the scp file.
+//       Helpful when the scp entries point to files on slow or network
+//       storage.  For archives it is the same as "bg".
+//   mmap means the archives (for "ark:"), or the files the scp entries point
+//       to (for "scp:"), are read through a memory mapping that is shared by
+//       all readers in the process (see Input::OpenMapped()).  It has no effect
+//       on pipes and the standard input.  With MatrixViewHolder, matrices
+//       stored uncompressed in binary form are used in place, without copying.
 //
 //   b   is ignored [for scripting convenience]
 //   t   is ignored [for scripting convenience]
@@ -211,9 +239,14 @@ struct  RspecifierOptions {
   bool background;  // For sequential readers, if the background option ("bg")
                     // is provided, it will read ahead to the next object in a
                     // background thread.
+  int32 background_threads;  // With "bg=N", N background threads read an scp
+                             // file's entries in parallel; "bg" means 1.
+  bool mmap;  // If "mmap" is provided, files are read through a memory
+              // mapping; see Input::OpenMapped().
   RspecifierOptions(): once(false), sorted(false),
                        called_sorted(false), permissive(false),
-                       background(false) { }
+                       background(false), background_threads(1),
+                       mmap(false) { }
 };
 
 enum RspecifierType  {
@@ -227,6 +260,75 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
                                   RspecifierOptions *opts);
 
 
+/// The index of an archive, written to <archive-filename>.idx by TableWriter
+/// with the "idx" wspecifier option.  It is a text file with a line
+///   key offset size
+/// for each object, where 'offset' is the byte offset of the object (just after
+/// the key and space) in the archive and 'size' is the number of bytes it
+/// takes up; then a last line
+///   #end data-size file-size mtime-seconds mtime-nanoseconds
+/// that is written when the archive was closed successfully.  'data-size' is
+/// the size of the archive data (the uncompressed size, for a ".z" archive),
+/// and the rest come from stat() on the archive file just after it was closed.
+/// An index without that line, or one for an archive whose size or
+/// modification time is not exactly the recorded one (e.g. it was rewritten in
+/// the same second), is ignored.
+class ArchiveIndex {
+ public:
+  static std::string IndexFilename(const std::string &archive_filename) {
+    return archive_filename + ".idx";
+  }
+
+  /// Returns true if 'archive_rxfilename' is a regular file for which an index
+  /// file exists.  It may still be out of date; Read() checks that.
+  static bool Exists(const std::string &archive_rxfilename);
+
+  /// Reads the index of 'archive_filename'.  Returns false, with a warning,
+  /// if it cannot be read or does not match the archive.  Where a key appears
+  /// more than once, the first object is kept, as when reading the archive.
+  bool Read(const std::string &archive_filename);
+
+  /// Outputs the position of the object for 'key'; returns false if it is not
+  /// in the archive.
+  bool Lookup(const std::string &key, int64 *offset, int64 *size) const;
+
+  size_t NumKeys() const { return entries_.size(); }
+
+ private:
+  unordered_map<std::string, std::pair<int64, int64>, StringHasher> entries_;
+};
+
+/// Writes the index of an archive; used by TableWriter.
+class ArchiveIndexWriter {
+ public:
+  /// Opens <archive_filename>.idx for writing.  'archive_filename' must be the
+  /// filename of the archive, as Close() stats it.
+  bool Open(const std::string &archive_filename);
+
+  bool IsOpen() { return output_.IsOpen(); }
+
+  /// Records an object that was written to the archive.
+  void Add(const std::string &key, int64 offset, int64 size) {
+    output_.Stream() << key << ' ' << offset << ' ' << size << '\n';
+  }
+
+  void Flush() { output_.Stream().flush(); }
+
+  /// Finishes the index of an archive that was closed successfully and has
+  /// 'archive_size' bytes of data.  Returns false on error.
+  bool Close(int64 archive_size);
+
+  /// Closes the index without finishing it, after an error writing the
+  /// archive; it will be ignored by readers.
+  void Abandon();
+
+ private:
+  Output output_;
+  std::string archive_filename_;
+  std::string filename_;
+};
+
+
 /// Allows random access to a collection
 /// of objects in an archive or script file; see \ref io_sec_tables.
 template<class Holder>
@@ -0,0 +1,158 @@
+// util/open-hash-list-inl.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_OPEN_HASH_LIST_INL_H_
+#define KALDI_UTIL_OPEN_HASH_LIST_INL_H_
+
+// Do not include this file directly.  It is included by open-hash-list.h
+
+
+namespace kaldi {
+
+template<class I, class T> OpenHashList<I, T>::OpenHashList():
+    list_head_(NULL), list_tail_(NULL), num_elems_(0), mask_(0), shift_(64),
+    stamp_(1), freed_head_(NULL) { }
+
+template<class I, class T> void OpenHashList<I, T>::SetSize(size_t size) {
+  KALDI_ASSERT(list_head_ == NULL);  // make sure empty.
+  if (size > slots_.size())
+    Rehash(size);
+}
+
+template<class I, class T> void OpenHashList<I, T>::Rehash(size_t size) {
+  size_t new_size = 16;
+  int32 log_size = 4;
+  while (new_size < size) {
+    new_size <<= 1;
+    log_size++;
+  }
+  Slot empty;
+  empty.key = 0;
+  empty.stamp = 0;
+  empty.elem = NULL;
+  slots_.assign(new_size, empty);
+  mask_ = new_size - 1;
+  shift_ = 64 - log_size;
+  stamp_ = 1;
+  for (Elem *e = list_head_; e != NULL; e = e->tail) {
+    size_t index = Index(e->key);
+    while (slots_[index].stamp == stamp_)
+      index = (index + 1) & mask_;
+    slots_[index].key = e->key;
+    slots_[index].stamp = stamp_;
+    slots_[index].elem = e;
+  }
+}
+
+template<class I, class T>
+typename OpenHashList<I, T>::Elem* OpenHashList<I, T>::Clear() {
+  // Clears the hashtable and gives ownership of the currently contained list
+  // to the user.
+  Elem *ans = list_head_;
+  list_head_ = NULL;
+  list_tail_ = NULL;
+  num_elems_ = 0;
+  if (++stamp_ == 0) {  // wrapped around: stale stamps could look current.
+    for (size_t i = 0; i < slots_.size(); i++)
+      slots_[i].stamp = 0;
+    stamp_ = 1;
+  }
+  return ans;
+}
+
+template<class I, class T>
+inline void OpenHashList<I, T>::Delete(Elem *e) {
+  e->tail = freed_head_;
+  freed_head_ = e;
+}
+
+template<class I, class T>
+inline typename OpenHashList<I, T>::Elem* OpenHashList<I, T>::Find(I key) {
+  if (slots_.empty()) return NULL;
+  for (size_t index = Index(key); ; index = (index + 1) & mask_) {
+    const Slot &slot = slots_[index];
+    if (slot.stamp != stamp_) return NULL;  // empty slot: not found.
+    if (slot.key == key) return slot.elem;
+  }
+}
+
+template<class I, class T>
+inline typename OpenHashList<I, T>::Elem* OpenHashList<I, T>::New() {
+  if (freed_head_) {
+    Elem *ans = freed_head_;
+    freed_head_ = freed_head_->tail;
+    return ans;
+  } else {
+    Elem *tmp = new Elem[allocate_block_size_];
+    for (size_t i = 0; i+1 < allocate_block_size_; i++)
+      tmp[i].tail = tmp+i+1;
+    tmp[allocate_block_size_-1].tail = NULL;
+    freed_head_ = tmp;
+    allocated_.push_back(tmp);
+    return this->New();
+  }
+}
+
+template<class I, class T>
+OpenHashList<I, T>::~OpenHashList() {
+  // First test whether we had any memory leak within the
+  // OpenHashList, i.e. things for which the user did not call Delete().
+  size_t num_in_list = 0, num_allocated = 0;
+  for (Elem *e = freed_head_; e != NULL; e = e->tail)
+    num_in_list++;
+  for (size_t i = 0; i < allocated_.size(); i++) {
+    num_allocated += allocate_block_size_;
+    delete[] allocated_[i];
+  }
+  if (num_in_list != num_allocated) {
+    KALDI_WARN << "Possible memory leak: " << num_in_list
+               << " != " << num_allocated
+               << ": you might have forgotten to call Delete on "
+               << "some Elems";
+  }
+}
+
+template<class I, class T>
+void OpenHashList<I, T>::Insert(I key, T val) {
+  Elem *elem = New();
+  elem->key = key;
+  elem->val = val;
+  elem->tail = NULL;
+  if (list_tail_ == NULL) list_head_ = elem;
+  else list_tail_->tail = elem;
+  list_tail_ = elem;
+  num_elems_++;
+
+  if (num_elems_ * 4 > slots_.size() * 3) {
+    // Rehash() re-inserts the whole list, including the new element.
+    Rehash(slots_.size() * 2);
+    return;
+  }
+  size_t index = Index(key);
+  while (slots_[index].stamp == stamp_)
+    index = (index + 1) & mask_;
+  Slot &slot = slots_[index];
+  slot.key = key;
+  slot.stamp = stamp_;
+  slot.elem = elem;
+}
+
+
+}  // end namespace kaldi
+
+#endif  // KALDI_UTIL_OPEN_HASH_LIST_INL_H_
@@ -0,0 +1,132 @@
+// util/open-hash-list-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "util/open-hash-list.h"
+#include <map>  // for baseline.
+#include <cstdlib>
+#include <iostream>
+
+namespace kaldi {
+
+template<class Int, class T> void TestOpenHashList() {
+  typedef typename OpenHashList<Int, T>::Elem Elem;
+
+  OpenHashList<Int, T> hash;
+  hash.SetSize(Rand() % 2 == 0 ? 200 : 4);  // the small size forces rehashing.
+  std::map<Int, T> m1;
+  for (size_t j = 0; j < 50; j++) {
+    Int key = Rand() % 200;
+    T val = Rand() % 50;
+    m1[key] = val;
+    Elem *e = hash.Find(key);
+    if (e) e->val = val;
+    else  hash.Insert(key, val);
+  }
+
+  std::map<Int, T> m2;
+
+  for (int i = 0; i < 100; i++) {
+    m2.clear();
+    for (typename std::map<Int, T>::const_iterator iter = m1.begin();
+        iter != m1.end();
+        iter++) {
+      m2[iter->first + 1] = iter->second;
+    }
+    std::swap(m1, m2);
+
+    Elem *h = hash.Clear(), *tmp;
+
+    hash.SetSize(100 + Rand() % 100);
+
+    for (; h != NULL; h = tmp) {
+      KALDI_ASSERT(hash.Find(h->key + 1) == NULL);
+      hash.Insert(h->key + 1, h->val);
+      tmp = h->tail;
+      hash.Delete(h);  // think of this like calling delete.
+    }
+
+    // Now make sure h and m2 are the same.
+    const Elem *list = hash.GetList();
+    size_t count = 0;
+    for (; list != NULL; list = list->tail, count++) {
+      KALDI_ASSERT(m1[list->key] == list->val);
+    }
+
+    for (size_t j = 0; j < 10; j++) {
+      Int key = Rand() % 200;
+      bool found_m1 = (m1.find(key) != m1.end());
+      Elem *e = hash.Find(key);
+      KALDI_ASSERT((e != NULL) == found_m1);
+      if (found_m1)
+        KALDI_ASSERT(m1[key] == e->val);
+    }
+
+    KALDI_ASSERT(m1.size() == count);
+  }
+  for (Elem *h = hash.Clear(), *tmp; h != NULL; h = tmp) {
+    tmp = h->tail;
+    hash.Delete(h);
+  }
+}
+
+// Checks that the list is in insertion order, and that Find() works after the
+// table has grown well beyond the size given to SetSize().
+void TestOpenHashListGrowth() {
+  typedef OpenHashList<int32, int32>::Elem Elem;
+  OpenHashList<int32, int32> hash;
+  hash.SetSize(16);
+  std::vector<int32> keys;
+  for (int32 i = 0; i < 10000; i++) {
+    int32 key = RandInt(-100000, 100000);
+    if (hash.Find(key) == NULL) {
+      hash.Insert(key, i);
+      keys.push_back(key);
+    }
+  }
+  KALDI_ASSERT(hash.Size() >= keys.size());
+  size_t n = 0;
+  for (const Elem *e = hash.GetList(); e != NULL; e = e->tail, n++)
+    KALDI_ASSERT(e->key == keys[n]);
+  KALDI_ASSERT(n == keys.size());
+  for (size_t i = 0; i < keys.size(); i++)
+    KALDI_ASSERT(hash.Find(keys[i])->key == keys[i]);
+  for (Elem *h = hash.Clear(), *tmp; h != NULL; h = tmp) {
+    tmp = h->tail;
+    hash.Delete(h);
+  }
+  for (size_t i = 0; i < keys.size(); i++)
+    KALDI_ASSERT(hash.Find(keys[i]) == NULL);
+}
+
+
+}  // end namespace kaldi
+
+
+
+int main() {
+  using namespace kaldi;
+  for (size_t i = 0;i < 3;i++) {
+    TestOpenHashList<int, unsigned int>();
+    TestOpenHashList<unsigned int, int>();
+    TestOpenHashList<int16, int32>();
+    TestOpenHashList<int64, int32>();
+    TestOpenHashList<unsigned char, int>();
+  }
+  TestOpenHashListGrowth();
+  std::cout << "Test OK.\n";
+}
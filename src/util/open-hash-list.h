@@ -0,0 +1,146 @@
+// util/open-hash-list.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_OPEN_HASH_LIST_H_
+#define KALDI_UTIL_OPEN_HASH_LIST_H_
+#include <vector>
+#include <limits>
+#include <type_traits>
+#include "util/stl-utils.h"
+
+
+/* OpenHashList has the same interface and semantics as HashList (see
+   hash-list.h), except that InsertMore() is not supported, and can be used in
+   its place in the decoders.  The difference is in the hash: HashList chains
+   the Elems of each bucket, so every lookup goes through a bucket and then
+   through one or more Elems, which are scattered in memory.  OpenHashList
+   uses open addressing with linear probing over a single array of slots, and
+   stores the key in the slot, so a lookup usually touches a single cache
+   line and only dereferences the Elem if the key is found.
+
+   Each slot carries a stamp, and a slot only counts as occupied if its stamp
+   equals the current one; so Clear() just increments the stamp and does not
+   need to visit the slots.  The table doubles in size if it becomes more than
+   3/4 full; SetSize() should still be called with a sensible size (about
+   twice the expected number of elements), as with HashList.
+
+   The list of elements is kept in insertion order.  The key type I must be
+   an integer type.
+*/
+
+
+namespace kaldi {
+
+template<class I, class T> class OpenHashList {
+ public:
+  struct Elem {
+    I key;
+    T val;
+    Elem *tail;
+  };
+
+  /// Constructor takes no arguments.
+  /// Call SetSize to inform it of the likely size.
+  OpenHashList();
+
+  /// Clears the hash and gives the head of the current list to the user;
+  /// ownership is transferred to the user (the user must call Delete()
+  /// for each element in the list, at his/her leisure).
+  Elem *Clear();
+
+  /// Gives the head of the current list to the user.  Ownership retained in
+  /// the class.
+  const Elem *GetList() const { return list_head_; }
+
+  /// Think of this like delete().  It is to be called for each Elem in turn
+  /// after you "obtained ownership" by doing Clear().
+  inline void Delete(Elem *e);
+
+  /// This should probably not be needed to be called directly by the user.
+  /// Think of it as opposite to Delete();
+  inline Elem *New();
+
+  /// Find tries to find this element in the current list using the hashtable.
+  /// It returns NULL if not present.  The Elem it returns is not owned by the
+  /// user, it is part of the internal list owned by this object, but the user
+  /// is free to modify the "val" element.
+  inline Elem *Find(I key);
+
+  /// Insert inserts a new element into the hashtable/stored list.  By calling
+  /// this, the user asserts that it is not already present (e.g. Find was
+  /// called and returned NULL).
+  inline void Insert(I key, T val);
+
+  /// SetSize tells the object how many hash slots to allocate (should
+  /// typically be at least twice the number of objects we expect to go in the
+  /// structure); it is rounded up to a power of two.  It must be called while
+  /// the hash is empty (e.g. after Clear() or after initializing the object).
+  /// It never makes the table smaller.
+  void SetSize(size_t sz);
+
+  /// Returns current number of hash slots.
+  inline size_t Size() { return slots_.size(); }
+
+  ~OpenHashList();
+ private:
+  static_assert(std::is_integral<I>::value,
+                "OpenHashList requires an integer key type.");
+
+  struct Slot {
+    I key;
+    uint32 stamp;  // the slot is occupied only if stamp == stamp_.
+    Elem *elem;
+  };
+
+  // Fibonacci hashing: takes the top bits of key * 2^64 / golden ratio, which
+  // spreads consecutive state-ids (common in decoding graphs) over the table.
+  inline size_t Index(I key) const {
+    return static_cast<size_t>(
+        (static_cast<uint64>(key) * 11400714819323198485ULL) >> shift_);
+  }
+
+  // Allocates 'size' slots (a power of two) and re-inserts the elements of
+  // the current list.
+  void Rehash(size_t size);
+
+  Elem *list_head_;  // head of currently stored list.
+  Elem *list_tail_;  // tail of currently stored list (NULL if empty).
+  size_t num_elems_;  // number of elements in the hash.
+
+  std::vector<Slot> slots_;
+  size_t mask_;  // slots_.size() - 1.
+  int32 shift_;  // 64 - log2(slots_.size()).
+  uint32 stamp_;
+
+  Elem *freed_head_;  // head of list of currently freed elements. [ready for
+  // allocation]
+
+  std::vector<Elem*> allocated_;  // list of allocated blocks.
+
+  static const size_t allocate_block_size_ = 1024;  // Number of Elements to
+  // allocate in one block.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OpenHashList);
+};
+
+
+}  // end namespace kaldi
+
+#include "util/open-hash-list-inl.h"
+
+#endif  // KALDI_UTIL_OPEN_HASH_LIST_H_
@@ -51,6 +51,13 @@ typedef RandomAccessTableReader<KaldiObjectHolder<Matrix<double> > >
 typedef RandomAccessTableReaderMapped<KaldiObjectHolder<Matrix<double> > >
                                       RandomAccessDoubleMatrixReaderMapped;
 
+// Readers that return SubMatrix views; with the "mmap" rspecifier option they
+// don't copy the data (see MatrixViewHolder).
+typedef SequentialTableReader<MatrixViewHolder<BaseFloat> >
+                              SequentialBaseFloatMatrixViewReader;
+typedef RandomAccessTableReader<MatrixViewHolder<BaseFloat> >
+                                RandomAccessBaseFloatMatrixViewReader;
+
 typedef TableWriter<KaldiObjectHolder<CompressedMatrix> >
                                       CompressedMatrixWriter;
 